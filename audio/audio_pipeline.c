@@ -0,0 +1,212 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <retro_miscellaneous.h>
+#include <audio/conversion/float_to_s16.h>
+#include <audio/conversion/s16_to_float.h>
+#ifdef HAVE_AUDIOMIXER
+#include <audio/audio_mixer.h>
+#endif
+
+#include "audio_pipeline.h"
+#include "../performance_counters.h"
+
+/* The SIMD paths of convert_float_to_s16() round, while its scalar
+ * tail truncates. Converting only whole groups of this many samples
+ * until the end of the flush keeps every sample on the same path it
+ * would take if the whole buffer were converted in one go. */
+#define AUDIO_PIPELINE_CONVERT_ALIGN 8
+
+bool audio_pipeline_init(audio_pipeline_t *pipe, double max_ratio)
+{
+   /* The resampler may emit a frame more than the ratio implies, and
+    * up to AUDIO_PIPELINE_CONVERT_ALIGN - 1 samples are carried over
+    * from the previous block. */
+   size_t output_size = ((size_t)ceil(AUDIO_PIPELINE_BLOCK_FRAMES
+            * max_ratio) + 16) * 2 + AUDIO_PIPELINE_CONVERT_ALIGN;
+
+   memset(pipe, 0, sizeof(*pipe));
+
+   pipe->input       = (float*)malloc(
+         AUDIO_PIPELINE_BLOCK_FRAMES * 2 * sizeof(float));
+   pipe->output      = (float*)malloc(output_size * sizeof(float));
+   pipe->output_s16  = (int16_t*)malloc(output_size * sizeof(int16_t));
+   pipe->output_size = output_size;
+
+   if (!pipe->input || !pipe->output || !pipe->output_s16)
+   {
+      audio_pipeline_free(pipe);
+      return false;
+   }
+
+   return true;
+}
+
+void audio_pipeline_free(audio_pipeline_t *pipe)
+{
+   if (pipe->input)
+      free(pipe->input);
+   if (pipe->output)
+      free(pipe->output);
+   if (pipe->output_s16)
+      free(pipe->output_s16);
+
+   memset(pipe, 0, sizeof(*pipe));
+}
+
+/* Hands @samples of fresh output, which follow *carry samples held
+ * back earlier at the start of pipe->output, to the driver. */
+static bool audio_pipeline_write(audio_pipeline_t *pipe,
+      const audio_pipeline_stages_t *stages,
+      size_t *carry, size_t samples, bool flush)
+{
+   size_t avail = *carry + samples;
+   size_t count = avail;
+
+   if (stages->use_float)
+      return !count || stages->write(stages->write_data,
+            pipe->output, count * sizeof(float)) >= 0;
+
+   if (!flush)
+      count &= ~(size_t)(AUDIO_PIPELINE_CONVERT_ALIGN - 1);
+
+   *carry = avail - count;
+
+   if (!count)
+      return true;
+
+   convert_float_to_s16(pipe->output_s16, pipe->output, count);
+
+   if (*carry)
+      memmove(pipe->output, pipe->output + count,
+            *carry * sizeof(float));
+
+   return stages->write(stages->write_data,
+         pipe->output_s16, count * sizeof(int16_t)) >= 0;
+}
+
+static bool audio_pipeline_passthrough(audio_pipeline_t *pipe,
+      const audio_pipeline_stages_t *stages,
+      const int16_t *data, size_t samples)
+{
+   size_t offset;
+   size_t carry = 0;
+
+   /* Without gain, the conversion to float and back is exact. */
+   if (!stages->use_float && stages->gain == 1.0f)
+      return stages->write(stages->write_data,
+            data, samples * sizeof(int16_t)) >= 0;
+
+   for (offset = 0; offset < samples;
+         offset += AUDIO_PIPELINE_BLOCK_FRAMES * 2)
+   {
+      size_t block = MIN(AUDIO_PIPELINE_BLOCK_FRAMES * 2, samples - offset);
+
+      convert_s16_to_float(pipe->output, data + offset, block,
+            stages->gain);
+
+      if (!audio_pipeline_write(pipe, stages, &carry, block, false))
+         return false;
+   }
+
+   return audio_pipeline_write(pipe, stages, &carry, 0, true);
+}
+
+bool audio_pipeline_process(audio_pipeline_t *pipe,
+      const audio_pipeline_stages_t *stages,
+      const int16_t *data, size_t samples)
+{
+   size_t offset;
+   size_t carry = 0;
+
+   if (     stages->passthrough
+         && !stages->dsp
+         && !stages->mixer
+         && fabs(stages->ratio - 1.0) < AUDIO_PIPELINE_PASSTHROUGH_EPSILON)
+      return audio_pipeline_passthrough(pipe, stages, data, samples);
+
+   for (offset = 0; offset < samples;
+         offset += AUDIO_PIPELINE_BLOCK_FRAMES * 2)
+   {
+      size_t block        = MIN(AUDIO_PIPELINE_BLOCK_FRAMES * 2,
+            samples - offset);
+      const float *input  = pipe->input;
+      size_t frames       = block >> 1;
+
+      convert_s16_to_float(pipe->input, data + offset, block,
+            stages->gain);
+
+#ifdef HAVE_DSP_FILTER
+      if (stages->dsp)
+      {
+         struct retro_dsp_data dsp_data;
+
+         dsp_data.input         = pipe->input;
+         dsp_data.input_frames  = (unsigned)frames;
+         dsp_data.output        = NULL;
+         dsp_data.output_frames = 0;
+
+         retro_dsp_filter_process(stages->dsp, &dsp_data);
+
+         if (dsp_data.output)
+         {
+            input               = dsp_data.output;
+            frames              = dsp_data.output_frames;
+         }
+      }
+#endif
+
+      /* Block based filters (eq) may hand back more than a block. */
+      while (frames)
+      {
+         struct resampler_data src_data;
+         size_t chunk           = MIN(frames, AUDIO_PIPELINE_BLOCK_FRAMES);
+
+         src_data.data_in       = input;
+         src_data.input_frames  = chunk;
+         src_data.data_out      = pipe->output + carry;
+         src_data.output_frames = 0;
+         src_data.ratio         = stages->ratio;
+
+         stages->resampler->process(stages->resampler_data, &src_data);
+
+#ifdef HAVE_AUDIOMIXER
+         if (stages->mixer)
+         {
+            performance_counter_start_plus(stages->mixer_perf != NULL,
+                  (*stages->mixer_perf));
+            audio_mixer_mix(pipe->output + carry, src_data.output_frames,
+                  stages->mixer_gain, stages->mixer_override);
+            performance_counter_stop_plus(stages->mixer_perf != NULL,
+                  (*stages->mixer_perf));
+         }
+#endif
+
+         if (!audio_pipeline_write(pipe, stages, &carry,
+                  src_data.output_frames * 2, false))
+            return false;
+
+         input                 += chunk * 2;
+         frames                -= chunk;
+      }
+   }
+
+   return audio_pipeline_write(pipe, stages, &carry, 0, true);
+}
@@ -0,0 +1,113 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AUDIO_PIPELINE_H__
+#define __AUDIO_PIPELINE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <audio/audio_resampler.h>
+#include <audio/dsp_filter.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Stereo frames taken from the core's buffer per pass through the
+ * stages; small enough for the float blocks to stay in L1. */
+#define AUDIO_PIPELINE_BLOCK_FRAMES        256
+/* The resampler is skipped when the ratio is this close to 1 */
+#define AUDIO_PIPELINE_PASSTHROUGH_EPSILON 0.00001
+
+typedef struct audio_pipeline
+{
+   /* AUDIO_PIPELINE_BLOCK_FRAMES * 2 samples */
+   float *input;
+   /* output_size samples each */
+   float *output;
+   int16_t *output_s16;
+   size_t output_size;
+} audio_pipeline_t;
+
+/* Everything one flush goes through. Owned by the audio driver
+ * state and filled in for every call. */
+typedef struct audio_pipeline_stages
+{
+   ssize_t (*write)(void *data, const void *buf, size_t size);
+   void *write_data;
+
+   const retro_resampler_t *resampler;
+   void *resampler_data;
+
+   /* NULL when no DSP filter is loaded */
+   retro_dsp_filter_t *dsp;
+
+   /* Times the mixer when set */
+   struct retro_perf_counter *mixer_perf;
+
+   double ratio;
+   float gain;
+   float mixer_gain;
+
+   bool mixer;
+   bool mixer_override;
+   bool use_float;
+   /* Whether the resampler may be skipped when the ratio is ~1.
+    * Only safe when the ratio does not wander around 1 (no dynamic
+    * rate control), as every switch moves the resampler's delay. */
+   bool passthrough;
+} audio_pipeline_stages_t;
+
+/**
+ * audio_pipeline_init:
+ * @pipe               : Pipeline to set up.
+ * @max_ratio          : Largest resampling ratio that will be used.
+ *
+ * Allocates the per-block scratch buffers.
+ *
+ * Returns: true on success, otherwise false.
+ **/
+bool audio_pipeline_init(audio_pipeline_t *pipe, double max_ratio);
+
+void audio_pipeline_free(audio_pipeline_t *pipe);
+
+/**
+ * audio_pipeline_process:
+ * @pipe               : Pipeline.
+ * @stages             : Stages and parameters of this flush.
+ * @data               : Interleaved stereo samples from the core.
+ * @samples            : Number of samples (not frames) in @data.
+ *
+ * Streams @data through gain and float conversion, the DSP filter,
+ * the resampler, the mixer and the conversion back to the driver's
+ * format one block at a time, writing each block to the driver as
+ * it is done. The output is bit-identical to running every stage
+ * over the whole buffer in turn. When only gain and resampling at a
+ * ratio of ~1 are left to do (and @stages allows it), the float
+ * round trip is skipped altogether.
+ *
+ * Returns: false if the driver failed a write, otherwise true.
+ **/
+bool audio_pipeline_process(audio_pipeline_t *pipe,
+      const audio_pipeline_stages_t *stages,
+      const int16_t *data, size_t samples);
+
+RETRO_END_DECLS
+
+#endif
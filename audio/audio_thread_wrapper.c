@@ -21,6 +21,7 @@
 #include <rthreads/rthreads.h>
 
 #include "audio_thread_wrapper.h"
+#include "../performance_trace.h"
 #include "../verbosity.h"
 
 typedef struct audio_thread
@@ -75,8 +76,12 @@ static void audio_thread_loop(void *data)
       scond_wait(thr->cond, thr->lock);
    slock_unlock(thr->lock);
 
+   performance_trace_set_thread_name("audio");
+
    for (;;)
    {
+      retro_perf_tick_t trace_start;
+
       slock_lock(thr->lock);
 
       if (!thr->alive)
@@ -104,9 +109,13 @@ static void audio_thread_loop(void *data)
       }
 
       slock_unlock(thr->lock);
+
+      performance_trace_scope_begin(trace_start);
       audio_driver_callback();
+      performance_trace_scope_end(trace_start, "audio_thread_callback");
    }
 
+   performance_trace_thread_exit();
    thr->driver->free(thr->driver_data);
 }
 
@@ -0,0 +1,650 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2020 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <formats/jsonsax_full.h>
+#include <lists/string_list.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "benchmark.h"
+
+#define BENCHMARK_REPORT_VERSION 1
+
+typedef struct benchmark_counter
+{
+   const struct retro_perf_counter *perf;
+   /* Growth of 'total' and 'call_cnt' in each recorded frame */
+   retro_perf_tick_t *ticks;
+   uint32_t *calls;
+   retro_perf_tick_t last_total;
+   retro_perf_tick_t last_calls;
+   char ident[64];
+   bool core;
+} benchmark_counter_t;
+
+struct benchmark
+{
+   benchmark_counter_t *counters;
+   /* Wall clock length of each recorded frame */
+   retro_time_t *frame_usec;
+   size_t num_counters;
+   size_t cap_counters;
+   retro_perf_tick_t start_ticks;
+   retro_perf_tick_t last_ticks;
+   retro_time_t start_usec;
+   retro_time_t last_usec;
+   unsigned frames;
+   unsigned frame;
+   unsigned features;
+   bool started;
+};
+
+typedef struct benchmark_json
+{
+   JSON_Writer writer;
+   /* NULL when writing to stdout */
+   RFILE *file;
+   double ticks_per_usec;
+} benchmark_json_t;
+
+static const struct
+{
+   const char *name;
+   unsigned feature;
+} benchmark_feature_names[] = {
+   { "rewind",   BENCHMARK_FEATURE_REWIND   },
+   { "runahead", BENCHMARK_FEATURE_RUNAHEAD },
+   { "netplay",  BENCHMARK_FEATURE_NETPLAY  },
+   { "record",   BENCHMARK_FEATURE_RECORD   },
+   { "filter",   BENCHMARK_FEATURE_FILTER   }
+};
+
+bool benchmark_parse_features(const char *list, unsigned *features)
+{
+   size_t i, j;
+   bool ret                   = true;
+   struct string_list *names  = NULL;
+
+   *features                  = 0;
+
+   if (string_is_empty(list))
+      return true;
+
+   if (!(names = string_split(list, ",")))
+      return false;
+
+   for (i = 0; i < names->size; i++)
+   {
+      bool found = false;
+
+      for (j = 0; j < ARRAY_SIZE(benchmark_feature_names); j++)
+      {
+         if (string_is_equal(names->elems[i].data,
+                  benchmark_feature_names[j].name))
+         {
+            *features |= benchmark_feature_names[j].feature;
+            found      = true;
+            break;
+         }
+      }
+
+      if (!found)
+         ret = false;
+   }
+
+   string_list_free(names);
+   return ret;
+}
+
+benchmark_t *benchmark_new(unsigned frames, unsigned features)
+{
+   benchmark_t *bench = NULL;
+
+   if (!frames)
+      return NULL;
+
+   if (!(bench = (benchmark_t*)calloc(1, sizeof(*bench))))
+      return NULL;
+
+   bench->frames     = frames;
+   bench->features   = features;
+   bench->frame_usec = (retro_time_t*)calloc(frames,
+         sizeof(*bench->frame_usec));
+
+   if (!bench->frame_usec)
+   {
+      free(bench);
+      return NULL;
+   }
+
+   return bench;
+}
+
+void benchmark_free(benchmark_t *bench)
+{
+   size_t i;
+
+   if (!bench)
+      return;
+
+   for (i = 0; i < bench->num_counters; i++)
+   {
+      free(bench->counters[i].ticks);
+      free(bench->counters[i].calls);
+   }
+
+   free(bench->counters);
+   free(bench->frame_usec);
+   free(bench);
+}
+
+unsigned benchmark_get_features(const benchmark_t *bench)
+{
+   return bench->features;
+}
+
+unsigned benchmark_get_frames(const benchmark_t *bench)
+{
+   return bench->frame;
+}
+
+/* The registration lists only ever grow (the core's is cleared when
+ * it is unloaded), so the counter after the previous match is
+ * nearly always the one looked for. */
+static benchmark_counter_t *benchmark_find_counter(benchmark_t *bench,
+      const struct retro_perf_counter *perf, bool core, size_t *hint)
+{
+   size_t i;
+
+   for (i = 0; i < bench->num_counters; i++)
+   {
+      size_t idx                = (*hint + i) % bench->num_counters;
+      benchmark_counter_t *slot = &bench->counters[idx];
+
+      if (slot->perf == perf && slot->core == core)
+      {
+         *hint = idx + 1;
+         return slot;
+      }
+   }
+
+   return NULL;
+}
+
+static benchmark_counter_t *benchmark_add_counter(benchmark_t *bench,
+      const struct retro_perf_counter *perf, bool core)
+{
+   benchmark_counter_t *slot = NULL;
+
+   if (bench->num_counters == bench->cap_counters)
+   {
+      size_t new_cap                = bench->cap_counters
+         ? bench->cap_counters * 2 : 32;
+      benchmark_counter_t *counters = (benchmark_counter_t*)realloc(
+            bench->counters, new_cap * sizeof(*counters));
+
+      if (!counters)
+         return NULL;
+
+      bench->counters     = counters;
+      bench->cap_counters = new_cap;
+   }
+
+   slot        = &bench->counters[bench->num_counters];
+   memset(slot, 0, sizeof(*slot));
+   slot->ticks = (retro_perf_tick_t*)calloc(bench->frames,
+         sizeof(*slot->ticks));
+   slot->calls = (uint32_t*)calloc(bench->frames, sizeof(*slot->calls));
+
+   if (!slot->ticks || !slot->calls)
+   {
+      free(slot->ticks);
+      free(slot->calls);
+      return NULL;
+   }
+
+   slot->perf  = perf;
+   slot->core  = core;
+   strlcpy(slot->ident, perf->ident ? perf->ident : "unnamed",
+         sizeof(slot->ident));
+
+   bench->num_counters++;
+   return slot;
+}
+
+static void benchmark_sample_counters(benchmark_t *bench,
+      struct retro_perf_counter **counters, unsigned num, bool core)
+{
+   unsigned i;
+   size_t hint = 0;
+
+   for (i = 0; i < num; i++)
+   {
+      const struct retro_perf_counter *perf = counters[i];
+      benchmark_counter_t *slot             = NULL;
+
+      if (!perf)
+         continue;
+
+      if (!(slot = benchmark_find_counter(bench, perf, core, &hint)))
+      {
+         if (!(slot = benchmark_add_counter(bench, perf, core)))
+            continue;
+
+         /* Counters that exist before the first frame only count
+          * from there; later ones were registered during the frame
+          * that just ended, at zero. */
+         if (!bench->started)
+         {
+            slot->last_total = perf->total;
+            slot->last_calls = perf->call_cnt;
+         }
+      }
+
+      if (bench->started)
+      {
+         /* A counter going backwards was reset - e.g. the core was
+          * reloaded - and has only counted since then. */
+         retro_perf_tick_t ticks = (perf->total >= slot->last_total)
+            ? perf->total - slot->last_total : perf->total;
+         retro_perf_tick_t calls = (perf->call_cnt >= slot->last_calls)
+            ? perf->call_cnt - slot->last_calls : perf->call_cnt;
+
+         slot->ticks[bench->frame] = ticks;
+         slot->calls[bench->frame] = (uint32_t)calls;
+      }
+
+      slot->last_total = perf->total;
+      slot->last_calls = perf->call_cnt;
+   }
+}
+
+bool benchmark_frame(benchmark_t *bench,
+      struct retro_perf_counter **counters, unsigned num_counters,
+      struct retro_perf_counter **core_counters, unsigned num_core_counters)
+{
+   retro_perf_tick_t now_ticks;
+   retro_time_t now_usec;
+
+   if (!bench || bench->frame >= bench->frames)
+      return false;
+
+   now_ticks = cpu_features_get_perf_counter();
+   now_usec  = cpu_features_get_time_usec();
+
+   benchmark_sample_counters(bench, counters, num_counters, false);
+   benchmark_sample_counters(bench, core_counters, num_core_counters, true);
+
+   if (!bench->started)
+   {
+      bench->start_ticks = now_ticks;
+      bench->start_usec  = now_usec;
+      bench->started     = true;
+   }
+   else
+      bench->frame_usec[bench->frame++] = now_usec - bench->last_usec;
+
+   bench->last_ticks = now_ticks;
+   bench->last_usec  = now_usec;
+
+   return bench->frame < bench->frames;
+}
+
+static int benchmark_tick_cmp(const void *a, const void *b)
+{
+   retro_perf_tick_t x = *(const retro_perf_tick_t*)a;
+   retro_perf_tick_t y = *(const retro_perf_tick_t*)b;
+   return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of the sorted @values */
+static retro_perf_tick_t benchmark_percentile(
+      const retro_perf_tick_t *values, size_t num, unsigned percent)
+{
+   size_t rank = (num * percent + 99) / 100;
+   return values[rank ? rank - 1 : 0];
+}
+
+/* Sorts @values */
+static void benchmark_summarize(retro_perf_tick_t *values, size_t num,
+      uint64_t calls, benchmark_stats_t *stats)
+{
+   size_t i;
+   retro_perf_tick_t sum = 0;
+
+   memset(stats, 0, sizeof(*stats));
+   stats->calls  = calls;
+   stats->frames = num;
+
+   if (!num)
+      return;
+
+   qsort(values, num, sizeof(*values), benchmark_tick_cmp);
+
+   for (i = 0; i < num; i++)
+      sum += values[i];
+
+   stats->min  = values[0];
+   stats->max  = values[num - 1];
+   stats->mean = sum / num;
+   stats->p50  = benchmark_percentile(values, num, 50);
+   stats->p90  = benchmark_percentile(values, num, 90);
+   stats->p99  = benchmark_percentile(values, num, 99);
+}
+
+/* @scratch holds bench->frames values */
+static void benchmark_counter_stats(const benchmark_t *bench,
+      const benchmark_counter_t *slot, retro_perf_tick_t *scratch,
+      benchmark_stats_t *stats)
+{
+   unsigned i;
+   size_t num     = 0;
+   uint64_t calls = 0;
+
+   for (i = 0; i < bench->frame; i++)
+   {
+      if (!slot->calls[i])
+         continue;
+      calls          += slot->calls[i];
+      scratch[num++]  = slot->ticks[i];
+   }
+
+   benchmark_summarize(scratch, num, calls, stats);
+}
+
+bool benchmark_get_stats(benchmark_t *bench, const char *ident,
+      benchmark_stats_t *stats)
+{
+   size_t i;
+
+   if (!bench || string_is_empty(ident))
+      return false;
+
+   for (i = 0; i < bench->num_counters; i++)
+   {
+      retro_perf_tick_t *scratch = NULL;
+
+      if (!string_is_equal(bench->counters[i].ident, ident))
+         continue;
+
+      if (!(scratch = (retro_perf_tick_t*)malloc(
+                  bench->frames * sizeof(*scratch))))
+         return false;
+
+      benchmark_counter_stats(bench, &bench->counters[i], scratch, stats);
+      free(scratch);
+      return true;
+   }
+
+   return false;
+}
+
+static JSON_Writer_HandlerResult benchmark_json_output(JSON_Writer writer,
+      const char *pBytes, size_t length)
+{
+   benchmark_json_t *ctx = (benchmark_json_t*)JSON_Writer_GetUserData(writer);
+
+   if (ctx->file)
+      return (filestream_write(ctx->file, pBytes, length) == (int64_t)length)
+         ? JSON_Writer_Continue : JSON_Writer_Abort;
+
+   return (fwrite(pBytes, 1, length, stdout) == length)
+      ? JSON_Writer_Continue : JSON_Writer_Abort;
+}
+
+static void benchmark_json_key(benchmark_json_t *ctx, size_t indent,
+      const char *key)
+{
+   if (indent)
+   {
+      JSON_Writer_WriteNewLine(ctx->writer);
+      JSON_Writer_WriteSpace(ctx->writer, indent);
+   }
+   JSON_Writer_WriteString(ctx->writer, key, strlen(key), JSON_UTF8);
+   JSON_Writer_WriteColon(ctx->writer);
+   JSON_Writer_WriteSpace(ctx->writer, 1);
+}
+
+static void benchmark_json_string(benchmark_json_t *ctx, const char *str)
+{
+   if (!str)
+      JSON_Writer_WriteNull(ctx->writer);
+   else
+      JSON_Writer_WriteString(ctx->writer, str, strlen(str), JSON_UTF8);
+}
+
+static void benchmark_json_uint(benchmark_json_t *ctx, uint64_t value)
+{
+   char buf[32];
+   int n = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+   if (n > 0 && n < (int)sizeof(buf))
+      JSON_Writer_WriteNumber(ctx->writer, buf, n, JSON_UTF8);
+}
+
+static void benchmark_json_double(benchmark_json_t *ctx, double value)
+{
+   char buf[64];
+   int n = snprintf(buf, sizeof(buf), "%.3f", value);
+   if (n > 0 && n < (int)sizeof(buf))
+      JSON_Writer_WriteNumber(ctx->writer, buf, n, JSON_UTF8);
+}
+
+/* Writes the members of @stats (without braces), in microseconds
+ * unless @ticks_per_usec is 0. */
+static void benchmark_json_stats(benchmark_json_t *ctx,
+      const benchmark_stats_t *stats, bool calls, double ticks_per_usec)
+{
+   double scale = ticks_per_usec > 0.0 ? 1.0 / ticks_per_usec : 1.0;
+
+   benchmark_json_key(ctx, 0, "frames");
+   benchmark_json_uint(ctx, stats->frames);
+   if (calls)
+   {
+      JSON_Writer_WriteComma(ctx->writer);
+      JSON_Writer_WriteSpace(ctx->writer, 1);
+      benchmark_json_key(ctx, 0, "calls");
+      benchmark_json_uint(ctx, stats->calls);
+   }
+#define BENCHMARK_JSON_STAT(name, field) \
+   JSON_Writer_WriteComma(ctx->writer); \
+   JSON_Writer_WriteSpace(ctx->writer, 1); \
+   benchmark_json_key(ctx, 0, name); \
+   benchmark_json_double(ctx, (double)stats->field * scale)
+   BENCHMARK_JSON_STAT("mean_us", mean);
+   BENCHMARK_JSON_STAT("min_us",  min);
+   BENCHMARK_JSON_STAT("p50_us",  p50);
+   BENCHMARK_JSON_STAT("p90_us",  p90);
+   BENCHMARK_JSON_STAT("p99_us",  p99);
+   BENCHMARK_JSON_STAT("max_us",  max);
+#undef BENCHMARK_JSON_STAT
+}
+
+static void benchmark_json_write(benchmark_t *bench, benchmark_json_t *ctx,
+      const benchmark_report_info_t *info, retro_perf_tick_t *scratch)
+{
+   size_t i;
+   benchmark_stats_t stats;
+   JSON_Writer writer  = ctx->writer;
+   retro_time_t usec   = bench->last_usec - bench->start_usec;
+
+   JSON_Writer_WriteStartObject(writer);
+
+   benchmark_json_key(ctx, 2, "version");
+   benchmark_json_uint(ctx, BENCHMARK_REPORT_VERSION);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "core");
+   benchmark_json_string(ctx, info ? info->core_name : NULL);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "core_version");
+   benchmark_json_string(ctx, info ? info->core_version : NULL);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "content");
+   benchmark_json_string(ctx, info ? info->content_path : NULL);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "frames_requested");
+   benchmark_json_uint(ctx, bench->frames);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "frames");
+   benchmark_json_uint(ctx, bench->frame);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "duration_ms");
+   benchmark_json_double(ctx, (double)usec / 1000.0);
+   JSON_Writer_WriteComma(writer);
+
+   benchmark_json_key(ctx, 2, "ticks_per_us");
+   benchmark_json_double(ctx, ctx->ticks_per_usec);
+   JSON_Writer_WriteComma(writer);
+
+   /* > Features */
+   benchmark_json_key(ctx, 2, "features");
+   JSON_Writer_WriteStartObject(writer);
+   for (i = 0; i < ARRAY_SIZE(benchmark_feature_names); i++)
+   {
+      unsigned feature = benchmark_feature_names[i].feature;
+
+      benchmark_json_key(ctx, 4, benchmark_feature_names[i].name);
+      JSON_Writer_WriteStartObject(writer);
+      benchmark_json_key(ctx, 0, "requested");
+      JSON_Writer_WriteBoolean(writer,
+            (bench->features & feature) ? JSON_True : JSON_False);
+      JSON_Writer_WriteComma(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      benchmark_json_key(ctx, 0, "active");
+      JSON_Writer_WriteBoolean(writer,
+            (info && (info->features_active & feature))
+            ? JSON_True : JSON_False);
+      JSON_Writer_WriteEndObject(writer);
+      if (i + 1 < ARRAY_SIZE(benchmark_feature_names))
+         JSON_Writer_WriteComma(writer);
+   }
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteComma(writer);
+
+   /* > Wall clock frame time */
+   for (i = 0; i < bench->frame; i++)
+      scratch[i] = (retro_perf_tick_t)bench->frame_usec[i];
+   benchmark_summarize(scratch, bench->frame, bench->frame, &stats);
+
+   benchmark_json_key(ctx, 2, "frame_time");
+   JSON_Writer_WriteStartObject(writer);
+   benchmark_json_stats(ctx, &stats, false, 0.0);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteComma(writer);
+
+   /* > Counters, in order of registration */
+   benchmark_json_key(ctx, 2, "stages");
+   JSON_Writer_WriteStartArray(writer);
+   for (i = 0; i < bench->num_counters; i++)
+   {
+      const benchmark_counter_t *slot = &bench->counters[i];
+
+      benchmark_counter_stats(bench, slot, scratch, &stats);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      JSON_Writer_WriteStartObject(writer);
+      benchmark_json_key(ctx, 0, "name");
+      benchmark_json_string(ctx, slot->ident);
+      JSON_Writer_WriteComma(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      benchmark_json_key(ctx, 0, "source");
+      benchmark_json_string(ctx, slot->core ? "core" : "frontend");
+      JSON_Writer_WriteComma(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      benchmark_json_stats(ctx, &stats, true, ctx->ticks_per_usec);
+      JSON_Writer_WriteEndObject(writer);
+      if (i + 1 < bench->num_counters)
+         JSON_Writer_WriteComma(writer);
+   }
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteEndArray(writer);
+
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+}
+
+bool benchmark_write_report(benchmark_t *bench, const char *path,
+      const benchmark_report_info_t *info)
+{
+   benchmark_json_t ctx;
+   retro_perf_tick_t *scratch = NULL;
+   retro_time_t usec          = 0;
+   bool success               = false;
+
+   if (!bench)
+      return false;
+
+   ctx.writer         = NULL;
+   ctx.file           = NULL;
+   ctx.ticks_per_usec = 0.0;
+
+   /* The tick counter has no fixed rate (TSC, nanoseconds, ...) */
+   usec               = bench->last_usec - bench->start_usec;
+   if (usec > 0)
+      ctx.ticks_per_usec = (double)(bench->last_ticks - bench->start_ticks)
+         / (double)usec;
+   if (ctx.ticks_per_usec <= 0.0)
+      ctx.ticks_per_usec = 1.0;
+
+   if (!(scratch = (retro_perf_tick_t*)malloc(
+               bench->frames * sizeof(*scratch))))
+      return false;
+
+   if (!string_is_empty(path))
+   {
+      if (!(ctx.file = filestream_open(path,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto end;
+   }
+
+   if (!(ctx.writer = JSON_Writer_Create(NULL)))
+      goto end;
+
+   JSON_Writer_SetOutputEncoding(ctx.writer, JSON_UTF8);
+   JSON_Writer_SetOutputHandler(ctx.writer, &benchmark_json_output);
+   JSON_Writer_SetUserData(ctx.writer, &ctx);
+
+   benchmark_json_write(bench, &ctx, info, scratch);
+
+   success = JSON_Writer_GetError(ctx.writer) == JSON_Error_None;
+
+end:
+   if (ctx.writer)
+      JSON_Writer_Free(ctx.writer);
+   if (ctx.file)
+      filestream_close(ctx.file);
+   else if (success)
+      fflush(stdout);
+   free(scratch);
+   return success;
+}
@@ -0,0 +1,145 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2020 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Records, for a fixed number of frames, how much time each
+ * registered performance counter accounted for in every frame,
+ * and writes the distribution of those per-frame times as JSON.
+ *
+ * The counters themselves are not touched: each frame only the
+ * growth of their 'total' and 'call_cnt' since the previous frame
+ * is stored. Counters registered while the benchmark is running
+ * are picked up from the frame they first show up in.
+ *
+ * Not thread safe - only used from the main thread. */
+
+enum benchmark_feature
+{
+   BENCHMARK_FEATURE_REWIND   = (1 << 0),
+   BENCHMARK_FEATURE_RUNAHEAD = (1 << 1),
+   BENCHMARK_FEATURE_NETPLAY  = (1 << 2),
+   BENCHMARK_FEATURE_RECORD   = (1 << 3),
+   BENCHMARK_FEATURE_FILTER   = (1 << 4)
+};
+
+typedef struct benchmark benchmark_t;
+
+/* Per-frame time of one counter, in counter ticks. Frames the
+ * counter was not called in are left out. */
+typedef struct benchmark_stats
+{
+   uint64_t frames;
+   uint64_t calls;
+   retro_perf_tick_t min;
+   retro_perf_tick_t mean;
+   retro_perf_tick_t p50;
+   retro_perf_tick_t p90;
+   retro_perf_tick_t p99;
+   retro_perf_tick_t max;
+} benchmark_stats_t;
+
+typedef struct benchmark_report_info
+{
+   const char *core_name;
+   const char *core_version;
+   const char *content_path;
+   /* BENCHMARK_FEATURE_* that actually ran */
+   unsigned features_active;
+} benchmark_report_info_t;
+
+/**
+ * benchmark_parse_features:
+ * @list               : Comma separated feature names, e.g.
+ *                       "rewind,runahead".
+ * @features           : Set to the matching BENCHMARK_FEATURE_* bits.
+ *
+ * Returns: false if @list names an unknown feature.
+ **/
+bool benchmark_parse_features(const char *list, unsigned *features);
+
+/**
+ * benchmark_new:
+ * @frames             : Number of frames to record.
+ * @features           : BENCHMARK_FEATURE_* bits asked for.
+ *
+ * Returns: new benchmark, or NULL on allocation failure.
+ **/
+benchmark_t *benchmark_new(unsigned frames, unsigned features);
+
+void benchmark_free(benchmark_t *bench);
+
+unsigned benchmark_get_features(const benchmark_t *bench);
+
+/* Number of frames recorded so far */
+unsigned benchmark_get_frames(const benchmark_t *bench);
+
+/**
+ * benchmark_frame:
+ * @bench              : Benchmark.
+ * @counters           : Frontend counters.
+ * @num_counters       : Number of frontend counters.
+ * @core_counters      : Counters registered by the core.
+ * @num_core_counters  : Number of core counters.
+ *
+ * Marks the start of a new frame. The first call only takes the
+ * baseline; every following call records the frame that just
+ * ended. Does nothing once all frames are recorded.
+ *
+ * Returns: true while more frames are wanted.
+ **/
+bool benchmark_frame(benchmark_t *bench,
+      struct retro_perf_counter **counters, unsigned num_counters,
+      struct retro_perf_counter **core_counters, unsigned num_core_counters);
+
+/**
+ * benchmark_get_stats:
+ * @bench              : Benchmark.
+ * @ident              : Counter name.
+ * @stats              : Filled in on success.
+ *
+ * Returns: false if no counter named @ident was seen.
+ **/
+bool benchmark_get_stats(benchmark_t *bench, const char *ident,
+      benchmark_stats_t *stats);
+
+/**
+ * benchmark_write_report:
+ * @bench              : Benchmark.
+ * @path               : File to write to, or NULL/empty for stdout.
+ * @info               : What was benchmarked.
+ *
+ * Writes the JSON report. Times are converted from counter ticks to
+ * microseconds using the rate the tick counter advanced at over the
+ * whole run.
+ *
+ * Returns: true on success.
+ **/
+bool benchmark_write_report(benchmark_t *bench, const char *path,
+      const benchmark_report_info_t *info);
+
+RETRO_END_DECLS
+
+#endif
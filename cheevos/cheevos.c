@@ -68,6 +68,7 @@
 #include "../core.h"
 #include "../version.h"
 
+#include "../content_fingerprint.h"
 #include "../frontend/frontend_driver.h"
 #include "../network/net_http_special.h"
 #include "../tasks/tasks_internal.h"
@@ -1539,6 +1540,35 @@ enum
    RCHEEVOS_DELAY        = -8
 };
 
+/* Hashes are only remembered for content loaded from a file: data in
+ * memory may have been patched. */
+static bool rcheevos_get_fingerprint(const rcheevos_coro_t *coro,
+      char *hash)
+{
+   content_fingerprint_t fp;
+
+   if (     coro->data
+         || !content_fingerprint_get(coro->path, NULL, &fp)
+         || !(fp.flags & CONTENT_FINGERPRINT_CHEEVOS))
+      return false;
+
+   strlcpy(hash, fp.cheevos_hash, sizeof(fp.cheevos_hash));
+   return true;
+}
+
+static void rcheevos_set_fingerprint(const rcheevos_coro_t *coro)
+{
+   content_fingerprint_t fp;
+
+   if (coro->data)
+      return;
+
+   fp.flags = CONTENT_FINGERPRINT_CHEEVOS;
+   strlcpy(fp.cheevos_hash, coro->hash, sizeof(fp.cheevos_hash));
+   content_fingerprint_update(coro->path, NULL, &fp);
+   content_fingerprint_flush();
+}
+
 static int rcheevos_iterate(rcheevos_coro_t* coro)
 {
    char buffer[2048];
@@ -1556,25 +1586,37 @@ static int rcheevos_iterate(rcheevos_coro_t* coro)
       if (!coro->settings->bools.cheevos_enable)
          CORO_STOP();
 
-      /* iterate over the possible hashes for the file being loaded */
-      rc_hash_initialize_iterator(&coro->iterator, coro->path, (uint8_t*)coro->data, coro->len);
+      /* the hash that matched the last time the file was loaded, if
+       * it did not change since, saves reading it again */
+      coro->gameid = 0;
+      if (rcheevos_get_fingerprint(coro, coro->hash))
+         CORO_GOSUB(RCHEEVOS_GET_GAMEID);
+
+      if (coro->gameid == 0)
+      {
+         /* iterate over the possible hashes for the file being loaded */
+         rc_hash_initialize_iterator(&coro->iterator, coro->path, (uint8_t*)coro->data, coro->len);
 #ifdef CHEEVOS_TIME_HASH
-      start = cpu_features_get_time_usec();
+         start = cpu_features_get_time_usec();
 #endif
-      while (rc_hash_iterate(coro->hash, &coro->iterator))
-      {
+         while (rc_hash_iterate(coro->hash, &coro->iterator))
+         {
 #ifdef CHEEVOS_TIME_HASH
-         CHEEVOS_LOG(RCHEEVOS_TAG "hash generated in %ums\n", (cpu_features_get_time_usec() - start) / 1000);
+            CHEEVOS_LOG(RCHEEVOS_TAG "hash generated in %ums\n", (cpu_features_get_time_usec() - start) / 1000);
 #endif
-         CORO_GOSUB(RCHEEVOS_GET_GAMEID);
-         if (coro->gameid != 0)
-            break;
+            CORO_GOSUB(RCHEEVOS_GET_GAMEID);
+            if (coro->gameid != 0)
+            {
+               rcheevos_set_fingerprint(coro);
+               break;
+            }
 
 #ifdef CHEEVOS_TIME_HASH
-         start = cpu_features_get_time_usec();
+            start = cpu_features_get_time_usec();
 #endif
+         }
+         rc_hash_destroy_iterator(&coro->iterator);
       }
-      rc_hash_destroy_iterator(&coro->iterator);
 
       /* if no match was found, bail */
       if (coro->gameid == 0)
@@ -257,6 +257,12 @@
  */
 #define DEFAULT_FRAME_DELAY 0
 
+/* Chooses the frame delay automatically from the measured
+ * time it takes to run the core, backing off on missed frames.
+ * A non-zero DEFAULT_FRAME_DELAY is used as the upper limit.
+ */
+#define DEFAULT_FRAME_DELAY_AUTO false
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -921,6 +927,14 @@ static const int netplay_check_frames = 600;
 
 static const bool netplay_use_mitm_server = false;
 
+/* Send input over UDP as well as TCP, so a lost packet
+ * does not hold up the input behind it */
+static const bool netplay_udp = false;
+
+/* When spectating as a client, pass the stream on to
+ * spectators of our own, so the host only sends it once */
+static const bool netplay_relay = false;
+
 #define DEFAULT_NETPLAY_MITM_SERVER "nyc"
 
 #ifdef HAVE_NETWORKING
@@ -1120,6 +1134,11 @@ static const unsigned input_max_users = 5;
 
 static const unsigned input_poll_type_behavior = 2;
 
+/* Read input devices on a dedicated thread (udev/linuxraw)
+ * into a timestamped event queue that is drained when
+ * the core polls. */
+#define DEFAULT_INPUT_THREADED false
+
 static const unsigned input_bind_timeout = 5;
 
 static const unsigned input_bind_hold = 2;
@@ -88,6 +88,7 @@ typedef struct settings
       bool video_vsync;
       bool video_adaptive_vsync;
       bool video_hard_sync;
+      bool video_frame_delay_auto;
       bool video_black_frame_insertion;
       bool video_vfilter;
       bool video_smooth;
@@ -149,6 +150,7 @@ typedef struct settings
       bool input_backtouch_toggle;
       bool input_small_keyboard_enable;
       bool input_keyboard_gamepad_enable;
+      bool input_threaded;
 
       /* Frame time counter */
       bool frame_time_counter_reset_after_fastforwarding;
@@ -288,6 +290,8 @@ typedef struct settings
       bool netplay_require_slaves;
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
+      bool netplay_udp;
+      bool netplay_relay;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
 
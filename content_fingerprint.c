@@ -0,0 +1,629 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (content_fingerprint.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <encodings/utf.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "content_fingerprint.h"
+
+/* "RAFP" */
+#define CONTENT_FINGERPRINT_MAGIC   0x50464152
+#define CONTENT_FINGERPRINT_VERSION 1
+
+/* Fixed part of a stored entry, followed by the key and the serial */
+#define CONTENT_FINGERPRINT_RECORD_SIZE (8 + 8 + 4 + 1 + 1 + 2 + 32)
+
+typedef struct content_fingerprint_entry
+{
+   /* Canonical path, then '#' and the member if there is one */
+   char *key;
+   int64_t size;
+   int64_t mtime;
+   uint32_t hash;
+   content_fingerprint_t fp;
+} content_fingerprint_entry_t;
+
+typedef struct content_fingerprint_state
+{
+   content_fingerprint_entry_t *entries;
+   /* Open addressing over entries, index + 1, 0 when empty */
+   uint32_t *table;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   size_t count;
+   size_t capacity;
+   size_t table_size;
+   unsigned hits;
+   unsigned misses;
+   char path[PATH_MAX_LENGTH];
+   bool loaded;
+   bool dirty;
+} content_fingerprint_state_t;
+
+static content_fingerprint_state_t content_fingerprint_st;
+
+static void content_fingerprint_lock(content_fingerprint_state_t *state)
+{
+#ifdef HAVE_THREADS
+   slock_lock(state->lock);
+#endif
+}
+
+static void content_fingerprint_unlock(content_fingerprint_state_t *state)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(state->lock);
+#endif
+}
+
+/* Size and modification time of the file @path is in (the archive for
+ * paths into one). Returns false where neither can be found out, the
+ * store is not used then. */
+static bool content_fingerprint_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+#if defined(LEGACY_WIN32)
+   struct _stat buf;
+   char *path_local   = utf8_to_local_string_alloc(path);
+   int ret            = path_local ? _stat(path_local, &buf) : -1;
+
+   free(path_local);
+#else
+   struct _stat64 buf;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+   int ret            = path_wide ? _wstat64(path_wide, &buf) : -1;
+
+   free(path_wide);
+#endif
+
+   if (ret != 0 || (buf.st_mode & _S_IFDIR))
+      return false;
+
+   *size  = (int64_t)buf.st_size;
+   *mtime = (int64_t)buf.st_mtime;
+   return true;
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+   struct stat buf;
+
+   if (stat(path, &buf) != 0 || S_ISDIR(buf.st_mode))
+      return false;
+
+   *size  = (int64_t)buf.st_size;
+   *mtime = (int64_t)buf.st_mtime;
+   return true;
+#else
+   return false;
+#endif
+}
+
+/* Splits @path into the file to stat and the key, which has the
+ * canonical path of that file. */
+static bool content_fingerprint_key(const char *path, const char *member,
+      char *file, size_t file_size, char *key, size_t key_size)
+{
+   const char *delim = path_get_archive_delim(path);
+
+   strlcpy(file, path, file_size);
+   if (delim)
+      file[delim - path] = '\0';
+
+   if (string_is_empty(file))
+      return false;
+
+   path_resolve_realpath(file, file_size, true);
+
+   strlcpy(key, file, key_size);
+   if (delim)
+      strlcat(key, delim, key_size);
+   if (!string_is_empty(member))
+   {
+      strlcat(key, "#", key_size);
+      strlcat(key, member, key_size);
+   }
+
+   return true;
+}
+
+static content_fingerprint_entry_t *content_fingerprint_find(
+      content_fingerprint_state_t *state, const char *key, uint32_t hash)
+{
+   size_t i;
+
+   if (!state->table_size)
+      return NULL;
+
+   for (i = hash & (state->table_size - 1); state->table[i];
+         i = (i + 1) & (state->table_size - 1))
+   {
+      content_fingerprint_entry_t *entry =
+         &state->entries[state->table[i] - 1];
+
+      if (entry->hash == hash && string_is_equal(entry->key, key))
+         return entry;
+   }
+
+   return NULL;
+}
+
+static void content_fingerprint_rehash(content_fingerprint_state_t *state,
+      size_t table_size)
+{
+   size_t i;
+   uint32_t *table = (uint32_t*)calloc(table_size, sizeof(*table));
+
+   if (!table)
+      return;
+
+   for (i = 0; i < state->count; i++)
+   {
+      size_t j = state->entries[i].hash & (table_size - 1);
+
+      while (table[j])
+         j = (j + 1) & (table_size - 1);
+
+      table[j] = (uint32_t)(i + 1);
+   }
+
+   free(state->table);
+   state->table      = table;
+   state->table_size = table_size;
+}
+
+static content_fingerprint_entry_t *content_fingerprint_add(
+      content_fingerprint_state_t *state, const char *key, uint32_t hash)
+{
+   content_fingerprint_entry_t *entry = NULL;
+
+   if (state->count == state->capacity)
+   {
+      size_t capacity = state->capacity ? state->capacity * 2 : 256;
+      content_fingerprint_entry_t *entries = (content_fingerprint_entry_t*)
+         realloc(state->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return NULL;
+
+      state->entries  = entries;
+      state->capacity = capacity;
+   }
+
+   entry       = &state->entries[state->count];
+   memset(entry, 0, sizeof(*entry));
+   entry->hash = hash;
+
+   if (!(entry->key = strdup(key)))
+      return NULL;
+
+   state->count++;
+
+   /* Keep the table at most half full */
+   if (state->count * 2 > state->table_size)
+      content_fingerprint_rehash(state,
+            state->table_size ? state->table_size * 2 : 512);
+   else
+   {
+      size_t i = hash & (state->table_size - 1);
+
+      while (state->table[i])
+         i = (i + 1) & (state->table_size - 1);
+
+      state->table[i] = (uint32_t)state->count;
+   }
+
+   return entry;
+}
+
+static void content_fingerprint_free_entries(
+      content_fingerprint_state_t *state)
+{
+   size_t i;
+
+   for (i = 0; i < state->count; i++)
+      free(state->entries[i].key);
+
+   free(state->entries);
+   free(state->table);
+
+   state->entries    = NULL;
+   state->table      = NULL;
+   state->count      = 0;
+   state->capacity   = 0;
+   state->table_size = 0;
+}
+
+static bool content_fingerprint_load(content_fingerprint_state_t *state)
+{
+   uint32_t header[4];
+   uint32_t i;
+   void *buf        = NULL;
+   int64_t len      = 0;
+   const uint8_t *ptr;
+   const uint8_t *end;
+
+   if (!path_is_valid(state->path))
+      return true;
+
+   if (!filestream_read_file(state->path, &buf, &len))
+      return false;
+
+   ptr = (const uint8_t*)buf;
+   end = ptr + len;
+
+   if (len < (int64_t)sizeof(header))
+      goto error;
+
+   memcpy(header, ptr, sizeof(header));
+   ptr += sizeof(header);
+
+   if (     header[0] != CONTENT_FINGERPRINT_MAGIC
+         || header[1] != CONTENT_FINGERPRINT_VERSION
+         || header[3] != encoding_crc32(0, ptr, (size_t)(end - ptr)))
+      goto error;
+
+   for (i = 0; i < header[2]; i++)
+   {
+      char key[PATH_MAX_LENGTH];
+      content_fingerprint_entry_t *entry = NULL;
+      int64_t size, mtime;
+      uint32_t crc;
+      uint8_t flags, serial_len;
+      uint16_t key_len;
+      const char *hash;
+
+      if (end - ptr < CONTENT_FINGERPRINT_RECORD_SIZE)
+         goto error;
+
+      memcpy(&size,  ptr,      8);
+      memcpy(&mtime, ptr + 8,  8);
+      memcpy(&crc,   ptr + 16, 4);
+      flags      = ptr[20];
+      serial_len = ptr[21];
+      memcpy(&key_len, ptr + 22, 2);
+      hash       = (const char*)ptr + 24;
+      ptr       += CONTENT_FINGERPRINT_RECORD_SIZE;
+
+      if (     end - ptr < key_len + serial_len
+            || key_len >= sizeof(key)
+            || serial_len >= CONTENT_FINGERPRINT_SERIAL_SIZE)
+         goto error;
+
+      memcpy(key, ptr, key_len);
+      key[key_len] = '\0';
+
+      if (!(entry = content_fingerprint_add(state, key,
+                  djb2_calculate(key))))
+         goto error;
+
+      entry->size     = size;
+      entry->mtime    = mtime;
+      entry->fp.crc   = crc;
+      entry->fp.flags = flags;
+      memcpy(entry->fp.serial, ptr + key_len, serial_len);
+      entry->fp.serial[serial_len] = '\0';
+      memcpy(entry->fp.cheevos_hash, hash,
+            CONTENT_FINGERPRINT_HASH_SIZE - 1);
+      entry->fp.cheevos_hash[CONTENT_FINGERPRINT_HASH_SIZE - 1] = '\0';
+
+      ptr += key_len + serial_len;
+   }
+
+   free(buf);
+   return true;
+
+error:
+   free(buf);
+   content_fingerprint_free_entries(state);
+   return false;
+}
+
+bool content_fingerprint_init(const char *path)
+{
+   bool ret                           = true;
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   if (string_is_empty(path))
+      return false;
+
+#ifdef HAVE_THREADS
+   if (!state->lock && !(state->lock = slock_new()))
+      return false;
+#endif
+
+   content_fingerprint_lock(state);
+
+   if (!state->loaded || !string_is_equal(state->path, path))
+   {
+      content_fingerprint_free_entries(state);
+      strlcpy(state->path, path, sizeof(state->path));
+
+      ret           = content_fingerprint_load(state);
+      state->loaded = true;
+      state->dirty  = false;
+   }
+
+   content_fingerprint_unlock(state);
+
+   return ret;
+}
+
+void content_fingerprint_deinit(void)
+{
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   content_fingerprint_flush();
+   content_fingerprint_free_entries(state);
+
+#ifdef HAVE_THREADS
+   if (state->lock)
+      slock_free(state->lock);
+#endif
+
+   memset(state, 0, sizeof(*state));
+}
+
+bool content_fingerprint_get(const char *path, const char *member,
+      content_fingerprint_t *fp)
+{
+   char file[PATH_MAX_LENGTH];
+   char key[PATH_MAX_LENGTH];
+   int64_t size                       = 0;
+   int64_t mtime                      = 0;
+   bool ret                           = false;
+   content_fingerprint_entry_t *entry = NULL;
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   if (!state->loaded)
+      return false;
+
+   if (!content_fingerprint_key(path, member, file, sizeof(file),
+            key, sizeof(key)))
+      return false;
+
+   if (!content_fingerprint_stat(file, &size, &mtime))
+      return false;
+
+   content_fingerprint_lock(state);
+
+   entry = content_fingerprint_find(state, key, djb2_calculate(key));
+
+   if (entry && entry->size == size && entry->mtime == mtime)
+   {
+      *fp = entry->fp;
+      ret = true;
+      state->hits++;
+   }
+   else
+      state->misses++;
+
+   content_fingerprint_unlock(state);
+
+   return ret;
+}
+
+void content_fingerprint_update(const char *path, const char *member,
+      const content_fingerprint_t *fp)
+{
+   char file[PATH_MAX_LENGTH];
+   char key[PATH_MAX_LENGTH];
+   int64_t size                       = 0;
+   int64_t mtime                      = 0;
+   uint32_t hash;
+   content_fingerprint_entry_t *entry = NULL;
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   if (!state->loaded || !fp->flags)
+      return;
+
+   if (!content_fingerprint_key(path, member, file, sizeof(file),
+            key, sizeof(key)))
+      return;
+
+   if (!content_fingerprint_stat(file, &size, &mtime))
+      return;
+
+   hash = djb2_calculate(key);
+
+   content_fingerprint_lock(state);
+
+   if (!(entry = content_fingerprint_find(state, key, hash)))
+      entry = content_fingerprint_add(state, key, hash);
+
+   if (entry)
+   {
+      /* What is known about an older version of the file is useless */
+      if (entry->size != size || entry->mtime != mtime)
+      {
+         memset(&entry->fp, 0, sizeof(entry->fp));
+         entry->size  = size;
+         entry->mtime = mtime;
+      }
+
+      if (fp->flags & CONTENT_FINGERPRINT_CRC)
+         entry->fp.crc = fp->crc;
+      if (fp->flags & CONTENT_FINGERPRINT_SERIAL)
+         strlcpy(entry->fp.serial, fp->serial, sizeof(entry->fp.serial));
+      if (fp->flags & CONTENT_FINGERPRINT_CHEEVOS)
+         strlcpy(entry->fp.cheevos_hash, fp->cheevos_hash,
+               sizeof(entry->fp.cheevos_hash));
+
+      entry->fp.flags |= fp->flags;
+      state->dirty     = true;
+   }
+
+   content_fingerprint_unlock(state);
+}
+
+void content_fingerprint_prune(void)
+{
+   size_t i;
+   size_t count                       = 0;
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   if (!state->loaded)
+      return;
+
+   content_fingerprint_lock(state);
+
+   for (i = 0; i < state->count; i++)
+   {
+      char file[PATH_MAX_LENGTH];
+      int64_t size, mtime;
+      content_fingerprint_entry_t *entry = &state->entries[i];
+      const char *delim                  = path_get_archive_delim(entry->key);
+
+      strlcpy(file, entry->key, sizeof(file));
+      if (delim)
+         file[delim - entry->key] = '\0';
+
+      if (content_fingerprint_stat(file, &size, &mtime))
+         state->entries[count++] = *entry;
+      else
+         free(entry->key);
+   }
+
+   if (count != state->count)
+   {
+      state->count = count;
+      state->dirty = true;
+      content_fingerprint_rehash(state, state->table_size);
+   }
+
+   content_fingerprint_unlock(state);
+}
+
+bool content_fingerprint_flush(void)
+{
+   char tmp[PATH_MAX_LENGTH];
+   size_t i;
+   size_t len                         = 4 * sizeof(uint32_t);
+   uint32_t header[4];
+   uint8_t *buf                       = NULL;
+   uint8_t *ptr                       = NULL;
+   bool ret                           = false;
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   if (!state->loaded)
+      return false;
+
+   content_fingerprint_lock(state);
+
+   if (!state->dirty)
+   {
+      content_fingerprint_unlock(state);
+      return true;
+   }
+
+   for (i = 0; i < state->count; i++)
+      len += CONTENT_FINGERPRINT_RECORD_SIZE
+         + strlen(state->entries[i].key)
+         + strlen(state->entries[i].fp.serial);
+
+   if (!(buf = (uint8_t*)malloc(len)))
+      goto end;
+
+   ptr = buf + sizeof(header);
+
+   for (i = 0; i < state->count; i++)
+   {
+      const content_fingerprint_entry_t *entry = &state->entries[i];
+      uint16_t key_len   = (uint16_t)strlen(entry->key);
+      uint8_t serial_len = (uint8_t)strlen(entry->fp.serial);
+
+      memcpy(ptr,      &entry->size,   8);
+      memcpy(ptr + 8,  &entry->mtime,  8);
+      memcpy(ptr + 16, &entry->fp.crc, 4);
+      ptr[20] = entry->fp.flags;
+      ptr[21] = serial_len;
+      memcpy(ptr + 22, &key_len, 2);
+      memset(ptr + 24, 0, 32);
+      memcpy(ptr + 24, entry->fp.cheevos_hash,
+            strlen(entry->fp.cheevos_hash));
+      ptr += CONTENT_FINGERPRINT_RECORD_SIZE;
+
+      memcpy(ptr, entry->key, key_len);
+      ptr += key_len;
+      memcpy(ptr, entry->fp.serial, serial_len);
+      ptr += serial_len;
+   }
+
+   header[0] = CONTENT_FINGERPRINT_MAGIC;
+   header[1] = CONTENT_FINGERPRINT_VERSION;
+   header[2] = (uint32_t)state->count;
+   header[3] = encoding_crc32(0, buf + sizeof(header),
+         len - sizeof(header));
+   memcpy(buf, header, sizeof(header));
+
+   /* Written next to the store and renamed, so it is never left
+    * half written */
+   strlcpy(tmp, state->path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   if (filestream_write_file(tmp, buf, (int64_t)len))
+   {
+      filestream_delete(state->path);
+
+      if (!filestream_rename(tmp, state->path))
+      {
+         state->dirty = false;
+         ret          = true;
+      }
+      else
+         filestream_delete(tmp);
+   }
+
+end:
+   content_fingerprint_unlock(state);
+   free(buf);
+   return ret;
+}
+
+void content_fingerprint_get_stats(content_fingerprint_stats_t *stats)
+{
+   content_fingerprint_state_t *state = &content_fingerprint_st;
+
+   memset(stats, 0, sizeof(*stats));
+
+   if (!state->loaded)
+      return;
+
+   content_fingerprint_lock(state);
+   stats->hits    = state->hits;
+   stats->misses  = state->misses;
+   stats->entries = (unsigned)state->count;
+   content_fingerprint_unlock(state);
+}
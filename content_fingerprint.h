@@ -0,0 +1,112 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (content_fingerprint.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CONTENT_FINGERPRINT_H
+#define __CONTENT_FINGERPRINT_H
+
+#include <stdint.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Persistent store for what hashing content files found out: their
+ * CRC32, disc serial and achievement hash. Entries are keyed by the
+ * canonical path of a file (plus the archive member or range the
+ * result was computed from) and only returned while the file's size
+ * and modification time are unchanged, so rescanning a library only
+ * reads new or changed files. */
+
+#define CONTENT_FINGERPRINT_SERIAL_SIZE 64
+/* MD5 in hex, plus terminator */
+#define CONTENT_FINGERPRINT_HASH_SIZE   33
+
+enum content_fingerprint_flags
+{
+   CONTENT_FINGERPRINT_CRC     = (1 << 0),
+   CONTENT_FINGERPRINT_SERIAL  = (1 << 1),
+   CONTENT_FINGERPRINT_CHEEVOS = (1 << 2)
+};
+
+typedef struct content_fingerprint
+{
+   uint32_t crc;
+   /* Which of the fields below are known. A known serial can be
+    * empty, meaning the file has none. */
+   uint8_t flags;
+   char serial[CONTENT_FINGERPRINT_SERIAL_SIZE];
+   char cheevos_hash[CONTENT_FINGERPRINT_HASH_SIZE];
+} content_fingerprint_t;
+
+typedef struct content_fingerprint_stats
+{
+   unsigned hits;
+   unsigned misses;
+   unsigned entries;
+} content_fingerprint_stats_t;
+
+/**
+ * content_fingerprint_init:
+ * @path               : File the store is kept in.
+ *
+ * Loads the store. Does nothing if it is already loaded from @path.
+ * All functions are safe to call from several threads, and do nothing
+ * (or miss) before this was called.
+ *
+ * Returns: false if the file exists but is not a valid store; it is
+ * then replaced on the next flush.
+ **/
+bool content_fingerprint_init(const char *path);
+
+/* Flushes and frees the store. */
+void content_fingerprint_deinit(void);
+
+/**
+ * content_fingerprint_get:
+ * @path               : Content path, may point into an archive.
+ * @member             : Further qualifies what the fingerprint is of,
+ *                       e.g. a byte range of @path. Can be NULL.
+ * @fp                 : Filled in on a hit.
+ *
+ * Returns: true if a fingerprint is known and the file did not change
+ * since. Check fp->flags for the fields that are set.
+ **/
+bool content_fingerprint_get(const char *path, const char *member,
+      content_fingerprint_t *fp);
+
+/* Records the fields of @fp set in fp->flags, keeping the others if
+ * the file did not change. */
+void content_fingerprint_update(const char *path, const char *member,
+      const content_fingerprint_t *fp);
+
+/* Forgets entries for files that no longer exist. */
+void content_fingerprint_prune(void);
+
+/* Writes the store if it changed. The file is replaced atomically. */
+bool content_fingerprint_flush(void);
+
+void content_fingerprint_get_stats(content_fingerprint_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
@@ -358,12 +358,16 @@ static void dir_list_prioritize(struct string_list *list)
    qsort(list->elems, list->size, sizeof(*list->elems), dir_entry_compare);
 }
 
+/* Content is scanned while the rest of @dir is still being listed, a
+ * directory at a time. CUE and GDI files come first within each, so
+ * the tracks they reference (usually next to them) can be skipped. */
 database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type, retro_task_t *task,
       bool show_hidden_files)
 {
    core_info_list_t *core_info_list = NULL;
    struct string_list       *list   = NULL;
+   dir_walk_t               *walk   = NULL;
    database_info_handle_t     *db   = (database_info_handle_t*)
       malloc(sizeof(*db));
 
@@ -372,26 +376,47 @@ database_info_handle_t *database_info_dir_init(const char *dir,
 
    core_info_get_list(&core_info_list);
 
-   list = dir_list_new(dir, core_info_list ? core_info_list->all_ext : NULL,
+   walk = dir_walk_new(dir, core_info_list ? core_info_list->all_ext : NULL,
          false, show_hidden_files,
-         false, true);
+         false, true, DIR_WALK_DEFAULT_THREADS);
+   list = string_list_new();
 
-   if (!list)
+   if (!walk || !list)
    {
+      dir_walk_free(walk);
+      string_list_free(list);
       free(db);
       return NULL;
    }
 
-   dir_list_prioritize(list);
-
    db->status             = DATABASE_STATUS_ITERATE;
    db->type               = type;
    db->list_ptr           = 0;
    db->list               = list;
+   db->walk               = walk;
+
+   database_info_dir_next(db);
 
    return db;
 }
 
+bool database_info_dir_next(database_info_handle_t *db)
+{
+   size_t i;
+   struct string_list *batch = NULL;
+
+   if (!db || !(batch = dir_walk_next(db->walk)))
+      return false;
+
+   dir_list_prioritize(batch);
+
+   for (i = 0; i < batch->size; i++)
+      string_list_append(db->list, batch->elems[i].data, batch->elems[i].attr);
+
+   string_list_free(batch);
+   return true;
+}
+
 database_info_handle_t *database_info_file_init(const char *path,
       enum database_type type, retro_task_t *task)
 {
@@ -419,6 +444,7 @@ database_info_handle_t *database_info_file_init(const char *path,
    db->type               = type;
    db->list_ptr           = 0;
    db->list               = list;
+   db->walk               = NULL;
 
    return db;
 }
@@ -428,6 +454,7 @@ void database_info_free(database_info_handle_t *db)
    if (!db)
       return;
 
+   dir_walk_free(db->walk);
    string_list_free(db->list);
 }
 
@@ -22,6 +22,7 @@
 #include <stddef.h>
 
 #include <file/archive_file.h>
+#include <lists/dir_walk.h>
 #include <retro_common_api.h>
 #include <queues/task_queue.h>
 
@@ -76,6 +77,8 @@ typedef struct
    enum database_type type;
    size_t list_ptr;
    struct string_list *list;
+   /* Directories still being listed, see database_info_dir_next() */
+   dir_walk_t *walk;
 } database_info_handle_t;
 
 typedef struct
@@ -131,6 +134,10 @@ database_info_handle_t *database_info_dir_init(const char *dir,
 database_info_handle_t *database_info_file_init(const char *path,
       enum database_type type, retro_task_t *task);
 
+/* Appends the files of the next directory of a scan to handle->list.
+ * Returns false once there are no more. */
+bool database_info_dir_next(database_info_handle_t *handle);
+
 void database_info_free(database_info_handle_t *handle);
 
 int database_info_build_query_enum(
@@ -78,6 +78,8 @@ enum file_path_enum
    FILE_PATH_CHT_EXTENSION,
    FILE_PATH_LPL_EXTENSION,
    FILE_PATH_LPL_EXTENSION_NO_DOT,
+   FILE_PATH_LPL_CACHE_EXTENSION,
+   FILE_PATH_LPL_JOURNAL_EXTENSION,
    FILE_PATH_RDB_EXTENSION,
    FILE_PATH_RDB_EXTENSION_NO_DOT,
    FILE_PATH_BSV_EXTENSION,
@@ -94,6 +96,8 @@ enum file_path_enum
    FILE_PATH_CONFIG_EXTENSION,
    FILE_PATH_CORE_INFO_EXTENSION,
    FILE_PATH_RUNTIME_EXTENSION,
+   FILE_PATH_RUNTIME_STORE,
+   FILE_PATH_EXPLORE_INDEX,
    FILE_PATH_DEFAULT_EVENT_LOG,
    FILE_PATH_EVENT_LOG_EXTENSION,
    FILE_PATH_DISK_CONTROL_INDEX_EXTENSION,
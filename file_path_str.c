@@ -82,6 +82,12 @@ const char *file_path_str(enum file_path_enum enum_idx)
       case FILE_PATH_LPL_EXTENSION_NO_DOT:
          str = "lpl";
          break;
+      case FILE_PATH_LPL_CACHE_EXTENSION:
+         str = ".lplc";
+         break;
+      case FILE_PATH_LPL_JOURNAL_EXTENSION:
+         str = ".lplj";
+         break;
       case FILE_PATH_PNG_EXTENSION:
          str = ".png";
          break;
@@ -221,6 +227,12 @@ const char *file_path_str(enum file_path_enum enum_idx)
       case FILE_PATH_RUNTIME_EXTENSION:
          str = ".lrtl";
          break;
+      case FILE_PATH_RUNTIME_STORE:
+         str = "content_runtime.lrts";
+         break;
+      case FILE_PATH_EXPLORE_INDEX:
+         str = "explore_index.rexi";
+         break;
       case FILE_PATH_DEFAULT_EVENT_LOG:
          str = "retroarch.log";
          break;
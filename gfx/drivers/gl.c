@@ -3100,14 +3100,14 @@ static bool gl2_frame(void *data, const void *frame,
             && !runloop_is_paused)
       {
          if (gl->ctx_driver->swap_buffers)
-            gl->ctx_driver->swap_buffers(gl->ctx_data);
+            video_driver_swap_buffers(gl->ctx_driver, gl->ctx_data);
          glClear(GL_COLOR_BUFFER_BIT);
       }
    }
 #endif
 
    if (gl->ctx_driver->swap_buffers)
-      gl->ctx_driver->swap_buffers(gl->ctx_data);
+      video_driver_swap_buffers(gl->ctx_driver, gl->ctx_data);
 
    /* check if we are fast forwarding or in menu, if we are ignore hard sync */
    if (  gl->have_sync
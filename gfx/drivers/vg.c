@@ -451,7 +451,7 @@ static bool vg_frame(void *data, const void *frame,
    if (vg->ctx_driver->update_window_title)
       vg->ctx_driver->update_window_title(vg->ctx_data);
 
-   vg->ctx_driver->swap_buffers(vg->ctx_data);
+   video_driver_swap_buffers(vg->ctx_driver, vg->ctx_data);
 
    return true;
 }
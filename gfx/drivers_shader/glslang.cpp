@@ -45,27 +45,32 @@ struct SlangProcess
       TBuiltInResource Resources;
 };
 
-/* We don't use glslang from multiple threads, but to be sure.
- * Initializing TLS and freeing it for glslang works around 
- * a really bizarre issue where the TLS key is suddenly 
- * corrupted *somehow*.
+/* InitializeProcess() and FinalizeProcess() must not run concurrently
+ * with each other or with a compile, so they are reference counted
+ * under a lock. Compiles themselves can run on any number of threads,
+ * glslang gives each thread its own pool allocator and locks the
+ * builtin symbol tables it shares between them.
+ *
+ * The process is still finalized whenever the last holder goes away;
+ * keeping glslang initialized indefinitely used to corrupt its TLS
+ * keys *somehow*.
  */
-static std::mutex glslang_global_lock;
+static std::mutex glslang_process_lock;
+static unsigned glslang_process_refs;
 
-struct SlangProcessHolder
+glslang::ProcessHolder::ProcessHolder()
 {
-   SlangProcessHolder()
-   {
-      glslang_global_lock.lock();
+   std::lock_guard<std::mutex> lock(glslang_process_lock);
+   if (glslang_process_refs++ == 0)
       InitializeProcess();
-   }
+}
 
-   ~SlangProcessHolder()
-   {
+glslang::ProcessHolder::~ProcessHolder()
+{
+   std::lock_guard<std::mutex> lock(glslang_process_lock);
+   if (--glslang_process_refs == 0)
       FinalizeProcess();
-      glslang_global_lock.unlock();
-   }
-};
+}
 
 SlangProcess::SlangProcess()
 {
@@ -388,12 +393,26 @@ SlangProcess::SlangProcess()
    }
 }
 
+const string &glslang::compiler_version()
+{
+   static const string version = [] {
+      string spirv;
+      GetSpirvVersion(spirv);
+      return string("glslang ") + GetGlslVersionString()
+         + ", " + spirv
+         + ", generator " + to_string(GetSpirvGeneratorVersion())
+         + ", default version 100, vulkan and spv rules";
+   }();
+
+   return version;
+}
+
 bool glslang::compile_spirv(const string &source, Stage stage,
       std::vector<uint32_t> *spirv)
 {
    string msg;
    static SlangProcess process;
-   SlangProcessHolder process_holder;
+   ProcessHolder process_holder;
    TProgram program;
    EShLanguage language;
 
@@ -17,7 +17,22 @@ namespace glslang
         StageCompute
     };
 
+    /* Keeps glslang initialized while alive. compile_spirv() holds one
+     * itself, holding another around a batch of compiles lets them
+     * share the builtin symbol tables instead of rebuilding them for
+     * every stage. */
+    struct ProcessHolder
+    {
+        ProcessHolder();
+        ~ProcessHolder();
+    };
+
+    /* Can be called from several threads at once. */
     bool compile_spirv(const std::string &source, Stage stage, std::vector<uint32_t> *spirv);
+
+    /* Identifies the compiler and the options compile_spirv() uses,
+     * so that cached SPIR-V is not reused across either changing. */
+    const std::string &compiler_version();
 }
 
 #endif
@@ -19,10 +19,14 @@
 #include <algorithm>
 
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 #include <file/file_path.h>
 #include <file/config_file.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -33,6 +37,8 @@
 #if defined(HAVE_GLSLANG)
 #include "glslang.hpp"
 #endif
+#include "slang_cache.h"
+#include "../video_shader_parse.h"
 #include "../../verbosity.h"
 
 static std::string build_stage_source(
@@ -217,36 +223,109 @@ bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta)
    return true;
 }
 
+#if defined(HAVE_GLSLANG)
+/* Cached SPIR-V is the number of words in the vertex stage, followed
+ * by the words of both stages. */
+static bool glslang_load_cached_spirv(const char *key,
+      glslang_output *output)
+{
+   void *data  = NULL;
+   size_t size = 0;
+   size_t count;
+   const uint32_t *words;
+
+   if (!slang_cache_get("spv", key, &data, &size))
+      return false;
+
+   words = (const uint32_t*)data;
+   count = size / sizeof(uint32_t);
+
+   if (     size % sizeof(uint32_t)
+         || count < 1
+         || words[0] >= count - 1)
+   {
+      free(data);
+      return false;
+   }
+
+   output->vertex.assign(words + 1, words + 1 + words[0]);
+   output->fragment.assign(words + 1 + words[0], words + count);
+
+   free(data);
+   return !output->vertex.empty();
+}
+
+static void glslang_store_cached_spirv(const char *key,
+      const glslang_output *output)
+{
+   std::vector<uint32_t> words;
+
+   words.reserve(1 + output->vertex.size() + output->fragment.size());
+   words.push_back((uint32_t)output->vertex.size());
+   words.insert(words.end(), output->vertex.begin(), output->vertex.end());
+   words.insert(words.end(), output->fragment.begin(),
+         output->fragment.end());
+
+   slang_cache_put("spv", key, words.data(),
+         words.size() * sizeof(uint32_t));
+}
+#endif
+
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
 #if defined(HAVE_GLSLANG)
+   char key[SLANG_CACHE_KEY_SIZE];
+   std::string vertex_source;
+   std::string fragment_source;
+   std::string key_data;
    struct string_list *lines = string_list_new();
 
    if (!lines)
       return false;
 
-   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
-
    if (!glslang_read_shader_file(shader_path, lines, true))
       goto error;
    output->meta = glslang_meta{};
    if (!glslang_parse_meta(lines, &output->meta))
       goto error;
 
-   if (!glslang::compile_spirv(build_stage_source(lines, "vertex"),
+   vertex_source   = build_stage_source(lines, "vertex");
+   fragment_source = build_stage_source(lines, "fragment");
+
+   /* Includes are resolved by now, so this covers everything the
+    * SPIR-V depends on. The sources never contain NULs. */
+   key_data        = glslang::compiler_version();
+   key_data       += '\0';
+   key_data       += vertex_source;
+   key_data       += '\0';
+   key_data       += fragment_source;
+   slang_cache_key(key, key_data.data(), key_data.size());
+
+   if (glslang_load_cached_spirv(key, output))
+   {
+      RARCH_LOG("[slang]: Using cached shader \"%s\".\n", shader_path);
+      string_list_free(lines);
+      return true;
+   }
+
+   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+
+   if (!glslang::compile_spirv(vertex_source,
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       goto error;
    }
 
-   if (!glslang::compile_spirv(build_stage_source(lines, "fragment"),
+   if (!glslang::compile_spirv(fragment_source,
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       goto error;
    }
 
+   glslang_store_cached_spirv(key, output);
+
    string_list_free(lines);
 
    return true;
@@ -257,3 +336,122 @@ error:
 
    return false;
 }
+
+#if defined(HAVE_GLSLANG)
+struct glslang_preset_job
+{
+   const struct video_shader *shader;
+   std::vector<glslang_output> *output;
+   std::vector<int64_t> *times;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   unsigned next;
+   bool failed;
+};
+
+/* Compiles passes until there are none left. Run by every thread, so
+ * a pass that takes long does not hold up the others. */
+static void glslang_compile_preset_passes(void *data)
+{
+   glslang_preset_job *job = (glslang_preset_job*)data;
+
+   for (;;)
+   {
+      unsigned i;
+      retro_time_t start;
+      bool ok;
+
+#ifdef HAVE_THREADS
+      slock_lock(job->lock);
+#endif
+      i = job->next++;
+      if (job->failed)
+         i = job->shader->passes;
+#ifdef HAVE_THREADS
+      slock_unlock(job->lock);
+#endif
+
+      if (i >= job->shader->passes)
+         break;
+
+      start = cpu_features_get_time_usec();
+      ok    = glslang_compile_shader(job->shader->pass[i].source.path,
+            &(*job->output)[i]);
+
+      if (job->times)
+         (*job->times)[i] = cpu_features_get_time_usec() - start;
+
+      if (!ok)
+      {
+         RARCH_ERR("Failed to compile shader: \"%s\".\n",
+               job->shader->pass[i].source.path);
+#ifdef HAVE_THREADS
+         slock_lock(job->lock);
+#endif
+         job->failed = true;
+#ifdef HAVE_THREADS
+         slock_unlock(job->lock);
+#endif
+      }
+   }
+}
+#endif
+
+bool glslang_compile_preset(const struct video_shader *shader,
+      std::vector<glslang_output> *output,
+      unsigned threads, std::vector<int64_t> *times)
+{
+#if defined(HAVE_GLSLANG)
+   unsigned i;
+   glslang_preset_job job;
+   /* Shares the builtin symbol tables between all passes */
+   glslang::ProcessHolder process_holder;
+#ifdef HAVE_THREADS
+   std::vector<sthread_t*> workers;
+#endif
+
+   output->clear();
+   output->resize(shader->passes);
+   if (times)
+      times->assign(shader->passes, 0);
+
+   job.shader = shader;
+   job.output = output;
+   job.times  = times;
+   job.next   = 0;
+   job.failed = false;
+
+   if (!threads)
+      threads = cpu_features_get_core_amount();
+   if (threads > shader->passes)
+      threads = shader->passes;
+
+#ifdef HAVE_THREADS
+   if (!(job.lock = slock_new()))
+      return false;
+
+   /* The calling thread is one of them */
+   for (i = 1; i < threads; i++)
+   {
+      sthread_t *worker = sthread_create(
+            glslang_compile_preset_passes, &job);
+      if (!worker)
+         break;
+      workers.push_back(worker);
+   }
+#endif
+
+   glslang_compile_preset_passes(&job);
+
+#ifdef HAVE_THREADS
+   for (i = 0; i < workers.size(); i++)
+      sthread_join(workers[i]);
+   slock_free(job.lock);
+#endif
+
+   return !job.failed;
+#else
+   return false;
+#endif
+}
@@ -53,8 +53,20 @@ struct glslang_output
    glslang_meta meta;
 };
 
+struct video_shader;
+
+/* Reuses SPIR-V from the shader cache when the preprocessed source
+ * has been compiled before, see slang_cache_init(). */
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/* Compiles every pass of @shader into @output, in order. Passes are
+ * compiled concurrently on up to @threads threads, 0 meaning one per
+ * CPU core. If @times is set, it receives the time each pass took in
+ * microseconds. */
+bool glslang_compile_preset(const struct video_shader *shader,
+      std::vector<glslang_output> *output,
+      unsigned threads = 0, std::vector<int64_t> *times = nullptr);
+
 /* Helpers for internal use. */
 bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta);
 
@@ -28,9 +28,11 @@
 #include <formats/image.h>
 #include <retro_miscellaneous.h>
 
+#include "slang_cache.h"
 #include "slang_reflection.h"
 #include "slang_reflection.hpp"
 #include "spirv_glsl.hpp"
+#include "spirv_cross_c.h"
 
 #include "../common/gl_core_common.h"
 
@@ -55,130 +57,271 @@ static bool gl_core_shader_set_unique_map(unordered_map<string, P> &m,
    return true;
 }
 
-GLuint gl_core_cross_compile_program(
+/* What SPIRV-Cross makes of a program: everything needed to build it
+ * with GL, so it can be cached. */
+struct gl_core_cross_output
+{
+   std::string vertex;
+   std::string fragment;
+   /* Locations of the vertex inputs */
+   std::vector<uint32_t> attributes;
+   /* Bindings of the sampled images */
+   std::vector<uint32_t> textures;
+};
+
+static bool gl_core_cross_compile(
       const uint32_t *vertex, size_t vertex_size,
       const uint32_t *fragment, size_t fragment_size,
-      gl_core_buffer_locations *loc, bool flatten)
+      bool flatten, gl_core_cross_output *output)
 {
-   GLuint program = 0;
-   try
+   spirv_cross::ShaderResources vertex_resources;
+   spirv_cross::ShaderResources fragment_resources;
+   spirv_cross::CompilerGLSL vertex_compiler(vertex, vertex_size / 4);
+   spirv_cross::CompilerGLSL fragment_compiler(fragment, fragment_size / 4);
+   spirv_cross::CompilerGLSL::Options opts;
+#ifdef HAVE_OPENGLES3
+   opts.es                               = true;
+#else
+   opts.es                               = false;
+#endif
+   opts.version                          = gl_core_get_cross_compiler_target_version();
+   opts.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
+   opts.fragment.default_int_precision   = spirv_cross::CompilerGLSL::Options::Precision::Highp;
+   opts.enable_420pack_extension         = false;
+
+   vertex_compiler.set_common_options(opts);
+   fragment_compiler.set_common_options(opts);
+
+   vertex_resources                      = vertex_compiler.get_shader_resources();
+   fragment_resources                    = fragment_compiler.get_shader_resources();
+
+   for (auto &res : vertex_resources.stage_inputs)
    {
-      spirv_cross::ShaderResources vertex_resources;
-      spirv_cross::ShaderResources fragment_resources;
-      spirv_cross::CompilerGLSL vertex_compiler(vertex, vertex_size / 4);
-      spirv_cross::CompilerGLSL fragment_compiler(fragment, fragment_size / 4);
-      spirv_cross::CompilerGLSL::Options opts;
+      uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      vertex_compiler.set_name(res.id, string("RARCH_ATTRIBUTE_") + to_string(location));
+      vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
+      output->attributes.push_back(location);
+   }
+
+   for (auto &res : vertex_resources.stage_outputs)
+   {
+      uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      vertex_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
+      vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
+   }
+
+   for (auto &res : fragment_resources.stage_inputs)
+   {
+      uint32_t location = fragment_compiler.get_decoration(res.id, spv::DecorationLocation);
+      fragment_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
+      fragment_compiler.unset_decoration(res.id, spv::DecorationLocation);
+   }
+
+   if (vertex_resources.push_constant_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one push constant buffer.\n");
+      return false;
+   }
+
+   for (auto &res : vertex_resources.push_constant_buffers)
+   {
+      vertex_compiler.set_name(res.id, "RARCH_PUSH_VERTEX_INSTANCE");
+      vertex_compiler.set_name(res.base_type_id, "RARCH_PUSH_VERTEX");
+   }
+
+   if (vertex_resources.uniform_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
+      return false;
+   }
+
+   for (auto &res : vertex_resources.uniform_buffers)
+   {
+      if (flatten)
+         vertex_compiler.flatten_buffer_block(res.id);
+      vertex_compiler.set_name(res.id, "RARCH_UBO_VERTEX_INSTANCE");
+      vertex_compiler.set_name(res.base_type_id, "RARCH_UBO_VERTEX");
+      vertex_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      vertex_compiler.unset_decoration(res.id, spv::DecorationBinding);
+   }
+
+   if (fragment_resources.push_constant_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one push constant block.\n");
+      return false;
+   }
+
+   for (auto &res : fragment_resources.push_constant_buffers)
+   {
+      fragment_compiler.set_name(res.id, "RARCH_PUSH_FRAGMENT_INSTANCE");
+      fragment_compiler.set_name(res.base_type_id, "RARCH_PUSH_FRAGMENT");
+   }
+
+   if (fragment_resources.uniform_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
+      return false;
+   }
+
+   for (auto &res : fragment_resources.uniform_buffers)
+   {
+      if (flatten)
+         fragment_compiler.flatten_buffer_block(res.id);
+      fragment_compiler.set_name(res.id, "RARCH_UBO_FRAGMENT_INSTANCE");
+      fragment_compiler.set_name(res.base_type_id, "RARCH_UBO_FRAGMENT");
+      fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+   }
+
+   for (auto &res : fragment_resources.sampled_images)
+   {
+      uint32_t binding = fragment_compiler.get_decoration(res.id, spv::DecorationBinding);
+      fragment_compiler.set_name(res.id, string("RARCH_TEXTURE_") + to_string(binding));
+      fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+      output->textures.push_back(binding);
+   }
+
+   output->vertex   = vertex_compiler.compile();
+   output->fragment = fragment_compiler.compile();
+
+   return true;
+}
+
+/* The key covers the SPIR-V, the SPIRV-Cross version and options. */
+static void gl_core_cross_cache_key(char *key,
+      const uint32_t *vertex, size_t vertex_size,
+      const uint32_t *fragment, size_t fragment_size, bool flatten)
+{
+   uint32_t header[6];
+   string data;
+
 #ifdef HAVE_OPENGLES3
-      opts.es                               = true;
+   header[0] = 1;
 #else
-      opts.es                               = false;
+   header[0] = 0;
 #endif
-      opts.version                          = gl_core_get_cross_compiler_target_version();
-      opts.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
-      opts.fragment.default_int_precision   = spirv_cross::CompilerGLSL::Options::Precision::Highp;
-      opts.enable_420pack_extension         = false;
+   header[1] = gl_core_get_cross_compiler_target_version();
+   header[2] = flatten;
+   header[3] = SPVC_C_API_VERSION_MAJOR;
+   header[4] = SPVC_C_API_VERSION_MINOR;
+   header[5] = (uint32_t)vertex_size;
 
-      vertex_compiler.set_common_options(opts);
-      fragment_compiler.set_common_options(opts);
+   data.append((const char*)header, sizeof(header));
+   data.append((const char*)vertex, vertex_size);
+   data.append((const char*)fragment, fragment_size);
 
-      vertex_resources                      = vertex_compiler.get_shader_resources();
-      fragment_resources                    = fragment_compiler.get_shader_resources();
+   slang_cache_key(key, data.data(), data.size());
+}
 
-      for (auto &res : vertex_resources.stage_inputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
-         vertex_compiler.set_name(res.id, string("RARCH_ATTRIBUTE_") + to_string(location));
-         vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+/* Cached as the four sizes, then the attributes, textures and both
+ * sources. */
+static bool gl_core_cross_cache_load(const char *key,
+      gl_core_cross_output *output)
+{
+   uint32_t sizes[4];
+   void *data  = NULL;
+   size_t size = 0;
+   size_t needed;
+   const uint8_t *ptr;
 
-      for (auto &res : vertex_resources.stage_outputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
-         vertex_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
-         vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+   if (!slang_cache_get("glcore", key, &data, &size))
+      return false;
 
-      for (auto &res : fragment_resources.stage_inputs)
-      {
-         uint32_t location = fragment_compiler.get_decoration(res.id, spv::DecorationLocation);
-         fragment_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
-         fragment_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+   ptr = (const uint8_t*)data;
 
-      if (vertex_resources.push_constant_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one push constant buffer.\n");
-         return 0;
-      }
+   if (size < sizeof(sizes))
+   {
+      free(data);
+      return false;
+   }
 
-      for (auto &res : vertex_resources.push_constant_buffers)
-      {
-         vertex_compiler.set_name(res.id, "RARCH_PUSH_VERTEX_INSTANCE");
-         vertex_compiler.set_name(res.base_type_id, "RARCH_PUSH_VERTEX");
-      }
+   memcpy(sizes, ptr, sizeof(sizes));
+   ptr   += sizeof(sizes);
+   needed = sizeof(sizes)
+      + ((size_t)sizes[0] + sizes[1]) * sizeof(uint32_t)
+      + sizes[2] + sizes[3];
 
-      if (vertex_resources.uniform_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
-         return 0;
-      }
+   if (needed != size)
+   {
+      free(data);
+      return false;
+   }
 
-      for (auto &res : vertex_resources.uniform_buffers)
-      {
-         if (flatten)
-            vertex_compiler.flatten_buffer_block(res.id);
-         vertex_compiler.set_name(res.id, "RARCH_UBO_VERTEX_INSTANCE");
-         vertex_compiler.set_name(res.base_type_id, "RARCH_UBO_VERTEX");
-         vertex_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         vertex_compiler.unset_decoration(res.id, spv::DecorationBinding);
-      }
+   output->attributes.resize(sizes[0]);
+   output->textures.resize(sizes[1]);
+   if (sizes[0])
+      memcpy(output->attributes.data(), ptr, sizes[0] * sizeof(uint32_t));
+   ptr += sizes[0] * sizeof(uint32_t);
+   if (sizes[1])
+      memcpy(output->textures.data(), ptr, sizes[1] * sizeof(uint32_t));
+   ptr += sizes[1] * sizeof(uint32_t);
+   output->vertex.assign((const char*)ptr, sizes[2]);
+   ptr += sizes[2];
+   output->fragment.assign((const char*)ptr, sizes[3]);
 
-      if (fragment_resources.push_constant_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one push constant block.\n");
-         return 0;
-      }
+   free(data);
+   return true;
+}
 
-      for (auto &res : fragment_resources.push_constant_buffers)
-      {
-         fragment_compiler.set_name(res.id, "RARCH_PUSH_FRAGMENT_INSTANCE");
-         fragment_compiler.set_name(res.base_type_id, "RARCH_PUSH_FRAGMENT");
-      }
+static void gl_core_cross_cache_store(const char *key,
+      const gl_core_cross_output *output)
+{
+   string data;
+   uint32_t sizes[4];
 
-      if (fragment_resources.uniform_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
-         return 0;
-      }
+   sizes[0] = (uint32_t)output->attributes.size();
+   sizes[1] = (uint32_t)output->textures.size();
+   sizes[2] = (uint32_t)output->vertex.size();
+   sizes[3] = (uint32_t)output->fragment.size();
+
+   data.append((const char*)sizes, sizeof(sizes));
+   data.append((const char*)output->attributes.data(),
+         output->attributes.size() * sizeof(uint32_t));
+   data.append((const char*)output->textures.data(),
+         output->textures.size() * sizeof(uint32_t));
+   data.append(output->vertex);
+   data.append(output->fragment);
 
-      for (auto &res : fragment_resources.uniform_buffers)
+   slang_cache_put("glcore", key, data.data(), data.size());
+}
+
+GLuint gl_core_cross_compile_program(
+      const uint32_t *vertex, size_t vertex_size,
+      const uint32_t *fragment, size_t fragment_size,
+      gl_core_buffer_locations *loc, bool flatten)
+{
+   char key[SLANG_CACHE_KEY_SIZE];
+   gl_core_cross_output output;
+   GLuint program = 0;
+
+   gl_core_cross_cache_key(key, vertex, vertex_size,
+         fragment, fragment_size, flatten);
+
+   if (!gl_core_cross_cache_load(key, &output))
+   {
+      try
       {
-         if (flatten)
-            fragment_compiler.flatten_buffer_block(res.id);
-         fragment_compiler.set_name(res.id, "RARCH_UBO_FRAGMENT_INSTANCE");
-         fragment_compiler.set_name(res.base_type_id, "RARCH_UBO_FRAGMENT");
-         fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+         if (!gl_core_cross_compile(vertex, vertex_size,
+                  fragment, fragment_size, flatten, &output))
+            return 0;
       }
-
-      std::vector<uint32_t> texture_binding_fixups;
-      for (auto &res : fragment_resources.sampled_images)
+      catch (const exception &e)
       {
-         uint32_t binding = fragment_compiler.get_decoration(res.id, spv::DecorationBinding);
-         fragment_compiler.set_name(res.id, string("RARCH_TEXTURE_") + to_string(binding));
-         fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
-         texture_binding_fixups.push_back(binding);
+         RARCH_ERR("[GLCore]: Failed to cross compile program: %s\n", e.what());
+         return 0;
       }
 
-      auto vertex_source = vertex_compiler.compile();
-      auto fragment_source = fragment_compiler.compile();
-      GLuint vertex_shader = gl_core_compile_shader(GL_VERTEX_SHADER, vertex_source.c_str());
-      GLuint fragment_shader = gl_core_compile_shader(GL_FRAGMENT_SHADER, fragment_source.c_str());
+      gl_core_cross_cache_store(key, &output);
+   }
+
+   {
+      GLuint vertex_shader = gl_core_compile_shader(GL_VERTEX_SHADER, output.vertex.c_str());
+      GLuint fragment_shader = gl_core_compile_shader(GL_FRAGMENT_SHADER, output.fragment.c_str());
 
 #if 0
-      RARCH_LOG("[GLCore]: Vertex shader:\n========\n%s\n=======\n", vertex_source.c_str());
-      RARCH_LOG("[GLCore]: Fragment shader:\n========\n%s\n=======\n", fragment_source.c_str());
+      RARCH_LOG("[GLCore]: Vertex shader:\n========\n%s\n=======\n", output.vertex.c_str());
+      RARCH_LOG("[GLCore]: Fragment shader:\n========\n%s\n=======\n", output.fragment.c_str());
 #endif
 
       if (!vertex_shader || !fragment_shader)
@@ -194,11 +337,8 @@ GLuint gl_core_cross_compile_program(
       program = glCreateProgram();
       glAttachShader(program, vertex_shader);
       glAttachShader(program, fragment_shader);
-      for (auto &res : vertex_resources.stage_inputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      for (auto &location : output.attributes)
          glBindAttribLocation(program, location, (string("RARCH_ATTRIBUTE_") + to_string(location)).c_str());
-      }
       glLinkProgram(program);
       glDeleteShader(vertex_shader);
       glDeleteShader(fragment_shader);
@@ -250,7 +390,7 @@ GLuint gl_core_cross_compile_program(
       }
 
       /* Force proper bindings for textures. */
-      for (auto &binding : texture_binding_fixups)
+      for (auto &binding : output.textures)
       {
          GLint location = glGetUniformLocation(program, (string("RARCH_TEXTURE_") + to_string(binding)).c_str());
          if (location >= 0)
@@ -259,13 +399,6 @@ GLuint gl_core_cross_compile_program(
 
       glUseProgram(0);
    }
-   catch (const exception &e)
-   {
-      RARCH_ERR("[GLCore]: Failed to cross compile program: %s\n", e.what());
-      if (program != 0)
-         glDeleteProgram(program);
-      return 0;
-   }
 
    return program;
 }
@@ -2197,6 +2330,7 @@ gl_core_filter_chain_t *gl_core_filter_chain_create_from_preset(
       const char *path, gl_core_filter_chain_filter filter)
 {
    unsigned i;
+   std::vector<glslang_output> outputs;
    config_file_t *conf            = NULL;
    unique_ptr<video_shader> shader{ new video_shader() };
    if (!shader)
@@ -2220,11 +2354,14 @@ gl_core_filter_chain_t *gl_core_filter_chain_create_from_preset(
    if (shader->luts && !gl_core_filter_chain_load_luts(chain.get(), shader.get()))
       goto error;
 
+   if (!glslang_compile_preset(shader.get(), &outputs))
+      goto error;
+
    shader->num_parameters = 0;
 
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct gl_core_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2240,13 +2377,6 @@ gl_core_filter_chain_t *gl_core_filter_chain_create_from_preset(
       pass_info.address       = GL_CORE_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         goto error;
-      }
-
       for (auto &meta_param : output.meta.parameters)
       {
          if (shader->num_parameters >= GFX_MAX_PARAMETERS)
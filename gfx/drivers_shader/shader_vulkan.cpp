@@ -2588,6 +2588,7 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       const char *path, vulkan_filter_chain_filter filter)
 {
    unsigned i;
+   std::vector<glslang_output> outputs;
    config_file_t *conf            = NULL;
    unique_ptr<video_shader> shader{ new video_shader() };
    if (!shader)
@@ -2613,11 +2614,14 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
    if (shader->luts && !vulkan_filter_chain_load_luts(info, chain.get(), shader.get()))
       goto error;
 
+   if (!glslang_compile_preset(shader.get(), &outputs))
+      goto error;
+
    shader->num_parameters = 0;
 
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output             = outputs[i];
       struct vulkan_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2633,13 +2637,6 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       pass_info.address       = VULKAN_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         goto error;
-      }
-
       for (auto &meta_param : output.meta.parameters)
       {
          if (shader->num_parameters >= GFX_MAX_PARAMETERS)
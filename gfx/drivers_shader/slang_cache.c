@@ -0,0 +1,433 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "slang_cache.h"
+
+/* "RASC" */
+#define SLANG_CACHE_MAGIC   0x43534152
+/* Bump when the layout of any kind of entry changes */
+#define SLANG_CACHE_VERSION 1
+
+typedef struct slang_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t size;
+   uint32_t crc;
+   /* Last time the entry was used, for eviction */
+   uint64_t stamp;
+} slang_cache_header_t;
+
+typedef struct slang_cache_entry
+{
+   char *path;
+   uint64_t stamp;
+   /* Header included */
+   uint64_t size;
+} slang_cache_entry_t;
+
+typedef struct slang_cache_state
+{
+   slang_cache_entry_t *entries;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   size_t count;
+   size_t capacity;
+   uint64_t max_size;
+   uint64_t size;
+   /* Last stamp handed out */
+   uint64_t stamp;
+   slang_cache_stats_t stats;
+   char dir[PATH_MAX_LENGTH];
+   bool enabled;
+   /* Whether entries/size reflect the directory; only needed once
+    * something is stored, so hits never pay for the scan. */
+   bool scanned;
+} slang_cache_state_t;
+
+static slang_cache_state_t slang_cache_st;
+
+static void slang_cache_lock(slang_cache_state_t *cache)
+{
+#ifdef HAVE_THREADS
+   slock_lock(cache->lock);
+#endif
+}
+
+static void slang_cache_unlock(slang_cache_state_t *cache)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(cache->lock);
+#endif
+}
+
+/* Seconds since the epoch, with the order of the uses within a second
+ * in the low bits. */
+static uint64_t slang_cache_stamp(slang_cache_state_t *cache)
+{
+   uint64_t stamp = (uint64_t)time(NULL) << 20;
+
+   if (stamp <= cache->stamp)
+      stamp = cache->stamp + 1;
+
+   return cache->stamp = stamp;
+}
+
+static void slang_cache_free_entries(slang_cache_state_t *cache)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+      free(cache->entries[i].path);
+   free(cache->entries);
+
+   cache->entries  = NULL;
+   cache->count    = 0;
+   cache->capacity = 0;
+   cache->size     = 0;
+   cache->scanned  = false;
+}
+
+static slang_cache_entry_t *slang_cache_find(slang_cache_state_t *cache,
+      const char *path)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+      if (string_is_equal(cache->entries[i].path, path))
+         return &cache->entries[i];
+
+   return NULL;
+}
+
+static bool slang_cache_add(slang_cache_state_t *cache,
+      const char *path, uint64_t stamp, uint64_t size)
+{
+   if (cache->count == cache->capacity)
+   {
+      size_t capacity                = cache->capacity ?
+         cache->capacity * 2 : 64;
+      slang_cache_entry_t *entries   = (slang_cache_entry_t*)realloc(
+            cache->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return false;
+
+      cache->entries                 = entries;
+      cache->capacity                = capacity;
+   }
+
+   if (!(cache->entries[cache->count].path = strdup(path)))
+      return false;
+
+   cache->entries[cache->count].stamp = stamp;
+   cache->entries[cache->count].size  = size;
+   cache->count++;
+   cache->size                       += size;
+   return true;
+}
+
+static void slang_cache_remove(slang_cache_state_t *cache,
+      slang_cache_entry_t *entry)
+{
+   cache->size -= entry->size;
+   free(entry->path);
+   *entry       = cache->entries[--cache->count];
+}
+
+static bool slang_cache_read_header(const char *path,
+      slang_cache_header_t *header)
+{
+   int64_t read;
+   RFILE *file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   read = filestream_read(file, header, sizeof(*header));
+   filestream_close(file);
+
+   return read == sizeof(*header)
+      && header->magic   == SLANG_CACHE_MAGIC
+      && header->version == SLANG_CACHE_VERSION;
+}
+
+/* Indexes the directory, deleting entries written by other versions
+ * and temporary files left behind by interrupted stores. */
+static void slang_cache_scan(slang_cache_state_t *cache)
+{
+   size_t i;
+   struct string_list *list = dir_list_new(cache->dir, NULL,
+         false, true, false, false);
+
+   slang_cache_free_entries(cache);
+   cache->scanned = true;
+
+   if (!list)
+      return;
+
+   for (i = 0; i < list->size; i++)
+   {
+      slang_cache_header_t header;
+      const char *path = list->elems[i].data;
+
+      if (slang_cache_read_header(path, &header))
+      {
+         slang_cache_add(cache, path, header.stamp,
+               sizeof(header) + (uint64_t)header.size);
+         if (header.stamp > cache->stamp)
+            cache->stamp = header.stamp;
+      }
+      else
+         filestream_delete(path);
+   }
+
+   string_list_free(list);
+}
+
+static void slang_cache_evict(slang_cache_state_t *cache, uint64_t needed)
+{
+   while (cache->count && cache->size + needed > cache->max_size)
+   {
+      size_t i;
+      slang_cache_entry_t *oldest = &cache->entries[0];
+
+      for (i = 1; i < cache->count; i++)
+         if (cache->entries[i].stamp < oldest->stamp)
+            oldest = &cache->entries[i];
+
+      filestream_delete(oldest->path);
+      slang_cache_remove(cache, oldest);
+      cache->stats.evictions++;
+   }
+}
+
+static void slang_cache_path(const slang_cache_state_t *cache,
+      char *s, size_t len, const char *kind, const char *key)
+{
+   fill_pathname_join(s, cache->dir, key, len);
+   strlcat(s, ".", len);
+   strlcat(s, kind, len);
+}
+
+bool slang_cache_init(const char *dir, uint64_t max_size)
+{
+   slang_cache_state_t *cache = &slang_cache_st;
+
+#ifdef HAVE_THREADS
+   if (!cache->lock && !(cache->lock = slock_new()))
+      return false;
+#endif
+
+   slang_cache_lock(cache);
+
+   if (!string_is_equal(cache->dir, dir))
+   {
+      slang_cache_free_entries(cache);
+      strlcpy(cache->dir, dir, sizeof(cache->dir));
+   }
+
+   cache->max_size = max_size;
+   cache->enabled  = !string_is_empty(dir)
+      && (path_is_directory(dir) || path_mkdir(dir));
+
+   if (cache->scanned)
+      slang_cache_evict(cache, 0);
+
+   slang_cache_unlock(cache);
+
+   return cache->enabled;
+}
+
+void slang_cache_deinit(void)
+{
+   slang_cache_state_t *cache = &slang_cache_st;
+   /* Keeps the use order if the cache is initialized again */
+   uint64_t stamp             = cache->stamp;
+
+   slang_cache_free_entries(cache);
+
+#ifdef HAVE_THREADS
+   if (cache->lock)
+      slock_free(cache->lock);
+#endif
+
+   memset(cache, 0, sizeof(*cache));
+   cache->stamp               = stamp;
+}
+
+void slang_cache_key(char *key, const void *data, size_t size)
+{
+   sha256_hash(key, (const uint8_t*)data, size);
+}
+
+bool slang_cache_get(const char *kind, const char *key,
+      void **data, size_t *size)
+{
+   char path[PATH_MAX_LENGTH];
+   slang_cache_header_t header;
+   RFILE *file                = NULL;
+   void *buf                  = NULL;
+   int64_t len                = 0;
+   slang_cache_state_t *cache = &slang_cache_st;
+
+   if (!cache->enabled)
+      return false;
+
+   slang_cache_path(cache, path, sizeof(path), kind, key);
+
+   if (path_is_valid(path) && filestream_read_file(path, &buf, &len))
+   {
+      if (len >= (int64_t)sizeof(header))
+         memcpy(&header, buf, sizeof(header));
+
+      if (     len < (int64_t)sizeof(header)
+            || header.magic   != SLANG_CACHE_MAGIC
+            || header.version != SLANG_CACHE_VERSION
+            || header.size    != len - sizeof(header)
+            || header.crc     != encoding_crc32(0,
+               (const uint8_t*)buf + sizeof(header), header.size))
+      {
+         free(buf);
+         buf = NULL;
+         filestream_delete(path);
+      }
+   }
+
+   slang_cache_lock(cache);
+
+   if (!buf)
+   {
+      cache->stats.misses++;
+      slang_cache_unlock(cache);
+      return false;
+   }
+
+   /* Mark the entry as used, so it is the last to be evicted */
+   header.stamp = slang_cache_stamp(cache);
+
+   if ((file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      filestream_write(file, &header, sizeof(header));
+      filestream_close(file);
+   }
+
+   if (cache->scanned)
+   {
+      slang_cache_entry_t *entry = slang_cache_find(cache, path);
+      if (entry)
+         entry->stamp = header.stamp;
+   }
+
+   cache->stats.hits++;
+   slang_cache_unlock(cache);
+
+   memmove(buf, (const uint8_t*)buf + sizeof(header), header.size);
+   *data = buf;
+   *size = header.size;
+   return true;
+}
+
+bool slang_cache_put(const char *kind, const char *key,
+      const void *data, size_t size)
+{
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+   slang_cache_header_t *header = NULL;
+   slang_cache_entry_t *entry   = NULL;
+   bool ret                     = false;
+   uint64_t total               = sizeof(*header) + (uint64_t)size;
+   slang_cache_state_t *cache   = &slang_cache_st;
+
+   if (!cache->enabled || total > cache->max_size)
+      return false;
+
+   if (!(header = (slang_cache_header_t*)malloc((size_t)total)))
+      return false;
+
+   header->magic   = SLANG_CACHE_MAGIC;
+   header->version = SLANG_CACHE_VERSION;
+   header->size    = (uint32_t)size;
+   header->crc     = encoding_crc32(0, (const uint8_t*)data, size);
+   memcpy(header + 1, data, size);
+
+   slang_cache_path(cache, path, sizeof(path), kind, key);
+   strlcpy(tmp, path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   slang_cache_lock(cache);
+
+   if (!cache->scanned)
+      slang_cache_scan(cache);
+
+   /* Another thread may have stored the same entry meanwhile */
+   if ((entry = slang_cache_find(cache, path)))
+      slang_cache_remove(cache, entry);
+
+   slang_cache_evict(cache, total);
+
+   header->stamp = slang_cache_stamp(cache);
+
+   /* Written next to the entry and renamed, so a reader never sees a
+    * partial file */
+   if (filestream_write_file(tmp, header, (int64_t)total))
+   {
+      filestream_delete(path);
+
+      if (!filestream_rename(tmp, path))
+      {
+         ret = slang_cache_add(cache, path, header->stamp, total);
+         cache->stats.stores++;
+      }
+      else
+         filestream_delete(tmp);
+   }
+
+   slang_cache_unlock(cache);
+
+   free(header);
+   return ret;
+}
+
+void slang_cache_get_stats(slang_cache_stats_t *stats)
+{
+   slang_cache_state_t *cache = &slang_cache_st;
+
+   slang_cache_lock(cache);
+   *stats      = cache->stats;
+   stats->size = cache->size;
+   slang_cache_unlock(cache);
+}
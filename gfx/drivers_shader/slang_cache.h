@@ -0,0 +1,94 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLANG_CACHE_H
+#define SLANG_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+/* Hex SHA-256 plus terminator */
+#define SLANG_CACHE_KEY_SIZE 65
+
+/* Default bound for the files in the cache directory */
+#define SLANG_CACHE_DEFAULT_SIZE (32 * 1024 * 1024)
+
+RETRO_BEGIN_DECLS
+
+typedef struct slang_cache_stats
+{
+   unsigned hits;
+   unsigned misses;
+   unsigned stores;
+   unsigned evictions;
+   /* Bytes on disk, only known once something was stored */
+   uint64_t size;
+} slang_cache_stats_t;
+
+/**
+ * slang_cache_init:
+ * @dir                : Directory for the cache files, created if needed.
+ * @max_size           : Bound for the size of the directory in bytes;
+ *                       least recently used entries go first.
+ *
+ * Content addressed, persistent cache for compiled shaders. Entries
+ * are keyed by a hash of everything that determines their contents
+ * (see slang_cache_key()), so they never have to be invalidated; they
+ * just stop being looked up and are evicted over time.
+ *
+ * Can be called again to move the cache. Safe to use from several
+ * threads once initialized.
+ *
+ * Returns: true if the directory is usable.
+ **/
+bool slang_cache_init(const char *dir, uint64_t max_size);
+
+void slang_cache_deinit(void);
+
+/**
+ * slang_cache_key:
+ * @key                : SLANG_CACHE_KEY_SIZE bytes for the result.
+ * @data               : Everything the cached result depends on,
+ *                       including the compiler's version and options.
+ * @size               : Size of @data.
+ **/
+void slang_cache_key(char *key, const void *data, size_t size);
+
+/**
+ * slang_cache_get:
+ * @kind               : What is stored, e.g. "spv". Part of the file name.
+ * @key                : From slang_cache_key().
+ * @data               : Set to the cached bytes, to be free()d.
+ * @size               : Set to their size.
+ *
+ * Returns: true on a hit. Missing, truncated or corrupt entries and a
+ * disabled cache are all misses.
+ **/
+bool slang_cache_get(const char *kind, const char *key,
+      void **data, size_t *size);
+
+/* Stores @size bytes under @kind and @key, evicting older entries to
+ * stay within the size bound. Returns false if nothing was written. */
+bool slang_cache_put(const char *kind, const char *key,
+      const void *data, size_t size);
+
+void slang_cache_get_stats(slang_cache_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
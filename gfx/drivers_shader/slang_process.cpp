@@ -15,6 +15,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <spirv_glsl.hpp>
 #include <spirv_hlsl.hpp>
 #include <spirv_msl.hpp>
@@ -23,6 +24,8 @@
 #include <stdint.h>
 #include <algorithm>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
 
 #include "glslang_util.h"
 #include "slang_reflection.h"
@@ -115,22 +118,16 @@ static string get_size_semantic_name(
    return get_semantic_name(reflection.texture_semantic_uniform_map, semantic, index);
 }
 
-static bool slang_process_reflection(
-      const Compiler*        vs_compiler,
-      const Compiler*        ps_compiler,
-      const ShaderResources& vs_resources,
-      const ShaderResources& ps_resources,
-      video_shader*          shader_info,
-      unsigned               pass_number,
-      const semantics_map_t* map,
-      pass_semantics_t*      out)
+/* Fills in the names pass @pass_number can use for the passes before
+ * it, the LUTs and the parameters. */
+static bool slang_semantic_maps(
+      const video_shader* shader_info,
+      unsigned            pass_number,
+      unordered_map<string, slang_texture_semantic_map>& texture_semantic_map,
+      unordered_map<string, slang_texture_semantic_map>& texture_semantic_uniform_map,
+      unordered_map<string, slang_semantic_map>& uniform_semantic_map)
 {
-   int semantic;
    unsigned i;
-   vector<texture_sem_t> textures;
-   vector<uniform_sem_t> uniforms[SLANG_CBUFFER_MAX];
-   unordered_map<string, slang_texture_semantic_map> texture_semantic_map;
-   unordered_map<string, slang_texture_semantic_map> texture_semantic_uniform_map;
 
    for (i = 0; i <= pass_number; i++)
    {
@@ -180,8 +177,6 @@ static bool slang_process_reflection(
          return false;
    }
 
-   unordered_map<string, slang_semantic_map> uniform_semantic_map;
-
    for (i = 0; i < shader_info->num_parameters; i++)
    {
       if (!set_unique_map(
@@ -190,6 +185,32 @@ static bool slang_process_reflection(
          return false;
    }
 
+   return true;
+}
+
+static bool slang_process_reflection(
+      const Compiler*        vs_compiler,
+      const Compiler*        ps_compiler,
+      const ShaderResources& vs_resources,
+      const ShaderResources& ps_resources,
+      video_shader*          shader_info,
+      unsigned               pass_number,
+      const semantics_map_t* map,
+      pass_semantics_t*      out)
+{
+   int semantic;
+   unsigned i;
+   vector<texture_sem_t> textures;
+   vector<uniform_sem_t> uniforms[SLANG_CBUFFER_MAX];
+   unordered_map<string, slang_texture_semantic_map> texture_semantic_map;
+   unordered_map<string, slang_texture_semantic_map> texture_semantic_uniform_map;
+   unordered_map<string, slang_semantic_map> uniform_semantic_map;
+
+   if (!slang_semantic_maps(shader_info, pass_number,
+            texture_semantic_map, texture_semantic_uniform_map,
+            uniform_semantic_map))
+      return false;
+
    slang_reflection sl_reflection;
    sl_reflection.pass_number                  = pass_number;
    sl_reflection.texture_semantic_map         = &texture_semantic_map;
@@ -673,3 +694,123 @@ error:
 
    return false;
 }
+
+bool slang_compile_preset_report(const char *path, unsigned threads)
+{
+   unsigned i;
+   retro_time_t start;
+   retro_time_t serial_time;
+   retro_time_t parallel_time;
+   retro_time_t reflect_total = 0;
+   vector<glslang_output> outputs;
+   vector<glslang_output> parallel_outputs;
+   vector<int64_t> times;
+   config_file_t *conf        = NULL;
+   unique_ptr<video_shader> shader{ new video_shader() };
+
+   if (!(conf = video_shader_read_preset(path)))
+      return false;
+
+   if (!video_shader_read_conf_preset(conf, shader.get()))
+   {
+      config_file_free(conf);
+      return false;
+   }
+
+   config_file_free(conf);
+
+   if (!threads)
+      threads = cpu_features_get_core_amount();
+
+   /* The per pass times are taken from the serial run, so they do not
+    * depend on how the passes were spread over the threads. */
+   start         = cpu_features_get_time_usec();
+   if (!glslang_compile_preset(shader.get(), &outputs, 1, &times))
+      return false;
+   serial_time   = cpu_features_get_time_usec() - start;
+
+   start         = cpu_features_get_time_usec();
+   if (!glslang_compile_preset(shader.get(), &parallel_outputs,
+            threads, NULL))
+      return false;
+   parallel_time = cpu_features_get_time_usec() - start;
+
+   for (i = 0; i < shader->passes; i++)
+   {
+      if (     parallel_outputs[i].vertex   != outputs[i].vertex
+            || parallel_outputs[i].fragment != outputs[i].fragment)
+      {
+         RARCH_ERR("[slang]: Pass #%u compiled differently on %u threads.\n",
+               i, threads);
+         return false;
+      }
+   }
+
+   printf("%s: %u passes\n\n", path, shader->passes);
+   printf("%4s %12s %12s %10s %6s %6s %8s  %s\n",
+         "pass", "compile (ms)", "reflect (ms)", "SPIR-V (B)",
+         "UBO", "push", "textures", "shader");
+
+   shader->num_parameters = 0;
+
+   for (i = 0; i < shader->passes; i++)
+   {
+      unsigned j;
+      retro_time_t reflect_time;
+      unsigned textures          = 0;
+      glslang_output &output     = outputs[i];
+      video_shader_pass &pass    = shader->pass[i];
+      slang_reflection reflection;
+      unordered_map<string, slang_texture_semantic_map> texture_semantic_map;
+      unordered_map<string, slang_texture_semantic_map> texture_semantic_uniform_map;
+      unordered_map<string, slang_semantic_map> uniform_semantic_map;
+
+      start = cpu_features_get_time_usec();
+
+      if (!slang_preprocess_parse_parameters(output.meta, shader.get()))
+         return false;
+
+      if (!*pass.alias && !output.meta.name.empty())
+         strlcpy(pass.alias, output.meta.name.c_str(), sizeof(pass.alias) - 1);
+
+      if (!slang_semantic_maps(shader.get(), i,
+               texture_semantic_map, texture_semantic_uniform_map,
+               uniform_semantic_map))
+         return false;
+
+      reflection.pass_number                  = i;
+      reflection.texture_semantic_map         = &texture_semantic_map;
+      reflection.texture_semantic_uniform_map = &texture_semantic_uniform_map;
+      reflection.semantic_map                 = &uniform_semantic_map;
+
+      if (!slang_reflect_spirv(output.vertex, output.fragment, &reflection))
+      {
+         RARCH_ERR("[slang]: Failed to reflect pass #%u.\n", i);
+         return false;
+      }
+
+      reflect_time   = cpu_features_get_time_usec() - start;
+      reflect_total += reflect_time;
+
+      for (j = 0; j < SLANG_NUM_TEXTURE_SEMANTICS; j++)
+         for (auto &meta : reflection.semantic_textures[j])
+            if (meta.texture)
+               textures++;
+
+      printf("%4u %12.2f %12.2f %10u %6u %6u %8u  %s\n", i,
+            times[i] / 1000.0, reflect_time / 1000.0,
+            (unsigned)((output.vertex.size() + output.fragment.size())
+               * sizeof(uint32_t)),
+            (unsigned)reflection.ubo_size,
+            (unsigned)reflection.push_constant_size,
+            textures, path_basename(pass.source.path));
+   }
+
+   printf("\nCompile: %.2f ms on 1 thread, %.2f ms on %u thread%s."
+         " Reflection: %.2f ms.\n",
+         serial_time / 1000.0, parallel_time / 1000.0, threads,
+         threads == 1 ? "" : "s",
+         reflect_total / 1000.0);
+
+   return true;
+}
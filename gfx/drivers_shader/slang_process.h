@@ -99,6 +99,11 @@ bool slang_process(
       const semantics_map_t* semantics_map,
       pass_semantics_t*      out);
 
+/* Compiles and reflects every pass of the preset at @path, serially
+ * and then on @threads threads (0 for one per CPU core), and prints
+ * how long each pass took. Needs no GPU, meant for benchmarking. */
+bool slang_compile_preset_report(const char *path, unsigned threads);
+
 RETRO_END_DECLS
 
 #ifdef __cplusplus
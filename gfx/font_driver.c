@@ -22,6 +22,7 @@
 #endif
 
 #include "font_driver.h"
+#include "gfx_display.h"
 #include "video_thread_wrapper.h"
 
 #include "../retroarch.h"
@@ -1055,6 +1056,9 @@ void font_driver_render_msg(
 #else
       char *new_msg = (char*)msg;
 #endif
+      /* Drawn right away, so batched quads must come first */
+      if (!font->block_bound)
+         gfx_display_batch_flush();
       font->renderer->render_msg(data,
             font->renderer_data, new_msg, params);
 #ifdef HAVE_LANGEXTRA
@@ -1069,14 +1073,20 @@ void font_driver_bind_block(void *font_data, void *block)
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
 
    if (font && font->renderer && font->renderer->bind_block)
+   {
       font->renderer->bind_block(font->renderer_data, block);
+      font->block_bound = (block != NULL);
+   }
 }
 
 void font_driver_flush(unsigned width, unsigned height, void *font_data)
 {
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
    if (font && font->renderer && font->renderer->flush)
+   {
+      gfx_display_batch_flush();
       font->renderer->flush(width, height, font->renderer_data);
+   }
 }
 
 int font_driver_get_message_width(void *font_data,
@@ -1204,6 +1214,7 @@ font_data_t *font_driver_init_first(
       font->renderer      = (const font_renderer_t*)font_driver;
       font->renderer_data = font_handle;
       font->size          = font_size;
+      font->block_bound   = false;
       return font;
    }
 
@@ -129,6 +129,9 @@ typedef struct
    const font_renderer_t *renderer;
    void *renderer_data;
    float size;
+   /* Text is queued into a raster block instead of
+    * being drawn straight away */
+   bool block_bound;
 } font_data_t;
 
 /* font_path can be NULL for default font. */
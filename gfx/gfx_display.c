@@ -48,11 +48,46 @@ static float osk_dark[16] =  {
  * needs to be refactored */
 uintptr_t gfx_display_white_texture;
 
-static void *gfx_display_null_get_default_mvp(void *data) { return NULL; }
+/* TODO/FIXME - static globals */
+static unsigned gfx_display_null_draws    = 0;
+static size_t   gfx_display_null_vertices = 0;
+
+/* Same projection as the GL display driver: (0,0)-(1,1) fills
+ * the viewport, so that batched quads still add up */
+static void *gfx_display_null_get_default_mvp(void *data)
+{
+   static math_matrix_4x4 mvp = {{
+       2.0f,  0.0f,  0.0f, 0.0f,
+       0.0f,  2.0f,  0.0f, 0.0f,
+       0.0f,  0.0f, -1.0f, 0.0f,
+      -1.0f, -1.0f,  0.0f, 1.0f
+   }};
+   return &mvp;
+}
 static void gfx_display_null_blend_begin(void *data) { }
 static void gfx_display_null_blend_end(void *data) { }
+
 static void gfx_display_null_draw(gfx_display_ctx_draw_t *draw,
-      void *data, unsigned width, unsigned height) { }
+      void *data, unsigned width, unsigned height)
+{
+   gfx_display_null_draws++;
+   if (draw->coords)
+      gfx_display_null_vertices += draw->coords->vertices;
+}
+
+void gfx_display_null_get_stats(unsigned *draws, size_t *vertices,
+      bool reset)
+{
+   if (draws)
+      *draws                    = gfx_display_null_draws;
+   if (vertices)
+      *vertices                 = gfx_display_null_vertices;
+   if (reset)
+   {
+      gfx_display_null_draws    = 0;
+      gfx_display_null_vertices = 0;
+   }
+}
 static void gfx_display_null_draw_pipeline(gfx_display_ctx_draw_t *draw,
       void *data, unsigned width, unsigned height) { }
 static void gfx_display_null_viewport(gfx_display_ctx_draw_t *draw, void *data) { }
@@ -101,7 +136,8 @@ gfx_display_ctx_driver_t gfx_display_ctx_null = {
    "null",
    false,
    NULL,
-   NULL
+   NULL,
+   true
 };
 
 /* Menu display drivers */
@@ -613,12 +649,382 @@ void gfx_display_coords_array_reset(void)
    p_dispca->coords.vertices         = 0;
 }
 
+/* Sets the requested blend state on the display driver,
+ * if it is not known to be set already */
+static void gfx_display_blend_apply(gfx_display_t *p_disp, void *data)
+{
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   if (     !dispctx
+         || p_disp->blend_requested == GFX_DISPLAY_BLEND_UNKNOWN
+         || p_disp->blend_requested == p_disp->blend_applied)
+      return;
+
+   if (p_disp->blend_requested == GFX_DISPLAY_BLEND_ON)
+   {
+      if (dispctx->blend_begin)
+         dispctx->blend_begin(data);
+   }
+   else if (dispctx->blend_end)
+      dispctx->blend_end(data);
+
+   p_disp->blend_applied = p_disp->blend_requested;
+}
+
+/* Draws the queued quads, one display driver call per group,
+ * each with the texture and blend state it was queued with */
+static void gfx_display_batch_draw(gfx_display_t *p_disp)
+{
+   unsigned i, j;
+   gfx_display_ctx_draw_t draw;
+   struct video_coords coords;
+   enum gfx_display_blend_state requested;
+   video_coord_array_t *ca           = &p_disp->batch;
+   video_coord_array_t *sorted       = &p_disp->batch_sorted;
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+   size_t offset                     = 0;
+
+   if (!p_disp->batch_num_quads)
+      return;
+
+   if (!dispctx || !dispctx->draw)
+      goto end;
+
+   /* Quads of a group are only contiguous if there is
+    * just one group */
+   if (p_disp->batch_num_groups > 1)
+   {
+      size_t cursor[GFX_DISPLAY_BATCH_GROUPS];
+
+      /* Make room, then move every quad to its group */
+      sorted->coords.vertices = 0;
+      if (!video_coord_array_append(sorted,
+               (const video_coords_t*)&ca->coords, ca->coords.vertices))
+         goto end;
+
+      for (i = 0; i < p_disp->batch_num_groups; i++)
+      {
+         cursor[i] = offset;
+         offset   += p_disp->batch_groups[i].quads * 6;
+      }
+
+      for (j = 0; j < p_disp->batch_num_quads; j++)
+      {
+         size_t dst = cursor[p_disp->batch_quads[j].group];
+         size_t src = j * 6;
+
+         memcpy(sorted->coords.vertex        + dst * 2,
+               ca->coords.vertex        + src * 2, 12 * sizeof(float));
+         memcpy(sorted->coords.color         + dst * 4,
+               ca->coords.color         + src * 4, 24 * sizeof(float));
+         memcpy(sorted->coords.tex_coord     + dst * 2,
+               ca->coords.tex_coord     + src * 2, 12 * sizeof(float));
+         memcpy(sorted->coords.lut_tex_coord + dst * 2,
+               ca->coords.lut_tex_coord + src * 2, 12 * sizeof(float));
+
+         cursor[p_disp->batch_quads[j].group] = dst + 6;
+      }
+
+      ca     = sorted;
+      offset = 0;
+   }
+
+   requested                       = p_disp->blend_requested;
+
+   draw.x                          = 0;
+   draw.y                          = 0;
+   draw.color                      = NULL;
+   draw.vertex                     = NULL;
+   draw.tex_coord                  = NULL;
+   draw.width                      = p_disp->batch_width;
+   draw.height                     = p_disp->batch_height;
+   draw.coords                     = &coords;
+   draw.matrix_data                = NULL;
+   draw.prim_type                  = GFX_DISPLAY_PRIM_TRIANGLES;
+   draw.pipeline.id                = 0;
+   draw.pipeline.backend_data      = NULL;
+   draw.pipeline.backend_data_size = 0;
+   draw.pipeline.active            = false;
+   draw.rotation                   = 0.0f;
+   draw.scale_factor               = 1.0f;
+
+   for (i = 0; i < p_disp->batch_num_groups; i++)
+   {
+      gfx_display_batch_group_t *group = &p_disp->batch_groups[i];
+
+      p_disp->blend_requested = group->blend;
+      gfx_display_blend_apply(p_disp, p_disp->batch_userdata);
+
+      coords.vertex           = ca->coords.vertex        + offset * 2;
+      coords.color            = ca->coords.color         + offset * 4;
+      coords.tex_coord        = ca->coords.tex_coord     + offset * 2;
+      coords.lut_tex_coord    = ca->coords.lut_tex_coord + offset * 2;
+      coords.vertices         = group->quads * 6;
+      coords.index            = NULL;
+      coords.indexes          = 0;
+
+      draw.texture            = group->texture;
+      draw.vertex_count       = coords.vertices;
+
+      dispctx->draw(&draw, p_disp->batch_userdata,
+            p_disp->batch_width, p_disp->batch_height);
+
+      offset                 += coords.vertices;
+   }
+
+   p_disp->blend_requested    = requested;
+
+end:
+   ca->coords.vertices        = 0;
+   p_disp->batch.coords.vertices = 0;
+   p_disp->batch_num_quads    = 0;
+   p_disp->batch_num_groups   = 0;
+}
+
+/* Picks the group a quad with the given bounds is drawn with.
+ * Quads are drawn grouped by texture and blend state, rather
+ * than in the order they were queued in: a quad may only join
+ * an earlier group if it does not overlap any quad of the
+ * groups after it, which would otherwise be drawn below it.
+ * To bound the cost, a new group is started instead if that
+ * means looking at too many quads. */
+static int gfx_display_batch_find_group(gfx_display_t *p_disp,
+      uintptr_t texture, const gfx_display_batch_quad_t *bounds)
+{
+   unsigned i;
+   int group = (int)p_disp->batch_num_groups - 1;
+
+   for (; group >= 0; group--)
+      if (     p_disp->batch_groups[group].texture == texture
+            && p_disp->batch_groups[group].blend
+            == p_disp->blend_requested)
+         break;
+
+   if (group < 0)
+      return -1;
+   /* Quads of later groups were all queued after
+    * the first quad of the next group */
+   if (group + 1 == (int)p_disp->batch_num_groups)
+      return group;
+
+   i = p_disp->batch_groups[group + 1].first;
+   if (p_disp->batch_num_quads - i > GFX_DISPLAY_BATCH_LOOKBACK)
+      return -1;
+
+   for (; i < p_disp->batch_num_quads; i++)
+   {
+      const gfx_display_batch_quad_t *quad = &p_disp->batch_quads[i];
+      if (     (int)quad->group > group
+            && quad->x0 < bounds->x1 && bounds->x0 < quad->x1
+            && quad->y0 < bounds->y1 && bounds->y0 < quad->y1)
+         return -1;
+   }
+
+   return group;
+}
+
+/* Queues a draw to be merged with others, if it is a quad
+ * drawn with the default pipeline and an affine transform.
+ * Its vertices are moved from the draw's viewport to the whole
+ * video viewport, as seen through the default MVP. */
+static bool gfx_display_batch_push(gfx_display_t *p_disp,
+      gfx_display_ctx_draw_t *draw, void *data,
+      unsigned video_width, unsigned video_height)
+{
+   static const unsigned order[6]    = { 0, 1, 2, 2, 1, 3 };
+   static const float white[16]      = {
+      1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+      1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f
+   };
+   unsigned i;
+   int group;
+   video_coords_t coords;
+   math_matrix_4x4 identity;
+   gfx_display_batch_quad_t bounds;
+   float vertex[12], tex_coord[12], color[24];
+   float det, inv00, inv01, inv10, inv11;
+   const math_matrix_4x4 *mvp        = NULL;
+   const math_matrix_4x4 *mat        = NULL;
+   const float *src_vertex           = draw->coords->vertex;
+   const float *src_tex_coord        = draw->coords->tex_coord;
+   const float *src_color            = draw->coords->color;
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   if (     !dispctx->can_batch
+         || draw->prim_type != GFX_DISPLAY_PRIM_TRIANGLESTRIP
+         || draw->coords->vertices != 4
+         || draw->pipeline.id
+         || !video_width
+         || !video_height)
+      return false;
+
+   if (dispctx->get_default_mvp)
+      mvp = (const math_matrix_4x4*)dispctx->get_default_mvp(data);
+   if (!mvp)
+   {
+      matrix_4x4_identity(identity);
+      mvp = &identity;
+   }
+   mat = draw->matrix_data
+      ? (const math_matrix_4x4*)draw->matrix_data : mvp;
+
+   /* Only affine 2D transforms can be undone on the CPU */
+   if (     MAT_ELEM_4X4(*mat, 3, 0) != 0.0f
+         || MAT_ELEM_4X4(*mat, 3, 1) != 0.0f
+         || MAT_ELEM_4X4(*mat, 3, 3) != 1.0f
+         || MAT_ELEM_4X4(*mvp, 3, 0) != 0.0f
+         || MAT_ELEM_4X4(*mvp, 3, 1) != 0.0f
+         || MAT_ELEM_4X4(*mvp, 3, 3) != 1.0f)
+      return false;
+
+   det = MAT_ELEM_4X4(*mvp, 0, 0) * MAT_ELEM_4X4(*mvp, 1, 1)
+       - MAT_ELEM_4X4(*mvp, 0, 1) * MAT_ELEM_4X4(*mvp, 1, 0);
+   if (det == 0.0f)
+      return false;
+   inv00 =  MAT_ELEM_4X4(*mvp, 1, 1) / det;
+   inv01 = -MAT_ELEM_4X4(*mvp, 0, 1) / det;
+   inv10 = -MAT_ELEM_4X4(*mvp, 1, 0) / det;
+   inv11 =  MAT_ELEM_4X4(*mvp, 0, 0) / det;
+
+   if (!src_vertex)
+      src_vertex    = dispctx->get_default_vertices();
+   if (!src_tex_coord)
+      src_tex_coord = dispctx->get_default_tex_coords();
+   if (!src_color)
+      src_color     = white;
+
+   if (     p_disp->batch_num_quads
+         && (  p_disp->batch_userdata != data
+            || p_disp->batch_width    != video_width
+            || p_disp->batch_height   != video_height
+            || p_disp->batch_num_quads == GFX_DISPLAY_BATCH_QUADS))
+      gfx_display_batch_draw(p_disp);
+
+   bounds.x0 = bounds.y0 =  2.0f;
+   bounds.x1 = bounds.y1 = -2.0f;
+
+   for (i = 0; i < 6; i++)
+   {
+      const float *v = src_vertex + order[i] * 2;
+      /* Clip space in the draw's viewport... */
+      float cx       = MAT_ELEM_4X4(*mat, 0, 0) * v[0]
+                     + MAT_ELEM_4X4(*mat, 0, 1) * v[1]
+                     + MAT_ELEM_4X4(*mat, 0, 3);
+      float cy       = MAT_ELEM_4X4(*mat, 1, 0) * v[0]
+                     + MAT_ELEM_4X4(*mat, 1, 1) * v[1]
+                     + MAT_ELEM_4X4(*mat, 1, 3);
+      /* ...then in the whole viewport... */
+      cx             = (draw->x + (cx + 1.0f) * 0.5f * draw->width)
+                     * 2.0f / video_width  - 1.0f;
+      cy             = (draw->y + (cy + 1.0f) * 0.5f * draw->height)
+                     * 2.0f / video_height - 1.0f;
+
+      if (cx < bounds.x0)
+         bounds.x0 = cx;
+      if (cx > bounds.x1)
+         bounds.x1 = cx;
+      if (cy < bounds.y0)
+         bounds.y0 = cy;
+      if (cy > bounds.y1)
+         bounds.y1 = cy;
+
+      cx            -= MAT_ELEM_4X4(*mvp, 0, 3);
+      cy            -= MAT_ELEM_4X4(*mvp, 1, 3);
+
+      /* ...and back through the default MVP */
+      vertex[i * 2]         = inv00 * cx + inv01 * cy;
+      vertex[i * 2 + 1]     = inv10 * cx + inv11 * cy;
+      tex_coord[i * 2]      = src_tex_coord[order[i] * 2];
+      tex_coord[i * 2 + 1]  = src_tex_coord[order[i] * 2 + 1];
+      memcpy(color + i * 4, src_color + order[i] * 4, 4 * sizeof(float));
+   }
+
+   if ((group = gfx_display_batch_find_group(
+               p_disp, draw->texture, &bounds)) < 0)
+   {
+      if (p_disp->batch_num_groups == GFX_DISPLAY_BATCH_GROUPS)
+         gfx_display_batch_draw(p_disp);
+
+      group = p_disp->batch_num_groups++;
+      p_disp->batch_groups[group].texture = draw->texture;
+      p_disp->batch_groups[group].blend   = p_disp->blend_requested;
+      p_disp->batch_groups[group].quads   = 0;
+      p_disp->batch_groups[group].first   = p_disp->batch_num_quads;
+   }
+
+   coords.vertex           = vertex;
+   coords.color            = color;
+   coords.tex_coord        = tex_coord;
+   coords.lut_tex_coord    = tex_coord;
+   coords.vertices         = 6;
+   coords.index            = NULL;
+   coords.indexes          = 0;
+
+   if (!video_coord_array_append(&p_disp->batch, &coords, 6))
+   {
+      if (!p_disp->batch_groups[group].quads)
+         p_disp->batch_num_groups--;
+      return false;
+   }
+
+   bounds.group                                = group;
+   p_disp->batch_quads[p_disp->batch_num_quads++] = bounds;
+   p_disp->batch_groups[group].quads++;
+   p_disp->batch_userdata  = data;
+   p_disp->batch_width     = video_width;
+   p_disp->batch_height    = video_height;
+   return true;
+}
+
+void gfx_display_batch_begin(void)
+{
+   gfx_display_t            *p_disp  = disp_get_ptr();
+   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   if (p_disp->batching || !dispctx || !dispctx->can_batch)
+      return;
+
+   p_disp->batching        = true;
+   p_disp->blend_requested = GFX_DISPLAY_BLEND_UNKNOWN;
+   p_disp->blend_applied   = GFX_DISPLAY_BLEND_UNKNOWN;
+}
+
+void gfx_display_batch_end(void)
+{
+   gfx_display_t *p_disp = disp_get_ptr();
+
+   if (!p_disp->batching)
+      return;
+
+   gfx_display_batch_draw(p_disp);
+   /* Leave the blend state as the last request wanted it */
+   gfx_display_blend_apply(p_disp, p_disp->batch_userdata);
+   p_disp->batching      = false;
+}
+
+void gfx_display_batch_flush(void)
+{
+   gfx_display_t *p_disp = disp_get_ptr();
+
+   if (!p_disp->batching)
+      return;
+
+   gfx_display_batch_draw(p_disp);
+   p_disp->blend_applied = GFX_DISPLAY_BLEND_UNKNOWN;
+}
+
 /* Begin blending operation */
 void gfx_display_blend_begin(void *data)
 {
    gfx_display_t            *p_disp  = disp_get_ptr();
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
-   if (dispctx && dispctx->blend_begin)
+
+   if (p_disp->batching)
+   {
+      p_disp->blend_requested = GFX_DISPLAY_BLEND_ON;
+      p_disp->batch_userdata  = data;
+   }
+   else if (dispctx && dispctx->blend_begin)
       dispctx->blend_begin(data);
 }
 
@@ -627,7 +1033,13 @@ void gfx_display_blend_end(void *data)
 {
    gfx_display_t            *p_disp  = disp_get_ptr();
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
-   if (dispctx && dispctx->blend_end)
+
+   if (p_disp->batching)
+   {
+      p_disp->blend_requested = GFX_DISPLAY_BLEND_OFF;
+      p_disp->batch_userdata  = data;
+   }
+   else if (dispctx && dispctx->blend_end)
       dispctx->blend_end(data);
 }
 
@@ -639,6 +1051,9 @@ void gfx_display_scissor_begin(void *userdata,
 {
    gfx_display_t            *p_disp  = disp_get_ptr();
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   gfx_display_batch_draw(p_disp);
+
    if (dispctx && dispctx->scissor_begin)
    {
       if (y < 0)
@@ -687,6 +1102,9 @@ void gfx_display_scissor_end(
 {
    gfx_display_t            *p_disp  = disp_get_ptr();
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
+
+   gfx_display_batch_draw(p_disp);
+
    if (dispctx && dispctx->scissor_end)
       dispctx->scissor_end(userdata,
             video_width, video_height);
@@ -749,6 +1167,16 @@ void gfx_display_draw(gfx_display_ctx_draw_t *draw,
       return;
    if (draw->width <= 0)
       return;
+
+   if (p_disp->batching)
+   {
+      if (gfx_display_batch_push(p_disp, draw, data,
+               video_width, video_height))
+         return;
+      gfx_display_batch_draw(p_disp);
+      gfx_display_blend_apply(p_disp, data);
+   }
+
    dispctx->draw(draw, data, video_width, video_height);
 }
 
@@ -768,7 +1196,7 @@ void gfx_display_draw_blend(
    if (draw->width <= 0)
       return;
    gfx_display_blend_begin(data);
-   dispctx->draw(draw, data, video_width, video_height);
+   gfx_display_draw(draw, data, video_width, video_height);
    gfx_display_blend_end(data);
 }
 
@@ -781,8 +1209,19 @@ void gfx_display_draw_pipeline(
    gfx_display_t            *p_disp  = disp_get_ptr();
    gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
    if (dispctx && draw && dispctx->draw_pipeline)
+   {
+      if (p_disp->batching)
+      {
+         gfx_display_batch_draw(p_disp);
+         gfx_display_blend_apply(p_disp, userdata);
+      }
+
       dispctx->draw_pipeline(draw, userdata,
             video_width, video_height);
+
+      /* Pipelines set their own blend function and shader */
+      p_disp->blend_applied = GFX_DISPLAY_BLEND_UNKNOWN;
+   }
 }
 
 void gfx_display_draw_bg(gfx_display_ctx_draw_t *draw,
@@ -857,8 +1296,6 @@ void gfx_display_draw_quad(
 {
    gfx_display_ctx_draw_t draw;
    struct video_coords coords;
-   gfx_display_t            *p_disp  = disp_get_ptr();
-   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
 
    coords.vertices      = 4;
    coords.vertex        = NULL;
@@ -866,8 +1303,7 @@ void gfx_display_draw_quad(
    coords.lut_tex_coord = NULL;
    coords.color         = color;
 
-   if (dispctx && dispctx->blend_begin)
-      dispctx->blend_begin(data);
+   gfx_display_blend_begin(data);
 
    draw.x            = x;
    draw.y            = (int)height - y - (int)h;
@@ -884,8 +1320,7 @@ void gfx_display_draw_quad(
    gfx_display_draw(&draw, data,
          video_width, video_height);
 
-   if (dispctx && dispctx->blend_end)
-      dispctx->blend_end(data);
+   gfx_display_blend_end(data);
 }
 
 void gfx_display_draw_polygon(
@@ -902,8 +1337,6 @@ void gfx_display_draw_polygon(
    float vertex[8];
    gfx_display_ctx_draw_t draw;
    struct video_coords coords;
-   gfx_display_t            *p_disp  = disp_get_ptr();
-   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
 
    vertex[0]             = x1 / (float)width;
    vertex[1]             = y1 / (float)height;
@@ -920,8 +1353,7 @@ void gfx_display_draw_polygon(
    coords.lut_tex_coord = NULL;
    coords.color         = color;
 
-   if (dispctx && dispctx->blend_begin)
-      dispctx->blend_begin(userdata);
+   gfx_display_blend_begin(userdata);
 
    draw.x            = 0;
    draw.y            = 0;
@@ -938,8 +1370,7 @@ void gfx_display_draw_polygon(
    gfx_display_draw(&draw, userdata,
          video_width, video_height);
 
-   if (dispctx && dispctx->blend_end)
-      dispctx->blend_end(userdata);
+   gfx_display_blend_end(userdata);
 }
 
 void gfx_display_draw_texture(
@@ -1364,8 +1795,6 @@ void gfx_display_draw_cursor(
 {
    gfx_display_ctx_draw_t draw;
    struct video_coords coords;
-   gfx_display_t            *p_disp  = disp_get_ptr();
-   gfx_display_ctx_driver_t *dispctx = p_disp->dispctx;
 
    if (!cursor_visible)
       return;
@@ -1376,8 +1805,7 @@ void gfx_display_draw_cursor(
    coords.lut_tex_coord = NULL;
    coords.color         = (const float*)color;
 
-   if (dispctx && dispctx->blend_begin)
-      dispctx->blend_begin(userdata);
+   gfx_display_blend_begin(userdata);
 
    draw.x               = x - (cursor_size / 2);
    draw.y               = (int)height - y - (cursor_size / 2);
@@ -1391,8 +1819,7 @@ void gfx_display_draw_cursor(
 
    gfx_display_draw(&draw, userdata, video_width, video_height);
 
-   if (dispctx && dispctx->blend_end)
-      dispctx->blend_end(userdata);
+   gfx_display_blend_end(userdata);
 }
 
 void gfx_display_push_quad(
@@ -1632,13 +2059,17 @@ bool gfx_display_get_update_pending(void)
    return false;
 }
 
+/* Menus and widgets draw between these two, which
+ * is also where quads get batched */
 void gfx_display_set_viewport(unsigned width, unsigned height)
 {
    video_driver_set_viewport(width, height, true, false);
+   gfx_display_batch_begin();
 }
 
 void gfx_display_unset_viewport(unsigned width, unsigned height)
 {
+   gfx_display_batch_end();
    video_driver_set_viewport(width, height, false, true);
 }
 
@@ -1876,6 +2307,8 @@ void gfx_display_free(void)
 {
    gfx_display_t           *p_disp   = disp_get_ptr();
    video_coord_array_free(&p_disp->dispca);
+   video_coord_array_free(&p_disp->batch);
+   video_coord_array_free(&p_disp->batch_sorted);
    gfx_animation_ctl(MENU_ANIMATION_CTL_DEINIT, NULL);
 
    p_disp->msg_force           = false;
@@ -1884,6 +2317,9 @@ void gfx_display_free(void)
    p_disp->framebuf_height     = 0;
    p_disp->framebuf_pitch      = 0;
    p_disp->has_windowed        = false;
+   p_disp->batching            = false;
+   p_disp->batch_num_quads     = 0;
+   p_disp->batch_num_groups    = 0;
    p_disp->dispctx             = NULL;
 }
 
@@ -1894,6 +2330,11 @@ void gfx_display_init(void)
 
    p_disp->has_windowed          = video_driver_has_windowed();
    p_dispca->allocated           =  0;
+   p_disp->batching              = false;
+   p_disp->batch_num_quads       = 0;
+   p_disp->batch_num_groups      = 0;
+   video_coord_array_free(&p_disp->batch);
+   video_coord_array_free(&p_disp->batch_sorted);
 }
 
 bool gfx_display_driver_exists(const char *s)
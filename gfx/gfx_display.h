@@ -102,6 +102,44 @@ typedef struct gfx_display_frame_info
    bool shadows_enable;
 } gfx_display_frame_info_t;
 
+/* Blend state asked for by the menu, and the one last
+ * set on the display driver, while batching */
+enum gfx_display_blend_state
+{
+   GFX_DISPLAY_BLEND_UNKNOWN = 0,
+   GFX_DISPLAY_BLEND_OFF,
+   GFX_DISPLAY_BLEND_ON
+};
+
+/* Quads queued while batching, and how many groups
+ * of them (one draw each) may be pending at once */
+#define GFX_DISPLAY_BATCH_QUADS    1024
+#define GFX_DISPLAY_BATCH_GROUPS   32
+/* How many quads of later groups a quad may be checked
+ * against before it can join an earlier group */
+#define GFX_DISPLAY_BATCH_LOOKBACK 64
+
+/* Bounds of a queued quad in clip space of the
+ * whole viewport, and the group it belongs to */
+typedef struct gfx_display_batch_quad
+{
+   float x0;
+   float y0;
+   float x1;
+   float y1;
+   unsigned group;
+} gfx_display_batch_quad_t;
+
+/* Queued quads drawn with a single display driver call */
+typedef struct gfx_display_batch_group
+{
+   uintptr_t texture;
+   enum gfx_display_blend_state blend;
+   unsigned quads;
+   /* Index of its first quad */
+   unsigned first;
+} gfx_display_batch_group_t;
+
 typedef struct gfx_display_ctx_draw gfx_display_ctx_draw_t;
 
 
@@ -143,6 +181,10 @@ typedef struct gfx_display_ctx_driver
          int x, int y, unsigned width, unsigned height);
    void (*scissor_end)(void *data, unsigned video_width,
          unsigned video_height);
+   /* Draws a GFX_DISPLAY_PRIM_TRIANGLES list of any length
+    * over the whole viewport with the default pipeline, so
+    * that queued quads can be merged into one draw */
+   bool can_batch;
 } gfx_display_ctx_driver_t;
 
 struct gfx_display_ctx_draw
@@ -220,6 +262,23 @@ struct gfx_display
 
    video_coord_array_t dispca;
    gfx_display_ctx_driver_t *dispctx;
+
+   /* Quads queued while batching, six vertices each, in the
+    * order they were queued. They are drawn before the scissor
+    * rectangle changes or anything else gets drawn. */
+   video_coord_array_t batch;
+   /* The same quads, sorted by group for drawing */
+   video_coord_array_t batch_sorted;
+   gfx_display_batch_quad_t batch_quads[GFX_DISPLAY_BATCH_QUADS];
+   gfx_display_batch_group_t batch_groups[GFX_DISPLAY_BATCH_GROUPS];
+   void *batch_userdata;
+   unsigned batch_width;
+   unsigned batch_height;
+   unsigned batch_num_quads;
+   unsigned batch_num_groups;
+   enum gfx_display_blend_state blend_requested;
+   enum gfx_display_blend_state blend_applied;
+   bool batching;
 };
 
 typedef struct gfx_display gfx_display_t;
@@ -232,6 +291,19 @@ void gfx_display_blend_begin(void *data);
 
 void gfx_display_blend_end(void *data);
 
+/* Between gfx_display_batch_begin() and gfx_display_batch_end(),
+ * quads drawn with the default pipeline are queued and merged
+ * into as few display driver draws as possible. Blend state
+ * changes are deferred until something is actually drawn.
+ * Only has an effect if the display driver can batch. */
+void gfx_display_batch_begin(void);
+void gfx_display_batch_end(void);
+
+/* Draws all queued quads. Must be called before anything that
+ * draws behind the back of gfx_display (e.g. fonts), which is
+ * also assumed to leave the blend state undefined */
+void gfx_display_batch_flush(void);
+
 void gfx_display_push_quad(
       unsigned width, unsigned height,
       const float *colors, int x1, int y1,
@@ -407,8 +479,16 @@ bool gfx_display_driver_exists(const char *s);
 
 bool gfx_display_init_first_driver(bool video_is_threaded);
 
+/* Number of draws and vertices the null display driver has
+ * been asked for since the last reset, to measure batching
+ * without a GPU */
+void gfx_display_null_get_stats(unsigned *draws, size_t *vertices,
+      bool reset);
+
 extern uintptr_t gfx_display_white_texture;
 
+extern gfx_display_ctx_driver_t gfx_display_ctx_null;
+
 extern gfx_display_ctx_driver_t gfx_display_ctx_gl;
 extern gfx_display_ctx_driver_t gfx_display_ctx_gl_core;
 extern gfx_display_ctx_driver_t gfx_display_ctx_gl1;
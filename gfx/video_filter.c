@@ -31,6 +31,7 @@
 #include "../frontend/frontend_driver.h"
 #include "../dynamic.h"
 #include "../performance_counters.h"
+#include "../performance_trace.h"
 #include "../verbosity.h"
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
@@ -60,48 +61,262 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   struct softfilter_pool *pool;
 #endif
 };
 
+/* Row tiles requested from the filter per worker thread.
+ * Cutting the frame into more packets than there are workers
+ * lets a worker that finished its own share early steal tiles
+ * from a slower one instead of idling on uneven scenes. */
+#define SOFTFILTER_TILES_PER_THREAD 4
+
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
 
-struct filter_thread_data
+struct softfilter_pool_worker
 {
+   struct softfilter_pool *pool;
    sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
    slock_t *lock;
+   /* Packet range [head, tail) still owed by this worker.
+    * The owner pops from the head, thieves from the tail. */
+   unsigned head;
+   unsigned tail;
+   unsigned generation;
+};
+
+struct softfilter_pool
+{
+   const struct softfilter_work_packet *packets;
    void *userdata;
+
+   /* Worker 0 is the thread calling rarch_softfilter_process,
+    * it has a queue but no sthread of its own. */
+   struct softfilter_pool_worker *workers;
+   unsigned num_workers;
+
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done_cond;
+   unsigned generation;
+   unsigned remaining;
    bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+static bool softfilter_pool_take(struct softfilter_pool_worker *worker,
+      bool steal, unsigned *index)
+{
+   bool ret = false;
+
+   slock_lock(worker->lock);
+   if (worker->head < worker->tail)
+   {
+      *index = steal ? --worker->tail : worker->head++;
+      ret    = true;
+   }
+   slock_unlock(worker->lock);
+
+   return ret;
+}
+
+/* Drains the worker's own range, then steals from the
+ * others until every queue is empty. Returns the number
+ * of packets executed. */
+static unsigned softfilter_pool_run(struct softfilter_pool *pool,
+      unsigned self)
+{
+   unsigned index    = 0;
+   unsigned executed = 0;
+
+   for (;;)
+   {
+      if (!softfilter_pool_take(&pool->workers[self], false, &index))
+      {
+         unsigned i;
+
+         for (i = 1; i < pool->num_workers; i++)
+         {
+            unsigned victim = (self + i) % pool->num_workers;
+            if (softfilter_pool_take(&pool->workers[victim], true, &index))
+               break;
+         }
+
+         if (i == pool->num_workers)
+            break;
+      }
+
+      pool->packets[index].work(pool->userdata,
+            pool->packets[index].thread_data);
+      executed++;
+   }
+
+   return executed;
+}
+
+static void softfilter_pool_retire(struct softfilter_pool *pool,
+      unsigned executed)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   if (!executed)
+      return;
+
+   slock_lock(pool->lock);
+   pool->remaining -= executed;
+   if (!pool->remaining)
+      scond_signal(pool->done_cond);
+   slock_unlock(pool->lock);
+}
+
+static void softfilter_pool_loop(void *data)
+{
+   struct softfilter_pool_worker *worker =
+      (struct softfilter_pool_worker*)data;
+   struct softfilter_pool *pool          = worker->pool;
+   unsigned self                         = (unsigned)
+      (worker - pool->workers);
+
+   performance_trace_set_thread_name("softfilter");
 
    for (;;)
    {
       bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
+      retro_perf_tick_t trace_start;
+
+      slock_lock(pool->lock);
+      while (worker->generation == pool->generation && !pool->die)
+         scond_wait(pool->cond, pool->lock);
+      die                = pool->die;
+      worker->generation = pool->generation;
+      slock_unlock(pool->lock);
 
       if (die)
          break;
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+      performance_trace_scope_begin(trace_start);
+      softfilter_pool_retire(pool, softfilter_pool_run(pool, self));
+      performance_trace_scope_end(trace_start, "softfilter_work");
+   }
+
+   performance_trace_thread_exit();
+}
+
+static void softfilter_pool_free(struct softfilter_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->die = true;
+      if (pool->cond)
+         scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
    }
+
+   if (pool->workers)
+   {
+      for (i = 0; i < pool->num_workers; i++)
+      {
+         if (pool->workers[i].thread)
+            sthread_join(pool->workers[i].thread);
+         if (pool->workers[i].lock)
+            slock_free(pool->workers[i].lock);
+      }
+      free(pool->workers);
+   }
+
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+   free(pool);
+}
+
+static struct softfilter_pool *softfilter_pool_new(
+      const struct softfilter_work_packet *packets, void *userdata,
+      unsigned num_workers)
+{
+   unsigned i;
+   struct softfilter_pool *pool = (struct softfilter_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->packets     = packets;
+   pool->userdata    = userdata;
+   pool->num_workers = num_workers;
+   pool->workers     = (struct softfilter_pool_worker*)
+      calloc(num_workers, sizeof(*pool->workers));
+   pool->lock        = slock_new();
+   pool->cond        = scond_new();
+   pool->done_cond   = scond_new();
+
+   if (!pool->workers || !pool->lock || !pool->cond || !pool->done_cond)
+      goto error;
+
+   for (i = 0; i < num_workers; i++)
+   {
+      pool->workers[i].pool = pool;
+      if (!(pool->workers[i].lock = slock_new()))
+         goto error;
+   }
+
+   for (i = 1; i < num_workers; i++)
+   {
+      pool->workers[i].thread = sthread_create(
+            softfilter_pool_loop, &pool->workers[i]);
+      if (!pool->workers[i].thread)
+         goto error;
+   }
+
+   return pool;
+
+error:
+   softfilter_pool_free(pool);
+   return NULL;
+}
+
+static void softfilter_pool_process(struct softfilter_pool *pool,
+      unsigned count)
+{
+   unsigned i;
+
+   /* Account for the packets before any queue is visible,
+    * a worker still scanning from the previous frame may
+    * pick up (and retire) a tile as soon as it is queued. */
+   slock_lock(pool->lock);
+   pool->remaining = count;
+   slock_unlock(pool->lock);
+
+   /* Hand each worker a contiguous run of tiles up front,
+    * so neighbouring rows stay on one core unless stolen. */
+   for (i = 0; i < pool->num_workers; i++)
+   {
+      struct softfilter_pool_worker *worker = &pool->workers[i];
+
+      slock_lock(worker->lock);
+      worker->head = (count * i) / pool->num_workers;
+      worker->tail = (count * (i + 1)) / pool->num_workers;
+      slock_unlock(worker->lock);
+   }
+
+   slock_lock(pool->lock);
+   pool->generation++;
+   scond_broadcast(pool->cond);
+   slock_unlock(pool->lock);
+
+   softfilter_pool_retire(pool, softfilter_pool_run(pool, 0));
+
+   slock_lock(pool->lock);
+   while (pool->remaining)
+      scond_wait(pool->done_cond, pool->lock);
+   slock_unlock(pool->lock);
 }
 #endif
 
@@ -134,12 +349,10 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i = 0;
+   unsigned input_fmts, input_fmt, output_fmts, tiles;
    struct config_file_userdata userdata;
    char key[64], name[64];
 
-   (void)i;
-
    key[0] = name[0] = '\0';
 
    snprintf(key, sizeof(key), "filter");
@@ -207,29 +420,44 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = cpu_features_get_core_amount();
+   if (!threads)
+      threads = 1;
+
+   /* Filters see the tile count as their thread count;
+    * the workers then share those tiles. */
+   tiles = threads;
+#ifdef HAVE_THREADS
+   if (threads > 1)
+      tiles = threads * SOFTFILTER_TILES_PER_THREAD;
+#endif
+
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         tiles, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
-   if (!threads)
+   tiles = filt->impl->query_num_threads(filt->impl_data);
+   if (!tiles)
    {
       RARCH_ERR("Invalid number of threads.\n");
       return false;
    }
 
-   filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   filt->threads = tiles;
+   if (threads > tiles)
+      threads    = tiles;
+
+   RARCH_LOG("Using %u threads (%u work packets) for softfilter.\n",
+         threads, tiles);
 
    filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
+      calloc(tiles, sizeof(*filt->packets));
    if (!filt->packets)
    {
       RARCH_ERR("Failed to allocate softfilter packets.\n");
@@ -237,29 +465,12 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (threads > 1)
    {
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
+      filt->pool = softfilter_pool_new(filt->packets,
+            filt->impl_data, threads);
+      if (!filt->pool)
          return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
    }
 #endif
 
@@ -462,6 +673,10 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    if (!filt)
       return;
 
+#ifdef HAVE_THREADS
+   softfilter_pool_free(filt->pool);
+#endif
+
    free(filt->packets);
    if (filt->impl && filt->impl_data)
       filt->impl->destroy(filt->impl_data);
@@ -472,29 +687,8 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
       if (filt->plugs[i].lib)
          dylib_close(filt->plugs[i].lib);
    }
-   free(filt->plugs);
-#endif
-
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!&filt->thread_data[i])
-            continue;
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
 #endif
+   free(filt->plugs);
 
    if (filt->conf)
       config_file_free(filt->conf);
@@ -539,32 +733,9 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->pool)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      softfilter_pool_process(filt->pool, filt->threads);
       return;
    }
 #endif
@@ -16,6 +16,11 @@
 
 #include "softfilter.h"
 #include <stdlib.h>
+#include <retro_inline.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation lq2x_get_implementation
@@ -43,6 +48,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -67,15 +73,15 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -103,95 +109,251 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
+static INLINE void lq2x_pixel_rgb565(uint16_t A, uint16_t B,
+      uint16_t C, uint16_t D, uint16_t E, uint16_t *out0, uint16_t *out1)
+{
+   uint16_t c = C;
+
+   if(A != E && B != D)
+   {
+      out0[0] = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out0[1] = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out1[0] = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+      out1[1] = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+   }
+   else
+   {
+      out0[0] = c;
+      out0[1] = c;
+      out1[0] = c;
+      out1[1] = c;
+   }
+}
+
+static INLINE void lq2x_pixel_xrgb8888(uint32_t A, uint32_t B,
+      uint32_t C, uint32_t D, uint32_t E, uint32_t *out0, uint32_t *out1)
+{
+   uint32_t c = C;
+
+   if(A != E && B != D)
+   {
+      out0[0] = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out0[1] = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out1[0] = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+      out1[1] = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+   }
+   else
+   {
+      out0[0] = c;
+      out0[1] = c;
+      out1[0] = c;
+      out1[1] = c;
+   }
+}
+
 static void lq2x_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned x, y;
-   uint16_t *out0 = (uint16_t*)dst;
-   uint16_t *out1 = (uint16_t*)(dst + dst_stride);
 
    for(y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
+      const uint16_t *row   = src + y * src_stride;
+      const uint16_t *above = (y == 0 && first) ? row : row - src_stride;
+      const uint16_t *below = (y == height - 1 && last) ? row : row + src_stride;
+      uint16_t *out0        = dst + 2 * y * dst_stride;
+      uint16_t *out1        = out0 + dst_stride;
 
       for(x = 0; x < width; x++)
+         lq2x_pixel_rgb565(above[x],
+               (x > 0) ? row[x - 1] : row[x],
+               row[x],
+               (x < width - 1) ? row[x + 1] : row[x],
+               below[x], out0 + (x << 1), out1 + (x << 1));
+   }
+}
+
+static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
+      int first, int last, uint32_t *src,
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+
+   for(y = 0; y < height; y++)
+   {
+      const uint32_t *row   = src + y * src_stride;
+      const uint32_t *above = (y == 0 && first) ? row : row - src_stride;
+      const uint32_t *below = (y == height - 1 && last) ? row : row + src_stride;
+      uint32_t *out0        = dst + 2 * y * dst_stride;
+      uint32_t *out1        = out0 + dst_stride;
+
+      for(x = 0; x < width; x++)
+         lq2x_pixel_xrgb8888(above[x],
+               (x > 0) ? row[x - 1] : row[x],
+               row[x],
+               (x < width - 1) ? row[x + 1] : row[x],
+               below[x], out0 + (x << 1), out1 + (x << 1));
+   }
+}
+
+#if defined(__SSE2__)
+static INLINE __m128i lq2x_select_sse2(__m128i mask,
+      __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* Same compare-and-blend as lq2x_pixel_rgb565, eight pixels at a
+ * time. The blend is rewritten as (C & A) + (((C ^ A) & ~0x0821) >> 1),
+ * which equals the scalar expression but cannot overflow 16 bits. */
+static void lq2x_sse2_rgb565(unsigned width, unsigned height,
+      int first, int last, uint16_t *src,
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+   const __m128i blend_mask = _mm_set1_epi16((short)0xF7DE);
+   const __m128i ones       = _mm_set1_epi16(-1);
+
+   for(y = 0; y < height; y++)
+   {
+      const uint16_t *row   = src + y * src_stride;
+      const uint16_t *above = (y == 0 && first) ? row : row - src_stride;
+      const uint16_t *below = (y == height - 1 && last) ? row : row + src_stride;
+      uint16_t *out0        = dst + 2 * y * dst_stride;
+      uint16_t *out1        = out0 + dst_stride;
+
+      lq2x_pixel_rgb565(above[0], row[0], row[0],
+            (width > 1) ? row[1] : row[0], below[0], out0, out1);
+
+      for(x = 1; x + 8 < width; x += 8)
       {
-         uint16_t A, B, C, D, E, c;
-         A = *(src - prevline);
-         B = (x > 0) ? *(src - 1) : *src;
-         C = *src;
-         D = (x < width - 1) ? *(src + 1) : *src;
-         E = *(src++ + nextline);
-         c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         __m128i a    = _mm_loadu_si128((const __m128i*)(above + x));
+         __m128i b    = _mm_loadu_si128((const __m128i*)(row + x - 1));
+         __m128i c    = _mm_loadu_si128((const __m128i*)(row + x));
+         __m128i d    = _mm_loadu_si128((const __m128i*)(row + x + 1));
+         __m128i e    = _mm_loadu_si128((const __m128i*)(below + x));
+         __m128i edge = _mm_andnot_si128(_mm_or_si128(
+                  _mm_cmpeq_epi16(a, e), _mm_cmpeq_epi16(b, d)), ones);
+         __m128i ca   = _mm_add_epi16(_mm_and_si128(c, a), _mm_srli_epi16(
+                  _mm_and_si128(_mm_xor_si128(c, a), blend_mask), 1));
+         __m128i ce   = _mm_add_epi16(_mm_and_si128(c, e), _mm_srli_epi16(
+                  _mm_and_si128(_mm_xor_si128(c, e), blend_mask), 1));
+         __m128i p00  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi16(a, b)), ca, c);
+         __m128i p01  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi16(a, d)), ca, c);
+         __m128i p10  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi16(e, b)), ce, c);
+         __m128i p11  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi16(e, d)), ce, c);
+
+         _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+               _mm_unpacklo_epi16(p00, p01));
+         _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 8),
+               _mm_unpackhi_epi16(p00, p01));
+         _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+               _mm_unpacklo_epi16(p10, p11));
+         _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8),
+               _mm_unpackhi_epi16(p10, p11));
       }
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      for(; x < width; x++)
+         lq2x_pixel_rgb565(above[x], row[x - 1], row[x],
+               (x < width - 1) ? row[x + 1] : row[x],
+               below[x], out0 + (x << 1), out1 + (x << 1));
    }
 }
 
-static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
+/* Same compare-and-blend as lq2x_pixel_xrgb8888, four pixels at a
+ * time. 32-bit lanes wrap exactly like the scalar code does. */
+static void lq2x_sse2_xrgb8888(unsigned width, unsigned height,
       int first, int last, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned x, y;
-   uint32_t *out0 = (uint32_t*)dst;
-   uint32_t *out1 = (uint32_t*)(dst + dst_stride);
+   const __m128i blend_mask = _mm_set1_epi32(0x0421);
+   const __m128i ones       = _mm_set1_epi32(-1);
 
    for(y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
+      const uint32_t *row   = src + y * src_stride;
+      const uint32_t *above = (y == 0 && first) ? row : row - src_stride;
+      const uint32_t *below = (y == height - 1 && last) ? row : row + src_stride;
+      uint32_t *out0        = dst + 2 * y * dst_stride;
+      uint32_t *out1        = out0 + dst_stride;
 
-      for(x = 0; x < width; x++)
+      lq2x_pixel_xrgb8888(above[0], row[0], row[0],
+            (width > 1) ? row[1] : row[0], below[0], out0, out1);
+
+      for(x = 1; x + 4 < width; x += 4)
       {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         __m128i a    = _mm_loadu_si128((const __m128i*)(above + x));
+         __m128i b    = _mm_loadu_si128((const __m128i*)(row + x - 1));
+         __m128i c    = _mm_loadu_si128((const __m128i*)(row + x));
+         __m128i d    = _mm_loadu_si128((const __m128i*)(row + x + 1));
+         __m128i e    = _mm_loadu_si128((const __m128i*)(below + x));
+         __m128i edge = _mm_andnot_si128(_mm_or_si128(
+                  _mm_cmpeq_epi32(a, e), _mm_cmpeq_epi32(b, d)), ones);
+         __m128i ca   = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(c, a),
+                  _mm_and_si128(_mm_xor_si128(c, a), blend_mask)), 1);
+         __m128i ce   = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(c, e),
+                  _mm_and_si128(_mm_xor_si128(c, e), blend_mask)), 1);
+         __m128i p00  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi32(a, b)), ca, c);
+         __m128i p01  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi32(a, d)), ca, c);
+         __m128i p10  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi32(e, b)), ce, c);
+         __m128i p11  = lq2x_select_sse2(
+               _mm_and_si128(edge, _mm_cmpeq_epi32(e, d)), ce, c);
+
+         _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+               _mm_unpacklo_epi32(p00, p01));
+         _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 4),
+               _mm_unpackhi_epi32(p00, p01));
+         _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+               _mm_unpacklo_epi32(p10, p11));
+         _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 4),
+               _mm_unpackhi_epi32(p10, p11));
       }
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      for(; x < width; x++)
+         lq2x_pixel_xrgb8888(above[x], row[x - 1], row[x],
+               (x < width - 1) ? row[x + 1] : row[x],
+               below[x], out0 + (x << 1), out1 + (x << 1));
    }
 }
 
+static void lq2x_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr =
+      (struct softfilter_thread_data*)thread_data;
+
+   (void)data;
+
+   lq2x_sse2_rgb565(thr->width, thr->height,
+         thr->first, thr->last, (uint16_t*)thr->in_data,
+         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
+         (uint16_t*)thr->out_data,
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+}
+
+static void lq2x_work_cb_xrgb8888_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr =
+      (struct softfilter_thread_data*)thread_data;
+
+   (void)data;
+
+   lq2x_sse2_xrgb8888(thr->width, thr->height,
+         thr->first, thr->last, (uint32_t*)thr->in_data,
+         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
+         (uint32_t*)thr->out_data,
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+}
+#endif
+
 static void lq2x_work_cb_rgb565(void *data, void *thread_data)
 {
    struct softfilter_thread_data *thr =
@@ -250,7 +412,7 @@ static void lq2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
@@ -261,6 +423,15 @@ static void lq2x_generic_packets(void *data,
 #endif
       else if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
          packets[i].work = lq2x_work_cb_xrgb8888;
+#if defined(__SSE2__)
+      if (filt->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
+            packets[i].work = lq2x_work_cb_rgb565_sse2;
+         else if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
+            packets[i].work = lq2x_work_cb_xrgb8888_sse2;
+      }
+#endif
       packets[i].thread_data = thr;
    }
 }
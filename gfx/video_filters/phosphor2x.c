@@ -21,6 +21,10 @@
 #include <math.h>
 #include <retro_inline.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation phosphor2x_get_implementation
 #define softfilter_thread_data phosphor2x_softfilter_thread_data
@@ -47,6 +51,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
    float phosphor_bleed;
    float scale_add;
    float scale_times;
@@ -235,7 +240,6 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
    unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
 
-   (void)simd;
    (void)out_fmt;
    (void)max_width;
    (void)max_height;
@@ -246,8 +250,9 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers)
    {
       free(filt);
@@ -308,6 +313,54 @@ static void phosphor2x_generic_destroy(void *data)
    free(filt);
 }
 
+#if defined(__SSE2__)
+/* Scanline pass of phosphor2x_generic_xrgb8888, four pixels at a
+ * time. The per-pixel scale still comes from scan_range_8888, only
+ * the channel split, multiply and repack are vectorized. */
+static void scanlines_xrgb8888_sse2(struct filter_data *filt,
+      uint32_t *scan_out, const uint32_t *line, unsigned width)
+{
+   unsigned x;
+   const __m128i byte_mask = _mm_set1_epi32(0xff);
+
+   for (x = 0; x + 4 <= width; x += 4)
+   {
+      __m128i px    = _mm_loadu_si128((const __m128i*)(line + x));
+      __m128i red   = _mm_and_si128(_mm_srli_epi32(px, 16), byte_mask);
+      __m128i green = _mm_and_si128(_mm_srli_epi32(px,  8), byte_mask);
+      __m128i blue  = _mm_and_si128(px, byte_mask);
+      /* Channels fit in the low 16 bits of each lane. */
+      __m128i max   = _mm_max_epi16(red, _mm_max_epi16(green, blue));
+      uint32_t idx[4];
+      __m128 scale;
+
+      _mm_storeu_si128((__m128i*)idx, max);
+      scale = _mm_set_ps(
+            filt->scan_range_8888[idx[3]], filt->scan_range_8888[idx[2]],
+            filt->scan_range_8888[idx[1]], filt->scan_range_8888[idx[0]]);
+
+      red   = _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_cvtepi32_ps(red)));
+      green = _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_cvtepi32_ps(green)));
+      blue  = _mm_cvttps_epi32(_mm_mul_ps(scale, _mm_cvtepi32_ps(blue)));
+
+      _mm_storeu_si128((__m128i*)(scan_out + x), _mm_or_si128(
+               _mm_or_si128(_mm_slli_epi32(red, 16),
+                  _mm_slli_epi32(green, 8)), blue));
+   }
+
+   for (; x < width; x++)
+   {
+      unsigned max = max_component_xrgb8888(line[x]);
+      float scale  = filt->scan_range_8888[max];
+
+      scan_out[x]  =
+           ((uint32_t)(scale * red_xrgb8888(line[x]))   << 16)
+         | ((uint32_t)(scale * green_xrgb8888(line[x])) <<  8)
+         |  (uint32_t)(scale * blue_xrgb8888(line[x]));
+   }
+}
+#endif
+
 static void phosphor2x_generic_xrgb8888(void *data,
       unsigned width, unsigned height,
       int first, int last, uint32_t *src,
@@ -340,6 +393,14 @@ static void phosphor2x_generic_xrgb8888(void *data,
 
       scan_out = (uint32_t*)out_line + (dst_stride);
 
+#if defined(__SSE2__)
+      if (filt->simd & SOFTFILTER_SIMD_SSE2)
+      {
+         scanlines_xrgb8888_sse2(filt, scan_out, out_line, width << 1);
+         continue;
+      }
+#endif
+
       for (x = 0; x < (width << 1); x++)
       {
          unsigned max = max_component_xrgb8888(out_line[x]);
@@ -457,7 +518,7 @@ static void phosphor2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
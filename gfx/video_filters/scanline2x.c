@@ -20,6 +20,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scanline2x_get_implementation
 #define softfilter_thread_data scanline2x_softfilter_thread_data
@@ -44,6 +48,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned scanline2x_generic_input_fmts(void)
@@ -68,18 +73,18 @@ static void *scanline2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
    if (!filt) {
       return NULL;
    }
-   /* Apparently the code is not thread-safe,
-    * so force single threaded operation... */
-   filt->workers = (struct softfilter_thread_data*)calloc(1, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   /* Every output row only depends on its own input row,
+    * so any split of the frame into row bands is safe. */
+   filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    if (!filt->workers) {
       free(filt);
       return NULL;
@@ -194,32 +199,153 @@ static void scanline2x_work_cb_rgb565(void *data, void *thread_data)
    }
 }
 
+#if defined(__SSE2__)
+/* (c >> 1) + (c >> 2) per channel, done on whole pixels by masking
+ * off the bits that shift in from the neighbouring channel. */
+static void scanline2x_work_cb_xrgb8888_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input = (const uint32_t*)thr->in_data;
+   uint32_t *output = (uint32_t*)thr->out_data;
+   unsigned in_stride = (unsigned)(thr->in_pitch >> 2);
+   unsigned out_stride = (unsigned)(thr->out_pitch >> 2);
+   const __m128i mask_half = _mm_set1_epi32(0x7F7F7F7F);
+   const __m128i mask_quarter = _mm_set1_epi32(0x3F3F3F3F);
+   unsigned x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      uint32_t *out_ptr = output;
+
+      for (x = 0; x + 4 <= thr->width; x += 4)
+      {
+         __m128i color    = _mm_loadu_si128((const __m128i*)(input + x));
+         __m128i scanline = _mm_add_epi32(
+               _mm_and_si128(_mm_srli_epi32(color, 1), mask_half),
+               _mm_and_si128(_mm_srli_epi32(color, 2), mask_quarter));
+
+         _mm_storeu_si128((__m128i*)(out_ptr),
+               _mm_unpacklo_epi32(color, color));
+         _mm_storeu_si128((__m128i*)(out_ptr + 4),
+               _mm_unpackhi_epi32(color, color));
+         _mm_storeu_si128((__m128i*)(out_ptr + out_stride),
+               _mm_unpacklo_epi32(scanline, scanline));
+         _mm_storeu_si128((__m128i*)(out_ptr + out_stride + 4),
+               _mm_unpackhi_epi32(scanline, scanline));
+
+         out_ptr += 8;
+      }
+
+      for (; x < thr->width; ++x)
+      {
+         uint32_t color          = *(input + x);
+         uint32_t scanline_color =
+               ((color >> 1) & 0x7F7F7F7F) + ((color >> 2) & 0x3F3F3F3F);
+
+         out_ptr[0]              = color;
+         out_ptr[1]              = color;
+         out_ptr[out_stride]     = scanline_color;
+         out_ptr[out_stride + 1] = scanline_color;
+
+         out_ptr += 2;
+      }
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+
+static void scanline2x_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input = (const uint16_t*)thr->in_data;
+   uint16_t *output = (uint16_t*)thr->out_data;
+   unsigned in_stride = (unsigned)(thr->in_pitch >> 1);
+   unsigned out_stride = (unsigned)(thr->out_pitch >> 1);
+   const __m128i mask_half = _mm_set1_epi16(0x7BCF);
+   const __m128i mask_quarter = _mm_set1_epi16(0x39C7);
+   unsigned x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      uint16_t *out_ptr = output;
+
+      for (x = 0; x + 8 <= thr->width; x += 8)
+      {
+         __m128i color    = _mm_loadu_si128((const __m128i*)(input + x));
+         __m128i scanline = _mm_add_epi16(
+               _mm_and_si128(_mm_srli_epi16(color, 1), mask_half),
+               _mm_and_si128(_mm_srli_epi16(color, 2), mask_quarter));
+
+         _mm_storeu_si128((__m128i*)(out_ptr),
+               _mm_unpacklo_epi16(color, color));
+         _mm_storeu_si128((__m128i*)(out_ptr + 8),
+               _mm_unpackhi_epi16(color, color));
+         _mm_storeu_si128((__m128i*)(out_ptr + out_stride),
+               _mm_unpacklo_epi16(scanline, scanline));
+         _mm_storeu_si128((__m128i*)(out_ptr + out_stride + 8),
+               _mm_unpackhi_epi16(scanline, scanline));
+
+         out_ptr += 16;
+      }
+
+      for (; x < thr->width; ++x)
+      {
+         uint16_t color          = *(input + x);
+         uint16_t scanline_color =
+               ((color >> 1) & 0x7BCF) + ((color >> 2) & 0x39C7);
+
+         out_ptr[0]              = color;
+         out_ptr[1]              = color;
+         out_ptr[out_stride]     = scanline_color;
+         out_ptr[out_stride + 1] = scanline_color;
+
+         out_ptr += 2;
+      }
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+#endif
+
 static void scanline2x_generic_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   /* We are guaranteed single threaded operation
-    * (filt->threads = 1) so we don't need to loop
-    * over threads and can cull some code. This only
-    * makes the tiniest performance difference, but
-    * every little helps when running on an o3DS... */
    struct filter_data *filt = (struct filter_data*)data;
-   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[0];
-
-   thr->out_data = (uint8_t*)output;
-   thr->in_data = (const uint8_t*)input;
-   thr->out_pitch = output_stride;
-   thr->in_pitch = input_stride;
-   thr->width = width;
-   thr->height = height;
-
-   if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = scanline2x_work_cb_xrgb8888;
-   } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = scanline2x_work_cb_rgb565;
+   unsigned i;
+
+   for (i = 0; i < filt->threads; i++)
+   {
+      struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[i];
+      unsigned y_start = (height * i) / filt->threads;
+      unsigned y_end = (height * (i + 1)) / filt->threads;
+
+      thr->out_data = (uint8_t*)output + y_start * 2 * output_stride;
+      thr->in_data = (const uint8_t*)input + y_start * input_stride;
+      thr->out_pitch = output_stride;
+      thr->in_pitch = input_stride;
+      thr->width = width;
+      thr->height = y_end - y_start;
+
+      if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
+         packets[i].work = scanline2x_work_cb_xrgb8888;
+      } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
+         packets[i].work = scanline2x_work_cb_rgb565;
+      }
+#if defined(__SSE2__)
+      if (filt->simd & SOFTFILTER_SIMD_SSE2) {
+         if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
+            packets[i].work = scanline2x_work_cb_xrgb8888_sse2;
+         } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
+            packets[i].work = scanline2x_work_cb_rgb565_sse2;
+         }
+      }
+#endif
+      packets[i].thread_data = thr;
    }
-   packets[0].thread_data = thr;
 }
 
 static const struct softfilter_implementation scanline2x_generic = {
@@ -116,7 +116,11 @@ typedef unsigned (*softfilter_query_input_formats_t)(void);
 typedef unsigned (*softfilter_query_output_formats_t)(unsigned input_format);
 
 /* In softfilter_process_t, the softfilter implementation
- * submits work units to a worker thread pool. */
+ * submits work units to a worker thread pool.
+ *
+ * Packets are scheduled on a shared work-stealing pool, so they
+ * may run in any order and on any thread. Each packet must only
+ * write its own part of the output. */
 typedef void (*softfilter_work_t)(void *data, void *thread_data);
 struct softfilter_work_packet
 {
@@ -128,7 +132,13 @@ struct softfilter_work_packet
  * maximum possible input size.
  *
  * Input sizes can very per call to softfilter_process_t, but they
- * will never be larger than the maximum. */
+ * will never be larger than the maximum.
+ *
+ * threads is the number of work packets the frontend would like the
+ * frame to be split into. It is usually a multiple of the actual
+ * worker count, so smaller row tiles can be balanced between threads.
+ *
+ * simd is the mask of CPU features the filter may use. */
 typedef void *(*softfilter_create_t)(const struct softfilter_config *config,
       unsigned in_fmt, unsigned out_fmt,
       unsigned max_width, unsigned max_height,
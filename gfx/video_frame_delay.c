@@ -0,0 +1,116 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "video_frame_delay.h"
+
+static int video_frame_delay_auto_compare(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+static retro_time_t video_frame_delay_auto_percentile(
+      const video_frame_delay_auto_t *fd)
+{
+   retro_time_t sorted[VIDEO_FRAME_DELAY_AUTO_WINDOW];
+   unsigned count = fd->window_count;
+   unsigned index = (count * VIDEO_FRAME_DELAY_AUTO_PERCENTILE) / 100;
+
+   memcpy(sorted, fd->window, count * sizeof(*sorted));
+   qsort(sorted, count, sizeof(*sorted), video_frame_delay_auto_compare);
+
+   if (index >= count)
+      index = count - 1;
+
+   return sorted[index];
+}
+
+void video_frame_delay_auto_init(video_frame_delay_auto_t *fd,
+      unsigned delay_max)
+{
+   memset(fd, 0, sizeof(*fd));
+   fd->delay_max = delay_max;
+   /* Start conservatively and only ramp up once
+    * a full window of measurements is available */
+   fd->hold      = VIDEO_FRAME_DELAY_AUTO_WINDOW;
+}
+
+void video_frame_delay_auto_set_max(video_frame_delay_auto_t *fd,
+      unsigned delay_max)
+{
+   fd->delay_max = delay_max;
+   if (fd->delay > delay_max)
+      fd->delay  = delay_max;
+}
+
+unsigned video_frame_delay_auto_update(video_frame_delay_auto_t *fd,
+      retro_time_t frame_time, retro_time_t work_time,
+      retro_time_t frame_interval)
+{
+   retro_time_t budget, work;
+   unsigned target;
+
+   if (frame_time <= 0)
+      return fd->delay;
+
+   if (work_time < 0)
+      work_time = 0;
+
+   fd->window[fd->window_index] = work_time;
+   fd->window_index             = (fd->window_index + 1)
+      % VIDEO_FRAME_DELAY_AUTO_WINDOW;
+   if (fd->window_count < VIDEO_FRAME_DELAY_AUTO_WINDOW)
+      fd->window_count++;
+
+   fd->frames++;
+   fd->work_percentile = video_frame_delay_auto_percentile(fd);
+
+   /* React to a heavier frame right away instead of waiting
+    * for it to show up in the percentile */
+   work   = (work_time > fd->work_percentile) ? work_time : fd->work_percentile;
+   budget = frame_time - work - VIDEO_FRAME_DELAY_AUTO_MARGIN;
+   target = (budget > 0) ? (unsigned)(budget / 1000) : 0;
+   if (target > fd->delay_max)
+      target = fd->delay_max;
+
+   if (fd->hold)
+      fd->hold--;
+
+   /* A frame that took between 1.5 and 4 periods missed its
+    * deadline; anything longer is a pause, a menu visit or
+    * content loading, and says nothing about the delay. */
+   if (     frame_interval > (frame_time * 3) / 2
+         && frame_interval < frame_time * 4)
+   {
+      fd->misses++;
+      fd->delay = (fd->delay > 2) ? fd->delay - 2 : 0;
+      fd->hold  = VIDEO_FRAME_DELAY_AUTO_MISS_HOLD;
+   }
+
+   if (target < fd->delay)
+      fd->delay = target;
+   else if (target > fd->delay && !fd->hold)
+   {
+      fd->delay++;
+      fd->hold = VIDEO_FRAME_DELAY_AUTO_RAISE_HOLD;
+   }
+
+   return fd->delay;
+}
@@ -0,0 +1,109 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_FRAME_DELAY_H__
+#define __VIDEO_FRAME_DELAY_H__
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Number of frames of work time kept for the rolling percentile */
+#define VIDEO_FRAME_DELAY_AUTO_WINDOW     128
+/* Percentile of the work time the delay is sized for */
+#define VIDEO_FRAME_DELAY_AUTO_PERCENTILE 95
+/* Time (usec) left between the end of the frame's work
+ * and the deadline */
+#define VIDEO_FRAME_DELAY_AUTO_MARGIN     2000
+/* Frames to wait before raising the delay by 1 ms */
+#define VIDEO_FRAME_DELAY_AUTO_RAISE_HOLD 30
+/* Frames to wait before raising the delay again after a miss */
+#define VIDEO_FRAME_DELAY_AUTO_MISS_HOLD  300
+
+typedef struct video_frame_delay_auto
+{
+   retro_time_t window[VIDEO_FRAME_DELAY_AUTO_WINDOW];
+   retro_time_t work_percentile;
+
+   uint64_t frames;
+   uint64_t misses;
+
+   unsigned window_count;
+   unsigned window_index;
+   /* Frames left until the delay may be raised again */
+   unsigned hold;
+   /* Current delay (ms) */
+   unsigned delay;
+   unsigned delay_max;
+} video_frame_delay_auto_t;
+
+/**
+ * video_frame_delay_auto_init:
+ * @fd                 : Controller state.
+ * @delay_max          : Upper bound of the delay in ms.
+ *
+ * Resets the adaptive frame delay controller.
+ **/
+void video_frame_delay_auto_init(video_frame_delay_auto_t *fd,
+      unsigned delay_max);
+
+/**
+ * video_frame_delay_auto_set_max:
+ * @fd                 : Controller state.
+ * @delay_max          : Upper bound of the delay in ms.
+ *
+ * Changes the upper bound without resetting the controller. A
+ * current delay above it is lowered right away; a higher bound is
+ * ramped up to as usual.
+ **/
+void video_frame_delay_auto_set_max(video_frame_delay_auto_t *fd,
+      unsigned delay_max);
+
+/**
+ * video_frame_delay_auto_update:
+ * @fd                 : Controller state.
+ * @frame_time         : Target frame period (usec).
+ * @work_time          : Time spent running the core and submitting
+ *                       the frame, excluding the frame delay itself
+ *                       and any wait for VSync (usec). The frontend
+ *                       times the wait around the context driver's
+ *                       buffer swap; for video drivers that do not
+ *                       swap through video_driver_swap_buffers(), it
+ *                       leaves out their whole frame call instead.
+ * @frame_interval     : Time since the previous frame started, or 0
+ *                       if unknown (usec). Used to detect missed
+ *                       frames.
+ *
+ * Feeds one frame worth of measurements into the controller. The
+ * delay is chosen so that the configured percentile of recent
+ * frames would still finish VIDEO_FRAME_DELAY_AUTO_MARGIN before
+ * the deadline. It drops immediately when frames get heavier and
+ * backs off further on every missed frame, but is only raised
+ * slowly. Deterministic for a given sequence of inputs.
+ *
+ * Returns: delay (ms) to use for the next frame.
+ **/
+unsigned video_frame_delay_auto_update(video_frame_delay_auto_t *fd,
+      retro_time_t frame_time, retro_time_t work_time,
+      retro_time_t frame_interval);
+
+RETRO_END_DECLS
+
+#endif
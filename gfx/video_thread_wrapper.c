@@ -27,6 +27,7 @@
 #include "video_thread_wrapper.h"
 #include "font_driver.h"
 
+#include "../performance_trace.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
 
@@ -563,6 +564,8 @@ static void video_thread_loop(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
 
+   performance_trace_set_thread_name("video");
+
    for (;;)
    {
       thread_packet_t pkt;
@@ -581,7 +584,10 @@ static void video_thread_loop(void *data)
       slock_unlock(thr->lock);
 
       if (video_thread_handle_packet(thr, &pkt))
+      {
+         performance_trace_thread_exit();
          return;
+      }
 
       if (updated)
       {
@@ -605,15 +611,18 @@ static void video_thread_loop(void *data)
          if (thr->driver && thr->driver->frame)
          {
             video_frame_info_t video_info;
+            retro_perf_tick_t trace_start;
             /* TODO/FIXME - not thread-safe - should get 
              * rid of this */
             video_driver_build_info(&video_info);
 
+            performance_trace_scope_begin(trace_start);
             ret = thr->driver->frame(thr->driver_data,
                   thr->frame.buffer, thr->frame.width, thr->frame.height,
                   thr->frame.count,
                   thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL,
                   &video_info);
+            performance_trace_scope_end(trace_start, "video_thread_frame");
          }
 
          slock_unlock(thr->frame.lock);
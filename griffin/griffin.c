@@ -161,7 +161,11 @@ CONFIG FILE
 CONTENT METADATA RECORDS
 ============================================================ */
 #include "../runtime_file.c"
+#include "../runtime_store.c"
 #include "../disk_index_file.c"
+#include "../content_fingerprint.c"
+#include "../benchmark.c"
+#include "../performance_trace.c"
 
 /*============================================================
 ACHIEVEMENTS
@@ -341,6 +345,7 @@ VIDEO SHADERS
 
 #ifdef HAVE_SLANG
 #include "../gfx/drivers_shader/glslang_util.c"
+#include "../gfx/drivers_shader/slang_cache.c"
 #endif
 
 #ifdef HAVE_CG
@@ -738,6 +743,9 @@ INPUT
 
 #if defined(__linux__) && !defined(ANDROID)
 #include "../input/common/linux_common.c"
+#ifdef HAVE_THREADS
+#include "../input/common/linux_input_thread.c"
+#endif
 #include "../input/drivers/linuxraw_input.c"
 #include "../input/drivers_joypad/linuxraw_joypad.c"
 #endif
@@ -803,6 +811,7 @@ INPUT (HID)
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_queue.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -815,6 +824,7 @@ AUDIO RESAMPLER
 #ifdef HAVE_CC_RESAMPLER
 #include "../audio/drivers_resampler/cc_resampler.c"
 #endif
+#include "../audio/audio_pipeline.c"
 
 /*============================================================
 CAMERA
@@ -940,6 +950,7 @@ MIDI
 DRIVERS
 ============================================================ */
 #include "../gfx/video_crt_switch.c"
+#include "../gfx/video_frame_delay.c"
 #include "../gfx/gfx_animation.c"
 #include "../gfx/gfx_display.c"
 #include "../gfx/gfx_thumbnail_path.c"
@@ -1022,6 +1033,7 @@ FILE
 #include "../file_path_special.c"
 #include "../file_path_str.c"
 #include "../libretro-common/lists/dir_list.c"
+#include "../libretro-common/lists/dir_walk.c"
 #include "../libretro-common/lists/string_list.c"
 #include "../libretro-common/lists/file_list.c"
 #include "../libretro-common/file/retro_dirent.c"
@@ -1252,6 +1264,9 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_udp.c"
+#include "../network/netplay/netplay_savestate.c"
+#include "../network/netplay/netplay_broadcast.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -1348,8 +1363,10 @@ MENU
 #include "../menu/cbs/menu_cbs_up.c"
 #include "../menu/cbs/menu_cbs_down.c"
 #include "../menu/cbs/menu_cbs_contentlist_switch.c"
+#include "../menu/menu_virtual_list.c"
 #include "../menu/menu_displaylist.c"
 #ifdef HAVE_LIBRETRODB
+#include "../menu/menu_explore_index.c"
 #include "../menu/menu_explore.c"
 #endif
 #endif
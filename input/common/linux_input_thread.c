@@ -0,0 +1,248 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rthreads/rthreads.h>
+#include <retro_inline.h>
+
+#include "linux_input_thread.h"
+
+#include "../../verbosity.h"
+
+/* Must be a power of two */
+#define LINUX_INPUT_THREAD_QUEUE_SIZE 1024
+#define LINUX_INPUT_THREAD_TIMEOUT_MS 4
+#define LINUX_INPUT_THREAD_CACHELINE  64
+
+struct linux_input_thread
+{
+   linux_input_thread_event_t queue[LINUX_INPUT_THREAD_QUEUE_SIZE];
+
+   /* Producer and consumer indices live on separate cache
+    * lines so the input thread and the poller don't keep
+    * invalidating each other. Both only ever increase. */
+   size_t head;
+   uint8_t pad_head[LINUX_INPUT_THREAD_CACHELINE - sizeof(size_t)];
+   size_t tail;
+   uint8_t pad_tail[LINUX_INPUT_THREAD_CACHELINE - sizeof(size_t)];
+
+   linux_input_thread_stats_t stats;
+
+   linux_input_thread_wait_t wait_cb;
+   void *data;
+
+   sthread_t *thread;
+   bool alive;
+};
+
+static INLINE size_t linux_input_thread_load(const size_t *ptr)
+{
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static INLINE void linux_input_thread_store(size_t *ptr, size_t val)
+{
+   __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+static void linux_input_thread_loop(void *data)
+{
+   linux_input_thread_t *thread = (linux_input_thread_t*)data;
+
+   while (__atomic_load_n(&thread->alive, __ATOMIC_ACQUIRE))
+      thread->wait_cb(thread->data, thread,
+            LINUX_INPUT_THREAD_TIMEOUT_MS);
+}
+
+linux_input_thread_t *linux_input_thread_new(
+      linux_input_thread_wait_t wait_cb, void *data, bool start)
+{
+   linux_input_thread_t *thread = (linux_input_thread_t*)
+      calloc(1, sizeof(*thread));
+
+   if (!thread)
+      return NULL;
+
+   thread->wait_cb = wait_cb;
+   thread->data    = data;
+
+   if (start && wait_cb)
+   {
+      thread->alive  = true;
+      thread->thread = sthread_create(linux_input_thread_loop, thread);
+
+      if (!thread->thread)
+      {
+         free(thread);
+         return NULL;
+      }
+   }
+
+   return thread;
+}
+
+void linux_input_thread_free(linux_input_thread_t *thread)
+{
+   if (!thread)
+      return;
+
+   if (thread->thread)
+   {
+      __atomic_store_n(&thread->alive, false, __ATOMIC_RELEASE);
+      sthread_join(thread->thread);
+   }
+
+   free(thread);
+}
+
+bool linux_input_thread_push(linux_input_thread_t *thread,
+      void *userdata, retro_time_t time,
+      uint16_t type, uint16_t code, int32_t value)
+{
+   linux_input_thread_event_t *event = NULL;
+   size_t head                       = thread->head;
+   size_t tail                       = linux_input_thread_load(&thread->tail);
+
+   if (head - tail >= LINUX_INPUT_THREAD_QUEUE_SIZE)
+   {
+      __atomic_add_fetch(&thread->stats.dropped, 1, __ATOMIC_RELAXED);
+      return false;
+   }
+
+   event           = &thread->queue[head & (LINUX_INPUT_THREAD_QUEUE_SIZE - 1)];
+   event->time     = time;
+   event->userdata = userdata;
+   event->type     = type;
+   event->code     = code;
+   event->value    = value;
+
+   linux_input_thread_store(&thread->head, head + 1);
+   return true;
+}
+
+static unsigned linux_input_thread_bucket(retro_time_t latency)
+{
+   unsigned bucket = 0;
+
+   while (latency > 0 && bucket < LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS - 1)
+   {
+      latency >>= 1;
+      bucket++;
+   }
+
+   return bucket;
+}
+
+size_t linux_input_thread_drain(linux_input_thread_t *thread,
+      retro_time_t now, linux_input_thread_event_cb_t cb, void *data)
+{
+   size_t count                       = 0;
+   size_t tail                        = thread->tail;
+   size_t head                        = linux_input_thread_load(&thread->head);
+   linux_input_thread_stats_t *stats  = &thread->stats;
+
+   stats->polls++;
+
+   for (; tail != head; tail++, count++)
+   {
+      const linux_input_thread_event_t *event =
+         &thread->queue[tail & (LINUX_INPUT_THREAD_QUEUE_SIZE - 1)];
+      retro_time_t latency = now - event->time;
+
+      /* Events stamped by the kernel can be marginally ahead of
+       * a clock sampled just before the drain started */
+      if (latency < 0)
+         latency = 0;
+
+      stats->events++;
+      stats->latency_total += latency;
+      if (latency > stats->latency_max)
+         stats->latency_max = latency;
+      stats->histogram[linux_input_thread_bucket(latency)]++;
+
+      cb(data, event);
+
+      /* Release the slot only once the callback is done with it */
+      linux_input_thread_store(&thread->tail, tail + 1);
+   }
+
+   return count;
+}
+
+void linux_input_thread_get_stats(linux_input_thread_t *thread,
+      linux_input_thread_stats_t *stats)
+{
+   memcpy(stats, &thread->stats, sizeof(*stats));
+   stats->dropped = __atomic_load_n(&thread->stats.dropped, __ATOMIC_RELAXED);
+}
+
+retro_time_t linux_input_thread_latency_percentile(
+      const linux_input_thread_stats_t *stats, unsigned percentile)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t target = 0;
+
+   if (!stats->events)
+      return 0;
+
+   if (percentile > 100)
+      percentile = 100;
+
+   target = (stats->events * percentile + 99) / 100;
+
+   for (i = 0; i < LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS; i++)
+   {
+      seen += stats->histogram[i];
+      if (seen >= target && seen > 0)
+      {
+         if (i == LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS - 1)
+            return stats->latency_max;
+         return ((retro_time_t)1 << i) - 1;
+      }
+   }
+
+   return stats->latency_max;
+}
+
+void linux_input_thread_log_stats(linux_input_thread_t *thread,
+      const char *ident)
+{
+   linux_input_thread_stats_t stats;
+
+   if (!thread)
+      return;
+
+   linux_input_thread_get_stats(thread, &stats);
+
+   if (!stats.events)
+      return;
+
+   RARCH_LOG("[%s]: Input thread: %llu events over %llu polls, %llu dropped.\n",
+         ident,
+         (unsigned long long)stats.events,
+         (unsigned long long)stats.polls,
+         (unsigned long long)stats.dropped);
+   RARCH_LOG("[%s]: Event-to-poll latency: avg %lld usec, "
+         "p50 < %lld usec, p99 < %lld usec, max %lld usec.\n",
+         ident,
+         (long long)(stats.latency_total / (retro_time_t)stats.events),
+         (long long)linux_input_thread_latency_percentile(&stats, 50),
+         (long long)linux_input_thread_latency_percentile(&stats, 99),
+         (long long)stats.latency_max);
+}
@@ -0,0 +1,135 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LINUX_INPUT_THREAD_H
+#define _LINUX_INPUT_THREAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Number of log2 buckets (in microseconds) used for the
+ * event-to-poll latency histogram. Bucket N holds latencies
+ * in the range [2^(N-1), 2^N) usec, the last bucket holds
+ * everything above. */
+#define LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS 20
+
+typedef struct linux_input_thread linux_input_thread_t;
+
+typedef struct linux_input_thread_event
+{
+   /* Monotonic timestamp (usec) at which the event was
+    * generated, comparable with cpu_features_get_time_usec() */
+   retro_time_t time;
+   /* Driver specific source of the event (device, etc.) */
+   void *userdata;
+   uint16_t type;
+   uint16_t code;
+   int32_t value;
+} linux_input_thread_event_t;
+
+typedef struct linux_input_thread_stats
+{
+   uint64_t events;
+   uint64_t dropped;
+   uint64_t polls;
+   retro_time_t latency_total;
+   retro_time_t latency_max;
+   uint64_t histogram[LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS];
+} linux_input_thread_stats_t;
+
+/* Runs on the input thread. Must block for at most 'timeout_ms'
+ * waiting for input, and hand everything it read over through
+ * linux_input_thread_push(). */
+typedef void (*linux_input_thread_wait_t)(void *data,
+      linux_input_thread_t *thread, int timeout_ms);
+
+/* Runs on the polling thread for every queued event. */
+typedef void (*linux_input_thread_event_cb_t)(void *data,
+      const linux_input_thread_event_t *event);
+
+/**
+ * linux_input_thread_new:
+ * @wait_cb              : Callback reading events on the input thread.
+ * @data                 : Userdata passed to @wait_cb.
+ * @start                : Start the input thread. When false, events
+ *                         have to be pushed by the caller (used to
+ *                         replay recorded traces deterministically).
+ *
+ * Creates a single producer/single consumer queue of timestamped
+ * input events, optionally fed by a dedicated thread that drains
+ * the input devices continuously.
+ *
+ * Returns: new input thread handle on success, otherwise NULL.
+ **/
+linux_input_thread_t *linux_input_thread_new(
+      linux_input_thread_wait_t wait_cb, void *data, bool start);
+
+void linux_input_thread_free(linux_input_thread_t *thread);
+
+/**
+ * linux_input_thread_push:
+ *
+ * Queues an event. Must only be called from a single producer
+ * (the input thread itself, or the caller when the thread was
+ * not started).
+ *
+ * Returns: false if the queue was full and the event was dropped.
+ **/
+bool linux_input_thread_push(linux_input_thread_t *thread,
+      void *userdata, retro_time_t time,
+      uint16_t type, uint16_t code, int32_t value);
+
+/**
+ * linux_input_thread_drain:
+ * @thread               : Input thread handle.
+ * @now                  : Time of the poll, used for latency accounting.
+ * @cb                   : Called for every event queued up to now.
+ * @data                 : Userdata passed to @cb.
+ *
+ * Consumes every event queued so far, in order. Meant to be called
+ * from the input driver's poll function, so that events arriving up
+ * to the point where the core actually polls are folded in.
+ *
+ * Returns: number of events consumed.
+ **/
+size_t linux_input_thread_drain(linux_input_thread_t *thread,
+      retro_time_t now, linux_input_thread_event_cb_t cb, void *data);
+
+void linux_input_thread_get_stats(linux_input_thread_t *thread,
+      linux_input_thread_stats_t *stats);
+
+/**
+ * linux_input_thread_latency_percentile:
+ *
+ * Returns: approximated event-to-poll latency (usec) below which
+ * @percentile (0-100) of the events fall, using the upper bound
+ * of the matching histogram bucket.
+ **/
+retro_time_t linux_input_thread_latency_percentile(
+      const linux_input_thread_stats_t *stats, unsigned percentile);
+
+void linux_input_thread_log_stats(linux_input_thread_t *thread,
+      const char *ident);
+
+RETRO_END_DECLS
+
+#endif
@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <sys/ioctl.h>
 #include <linux/input.h>
@@ -24,10 +25,19 @@
 #include <signal.h>
 
 #include <boolean.h>
+#include <features/features_cpu.h>
 
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../../configuration.h"
 #include "../../verbosity.h"
 
 #include "../common/linux_common.h"
+#ifdef HAVE_THREADS
+#include "../common/linux_input_thread.h"
+#endif
 
 #include "../input_keymaps.h"
 #include "../input_driver.h"
@@ -38,12 +48,68 @@
 typedef struct linuxraw_input
 {
    const input_device_driver_t *joypad;
+#ifdef HAVE_THREADS
+   linux_input_thread_t *thread;
+#endif
    bool state[0x80];
 } linuxraw_input_t;
 
+static void linuxraw_input_handle_scancode(linuxraw_input_t *linuxraw,
+      uint8_t c)
+{
+   bool pressed;
+
+   if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
+      kill(getpid(), SIGINT);
+
+   pressed = !(c & 0x80);
+   c &= ~0x80;
+
+   linuxraw->state[c] = pressed;
+}
+
+#ifdef HAVE_THREADS
+static void linuxraw_input_thread_dispatch(void *data,
+      const linux_input_thread_event_t *event)
+{
+   linuxraw_input_handle_scancode((linuxraw_input_t*)data,
+         (uint8_t)event->code);
+}
+
+/* Runs on the input thread */
+static void linuxraw_input_thread_wait(void *data,
+      linux_input_thread_t *thread, int timeout_ms)
+{
+   uint8_t c;
+   struct pollfd fds;
+
+   fds.fd      = STDIN_FILENO;
+   fds.events  = POLLIN;
+   fds.revents = 0;
+
+   if (poll(&fds, 1, timeout_ms) <= 0 || !(fds.revents & POLLIN))
+      return;
+
+   while (read(STDIN_FILENO, &c, 1) > 0)
+   {
+      uint16_t t;
+
+      /* ignore extended scancodes */
+      if (!(c & ~0x80))
+         read(STDIN_FILENO, &t, 2);
+      else
+         linux_input_thread_push(thread, NULL,
+               cpu_features_get_time_usec(), EV_KEY, c, !(c & 0x80));
+   }
+}
+#endif
+
 static void *linuxraw_input_init(const char *joypad_driver)
 {
    linuxraw_input_t *linuxraw  = NULL;
+#ifdef HAVE_THREADS
+   settings_t *settings        = config_get_ptr();
+#endif
 
    /* Only work on terminals. */
    if (!isatty(0))
@@ -71,6 +137,18 @@ static void *linuxraw_input_init(const char *joypad_driver)
 
    linux_terminal_claim_stdin();
 
+#ifdef HAVE_THREADS
+   if (settings->bools.input_threaded)
+   {
+      linuxraw->thread = linux_input_thread_new(
+            linuxraw_input_thread_wait, linuxraw, true);
+      if (linuxraw->thread)
+         RARCH_LOG("[linuxraw]: Reading keyboard on a dedicated thread.\n");
+      else
+         RARCH_WARN("[linuxraw]: Failed to start input thread, polling synchronously.\n");
+   }
+#endif
+
    return linuxraw;
 }
 
@@ -176,6 +254,14 @@ static void linuxraw_input_free(void *data)
    if (linuxraw->joypad)
       linuxraw->joypad->destroy();
 
+#ifdef HAVE_THREADS
+   if (linuxraw->thread)
+   {
+      linux_input_thread_log_stats(linuxraw->thread, "linuxraw");
+      linux_input_thread_free(linuxraw->thread);
+   }
+#endif
+
    linux_terminal_restore_input();
    free(data);
 }
@@ -202,22 +288,29 @@ static void linuxraw_input_poll(void *data)
    uint8_t c;
    linuxraw_input_t *linuxraw = (linuxraw_input_t*)data;
 
-   while (read(STDIN_FILENO, &c, 1) > 0)
+#ifdef HAVE_THREADS
+   if (linuxraw->thread)
    {
-      bool pressed;
-      uint16_t t;
+      /* Fold in everything the input thread read up to now */
+      linux_input_thread_drain(linuxraw->thread,
+            cpu_features_get_time_usec(),
+            linuxraw_input_thread_dispatch, linuxraw);
 
-      if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
-         kill(getpid(), SIGINT);
+      if (linuxraw->joypad)
+         linuxraw->joypad->poll();
+      return;
+   }
+#endif
 
-      pressed = !(c & 0x80);
-      c &= ~0x80;
+   while (read(STDIN_FILENO, &c, 1) > 0)
+   {
+      uint16_t t;
 
       /* ignore extended scancodes */
-      if (!c)
+      if (!(c & ~0x80))
          read(STDIN_FILENO, &t, 2);
       else
-         linuxraw->state[c] = pressed;
+         linuxraw_input_handle_scancode(linuxraw, c);
    }
 
    if (linuxraw->joypad)
@@ -36,6 +36,7 @@
 
 #include <limits.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -65,11 +66,18 @@
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 
 #include "../input_keymaps.h"
 
 #include "../common/linux_common.h"
 
+#if defined(HAVE_THREADS) && defined(HAVE_EPOLL)
+#define UDEV_INPUT_THREAD
+#include <rthreads/rthreads.h>
+#include "../common/linux_input_thread.h"
+#endif
+
 #include "../../configuration.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
@@ -80,6 +88,12 @@
 
 #define UDEV_MAX_KEYS (KEY_MAX + 7) / 8
 
+/* Older kernel headers don't have the y2038-safe accessors */
+#ifndef input_event_sec
+#define input_event_sec  time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
 typedef struct udev_input udev_input_t;
 
 typedef struct udev_input_device udev_input_device_t;
@@ -120,6 +134,8 @@ struct udev_input_device
          const struct input_event *event, udev_input_device_t *dev);
    char devnode[PATH_MAX_LENGTH];
    enum udev_input_dev_type type;
+   /* Event timestamps use CLOCK_MONOTONIC */
+   bool monotonic;
 
    udev_input_mouse_t mouse;
 };
@@ -145,6 +161,15 @@ struct udev_input
    /* OS pointer coords (zeros if we don't have X11) */
    int pointer_x;
    int pointer_y;
+
+#ifdef UDEV_INPUT_THREAD
+   /* Reads the devices continuously when input_threaded
+    * is enabled. devices_lock protects the device list
+    * against hotplug while the thread reads from it. */
+   linux_input_thread_t *thread;
+   slock_t *devices_lock;
+   bool threaded;
+#endif
 };
 
 #ifdef UDEV_XKB_HANDLING
@@ -472,6 +497,82 @@ static void udev_handle_mouse(void *data,
    }
 }
 
+#ifdef UDEV_INPUT_THREAD
+static void udev_input_thread_dispatch(void *data,
+      const linux_input_thread_event_t *event)
+{
+   struct input_event input_event;
+   udev_input_device_t *device = (udev_input_device_t*)event->userdata;
+
+   input_event.type  = event->type;
+   input_event.code  = event->code;
+   input_event.value = event->value;
+
+   device->handle_cb(data, &input_event, device);
+}
+
+static void udev_input_thread_flush(udev_input_t *udev)
+{
+   linux_input_thread_drain(udev->thread, cpu_features_get_time_usec(),
+         udev_input_thread_dispatch, udev);
+}
+
+/* Runs on the input thread */
+static void udev_input_thread_wait(void *data,
+      linux_input_thread_t *thread, int timeout_ms)
+{
+   int i, ret;
+   struct epoll_event events[32];
+   udev_input_t *udev = (udev_input_t*)data;
+
+   ret = epoll_wait(udev->fd, events, ARRAY_SIZE(events), timeout_ms);
+
+   if (ret <= 0)
+      return;
+
+   slock_lock(udev->devices_lock);
+
+   for (i = 0; i < ret; i++)
+   {
+      unsigned k;
+      int j, len;
+      struct input_event input_events[32];
+      udev_input_device_t *device = (udev_input_device_t*)events[i].data.ptr;
+
+      if (!(events[i].events & EPOLLIN))
+         continue;
+
+      /* The device may have been unplugged in between
+       * epoll_wait returning and the lock being taken */
+      for (k = 0; k < udev->num_devices; k++)
+         if (udev->devices[k] == device)
+            break;
+      if (k == udev->num_devices)
+         continue;
+
+      while ((len = read(device->fd,
+                  input_events, sizeof(input_events))) > 0)
+      {
+         retro_time_t now = cpu_features_get_time_usec();
+
+         len /= sizeof(*input_events);
+         for (j = 0; j < len; j++)
+         {
+            const struct input_event *ev = &input_events[j];
+            retro_time_t time            = device->monotonic
+               ? (retro_time_t)ev->input_event_sec * 1000000 + ev->input_event_usec
+               : now;
+
+            linux_input_thread_push(thread, device, time,
+                  ev->type, ev->code, ev->value);
+         }
+      }
+   }
+
+   slock_unlock(udev->devices_lock);
+}
+#endif
+
 static bool udev_input_add_device(udev_input_t *udev,
       enum udev_input_dev_type type, const char *devnode, device_handle_cb cb)
 {
@@ -506,6 +607,17 @@ static bool udev_input_add_device(udev_input_t *udev,
 
    strlcpy(device->devnode, devnode, sizeof(device->devnode));
 
+#ifdef UDEV_INPUT_THREAD
+   /* Have the kernel stamp events with the same clock as
+    * cpu_features_get_time_usec(), so the input thread can
+    * measure event-to-poll latency from the actual event time */
+   if (udev->threaded)
+   {
+      int clk           = CLOCK_MONOTONIC;
+      device->monotonic = ioctl(fd, EVIOCSCLOCKID, &clk) == 0;
+   }
+#endif
+
    /* UDEV_INPUT_MOUSE may report in absolute coords too */
    if (type == UDEV_INPUT_MOUSE || type == UDEV_INPUT_TOUCHPAD )
    {
@@ -538,11 +650,22 @@ static bool udev_input_add_device(udev_input_t *udev,
       }
    }
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->devices_lock)
+      slock_lock(udev->devices_lock);
+#endif
+
    tmp = ( udev_input_device_t**)realloc(udev->devices,
          (udev->num_devices + 1) * sizeof(*udev->devices));
 
    if (!tmp)
+   {
+#ifdef UDEV_INPUT_THREAD
+      if (udev->devices_lock)
+         slock_unlock(udev->devices_lock);
+#endif
       goto error;
+   }
 
    tmp[udev->num_devices++] = device;
    udev->devices            = tmp;
@@ -566,6 +689,11 @@ static bool udev_input_add_device(udev_input_t *udev,
    }
 #endif
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->devices_lock)
+      slock_unlock(udev->devices_lock);
+#endif
+
    return true;
 
 error:
@@ -582,14 +710,32 @@ static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
 
    for (i = 0; i < udev->num_devices; i++)
    {
-      if (!string_is_equal(devnode, udev->devices[i]->devnode))
+      udev_input_device_t *device = udev->devices[i];
+
+      if (!string_is_equal(devnode, device->devnode))
          continue;
 
-      close(udev->devices[i]->fd);
-      free(udev->devices[i]);
+#ifdef UDEV_INPUT_THREAD
+      if (udev->devices_lock)
+         slock_lock(udev->devices_lock);
+#endif
+
+      close(device->fd);
       memmove(udev->devices + i, udev->devices + i + 1,
             (udev->num_devices - (i + 1)) * sizeof(*udev->devices));
       udev->num_devices--;
+
+#ifdef UDEV_INPUT_THREAD
+      if (udev->devices_lock)
+      {
+         slock_unlock(udev->devices_lock);
+         /* Consume whatever was queued for this device
+          * before it goes away */
+         udev_input_thread_flush(udev);
+      }
+#endif
+
+      free(device);
    }
 }
 
@@ -744,6 +890,18 @@ static void udev_input_poll(void *data)
    while (udev->monitor && udev_input_poll_hotplug_available(udev->monitor))
       udev_input_handle_hotplug(udev);
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->thread)
+   {
+      /* Fold in everything the input thread read up to now */
+      udev_input_thread_flush(udev);
+
+      if (udev->joypad)
+         udev->joypad->poll();
+      return;
+   }
+#endif
+
 #if defined(HAVE_EPOLL)
    ret = epoll_wait(udev->fd, events, ARRAY_SIZE(events), 0);
 #elif defined(HAVE_KQUEUE)
@@ -1178,6 +1336,19 @@ static void udev_input_free(void *data)
    if (udev->joypad)
       udev->joypad->destroy();
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->thread)
+   {
+      linux_input_thread_log_stats(udev->thread, "udev");
+      linux_input_thread_free(udev->thread);
+   }
+   udev->thread = NULL;
+
+   if (udev->devices_lock)
+      slock_free(udev->devices_lock);
+   udev->devices_lock = NULL;
+#endif
+
    if (udev->fd >= 0)
       close(udev->fd);
 
@@ -1260,12 +1431,19 @@ static void *udev_input_init(const char *joypad_driver)
    int fd;
 #ifdef UDEV_XKB_HANDLING
    gfx_ctx_ident_t ctx_ident;
+#endif
+#ifdef UDEV_INPUT_THREAD
+   settings_t *settings = config_get_ptr();
 #endif
    udev_input_t *udev   = (udev_input_t*)calloc(1, sizeof(*udev));
 
    if (!udev)
       return NULL;
 
+#ifdef UDEV_INPUT_THREAD
+   udev->threaded       = settings->bools.input_threaded;
+#endif
+
    udev->udev = udev_new();
    if (!udev->udev)
       goto error;
@@ -1314,6 +1492,26 @@ static void *udev_input_init(const char *joypad_driver)
    udev->joypad = input_joypad_init_driver(joypad_driver, udev);
    input_keymaps_init_keyboard_lut(rarch_key_map_linux);
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->threaded)
+   {
+      udev->devices_lock = slock_new();
+      if (udev->devices_lock)
+         udev->thread    = linux_input_thread_new(
+               udev_input_thread_wait, udev, true);
+
+      if (udev->thread)
+         RARCH_LOG("[udev]: Reading input devices on a dedicated thread.\n");
+      else
+      {
+         RARCH_WARN("[udev]: Failed to start input thread, polling synchronously.\n");
+         if (udev->devices_lock)
+            slock_free(udev->devices_lock);
+         udev->devices_lock = NULL;
+      }
+   }
+#endif
+
 #ifdef __linux__
    linux_terminal_disable_input();
 #endif
@@ -22,6 +22,8 @@
 
 #include <audio/audio_mixer.h>
 #include <audio/audio_resampler.h>
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_RWAV
 #include <formats/rwav.h>
@@ -61,9 +63,46 @@
 #include <ibxm/ibxm.h>
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define AUDIO_MIXER_LOAD(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define AUDIO_MIXER_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#define AUDIO_MIXER_BARRIER()       __sync_synchronize()
+#elif defined(_XBOX360)
+/* Three weakly ordered cores */
+#include <xtl.h>
+#define AUDIO_MIXER_BARRIER()       MemoryBarrier()
+#elif defined(_WIN32) && !defined(_XBOX)
+#include <windows.h>
+#define AUDIO_MIXER_BARRIER()       MemoryBarrier()
+#endif
+
+/* Streams are only decoded ahead on a worker thread where the
+ * samples it writes can be ordered before the index publishing
+ * them; elsewhere they are decoded by audio_mixer_mix(), as
+ * without HAVE_THREADS */
+#if defined(AUDIO_MIXER_LOAD) || defined(AUDIO_MIXER_BARRIER)
+#define AUDIO_MIXER_STREAM_THREAD
+#endif
+#endif
+
+#ifndef AUDIO_MIXER_LOAD
+#ifndef AUDIO_MIXER_BARRIER
+#define AUDIO_MIXER_BARRIER()
+#endif
+#endif
+
 #define AUDIO_MIXER_MAX_VOICES      8
 #define AUDIO_MIXER_TEMP_BUFFER 8192
 
+/* How far ahead of the mixer streams are decoded */
+#define AUDIO_MIXER_STREAM_AHEAD_MS   250
+/* Upper bound on how long the decoder thread sleeps between checks */
+#define AUDIO_MIXER_STREAM_WAIT_USEC  20000
+
 struct audio_mixer_sound
 {
    enum audio_mixer_type type;
@@ -133,8 +172,6 @@ struct audio_mixer_voice
 #ifdef HAVE_STB_VORBIS
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -147,8 +184,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_FLAC
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -161,8 +196,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_MP3
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -175,20 +208,80 @@ struct audio_mixer_voice
 #ifdef HAVE_IBXM
       struct
       {
-         unsigned          position;
-         unsigned          samples;
          unsigned          buf_samples;
          int*              buffer;
+         float*            pcm;
          struct replay*    stream;
          struct module*    module;
       } mod;
 #endif
    } types;
+
+   /* Decoded audio of the streaming types (ogg, mod, flac, mp3) at the
+    * output rate, written by the decoder thread (or by
+    * audio_mixer_mix() itself for voices that are not threaded) and
+    * read by audio_mixer_mix(). read and write run freely and are
+    * masked with size - 1 to index the ring. */
+   struct
+   {
+      float *ring;
+      const float *pending;        /* decoded but not queued yet */
+      unsigned size;               /* in samples, a power of two */
+      unsigned pending_samples;
+      unsigned repeats_seen;
+      volatile unsigned read;
+      volatile unsigned write;
+      volatile unsigned repeats;   /* times the decoder looped */
+      volatile unsigned ended;
+      bool active;                 /* changed with the stream lock held */
+      bool threaded;
+   } stream;
 };
 
 /* TODO/FIXME - static globals */
 static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES] = {{0}};
 static unsigned s_rate = 0;
+static bool s_threaded = true;
+static audio_mixer_stats_t s_stats = {0};
+
+#ifdef AUDIO_MIXER_STREAM_THREAD
+static sthread_t *s_stream_thread = NULL;
+static slock_t *s_stream_lock     = NULL;
+static scond_t *s_stream_cond     = NULL;
+static bool s_stream_quit         = false;
+#endif
+
+/* Acquire and release accesses to the indices shared between the
+ * decoder thread and the mixer */
+static INLINE unsigned audio_mixer_load(volatile unsigned *ptr)
+{
+#ifdef AUDIO_MIXER_LOAD
+   return AUDIO_MIXER_LOAD(ptr);
+#else
+   unsigned val = *ptr;
+   AUDIO_MIXER_BARRIER();
+   return val;
+#endif
+}
+
+static INLINE void audio_mixer_store(volatile unsigned *ptr, unsigned val)
+{
+#ifdef AUDIO_MIXER_STORE
+   AUDIO_MIXER_STORE(ptr, val);
+#else
+   AUDIO_MIXER_BARRIER();
+   *ptr = val;
+#endif
+}
+
+#if defined(HAVE_STB_VORBIS) || defined(HAVE_IBXM) || defined(HAVE_DR_FLAC) || defined(HAVE_DR_MP3)
+/* Called by the decoders when a repeating stream loops. The callback
+ * itself is run by audio_mixer_mix(), on the mixing thread. */
+static void audio_mixer_stream_repeated(audio_mixer_voice_t* voice)
+{
+   audio_mixer_store(&voice->stream.repeats, voice->stream.repeats + 1);
+}
+#endif
 
 #ifdef HAVE_RWAV
 static bool wav_to_float(const rwav_t* wav, float** pcm, size_t samples_out)
@@ -311,13 +404,7 @@ void audio_mixer_init(unsigned rate)
 
    s_rate = rate;
 
-   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
-      s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
-}
-
-void audio_mixer_done(void)
-{
-   unsigned i;
+   memset(&s_stats, 0, sizeof(s_stats));
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
@@ -561,8 +648,6 @@ static bool audio_mixer_play_ogg(
    voice->types.ogg.buf_samples    = samples;
    voice->types.ogg.ratio          = ratio;
    voice->types.ogg.stream         = stb_vorbis;
-   voice->types.ogg.position       = 0;
-   voice->types.ogg.samples        = 0;
 
    return true;
 
@@ -584,6 +669,7 @@ static bool audio_mixer_play_mod(
    int buf_samples               = 0;
    int samples                   = 0;
    void *mod_buffer              = NULL;
+   void *mod_pcm                 = NULL;
    struct module* module         = NULL;
    struct replay* replay         = NULL;
 
@@ -612,8 +698,9 @@ static bool audio_mixer_play_mod(
 
    buf_samples = calculate_mix_buf_len(s_rate);
    mod_buffer  = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(int));
+   mod_pcm     = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(float));
 
-   if (!mod_buffer)
+   if (!mod_buffer || !mod_pcm)
    {
       printf("audio_mixer_play_mod cannot allocate mod_buffer !\n");
       goto error;
@@ -632,18 +719,21 @@ static bool audio_mixer_play_mod(
       dispose_replay(voice->types.mod.stream);
    if (voice->types.mod.buffer)
       memalign_free(voice->types.mod.buffer);
+   if (voice->types.mod.pcm)
+      memalign_free(voice->types.mod.pcm);
 
    voice->types.mod.buffer         = (int*)mod_buffer;
+   voice->types.mod.pcm            = (float*)mod_pcm;
    voice->types.mod.buf_samples    = buf_samples;
    voice->types.mod.stream         = replay;
-   voice->types.mod.position       = 0;
-   voice->types.mod.samples        = 0; /* samples; */
 
    return true;
 
 error:
    if (mod_buffer)
       memalign_free(mod_buffer);
+   if (mod_pcm)
+      memalign_free(mod_pcm);
    if (module)
       dispose_module(module);
    return false;
@@ -701,8 +791,6 @@ static bool audio_mixer_play_flac(
    voice->types.flac.buf_samples    = samples;
    voice->types.flac.ratio          = ratio;
    voice->types.flac.stream         = dr_flac;
-   voice->types.flac.position       = 0;
-   voice->types.flac.samples        = 0;
 
    return true;
 
@@ -769,8 +857,6 @@ static bool audio_mixer_play_mp3(
    voice->types.mp3.buffer         = (float*)mp3_buffer;
    voice->types.mp3.buf_samples    = samples;
    voice->types.mp3.ratio          = ratio;
-   voice->types.mp3.position       = 0;
-   voice->types.mp3.samples        = 0;
 
    return true;
 
@@ -780,16 +866,486 @@ error:
 }
 #endif
 
+#ifdef HAVE_STB_VORBIS
+static unsigned audio_mixer_decode_ogg(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   struct resampler_data info;
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
+   bool seeked                      = false;
+   unsigned temp_samples            = 0;
+
+again:
+   temp_samples = stb_vorbis_get_samples_float_interleaved(
+         voice->types.ogg.stream, 2, temp_buffer,
+         AUDIO_MIXER_TEMP_BUFFER) * 2;
+
+   if (temp_samples == 0)
+   {
+      if (!voice->repeat || seeked)
+         return 0;
+
+      stb_vorbis_seek_start(voice->types.ogg.stream);
+      audio_mixer_stream_repeated(voice);
+      seeked = true;
+      goto again;
+   }
+
+   *pcm = voice->types.ogg.buffer;
+
+   if (!voice->types.ogg.resampler)
+   {
+      memcpy(voice->types.ogg.buffer, temp_buffer,
+            temp_samples * sizeof(float));
+      return temp_samples;
+   }
+
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.ogg.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.ogg.ratio;
+
+   voice->types.ogg.resampler->process(
+         voice->types.ogg.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2,
+         voice->types.ogg.buf_samples);
+}
+#endif
+
+#ifdef HAVE_IBXM
+static unsigned audio_mixer_decode_mod(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   unsigned i;
+   float samplef                    = 0.0f;
+   unsigned temp_samples            = replay_get_audio(
+         voice->types.mod.stream, voice->types.mod.buffer) * 2;
+   const int *in                    = voice->types.mod.buffer;
+   float *out                       = voice->types.mod.pcm;
+
+   if (temp_samples == 0)
+   {
+      if (!voice->repeat)
+         return 0;
+
+      replay_seek(voice->types.mod.stream, 0);
+      audio_mixer_stream_repeated(voice);
+
+      temp_samples = replay_get_audio(
+            voice->types.mod.stream, voice->types.mod.buffer) * 2;
+   }
+
+   for (i = temp_samples; i != 0; i--)
+   {
+      samplef  = (float)(*in++ + 32768) / 65535.0f;
+      *out++   = samplef * 2.0f - 1.0f;
+   }
+
+   *pcm = voice->types.mod.pcm;
+   return temp_samples;
+}
+#endif
+
+#ifdef HAVE_DR_FLAC
+static unsigned audio_mixer_decode_flac(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   struct resampler_data info;
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
+   bool seeked                      = false;
+   unsigned temp_samples            = 0;
+
+again:
+   temp_samples = (unsigned)drflac_read_f32(voice->types.flac.stream,
+         AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
+
+   if (temp_samples == 0)
+   {
+      if (!voice->repeat || seeked)
+         return 0;
+
+      drflac_seek_to_sample(voice->types.flac.stream, 0);
+      audio_mixer_stream_repeated(voice);
+      seeked = true;
+      goto again;
+   }
+
+   *pcm = voice->types.flac.buffer;
+
+   if (!voice->types.flac.resampler)
+   {
+      memcpy(voice->types.flac.buffer, temp_buffer,
+            temp_samples * sizeof(float));
+      return temp_samples;
+   }
+
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.flac.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.flac.ratio;
+
+   voice->types.flac.resampler->process(
+         voice->types.flac.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2,
+         voice->types.flac.buf_samples);
+}
+#endif
+
+#ifdef HAVE_DR_MP3
+static unsigned audio_mixer_decode_mp3(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   struct resampler_data info;
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
+   bool seeked                      = false;
+   unsigned temp_samples            = 0;
+
+again:
+   temp_samples = (unsigned)drmp3_read_f32(
+         &voice->types.mp3.stream,
+         AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
+
+   if (temp_samples == 0)
+   {
+      if (!voice->repeat || seeked)
+         return 0;
+
+      drmp3_seek_to_frame(&voice->types.mp3.stream, 0);
+      audio_mixer_stream_repeated(voice);
+      seeked = true;
+      goto again;
+   }
+
+   *pcm = voice->types.mp3.buffer;
+
+   if (!voice->types.mp3.resampler)
+   {
+      memcpy(voice->types.mp3.buffer, temp_buffer,
+            temp_samples * sizeof(float));
+      return temp_samples;
+   }
+
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.mp3.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.mp3.ratio;
+
+   voice->types.mp3.resampler->process(
+         voice->types.mp3.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2,
+         voice->types.mp3.buf_samples);
+}
+#endif
+
+/* Decodes the next block of a stream at the output rate, seeking
+ * back to the start once if the voice repeats. Returns the number of
+ * samples at *pcm, 0 once the stream has ended. */
+static unsigned audio_mixer_stream_decode(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   switch (voice->type)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         return audio_mixer_decode_ogg(voice, pcm);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         return audio_mixer_decode_mod(voice, pcm);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         return audio_mixer_decode_flac(voice, pcm);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         return audio_mixer_decode_mp3(voice, pcm);
+#else
+         break;
+#endif
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+/* Queues decoded audio until @target samples (at most the size of the
+ * ring) are buffered, decoding at most one more block to get there.
+ * Returns true if a block was decoded. Only ever called by one thread
+ * at a time for a given voice: the decoder thread for threaded voices,
+ * otherwise whoever calls audio_mixer_mix(). */
+static bool audio_mixer_stream_fill(audio_mixer_voice_t* voice,
+      unsigned target)
+{
+   bool decoded   = false;
+   unsigned mask  = voice->stream.size - 1;
+   unsigned write = voice->stream.write;
+
+   for (;;)
+   {
+      unsigned count, offset, first;
+      unsigned buffered = write - audio_mixer_load(&voice->stream.read);
+
+      if (buffered >= target)
+         break;
+
+      if (!voice->stream.pending_samples)
+      {
+         if (decoded)
+            break;
+
+         decoded                       = true;
+         voice->stream.pending_samples = audio_mixer_stream_decode(
+               voice, &voice->stream.pending);
+
+         if (!voice->stream.pending_samples)
+         {
+            audio_mixer_store(&voice->stream.ended, 1);
+            break;
+         }
+      }
+
+      count  = MIN(voice->stream.pending_samples, target - buffered);
+      offset = write & mask;
+      first  = MIN(count, voice->stream.size - offset);
+
+      memcpy(voice->stream.ring + offset, voice->stream.pending,
+            first * sizeof(float));
+      if (count > first)
+         memcpy(voice->stream.ring, voice->stream.pending + first,
+               (count - first) * sizeof(float));
+
+      voice->stream.pending         += count;
+      voice->stream.pending_samples -= count;
+      write                         += count;
+
+      audio_mixer_store(&voice->stream.write, write);
+   }
+
+   return decoded;
+}
+
+#ifdef AUDIO_MIXER_STREAM_THREAD
+static void audio_mixer_stream_thread(void *data)
+{
+   slock_lock(s_stream_lock);
+
+   while (!s_stream_quit)
+   {
+      unsigned i;
+      bool decoded = false;
+
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         audio_mixer_voice_t *voice = &s_voices[i];
+
+         if (     !voice->stream.active
+               || !voice->stream.threaded
+               ||  voice->stream.ended)
+            continue;
+
+         if (audio_mixer_stream_fill(voice, voice->stream.size))
+            decoded = true;
+
+         /* Let audio_mixer_play() and audio_mixer_stop() in
+          * between two blocks. */
+         slock_unlock(s_stream_lock);
+         slock_lock(s_stream_lock);
+      }
+
+      /* The mixer signals once a ring is half empty, the timeout
+       * covers a signal sent while the voices were being walked. */
+      if (!decoded && !s_stream_quit)
+         scond_wait_timeout(s_stream_cond, s_stream_lock,
+               AUDIO_MIXER_STREAM_WAIT_USEC);
+   }
+
+   slock_unlock(s_stream_lock);
+}
+
+static void audio_mixer_stream_thread_init(void)
+{
+   s_stream_quit = false;
+   s_stream_lock = slock_new();
+   s_stream_cond = scond_new();
+
+   if (s_stream_lock && s_stream_cond)
+      s_stream_thread = sthread_create(audio_mixer_stream_thread, NULL);
+
+   if (!s_stream_thread)
+   {
+      if (s_stream_lock)
+         slock_free(s_stream_lock);
+      if (s_stream_cond)
+         scond_free(s_stream_cond);
+      s_stream_lock = NULL;
+      s_stream_cond = NULL;
+   }
+}
+
+static void audio_mixer_stream_thread_deinit(void)
+{
+   if (!s_stream_thread)
+      return;
+
+   slock_lock(s_stream_lock);
+   s_stream_quit = true;
+   scond_signal(s_stream_cond);
+   slock_unlock(s_stream_lock);
+
+   sthread_join(s_stream_thread);
+   slock_free(s_stream_lock);
+   scond_free(s_stream_cond);
+
+   s_stream_thread = NULL;
+   s_stream_lock   = NULL;
+   s_stream_cond   = NULL;
+}
+#endif
+
+static void audio_mixer_stream_lock(void)
+{
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   if (s_stream_lock)
+      slock_lock(s_stream_lock);
+#endif
+}
+
+static void audio_mixer_stream_unlock(void)
+{
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   if (s_stream_lock)
+      slock_unlock(s_stream_lock);
+#endif
+}
+
+static bool audio_mixer_type_is_stream(enum audio_mixer_type type)
+{
+   switch (type)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+      case AUDIO_MIXER_TYPE_MOD:
+      case AUDIO_MIXER_TYPE_FLAC:
+      case AUDIO_MIXER_TYPE_MP3:
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/* Resets the ring of a voice that has just been set up to play a
+ * stream and decodes the first block, so mixing can start right away.
+ * Called with the stream lock held. */
+static bool audio_mixer_stream_start(audio_mixer_voice_t* voice)
+{
+   unsigned size    = 1;
+   unsigned samples = s_rate * 2 * AUDIO_MIXER_STREAM_AHEAD_MS / 1000;
+
+   while (size < samples)
+      size <<= 1;
+
+   if (voice->stream.size != size)
+   {
+      if (voice->stream.ring)
+         memalign_free(voice->stream.ring);
+
+      voice->stream.size = 0;
+      voice->stream.ring = (float*)memalign_alloc(16, size * sizeof(float));
+
+      if (!voice->stream.ring)
+         return false;
+
+      voice->stream.size = size;
+   }
+
+   voice->stream.pending         = NULL;
+   voice->stream.pending_samples = 0;
+   voice->stream.read            = 0;
+   voice->stream.write           = 0;
+   voice->stream.repeats         = 0;
+   voice->stream.repeats_seen    = 0;
+   voice->stream.ended           = 0;
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   voice->stream.threaded        = s_threaded && s_stream_thread;
+#else
+   voice->stream.threaded        = false;
+#endif
+   voice->stream.active          = true;
+
+   audio_mixer_stream_fill(voice, size);
+
+   return true;
+}
+
+void audio_mixer_done(void)
+{
+   unsigned i;
+
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   audio_mixer_stream_thread_deinit();
+#endif
+
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      s_voices[i].type          = AUDIO_MIXER_TYPE_NONE;
+      s_voices[i].stream.active = false;
+
+      if (s_voices[i].stream.ring)
+         memalign_free(s_voices[i].stream.ring);
+
+      s_voices[i].stream.ring   = NULL;
+      s_voices[i].stream.size   = 0;
+   }
+}
+
+void audio_mixer_set_threaded(bool threaded)
+{
+   s_threaded = threaded;
+}
+
+void audio_mixer_get_stats(audio_mixer_stats_t *stats)
+{
+   if (stats)
+      *stats = s_stats;
+}
+
 audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       float volume, audio_mixer_stop_cb_t stop_cb)
 {
    unsigned i;
    bool res                   = false;
+   bool stream                = false;
    audio_mixer_voice_t* voice = s_voices;
 
    if (!sound)
       return NULL;
 
+   stream                     = audio_mixer_type_is_stream(sound->type);
+
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   if (stream && s_threaded && !s_stream_thread)
+      audio_mixer_stream_thread_init();
+#endif
+
+   /* The decoder thread may still be working on the voice that is
+    * about to be reused */
+   audio_mixer_stream_lock();
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
    {
       if (voice->type != AUDIO_MIXER_TYPE_NONE)
@@ -834,11 +1390,17 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       voice->volume   = volume;
       voice->sound    = sound;
       voice->stop_cb  = stop_cb;
+
+      if (stream && !audio_mixer_stream_start(voice))
+      {
+         voice->type  = AUDIO_MIXER_TYPE_NONE;
+         res          = false;
+      }
    }
-   else
-      voice = NULL;
 
-   return voice;
+   audio_mixer_stream_unlock();
+
+   return res ? voice : NULL;
 }
 
 void audio_mixer_stop(audio_mixer_voice_t* voice)
@@ -851,7 +1413,12 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       stop_cb     = voice->stop_cb;
       sound       = voice->sound;
 
-      voice->type = AUDIO_MIXER_TYPE_NONE;
+      /* Once this returns, the decoder thread is done with the voice
+       * and the sound can be destroyed. */
+      audio_mixer_stream_lock();
+      voice->stream.active = false;
+      voice->type          = AUDIO_MIXER_TYPE_NONE;
+      audio_mixer_stream_unlock();
 
       if (stop_cb)
          stop_cb(sound, AUDIO_MIXER_SOUND_STOPPED);
@@ -902,176 +1469,60 @@ again:
    }
 }
 
-#ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.ogg.position == voice->types.ogg.samples)
-   {
-again:
-      temp_samples = stb_vorbis_get_samples_float_interleaved(
-            voice->types.ogg.stream, 2, temp_buffer,
-            AUDIO_MIXER_TEMP_BUFFER) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.ogg.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.ogg.ratio;
-
-      if (voice->types.ogg.resampler)
-         voice->types.ogg.resampler->process(
-               voice->types.ogg.resampler_data, &info);
-      else
-         memcpy(voice->types.ogg.buffer, temp_buffer,
-               temp_samples * sizeof(float));
-
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
-   }
-
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
+   unsigned i;
+   unsigned buf_free = (unsigned)(num_frames * 2);
+   unsigned mask     = voice->stream.size - 1;
+   unsigned read     = voice->stream.read;
 
-   if (voice->types.ogg.samples < buf_free)
+   while (buf_free)
    {
-      for (i = voice->types.ogg.samples; i != 0; i--)
+      unsigned ended, count, first;
+      const float *pcm = NULL;
+
+      if (!voice->stream.threaded)
+         while (     !voice->stream.ended
+               && audio_mixer_stream_fill(voice,
+                  MIN(buf_free, voice->stream.size)));
+
+      /* Whatever was queued before the end was flagged is visible
+       * after reading it. */
+      ended    = audio_mixer_load(&voice->stream.ended);
+      count    = MIN(audio_mixer_load(&voice->stream.write) - read,
+            buf_free);
+      first    = MIN(count, voice->stream.size - (read & mask));
+      pcm      = voice->stream.ring + (read & mask);
+
+      for (i = first; i != 0; i--)
          *buffer++ += *pcm++ * volume;
 
-      buf_free -= voice->types.ogg.samples;
-      goto again;
-   }
+      pcm      = voice->stream.ring;
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+      for (i = count - first; i != 0; i--)
+         *buffer++ += *pcm++ * volume;
 
-   voice->types.ogg.position += buf_free;
-   voice->types.ogg.samples  -= buf_free;
-}
-#endif
+      read     += count;
+      buf_free -= count;
 
-#ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   float samplef                    = 0.0f;
-   int samplei                      = 0;
-   unsigned temp_samples            = 0;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   int* pcm                         = NULL;
+      audio_mixer_store(&voice->stream.read, read);
 
-   if (voice->types.mod.position == voice->types.mod.samples)
-   {
-again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer );
-
-      temp_samples *= 2; /* stereo */
-
-      if (temp_samples == 0)
+      while (voice->stream.repeats_seen !=
+            audio_mixer_load(&voice->stream.repeats))
       {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
+         voice->stream.repeats_seen++;
 
          if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
-      }
-
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
-   }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
-
-   if (voice->types.mod.samples < buf_free)
-   {
-      for (i = voice->types.mod.samples; i != 0; i--)
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
+            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
       }
 
-      buf_free -= voice->types.mod.samples;
-      goto again;
-   }
-
-   for (i = buf_free; i != 0; --i )
-   {
-      samplei     = *pcm++ * volume;
-      samplef     = (float)((int)samplei + 32768) / 65535.0f;
-      samplef     = samplef * 2.0f - 1.0f;
-      *buffer++  += samplef;
-   }
-
-   voice->types.mod.position += buf_free;
-   voice->types.mod.samples  -= buf_free;
-}
-#endif
-
-#ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float *pcm                       = NULL;
+      if (!buf_free)
+         break;
 
-   if (voice->types.flac.position == voice->types.flac.samples)
-   {
-again:
-      temp_samples = (unsigned)drflac_read_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
-      if (temp_samples == 0)
+      if (ended)
       {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            drflac_seek_to_sample(voice->types.flac.stream,0);
-            goto again;
-         }
-
          if (voice->stop_cb)
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
@@ -1079,111 +1530,22 @@ again:
          return;
       }
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.flac.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.flac.ratio;
-
-      if (voice->types.flac.resampler)
-         voice->types.flac.resampler->process(
-               voice->types.flac.resampler_data, &info);
-      else
-         memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
-   }
-
-   pcm = voice->types.flac.buffer + voice->types.flac.position;
-
-   if (voice->types.flac.samples < buf_free)
-   {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.flac.samples;
-      goto again;
-   }
-
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.flac.position += buf_free;
-   voice->types.flac.samples  -= buf_free;
-}
-#endif
-
-#ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.mp3.position == voice->types.mp3.samples)
-   {
-again:
-      temp_samples = (unsigned)drmp3_read_f32(
-            &voice->types.mp3.stream,
-            AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
-
-      if (temp_samples == 0)
+      if (voice->stream.threaded)
       {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            drmp3_seek_to_frame(&voice->types.mp3.stream,0);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
+         /* The decoder thread fell behind, leave the rest silent */
+         s_stats.underruns++;
+         s_stats.underrun_frames += buf_free / 2;
+         break;
       }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.mp3.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.mp3.ratio;
-
-      if (voice->types.mp3.resampler)
-         voice->types.mp3.resampler->process(
-               voice->types.mp3.resampler_data, &info);
-      else
-         memcpy(voice->types.mp3.buffer, temp_buffer,
-               temp_samples * sizeof(float));
-      voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
-   }
-
-   pcm = voice->types.mp3.buffer + voice->types.mp3.position;
-
-   if (voice->types.mp3.samples < buf_free)
-   {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.mp3.samples;
-      goto again;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.mp3.position += buf_free;
-   voice->types.mp3.samples  -= buf_free;
-}
+#ifdef AUDIO_MIXER_STREAM_THREAD
+   if (     voice->stream.threaded
+         && audio_mixer_load(&voice->stream.write) - read
+         < voice->stream.size / 2)
+      scond_signal(s_stream_cond);
 #endif
+}
 
 void audio_mixer_mix(float* buffer, size_t num_frames,
       float volume_override, bool override)
@@ -1203,31 +1565,17 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
             audio_mixer_mix_wav(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
-#endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
-#endif
+         case AUDIO_MIXER_TYPE_MP3:
+            audio_mixer_mix_stream(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_NONE:
             break;
       }
    }
 
-   for (j = 0, sample = buffer; j < num_frames; j++, sample++)
+   for (j = 0, sample = buffer; j < num_frames * 2; j++, sample++)
    {
       if (*sample < -1.0f)
          *sample = -1.0f;
@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <retro_miscellaneous.h>
 
@@ -36,6 +37,11 @@
 
 #include <audio/dsp_filter.h>
 
+/* Default chunk size (in stereo frames) for fused chain processing.
+ * 256 frames is 2KiB of float samples, which stays resident in L1
+ * while every filter of the chain runs over it. */
+#define DSP_FILTER_BLOCK_FRAMES 256
+
 struct retro_dsp_plug
 {
 #ifdef HAVE_DYLIB
@@ -59,6 +65,15 @@ struct retro_dsp_filter
 
    struct retro_dsp_instance *instances;
    unsigned num_instances;
+
+   /* Fused mode: the whole chain runs over block_frames at a time.
+    * 0 runs each filter over the entire buffer instead. */
+   unsigned block_frames;
+
+   /* Holds the output of fused processing whenever a filter of
+    * the chain does not process in place (e.g. eq). */
+   float *block_buffer;
+   size_t block_buffer_size;
 };
 
 static const struct dspfilter_implementation *find_implementation(
@@ -92,6 +107,9 @@ static bool create_filter_graph(retro_dsp_filter_t *dsp, float sample_rate)
    if (!config_get_uint(dsp->conf, "filters", &filters))
       return false;
 
+   dsp->block_frames = DSP_FILTER_BLOCK_FRAMES;
+   config_get_uint(dsp->conf, "block_frames", &dsp->block_frames);
+
    instances = (struct retro_dsp_instance*)calloc(filters, sizeof(*instances));
    if (!instances)
       return false;
@@ -141,6 +159,7 @@ extern const struct dspfilter_implementation *phaser_dspfilter_get_implementatio
 extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 
 static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    panning_dspfilter_get_implementation,
@@ -150,6 +169,7 @@ static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    wahwah_dspfilter_get_implementation,
    eq_dspfilter_get_implementation,
    chorus_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
 };
 
 static bool append_plugs(retro_dsp_filter_t *dsp, struct string_list *list)
@@ -285,6 +305,7 @@ void retro_dsp_filter_free(retro_dsp_filter_t *dsp)
          dsp->instances[i].impl->free(dsp->instances[i].impl_data);
    }
    free(dsp->instances);
+   free(dsp->block_buffer);
 
 #ifdef HAVE_DYLIB
    for (i = 0; i < dsp->num_plugs; i++)
@@ -301,23 +322,105 @@ void retro_dsp_filter_free(retro_dsp_filter_t *dsp)
    free(dsp);
 }
 
+static void retro_dsp_filter_process_chain(retro_dsp_filter_t *dsp,
+      struct dspfilter_output *output)
+{
+   unsigned i;
+   struct dspfilter_input input = {0};
+
+   for (i = 0; i < dsp->num_instances; i++)
+   {
+      input.samples = output->samples;
+      input.frames  = output->frames;
+      dsp->instances[i].impl->process(
+            dsp->instances[i].impl_data, output, &input);
+   }
+}
+
+static bool retro_dsp_filter_reserve(retro_dsp_filter_t *dsp,
+      size_t samples)
+{
+   float *buf;
+
+   if (samples <= dsp->block_buffer_size)
+      return true;
+
+   samples *= 2;
+   buf      = (float*)realloc(dsp->block_buffer, samples * sizeof(float));
+   if (!buf)
+      return false;
+
+   dsp->block_buffer      = buf;
+   dsp->block_buffer_size = samples;
+   return true;
+}
+
+/* Runs the entire chain over one cache-sized chunk before moving
+ * on to the next, rather than letting every filter stream the whole
+ * buffer through the cache in turn. As long as each filter processes
+ * in place the result stays in data->input; once one hands back its
+ * own buffer, output is gathered in dsp->block_buffer instead. */
+static void retro_dsp_filter_process_fused(retro_dsp_filter_t *dsp,
+      struct retro_dsp_data *data)
+{
+   unsigned offset;
+   unsigned out_frames = 0;
+   bool in_place       = true;
+
+   for (offset = 0; offset < data->input_frames; offset += dsp->block_frames)
+   {
+      struct dspfilter_output output = {0};
+      float *chunk                   = data->input + offset * 2;
+      unsigned frames                = MIN(dsp->block_frames,
+            data->input_frames - offset);
+
+      output.samples = chunk;
+      output.frames  = frames;
+
+      retro_dsp_filter_process_chain(dsp, &output);
+
+      if (in_place && output.samples == chunk && output.frames == frames)
+      {
+         out_frames += frames;
+         continue;
+      }
+
+      if (!retro_dsp_filter_reserve(dsp,
+               (out_frames + output.frames) * 2))
+         break;
+
+      if (in_place)
+      {
+         memcpy(dsp->block_buffer, data->input,
+               out_frames * 2 * sizeof(float));
+         in_place = false;
+      }
+
+      if (output.frames)
+         memcpy(dsp->block_buffer + out_frames * 2, output.samples,
+               output.frames * 2 * sizeof(float));
+      out_frames += output.frames;
+   }
+
+   data->output        = in_place ? data->input : dsp->block_buffer;
+   data->output_frames = out_frames;
+}
+
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data)
 {
-   unsigned i;
    struct dspfilter_output output = {0};
-   struct dspfilter_input input   = {0};
+
+   if (dsp->block_frames && data->input_frames > dsp->block_frames)
+   {
+      retro_dsp_filter_process_fused(dsp, data);
+      return;
+   }
 
    output.samples = data->input;
    output.frames  = data->input_frames;
 
-   for (i = 0; i < dsp->num_instances; i++)
-   {
-      input.samples = output.samples;
-      input.frames  = output.frames;
-      dsp->instances[i].impl->process(
-            dsp->instances[i].impl_data, &output, &input);
-   }
+   retro_dsp_filter_process_chain(dsp, &output);
 
    data->output        = output.samples;
    data->output_frames = output.frames;
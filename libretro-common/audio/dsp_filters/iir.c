@@ -28,6 +28,10 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -124,6 +128,65 @@ static void iir_process(void *data, struct dspfilter_output *output,
    iir->r.yn2 = yn2_r;
 }
 
+#if defined(__SSE__)
+/* Runs both channels of a frame in the low two lanes of one vector.
+ * The coefficients are pre-divided by a0 so the feedback path is a
+ * multiply-add chain instead of a division per frame. This reassociates
+ * the arithmetic, so output differs from iir_process() by rounding only
+ * (well under 1e-4 for input in [-1, 1], see samples/audio/dsp_filter_bench). */
+static void iir_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct iir_data *iir = (struct iir_data*)data;
+   float *out           = output->samples;
+   __m128 b0            = _mm_set1_ps(iir->b0 / iir->a0);
+   __m128 b1            = _mm_set1_ps(iir->b1 / iir->a0);
+   __m128 b2            = _mm_set1_ps(iir->b2 / iir->a0);
+   __m128 a1            = _mm_set1_ps(iir->a1 / iir->a0);
+   __m128 a2            = _mm_set1_ps(iir->a2 / iir->a0);
+   __m128 xn1           = _mm_setr_ps(iir->l.xn1, iir->r.xn1, 0.0f, 0.0f);
+   __m128 xn2           = _mm_setr_ps(iir->l.xn2, iir->r.xn2, 0.0f, 0.0f);
+   __m128 yn1           = _mm_setr_ps(iir->l.yn1, iir->r.yn1, 0.0f, 0.0f);
+   __m128 yn2           = _mm_setr_ps(iir->l.yn2, iir->r.yn2, 0.0f, 0.0f);
+   float state[4];
+
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      /* Feed-forward terms do not depend on the previous output. */
+      __m128 ff = _mm_add_ps(_mm_add_ps(
+               _mm_mul_ps(b0, in), _mm_mul_ps(b1, xn1)),
+            _mm_mul_ps(b2, xn2));
+      __m128 y  = _mm_sub_ps(_mm_sub_ps(ff, _mm_mul_ps(a2, yn2)),
+            _mm_mul_ps(a1, yn1));
+
+      xn2       = xn1;
+      xn1       = in;
+      yn2       = yn1;
+      yn1       = y;
+
+      _mm_storel_pi((__m64*)out, y);
+   }
+
+   _mm_storeu_ps(state, xn1);
+   iir->l.xn1 = state[0];
+   iir->r.xn1 = state[1];
+   _mm_storeu_ps(state, xn2);
+   iir->l.xn2 = state[0];
+   iir->r.xn2 = state[1];
+   _mm_storeu_ps(state, yn1);
+   iir->l.yn1 = state[0];
+   iir->r.yn1 = state[1];
+   _mm_storeu_ps(state, yn2);
+   iir->l.yn2 = state[0];
+   iir->r.yn2 = state[1];
+}
+#endif
+
 #define CHECK(x) if (string_is_equal(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
 {
@@ -357,12 +420,28 @@ static const struct dspfilter_implementation iir_plug = {
    "iir",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation iir_plug_sse = {
+   iir_init,
+   iir_process_sse,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &iir_plug_sse;
+#endif
    (void)mask;
    return &iir_plug;
 }
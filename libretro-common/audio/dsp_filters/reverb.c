@@ -25,8 +25,13 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 struct comb
 {
    float *buffer;
@@ -260,6 +265,173 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    }
 }
 
+#if defined(__SSE__)
+#define REVERB_BLOCK 64
+
+/* Runs four combs side by side, one per lane. Each comb reads and
+ * rewrites the slot at its own index, so four consecutive frames can
+ * be loaded per comb and transposed into frame-major vectors; only
+ * filterstore is carried from one frame to the next. */
+static void revmodel_combs_sse(struct comb *c, float *mono,
+      const float *input, unsigned frames)
+{
+   unsigned t = 0;
+
+   while (t < frames)
+   {
+      unsigned k;
+      __m128 fs, damp1, damp2, feedback, sum;
+      __m128 v0, v1, v2, v3, n0, n1, n2, n3;
+
+      if (     frames - t < 4
+            || c[0].bufsize - c[0].bufidx < 4
+            || c[1].bufsize - c[1].bufidx < 4
+            || c[2].bufsize - c[2].bufidx < 4
+            || c[3].bufsize - c[3].bufidx < 4)
+      {
+         for (k = 0; k < 4; k++)
+            mono[t] += comb_process(&c[k], input[t]);
+         t++;
+         continue;
+      }
+
+      fs       = _mm_setr_ps(c[0].filterstore, c[1].filterstore,
+            c[2].filterstore, c[3].filterstore);
+      damp1    = _mm_setr_ps(c[0].damp1, c[1].damp1, c[2].damp1, c[3].damp1);
+      damp2    = _mm_setr_ps(c[0].damp2, c[1].damp2, c[2].damp2, c[3].damp2);
+      feedback = _mm_setr_ps(c[0].feedback, c[1].feedback,
+            c[2].feedback, c[3].feedback);
+
+      v0       = _mm_loadu_ps(c[0].buffer + c[0].bufidx);
+      v1       = _mm_loadu_ps(c[1].buffer + c[1].bufidx);
+      v2       = _mm_loadu_ps(c[2].buffer + c[2].bufidx);
+      v3       = _mm_loadu_ps(c[3].buffer + c[3].bufidx);
+
+      /* The comb outputs are the old buffer contents; accumulate them
+       * in comb order to match revmodel_process(). */
+      sum      = _mm_loadu_ps(mono + t);
+      sum      = _mm_add_ps(sum, v0);
+      sum      = _mm_add_ps(sum, v1);
+      sum      = _mm_add_ps(sum, v2);
+      sum      = _mm_add_ps(sum, v3);
+      _mm_storeu_ps(mono + t, sum);
+
+      _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+      fs       = _mm_add_ps(_mm_mul_ps(v0, damp2), _mm_mul_ps(fs, damp1));
+      n0       = _mm_add_ps(_mm_set1_ps(input[t + 0]), _mm_mul_ps(fs, feedback));
+      fs       = _mm_add_ps(_mm_mul_ps(v1, damp2), _mm_mul_ps(fs, damp1));
+      n1       = _mm_add_ps(_mm_set1_ps(input[t + 1]), _mm_mul_ps(fs, feedback));
+      fs       = _mm_add_ps(_mm_mul_ps(v2, damp2), _mm_mul_ps(fs, damp1));
+      n2       = _mm_add_ps(_mm_set1_ps(input[t + 2]), _mm_mul_ps(fs, feedback));
+      fs       = _mm_add_ps(_mm_mul_ps(v3, damp2), _mm_mul_ps(fs, damp1));
+      n3       = _mm_add_ps(_mm_set1_ps(input[t + 3]), _mm_mul_ps(fs, feedback));
+
+      _MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+
+      _mm_storeu_ps(c[0].buffer + c[0].bufidx, n0);
+      _mm_storeu_ps(c[1].buffer + c[1].bufidx, n1);
+      _mm_storeu_ps(c[2].buffer + c[2].bufidx, n2);
+      _mm_storeu_ps(c[3].buffer + c[3].bufidx, n3);
+
+      {
+         float store[4];
+         _mm_storeu_ps(store, fs);
+         for (k = 0; k < 4; k++)
+         {
+            c[k].filterstore = store[k];
+            c[k].bufidx     += 4;
+            if (c[k].bufidx >= c[k].bufsize)
+               c[k].bufidx   = 0;
+         }
+      }
+
+      t += 4;
+   }
+}
+
+/* An allpass only reads back what it wrote bufsize frames earlier,
+ * so four frames at a time can go through it in one step. */
+static void revmodel_allpass_sse(struct allpass *a, float *mono,
+      unsigned frames)
+{
+   unsigned t        = 0;
+   __m128 feedback   = _mm_set1_ps(a->feedback);
+
+   while (t < frames)
+   {
+      __m128 in, bufout;
+
+      if (frames - t < 4 || a->bufsize - a->bufidx < 4)
+      {
+         mono[t] = allpass_process(a, mono[t]);
+         t++;
+         continue;
+      }
+
+      in     = _mm_loadu_ps(mono + t);
+      bufout = _mm_loadu_ps(a->buffer + a->bufidx);
+
+      _mm_storeu_ps(a->buffer + a->bufidx,
+            _mm_add_ps(in, _mm_mul_ps(bufout, feedback)));
+      _mm_storeu_ps(mono + t, _mm_sub_ps(bufout, in));
+
+      a->bufidx += 4;
+      if (a->bufidx >= a->bufsize)
+         a->bufidx = 0;
+
+      t += 4;
+   }
+}
+
+static void revmodel_process_sse(struct revmodel *rev, float *out,
+      unsigned frames)
+{
+   unsigned t;
+   float in[REVERB_BLOCK];
+   float input[REVERB_BLOCK];
+   float mono[REVERB_BLOCK];
+
+   for (t = 0; t < frames; t++)
+   {
+      in[t]    = out[t << 1];
+      input[t] = in[t] * rev->gain;
+      mono[t]  = 0.0f;
+   }
+
+   revmodel_combs_sse(&rev->combL[0], mono, input, frames);
+   revmodel_combs_sse(&rev->combL[4], mono, input, frames);
+
+   for (t = 0; t < numallpasses; t++)
+      revmodel_allpass_sse(&rev->allpassL[t], mono, frames);
+
+   for (t = 0; t < frames; t++)
+      out[t << 1] = in[t] * rev->dry + mono[t] * rev->wet1;
+}
+
+/* Same arithmetic in the same order as reverb_process(), so output
+ * is bit-identical; work is just regrouped into blocks of frames. */
+static void reverb_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float *out;
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples         = input->samples;
+   output->frames          = input->frames;
+   out                     = output->samples;
+
+   for (i = 0; i < input->frames; i += REVERB_BLOCK)
+   {
+      unsigned frames = MIN(REVERB_BLOCK, input->frames - i);
+
+      revmodel_process_sse(&rev->left, out + (i << 1), frames);
+      revmodel_process_sse(&rev->right, out + (i << 1) + 1, frames);
+   }
+}
+#endif
+
 static void *reverb_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -303,12 +475,28 @@ static const struct dspfilter_implementation reverb_plug = {
    "reverb",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation reverb_plug_sse = {
+   reverb_init,
+   reverb_process_sse,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb",
+   "reverb",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation reverb_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &reverb_plug_sse;
+#endif
    (void)mask;
    return &reverb_plug;
 }
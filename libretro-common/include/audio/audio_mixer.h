@@ -51,6 +51,15 @@ typedef struct audio_mixer_voice audio_mixer_voice_t;
 
 typedef void (*audio_mixer_stop_cb_t)(audio_mixer_sound_t* sound, unsigned reason);
 
+typedef struct audio_mixer_stats
+{
+   /* Number of times a stream decoded on the decoder thread had less
+    * audio ready than audio_mixer_mix() asked for, and the frames of
+    * silence mixed in for it. */
+   unsigned underruns;
+   unsigned underrun_frames;
+} audio_mixer_stats_t;
+
 /* Reasons passed to the stop callback. */
 #define AUDIO_MIXER_SOUND_FINISHED 0
 #define AUDIO_MIXER_SOUND_STOPPED  1
@@ -60,6 +69,18 @@ void audio_mixer_init(unsigned rate);
 
 void audio_mixer_done(void);
 
+/* With HAVE_THREADS, ogg, mod, flac and mp3 voices are decoded a few
+ * hundred milliseconds ahead on a worker thread, leaving
+ * audio_mixer_mix() to add up ready samples. Passing false makes
+ * voices played from then on decode inside audio_mixer_mix() instead,
+ * as they always do on targets audio_mixer.c has no memory barrier
+ * for.
+ * Stop callbacks are always run by audio_mixer_mix() and
+ * audio_mixer_stop(), never on the worker. */
+void audio_mixer_set_threaded(bool threaded);
+
+void audio_mixer_get_stats(audio_mixer_stats_t *stats);
+
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size);
 audio_mixer_sound_t* audio_mixer_load_ogg(void *buffer, int32_t size);
 audio_mixer_sound_t* audio_mixer_load_mod(void *buffer, int32_t size);
@@ -44,6 +44,9 @@ struct retro_dsp_data
    unsigned output_frames;
 };
 
+/* Batches longer than the preset's "block_frames" (default 256) are
+ * run through the whole chain one block at a time, so the samples
+ * stay in cache between filters. "block_frames = 0" disables this. */
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data);
 
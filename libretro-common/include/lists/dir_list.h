@@ -29,6 +29,52 @@
 
 RETRO_BEGIN_DECLS
 
+/* Set of allowed file extensions, hashed so that checking a file
+ * does not depend on the number of extensions. */
+struct dir_list_filter;
+
+/**
+ * dir_list_filter_new:
+ * @ext                : allowed extensions, separated by '|', with
+ *                       or without the leading dot.
+ *
+ * Returns: filter for dir_list_filter_match(), NULL on error.
+ **/
+struct dir_list_filter *dir_list_filter_new(const char *ext);
+
+void dir_list_filter_free(struct dir_list_filter *filter);
+
+/**
+ * dir_list_filter_match:
+ * @filter             : from dir_list_filter_new().
+ * @ext                : extension of a file, without the dot.
+ *
+ * Returns: true if @ext is one of the allowed extensions,
+ * ignoring case.
+ **/
+bool dir_list_filter_match(const struct dir_list_filter *filter,
+      const char *ext);
+
+/**
+ * dir_list_read_entries:
+ * @list               : existing list to append to.
+ * @dirs               : list to append the subdirectories of @dir to.
+ * @dir                : directory path.
+ * @filter             : the extensions to include, NULL for all
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
+ *
+ * Lists a single directory, leaving it to the caller to descend
+ * into @dirs.
+ *
+ * Returns: true success, false in case of error.
+ **/
+bool dir_list_read_entries(struct string_list *list,
+      struct string_list *dirs, const char *dir,
+      const struct dir_list_filter *filter, bool include_dirs,
+      bool include_hidden, bool include_compressed);
+
 /**
  * dir_list_append:
  * @list               : existing list to append to.
@@ -0,0 +1,78 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dir_walk.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_DIR_WALK_H
+#define __LIBRETRO_SDK_DIR_WALK_H
+
+#include <retro_common_api.h>
+
+#include <boolean.h>
+#include <lists/string_list.h>
+
+RETRO_BEGIN_DECLS
+
+/* Enough to hide the latency of SD cards and network shares */
+#define DIR_WALK_DEFAULT_THREADS 4
+
+typedef struct dir_walk dir_walk_t;
+
+/**
+ * dir_walk_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the listing?
+ * @include_hidden     : include hidden files and directories as part of the listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ * @recursive          : list directory contents recursively
+ * @threads            : number of threads listing directories. With 0
+ *                       (or without HAVE_THREADS) they are listed by
+ *                       dir_walk_next() as needed.
+ *
+ * Lists a directory like dir_list_new(), but hands out the entries one
+ * directory at a time while the rest are still being listed, so the
+ * caller can start working before the whole tree was walked.
+ *
+ * Returns: the walk, NULL if @dir is not a directory.
+ **/
+dir_walk_t *dir_walk_new(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed,
+      bool recursive, unsigned threads);
+
+/**
+ * dir_walk_next:
+ * @walk               : the walk.
+ *
+ * Waits for the next directory with entries to include. Directories
+ * are handed out in no particular order; their entries in the order
+ * they were read.
+ *
+ * Returns: the entries, to be freed with string_list_free(), or NULL
+ * once the walk is done.
+ **/
+struct string_list *dir_walk_next(dir_walk_t *walk);
+
+/* Stops the walk and frees it. */
+void dir_walk_free(dir_walk_t *walk);
+
+RETRO_END_DECLS
+
+#endif
@@ -50,6 +50,9 @@ typedef struct file_list
 
    size_t capacity;
    size_t size;
+   /* Owns the strings of the entries, see file_list_use_string_pool().
+    * NULL when they are allocated one by one. */
+   struct string_pool *pool;
 } file_list_t;
 
 void *file_list_get_userdata_at_offset(const file_list_t *list,
@@ -82,6 +85,21 @@ void file_list_free(file_list_t *list);
  */
 bool file_list_reserve(file_list_t *list, size_t nitems);
 
+/**
+ * @brief makes the list copy the path, label and alt of its
+ * entries into a string pool, freed at once by file_list_clear()
+ * and file_list_free()
+ *
+ * Only for lists whose strings are never freed or replaced other
+ * than through this API. Must be called while the list is empty.
+ *
+ * @param list
+ * @param intern store equal strings only once, they must then
+ * not be modified
+ * @return whether or not the operation succeeded
+ */
+bool file_list_use_string_pool(file_list_t *list, bool intern);
+
 bool file_list_append(file_list_t *userdata, const char *path,
       const char *label, unsigned type, size_t current_directory_ptr,
       size_t entry_index);
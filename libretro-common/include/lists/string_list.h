@@ -31,6 +31,44 @@
 
 RETRO_BEGIN_DECLS
 
+/* Strings copied into a few large blocks, which are freed all at
+ * once. Optionally interned, so that equal strings are only stored
+ * once; interned strings must not be modified. */
+struct string_pool;
+
+/**
+ * string_pool_new:
+ * @intern           : return the same copy for equal strings.
+ *
+ * Returns: new string pool if successful, otherwise NULL.
+ */
+struct string_pool *string_pool_new(bool intern);
+
+void string_pool_free(struct string_pool *pool);
+
+/**
+ * string_pool_clear:
+ * @pool             : pointer to string pool
+ *
+ * Frees all strings of @pool at once, keeping the last
+ * block for reuse.
+ */
+void string_pool_clear(struct string_pool *pool);
+
+/**
+ * string_pool_strndup:
+ * @pool             : pointer to string pool
+ * @str              : string to copy
+ * @len              : length of @str, without terminator.
+ *
+ * Returns: NUL-terminated copy of @str owned by @pool,
+ * NULL on allocation failure.
+ */
+char *string_pool_strndup(struct string_pool *pool,
+      const char *str, size_t len);
+
+char *string_pool_strdup(struct string_pool *pool, const char *str);
+
 union string_list_elem_attr
 {
    bool  b;
@@ -50,6 +88,9 @@ struct string_list
    struct string_list_elem *elems;
    size_t size;
    size_t cap;
+   /* Owns the data of the elements, see string_list_use_string_pool().
+    * NULL when they are allocated one by one. */
+   struct string_pool *pool;
 };
 
 /**
@@ -110,6 +151,21 @@ struct string_list *string_separate(char *str, const char *delim);
  */
 struct string_list *string_list_new(void);
 
+/**
+ * string_list_use_string_pool:
+ * @list             : pointer to string list, still empty.
+ *
+ * Makes @list copy the data of its elements into a string
+ * pool, freed at once by string_list_free(), instead of
+ * allocating each one.
+ *
+ * Only for lists whose data is never freed, replaced or taken
+ * over other than through this API.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ */
+bool string_list_use_string_pool(struct string_list *list);
+
 /**
  * string_list_append:
  * @list             : pointer to string list
@@ -141,7 +197,7 @@ bool string_list_append_n(struct string_list *list, const char *elem,
  * string_list_free
  * @list             : pointer to string list object
  *
- * Frees a string list.
+ * Frees a string list, along with the data of its elements.
  */
 void string_list_free(struct string_list *list);
 
@@ -162,9 +218,10 @@ void string_list_join_concat(char *buffer, size_t size,
  * string_list_set:
  * @list             : pointer to string list
  * @idx              : index of element in string list
- * @str              : value for the element.
+ * @str              : value for the element, or NULL.
  *
- * Set value of element inside string list.
+ * Set value of element inside string list. The previous
+ * value stays allocated until the list is freed.
  **/
 void string_list_set(struct string_list *list, unsigned idx,
       const char *str);
@@ -0,0 +1,130 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_QUEUE_H
+#define __LIBRETRO_SDK_SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Lock-free byte ring for exactly one producer thread and one consumer
+ * thread. Unlike fifo_buffer_t it needs no external lock: each side
+ * owns one index, published with release/acquire ordering, and the two
+ * indices live on separate cache lines. A lock (or an eventfd) is only
+ * involved when one side actually has to sleep.
+ *
+ * Functions marked "producer" may only be called from the producing
+ * thread, and "consumer" ones from the consuming thread. */
+
+/* Sleep and wake up through an eventfd instead of a mutex and condition
+ * variable, so waking the other side never takes a lock. Ignored where
+ * eventfd is unavailable. */
+#define SPSC_QUEUE_EVENTFD (1 << 0)
+
+typedef struct spsc_queue spsc_queue_t;
+
+/**
+ * spsc_queue_new:
+ * @size               : Capacity in bytes; all of it is usable.
+ * @flags              : SPSC_QUEUE_* flags.
+ *
+ * Returns: new queue, or NULL on allocation failure.
+ **/
+spsc_queue_t *spsc_queue_new(size_t size, unsigned flags);
+
+void spsc_queue_free(spsc_queue_t *queue);
+
+/* Empties the queue. Neither side may be using it at the time. */
+void spsc_queue_clear(spsc_queue_t *queue);
+
+/* Producer: number of bytes that can be written right now. */
+size_t spsc_queue_write_avail(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_write_span:
+ * @queue              : Queue.
+ * @data               : Set to where the next bytes go.
+ *
+ * Producer: zero-copy access to the free space. Data written to *data
+ * becomes visible to the consumer with spsc_queue_write_commit().
+ *
+ * Returns: number of contiguous bytes available at *data. There may be
+ * more free space at the start of the ring once these are committed.
+ **/
+size_t spsc_queue_write_span(spsc_queue_t *queue, void **data);
+
+/* Producer: publishes @size bytes written through
+ * spsc_queue_write_span() and wakes a sleeping consumer. */
+void spsc_queue_write_commit(spsc_queue_t *queue, size_t size);
+
+/* Producer: copies in as much of @data as fits.
+ * Returns the number of bytes written. */
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t size);
+
+/* Consumer: number of bytes that can be read right now. */
+size_t spsc_queue_read_avail(spsc_queue_t *queue);
+
+/* Consumer: zero-copy counterpart of spsc_queue_write_span(). The
+ * bytes at *data stay valid until they are released with
+ * spsc_queue_read_commit(). */
+size_t spsc_queue_read_span(spsc_queue_t *queue, const void **data);
+
+/* Consumer: releases @size bytes and wakes a sleeping producer. */
+void spsc_queue_read_commit(spsc_queue_t *queue, size_t size);
+
+/* Consumer: copies out up to @size bytes.
+ * Returns the number of bytes read. */
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t size);
+
+/**
+ * spsc_queue_wait_write:
+ * @queue              : Queue.
+ * @size               : Free space needed, at most the capacity.
+ * @timeout_us         : Longest time to sleep, negative to wait until
+ *                       the space is there.
+ *
+ * Producer: sleeps until @size bytes can be written, the timeout
+ * elapses or spsc_queue_interrupt() is called. With a timeout, it may
+ * also return early on a spurious wakeup.
+ *
+ * Returns: true if @size bytes can be written.
+ **/
+bool spsc_queue_wait_write(spsc_queue_t *queue, size_t size,
+      int64_t timeout_us);
+
+/* Consumer: same as spsc_queue_wait_write(), waiting for @size bytes
+ * to read. */
+bool spsc_queue_wait_read(spsc_queue_t *queue, size_t size,
+      int64_t timeout_us);
+
+/* Either side or a third thread: makes current and future waits
+ * return right away, typically before shutting the other side down. */
+void spsc_queue_interrupt(spsc_queue_t *queue);
+
+RETRO_END_DECLS
+
+#endif
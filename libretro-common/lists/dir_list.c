@@ -21,6 +21,8 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -38,6 +40,16 @@
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 
+struct dir_list_filter
+{
+   /* Extensions without the leading dot */
+   char **exts;
+   /* Open addressing over exts, index + 1, 0 when empty */
+   unsigned *table;
+   unsigned count;
+   unsigned table_size;
+};
+
 static int qstrcmp_plain(const void *a_, const void *b_)
 {
    const struct string_list_elem *a = (const struct string_list_elem*)a_;
@@ -86,11 +98,124 @@ void dir_list_free(struct string_list *list)
    string_list_free(list);
 }
 
+/* FNV-1a of the lowercase @ext */
+static uint32_t dir_list_filter_hash(const char *ext)
+{
+   uint32_t hash = 2166136261u;
+
+   while (*ext)
+   {
+      hash ^= (uint8_t)tolower((unsigned char)*ext++);
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+/**
+ * dir_list_filter_new:
+ * @ext                : allowed extensions, separated by '|', with
+ *                       or without the leading dot.
+ *
+ * Returns: filter for dir_list_filter_match(), NULL on error.
+ **/
+struct dir_list_filter *dir_list_filter_new(const char *ext)
+{
+   unsigned i;
+   struct string_list *ext_list   = string_split(ext, "|");
+   struct dir_list_filter *filter = (struct dir_list_filter*)
+      calloc(1, sizeof(*filter));
+
+   if (!ext_list || !filter)
+      goto error;
+
+   /* Keep the table at most half full */
+   filter->table_size = 16;
+   while (filter->table_size < ext_list->size * 2)
+      filter->table_size *= 2;
+
+   filter->exts  = (char**)calloc(ext_list->size + 1, sizeof(char*));
+   filter->table = (unsigned*)calloc(filter->table_size, sizeof(unsigned));
+
+   if (!filter->exts || !filter->table)
+      goto error;
+
+   for (i = 0; i < ext_list->size; i++)
+   {
+      unsigned j;
+      const char *name = ext_list->elems[i].data;
+
+      if (*name == '.')
+         name++;
+
+      if (string_is_empty(name) || dir_list_filter_match(filter, name))
+         continue;
+
+      if (!(filter->exts[filter->count] = strdup(name)))
+         goto error;
+
+      j = dir_list_filter_hash(name) & (filter->table_size - 1);
+      while (filter->table[j])
+         j = (j + 1) & (filter->table_size - 1);
+
+      filter->table[j] = ++filter->count;
+   }
+
+   string_list_free(ext_list);
+   return filter;
+
+error:
+   string_list_free(ext_list);
+   dir_list_filter_free(filter);
+   return NULL;
+}
+
+void dir_list_filter_free(struct dir_list_filter *filter)
+{
+   unsigned i;
+
+   if (!filter)
+      return;
+
+   for (i = 0; i < filter->count; i++)
+      free(filter->exts[i]);
+
+   free(filter->exts);
+   free(filter->table);
+   free(filter);
+}
+
+/**
+ * dir_list_filter_match:
+ * @filter             : from dir_list_filter_new().
+ * @ext                : extension of a file, without the dot.
+ *
+ * Returns: true if @ext is one of the allowed extensions,
+ * ignoring case.
+ **/
+bool dir_list_filter_match(const struct dir_list_filter *filter,
+      const char *ext)
+{
+   unsigned i;
+
+   if (!filter || !ext)
+      return false;
+
+   for (i = dir_list_filter_hash(ext) & (filter->table_size - 1);
+         filter->table[i]; i = (i + 1) & (filter->table_size - 1))
+      if (string_is_equal_noncase(filter->exts[filter->table[i] - 1], ext))
+         return true;
+
+   return false;
+}
+
 /**
  * dir_list_read:
  * @dir                : directory path.
  * @list               : the string list to add files to
- * @ext_list           : the string list of extensions to include
+ * @dirs               : if not NULL, subdirectories are added to it
+ *                       instead of being listed recursively
+ * @filter             : the extensions to include, NULL for all
  * @include_dirs       : include directories as part of the finished directory listing?
  * @include_hidden     : include hidden files and directories as part of the finished directory listing?
  * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
@@ -101,7 +226,8 @@ void dir_list_free(struct string_list *list)
  * Returns: -1 on error, 0 on success.
  **/
 static int dir_list_read(const char *dir,
-      struct string_list *list, struct string_list *ext_list,
+      struct string_list *list, struct string_list *dirs,
+      const struct dir_list_filter *filter,
       bool include_dirs, bool include_hidden,
       bool include_compressed, bool recursive)
 {
@@ -137,13 +263,19 @@ static int dir_list_read(const char *dir,
 
       if (retro_dirent_is_dir(entry, NULL))
       {
-         if (recursive)
-            dir_list_read(file_path, list, ext_list, include_dirs,
+         attr.i = RARCH_DIRECTORY;
+
+         if (dirs)
+         {
+            if (!string_list_append(dirs, file_path, attr))
+               goto error;
+         }
+         else if (recursive)
+            dir_list_read(file_path, list, NULL, filter, include_dirs,
                   include_hidden, include_compressed, recursive);
 
          if (!include_dirs)
             continue;
-         attr.i = RARCH_DIRECTORY;
       }
       else
       {
@@ -159,7 +291,7 @@ static int dir_list_read(const char *dir,
           * compressed_file. In that case, we have to interpret it as a image.
           *
           * */
-         if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+         if (dir_list_filter_match(filter, file_ext))
             attr.i            = RARCH_PLAIN_FILE;
          else
          {
@@ -167,7 +299,7 @@ static int dir_list_read(const char *dir,
             if ((is_compressed_file = path_is_compressed_file(file_path)))
                attr.i               = RARCH_COMPRESSED_ARCHIVE;
 
-            if (ext_list &&
+            if (filter &&
                   (!is_compressed_file || !include_compressed))
                continue;
          }
@@ -187,6 +319,30 @@ error:
    return -1;
 }
 
+/**
+ * dir_list_read_entries:
+ * @list               : existing list to append to.
+ * @dirs               : list to append the subdirectories of @dir to.
+ * @dir                : directory path.
+ * @filter             : the extensions to include, NULL for all
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
+ *
+ * Lists a single directory, leaving it to the caller to descend
+ * into @dirs.
+ *
+ * Returns: true success, false in case of error.
+ **/
+bool dir_list_read_entries(struct string_list *list,
+      struct string_list *dirs, const char *dir,
+      const struct dir_list_filter *filter, bool include_dirs,
+      bool include_hidden, bool include_compressed)
+{
+   return dir_list_read(dir, list, dirs, filter,
+         include_dirs, include_hidden, include_compressed, false) != -1;
+}
+
 /**
  * dir_list_append:
  * @list               : existing list to append to.
@@ -207,11 +363,16 @@ bool dir_list_append(struct string_list *list,
       bool include_hidden, bool include_compressed,
       bool recursive)
 {
-   struct string_list *ext_list   = ext ? string_split(ext, "|") : NULL;
-   bool ret                       = dir_list_read(dir, list, ext_list,
+   bool ret                       = false;
+   struct dir_list_filter *filter = NULL;
+
+   if (ext && !(filter = dir_list_filter_new(ext)))
+      return false;
+
+   ret = dir_list_read(dir, list, NULL, filter,
          include_dirs, include_hidden, include_compressed, recursive) != -1;
 
-   string_list_free(ext_list);
+   dir_list_filter_free(filter);
 
    return ret;
 }
@@ -240,7 +401,8 @@ struct string_list *dir_list_new(const char *dir,
    if (!(list = string_list_new()))
       return NULL;
 
-   if (!dir_list_append(list, dir, ext, include_dirs,
+   if (     !string_list_use_string_pool(list)
+         || !dir_list_append(list, dir, ext, include_dirs,
             include_hidden, include_compressed, recursive))
    {
       string_list_free(list);
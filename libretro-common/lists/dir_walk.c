@@ -0,0 +1,321 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dir_walk.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/dir_walk.h>
+#include <retro_miscellaneous.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* Listed directories waiting for dir_walk_next() before the threads
+ * stop listing more, bounding memory when the caller is slower */
+#define DIR_WALK_MAX_PENDING 64
+
+struct dir_walk_batch
+{
+   struct string_list *list;
+   struct dir_walk_batch *next;
+};
+
+struct dir_walk
+{
+   struct dir_list_filter *filter;
+   /* Directories still to be listed. Taken over one by one as they
+    * are listed, so no string pool. */
+   struct string_list *dirs;
+   struct dir_walk_batch *head;
+   struct dir_walk_batch *tail;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   /* Signalled whenever any of the below changes */
+   scond_t *cond;
+   sthread_t **threads;
+#endif
+   unsigned num_threads;
+   unsigned pending;
+   /* Directories being listed right now */
+   unsigned busy;
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+   bool recursive;
+   bool cancelled;
+};
+
+static void dir_walk_lock(dir_walk_t *walk)
+{
+#ifdef HAVE_THREADS
+   if (walk->lock)
+      slock_lock(walk->lock);
+#endif
+}
+
+static void dir_walk_unlock(dir_walk_t *walk)
+{
+#ifdef HAVE_THREADS
+   if (walk->lock)
+      slock_unlock(walk->lock);
+#endif
+}
+
+static void dir_walk_wait(dir_walk_t *walk)
+{
+#ifdef HAVE_THREADS
+   scond_wait(walk->cond, walk->lock);
+#endif
+}
+
+static void dir_walk_signal(dir_walk_t *walk)
+{
+#ifdef HAVE_THREADS
+   if (walk->cond)
+      scond_broadcast(walk->cond);
+#endif
+}
+
+/* Lists the last directory in walk->dirs. Called, and returns, with
+ * the lock held; it is released while reading the directory. */
+static void dir_walk_list_one(dir_walk_t *walk)
+{
+   struct string_list *list = string_list_new();
+   struct string_list *dirs = walk->recursive ? string_list_new() : NULL;
+   char *dir                = walk->dirs->elems[walk->dirs->size - 1].data;
+
+   walk->dirs->size--;
+   walk->busy++;
+   dir_walk_unlock(walk);
+
+   if (list)
+      string_list_use_string_pool(list);
+   if (dirs)
+      string_list_use_string_pool(dirs);
+
+   if (list && (dirs || !walk->recursive))
+      dir_list_read_entries(list, dirs, dir, walk->filter,
+            walk->include_dirs, walk->include_hidden,
+            walk->include_compressed);
+   free(dir);
+
+   dir_walk_lock(walk);
+
+   if (dirs)
+   {
+      size_t i;
+
+      /* A path that filled the buffer was truncated, most likely
+       * while following a symlink loop */
+      for (i = 0; i < dirs->size; i++)
+         if (strlen(dirs->elems[i].data) < PATH_MAX_LENGTH - 1)
+            string_list_append(walk->dirs,
+                  dirs->elems[i].data, dirs->elems[i].attr);
+      string_list_free(dirs);
+   }
+
+   if (list && list->size)
+   {
+      struct dir_walk_batch *batch = (struct dir_walk_batch*)
+         malloc(sizeof(*batch));
+
+      if (batch)
+      {
+         batch->list = list;
+         batch->next = NULL;
+         list        = NULL;
+
+         if (walk->tail)
+            walk->tail->next = batch;
+         else
+            walk->head       = batch;
+
+         walk->tail          = batch;
+         walk->pending++;
+      }
+   }
+
+   string_list_free(list);
+
+   walk->busy--;
+   dir_walk_signal(walk);
+}
+
+#ifdef HAVE_THREADS
+static void dir_walk_thread(void *data)
+{
+   dir_walk_t *walk = (dir_walk_t*)data;
+
+   dir_walk_lock(walk);
+
+   while (!walk->cancelled && (walk->dirs->size || walk->busy))
+   {
+      if (walk->dirs->size && walk->pending < DIR_WALK_MAX_PENDING)
+         dir_walk_list_one(walk);
+      else
+         dir_walk_wait(walk);
+   }
+
+   dir_walk_unlock(walk);
+}
+#endif
+
+dir_walk_t *dir_walk_new(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed,
+      bool recursive, unsigned threads)
+{
+   union string_list_elem_attr attr;
+   dir_walk_t *walk = NULL;
+
+   if (!path_is_directory(dir))
+      return NULL;
+
+   if (!(walk = (dir_walk_t*)calloc(1, sizeof(*walk))))
+      return NULL;
+
+   walk->include_dirs       = include_dirs;
+   walk->include_hidden     = include_hidden;
+   walk->include_compressed = include_compressed;
+   walk->recursive          = recursive;
+   attr.i                   = 0;
+
+   if (ext && !(walk->filter = dir_list_filter_new(ext)))
+      goto error;
+
+   if (     !(walk->dirs = string_list_new())
+         || !string_list_append(walk->dirs, dir, attr))
+      goto error;
+
+#ifdef HAVE_THREADS
+   /* A single directory leaves nothing to do in parallel */
+   if (!recursive)
+      threads = 0;
+
+   if (threads)
+   {
+      unsigned i;
+
+      walk->lock    = slock_new();
+      walk->cond    = scond_new();
+      walk->threads = (sthread_t**)calloc(threads, sizeof(sthread_t*));
+
+      if (!walk->lock || !walk->cond || !walk->threads)
+         goto error;
+
+      for (i = 0; i < threads; i++)
+      {
+         if (!(walk->threads[i] = sthread_create(dir_walk_thread, walk)))
+            break;
+         walk->num_threads++;
+      }
+   }
+#endif
+
+   return walk;
+
+error:
+   dir_walk_free(walk);
+   return NULL;
+}
+
+struct string_list *dir_walk_next(dir_walk_t *walk)
+{
+   struct string_list *list = NULL;
+
+   if (!walk)
+      return NULL;
+
+   dir_walk_lock(walk);
+
+   for (;;)
+   {
+      if (walk->head)
+      {
+         struct dir_walk_batch *batch = walk->head;
+
+         if (!(walk->head = batch->next))
+            walk->tail = NULL;
+         walk->pending--;
+         dir_walk_signal(walk);
+
+         list = batch->list;
+         free(batch);
+         break;
+      }
+
+      if (!walk->dirs->size && !walk->busy)
+         break;
+
+      /* Without threads, or if they all quit early, the caller
+       * lists the next directory itself */
+      if (walk->dirs->size && !walk->num_threads)
+         dir_walk_list_one(walk);
+      else
+         dir_walk_wait(walk);
+   }
+
+   dir_walk_unlock(walk);
+
+   return list;
+}
+
+void dir_walk_free(dir_walk_t *walk)
+{
+   if (!walk)
+      return;
+
+#ifdef HAVE_THREADS
+   if (walk->lock)
+   {
+      unsigned i;
+
+      slock_lock(walk->lock);
+      walk->cancelled = true;
+      scond_broadcast(walk->cond);
+      slock_unlock(walk->lock);
+
+      for (i = 0; i < walk->num_threads; i++)
+         sthread_join(walk->threads[i]);
+   }
+
+   free(walk->threads);
+   if (walk->cond)
+      scond_free(walk->cond);
+   if (walk->lock)
+      slock_free(walk->lock);
+#endif
+
+   while (walk->head)
+   {
+      struct dir_walk_batch *batch = walk->head;
+
+      walk->head = batch->next;
+      string_list_free(batch->list);
+      free(batch);
+   }
+
+   string_list_free(walk->dirs);
+   dir_list_filter_free(walk->filter);
+   free(walk);
+}
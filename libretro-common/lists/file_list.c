@@ -26,6 +26,7 @@
 
 #include <retro_common.h>
 #include <lists/file_list.h>
+#include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <compat/strcasestr.h>
 
@@ -50,6 +51,27 @@ bool file_list_reserve(file_list_t *list, size_t nitems)
    return true;
 }
 
+bool file_list_use_string_pool(file_list_t *list, bool intern)
+{
+   if (list->size || list->pool)
+      return false;
+
+   return (list->pool = string_pool_new(intern)) != NULL;
+}
+
+static char *file_list_strdup(file_list_t *list, const char *str)
+{
+   if (list->pool)
+      return string_pool_strdup(list->pool, str);
+   return strdup(str);
+}
+
+static void file_list_free_string(file_list_t *list, char *str)
+{
+   if (!list->pool)
+      free(str);
+}
+
 bool file_list_prepend(file_list_t *list,
       const char *path, const char *label,
       unsigned type, size_t directory_ptr,
@@ -68,34 +90,14 @@ bool file_list_insert(file_list_t *list,
       size_t entry_idx,
       size_t idx)
 {
-   int i;
-
    /* Expand file list if needed */
    if (list->size >= list->capacity)
       if (!file_list_reserve(list, list->capacity * 2 + 1))
          return false;
 
-   for (i = (unsigned)list->size; i > (int)idx; i--)
-   {
-      struct item_file *copy = (struct item_file*)
-         malloc(sizeof(struct item_file));
-
-      copy->path             = NULL;
-      copy->label            = NULL;
-      copy->alt              = NULL;
-      copy->type             = 0;
-      copy->directory_ptr    = 0;
-      copy->entry_idx        = 0;
-      copy->userdata         = NULL;
-      copy->actiondata       = NULL;
-
-      memcpy(copy, &list->list[i-1], sizeof(struct item_file));
-
-      memcpy(&list->list[i-1], &list->list[i], sizeof(struct item_file));
-      memcpy(&list->list[i],             copy, sizeof(struct item_file));
-
-      free(copy);
-   }
+   if (idx < list->size)
+      memmove(&list->list[idx + 1], &list->list[idx],
+            (list->size - idx) * sizeof(struct item_file));
 
    list->list[idx].path          = NULL;
    list->list[idx].label         = NULL;
@@ -107,9 +109,9 @@ bool file_list_insert(file_list_t *list,
    list->list[idx].actiondata    = NULL;
 
    if (label)
-      list->list[idx].label      = strdup(label);
+      list->list[idx].label      = file_list_strdup(list, label);
    if (path)
-      list->list[idx].path       = strdup(path);
+      list->list[idx].path       = file_list_strdup(list, path);
 
    list->size++;
 
@@ -137,9 +139,9 @@ bool file_list_append(file_list_t *list,
    list->list[idx].actiondata    = NULL;
 
    if (label)
-      list->list[idx].label      = strdup(label);
+      list->list[idx].label      = file_list_strdup(list, label);
    if (path)
-      list->list[idx].path       = strdup(path);
+      list->list[idx].path       = file_list_strdup(list, path);
 
    list->size++;
 
@@ -168,12 +170,16 @@ void file_list_pop(file_list_t *list, size_t *directory_ptr)
    {
       --list->size;
       if (list->list[list->size].path)
-         free(list->list[list->size].path);
+         file_list_free_string(list, list->list[list->size].path);
       list->list[list->size].path = NULL;
 
       if (list->list[list->size].label)
-         free(list->list[list->size].label);
+         file_list_free_string(list, list->list[list->size].label);
       list->list[list->size].label = NULL;
+
+      if (list->list[list->size].alt)
+         file_list_free_string(list, list->list[list->size].alt);
+      list->list[list->size].alt = NULL;
    }
 
    if (directory_ptr)
@@ -193,20 +199,22 @@ void file_list_free(file_list_t *list)
       file_list_free_actiondata(list, i);
 
       if (list->list[i].path)
-         free(list->list[i].path);
+         file_list_free_string(list, list->list[i].path);
       list->list[i].path = NULL;
 
       if (list->list[i].label)
-         free(list->list[i].label);
+         file_list_free_string(list, list->list[i].label);
       list->list[i].label = NULL;
 
       if (list->list[i].alt)
-         free(list->list[i].alt);
+         file_list_free_string(list, list->list[i].alt);
       list->list[i].alt = NULL;
    }
    if (list->list)
       free(list->list);
+   string_pool_free(list->pool);
    list->list = NULL;
+   list->pool = NULL;
    free(list);
 }
 
@@ -217,6 +225,14 @@ void file_list_clear(file_list_t *list)
    if (!list)
       return;
 
+   /* Entries are initialized again when appended */
+   if (list->pool)
+   {
+      string_pool_clear(list->pool);
+      list->size = 0;
+      return;
+   }
+
    for (i = 0; i < list->size; i++)
    {
       if (list->list[i].path)
@@ -242,11 +258,15 @@ void file_list_set_label_at_offset(file_list_t *list, size_t idx,
       return;
 
    if (list->list[idx].label)
-      free(list->list[idx].label);
+      file_list_free_string(list, list->list[idx].label);
+   list->list[idx].label    = NULL;
+
+   if (list->list[idx].alt)
+      file_list_free_string(list, list->list[idx].alt);
    list->list[idx].alt      = NULL;
 
    if (label)
-      list->list[idx].label = strdup(label);
+      list->list[idx].label = file_list_strdup(list, label);
 }
 
 void file_list_get_label_at_offset(const file_list_t *list, size_t idx,
@@ -267,11 +287,11 @@ void file_list_set_alt_at_offset(file_list_t *list, size_t idx,
       return;
 
    if (list->list[idx].alt)
-      free(list->list[idx].alt);
+      file_list_free_string(list, list->list[idx].alt);
    list->list[idx].alt      = NULL;
 
    if (alt)
-      list->list[idx].alt   = strdup(alt);
+      list->list[idx].alt   = file_list_strdup(list, alt);
 }
 
 static int file_list_alt_cmp(const void *a_, const void *b_)
@@ -29,11 +29,254 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 
+/* First block of a pool, doubled up to the maximum */
+#define STRING_POOL_MIN_BLOCK 256
+#define STRING_POOL_MAX_BLOCK (64 * 1024)
+
+struct string_pool_block
+{
+   struct string_pool_block *next;
+   size_t size;
+   size_t used;
+   /* Followed by the strings */
+};
+
+struct string_pool
+{
+   struct string_pool_block *blocks;
+   /* Interned strings by hash, open addressing, at most half full */
+   char **interned;
+   uint32_t *hashes;
+   size_t interned_cap;
+   size_t interned_count;
+   size_t block_size;
+   bool intern;
+};
+
+struct string_pool *string_pool_new(bool intern)
+{
+   struct string_pool *pool = (struct string_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->block_size = STRING_POOL_MIN_BLOCK;
+   pool->intern     = intern;
+   return pool;
+}
+
+static void string_pool_free_blocks(struct string_pool_block *block)
+{
+   while (block)
+   {
+      struct string_pool_block *next = block->next;
+      free(block);
+      block = next;
+   }
+}
+
+void string_pool_free(struct string_pool *pool)
+{
+   if (!pool)
+      return;
+
+   string_pool_free_blocks(pool->blocks);
+   free(pool->interned);
+   free(pool->hashes);
+   free(pool);
+}
+
+void string_pool_clear(struct string_pool *pool)
+{
+   if (!pool)
+      return;
+
+   if (pool->blocks)
+   {
+      string_pool_free_blocks(pool->blocks->next);
+      pool->blocks->next = NULL;
+      pool->blocks->used = 0;
+   }
+
+   if (pool->interned_count)
+   {
+      memset(pool->interned, 0, pool->interned_cap * sizeof(*pool->interned));
+      pool->interned_count = 0;
+   }
+}
+
+static char *string_pool_alloc(struct string_pool *pool, size_t len)
+{
+   char *s;
+   struct string_pool_block *block = pool->blocks;
+
+   if (!block || block->size - block->used < len)
+   {
+      size_t size = pool->block_size;
+
+      if (size < len)
+         size = len;
+
+      if (!(block = (struct string_pool_block*)
+               malloc(sizeof(*block) + size)))
+         return NULL;
+
+      block->next  = pool->blocks;
+      block->size  = size;
+      block->used  = 0;
+      pool->blocks = block;
+
+      if (pool->block_size < STRING_POOL_MAX_BLOCK)
+         pool->block_size *= 2;
+   }
+
+   s            = (char*)(block + 1) + block->used;
+   block->used += len;
+   return s;
+}
+
+static uint32_t string_pool_hash(const char *str, size_t len)
+{
+   size_t i;
+   uint32_t hash = 2166136261u;
+
+   for (i = 0; i < len; i++)
+   {
+      hash ^= (uint8_t)str[i];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+static bool string_pool_grow_interned(struct string_pool *pool)
+{
+   size_t i;
+   size_t cap          = pool->interned_cap ? pool->interned_cap * 2 : 64;
+   char **interned     = (char**)calloc(cap, sizeof(*interned));
+   uint32_t *hashes    = (uint32_t*)malloc(cap * sizeof(*hashes));
+
+   if (!interned || !hashes)
+   {
+      free(interned);
+      free(hashes);
+      return false;
+   }
+
+   for (i = 0; i < pool->interned_cap; i++)
+   {
+      size_t j;
+
+      if (!pool->interned[i])
+         continue;
+
+      for (j = pool->hashes[i] & (cap - 1); interned[j]; j = (j + 1) & (cap - 1));
+
+      interned[j] = pool->interned[i];
+      hashes[j]   = pool->hashes[i];
+   }
+
+   free(pool->interned);
+   free(pool->hashes);
+   pool->interned     = interned;
+   pool->hashes       = hashes;
+   pool->interned_cap = cap;
+   return true;
+}
+
+char *string_pool_strndup(struct string_pool *pool,
+      const char *str, size_t len)
+{
+   char *s;
+   size_t i      = 0;
+   uint32_t hash = 0;
+
+   if (pool->intern)
+   {
+      if (     (pool->interned_count + 1) * 2 > pool->interned_cap
+            && !string_pool_grow_interned(pool))
+         return NULL;
+
+      hash = string_pool_hash(str, len);
+
+      for (i = hash & (pool->interned_cap - 1); pool->interned[i];
+            i = (i + 1) & (pool->interned_cap - 1))
+      {
+         if (     pool->hashes[i] == hash
+               && !strncmp(pool->interned[i], str, len)
+               && !pool->interned[i][len])
+            return pool->interned[i];
+      }
+   }
+
+   if (!(s = string_pool_alloc(pool, len + 1)))
+      return NULL;
+
+   memcpy(s, str, len);
+   s[len] = '\0';
+
+   if (pool->intern)
+   {
+      pool->interned[i] = s;
+      pool->hashes[i]   = hash;
+      pool->interned_count++;
+   }
+
+   return s;
+}
+
+char *string_pool_strdup(struct string_pool *pool, const char *str)
+{
+   return string_pool_strndup(pool, str, strlen(str));
+}
+
+/* Copies at most @len bytes of @str, into the pool of @list
+ * if it has one */
+static char *string_list_strndup(struct string_list *list,
+      const char *str, size_t len)
+{
+   char *s  = NULL;
+   size_t n = 0;
+
+   while (n < len && str[n])
+      n++;
+
+   if (list->pool)
+      return string_pool_strndup(list->pool, str, n);
+
+   if (!(s = (char*)malloc(n + 1)))
+      return NULL;
+
+   memcpy(s, str, n);
+   s[n] = '\0';
+   return s;
+}
+
+/**
+ * string_list_use_string_pool:
+ * @list             : pointer to string list
+ *
+ * Makes @list copy the data of its elements into a string pool.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool string_list_use_string_pool(struct string_list *list)
+{
+   if (list->size)
+      return false;
+
+   if (!list->pool && !(list->pool = string_pool_new(false)))
+      return false;
+
+   return true;
+}
+
 /**
  * string_list_free
  * @list             : pointer to string list object
  *
- * Frees a string list.
+ * Frees a string list, along with the data of its elements.
  */
 void string_list_free(struct string_list *list)
 {
@@ -45,7 +288,7 @@ void string_list_free(struct string_list *list)
    {
       for (i = 0; i < list->size; i++)
       {
-         if (list->elems[i].data)
+         if (!list->pool && list->elems[i].data)
             free(list->elems[i].data);
          if (list->elems[i].userdata)
             free(list->elems[i].userdata);
@@ -56,7 +299,10 @@ void string_list_free(struct string_list *list)
       free(list->elems);
    }
 
+   string_pool_free(list->pool);
+
    list->elems = NULL;
+   list->pool  = NULL;
    free(list);
 }
 
@@ -103,6 +349,7 @@ struct string_list *string_list_new(void)
    list->elems              = NULL;
    list->size               = 0;
    list->cap                = 0;
+   list->pool               = NULL;
 
    if (!string_list_capacity(list, 32))
    {
@@ -132,7 +379,7 @@ bool string_list_append(struct string_list *list, const char *elem,
          !string_list_capacity(list, list->cap * 2))
       return false;
 
-   data_dup = strdup(elem);
+   data_dup = string_list_strndup(list, elem, (size_t)-1);
    if (!data_dup)
       return false;
 
@@ -163,13 +410,11 @@ bool string_list_append_n(struct string_list *list, const char *elem,
          !string_list_capacity(list, list->cap * 2))
       return false;
 
-   data_dup = (char*)malloc(length + 1);
+   data_dup = string_list_strndup(list, elem, length);
 
    if (!data_dup)
       return false;
 
-   strlcpy(data_dup, elem, length + 1);
-
    list->elems[list->size].data = data_dup;
    list->elems[list->size].attr = attr;
 
@@ -181,15 +426,20 @@ bool string_list_append_n(struct string_list *list, const char *elem,
  * string_list_set:
  * @list             : pointer to string list
  * @idx              : index of element in string list
- * @str              : value for the element.
+ * @str              : value for the element, or NULL.
  *
- * Set value of element inside string list.
+ * Set value of element inside string list. With a string
+ * pool, the previous value stays allocated until the list
+ * is freed.
  **/
 void string_list_set(struct string_list *list,
       unsigned idx, const char *str)
 {
-   free(list->elems[idx].data);
-   list->elems[idx].data = strdup(str);
+   if (!list->pool)
+      free(list->elems[idx].data);
+   list->elems[idx].data = str
+      ? string_list_strndup(list, str, (size_t)-1)
+      : NULL;
 }
 
 /**
@@ -390,6 +640,7 @@ struct string_list *string_list_clone(
       return NULL;
 
    dest->elems            = NULL;
+   dest->pool             = NULL;
    dest->size             = src->size;
    dest->cap              = src->cap;
    if (dest->cap < dest->size)
@@ -406,6 +657,12 @@ struct string_list *string_list_clone(
 
    dest->elems            = elems;
 
+   if (src->pool && !(dest->pool = string_pool_new(false)))
+   {
+      string_list_free(dest);
+      return NULL;
+   }
+
    for (i = 0; i < src->size; i++)
    {
       const char *_src    = src->elems[i].data;
@@ -414,11 +671,11 @@ struct string_list *string_list_clone(
       dest->elems[i].data = NULL;
       dest->elems[i].attr = src->elems[i].attr;
 
-      if (len != 0)
+      if (len != 0 && !(dest->elems[i].data =
+               string_list_strndup(dest, _src, len)))
       {
-         char *result        = (char*)malloc(len + 1);
-         strcpy(result, _src);
-         dest->elems[i].data = result;
+         string_list_free(dest);
+         return NULL;
       }
    }
 
@@ -0,0 +1,453 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <memalign.h>
+#include <queues/spsc_queue.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(__linux__) && !defined(SPSC_QUEUE_NO_EVENTFD)
+#define SPSC_QUEUE_HAVE_EVENTFD
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define SPSC_LOAD(ptr)        __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SPSC_LOAD_LONG(ptr)   __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SPSC_STORE(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define SPSC_ADD(ptr, val)    __atomic_add_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+#define SPSC_FENCE()          __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__)
+#define SPSC_ADD(ptr, val)    __sync_add_and_fetch((ptr), (val))
+#define SPSC_FENCE()          __sync_synchronize()
+#elif defined(_XBOX360)
+/* Three weakly ordered cores */
+#include <xtl.h>
+#define SPSC_ADD(ptr, val)    InterlockedExchangeAdd((ptr), (val))
+#define SPSC_FENCE()          MemoryBarrier()
+#elif defined(_XBOX1)
+/* A single core: the interlocked call is only there to keep the
+ * compiler from moving accesses across the fence */
+#include <xtl.h>
+static volatile LONG spsc_fence_dummy;
+#define SPSC_ADD(ptr, val)    InterlockedExchangeAdd((ptr), (val))
+#define SPSC_FENCE()          InterlockedExchange(&spsc_fence_dummy, 0)
+#elif defined(_WIN32) && !defined(_XBOX)
+#include <windows.h>
+#define SPSC_ADD(ptr, val)    InterlockedExchangeAdd((ptr), (val))
+#define SPSC_FENCE()          MemoryBarrier()
+#elif defined(HAVE_THREADS)
+#error "spsc_queue: no atomic operations known for this compiler"
+#else
+/* Without threads, both ends run on the same thread */
+#define SPSC_ADD(ptr, val)    (*(ptr) += (val))
+#define SPSC_FENCE()
+#endif
+
+#ifndef SPSC_LOAD
+static INLINE size_t spsc_load(volatile size_t *ptr)
+{
+   size_t val = *ptr;
+   SPSC_FENCE();
+   return val;
+}
+
+static INLINE long spsc_load_long(volatile long *ptr)
+{
+   long val = *ptr;
+   SPSC_FENCE();
+   return val;
+}
+
+static INLINE void spsc_store(volatile size_t *ptr, size_t val)
+{
+   SPSC_FENCE();
+   *ptr = val;
+}
+
+#define SPSC_LOAD(ptr)        spsc_load(ptr)
+#define SPSC_LOAD_LONG(ptr)   spsc_load_long(ptr)
+#define SPSC_STORE(ptr, val)  spsc_store((ptr), (val))
+#endif
+
+#define SPSC_QUEUE_CACHE_LINE 64
+
+/* The side that waits, and gets woken up */
+enum spsc_queue_side
+{
+   SPSC_QUEUE_READER = 0,
+   SPSC_QUEUE_WRITER
+};
+
+/* Indices run over [0, 2 * size), which tells a full ring from an
+ * empty one without wasting a byte and works for any size. */
+typedef union spsc_queue_index
+{
+   volatile size_t pos;
+   uint8_t pad[SPSC_QUEUE_CACHE_LINE];
+} spsc_queue_index_t;
+
+struct spsc_queue
+{
+   /* Written by the producer only */
+   spsc_queue_index_t head;
+   /* Written by the consumer only */
+   spsc_queue_index_t tail;
+
+   uint8_t *buffer;
+   size_t size;
+
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+   /* One per side, so that a side going to sleep can never swallow
+    * the wakeup meant for the other one */
+   int fd[2];
+
+   /* Threads sleeping on each side, or about to */
+   volatile long waiters[2];
+   volatile long interrupted;
+};
+
+static INLINE size_t spsc_queue_used(const spsc_queue_t *queue,
+      size_t head, size_t tail)
+{
+   return head >= tail ? head - tail : head + 2 * queue->size - tail;
+}
+
+static INLINE size_t spsc_queue_offset(const spsc_queue_t *queue,
+      size_t pos)
+{
+   return pos >= queue->size ? pos - queue->size : pos;
+}
+
+static INLINE size_t spsc_queue_advance(const spsc_queue_t *queue,
+      size_t pos, size_t size)
+{
+   pos += size;
+   return pos >= 2 * queue->size ? pos - 2 * queue->size : pos;
+}
+
+spsc_queue_t *spsc_queue_new(size_t size, unsigned flags)
+{
+   spsc_queue_t *queue = (spsc_queue_t*)memalign_alloc(
+         SPSC_QUEUE_CACHE_LINE, sizeof(*queue));
+
+   if (!queue)
+      return NULL;
+
+   memset(queue, 0, sizeof(*queue));
+
+   queue->fd[0]  = -1;
+   queue->fd[1]  = -1;
+   queue->size   = size;
+   queue->buffer = (uint8_t*)malloc(size ? size : 1);
+
+   if (!queue->buffer)
+      goto error;
+
+#ifdef SPSC_QUEUE_HAVE_EVENTFD
+   if (flags & SPSC_QUEUE_EVENTFD)
+   {
+      queue->fd[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      queue->fd[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+      /* Fall back to the condition variable */
+      if (queue->fd[0] < 0 || queue->fd[1] < 0)
+      {
+         if (queue->fd[0] >= 0)
+            close(queue->fd[0]);
+         if (queue->fd[1] >= 0)
+            close(queue->fd[1]);
+         queue->fd[0] = queue->fd[1] = -1;
+      }
+   }
+#endif
+
+#ifdef HAVE_THREADS
+   if (queue->fd[0] < 0)
+   {
+      queue->lock = slock_new();
+      queue->cond = scond_new();
+
+      if (!queue->lock || !queue->cond)
+         goto error;
+   }
+#endif
+
+   return queue;
+
+error:
+   spsc_queue_free(queue);
+   return NULL;
+}
+
+void spsc_queue_free(spsc_queue_t *queue)
+{
+   if (!queue)
+      return;
+
+#ifdef SPSC_QUEUE_HAVE_EVENTFD
+   if (queue->fd[0] >= 0)
+      close(queue->fd[0]);
+   if (queue->fd[1] >= 0)
+      close(queue->fd[1]);
+#endif
+#ifdef HAVE_THREADS
+   if (queue->lock)
+      slock_free(queue->lock);
+   if (queue->cond)
+      scond_free(queue->cond);
+#endif
+
+   free(queue->buffer);
+   memalign_free(queue);
+}
+
+void spsc_queue_clear(spsc_queue_t *queue)
+{
+   queue->head.pos    = 0;
+   queue->tail.pos    = 0;
+   queue->interrupted = 0;
+}
+
+static void spsc_queue_wake(spsc_queue_t *queue, unsigned side)
+{
+#ifdef SPSC_QUEUE_HAVE_EVENTFD
+   if (queue->fd[side] >= 0)
+   {
+      uint64_t one = 1;
+      ssize_t ret  = write(queue->fd[side], &one, sizeof(one));
+      (void)ret;
+      return;
+   }
+#endif
+#ifdef HAVE_THREADS
+   slock_lock(queue->lock);
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+#endif
+}
+
+/* Called after publishing an index. The full fence pairs with the one
+ * in SPSC_ADD() in spsc_queue_wait(): either the sleeper sees the new
+ * index, or this sees the sleeper. */
+static INLINE void spsc_queue_notify(spsc_queue_t *queue, unsigned side)
+{
+   SPSC_FENCE();
+
+   if (SPSC_LOAD_LONG(&queue->waiters[side]))
+      spsc_queue_wake(queue, side);
+}
+
+size_t spsc_queue_write_avail(spsc_queue_t *queue)
+{
+   return queue->size - spsc_queue_used(queue,
+         queue->head.pos, SPSC_LOAD(&queue->tail.pos));
+}
+
+size_t spsc_queue_write_span(spsc_queue_t *queue, void **data)
+{
+   size_t head   = queue->head.pos;
+   size_t offset = spsc_queue_offset(queue, head);
+   size_t avail  = queue->size - spsc_queue_used(queue,
+         head, SPSC_LOAD(&queue->tail.pos));
+
+   *data         = queue->buffer + offset;
+   return MIN(avail, queue->size - offset);
+}
+
+void spsc_queue_write_commit(spsc_queue_t *queue, size_t size)
+{
+   if (!size)
+      return;
+
+   SPSC_STORE(&queue->head.pos,
+         spsc_queue_advance(queue, queue->head.pos, size));
+   spsc_queue_notify(queue, SPSC_QUEUE_READER);
+}
+
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t size)
+{
+   size_t head   = queue->head.pos;
+   size_t offset = spsc_queue_offset(queue, head);
+   size_t first;
+
+   size          = MIN(size, queue->size - spsc_queue_used(queue,
+            head, SPSC_LOAD(&queue->tail.pos)));
+   first         = MIN(size, queue->size - offset);
+
+   memcpy(queue->buffer + offset, data, first);
+   memcpy(queue->buffer, (const uint8_t*)data + first, size - first);
+
+   spsc_queue_write_commit(queue, size);
+   return size;
+}
+
+size_t spsc_queue_read_avail(spsc_queue_t *queue)
+{
+   return spsc_queue_used(queue,
+         SPSC_LOAD(&queue->head.pos), queue->tail.pos);
+}
+
+size_t spsc_queue_read_span(spsc_queue_t *queue, const void **data)
+{
+   size_t tail   = queue->tail.pos;
+   size_t offset = spsc_queue_offset(queue, tail);
+   size_t avail  = spsc_queue_used(queue,
+         SPSC_LOAD(&queue->head.pos), tail);
+
+   *data         = queue->buffer + offset;
+   return MIN(avail, queue->size - offset);
+}
+
+void spsc_queue_read_commit(spsc_queue_t *queue, size_t size)
+{
+   if (!size)
+      return;
+
+   SPSC_STORE(&queue->tail.pos,
+         spsc_queue_advance(queue, queue->tail.pos, size));
+   spsc_queue_notify(queue, SPSC_QUEUE_WRITER);
+}
+
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t size)
+{
+   size_t tail   = queue->tail.pos;
+   size_t offset = spsc_queue_offset(queue, tail);
+   size_t first;
+
+   size          = MIN(size, spsc_queue_used(queue,
+            SPSC_LOAD(&queue->head.pos), tail));
+   first         = MIN(size, queue->size - offset);
+
+   memcpy(data, queue->buffer + offset, first);
+   memcpy((uint8_t*)data + first, queue->buffer, size - first);
+
+   spsc_queue_read_commit(queue, size);
+   return size;
+}
+
+static INLINE bool spsc_queue_ready(spsc_queue_t *queue,
+      bool write, size_t size)
+{
+   return (write
+         ? spsc_queue_write_avail(queue)
+         : spsc_queue_read_avail(queue)) >= size;
+}
+
+static bool spsc_queue_wait(spsc_queue_t *queue, bool write,
+      size_t size, int64_t timeout_us)
+{
+   unsigned side = write ? SPSC_QUEUE_WRITER : SPSC_QUEUE_READER;
+   bool ret      = spsc_queue_ready(queue, write, size);
+
+   if (ret || SPSC_LOAD_LONG(&queue->interrupted))
+      return ret;
+
+#ifdef SPSC_QUEUE_HAVE_EVENTFD
+   if (queue->fd[side] >= 0)
+   {
+      SPSC_ADD(&queue->waiters[side], 1);
+
+      while (!(ret = spsc_queue_ready(queue, write, size))
+            && !SPSC_LOAD_LONG(&queue->interrupted))
+      {
+         struct pollfd pfd;
+         uint64_t count;
+         ssize_t res;
+
+         pfd.fd      = queue->fd[side];
+         pfd.events  = POLLIN;
+         pfd.revents = 0;
+
+         if (poll(&pfd, 1, timeout_us < 0
+                  ? -1 : (int)((timeout_us + 999) / 1000)) > 0)
+         {
+            res = read(queue->fd[side], &count, sizeof(count));
+            (void)res;
+         }
+
+         if (timeout_us >= 0)
+         {
+            ret = spsc_queue_ready(queue, write, size);
+            break;
+         }
+      }
+
+      SPSC_ADD(&queue->waiters[side], -1);
+      return ret;
+   }
+#endif
+
+#ifdef HAVE_THREADS
+   slock_lock(queue->lock);
+   SPSC_ADD(&queue->waiters[side], 1);
+
+   while (!(ret = spsc_queue_ready(queue, write, size))
+         && !SPSC_LOAD_LONG(&queue->interrupted))
+   {
+      if (timeout_us < 0)
+         scond_wait(queue->cond, queue->lock);
+      else
+      {
+         scond_wait_timeout(queue->cond, queue->lock, timeout_us);
+         ret = spsc_queue_ready(queue, write, size);
+         break;
+      }
+   }
+
+   SPSC_ADD(&queue->waiters[side], -1);
+   slock_unlock(queue->lock);
+#endif
+
+   return ret;
+}
+
+bool spsc_queue_wait_write(spsc_queue_t *queue, size_t size,
+      int64_t timeout_us)
+{
+   return spsc_queue_wait(queue, true, size, timeout_us);
+}
+
+bool spsc_queue_wait_read(spsc_queue_t *queue, size_t size,
+      int64_t timeout_us)
+{
+   return spsc_queue_wait(queue, false, size, timeout_us);
+}
+
+void spsc_queue_interrupt(spsc_queue_t *queue)
+{
+   SPSC_ADD(&queue->interrupted, 1);
+   spsc_queue_wake(queue, SPSC_QUEUE_READER);
+   spsc_queue_wake(queue, SPSC_QUEUE_WRITER);
+}
@@ -0,0 +1,243 @@
+/* Regression test and benchmark for the parallel directory walker.
+ *
+ *   dir_walk_test                 builds a tree in "dir_walk_test.dir"
+ *                                 and checks the walker against
+ *                                 dir_list_new()
+ *   dir_walk_test <dir> [exts]    times both on an existing tree
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <lists/dir_list.h>
+#include <lists/dir_walk.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+
+#define TREE_DEPTH  3
+#define TREE_WIDTH  4
+#define TREE_FILES  8
+
+static int failures = 0;
+static const char *dir = "dir_walk_test.dir";
+
+static const char *file_names[TREE_FILES] = {
+   "a.bin", "b.CUE", "c.cue", "d.zip", "e.txt", ".hidden.bin", "f", "g.Bin"
+};
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void make_tree(const char *path, unsigned depth)
+{
+   unsigned i;
+   char child[PATH_MAX_LENGTH];
+
+   path_mkdir(path);
+
+   for (i = 0; i < TREE_FILES; i++)
+   {
+      fill_pathname_join(child, path, file_names[i], sizeof(child));
+      filestream_write_file(child, "x", 1);
+   }
+
+   if (!depth)
+      return;
+
+   for (i = 0; i < TREE_WIDTH; i++)
+   {
+      char name[16];
+
+      snprintf(name, sizeof(name), "dir%u", i);
+      fill_pathname_join(child, path, name, sizeof(child));
+      make_tree(child, depth - 1);
+   }
+}
+
+static void remove_tree(const char *path)
+{
+   size_t i;
+   struct string_list *list = dir_list_new(path, NULL,
+         true, true, false, false);
+
+   if (list)
+   {
+      for (i = 0; i < list->size; i++)
+      {
+         if (list->elems[i].attr.i == RARCH_DIRECTORY)
+            remove_tree(list->elems[i].data);
+         else
+            filestream_delete(list->elems[i].data);
+      }
+
+      string_list_free(list);
+   }
+
+   filestream_delete(path);
+}
+
+/* Everything a walk hands out, sorted */
+static struct string_list *walk_all(const char *path, const char *ext,
+      bool include_dirs, bool recursive, unsigned threads)
+{
+   struct string_list *batch = NULL;
+   struct string_list *list  = string_list_new();
+   dir_walk_t *walk          = dir_walk_new(path, ext, include_dirs,
+         false, true, recursive, threads);
+
+   if (!walk)
+   {
+      string_list_free(list);
+      return NULL;
+   }
+
+   while ((batch = dir_walk_next(walk)))
+   {
+      size_t i;
+
+      for (i = 0; i < batch->size; i++)
+         string_list_append(list, batch->elems[i].data, batch->elems[i].attr);
+      string_list_free(batch);
+   }
+
+   dir_walk_free(walk);
+   dir_list_sort(list, false);
+   return list;
+}
+
+static bool lists_equal(const struct string_list *a,
+      const struct string_list *b)
+{
+   size_t i;
+
+   if (!a || !b || a->size != b->size)
+      return false;
+
+   for (i = 0; i < a->size; i++)
+      if (     strcmp(a->elems[i].data, b->elems[i].data)
+            || a->elems[i].attr.i != b->elems[i].attr.i)
+         return false;
+
+   return true;
+}
+
+static void compare(const char *ext, bool include_dirs, bool recursive,
+      unsigned threads, const char *msg)
+{
+   struct string_list *expected = dir_list_new(dir, ext, include_dirs,
+         false, true, recursive);
+   struct string_list *walked   = walk_all(dir, ext, include_dirs,
+         recursive, threads);
+
+   dir_list_sort(expected, false);
+   check(expected && expected->size && lists_equal(expected, walked),
+         "walk", msg);
+
+   string_list_free(expected);
+   string_list_free(walked);
+}
+
+static void test_filter(void)
+{
+   struct dir_list_filter *filter = dir_list_filter_new(".cue|bin||ZIP|bin");
+
+   check(filter
+         && dir_list_filter_match(filter, "cue")
+         && dir_list_filter_match(filter, "BIN")
+         && dir_list_filter_match(filter, "zip"),
+         "filter", "matches ignoring case and leading dots");
+   check(filter
+         && !dir_list_filter_match(filter, "cu")
+         && !dir_list_filter_match(filter, "")
+         && !dir_list_filter_match(filter, "txt"),
+         "filter", "rejects others");
+   dir_list_filter_free(filter);
+
+   filter = dir_list_filter_new("");
+   check(filter && !dir_list_filter_match(filter, "bin"),
+         "filter", "empty list matches nothing");
+   dir_list_filter_free(filter);
+}
+
+static void test_walk(void)
+{
+   dir_walk_t *walk = NULL;
+
+   make_tree(dir, TREE_DEPTH);
+
+   compare(NULL, false, true, 0, "all files, caller thread");
+   compare(NULL, false, true, 4, "all files, 4 threads");
+   compare("cue|bin", false, true, 4, "filtered, with archives");
+   compare("cue", true, true, 8, "filtered, with directories");
+   compare("bin", false, false, 4, "single directory");
+
+   check(!dir_walk_new("dir_walk_test.missing", NULL,
+            false, false, false, true, 4),
+         "walk", "missing directory");
+
+   /* Stopping early must not wait for, or leak, the rest */
+   walk = dir_walk_new(dir, NULL, false, false, false, true, 4);
+   string_list_free(dir_walk_next(walk));
+   dir_walk_free(walk);
+   check(true, "walk", "stopped early");
+
+   remove_tree(dir);
+}
+
+static void bench(const char *path, const char *ext)
+{
+   unsigned threads;
+   retro_time_t start        = cpu_features_get_time_usec();
+   struct string_list *list  = dir_list_new(path, ext,
+         false, false, true, true);
+
+   printf("dir_list_new:       %8.1f ms, %u entries\n",
+         (cpu_features_get_time_usec() - start) / 1000.0,
+         list ? (unsigned)list->size : 0);
+   string_list_free(list);
+
+   for (threads = 0; threads <= 16; threads = threads ? threads * 2 : 1)
+   {
+      start = cpu_features_get_time_usec();
+      list  = walk_all(path, ext, false, true, threads);
+
+      printf("dir_walk %2u threads: %8.1f ms, %u entries\n", threads,
+            (cpu_features_get_time_usec() - start) / 1000.0,
+            list ? (unsigned)list->size : 0);
+      string_list_free(list);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   if (argc > 1)
+   {
+      bench(argv[1], argc > 2 ? argv[2] : NULL);
+      return 0;
+   }
+
+   remove_tree(dir);
+
+   test_filter();
+   test_walk();
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
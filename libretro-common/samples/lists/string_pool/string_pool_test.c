@@ -0,0 +1,376 @@
+/* Regression test and benchmark for the string pool behind string
+ * and file lists.
+ *
+ *   string_pool_test [files]
+ *
+ * Uses (and empties) "string_pool_test.dir". Checks the pool, with
+ * and without interning, and string and file lists using it. Then
+ * counts allocations and times listing and sorting a directory of
+ * [files] (20000 by default) files, and filling, sorting and
+ * clearing a file list with and without a pool. Allocations are
+ * only counted with glibc, without sanitizers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <lists/dir_list.h>
+#include <lists/file_list.h>
+#include <lists/string_list.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+static int failures = 0;
+static const char *dir = "string_pool_test.dir";
+static unsigned long allocs = 0;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+/* Counts the allocations of everything, strdup() included.
+ * Sanitizers replace the allocator themselves. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+   allocs++;
+   return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+   allocs++;
+   return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+   allocs++;
+   return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+   __libc_free(ptr);
+}
+#endif
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void test_pool(void)
+{
+   unsigned i;
+   char tmp[32];
+   char *a, *b, *big;
+   bool ok                  = true;
+   struct string_pool *pool = string_pool_new(false);
+
+   a = string_pool_strdup(pool, "same");
+   b = string_pool_strdup(pool, "same");
+   check(a != b && string_is_equal(a, b), "pool", "copies without interning");
+
+   a = string_pool_strndup(pool, "prefix", 3);
+   check(string_is_equal(a, "pre"), "pool", "strndup terminates");
+
+   /* Larger than any block */
+   big = (char*)malloc(200000);
+   memset(big, 'x', 199999);
+   big[199999] = '\0';
+   a = string_pool_strdup(pool, big);
+   b = string_pool_strdup(pool, "after");
+   check(a && !strcmp(a, big) && string_is_equal(b, "after"),
+         "pool", "string larger than a block");
+   free(big);
+
+   for (i = 0; i < 10000; i++)
+   {
+      snprintf(tmp, sizeof(tmp), "string %u", i);
+      if (!string_is_equal(string_pool_strdup(pool, tmp), tmp))
+         ok = false;
+   }
+   check(ok, "pool", "many strings");
+
+   string_pool_clear(pool);
+   allocs = 0;
+   for (i = 0; i < 100; i++)
+      string_pool_strdup(pool, "reuses the last block");
+   check(allocs == 0, "pool", "clear keeps a block for reuse");
+   string_pool_free(pool);
+
+   pool = string_pool_new(true);
+   ok   = true;
+   for (i = 0; i < 5000; i++)
+   {
+      snprintf(tmp, sizeof(tmp), "string %u", i);
+      a = string_pool_strdup(pool, tmp);
+      b = string_pool_strdup(pool, tmp);
+      if (a != b || !string_is_equal(a, tmp))
+         ok = false;
+   }
+   a = string_pool_strdup(pool, "str");
+   b = string_pool_strndup(pool, "string 1", 3);
+   check(ok && a == b && a != string_pool_strdup(pool, "string"),
+         "intern", "equal strings stored once");
+
+   string_pool_clear(pool);
+   a = string_pool_strdup(pool, "string 1");
+   check(a == string_pool_strdup(pool, "string 1"),
+         "intern", "interning works after clear");
+   string_pool_free(pool);
+}
+
+static void test_string_list(void)
+{
+   unsigned i;
+   char *taken;
+   union string_list_elem_attr attr;
+   struct string_list *clone = NULL;
+   struct string_list *list  = string_split("zip|7z||cue|bin", "|");
+   bool ok                   = true;
+
+   check(list && list->size == 4
+         && string_is_equal(list->elems[0].data, "zip")
+         && string_is_equal(list->elems[3].data, "bin"),
+         "string_list", "split");
+
+   /* Without a pool, callers may still take elements over */
+   taken = list->elems[--list->size].data;
+   check(string_is_equal(taken, "bin"), "string_list", "take over data");
+   free(taken);
+   check(!string_list_use_string_pool(list),
+         "string_list", "pool only for empty lists");
+   attr.i = 0;
+   string_list_append(list, "bin", attr);
+
+   string_list_append_n(list, "iso9660", 3, attr);
+   string_list_set(list, 1, "chd");
+   string_list_set(list, 2, NULL);
+   check(list->size == 5 && string_is_equal(list->elems[4].data, "iso")
+         && string_is_equal(list->elems[1].data, "chd")
+         && !list->elems[2].data, "string_list", "append_n and set");
+
+   /* Empty strings are cloned as NULL, as before */
+   string_list_append(list, "", attr);
+   list->elems[0].userdata = malloc(16);
+   clone = string_list_clone(list);
+   string_list_free(list);
+   check(clone && clone->size == 6
+         && string_is_equal(clone->elems[0].data, "zip")
+         && !clone->elems[2].data && !clone->elems[5].data
+         && string_is_equal(clone->elems[4].data, "iso"),
+         "string_list", "clone outlives the original");
+   string_list_free(clone);
+
+   list = string_list_new();
+   string_list_use_string_pool(list);
+   for (i = 0; i < 1000; i++)
+   {
+      char tmp[32];
+      snprintf(tmp, sizeof(tmp), "elem %u", i);
+      string_list_append(list, tmp, attr);
+   }
+   for (i = 0; i < list->size; i++)
+   {
+      char tmp[32];
+      snprintf(tmp, sizeof(tmp), "elem %u", i);
+      if (!string_is_equal(list->elems[i].data, tmp))
+         ok = false;
+   }
+   check(ok && list->pool && string_list_find_elem(list, "ELEM 999") == 1000,
+         "string_list", "pooled, find");
+
+   string_list_set(list, 0, NULL);
+   clone = string_list_clone(list);
+   string_list_free(list);
+   check(clone && clone->pool && !clone->elems[0].data
+         && string_is_equal(clone->elems[999].data, "elem 999"),
+         "string_list", "pooled clone");
+   string_list_free(clone);
+}
+
+static file_list_t *file_list_create(bool pooled)
+{
+   file_list_t *list = (file_list_t*)calloc(1, sizeof(*list));
+
+   if (pooled)
+      file_list_use_string_pool(list, false);
+   return list;
+}
+
+static void test_file_list(bool pooled)
+{
+   const char *path  = NULL;
+   const char *label = NULL;
+   size_t directory_ptr;
+   const char *name  = pooled ? "file_list pooled" : "file_list";
+   file_list_t *list = file_list_create(pooled);
+
+   file_list_append(list, "b", "label b", 1, 0, 0);
+   file_list_append(list, "c", NULL, 2, 0, 0);
+   file_list_prepend(list, "a", "label a", 0, 0, 0);
+   file_list_insert(list, "ab", "label ab", 3, 0, 0, 1);
+   file_list_get_at_offset(list, 1, &path, &label, NULL, NULL);
+   check(list->size == 4 && string_is_equal(path, "ab")
+         && string_is_equal(list->list[0].path, "a")
+         && string_is_equal(list->list[3].path, "c"),
+         name, "append, prepend and insert");
+
+   file_list_set_label_at_offset(list, 2, "new label");
+   file_list_set_label_at_offset(list, 0, NULL);
+   file_list_get_label_at_offset(list, 0, &label);
+   check(string_is_equal(label, "a")
+         && string_is_equal(list->list[2].label, "new label"),
+         name, "labels replaced");
+
+   file_list_set_alt_at_offset(list, 0, "z");
+   file_list_set_alt_at_offset(list, 3, "y");
+   file_list_sort_on_alt(list);
+   check(string_is_equal(list->list[0].path, "ab")
+         && string_is_equal(list->list[3].path, "a"),
+         name, "sort on alt");
+
+   file_list_pop(list, &directory_ptr);
+   file_list_clear(list);
+   file_list_append(list, "again", "label", 0, 0, 0);
+   check(list->size == 1 && string_is_equal(list->list[0].path, "again")
+         && !list->list[0].alt, name, "pop and clear");
+
+   file_list_free(list);
+}
+
+static void make_dir(unsigned files)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+
+   path_mkdir(dir);
+
+   for (i = 0; i < files; i++)
+   {
+      char name[64];
+      /* Not created in sorted order */
+      snprintf(name, sizeof(name), "Game %05u (Region %u).zip",
+            (i * 7919) % files, i % 7);
+      fill_pathname_join(path, dir, name, sizeof(path));
+      filestream_write_file(path, "x", 1);
+   }
+}
+
+/* Milliseconds since *t, which is then reset */
+static double lap(retro_time_t *t)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+   double ms        = (now - *t) / 1000.0;
+
+   *t = now;
+   return ms;
+}
+
+static void bench_dir(unsigned files)
+{
+   size_t i;
+   double list_ms, sort_ms, free_ms;
+   unsigned long count;
+   retro_time_t t;
+   bool ok                  = true;
+   struct string_list *list = NULL;
+
+   allocs  = 0;
+   t       = cpu_features_get_time_usec();
+   list    = dir_list_new(dir, NULL, false, false, false, false);
+   list_ms = lap(&t);
+   dir_list_sort(list, true);
+   sort_ms = lap(&t);
+   count   = allocs;
+
+   for (i = 1; i < list->size; i++)
+      if (strcasecmp(list->elems[i - 1].data, list->elems[i].data) > 0)
+         ok = false;
+   check(ok && list->size == files, "dir_list", "listed and sorted");
+
+   lap(&t);
+   dir_list_free(list);
+   free_ms = lap(&t);
+
+   printf("dir_list, %u files: %6.1f ms to list, %5.1f ms to sort, "
+         "%5.2f ms to free, %lu allocations\n",
+         files, list_ms, sort_ms, free_ms, count);
+}
+
+static void bench_file_list(unsigned entries, bool pooled)
+{
+   unsigned i, round;
+   retro_time_t start;
+   file_list_t *list = file_list_create(pooled);
+
+   allocs = 0;
+   start  = cpu_features_get_time_usec();
+
+   /* A menu list is filled and cleared again and again */
+   for (round = 0; round < 4; round++)
+   {
+      for (i = 0; i < entries; i++)
+      {
+         char path[64];
+         snprintf(path, sizeof(path), "Game %05u.zip",
+               (i * 7919) % entries);
+         file_list_append(list, path, "playlist_entry", 0, 0, i);
+         file_list_set_alt_at_offset(list, i, path + 5);
+      }
+
+      file_list_sort_on_alt(list);
+      file_list_clear(list);
+   }
+
+   file_list_free(list);
+   printf("file_list%s, 4 x %u entries: %8.1f ms, %lu allocations\n",
+         pooled ? " pooled" : "", entries,
+         (cpu_features_get_time_usec() - start) / 1000.0, allocs);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned files = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 20000;
+   struct string_list *list;
+   size_t i;
+
+   test_pool();
+   test_string_list();
+   test_file_list(false);
+   test_file_list(true);
+
+   make_dir(files);
+   bench_dir(files);
+   bench_file_list(files, false);
+   bench_file_list(files, true);
+
+   if ((list = dir_list_new(dir, NULL, false, true, false, false)))
+   {
+      for (i = 0; i < list->size; i++)
+         filestream_delete(list->elems[i].data);
+      dir_list_free(list);
+   }
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
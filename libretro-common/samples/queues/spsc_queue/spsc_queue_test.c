@@ -0,0 +1,457 @@
+/* Correctness test and contention benchmark for spsc_queue_t.
+ *
+ *   spsc_queue_test [megabytes]
+ *
+ * First checks the queue on its own: all of the capacity is usable,
+ * spans stop at the end of the ring, data comes out in order across
+ * the wrap and spsc_queue_interrupt() releases a waiting thread.
+ *
+ * Then one thread streams [megabytes] (default 256) through a 64 KiB
+ * queue to another in uneven chunks, and the reader checks every
+ * byte. This is done for fifo_buffer_t guarded by a mutex and a
+ * condition variable, the way the threaded drivers used it, and for
+ * spsc_queue_t waking up through a condition variable and through an
+ * eventfd. Last, small timestamped messages are sent at a steady rate
+ * to measure how long each one takes to reach the sleeping reader.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <retro_timers.h>
+#include <rthreads/rthreads.h>
+#include <queues/fifo_queue.h>
+#include <queues/spsc_queue.h>
+
+#define QUEUE_SIZE      (64 * 1024)
+/* Prime, so the pattern never lines up with the ring */
+#define PATTERN_PERIOD  65521
+#define MAX_CHUNK       4096
+
+#define LAT_MESSAGES    20000
+#define LAT_INTERVAL_NS 50000
+
+typedef struct bench_impl
+{
+   const char *name;
+   void *(*create)(size_t size);
+   void (*destroy)(void *queue);
+   /* Both block until at least one byte could be moved */
+   size_t (*write)(void *queue, const void *data, size_t size);
+   size_t (*read)(void *queue, void *data, size_t size);
+} bench_impl_t;
+
+typedef struct bench_args
+{
+   const bench_impl_t *impl;
+   void *queue;
+   uint64_t *latencies;
+   size_t total;
+   bool intact;
+} bench_args_t;
+
+typedef struct latency_msg
+{
+   uint64_t sent;
+   uint64_t seq;
+   uint8_t pad[16];
+} latency_msg_t;
+
+static int failures = 0;
+static uint8_t pattern[PATTERN_PERIOD + MAX_CHUNK];
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* retro_time_t only has microseconds, which is coarser than the
+ * latencies measured here. */
+static uint64_t time_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const uint8_t *pattern_at(size_t pos)
+{
+   return pattern + pos % PATTERN_PERIOD;
+}
+
+/* fifo_buffer_t behind a lock, as the drivers had it */
+
+typedef struct mutex_queue
+{
+   fifo_buffer_t *fifo;
+   slock_t *lock;
+   scond_t *cond;
+} mutex_queue_t;
+
+static void *mutex_create(size_t size)
+{
+   mutex_queue_t *queue = (mutex_queue_t*)calloc(1, sizeof(*queue));
+
+   queue->fifo = fifo_new(size);
+   queue->lock = slock_new();
+   queue->cond = scond_new();
+   return queue;
+}
+
+static void mutex_destroy(void *data)
+{
+   mutex_queue_t *queue = (mutex_queue_t*)data;
+
+   fifo_free(queue->fifo);
+   slock_free(queue->lock);
+   scond_free(queue->cond);
+   free(queue);
+}
+
+static size_t mutex_write(void *data, const void *buf, size_t size)
+{
+   size_t avail;
+   mutex_queue_t *queue = (mutex_queue_t*)data;
+
+   slock_lock(queue->lock);
+   while (!(avail = FIFO_WRITE_AVAIL(queue->fifo)))
+      scond_wait(queue->cond, queue->lock);
+
+   avail = MIN(avail, size);
+   fifo_write(queue->fifo, buf, avail);
+   scond_signal(queue->cond);
+   slock_unlock(queue->lock);
+
+   return avail;
+}
+
+static size_t mutex_read(void *data, void *buf, size_t size)
+{
+   size_t avail;
+   mutex_queue_t *queue = (mutex_queue_t*)data;
+
+   slock_lock(queue->lock);
+   while (!(avail = FIFO_READ_AVAIL(queue->fifo)))
+      scond_wait(queue->cond, queue->lock);
+
+   avail = MIN(avail, size);
+   fifo_read(queue->fifo, buf, avail);
+   scond_signal(queue->cond);
+   slock_unlock(queue->lock);
+
+   return avail;
+}
+
+/* spsc_queue_t */
+
+static void *spsc_create(size_t size)
+{
+   return spsc_queue_new(size, 0);
+}
+
+static void *spsc_create_eventfd(size_t size)
+{
+   return spsc_queue_new(size, SPSC_QUEUE_EVENTFD);
+}
+
+static void spsc_destroy(void *data)
+{
+   spsc_queue_free((spsc_queue_t*)data);
+}
+
+static size_t spsc_write(void *data, const void *buf, size_t size)
+{
+   size_t written;
+   spsc_queue_t *queue = (spsc_queue_t*)data;
+
+   while (!(written = spsc_queue_write(queue, buf, size)))
+      spsc_queue_wait_write(queue, 1, -1);
+
+   return written;
+}
+
+static size_t spsc_read(void *data, void *buf, size_t size)
+{
+   size_t read;
+   spsc_queue_t *queue = (spsc_queue_t*)data;
+
+   while (!(read = spsc_queue_read(queue, buf, size)))
+      spsc_queue_wait_read(queue, 1, -1);
+
+   return read;
+}
+
+static const bench_impl_t impls[] = {
+   { "fifo+mutex",   mutex_create, mutex_destroy, mutex_write, mutex_read },
+   { "spsc",         spsc_create,  spsc_destroy,  spsc_write,  spsc_read  },
+   { "spsc+eventfd", spsc_create_eventfd, spsc_destroy,
+      spsc_write, spsc_read },
+};
+
+static void write_all(const bench_args_t *args, const void *data,
+      size_t size)
+{
+   size_t done = 0;
+
+   while (done < size)
+      done += args->impl->write(args->queue,
+            (const uint8_t*)data + done, size - done);
+}
+
+static void read_all(const bench_args_t *args, void *data, size_t size)
+{
+   size_t done = 0;
+
+   while (done < size)
+      done += args->impl->read(args->queue,
+            (uint8_t*)data + done, size - done);
+}
+
+static void throughput_reader(void *data)
+{
+   bench_args_t *args = (bench_args_t*)data;
+   uint8_t *buf       = (uint8_t*)malloc(MAX_CHUNK);
+   size_t pos         = 0;
+
+   while (pos < args->total)
+   {
+      size_t read = args->impl->read(args->queue, buf,
+            MIN(MAX_CHUNK, args->total - pos));
+
+      if (memcmp(buf, pattern_at(pos), read))
+         args->intact = false;
+      pos += read;
+   }
+
+   free(buf);
+}
+
+static void latency_reader(void *data)
+{
+   unsigned i;
+   bench_args_t *args = (bench_args_t*)data;
+
+   for (i = 0; i < LAT_MESSAGES; i++)
+   {
+      latency_msg_t msg;
+
+      read_all(args, &msg, sizeof(msg));
+      args->latencies[i] = time_ns() - msg.sent;
+
+      if (msg.seq != i)
+         args->intact = false;
+   }
+}
+
+static bool check_spsc_alone(void)
+{
+   size_t i, span;
+   void *wspan;
+   const void *rspan;
+   uint8_t buf[1000];
+   bool ok             = true;
+   /* Not a power of two on purpose */
+   spsc_queue_t *queue = spsc_queue_new(1000, 0);
+
+   if (!queue)
+      return false;
+
+   /* Fill it up completely */
+   ok = ok && spsc_queue_write_avail(queue) == 1000;
+   ok = ok && spsc_queue_write(queue, pattern_at(0), 1000) == 1000;
+   ok = ok && spsc_queue_write_avail(queue) == 0;
+   ok = ok && spsc_queue_write(queue, pattern_at(1000), 1) == 0;
+   ok = ok && spsc_queue_read_avail(queue) == 1000;
+
+   /* Free the front, then refill it from the start of the ring */
+   ok = ok && spsc_queue_read(queue, buf, 600) == 600;
+   ok = ok && !memcmp(buf, pattern_at(0), 600);
+   span = spsc_queue_write_span(queue, &wspan);
+   ok = ok && span == 600;
+   memcpy(wspan, pattern_at(1000), 500);
+   spsc_queue_write_commit(queue, 500);
+
+   /* A read span stops at the end of the ring... */
+   span = spsc_queue_read_span(queue, &rspan);
+   ok = ok && span == 400 && !memcmp(rspan, pattern_at(600), 400);
+   spsc_queue_read_commit(queue, 400);
+
+   /* ...and the rest is at its start. */
+   span = spsc_queue_read_span(queue, &rspan);
+   ok = ok && span == 500 && !memcmp(rspan, pattern_at(1000), 500);
+   spsc_queue_read_commit(queue, 500);
+   ok = ok && spsc_queue_read_avail(queue) == 0;
+
+   /* Copies across the wrap many times over */
+   for (i = 0; ok && i < 100; i++)
+   {
+      size_t pos = 1500 + i * 333;
+
+      ok = ok && spsc_queue_write(queue, pattern_at(pos), 333) == 333;
+      ok = ok && spsc_queue_read(queue, buf, sizeof(buf)) == 333;
+      ok = ok && !memcmp(buf, pattern_at(pos), 333);
+   }
+
+   spsc_queue_free(queue);
+   return ok;
+}
+
+static void interrupt_waiter(void *data)
+{
+   spsc_queue_t *queue = (spsc_queue_t*)data;
+
+   /* Never satisfied, the queue stays empty */
+   if (spsc_queue_wait_read(queue, 1, -1))
+      failures++;
+}
+
+static bool check_spsc_interrupt(unsigned flags)
+{
+   sthread_t *thread;
+   uint64_t start;
+   bool timed_out;
+   spsc_queue_t *queue = spsc_queue_new(QUEUE_SIZE, flags);
+
+   if (!queue)
+      return false;
+
+   start     = time_ns();
+   timed_out = !spsc_queue_wait_read(queue, 1, 20000);
+   timed_out = timed_out && time_ns() - start >= 10000000;
+
+   thread    = sthread_create(interrupt_waiter, queue);
+   retro_sleep(20);
+   spsc_queue_interrupt(queue);
+   sthread_join(thread);
+
+   /* Later waits return right away as well */
+   timed_out = timed_out && !spsc_queue_wait_write(queue,
+         QUEUE_SIZE + 1, -1);
+
+   spsc_queue_free(queue);
+   return timed_out;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i, j;
+   char msg[256];
+   double mbps[ARRAY_SIZE(impls)];
+   uint64_t p50[ARRAY_SIZE(impls)];
+   uint64_t p99[ARRAY_SIZE(impls)];
+   uint64_t worst[ARRAY_SIZE(impls)];
+   size_t megabytes    = argc > 1 ? strtoul(argv[1], NULL, 0) : 256;
+   uint64_t *latencies = (uint64_t*)malloc(
+         LAT_MESSAGES * sizeof(*latencies));
+
+   for (i = 0; i < sizeof(pattern); i++)
+   {
+      unsigned x = i % PATTERN_PERIOD;
+      pattern[i] = (uint8_t)(x * 131 + (x >> 9));
+   }
+
+   check(check_spsc_alone(), "spsc", "capacity, spans and wrap around");
+   check(check_spsc_interrupt(0), "spsc",
+         "timeout and interrupt");
+   check(check_spsc_interrupt(SPSC_QUEUE_EVENTFD), "spsc+eventfd",
+         "timeout and interrupt");
+
+   printf("Streaming %u MiB through a %u KiB queue.\n",
+         (unsigned)megabytes, QUEUE_SIZE / 1024);
+
+   for (i = 0; i < ARRAY_SIZE(impls); i++)
+   {
+      static const size_t chunks[] = { 64, 1000, MAX_CHUNK, 333 };
+      sthread_t *thread;
+      uint64_t start;
+      size_t pos;
+      bench_args_t args;
+
+      args.impl      = &impls[i];
+      args.queue     = impls[i].create(QUEUE_SIZE);
+      args.latencies = latencies;
+      args.total     = megabytes * 1024 * 1024;
+      args.intact    = true;
+
+      if (!args.queue)
+      {
+         check(false, impls[i].name, "created");
+         continue;
+      }
+
+      /* Throughput: the writer never waits on anything but the queue */
+      start  = time_ns();
+      thread = sthread_create(throughput_reader, &args);
+
+      for (pos = 0, j = 0; pos < args.total; j++)
+      {
+         size_t chunk = MIN(chunks[j & 3], args.total - pos);
+
+         write_all(&args, pattern_at(pos), chunk);
+         pos += chunk;
+      }
+
+      sthread_join(thread);
+      mbps[i] = (double)args.total / (time_ns() - start) * 1000.0;
+
+      /* Latency: the reader is asleep when each message arrives */
+      thread = sthread_create(latency_reader, &args);
+      start  = time_ns();
+
+      for (j = 0; j < LAT_MESSAGES; j++)
+      {
+         latency_msg_t msg;
+
+         while (time_ns() < start + (uint64_t)j * LAT_INTERVAL_NS);
+
+         memset(&msg, 0, sizeof(msg));
+         msg.seq  = j;
+         msg.sent = time_ns();
+         write_all(&args, &msg, sizeof(msg));
+      }
+
+      sthread_join(thread);
+      impls[i].destroy(args.queue);
+
+      qsort(latencies, LAT_MESSAGES, sizeof(*latencies), compare_u64);
+      p50[i]   = latencies[LAT_MESSAGES / 2];
+      p99[i]   = latencies[LAT_MESSAGES * 99 / 100];
+      worst[i] = latencies[LAT_MESSAGES - 1];
+
+      snprintf(msg, sizeof(msg), "%u MiB and %u messages intact",
+            (unsigned)megabytes, LAT_MESSAGES);
+      check(args.intact, impls[i].name, msg);
+   }
+
+   printf("%-14s %10s %10s %10s %10s\n", "queue", "MB/s",
+         "p50 (us)", "p99 (us)", "max (us)");
+   for (i = 0; i < ARRAY_SIZE(impls); i++)
+      printf("%-14s %10.0f %10.1f %10.1f %10.1f\n", impls[i].name,
+            mbps[i], p50[i] / 1000.0, p99[i] / 1000.0, worst[i] / 1000.0);
+
+   free(latencies);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
@@ -32,6 +32,7 @@
 #include "../core.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
+#include "../performance_counters.h"
 
 #ifdef HAVE_NETWORKING
 #include "../network/netplay/netplay.h"
@@ -120,6 +121,7 @@ size thisstart;
 /* TODO/FIXME - static public global variables */
 static struct state_manager_rewind_state rewind_state;
 static bool frame_is_reversed                         = false;
+static struct retro_perf_counter rewind_push_perf;
 
 /* There's no equivalent in libc, you'd think so ...
  * std::mismatch exists, but it's not optimized at all. */
@@ -778,7 +780,11 @@ bool state_manager_check_rewind(bool pressed,
       if ((cnt == 0) || rarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL))
       {
          retro_ctx_serialize_info_t serial_info;
-         void *state = NULL;
+         void *state          = NULL;
+         bool perfcnt_enable  = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+
+         performance_counter_init(rewind_push_perf, "rewind_push");
+         performance_counter_start_plus(perfcnt_enable, rewind_push_perf);
 
          state_manager_push_where(rewind_state.state, &state);
 
@@ -788,6 +794,8 @@ bool state_manager_check_rewind(bool pressed,
          core_serialize(&serial_info);
 
          state_manager_push_do(rewind_state.state);
+
+         performance_counter_stop_plus(perfcnt_enable, rewind_push_perf);
       }
    }
 
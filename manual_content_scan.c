@@ -24,6 +24,7 @@
 #include <file/archive_file.h>
 #include <string/stdstring.h>
 #include <lists/dir_list.h>
+#include <lists/dir_walk.h>
 #include <retro_miscellaneous.h>
 
 #include "msg_hash.h"
@@ -889,22 +890,22 @@ bool manual_content_scan_get_task_config(
    return true;
 }
 
-/* Creates a list of all valid content in the specified
- * content directory
+/* Starts listing all valid content in the specified
+ * content directory, see manual_content_scan_get_content_list()
  * > Returns NULL in the event of failure
- * > Returned string list must be free()'d */
-struct string_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config)
+ * > Returned walk must be freed with dir_walk_free() */
+dir_walk_t *manual_content_scan_get_content_walk(
+      manual_content_scan_task_config_t *task_config)
 {
-   struct string_list *dir_list = NULL;
    bool filter_exts;
    bool include_compressed;
 
    /* Sanity check */
    if (!task_config)
-      goto error;
+      return NULL;
 
    if (string_is_empty(task_config->content_dir))
-      goto error;
+      return NULL;
 
    /* Check whether files should be filtered by
     * extension */
@@ -921,36 +922,44 @@ struct string_list *manual_content_scan_get_content_list(manual_content_scan_tas
     *   then compressed files must of course be included */
    include_compressed = (!filter_exts || task_config->search_archives);
 
-   /* Get directory listing
+   /* Start directory listing
     * > Exclude directories and hidden files */
-   dir_list = dir_list_new(
+   return dir_walk_new(
          task_config->content_dir,
          filter_exts ? task_config->file_exts : NULL,
          false, /* include_dirs */
          false, /* include_hidden */
          include_compressed,
-         task_config->search_recursively
+         task_config->search_recursively,
+         DIR_WALK_DEFAULT_THREADS
    );
+}
 
-   /* Sanity check */
-   if (!dir_list)
-      goto error;
+/* Appends the valid content of the next directory
+ * listed by @walk to @list
+ * > Returns false once all directories have been
+ *   listed */
+bool manual_content_scan_get_content_list(
+      dir_walk_t *walk, struct string_list *list)
+{
+   size_t i;
+   struct string_list *dir_list = dir_walk_next(walk);
 
-   if (dir_list->size < 1)
-      goto error;
+   if (!dir_list)
+      return false;
 
-   /* Ensure list is in alphabetical order
+   /* Ensure each directory is in alphabetical order
     * > Not strictly required, but task status
     *   messages will be unintuitive if we leave
     *   the order 'random' */
    dir_list_sort(dir_list, true);
 
-   return dir_list;
+   for (i = 0; i < dir_list->size; i++)
+      string_list_append(list,
+            dir_list->elems[i].data, dir_list->elems[i].attr);
 
-error:
-   if (dir_list)
-      string_list_free(dir_list);
-   return NULL;
+   string_list_free(dir_list);
+   return true;
 }
 
 /* Converts specified content path string to 'real'
@@ -29,6 +29,7 @@
 #include <boolean.h>
 
 #include <lists/string_list.h>
+#include <lists/dir_walk.h>
 #include <formats/logiqx_dat.h>
 
 #include "playlist.h"
@@ -227,11 +228,19 @@ bool manual_content_scan_get_task_config(
       const char *path_dir_playlist
       );
 
-/* Creates a list of all valid content in the specified
- * content directory
+/* Starts listing all valid content in the specified
+ * content directory, see manual_content_scan_get_content_list()
  * > Returns NULL in the event of failure
- * > Returned string list must be free()'d */
-struct string_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config);
+ * > Returned walk must be freed with dir_walk_free() */
+dir_walk_t *manual_content_scan_get_content_walk(
+      manual_content_scan_task_config_t *task_config);
+
+/* Appends the valid content of the next directory
+ * listed by @walk to @list
+ * > Returns false once all directories have been
+ *   listed */
+bool manual_content_scan_get_content_list(
+      dir_walk_t *walk, struct string_list *list);
 
 /* Adds specified content to playlist, if not already
  * present */
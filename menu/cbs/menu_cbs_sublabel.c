@@ -1211,6 +1211,9 @@ static int action_bind_sublabel_playlist_entry(
 {
    playlist_t *playlist                      = NULL;
    const struct playlist_entry *entry        = NULL;
+   /* Long playlists only show a window of their
+    * entries, so i need not be the playlist index */
+   size_t idx                                = list->list[i].entry_idx;
 #ifdef HAVE_OZONE
    const char *menu_ident                    = menu_driver_ident();
 #endif
@@ -1243,11 +1246,11 @@ static int action_bind_sublabel_playlist_entry(
    if (!playlist)
       return 0;
 
-   if (i >= playlist_get_size(playlist))
+   if (idx >= playlist_get_size(playlist))
       return 0;
 
    /* Read playlist entry */
-   playlist_get_index(playlist, i, &entry);
+   playlist_get_index(playlist, idx, &entry);
 
    /* Only add sublabel if a core is currently assigned
     * > Both core name and core path must be valid */
@@ -1284,7 +1287,7 @@ static int action_bind_sublabel_playlist_entry(
    /* Check whether runtime info should be loaded from log file */
    if (entry->runtime_status == PLAYLIST_RUNTIME_UNKNOWN)
       runtime_update_playlist(
-            playlist, i,
+            playlist, idx,
             directory_runtime_log,
             directory_playlist,
             (playlist_sublabel_runtime_type == PLAYLIST_RUNTIME_PER_CORE),
@@ -2786,7 +2786,8 @@ static bool materialui_render_process_entry_playlist_thumb_list(
     * and free thumbnails for all off-screen entries */
    if (mui->secondary_thumbnail_enabled)
       gfx_thumbnail_process_streams(
-         mui->thumbnail_path_data, mui->playlist, entry_idx,
+         mui->thumbnail_path_data, mui->playlist,
+         menu_entries_get_virtual_index(entry_idx),
          &node->thumbnails.primary, &node->thumbnails.secondary,
          on_screen,
          thumbnail_upscale_threshold,
@@ -2794,7 +2795,8 @@ static bool materialui_render_process_entry_playlist_thumb_list(
    else
       gfx_thumbnail_process_stream(
             mui->thumbnail_path_data, GFX_THUMBNAIL_RIGHT,
-            mui->playlist, entry_idx, &node->thumbnails.primary,
+            mui->playlist, menu_entries_get_virtual_index(entry_idx),
+            &node->thumbnails.primary,
             on_screen,
             thumbnail_upscale_threshold,
             network_on_demand_thumbnails);
@@ -2822,7 +2824,8 @@ static bool materialui_render_process_entry_playlist_dual_icon(
     * > Note that secondary thumbnail is force
     *   enabled in dual icon mode */
    gfx_thumbnail_process_streams(
-      mui->thumbnail_path_data, mui->playlist, entry_idx,
+      mui->thumbnail_path_data, mui->playlist,
+      menu_entries_get_virtual_index(entry_idx),
       &node->thumbnails.primary, &node->thumbnails.secondary,
       on_screen,
       thumbnail_upscale_threshold,
@@ -2862,7 +2865,8 @@ static bool materialui_render_process_entry_playlist_desktop(
     * > Note that secondary thumbnail is force
     *   enabled */
    gfx_thumbnail_process_streams(
-      mui->thumbnail_path_data, mui->playlist, entry_idx,
+      mui->thumbnail_path_data, mui->playlist,
+      menu_entries_get_virtual_index(entry_idx),
       &node->thumbnails.primary, &node->thumbnails.secondary,
       is_on_screen,
       thumbnail_upscale_threshold,
@@ -2926,10 +2930,11 @@ static bool materialui_render_process_entry_playlist_desktop(
             const char *core_name              = NULL;
             const char *runtime_str            = NULL;
             const char *last_played_str        = NULL;
+            size_t playlist_idx                = menu_entries_get_virtual_index(selection);
             int n;
 
             /* Read playlist entry */
-            playlist_get_index(mui->playlist, selection, &entry);
+            playlist_get_index(mui->playlist, playlist_idx, &entry);
 
             /* Sanity check */
             if (!entry)
@@ -2956,7 +2961,7 @@ static bool materialui_render_process_entry_playlist_desktop(
             {
                if (entry->runtime_status == PLAYLIST_RUNTIME_UNKNOWN)
                   runtime_update_playlist(
-                        mui->playlist, selection,
+                        mui->playlist, playlist_idx,
                         directory_runtime_log,
                         directory_playlist,
                         (runtime_type == PLAYLIST_RUNTIME_PER_CORE),
@@ -212,6 +212,7 @@ static void *ozone_init(void **userdata, bool video_is_threaded)
    ozone->horizontal_list->list     = NULL;
    ozone->horizontal_list->capacity = 0;
    ozone->horizontal_list->size     = 0;
+   ozone->horizontal_list->pool     = NULL;
 
    if (ozone->horizontal_list)
       ozone_init_horizontal_list(ozone);
@@ -374,7 +375,8 @@ static void ozone_free(void *data)
 static void ozone_update_thumbnail_image(void *data)
 {
    ozone_handle_t *ozone             = (ozone_handle_t*)data;
-   size_t selection                  = menu_navigation_get_selection();
+   size_t selection                  = menu_entries_get_virtual_index(
+         menu_navigation_get_selection());
    settings_t *settings              = config_get_ptr();
    playlist_t *playlist              = playlist_get_cached();
    unsigned gfx_thumbnail_upscale_threshold = settings->uints.gfx_thumbnail_upscale_threshold;
@@ -2008,7 +2010,8 @@ static void ozone_set_thumbnail_content(void *data, const char *s)
       /* Playlist content */
       if (string_is_empty(s))
       {
-         size_t selection           = menu_navigation_get_selection();
+         size_t selection           = menu_entries_get_virtual_index(
+               menu_navigation_get_selection());
          gfx_thumbnail_set_content_playlist(ozone->thumbnail_path_data,
                playlist_get_cached(), selection);
       }
@@ -3542,7 +3545,8 @@ void ozone_free_list_nodes(file_list_t *list, bool actiondata)
 void ozone_update_content_metadata(ozone_handle_t *ozone)
 {
    const char *core_name             = NULL;
-   size_t selection                  = menu_navigation_get_selection();
+   size_t selection                  = menu_entries_get_virtual_index(
+         menu_navigation_get_selection());
    playlist_t *playlist              = playlist_get_cached();
    settings_t *settings              = config_get_ptr();
    bool scroll_content_metadata      = settings->bools.ozone_scroll_content_metadata;
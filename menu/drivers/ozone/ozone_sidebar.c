@@ -847,6 +847,7 @@ void ozone_refresh_horizontal_list(ozone_handle_t *ozone)
    ozone->horizontal_list->list     = NULL;
    ozone->horizontal_list->capacity = 0;
    ozone->horizontal_list->size     = 0;
+   ozone->horizontal_list->pool     = NULL;
 
    if (ozone->horizontal_list)
       ozone_init_horizontal_list(ozone);
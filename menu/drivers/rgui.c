@@ -35,6 +35,12 @@
 #include <retro_inline.h>
 #include <gfx/scaler/scaler.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
 #endif
@@ -614,7 +620,12 @@ typedef struct
    char menu_sublabel[MENU_SUBLABEL_MAX_LENGTH]; /* Must be a fixed length array... */
    gfx_thumbnail_path_data_t *thumbnail_path_data;
    rgui_particle_t particles[RGUI_NUM_PARTICLES];
-   bool font_lut[RGUI_NUM_FONT_GLYPHS_EXTENDED][FONT_WIDTH * FONT_HEIGHT];
+   /* Glyph rows as bitmasks (bit n == column n). The shadow
+    * LUT holds the pixels covered by the drop shadow but not
+    * by the glyph itself. The last row of a glyph is empty -
+    * it only receives shadow */
+   uint8_t font_lut[RGUI_NUM_FONT_GLYPHS_EXTENDED][FONT_HEIGHT_STRIDE];
+   uint8_t font_shadow_lut[RGUI_NUM_FONT_GLYPHS_EXTENDED][FONT_HEIGHT_STRIDE];
 } rgui_t;
 
 /* Particle effect animations update at a base rate
@@ -947,6 +958,17 @@ static frame_buf_t rgui_upscale_buf = {
    0,
    NULL
 };
+/* Copy of rgui_frame_buf as of the last texture upload,
+ * used to detect which rows have changed since */
+static frame_buf_t rgui_last_frame_buf = {
+   0,
+   0,
+   NULL
+};
+/* Dimensions of the last uploaded texture
+ * (0 if the texture must be re-uploaded) */
+static unsigned rgui_texture_width  = 0;
+static unsigned rgui_texture_height = 0;
 
 /* ==============================
  * pixel format conversion START
@@ -1090,6 +1112,30 @@ static void rgui_set_pixel_format_function(void)
  * pixel format conversion END
  * ============================== */
 
+/* Fills scanline[x_start..x_end) with a repeating 8 pixel
+ * pattern, where pattern[n] is used for every x with
+ * (x & 7) == n. Pixels below x_start (but in the same
+ * 8 pixel block) may also be written */
+static void rgui_fill_scanline(uint16_t *scanline,
+      unsigned x_start, unsigned x_end, const uint16_t *pattern)
+{
+   unsigned x_index = x_start;
+#if defined(__SSE2__)
+   __m128i pattern_vec = _mm_loadu_si128((const __m128i*)pattern);
+
+   for (x_index = x_start & ~7; x_index + 8 <= x_end; x_index += 8)
+      _mm_storeu_si128((__m128i*)(scanline + x_index), pattern_vec);
+#elif defined(__ARM_NEON__)
+   uint16x8_t pattern_vec = vld1q_u16(pattern);
+
+   for (x_index = x_start & ~7; x_index + 8 <= x_end; x_index += 8)
+      vst1q_u16(scanline + x_index, pattern_vec);
+#endif
+
+   for (; x_index < x_end; x_index++)
+      *(scanline + x_index) = pattern[x_index & 7];
+}
+
 static void rgui_fill_rect(
       uint16_t *data,
       unsigned fb_width, unsigned fb_height,
@@ -1106,6 +1152,8 @@ static void rgui_fill_rect(
    size_t x_size;
    uint16_t scanline_even[RGUI_MAX_FB_WIDTH]; /* Initial values don't matter here */
    uint16_t scanline_odd[RGUI_MAX_FB_WIDTH];
+   uint16_t pattern_even[8];
+   uint16_t pattern_odd[8];
 
    /* Note: unlike rgui_color_rect() and rgui_draw_particle(),
     * this function is frequently used to fill large areas.
@@ -1128,8 +1176,10 @@ static void rgui_fill_rect(
       uint16_t *dst = data + x_start;
 
       /* Populate source array */
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(scanline_even + x_index) = dark_color;
+      for (x_index = 0; x_index < 8; x_index++)
+         pattern_even[x_index] = dark_color;
+
+      rgui_fill_scanline(scanline_even, x_start, x_end, pattern_even);
 
       /* Fill destination array */
       for (y_index = y_start; y_index < y_end; y_index++)
@@ -1175,13 +1225,16 @@ static void rgui_fill_rect(
       }
 
       /* Populate source arrays */
-      for (x_index = x_start; x_index < x_end; x_index++)
+      for (x_index = 0; x_index < 8; x_index++)
       {
          bool x_is_even = (((x_index >> 1) & 1) == 0);
-         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
-         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
+         pattern_even[x_index] = x_is_even ? dark_color  : light_color;
+         pattern_odd[x_index]  = x_is_even ? light_color : dark_color;
       }
 
+      rgui_fill_scanline(scanline_even, x_start, x_end, pattern_even);
+      rgui_fill_scanline(scanline_odd,  x_start, x_end, pattern_odd);
+
       /* Fill destination array */
       for (y_index = y_start    ; y_index < y_end; y_index += 4)
          memcpy(dst + (y_index * fb_width), src_a, x_size);
@@ -1215,13 +1268,16 @@ static void rgui_fill_rect(
       }
 
       /* Populate source arrays */
-      for (x_index = x_start; x_index < x_end; x_index++)
+      for (x_index = 0; x_index < 8; x_index++)
       {
          bool x_is_even = ((x_index & 1) == 0);
-         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
-         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
+         pattern_even[x_index] = x_is_even ? dark_color  : light_color;
+         pattern_odd[x_index]  = x_is_even ? light_color : dark_color;
       }
 
+      rgui_fill_scanline(scanline_even, x_start, x_end, pattern_even);
+      rgui_fill_scanline(scanline_odd,  x_start, x_end, pattern_odd);
+
       /* Fill destination array */
       for (y_index = y_start    ; y_index < y_end; y_index += 2)
          memcpy(dst + (y_index * fb_width), src_a, x_size);
@@ -1839,11 +1895,17 @@ static bool downscale_thumbnail(rgui_t *rgui,
 
       for (y_dst = 0; y_dst < image_dst->height; y_dst++)
       {
+         uint32_t x_pos      = 0;
+         uint32_t *dst       = image_dst->pixels + (y_dst * image_dst->width);
+         const uint32_t *src = NULL;
+
          y_src = (y_dst * y_ratio) >> 16;
-         for (x_dst = 0; x_dst < image_dst->width; x_dst++)
+         src   = image_src->pixels + (y_src * image_src->width);
+
+         for (x_dst = 0; x_dst < image_dst->width; x_dst++, x_pos += x_ratio)
          {
-            x_src = (x_dst * x_ratio) >> 16;
-            image_dst->pixels[(y_dst * image_dst->width) + x_dst] = image_src->pixels[(y_src * image_src->width) + x_src];
+            x_src      = x_pos >> 16;
+            dst[x_dst] = src[x_src];
          }
       }
    }
@@ -1930,10 +1992,11 @@ static void process_thumbnail(rgui_t *rgui, thumbnail_t *thumbnail, uint32_t *qu
    thumbnail->width = image->width;
    thumbnail->height = image->height;
 
-   /* Copy image to thumbnail buffer, performing pixel format conversion */
-   for (x = 0; x < thumbnail->width; x++)
+   /* Copy image to thumbnail buffer, performing pixel format conversion
+    * (row by row, so both buffers are walked sequentially) */
+   for (y = 0; y < thumbnail->height; y++)
    {
-      for (y = 0; y < thumbnail->height; y++)
+      for (x = 0; x < thumbnail->width; x++)
       {
          thumbnail->data[x + (y * thumbnail->width)] =
             argb32_to_pixel_platform_format(image->pixels[x + (y * thumbnail->width)]);
@@ -2501,6 +2564,63 @@ static void prepare_rgui_colors(rgui_t *rgui, settings_t *settings)
  * critical that we simply cannot afford to check user
  * settings internally. */
 
+/* Writes one row of a glyph: pixels set in 'mask' are
+ * painted with 'color', pixels set in 'shadow_mask' with
+ * 'shadow_color', all others are left untouched.
+ * 'wide' indicates that 8 pixels may safely be read
+ * and written back at 'dst' */
+static INLINE void rgui_blit_glyph_row(uint16_t *dst,
+      uint8_t mask, uint8_t shadow_mask,
+      uint16_t color, uint16_t shadow_color, bool wide)
+{
+   if (!(mask | shadow_mask))
+      return;
+
+#if defined(__SSE2__)
+   if (wide)
+   {
+      const __m128i bits = _mm_set_epi16(128, 64, 32, 16, 8, 4, 2, 1);
+      __m128i text_sel   = _mm_cmpeq_epi16(
+            _mm_and_si128(_mm_set1_epi16(mask), bits), bits);
+      __m128i shadow_sel = _mm_cmpeq_epi16(
+            _mm_and_si128(_mm_set1_epi16(shadow_mask), bits), bits);
+      __m128i pixels     = _mm_loadu_si128((const __m128i*)dst);
+
+      pixels = _mm_or_si128(
+            _mm_andnot_si128(_mm_or_si128(text_sel, shadow_sel), pixels),
+            _mm_or_si128(
+               _mm_and_si128(text_sel,   _mm_set1_epi16((short)color)),
+               _mm_and_si128(shadow_sel, _mm_set1_epi16((short)shadow_color))));
+
+      _mm_storeu_si128((__m128i*)dst, pixels);
+      return;
+   }
+#elif defined(__ARM_NEON__)
+   if (wide)
+   {
+      static const uint16_t bits_data[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+      uint16x8_t bits       = vld1q_u16(bits_data);
+      uint16x8_t text_sel   = vtstq_u16(vdupq_n_u16(mask), bits);
+      uint16x8_t shadow_sel = vtstq_u16(vdupq_n_u16(shadow_mask), bits);
+      uint16x8_t pixels     = vld1q_u16(dst);
+
+      pixels = vbslq_u16(shadow_sel, vdupq_n_u16(shadow_color), pixels);
+      pixels = vbslq_u16(text_sel,   vdupq_n_u16(color),        pixels);
+
+      vst1q_u16(dst, pixels);
+      return;
+   }
+#endif
+
+   for (; mask | shadow_mask; mask >>= 1, shadow_mask >>= 1, dst++)
+   {
+      if (mask & 1)
+         *dst = color;
+      else if (shadow_mask & 1)
+         *dst = shadow_color;
+   }
+}
+
 /* blit_line() */
 
 static void blit_line_regular(
@@ -2509,10 +2629,11 @@ static void blit_line_regular(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui_frame_buf.data;
+   size_t fb_size           = rgui_frame_buf.width * rgui_frame_buf.height;
 
    while (!string_is_empty(message))
    {
-      unsigned i, j;
+      unsigned j;
       uint8_t symbol = (uint8_t)*message++;
 
       if (symbol >= RGUI_NUM_FONT_GLYPHS_REGULAR)
@@ -2520,16 +2641,12 @@ static void blit_line_regular(
 
       if (symbol != ' ')
       {
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
+         uint16_t *dst = frame_buf_data + (y * fb_width) + x;
+         bool wide     = ((((y + FONT_HEIGHT - 1) * fb_width) + x + 8) <= fb_size);
 
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (rgui->font_lut[symbol][i + (j * FONT_WIDTH)])
-                  *(frame_buf_data + buff_offset + i) = color;
-            }
-         }
+         for (j = 0; j < FONT_HEIGHT; j++, dst += fb_width)
+            rgui_blit_glyph_row(dst, rgui->font_lut[symbol][j], 0,
+                  color, shadow_color, wide);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -2542,18 +2659,11 @@ static void blit_line_regular_shadow(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data     = rgui_frame_buf.data;
-   uint16_t color_buf[2];
-   uint16_t shadow_color_buf[2];
-
-   color_buf[0] = color;
-   color_buf[1] = shadow_color;
-
-   shadow_color_buf[0] = shadow_color;
-   shadow_color_buf[1] = shadow_color;
+   size_t fb_size               = rgui_frame_buf.width * rgui_frame_buf.height;
 
    while (!string_is_empty(message))
    {
-      unsigned i, j;
+      unsigned j;
       uint8_t symbol = (uint8_t)*message++;
 
       if (symbol >= RGUI_NUM_FONT_GLYPHS_REGULAR)
@@ -2561,25 +2671,14 @@ static void blit_line_regular_shadow(
 
       if (symbol != ' ')
       {
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
-
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (rgui->font_lut[symbol][i + (j * FONT_WIDTH)])
-               {
-                  uint16_t *frame_buf_ptr = frame_buf_data + buff_offset + i;
-
-                  /* Text pixel + right shadow */
-                  memcpy(frame_buf_ptr, color_buf, sizeof(color_buf));
-
-                  /* Bottom shadow */
-                  frame_buf_ptr += fb_width;
-                  memcpy(frame_buf_ptr, shadow_color_buf, sizeof(shadow_color_buf));
-               }
-            }
-         }
+         uint16_t *dst = frame_buf_data + (y * fb_width) + x;
+         bool wide     = ((((y + FONT_HEIGHT_STRIDE - 1) * fb_width) + x + 8) <= fb_size);
+
+         /* Text pixels + right/bottom shadow */
+         for (j = 0; j < FONT_HEIGHT_STRIDE; j++, dst += fb_width)
+            rgui_blit_glyph_row(dst, rgui->font_lut[symbol][j],
+                  rgui->font_shadow_lut[symbol][j],
+                  color, shadow_color, wide);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -2592,6 +2691,7 @@ static void blit_line_extended(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui_frame_buf.data;
+   size_t fb_size           = rgui_frame_buf.width * rgui_frame_buf.height;
 
    while (!string_is_empty(message))
    {
@@ -2600,7 +2700,9 @@ static void blit_line_extended(
          message++;
       else
       {
-         unsigned i, j;
+         unsigned j;
+         uint16_t *dst;
+         bool wide;
          uint32_t symbol = utf8_walk(&message);
 
          /* Stupid cretinous hack: 'oe' ligatures are not
@@ -2616,16 +2718,12 @@ static void blit_line_extended(
          if (symbol >= RGUI_NUM_FONT_GLYPHS_EXTENDED)
             continue;
 
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
+         dst  = frame_buf_data + (y * fb_width) + x;
+         wide = ((((y + FONT_HEIGHT - 1) * fb_width) + x + 8) <= fb_size);
 
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (rgui->font_lut[symbol][i + (j * FONT_WIDTH)])
-                  *(frame_buf_data + buff_offset + i) = color;
-            }
-         }
+         for (j = 0; j < FONT_HEIGHT; j++, dst += fb_width)
+            rgui_blit_glyph_row(dst, rgui->font_lut[symbol][j], 0,
+                  color, shadow_color, wide);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -2638,14 +2736,7 @@ static void blit_line_extended_shadow(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data     = rgui_frame_buf.data;
-   uint16_t color_buf[2];
-   uint16_t shadow_color_buf[2];
-
-   color_buf[0] = color;
-   color_buf[1] = shadow_color;
-
-   shadow_color_buf[0] = shadow_color;
-   shadow_color_buf[1] = shadow_color;
+   size_t fb_size               = rgui_frame_buf.width * rgui_frame_buf.height;
 
    while (!string_is_empty(message))
    {
@@ -2654,7 +2745,9 @@ static void blit_line_extended_shadow(
          message++;
       else
       {
-         unsigned i, j;
+         unsigned j;
+         uint16_t *dst;
+         bool wide;
          uint32_t symbol = utf8_walk(&message);
 
          /* Stupid cretinous hack: 'oe' ligatures are not
@@ -2670,25 +2763,14 @@ static void blit_line_extended_shadow(
          if (symbol >= RGUI_NUM_FONT_GLYPHS_EXTENDED)
             continue;
 
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
+         dst  = frame_buf_data + (y * fb_width) + x;
+         wide = ((((y + FONT_HEIGHT_STRIDE - 1) * fb_width) + x + 8) <= fb_size);
 
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (rgui->font_lut[symbol][i + (j * FONT_WIDTH)])
-               {
-                  uint16_t *frame_buf_ptr = frame_buf_data + buff_offset + i;
-
-                  /* Text pixel + right shadow */
-                  memcpy(frame_buf_ptr, color_buf, sizeof(color_buf));
-
-                  /* Bottom shadow */
-                  frame_buf_ptr += fb_width;
-                  memcpy(frame_buf_ptr, shadow_color_buf, sizeof(shadow_color_buf));
-               }
-            }
-         }
+         /* Text pixels + right/bottom shadow */
+         for (j = 0; j < FONT_HEIGHT_STRIDE; j++, dst += fb_width)
+            rgui_blit_glyph_row(dst, rgui->font_lut[symbol][j],
+                  rgui->font_shadow_lut[symbol][j],
+                  color, shadow_color, wide);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -2848,17 +2930,35 @@ static void rgui_init_font_lut(rgui_t *rgui)
          symbol_index < RGUI_NUM_FONT_GLYPHS_EXTENDED; 
          symbol_index++)
    {
+      uint8_t *rows        = rgui->font_lut[symbol_index];
+      uint8_t *shadow_rows = rgui->font_shadow_lut[symbol_index];
+
       for (j = 0; j < FONT_HEIGHT; j++)
       {
+         rows[j] = 0;
+
          for (i = 0; i < FONT_WIDTH; i++)
          {
             uint8_t rem = 1 << ((i + j * FONT_WIDTH) & 7);
             unsigned offset  = (i + j * FONT_WIDTH) >> 3;
             
-            /* LUT value is 'true' if specified glyph position contains a pixel */
-            rgui->font_lut[symbol_index][i + (j * FONT_WIDTH)] = (bitmap_bin[FONT_OFFSET(symbol_index) + offset] & rem) > 0;
+            /* Bit is set if specified glyph position contains a pixel */
+            if (bitmap_bin[FONT_OFFSET(symbol_index) + offset] & rem)
+               rows[j] |= 1 << i;
          }
       }
+
+      rows[FONT_HEIGHT] = 0;
+
+      /* Each glyph pixel casts a shadow to its right, below it
+       * and diagonally below-right - but never over another
+       * glyph pixel */
+      for (j = 0; j < FONT_HEIGHT_STRIDE; j++)
+      {
+         uint8_t above  = (j > 0) ? rows[j - 1] : 0;
+         shadow_rows[j] = (uint8_t)(((rows[j] << 1) | above | (above << 1))
+               & ~rows[j]);
+      }
    }
 }
 
@@ -4131,6 +4231,19 @@ static void rgui_render(void *data,
    }
 }
 
+static void rgui_texture_invalidate(void)
+{
+   rgui_last_frame_buf.width  = 0;
+   rgui_last_frame_buf.height = 0;
+
+   if (rgui_last_frame_buf.data)
+      free(rgui_last_frame_buf.data);
+   rgui_last_frame_buf.data   = NULL;
+
+   rgui_texture_width         = 0;
+   rgui_texture_height        = 0;
+}
+
 static void rgui_framebuffer_free(void)
 {
    rgui_frame_buf.width  = 0;
@@ -4139,6 +4252,8 @@ static void rgui_framebuffer_free(void)
    if (rgui_frame_buf.data)
       free(rgui_frame_buf.data);
    rgui_frame_buf.data   = NULL;
+
+   rgui_texture_invalidate();
 }
 
 static void rgui_background_free(void)
@@ -4757,10 +4872,82 @@ static void rgui_free(void *data)
    gfx_animation_unset_update_time_cb();
 }
 
+/* Compares the framebuffer against the copy taken at the
+ * last texture upload, and refreshes that copy.
+ * Returns false if nothing has changed - otherwise 'row_start'
+ * and 'row_end' are set to the first and last modified rows */
+static bool rgui_get_dirty_rows(unsigned fb_width, unsigned fb_height,
+      unsigned *row_start, unsigned *row_end)
+{
+   unsigned y;
+   size_t row_size = fb_width * sizeof(uint16_t);
+   bool dirty      = false;
+
+   *row_start      = 0;
+   *row_end        = (fb_height > 0) ? fb_height - 1 : 0;
+
+   /* No usable copy: everything is dirty */
+   if (  (rgui_last_frame_buf.width  != fb_width)  ||
+         (rgui_last_frame_buf.height != fb_height) ||
+         !rgui_last_frame_buf.data)
+   {
+      rgui_texture_invalidate();
+
+      rgui_last_frame_buf.data = (uint16_t*)malloc(
+            fb_width * fb_height * sizeof(uint16_t));
+
+      if (rgui_last_frame_buf.data)
+      {
+         rgui_last_frame_buf.width  = fb_width;
+         rgui_last_frame_buf.height = fb_height;
+         memcpy(rgui_last_frame_buf.data, rgui_frame_buf.data,
+               fb_width * fb_height * sizeof(uint16_t));
+      }
+
+      return true;
+   }
+
+   for (y = 0; y < fb_height; y++)
+   {
+      const uint16_t *src = rgui_frame_buf.data      + (y * fb_width);
+      uint16_t *dst       = rgui_last_frame_buf.data + (y * fb_width);
+
+      if (!memcmp(src, dst, row_size))
+         continue;
+
+      memcpy(dst, src, row_size);
+
+      if (!dirty)
+         *row_start = y;
+      *row_end      = y;
+      dirty         = true;
+   }
+
+   return dirty;
+}
+
+static void rgui_upload_texture(const uint16_t *data,
+      unsigned width, unsigned height, bool frame_modified)
+{
+   /* If the frame is unchanged, the video driver
+    * already holds an identical texture */
+   if (  !frame_modified &&
+         (rgui_texture_width  == width) &&
+         (rgui_texture_height == height))
+      return;
+
+   rgui_texture_width  = width;
+   rgui_texture_height = height;
+
+   video_driver_set_texture_frame(data, false, width, height, 1.0f);
+}
+
 static void rgui_set_texture(void)
 {
    size_t fb_pitch;
    unsigned fb_width, fb_height;
+   unsigned row_start, row_end;
+   bool frame_modified;
    settings_t            *settings = config_get_ptr();
    unsigned internal_upscale_level = settings->uints.menu_rgui_internal_upscale_level;
 
@@ -4772,10 +4959,17 @@ static void rgui_set_texture(void)
 
    gfx_display_unset_framebuffer_dirty_flag();
 
+   /* The dirty flag is raised whenever the menu is
+    * redrawn - but a redraw frequently produces the
+    * same image (or changes only a few rows, e.g. when
+    * a ticker scrolls), so check what actually changed */
+   frame_modified = rgui_get_dirty_rows(fb_width, fb_height,
+         &row_start, &row_end);
+
    if (internal_upscale_level == RGUI_UPSCALE_NONE)
    {
-      video_driver_set_texture_frame(rgui_frame_buf.data,
-         false, fb_width, fb_height, 1.0f);
+      rgui_upload_texture(rgui_frame_buf.data,
+         fb_width, fb_height, frame_modified);
    }
    else
    {
@@ -4787,15 +4981,15 @@ static void rgui_set_texture(void)
        * than the menu framebuffer, no scaling is required */
       if ((vp.width <= fb_width) && (vp.height <= fb_height))
       {
-         video_driver_set_texture_frame(rgui_frame_buf.data,
-            false, fb_width, fb_height, 1.0f);
+         rgui_upload_texture(rgui_frame_buf.data,
+            fb_width, fb_height, frame_modified);
       }
       else
       {
          unsigned out_width;
          unsigned out_height;
          uint32_t x_ratio, y_ratio;
-         unsigned x_src, y_src;
+         unsigned x_src, y_src, y_src_prev;
          unsigned x_dst, y_dst;
          
          /* Determine output size */
@@ -4834,31 +5028,63 @@ static void rgui_set_texture(void)
                configuration_set_uint(settings,
                      settings->uints.menu_rgui_internal_upscale_level,
                      RGUI_UPSCALE_NONE);
-               video_driver_set_texture_frame(rgui_frame_buf.data,
-                  false, fb_width, fb_height, 1.0f);
+               rgui_upload_texture(rgui_frame_buf.data,
+                  fb_width, fb_height, true);
                return;
             }
          }
+
+         /* The upscaling buffer only holds the previous frame
+          * if that is what was last uploaded - otherwise
+          * it must be regenerated in full */
+         if (  (rgui_texture_width  != out_width) ||
+               (rgui_texture_height != out_height))
+         {
+            row_start      = 0;
+            row_end        = fb_height - 1;
+            frame_modified = true;
+         }
+         else if (!frame_modified)
+            return;
          
-         /* Perform nearest neighbour upscaling
+         /* Perform nearest neighbour upscaling of modified rows
           * NB: We're duplicating code here, but trying to handle
           * this with a polymorphic function is too much of a drag... */
-         x_ratio = ((fb_width  << 16) / out_width);
-         y_ratio = ((fb_height << 16) / out_height);
+         x_ratio    = ((fb_width  << 16) / out_width);
+         y_ratio    = ((fb_height << 16) / out_height);
+         y_src_prev = fb_height;
 
          for (y_dst = 0; y_dst < out_height; y_dst++)
          {
+            uint16_t *dst = rgui_upscale_buf.data + (y_dst * out_width);
+            const uint16_t *src;
+
             y_src = (y_dst * y_ratio) >> 16;
+
+            if ((y_src < row_start) || (y_src > row_end))
+               continue;
+
+            /* Each source row is repeated several times -
+             * only scale it once */
+            if (y_src == y_src_prev)
+            {
+               memcpy(dst, dst - out_width, out_width * sizeof(uint16_t));
+               continue;
+            }
+
+            src        = rgui_frame_buf.data + (y_src * fb_width);
+            y_src_prev = y_src;
+
             for (x_dst = 0; x_dst < out_width; x_dst++)
             {
-               x_src = (x_dst * x_ratio) >> 16;
-               rgui_upscale_buf.data[(y_dst * out_width) + x_dst] = rgui_frame_buf.data[(y_src * fb_width) + x_src];
+               x_src      = (x_dst * x_ratio) >> 16;
+               dst[x_dst] = src[x_src];
             }
          }
          
          /* Draw upscaled texture */
-         video_driver_set_texture_frame(rgui_upscale_buf.data,
-            false, out_width, out_height, 1.0f);
+         rgui_upload_texture(rgui_upscale_buf.data,
+            out_width, out_height, frame_modified);
       }
    }
 }
@@ -4943,7 +5169,9 @@ static void rgui_load_current_thumbnails(rgui_t *rgui, bool download_missing)
 
       if (gfx_thumbnail_get_system(rgui->thumbnail_path_data, &system))
          task_push_pl_entry_thumbnail_download(system,
-               playlist_get_cached(), (unsigned)menu_navigation_get_selection(),
+               playlist_get_cached(),
+               (unsigned)menu_entries_get_virtual_index(
+                  menu_navigation_get_selection()),
                false, true);
    }
 #endif
@@ -4965,7 +5193,8 @@ static void rgui_scan_selected_entry_thumbnail(rgui_t *rgui, bool force_load)
          && rgui->is_playlist)
    {
       if (gfx_thumbnail_set_content_playlist(rgui->thumbnail_path_data,
-            playlist_get_cached(), menu_navigation_get_selection()))
+            playlist_get_cached(),
+            menu_entries_get_virtual_index(menu_navigation_get_selection())))
       {
          if (gfx_thumbnail_is_enabled(rgui->thumbnail_path_data, GFX_THUMBNAIL_RIGHT))
             has_thumbnail = gfx_thumbnail_update_path(rgui->thumbnail_path_data, GFX_THUMBNAIL_RIGHT);
@@ -5579,6 +5808,12 @@ static void rgui_toggle(void *userdata, bool menu_on)
       free(rgui_upscale_buf.data);
       rgui_upscale_buf.data = NULL;
    }
+
+   /* Likewise the copy of the last uploaded frame - the
+    * texture will be re-uploaded when the menu is next
+    * displayed */
+   if (!menu_on)
+      rgui_texture_invalidate();
 }
 
 static void rgui_context_reset(void *data, bool is_threaded)
@@ -5592,6 +5827,8 @@ static void rgui_context_reset(void *data, bool is_threaded)
    if (rgui->widgets_supported)
       gfx_display_allocate_white_texture();
 #endif
+   /* Menu texture may have been lost along with the context */
+   rgui_texture_invalidate();
    video_driver_monitor_reset();
 }
 
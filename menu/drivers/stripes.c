@@ -937,7 +937,7 @@ static void stripes_update_thumbnail_path(void *data, unsigned i, char pos)
    if (playlist)
    {
       const struct playlist_entry *entry  = NULL;
-      playlist_get_index(playlist, i, &entry);
+      playlist_get_index(playlist, menu_entries_get_virtual_index(i), &entry);
 
       if (string_is_equal(entry->core_name, "imageviewer"))
       {
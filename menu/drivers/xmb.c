@@ -1074,7 +1074,8 @@ static void xmb_update_thumbnail_image(void *data)
 {
    const char *core_name = NULL;
    xmb_handle_t                *xmb     = (xmb_handle_t*)data;
-   size_t                selection      = menu_navigation_get_selection();
+   size_t                selection      = menu_entries_get_virtual_index(
+         menu_navigation_get_selection());
    playlist_t                *playlist  = playlist_get_cached();
    settings_t                *settings  = config_get_ptr();
    unsigned thumbnail_upscale_threshold = settings->uints.gfx_thumbnail_upscale_threshold;
@@ -1222,7 +1223,8 @@ static void xmb_set_thumbnail_content(void *data, const char *s)
       /* Playlist content */
       if (string_is_empty(s))
       {
-         size_t selection = menu_navigation_get_selection();
+         size_t selection = menu_entries_get_virtual_index(
+               menu_navigation_get_selection());
          gfx_thumbnail_set_content_playlist(xmb->thumbnail_path_data,
                playlist_get_cached(), selection);
          xmb->fullscreen_thumbnails_available = true;
@@ -2246,6 +2248,7 @@ static void xmb_refresh_horizontal_list(xmb_handle_t *xmb)
    xmb->horizontal_list->list     = NULL;
    xmb->horizontal_list->capacity = 0;
    xmb->horizontal_list->size     = 0;
+   xmb->horizontal_list->pool     = NULL;
 
    if (xmb->horizontal_list)
       xmb_init_horizontal_list(xmb);
@@ -5412,6 +5415,7 @@ static void *xmb_init(void **userdata, bool video_is_threaded)
    xmb->selection_buf_old->list       = NULL;
    xmb->selection_buf_old->capacity   = 0;
    xmb->selection_buf_old->size       = 0;
+   xmb->selection_buf_old->pool       = NULL;
 
    xmb->categories_active_idx         = 0;
    xmb->categories_active_idx_old     = 0;
@@ -5470,6 +5474,7 @@ static void *xmb_init(void **userdata, bool video_is_threaded)
    xmb->horizontal_list->list     = NULL;
    xmb->horizontal_list->capacity = 0;
    xmb->horizontal_list->size     = 0;
+   xmb->horizontal_list->pool     = NULL;
 
    if (xmb->horizontal_list)
       xmb_init_horizontal_list(xmb);
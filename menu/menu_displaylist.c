@@ -125,9 +125,20 @@
 
 /* TODO/FIXME - globals - need to find a way to
  * get rid of these */
+/* How the entries of the playlist shown are labelled,
+ * see menu_displaylist_parse_playlist() */
+struct menu_displaylist_playlist_state
+{
+   void (*sanitization)(char*);
+   char path[PATH_MAX_LENGTH];
+   char label_spacer[PL_LABEL_SPACER_MAXLEN];
+   bool show_inline_core_name;
+};
+
 struct menu_displaylist_state
 {
    enum msg_hash_enums new_type;
+   struct menu_displaylist_playlist_state playlist;
    char new_path_entry[4096];
    char new_lbl_entry[4096];
    char new_entry[4096];
@@ -1385,40 +1396,142 @@ static unsigned menu_displaylist_parse_system_info(file_list_t *list)
    return count;
 }
 
+/* Writes the menu label of playlist entry @idx */
+static bool menu_displaylist_get_playlist_entry_label(size_t idx,
+      char *s, size_t len, void *userdata)
+{
+   struct menu_displaylist_playlist_state *pl_st =
+      (struct menu_displaylist_playlist_state*)userdata;
+   playlist_t *playlist                          = playlist_get_cached();
+   const struct playlist_entry *entry            = NULL;
+
+   if (!playlist || idx >= playlist_size(playlist))
+      return false;
+
+   /* Read playlist entry */
+   playlist_get_index(playlist, idx, &entry);
+
+   if (!string_is_empty(entry->path))
+   {
+      /* Standard playlist entry
+       * > Base menu entry label is always playlist label
+       *   > If playlist label is NULL, fallback to playlist entry file name
+       * > If required, add currently associated core (if any), otherwise
+       *   no further action is necessary */
+
+      if (string_is_empty(entry->label))
+         fill_short_pathname_representation(s, entry->path, len);
+      else
+         strlcpy(s, entry->label, len);
+
+      if (pl_st->sanitization)
+         (*pl_st->sanitization)(s);
+
+      if (pl_st->show_inline_core_name)
+      {
+         /* Both core name and core path must be valid */
+         if (!string_is_empty(entry->core_name) && !string_is_equal(entry->core_name, "DETECT") &&
+             !string_is_empty(entry->core_path) && !string_is_equal(entry->core_path, "DETECT"))
+         {
+            strlcat(s, pl_st->label_spacer, len);
+            strlcat(s, entry->core_name, len);
+         }
+      }
+   }
+   else
+   {
+      /* Playlist entry without content...
+       * This is useless/broken, but have to include
+       * it otherwise synchronisation between the menu
+       * and the underlying playlist will be lost...
+       * > Use label if available, otherwise core name
+       * > If both are missing, add an empty menu entry */
+      if (!string_is_empty(entry->label))
+         strlcpy(s, entry->label, len);
+      else if (!string_is_empty(entry->core_name))
+         strlcpy(s, entry->core_name, len);
+   }
+
+   return true;
+}
+
+/* Adds the menu entries of playlist entries [start, start + count)
+ * > Called again with another range whenever the window
+ *   of a long playlist moves, see menu_entries_append_virtual() */
+static void menu_displaylist_fill_playlist(file_list_t *list,
+      size_t start, size_t count, void *userdata)
+{
+   size_t i;
+   struct menu_displaylist_playlist_state *pl_st =
+      (struct menu_displaylist_playlist_state*)userdata;
+   playlist_t *playlist                          = playlist_get_cached();
+   size_t list_size                              = playlist_size(playlist);
+
+   if (start >= list_size)
+      return;
+
+   if (count > list_size - start)
+      count = list_size - start;
+
+   /* Preallocate the file list */
+   file_list_reserve(list, list->size + count);
+
+   for (i = start; i < start + count; i++)
+   {
+      char menu_entry_label[PATH_MAX_LENGTH];
+      const struct playlist_entry *entry  = NULL;
+
+      menu_entry_label[0] = '\0';
+
+      menu_displaylist_get_playlist_entry_label(i,
+            menu_entry_label, sizeof(menu_entry_label), pl_st);
+
+      playlist_get_index(playlist, i, &entry);
+
+      menu_entries_append_enum(list, menu_entry_label,
+            string_is_empty(entry->path) ? pl_st->path : entry->path,
+            MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
+   }
+}
+
 static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
       playlist_t *playlist, const char *path_playlist, bool is_collection)
 {
-   unsigned i;
-   char label_spacer[PL_LABEL_SPACER_MAXLEN];
+   struct menu_displaylist_playlist_state *pl_st = &menu_displist_st.playlist;
+   const char *conf_path             = playlist_get_conf_path(playlist);
    size_t           list_size        = playlist_size(playlist);
+   size_t           prev_size        = info->list->size;
    settings_t       *settings        = config_get_ptr();
-   bool show_inline_core_name        = false;
    const char *menu_driver           = menu_driver_ident();
    unsigned pl_show_inline_core_name = settings->uints.playlist_show_inline_core_name;
    bool pl_show_sublabels            = settings->bools.playlist_show_sublabels;
-   void (*sanitization)(char*);
 
-   label_spacer[0] = '\0';
+   pl_st->label_spacer[0]            = '\0';
+   pl_st->show_inline_core_name      = false;
 
    if (list_size == 0)
       goto error;
 
+   strlcpy(pl_st->path, path_playlist, sizeof(pl_st->path));
+
    /* Check whether core name should be added to playlist entries */
    if (!string_is_equal(menu_driver, "ozone") &&
        !pl_show_sublabels &&
        ((pl_show_inline_core_name == PLAYLIST_INLINE_CORE_DISPLAY_ALWAYS) ||
         (!is_collection && !(pl_show_inline_core_name == PLAYLIST_INLINE_CORE_DISPLAY_NEVER))))
    {
-      show_inline_core_name = true;
+      pl_st->show_inline_core_name = true;
 
 #ifdef HAVE_RGUI
       /* Get spacer for menu entry labels (<content><spacer><core>)
        * > Note: Only required when showing inline core names */
       if (string_is_equal(menu_driver, "rgui"))
-         strlcpy(label_spacer, PL_LABEL_SPACER_RGUI, sizeof(label_spacer));
+         strlcpy(pl_st->label_spacer, PL_LABEL_SPACER_RGUI,
+               sizeof(pl_st->label_spacer));
       else
 #endif
-         strlcpy(label_spacer, PL_LABEL_SPACER_DEFAULT, sizeof(label_spacer));
+         strlcpy(pl_st->label_spacer, PL_LABEL_SPACER_DEFAULT,
+               sizeof(pl_st->label_spacer));
    }
 
    /* Inform menu driver of current system name
@@ -1452,92 +1565,40 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
       menu_driver_set_thumbnail_system(lpl_basename, sizeof(lpl_basename));
    }
 
-   /* Preallocate the file list */
-   file_list_reserve(info->list, list_size);
-
    switch (playlist_get_label_display_mode(playlist))
    {
       case LABEL_DISPLAY_MODE_REMOVE_PARENTHESES :
-         sanitization = &label_remove_parens;
+         pl_st->sanitization = &label_remove_parens;
          break;
       case LABEL_DISPLAY_MODE_REMOVE_BRACKETS :
-         sanitization = &label_remove_brackets;
+         pl_st->sanitization = &label_remove_brackets;
          break;
       case LABEL_DISPLAY_MODE_REMOVE_PARENTHESES_AND_BRACKETS :
-         sanitization = &label_remove_parens_and_brackets;
+         pl_st->sanitization = &label_remove_parens_and_brackets;
          break;
       case LABEL_DISPLAY_MODE_KEEP_DISC_INDEX :
-         sanitization = &label_keep_disc;
+         pl_st->sanitization = &label_keep_disc;
          break;
       case LABEL_DISPLAY_MODE_KEEP_REGION :
-         sanitization = &label_keep_region;
+         pl_st->sanitization = &label_keep_region;
          break;
       case LABEL_DISPLAY_MODE_KEEP_REGION_AND_DISC_INDEX :
-         sanitization = &label_keep_region_and_disc;
+         pl_st->sanitization = &label_keep_region_and_disc;
          break;
       default :
-         sanitization = NULL;
+         pl_st->sanitization = NULL;
    }
 
-   for (i = 0; i < list_size; i++)
-   {
-      char menu_entry_label[PATH_MAX_LENGTH];
-      const struct playlist_entry *entry  = NULL;
-
-      menu_entry_label[0] = '\0';
-
-      /* Read playlist entry */
-      playlist_get_index(playlist, i, &entry);
-
-      if (!string_is_empty(entry->path))
-      {
-         /* Standard playlist entry
-          * > Base menu entry label is always playlist label
-          *   > If playlist label is NULL, fallback to playlist entry file name
-          * > If required, add currently associated core (if any), otherwise
-          *   no further action is necessary */
-
-         if (string_is_empty(entry->label))
-            fill_short_pathname_representation(menu_entry_label, entry->path, sizeof(menu_entry_label));
-         else
-            strlcpy(menu_entry_label, entry->label, sizeof(menu_entry_label));
+   /* Long playlists only get the entries around
+    * the selection, the rest is added on demand */
+   menu_entries_append_virtual(info->list,
+         string_is_empty(conf_path) ? 0 : msg_hash_calculate(conf_path),
+         list_size,
+         menu_displaylist_fill_playlist,
+         menu_displaylist_get_playlist_entry_label,
+         pl_st);
 
-         if (sanitization)
-            (*sanitization)(menu_entry_label);
-
-         if (show_inline_core_name)
-         {
-            /* Both core name and core path must be valid */
-            if (!string_is_empty(entry->core_name) && !string_is_equal(entry->core_name, "DETECT") &&
-                !string_is_empty(entry->core_path) && !string_is_equal(entry->core_path, "DETECT"))
-            {
-               strlcat(menu_entry_label, label_spacer, sizeof(menu_entry_label));
-               strlcat(menu_entry_label, entry->core_name, sizeof(menu_entry_label));
-            }
-         }
-
-         menu_entries_append_enum(info->list, menu_entry_label, entry->path,
-               MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
-      }
-      else
-      {
-         /* Playlist entry without content...
-          * This is useless/broken, but have to include
-          * it otherwise synchronisation between the menu
-          * and the underlying playlist will be lost...
-          * > Use label if available, otherwise core name
-          * > If both are missing, add an empty menu entry */
-         if (!string_is_empty(entry->label))
-            strlcpy(menu_entry_label, entry->label, sizeof(menu_entry_label));
-         else if (!string_is_empty(entry->core_name))
-            strlcpy(menu_entry_label, entry->core_name, sizeof(menu_entry_label));
-
-         menu_entries_append_enum(info->list, menu_entry_label, path_playlist,
-               MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
-      }
-
-      info->count++;
-   }
+   info->count += info->list->size - prev_size;
 
    return 0;
 
@@ -6635,6 +6696,10 @@ unsigned menu_displaylist_build_list(
                ? MENU_SETTINGS_LIBRETRO_PERF_COUNTERS_BEGIN
                : MENU_SETTINGS_PERF_COUNTERS_BEGIN;
 
+            /* The menu only has entry types for the first ones */
+            if (num > MAX_COUNTERS)
+               num = MAX_COUNTERS;
+
             if (counters && num != 0)
             {
                for (i = 0; i < num; i++)
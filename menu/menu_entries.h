@@ -27,10 +27,17 @@
 #include "menu_setting.h"
 #include "menu_input.h"
 #include "menu_displaylist.h"
+#include "menu_virtual_list.h"
 
 RETRO_BEGIN_DECLS
 
 #define MENU_SUBLABEL_MAX_LENGTH 1024
+#define MENU_TITLE_MAX_LENGTH    512
+
+/* Cached sublabels and titles, for the entries last shown.
+ * Must be powers of two. */
+#define MENU_SUBLABEL_CACHE_SIZE 64
+#define MENU_TITLE_CACHE_SIZE    8
 
 enum menu_entries_ctl_state
 {
@@ -75,8 +82,9 @@ typedef struct menu_ctx_list
 
 typedef struct menu_file_list_cbs
 {
-   char action_sublabel_cache[MENU_SUBLABEL_MAX_LENGTH];
-   char action_title_cache   [512];
+   /* Identifies the entry in the sublabel and title caches,
+    * copies of the entry share them */
+   uint32_t cache_id;
 
    enum msg_hash_enums enum_idx;
 
@@ -158,6 +166,33 @@ bool menu_entries_append_enum(file_list_t *list,
       enum msg_hash_enums enum_idx,
       unsigned type, size_t directory_ptr, size_t entry_idx);
 
+/**
+ * menu_entries_append_virtual:
+ * @list               : List to add the entries to.
+ * @ident              : Identifies the source of the entries, e.g.
+ *                       a hash of the playlist path.
+ * @size               : Number of entries.
+ * @fill               : Adds a range of the entries to a list.
+ * @get_name           : Name of an entry as shown, for searching.
+ * @userdata           : Passed to @fill and @get_name.
+ *
+ * Adds @size entries to @list. When @list is the selection buffer
+ * and @size is larger than MENU_VIRTUAL_LIST_THRESHOLD, only a
+ * window of them around the selection is added; the window follows
+ * the selection, and @fill is called again whenever it has to move.
+ * Until @list is cleared, entry i of @list is entry
+ * menu_entries_get_virtual_index(i) of the source.
+ **/
+void menu_entries_append_virtual(file_list_t *list,
+      uint32_t ident, size_t size,
+      menu_virtual_list_fill_t fill,
+      menu_virtual_list_get_name_t get_name,
+      void *userdata);
+
+/* Index in the source of the list shown of its entry @idx,
+ * see menu_entries_append_virtual() */
+size_t menu_entries_get_virtual_index(size_t idx);
+
 bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data);
 
 void menu_entries_set_checked(file_list_t *list, size_t entry_idx,
@@ -20,9 +20,12 @@
 #include "../retroarch.h"
 #include "../configuration.h"
 #include "../playlist.h"
-#include "../libretro-db/libretrodb.h"
+#include "../file_path_special.h"
+#include "../verbosity.h"
+#include "menu_explore_index.h"
 #include <compat/strcasestr.h>
 #include <compat/strl.h>
+#include <vfs/vfs_implementation.h>
 
 /* Stretchy buffers, invented (?) by Sean Barrett */
 #define EX_BUF__HDR(b) (((struct ex_buf_hdr *)(b))-1)
@@ -96,10 +99,13 @@ typedef struct
 
 typedef struct
 {
-   const struct playlist_entry* playlist_entry;
+   const char *label;
    explore_string_t *by[EXPLORE_CAT_COUNT];
    explore_string_t **split;
-   char* original_title;
+   const char *original_title;
+   /* Playlist of the index, and the entry in there */
+   unsigned playlist;
+   unsigned index;
 } explore_entry_t;
 
 typedef struct 
@@ -109,6 +115,9 @@ typedef struct
    bool has_unknown[EXPLORE_CAT_COUNT];
 
    explore_entry_t* entries;
+   /* Owns the strings of the entries */
+   explore_index_t *index;
+   /* Per playlist of the index, loaded when needed */
    playlist_t **playlists;
    const char* label_explore_item_str;
    char title[1024];
@@ -345,9 +354,9 @@ static int explore_qsort_func_entries(const void *a_, const void *b_)
 {
    const explore_entry_t *a = (const explore_entry_t*)a_;
    const explore_entry_t *b = (const explore_entry_t*)b_;
-   if (a->playlist_entry->label[0] != b->playlist_entry->label[0])
-      return (unsigned char)a->playlist_entry->label[0] - (unsigned char)b->playlist_entry->label[0];
-   return strcasecmp(a->playlist_entry->label, b->playlist_entry->label);
+   if (a->label[0] != b->label[0])
+      return (unsigned char)a->label[0] - (unsigned char)b->label[0];
+   return strcasecmp(a->label, b->label);
 }
 
 static int explore_qsort_func_menulist(const void *a_, const void *b_)
@@ -483,22 +492,37 @@ static void explore_free(explore_state_t *state)
          playlist_free(state->playlists[i]);
    EX_BUF_FREE(state->playlists);
    ex_arena_free(&state->arena);
+   explore_index_free(state->index);
+}
+
+static void explore_playlist_config(playlist_config_t *playlist_config,
+      const char *path)
+{
+   strlcpy(playlist_config->path, path, sizeof(playlist_config->path));
+   playlist_config->base_content_directory[0] = '\0';
+   playlist_config->capacity                  = COLLECTION_SIZE;
+   playlist_config->old_format                = false;
+   playlist_config->compress                  = false;
+   playlist_config->fuzzy_archive_match       = false;
+   playlist_config->autofix_paths             = false;
 }
 
 static void explore_build_list(void)
 {
    unsigned i;
    char tmp[PATH_MAX_LENGTH];
-   struct explore_rdb { libretrodb_t *handle; ex_hashmap32 playlist_entries; } 
-   *rdbs                                    = NULL;
+   explore_index_stats_t stats;
+   const char *fields[EXPLORE_BY_SYSTEM];
+   const explore_index_entry_t *entries     = NULL;
+   size_t num_entries                       = 0;
    core_info_list_t *core_list              = NULL;
    ex_hashmap32 map_cores                   = {0};
-   ex_hashmap32 rdb_indices                 = {0};
    ex_hashmap32 cat_maps[EXPLORE_CAT_COUNT] = {{0}};
    explore_string_t **split_buf             = NULL;
    settings_t *settings                     = config_get_ptr();
    const char *directory_playlist           = settings->paths.directory_playlist;
    const char *directory_database           = settings->paths.path_content_database;
+   const char *directory_cache              = settings->paths.directory_cache;
    libretro_vfs_implementation_dir *dir     = NULL;
 
    menu_explore_free();
@@ -509,23 +533,27 @@ static void explore_build_list(void)
    explore_state->label_explore_item_str    = 
       msg_hash_to_str(MENU_ENUM_LABEL_EXPLORE_ITEM);
 
-   /* Index all playlists */
+   /* The system comes from the core info, the rest from the databases */
+   for (i = 0; i != EXPLORE_BY_SYSTEM; i++)
+      fields[i] = explore_by_info[i].rdbkey;
+
+   fill_pathname_join(tmp,
+         string_is_empty(directory_cache) ? directory_playlist : directory_cache,
+         file_path_str(FILE_PATH_EXPLORE_INDEX), sizeof(tmp));
+   explore_state->index = explore_index_new(tmp, fields, EXPLORE_BY_SYSTEM);
+
+   if (!explore_state->index)
+      return;
+
+   /* Index all playlists that changed since last time */
    for (dir = retro_vfs_opendir_impl(directory_playlist, false); dir;)
    {
       playlist_config_t playlist_config;
-      size_t j, used_entries                    = 0;
+      size_t j;
       playlist_t *playlist                      = NULL;
       const char *fext                          = NULL;
       const char *fname                         = NULL;
 
-      playlist_config.path[0]                   = '\0';
-      playlist_config.base_content_directory[0] = '\0';
-      playlist_config.capacity                  = 0;
-      playlist_config.old_format                = false;
-      playlist_config.compress                  = false;
-      playlist_config.fuzzy_archive_match       = false;
-      playlist_config.autofix_paths             = false;
-
       if (!retro_vfs_readdir_impl(dir))
       {
          retro_vfs_closedir_impl(dir);
@@ -539,16 +567,17 @@ static void explore_build_list(void)
       if (!fext || strcasecmp(fext, ".lpl"))
          continue;
 
-      fill_pathname_join(playlist_config.path,
-            directory_playlist, fname, sizeof(playlist_config.path));
-      playlist_config.capacity          = COLLECTION_SIZE;
+      fill_pathname_join(tmp, directory_playlist, fname, sizeof(tmp));
+
+      if (explore_index_begin_playlist(explore_state->index, tmp))
+         continue;
+
+      explore_playlist_config(&playlist_config, tmp);
       playlist                          = playlist_init(&playlist_config);
 
       for (j = 0; j < playlist_size(playlist); j++)
       {
-         uintptr_t rdb_num;
          uint32_t entry_crc32;
-         struct explore_rdb* rdb             = NULL;
          const struct playlist_entry *entry  = NULL;
          playlist_get_index(playlist, j, &entry);
 
@@ -563,190 +592,76 @@ static void explore_build_list(void)
                || !*entry->label)
             continue;
 
-         rdb_num = ex_hashmap32_strgetnum(&rdb_indices, entry->db_name);
-         if (!rdb_num)
-         {
-            struct explore_rdb rdb;
-
-            rdb.handle                = libretrodb_new();
-            rdb.playlist_entries.len  = 0;
-            rdb.playlist_entries.cap  = 0;
-            rdb.playlist_entries.keys = NULL;
-            rdb.playlist_entries.vals = NULL;
-
-            fill_pathname_join_noext(
-                  tmp, directory_database, entry->db_name, sizeof(tmp));
-            strlcat(tmp, ".rdb", sizeof(tmp));
-
-            if (libretrodb_open(tmp, rdb.handle) != 0)
-            {
-               /* Invalid RDB file */
-               libretrodb_free(rdb.handle);
-               ex_hashmap32_strsetnum(&rdb_indices,
-                     entry->db_name, (uintptr_t)-1);
-               continue;
-            }
-
-            EX_BUF_PUSH(rdbs, rdb);
-            rdb_num = (uintptr_t)EX_BUF_LEN(rdbs);
-            ex_hashmap32_strsetnum(&rdb_indices, entry->db_name, rdb_num);
-         }
-
-         if (rdb_num == (uintptr_t)-1)
+         if (!(entry_crc32 = (uint32_t)strtoul(entry->crc32, NULL, 16)))
             continue;
 
-         rdb         = &rdbs[rdb_num - 1];
-         entry_crc32 = (uint32_t)strtoul(entry->crc32, NULL, 16);
-         ex_hashmap32_setptr(&rdb->playlist_entries,
-               entry_crc32, (void*)entry);
-         used_entries++;
+         explore_index_add_entry(explore_state->index, entry->label,
+               entry->core_name, entry->db_name, entry_crc32, (unsigned)j);
       }
 
-      if (used_entries)
-         EX_BUF_PUSH(explore_state->playlists, playlist);
-      else
-         playlist_free(playlist);
+      playlist_free(playlist);
    }
 
+   /* Look up what is new in the databases */
+   explore_index_update(explore_state->index, directory_database,
+         EXPLORE_INDEX_DEFAULT_THREADS);
+   explore_index_save(explore_state->index);
+
+   explore_index_get_stats(explore_state->index, &stats);
+   RARCH_LOG("[Explore]: %u entries, %u of %u playlists parsed, %u databases read.\n",
+         stats.entries, stats.playlists_parsed, stats.playlists,
+         stats.databases_read);
+
    if (core_info_get_list(&core_list) && core_list)
       for (i = 0; i != core_list->count; i++)
          ex_hashmap32_strsetptr(&map_cores,
                core_list->list[i].display_name,
                &core_list->list[i]);
 
-   /* Loop through all RDBs referenced in the playlists 
-    * and load meta data strings */
-   for (i = 0; i != EX_BUF_LEN(rdbs); i++)
-   {
-      struct rmsgpack_dom_value item;
-      struct explore_rdb* rdb  = &rdbs[i];
-      libretrodb_cursor_t *cur = libretrodb_cursor_new();
-      bool more                = 
-         (
-          libretrodb_cursor_open(rdb->handle, cur, NULL) == 0
-          && libretrodb_cursor_read_item(cur, &item) == 0);
-
-      for (; more; more = (rmsgpack_dom_value_free(&item),
-               libretrodb_cursor_read_item(cur, &item) == 0))
-      {
-         unsigned k, l, cat;
-         uint32_t crc32;
-         explore_entry_t e;
-         char *fields[EXPLORE_CAT_COUNT];
-         char numeric_buf[EXPLORE_CAT_COUNT][16];
-         const struct playlist_entry *entry = NULL;
-         char *original_title               = NULL;
-         bool found_crc32                   = false;
-         core_info_t* core_info             = NULL;
-
-         if (item.type != RDT_MAP)
-            continue;
+   num_entries = explore_index_get_entries(explore_state->index, &entries);
 
-         for (k = 0; k < EXPLORE_CAT_COUNT; k++)
-            fields[k]                       = NULL;
-
-         for (k = 0; k < item.val.map.len; k++)
-         {
-            const char *key_str             = NULL;
-            struct rmsgpack_dom_value *key  = &item.val.map.items[k].key;
-            struct rmsgpack_dom_value *val  = &item.val.map.items[k].value;
-            if (!key || !val || key->type != RDT_STRING)
-               continue;
-
-            key_str                         = key->val.string.buff;
-            if (string_is_equal(key_str, "crc"))
-            {
-               crc32                        = 
-                  swap_if_little32(*(uint32_t*)val->val.binary.buff);
-               found_crc32                  = true;
-               continue;
-            }
-            else if (string_is_equal(key_str, "original_title"))
-            {
-               original_title = val->val.string.buff;
-               continue;
-            }
-
-            for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
-            {
-               if (!string_is_equal(key_str, explore_by_info[cat].rdbkey))
-                  continue;
-
-               if (explore_by_info[cat].is_numeric)
-               {
-                  if (!val->val.int_)
-                     break;
-                  snprintf(numeric_buf[cat],
-                        sizeof(numeric_buf[cat]),
-                        "%d", (int)val->val.int_);
-                  fields[cat] = numeric_buf[cat];
-                  break;
-               }
-               if (val->type != RDT_STRING)
-                  break;
-               fields[cat] = val->val.string.buff;
-               break;
-            }
-         }
-
-         if (!found_crc32)
-            continue;
-
-         entry = (const struct playlist_entry *)ex_hashmap32_getptr(
-               &rdb->playlist_entries, crc32);
-         if (!entry)
-            continue;
-
-         e.playlist_entry  = entry;
-         for (l = 0; l < EXPLORE_CAT_COUNT; l++)
-            e.by[l]        = NULL;
-         e.split           = NULL;
-         e.original_title  = NULL;
-
-         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
-            explore_add_unique_string(cat_maps, &e, cat,
-                  fields[cat], &split_buf);
-
-         if (!string_is_empty(entry->core_name))
-            core_info = (core_info_t*)
-               ex_hashmap32_strgetptr(&map_cores, entry->core_name);
-         explore_add_unique_string(cat_maps, &e,
-               EXPLORE_BY_SYSTEM,
-               (core_info ? core_info->systemname : NULL), NULL);
-
-         if (original_title && *original_title)
-         {
-            size_t len       = strlen(original_title) + 1;
-            e.original_title = (char*)
-               ex_arena_alloc(&explore_state->arena, len);
-            memcpy(e.original_title, original_title, len);
-         }
-
-         if (EX_BUF_LEN(split_buf))
-         {
-            size_t len;
-
-            EX_BUF_PUSH(split_buf, NULL); /* terminator */
-            len        = EX_BUF_SIZEOF(split_buf);
-            e.split    = (explore_string_t **)
-               ex_arena_alloc(&explore_state->arena, len);
-            memcpy(e.split, split_buf, len);
-            EX_BUF_CLEAR(split_buf);
-         }
+   for (i = 0; i != num_entries; i++)
+   {
+      unsigned cat;
+      explore_entry_t e;
+      const explore_index_entry_t *entry = &entries[i];
+      core_info_t* core_info             = NULL;
 
-         EX_BUF_PUSH(explore_state->entries, e);
+      e.label           = entry->label;
+      for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+         e.by[cat]      = NULL;
+      e.split           = NULL;
+      e.original_title  = entry->original_title;
+      e.playlist        = entry->playlist;
+      e.index           = entry->index;
+
+      for (cat = 0; cat != EXPLORE_BY_SYSTEM; cat++)
+         explore_add_unique_string(cat_maps, &e, cat,
+               entry->fields[cat], &split_buf);
+
+      if (!string_is_empty(entry->core_name))
+         core_info = (core_info_t*)
+            ex_hashmap32_strgetptr(&map_cores, entry->core_name);
+      explore_add_unique_string(cat_maps, &e,
+            EXPLORE_BY_SYSTEM,
+            (core_info ? core_info->systemname : NULL), NULL);
+
+      if (EX_BUF_LEN(split_buf))
+      {
+         size_t len;
+
+         EX_BUF_PUSH(split_buf, NULL); /* terminator */
+         len        = EX_BUF_SIZEOF(split_buf);
+         e.split    = (explore_string_t **)
+            ex_arena_alloc(&explore_state->arena, len);
+         memcpy(e.split, split_buf, len);
+         EX_BUF_CLEAR(split_buf);
       }
 
-      libretrodb_cursor_close(cur);
-      libretrodb_cursor_free(cur);
-      libretrodb_close(rdb->handle);
-      libretrodb_free(rdb->handle);
-      ex_hashmap32_free(&rdb->playlist_entries);
+      EX_BUF_PUSH(explore_state->entries, e);
    }
    EX_BUF_FREE(split_buf);
    ex_hashmap32_free(&map_cores);
-   ex_hashmap32_free(&rdb_indices);
-   EX_BUF_FREE(rdbs);
 
    for (i = 0; i != EXPLORE_CAT_COUNT; i++)
    {
@@ -919,6 +834,9 @@ unsigned menu_displaylist_explore(file_list_t *list)
    {
       /* free any existing playlist 
        * when entering the explore view */
+      for (i = 0; i != EX_BUF_LEN(explore_state->playlists); i++)
+         if (explore_state->playlists[i] == playlist_get_cached())
+            explore_state->playlists[i] = NULL;
       playlist_free_cached();
    }
 
@@ -1090,7 +1008,7 @@ SKIP_EXPLORE_BY_CATEGORY:;
          }
 
          if (use_find && 
-               !strcasestr(e->playlist_entry->label,
+               !strcasestr(e->label,
                   explore_state->find_string))
             goto SKIP_ENTRY;
 
@@ -1115,7 +1033,7 @@ SKIP_EXPLORE_BY_CATEGORY:;
                   explore_state,
                   (e->original_title 
                    ? e->original_title 
-                   : e->playlist_entry->label),
+                   : e->label),
                   EXPLORE_TYPE_FIRSTITEM + (e - explore_state->entries));
          }
 
@@ -1140,39 +1058,78 @@ SKIP_ENTRY:;
    else
    {
       /* Content page of selected game */
-      int pl_idx;
-      const struct playlist_entry *pl_entry = 
-         explore_state->entries[current_type - EXPLORE_TYPE_FIRSTITEM].playlist_entry;
+      size_t pl_idx;
+      playlist_t *pl                        = NULL;
+      const struct playlist_entry *pl_entry = NULL;
+      const explore_entry_t *e              = 
+         &explore_state->entries[current_type - EXPLORE_TYPE_FIRSTITEM];
       menu_handle_t                   *menu = menu_driver_get_ptr();
 
       strlcpy(explore_state->title,
-            pl_entry->label, sizeof(explore_state->title));
+            e->label, sizeof(explore_state->title));
 
-      for (pl_idx = 0; pl_idx != EX_BUF_LEN(explore_state->playlists); pl_idx++)
+      /* Only the playlist of the entry is loaded */
+      if (EX_BUF_LEN(explore_state->playlists) <= e->playlist)
+      {
+         size_t len = EX_BUF_LEN(explore_state->playlists);
+
+         EX_BUF_RESIZE(explore_state->playlists, e->playlist + 1);
+         for (; len <= e->playlist; len++)
+            explore_state->playlists[len] = NULL;
+      }
+
+      if (!(pl = explore_state->playlists[e->playlist]))
+      {
+         playlist_config_t playlist_config;
+         const char *path = explore_index_get_playlist(
+               explore_state->index, e->playlist);
+
+         if (path)
+         {
+            explore_playlist_config(&playlist_config, path);
+            pl = explore_state->playlists[e->playlist] =
+               playlist_init(&playlist_config);
+         }
+      }
+
+      if (pl)
+      {
+         /* The playlist may have changed since it was indexed */
+         if (e->index < playlist_size(pl))
+         {
+            playlist_get_index(pl, e->index, &pl_entry);
+            if (!string_is_equal(pl_entry->label, e->label))
+               pl_entry = NULL;
+         }
+
+         for (pl_idx = 0; !pl_entry && pl_idx < playlist_size(pl); pl_idx++)
+         {
+            const struct playlist_entry *pl_cur = NULL;
+
+            playlist_get_index(pl, pl_idx, &pl_cur);
+            if (string_is_equal(pl_cur->label, e->label))
+               pl_entry = pl_cur;
+         }
+      }
+
+      if (pl_entry)
       {
          menu_displaylist_info_t          info;
          const struct playlist_entry* pl_first = NULL;
-         playlist_t                       *pl  = 
-            explore_state->playlists[pl_idx];
 
          menu_displaylist_info_init(&info);
 
          playlist_get_index(pl, 0, &pl_first);
 
-         if (  pl_entry <  pl_first || 
-               pl_entry >= pl_first + playlist_size(pl))
-            continue;
-
          /* Fake all the state so the content screen 
           * and information screen think we're viewing via playlist */
          playlist_set_cached(pl);
          explore_state->cached_playlist = pl;
-         menu->rpl_entry_selection_ptr = (pl_entry - pl_first);
+         menu->rpl_entry_selection_ptr = (unsigned)(pl_entry - pl_first);
          strlcpy(menu->deferred_path,
                pl_entry->path, sizeof(menu->deferred_path));
          info.list                     = list;
          menu_displaylist_ctl(DISPLAYLIST_HORIZONTAL_CONTENT_ACTIONS, &info);
-         break;
       }
    }
 
@@ -0,0 +1,1402 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2020 - Daniel De Matteis
+ *  Copyright (C) 2020      - Psyraven
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <encodings/utf.h>
+#include <file/file_path.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "../libretro-db/libretrodb.h"
+
+#include "menu_explore_index.h"
+
+/* "REXI" */
+#define EXPLORE_INDEX_MAGIC      0x49584552
+#define EXPLORE_INDEX_VERSION    1
+
+#define EXPLORE_INDEX_BLOCK_SIZE (64 * 1024)
+#define EXPLORE_INDEX_NONE       ((uint32_t)-1)
+
+/* Strings live in blocks freed all at once */
+typedef struct explore_index_arena
+{
+   char *ptr;
+   char *end;
+   char **blocks;
+   size_t count;
+   size_t capacity;
+} explore_index_arena_t;
+
+typedef struct explore_index_playlist
+{
+   char *path;
+   int64_t size;
+   int64_t mtime;
+   /* Begun since the index was loaded */
+   bool used;
+} explore_index_playlist_t;
+
+typedef struct explore_index_db
+{
+   char *name;
+   int64_t size;
+   int64_t mtime;
+   /* Compared against the file during this update */
+   bool checked;
+} explore_index_db_t;
+
+/* Playlist entry */
+typedef struct explore_index_item
+{
+   char *label;
+   char *core_name;
+   uint32_t crc;
+   uint32_t db;
+   uint32_t playlist;
+   uint32_t index;
+} explore_index_item_t;
+
+/* What a database has for a CRC */
+typedef struct explore_index_record
+{
+   /* The fields, then the original title. NULL if not found. */
+   const char **values;
+   uint32_t crc;
+   uint32_t db;
+   /* Entry made from it + 1, while collecting entries */
+   uint32_t entry;
+   bool pending;
+   bool used;
+} explore_index_record_t;
+
+struct explore_index
+{
+   explore_index_arena_t arena;
+   char **fields;
+   explore_index_playlist_t *playlists;
+   explore_index_db_t *dbs;
+   explore_index_item_t *items;
+   explore_index_record_t *records;
+   /* Open addressing over records, index + 1, 0 when empty */
+   uint32_t *table;
+   explore_index_entry_t *entries;
+   size_t num_playlists, cap_playlists;
+   size_t num_dbs, cap_dbs;
+   size_t num_items, cap_items;
+   size_t num_records, cap_records;
+   size_t num_entries, cap_entries;
+   size_t table_size;
+   explore_index_stats_t stats;
+   unsigned num_fields;
+   /* Playlist explore_index_add_entry() adds to */
+   uint32_t current;
+   char path[PATH_MAX_LENGTH];
+   bool changed;
+   bool updated;
+};
+
+typedef struct explore_index_reader
+{
+   const uint8_t *ptr;
+   const uint8_t *end;
+   bool error;
+} explore_index_reader_t;
+
+typedef struct explore_index_writer
+{
+   uint8_t *data;
+   size_t len;
+   size_t capacity;
+   bool error;
+} explore_index_writer_t;
+
+/* Reads the databases with pending records */
+typedef struct explore_index_job
+{
+   explore_index_t *index;
+   explore_index_arena_t arena;
+   /* Pending records of the database, by CRC */
+   uint32_t *table;
+   size_t table_size;
+   uint32_t db;
+   char path[PATH_MAX_LENGTH];
+} explore_index_job_t;
+
+typedef struct explore_index_jobs
+{
+   explore_index_job_t *jobs;
+   size_t count;
+   size_t next;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} explore_index_jobs_t;
+
+static bool explore_index_reserve(void **ptr, size_t *capacity,
+      size_t count, size_t size)
+{
+   void *tmp;
+   size_t new_capacity;
+
+   if (count <= *capacity)
+      return true;
+
+   new_capacity = *capacity ? *capacity * 2 : 64;
+   while (new_capacity < count)
+      new_capacity *= 2;
+
+   if (!(tmp = realloc(*ptr, new_capacity * size)))
+      return false;
+
+   *ptr      = tmp;
+   *capacity = new_capacity;
+   return true;
+}
+
+static void *explore_index_alloc(explore_index_arena_t *arena, size_t size)
+{
+   void *ptr = NULL;
+
+   size      = (size + 7) & ~(size_t)7;
+
+   if (size > (size_t)(arena->end - arena->ptr))
+   {
+      size_t block_size = MAX(size, EXPLORE_INDEX_BLOCK_SIZE);
+      char *block       = NULL;
+
+      if (!explore_index_reserve((void**)&arena->blocks, &arena->capacity,
+               arena->count + 1, sizeof(*arena->blocks)))
+         return NULL;
+
+      if (!(block = (char*)malloc(block_size)))
+         return NULL;
+
+      arena->blocks[arena->count++] = block;
+      arena->ptr                    = block;
+      arena->end                    = block + block_size;
+   }
+
+   ptr         = arena->ptr;
+   arena->ptr += size;
+   return ptr;
+}
+
+/* Copies @len bytes of @str, NULL for an empty string */
+static char *explore_index_strndup(explore_index_arena_t *arena,
+      const char *str, size_t len)
+{
+   char *copy = NULL;
+
+   if (!str || !len || !(copy = (char*)explore_index_alloc(arena, len + 1)))
+      return NULL;
+
+   memcpy(copy, str, len);
+   copy[len] = '\0';
+   return copy;
+}
+
+static char *explore_index_strdup(explore_index_arena_t *arena,
+      const char *str)
+{
+   return explore_index_strndup(arena, str, str ? strlen(str) : 0);
+}
+
+/* Hands the blocks of @src over to @dst */
+static void explore_index_arena_merge(explore_index_arena_t *dst,
+      explore_index_arena_t *src)
+{
+   size_t i;
+
+   /* On failure the blocks leak, they are still referenced */
+   if (explore_index_reserve((void**)&dst->blocks, &dst->capacity,
+            dst->count + src->count, sizeof(*dst->blocks)))
+      for (i = 0; i < src->count; i++)
+         dst->blocks[dst->count++] = src->blocks[i];
+
+   free(src->blocks);
+   memset(src, 0, sizeof(*src));
+}
+
+static void explore_index_arena_free(explore_index_arena_t *arena)
+{
+   size_t i;
+
+   for (i = 0; i < arena->count; i++)
+      free(arena->blocks[i]);
+
+   free(arena->blocks);
+   memset(arena, 0, sizeof(*arena));
+}
+
+/* Size and modification time of @path, -1 for both if it is missing */
+static void explore_index_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+#if defined(LEGACY_WIN32)
+   struct _stat buf;
+   char *path_local   = utf8_to_local_string_alloc(path);
+   int ret            = path_local ? _stat(path_local, &buf) : -1;
+
+   free(path_local);
+#else
+   struct _stat64 buf;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+   int ret            = path_wide ? _wstat64(path_wide, &buf) : -1;
+
+   free(path_wide);
+#endif
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+   struct stat buf;
+   int ret = stat(path, &buf);
+#else
+   struct { int64_t st_size; int64_t st_mtime; } buf;
+   int ret = -1;
+
+   /* No modification time, always read everything */
+   buf.st_size  = 0;
+   buf.st_mtime = 0;
+#endif
+
+   if (ret != 0)
+   {
+      *size  = -1;
+      *mtime = -1;
+      return;
+   }
+
+   *size  = (int64_t)buf.st_size;
+   *mtime = (int64_t)buf.st_mtime;
+}
+
+static uint32_t explore_index_record_hash(uint32_t db, uint32_t crc)
+{
+   return (crc ^ (db * 0x9E3779B1u)) * 0x85EBCA6Bu;
+}
+
+static explore_index_record_t *explore_index_find_record(
+      explore_index_t *index, uint32_t db, uint32_t crc)
+{
+   size_t i;
+
+   if (!index->table_size)
+      return NULL;
+
+   for (i = explore_index_record_hash(db, crc) & (index->table_size - 1);
+         index->table[i]; i = (i + 1) & (index->table_size - 1))
+   {
+      explore_index_record_t *record = &index->records[index->table[i] - 1];
+
+      if (record->crc == crc && record->db == db)
+         return record;
+   }
+
+   return NULL;
+}
+
+static void explore_index_rehash(explore_index_t *index, size_t table_size)
+{
+   size_t i;
+   uint32_t *table = (uint32_t*)calloc(table_size, sizeof(*table));
+
+   if (!table)
+      return;
+
+   for (i = 0; i < index->num_records; i++)
+   {
+      const explore_index_record_t *record = &index->records[i];
+      size_t j = explore_index_record_hash(record->db, record->crc)
+         & (table_size - 1);
+
+      while (table[j])
+         j = (j + 1) & (table_size - 1);
+
+      table[j] = (uint32_t)(i + 1);
+   }
+
+   free(index->table);
+   index->table      = table;
+   index->table_size = table_size;
+}
+
+static explore_index_record_t *explore_index_add_record(
+      explore_index_t *index, uint32_t db, uint32_t crc)
+{
+   explore_index_record_t *record = NULL;
+
+   if (!explore_index_reserve((void**)&index->records, &index->cap_records,
+            index->num_records + 1, sizeof(*index->records)))
+      return NULL;
+
+   record         = &index->records[index->num_records++];
+   memset(record, 0, sizeof(*record));
+   record->crc    = crc;
+   record->db     = db;
+
+   /* Keep the table at most half full */
+   if (index->num_records * 2 > index->table_size)
+      explore_index_rehash(index,
+            index->table_size ? index->table_size * 2 : 1024);
+   else
+   {
+      size_t i = explore_index_record_hash(db, crc)
+         & (index->table_size - 1);
+
+      while (index->table[i])
+         i = (i + 1) & (index->table_size - 1);
+
+      index->table[i] = (uint32_t)index->num_records;
+   }
+
+   return record;
+}
+
+/* Forgets what database @db had, after it changed */
+static void explore_index_drop_records(explore_index_t *index, uint32_t db)
+{
+   size_t i;
+   size_t count = 0;
+
+   for (i = 0; i < index->num_records; i++)
+      if (index->records[i].db != db)
+         index->records[count++] = index->records[i];
+
+   if (count != index->num_records)
+   {
+      index->num_records = count;
+      explore_index_rehash(index, index->table_size);
+   }
+}
+
+static uint32_t explore_index_get_db(explore_index_t *index,
+      const char *name)
+{
+   size_t i;
+   explore_index_db_t *db = NULL;
+
+   for (i = index->num_dbs; i-- > 0;)
+      if (string_is_equal(index->dbs[i].name, name))
+         return (uint32_t)i;
+
+   if (!explore_index_reserve((void**)&index->dbs, &index->cap_dbs,
+            index->num_dbs + 1, sizeof(*index->dbs)))
+      return EXPLORE_INDEX_NONE;
+
+   db          = &index->dbs[index->num_dbs];
+   memset(db, 0, sizeof(*db));
+   db->size    = -1;
+   db->mtime   = -1;
+
+   if (!(db->name = explore_index_strdup(&index->arena, name)))
+      return EXPLORE_INDEX_NONE;
+
+   return (uint32_t)index->num_dbs++;
+}
+
+static uint32_t explore_index_read_u32(explore_index_reader_t *reader)
+{
+   uint32_t val = 0;
+
+   if (reader->end - reader->ptr < 4)
+      reader->error = true;
+   else
+   {
+      memcpy(&val, reader->ptr, 4);
+      reader->ptr += 4;
+   }
+
+   return val;
+}
+
+static int64_t explore_index_read_i64(explore_index_reader_t *reader)
+{
+   int64_t val = 0;
+
+   if (reader->end - reader->ptr < 8)
+      reader->error = true;
+   else
+   {
+      memcpy(&val, reader->ptr, 8);
+      reader->ptr += 8;
+   }
+
+   return val;
+}
+
+static char *explore_index_read_str(explore_index_t *index,
+      explore_index_reader_t *reader)
+{
+   uint16_t len = 0;
+   char *str    = NULL;
+
+   if (reader->end - reader->ptr < 2)
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   memcpy(&len, reader->ptr, 2);
+   reader->ptr += 2;
+
+   if (reader->end - reader->ptr < len)
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   if (len && !(str = explore_index_strndup(&index->arena,
+               (const char*)reader->ptr, len)))
+      reader->error = true;
+
+   reader->ptr += len;
+   return str;
+}
+
+static void explore_index_write(explore_index_writer_t *writer,
+      const void *data, size_t len)
+{
+   if (writer->error || !explore_index_reserve((void**)&writer->data,
+            &writer->capacity, writer->len + len, 1))
+   {
+      writer->error = true;
+      return;
+   }
+
+   if (len)
+      memcpy(writer->data + writer->len, data, len);
+   writer->len += len;
+}
+
+static void explore_index_write_u32(explore_index_writer_t *writer,
+      uint32_t val)
+{
+   explore_index_write(writer, &val, 4);
+}
+
+static void explore_index_write_i64(explore_index_writer_t *writer,
+      int64_t val)
+{
+   explore_index_write(writer, &val, 8);
+}
+
+static void explore_index_write_str(explore_index_writer_t *writer,
+      const char *str)
+{
+   size_t len   = str ? strlen(str) : 0;
+   uint16_t len16;
+
+   if (len > 0xFFFF)
+      len = 0xFFFF;
+
+   len16 = (uint16_t)len;
+   explore_index_write(writer, &len16, 2);
+   explore_index_write(writer, str, len);
+}
+
+static bool explore_index_load(explore_index_t *index,
+      const char **fields, unsigned num_fields)
+{
+   uint32_t header[3];
+   uint32_t i, j, count;
+   explore_index_reader_t reader;
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   if (!filestream_read_file(index->path, &buf, &len))
+      return false;
+
+   reader.ptr   = (const uint8_t*)buf;
+   reader.end   = reader.ptr + len;
+   reader.error = false;
+
+   if (len < (int64_t)sizeof(header))
+      goto error;
+
+   memcpy(header, reader.ptr, sizeof(header));
+   reader.ptr += sizeof(header);
+
+   if (     header[0] != EXPLORE_INDEX_MAGIC
+         || header[1] != EXPLORE_INDEX_VERSION
+         || header[2] != encoding_crc32(0, reader.ptr,
+            (size_t)(reader.end - reader.ptr)))
+      goto error;
+
+   /* A cache made for other fields is no use */
+   if (explore_index_read_u32(&reader) != num_fields)
+      goto error;
+
+   for (i = 0; i < num_fields; i++)
+   {
+      const char *field = explore_index_read_str(index, &reader);
+
+      if (reader.error || !string_is_equal(field, fields[i]))
+         goto error;
+   }
+
+   count = explore_index_read_u32(&reader);
+
+   for (i = 0; i < count && !reader.error; i++)
+   {
+      explore_index_db_t *db = NULL;
+
+      if (!explore_index_reserve((void**)&index->dbs, &index->cap_dbs,
+               index->num_dbs + 1, sizeof(*index->dbs)))
+         goto error;
+
+      db          = &index->dbs[index->num_dbs++];
+      memset(db, 0, sizeof(*db));
+      db->name    = explore_index_read_str(index, &reader);
+      db->size    = explore_index_read_i64(&reader);
+      db->mtime   = explore_index_read_i64(&reader);
+
+      if (!db->name)
+         goto error;
+   }
+
+   count = explore_index_read_u32(&reader);
+
+   for (i = 0; i < count && !reader.error; i++)
+   {
+      explore_index_record_t *record = NULL;
+      uint32_t db                    = explore_index_read_u32(&reader);
+      uint32_t crc                   = explore_index_read_u32(&reader);
+      uint8_t found;
+
+      if (reader.error || reader.ptr == reader.end || db >= index->num_dbs)
+         goto error;
+
+      found = *reader.ptr++;
+
+      if (!(record = explore_index_add_record(index, db, crc)))
+         goto error;
+
+      if (!found)
+         continue;
+
+      if (!(record->values = (const char**)explore_index_alloc(
+                  &index->arena, (num_fields + 1) * sizeof(char*))))
+         goto error;
+
+      for (j = 0; j <= num_fields; j++)
+         record->values[j] = explore_index_read_str(index, &reader);
+   }
+
+   count = explore_index_read_u32(&reader);
+
+   for (i = 0; i < count && !reader.error; i++)
+   {
+      uint32_t num_items;
+      explore_index_playlist_t *playlist = NULL;
+
+      if (!explore_index_reserve((void**)&index->playlists,
+               &index->cap_playlists, index->num_playlists + 1,
+               sizeof(*index->playlists)))
+         goto error;
+
+      playlist        = &index->playlists[index->num_playlists];
+      memset(playlist, 0, sizeof(*playlist));
+      playlist->path  = explore_index_read_str(index, &reader);
+      playlist->size  = explore_index_read_i64(&reader);
+      playlist->mtime = explore_index_read_i64(&reader);
+      num_items       = explore_index_read_u32(&reader);
+
+      if (!playlist->path)
+         goto error;
+
+      for (j = 0; j < num_items && !reader.error; j++)
+      {
+         explore_index_item_t *item = NULL;
+
+         if (!explore_index_reserve((void**)&index->items,
+                  &index->cap_items, index->num_items + 1,
+                  sizeof(*index->items)))
+            goto error;
+
+         item            = &index->items[index->num_items++];
+         item->label     = explore_index_read_str(index, &reader);
+         item->core_name = explore_index_read_str(index, &reader);
+         item->db        = explore_index_read_u32(&reader);
+         item->crc       = explore_index_read_u32(&reader);
+         item->index     = explore_index_read_u32(&reader);
+         item->playlist  = (uint32_t)index->num_playlists;
+
+         if (!item->label || item->db >= index->num_dbs)
+            goto error;
+      }
+
+      index->num_playlists++;
+   }
+
+   if (reader.error || reader.ptr != reader.end)
+      goto error;
+
+   free(buf);
+   return true;
+
+error:
+   free(buf);
+   return false;
+}
+
+/* Starts over with an empty index */
+static void explore_index_clear(explore_index_t *index)
+{
+   explore_index_arena_free(&index->arena);
+
+   free(index->playlists);
+   free(index->dbs);
+   free(index->items);
+   free(index->records);
+   free(index->table);
+   free(index->entries);
+
+   index->fields        = NULL;
+   index->playlists     = NULL;
+   index->dbs           = NULL;
+   index->items         = NULL;
+   index->records       = NULL;
+   index->table         = NULL;
+   index->entries       = NULL;
+   index->num_playlists = index->cap_playlists = 0;
+   index->num_dbs       = index->cap_dbs       = 0;
+   index->num_items     = index->cap_items     = 0;
+   index->num_records   = index->cap_records   = 0;
+   index->num_entries   = index->cap_entries   = 0;
+   index->table_size    = 0;
+}
+
+static bool explore_index_set_fields(explore_index_t *index,
+      const char **fields, unsigned num_fields)
+{
+   unsigned i;
+
+   index->num_fields = num_fields;
+
+   if (!(index->fields = (char**)explore_index_alloc(&index->arena,
+               (num_fields + 1) * sizeof(char*))))
+      return false;
+
+   for (i = 0; i < num_fields; i++)
+      if (!(index->fields[i] = explore_index_strdup(&index->arena,
+                  fields[i])))
+         return false;
+
+   return true;
+}
+
+explore_index_t *explore_index_new(const char *path,
+      const char **fields, unsigned num_fields)
+{
+   explore_index_t *index = (explore_index_t*)calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   index->current = EXPLORE_INDEX_NONE;
+
+   if (!string_is_empty(path))
+      strlcpy(index->path, path, sizeof(index->path));
+
+   if (     string_is_empty(path)
+         || !path_is_valid(path)
+         || !explore_index_load(index, fields, num_fields))
+   {
+      explore_index_clear(index);
+      index->changed = true;
+   }
+
+   if (!explore_index_set_fields(index, fields, num_fields))
+   {
+      explore_index_free(index);
+      return NULL;
+   }
+
+   return index;
+}
+
+void explore_index_free(explore_index_t *index)
+{
+   if (!index)
+      return;
+
+   explore_index_clear(index);
+   free(index);
+}
+
+bool explore_index_begin_playlist(explore_index_t *index, const char *path)
+{
+   size_t i;
+   int64_t size, mtime;
+   explore_index_playlist_t *playlist = NULL;
+
+   index->current = EXPLORE_INDEX_NONE;
+   index->stats.playlists++;
+
+   explore_index_stat(path, &size, &mtime);
+
+   for (i = 0; i < index->num_playlists; i++)
+   {
+      if (string_is_equal(index->playlists[i].path, path))
+      {
+         playlist = &index->playlists[i];
+         break;
+      }
+   }
+
+   if (playlist)
+   {
+      size_t count = 0;
+
+      if (     !playlist->used
+            && size != -1
+            && playlist->size  == size
+            && playlist->mtime == mtime)
+      {
+         playlist->used = true;
+         return true;
+      }
+
+      /* Outdated, or begun twice */
+      for (i = 0; i < index->num_items; i++)
+         if (index->items[i].playlist != (uint32_t)(playlist - index->playlists))
+            index->items[count++] = index->items[i];
+
+      index->num_items = count;
+   }
+   else
+   {
+      if (!explore_index_reserve((void**)&index->playlists,
+               &index->cap_playlists, index->num_playlists + 1,
+               sizeof(*index->playlists)))
+         return false;
+
+      playlist = &index->playlists[index->num_playlists];
+      memset(playlist, 0, sizeof(*playlist));
+
+      if (!(playlist->path = explore_index_strdup(&index->arena, path)))
+         return false;
+
+      index->num_playlists++;
+   }
+
+   playlist->size  = size;
+   playlist->mtime = mtime;
+   playlist->used  = true;
+   index->current  = (uint32_t)(playlist - index->playlists);
+   index->changed  = true;
+   index->stats.playlists_parsed++;
+
+   return false;
+}
+
+void explore_index_add_entry(explore_index_t *index,
+      const char *label, const char *core_name, const char *db_name,
+      uint32_t crc32, unsigned idx)
+{
+   explore_index_item_t *item = NULL;
+   uint32_t db;
+
+   if (     index->current == EXPLORE_INDEX_NONE
+         || string_is_empty(label)
+         || string_is_empty(db_name))
+      return;
+
+   if ((db = explore_index_get_db(index, db_name)) == EXPLORE_INDEX_NONE)
+      return;
+
+   if (!explore_index_reserve((void**)&index->items, &index->cap_items,
+            index->num_items + 1, sizeof(*index->items)))
+      return;
+
+   item            = &index->items[index->num_items];
+   item->label     = explore_index_strdup(&index->arena, label);
+   item->core_name = explore_index_strdup(&index->arena, core_name);
+   item->crc       = crc32;
+   item->db        = db;
+   item->playlist  = index->current;
+   item->index     = idx;
+
+   if (item->label)
+      index->num_items++;
+}
+
+/* Looks up the pending records of one database */
+static void explore_index_read_db(explore_index_job_t *job)
+{
+   struct rmsgpack_dom_value item;
+   explore_index_t *index   = job->index;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   bool more                = false;
+
+   if (!db || !cur)
+      goto end;
+
+   if (libretrodb_open(job->path, db) != 0)
+   {
+      libretrodb_free(db);
+      db = NULL;
+      goto end;
+   }
+
+   more = (    libretrodb_cursor_open(db, cur, NULL) == 0
+            && libretrodb_cursor_read_item(cur, &item) == 0);
+
+   for (; more; more = (rmsgpack_dom_value_free(&item),
+            libretrodb_cursor_read_item(cur, &item) == 0))
+   {
+      unsigned k, f;
+      size_t i;
+      const char **values            = NULL;
+      explore_index_record_t *record = NULL;
+
+      if (item.type != RDT_MAP)
+         continue;
+
+      /* Find the CRC first, most items are not looked for */
+      for (k = 0; k < item.val.map.len; k++)
+      {
+         struct rmsgpack_dom_value *key = &item.val.map.items[k].key;
+         struct rmsgpack_dom_value *val = &item.val.map.items[k].value;
+         uint32_t crc;
+
+         if (     key->type != RDT_STRING
+               || !string_is_equal(key->val.string.buff, "crc"))
+            continue;
+
+         if (val->type != RDT_BINARY || val->val.binary.len < 4)
+            break;
+
+         memcpy(&crc, val->val.binary.buff, 4);
+         crc = swap_if_little32(crc);
+
+         for (i = crc & (job->table_size - 1); job->table[i];
+               i = (i + 1) & (job->table_size - 1))
+         {
+            explore_index_record_t *candidate =
+               &index->records[job->table[i] - 1];
+
+            if (candidate->crc == crc)
+            {
+               record = candidate;
+               break;
+            }
+         }
+
+         break;
+      }
+
+      if (!record || !record->pending)
+         continue;
+
+      if (!(values = (const char**)explore_index_alloc(&job->arena,
+                  (index->num_fields + 1) * sizeof(char*))))
+         continue;
+
+      for (f = 0; f <= index->num_fields; f++)
+         values[f] = NULL;
+
+      for (k = 0; k < item.val.map.len; k++)
+      {
+         char num[24];
+         const char *str                = NULL;
+         struct rmsgpack_dom_value *key = &item.val.map.items[k].key;
+         struct rmsgpack_dom_value *val = &item.val.map.items[k].value;
+
+         if (key->type != RDT_STRING)
+            continue;
+
+         if (string_is_equal(key->val.string.buff, "original_title"))
+            f = index->num_fields;
+         else
+         {
+            for (f = 0; f < index->num_fields; f++)
+               if (string_is_equal(key->val.string.buff, index->fields[f]))
+                  break;
+
+            if (f == index->num_fields)
+               continue;
+         }
+
+         switch (val->type)
+         {
+            case RDT_STRING:
+               str = val->val.string.buff;
+               break;
+            case RDT_INT:
+               if (val->val.int_)
+               {
+                  snprintf(num, sizeof(num), "%d", (int)val->val.int_);
+                  str = num;
+               }
+               break;
+            case RDT_UINT:
+               if (val->val.uint_)
+               {
+                  snprintf(num, sizeof(num), "%u", (unsigned)val->val.uint_);
+                  str = num;
+               }
+               break;
+            default:
+               break;
+         }
+
+         values[f] = explore_index_strdup(&job->arena, str);
+      }
+
+      record->values  = values;
+      record->pending = false;
+   }
+
+end:
+   if (cur)
+   {
+      libretrodb_cursor_close(cur);
+      libretrodb_cursor_free(cur);
+   }
+   if (db)
+   {
+      libretrodb_close(db);
+      libretrodb_free(db);
+   }
+}
+
+static void explore_index_jobs_thread(void *data)
+{
+   explore_index_jobs_t *jobs = (explore_index_jobs_t*)data;
+
+   for (;;)
+   {
+      explore_index_job_t *job = NULL;
+
+#ifdef HAVE_THREADS
+      if (jobs->lock)
+         slock_lock(jobs->lock);
+#endif
+      if (jobs->next < jobs->count)
+         job = &jobs->jobs[jobs->next++];
+#ifdef HAVE_THREADS
+      if (jobs->lock)
+         slock_unlock(jobs->lock);
+#endif
+
+      if (!job)
+         break;
+
+      explore_index_read_db(job);
+   }
+}
+
+/* Reads the databases with pending records, @threads at a time */
+static void explore_index_read_dbs(explore_index_t *index,
+      const char *dir_database, unsigned threads)
+{
+   size_t i;
+   explore_index_jobs_t jobs;
+#ifdef HAVE_THREADS
+   sthread_t **workers = NULL;
+   unsigned num_workers = 0;
+#endif
+
+   memset(&jobs, 0, sizeof(jobs));
+
+   for (i = 0; i < index->num_records; i++)
+   {
+      size_t j;
+      explore_index_job_t *job       = NULL;
+      explore_index_record_t *record = &index->records[i];
+
+      if (!record->pending)
+         continue;
+
+      for (j = 0; j < jobs.count; j++)
+         if (jobs.jobs[j].db == record->db)
+            job = &jobs.jobs[j];
+
+      if (!job)
+      {
+         /* One job per database */
+         if (!jobs.jobs && !(jobs.jobs = (explore_index_job_t*)calloc(
+                     index->num_dbs, sizeof(*jobs.jobs))))
+            return;
+
+         job        = &jobs.jobs[jobs.count++];
+         job->index = index;
+         job->db    = record->db;
+
+         fill_pathname_join_noext(job->path, dir_database,
+               index->dbs[record->db].name, sizeof(job->path));
+         strlcat(job->path, ".rdb", sizeof(job->path));
+      }
+
+      job->table_size++;
+   }
+
+   /* Build a CRC table per job over its pending records */
+   for (i = 0; i < jobs.count; i++)
+   {
+      explore_index_job_t *job = &jobs.jobs[i];
+      size_t table_size        = 16;
+
+      while (table_size < job->table_size * 2)
+         table_size *= 2;
+
+      job->table_size = table_size;
+      job->table      = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+   }
+
+   for (i = 0; i < index->num_records; i++)
+   {
+      size_t j;
+      explore_index_record_t *record = &index->records[i];
+
+      if (!record->pending)
+         continue;
+
+      for (j = 0; j < jobs.count; j++)
+      {
+         explore_index_job_t *job = &jobs.jobs[j];
+
+         if (job->db == record->db && job->table)
+         {
+            size_t k = record->crc & (job->table_size - 1);
+
+            while (job->table[k])
+               k = (k + 1) & (job->table_size - 1);
+
+            job->table[k] = (uint32_t)(i + 1);
+            break;
+         }
+      }
+   }
+
+   for (i = 0; i < jobs.count; i++)
+   {
+      if (!jobs.jobs[i].table)
+      {
+         /* Out of memory, these go unfound */
+         jobs.jobs[i] = jobs.jobs[--jobs.count];
+         i--;
+      }
+   }
+
+   index->stats.databases_read += (unsigned)jobs.count;
+
+#ifdef HAVE_THREADS
+   if (threads > jobs.count)
+      threads = (unsigned)jobs.count;
+
+   if (threads > 1)
+   {
+      jobs.lock = slock_new();
+      workers   = (sthread_t**)calloc(threads, sizeof(*workers));
+
+      if (jobs.lock && workers)
+         for (; num_workers < threads; num_workers++)
+            if (!(workers[num_workers] = sthread_create(
+                        explore_index_jobs_thread, &jobs)))
+               break;
+   }
+#endif
+
+   /* The calling thread helps out, or does it all */
+   explore_index_jobs_thread(&jobs);
+
+#ifdef HAVE_THREADS
+   for (i = 0; i < num_workers; i++)
+      sthread_join(workers[i]);
+   free(workers);
+   if (jobs.lock)
+      slock_free(jobs.lock);
+#endif
+
+   for (i = 0; i < jobs.count; i++)
+   {
+      explore_index_arena_merge(&index->arena, &jobs.jobs[i].arena);
+      free(jobs.jobs[i].table);
+   }
+
+   /* What was not found is not in the database */
+   for (i = 0; i < index->num_records; i++)
+      index->records[i].pending = false;
+
+   if (jobs.count)
+      index->changed = true;
+
+   free(jobs.jobs);
+}
+
+void explore_index_update(explore_index_t *index,
+      const char *dir_database, unsigned threads)
+{
+   size_t i;
+   char path[PATH_MAX_LENGTH];
+
+   index->updated     = true;
+   index->num_entries = 0;
+
+   for (i = 0; i < index->num_records; i++)
+   {
+      index->records[i].used  = false;
+      index->records[i].entry = 0;
+   }
+
+   for (i = 0; i < index->num_items; i++)
+   {
+      explore_index_record_t *record = NULL;
+      explore_index_item_t *item     = &index->items[i];
+      explore_index_db_t *db         = &index->dbs[item->db];
+
+      if (!index->playlists[item->playlist].used)
+         continue;
+
+      /* Forget what a database that changed had */
+      if (!db->checked)
+      {
+         int64_t size, mtime;
+
+         fill_pathname_join_noext(path, dir_database, db->name,
+               sizeof(path));
+         strlcat(path, ".rdb", sizeof(path));
+         explore_index_stat(path, &size, &mtime);
+
+         if (size == -1 || db->size != size || db->mtime != mtime)
+         {
+            explore_index_drop_records(index, item->db);
+            db->size       = size;
+            db->mtime      = mtime;
+            index->changed = true;
+         }
+
+         db->checked = true;
+      }
+
+      if (!(record = explore_index_find_record(index, item->db, item->crc)))
+      {
+         if (!(record = explore_index_add_record(index, item->db, item->crc)))
+            continue;
+
+         record->pending = true;
+      }
+
+      record->used = true;
+   }
+
+   explore_index_read_dbs(index, dir_database, threads);
+
+   /* One entry per CRC and database, the last playlist entry wins */
+   for (i = 0; i < index->num_items; i++)
+   {
+      explore_index_entry_t *entry   = NULL;
+      explore_index_record_t *record = NULL;
+      explore_index_item_t *item     = &index->items[i];
+
+      if (!index->playlists[item->playlist].used)
+         continue;
+
+      if (     !(record = explore_index_find_record(index,
+                  item->db, item->crc))
+            || !record->values)
+         continue;
+
+      if (record->entry)
+         entry = &index->entries[record->entry - 1];
+      else
+      {
+         if (!explore_index_reserve((void**)&index->entries,
+                  &index->cap_entries, index->num_entries + 1,
+                  sizeof(*index->entries)))
+            continue;
+
+         entry         = &index->entries[index->num_entries++];
+         record->entry = (uint32_t)index->num_entries;
+      }
+
+      entry->label          = item->label;
+      entry->core_name      = item->core_name;
+      entry->fields         = record->values;
+      entry->original_title = record->values[index->num_fields];
+      entry->playlist       = item->playlist;
+      entry->index          = item->index;
+   }
+
+   index->stats.entries = (unsigned)index->num_entries;
+
+   for (i = 0; i < index->num_dbs; i++)
+      index->dbs[i].checked = false;
+}
+
+size_t explore_index_get_entries(explore_index_t *index,
+      const explore_index_entry_t **entries)
+{
+   *entries = index->entries;
+   return index->num_entries;
+}
+
+const char *explore_index_get_playlist(explore_index_t *index,
+      unsigned playlist)
+{
+   if (playlist >= index->num_playlists)
+      return NULL;
+   return index->playlists[playlist].path;
+}
+
+bool explore_index_save(explore_index_t *index)
+{
+   char tmp[PATH_MAX_LENGTH];
+   size_t i, j;
+   uint32_t header[3];
+   uint32_t count;
+   explore_index_writer_t writer;
+   bool ret = false;
+
+   if (string_is_empty(index->path))
+      return false;
+
+   /* Playlists that are gone are left out */
+   for (i = 0; i < index->num_playlists; i++)
+      if (!index->playlists[i].used)
+         index->changed = true;
+
+   if (!index->changed)
+      return true;
+
+   memset(&writer, 0, sizeof(writer));
+   memset(header, 0, sizeof(header));
+   explore_index_write(&writer, header, sizeof(header));
+
+   explore_index_write_u32(&writer, index->num_fields);
+   for (i = 0; i < index->num_fields; i++)
+      explore_index_write_str(&writer, index->fields[i]);
+
+   explore_index_write_u32(&writer, (uint32_t)index->num_dbs);
+   for (i = 0; i < index->num_dbs; i++)
+   {
+      explore_index_write_str(&writer, index->dbs[i].name);
+      explore_index_write_i64(&writer, index->dbs[i].size);
+      explore_index_write_i64(&writer, index->dbs[i].mtime);
+   }
+
+   /* Only what the current playlists need */
+   for (i = 0, count = 0; i < index->num_records; i++)
+      if (index->records[i].used || !index->updated)
+         count++;
+
+   explore_index_write_u32(&writer, count);
+   for (i = 0; i < index->num_records; i++)
+   {
+      uint8_t found;
+      const explore_index_record_t *record = &index->records[i];
+
+      if (!record->used && index->updated)
+         continue;
+
+      found = record->values ? 1 : 0;
+      explore_index_write_u32(&writer, record->db);
+      explore_index_write_u32(&writer, record->crc);
+      explore_index_write(&writer, &found, 1);
+
+      if (found)
+         for (j = 0; j <= index->num_fields; j++)
+            explore_index_write_str(&writer, record->values[j]);
+   }
+
+   for (i = 0, count = 0; i < index->num_playlists; i++)
+      if (index->playlists[i].used)
+         count++;
+
+   explore_index_write_u32(&writer, count);
+   for (i = 0; i < index->num_playlists; i++)
+   {
+      const explore_index_playlist_t *playlist = &index->playlists[i];
+
+      if (!playlist->used)
+         continue;
+
+      for (j = 0, count = 0; j < index->num_items; j++)
+         if (index->items[j].playlist == i)
+            count++;
+
+      explore_index_write_str(&writer, playlist->path);
+      explore_index_write_i64(&writer, playlist->size);
+      explore_index_write_i64(&writer, playlist->mtime);
+      explore_index_write_u32(&writer, count);
+
+      for (j = 0; j < index->num_items; j++)
+      {
+         const explore_index_item_t *item = &index->items[j];
+
+         if (item->playlist != i)
+            continue;
+
+         explore_index_write_str(&writer, item->label);
+         explore_index_write_str(&writer, item->core_name);
+         explore_index_write_u32(&writer, item->db);
+         explore_index_write_u32(&writer, item->crc);
+         explore_index_write_u32(&writer, item->index);
+      }
+   }
+
+   if (writer.error)
+      goto end;
+
+   header[0] = EXPLORE_INDEX_MAGIC;
+   header[1] = EXPLORE_INDEX_VERSION;
+   header[2] = encoding_crc32(0, writer.data + sizeof(header),
+         writer.len - sizeof(header));
+   memcpy(writer.data, header, sizeof(header));
+
+   /* Written next to the cache and renamed, so it is never left
+    * half written */
+   strlcpy(tmp, index->path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   if (filestream_write_file(tmp, writer.data, (int64_t)writer.len))
+   {
+      filestream_delete(index->path);
+
+      if (!filestream_rename(tmp, index->path))
+      {
+         index->changed = false;
+         ret            = true;
+      }
+      else
+         filestream_delete(tmp);
+   }
+
+end:
+   free(writer.data);
+   return ret;
+}
+
+void explore_index_get_stats(explore_index_t *index,
+      explore_index_stats_t *stats)
+{
+   *stats = index->stats;
+}
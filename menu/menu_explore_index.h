@@ -0,0 +1,125 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2020 - Daniel De Matteis
+ *  Copyright (C) 2020      - Psyraven
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_EXPLORE_INDEX_H
+#define _MENU_EXPLORE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Everything the Explore menu needs from the playlists and databases,
+ * kept in a cache file between runs. A playlist is only parsed again
+ * when its size or modification time changed, and a database is only
+ * read for CRCs it was not asked about before, or when it changed.
+ * Databases that have to be read are read in parallel. */
+
+#define EXPLORE_INDEX_DEFAULT_THREADS 4
+
+typedef struct explore_index explore_index_t;
+
+typedef struct explore_index_entry
+{
+   const char *label;
+   const char *core_name;
+   /* Values of the database fields passed to explore_index_new(),
+    * NULL where the database has none */
+   const char **fields;
+   const char *original_title;
+   /* Playlist the entry is from, see explore_index_get_playlist(),
+    * and its index in there */
+   unsigned playlist;
+   unsigned index;
+} explore_index_entry_t;
+
+typedef struct explore_index_stats
+{
+   unsigned playlists;
+   /* Playlists not found current in the cache */
+   unsigned playlists_parsed;
+   /* Databases that had to be read */
+   unsigned databases_read;
+   unsigned entries;
+} explore_index_stats_t;
+
+/**
+ * explore_index_new:
+ * @path               : Cache file.
+ * @fields             : Database fields to look up.
+ * @num_fields         : Number of @fields.
+ *
+ * Loads the cache. A missing or invalid cache, or one made for other
+ * fields, is started over.
+ *
+ * Returns: the index, NULL on allocation failure.
+ **/
+explore_index_t *explore_index_new(const char *path,
+      const char **fields, unsigned num_fields);
+
+void explore_index_free(explore_index_t *index);
+
+/**
+ * explore_index_begin_playlist:
+ * @index              : The index.
+ * @path               : Playlist file.
+ *
+ * Returns: true if the cached entries of @path are current. Otherwise
+ * they are dropped, and the caller adds the entries of the playlist
+ * with explore_index_add_entry().
+ **/
+bool explore_index_begin_playlist(explore_index_t *index, const char *path);
+
+/* Adds entry @idx of the playlist last passed to
+ * explore_index_begin_playlist(). */
+void explore_index_add_entry(explore_index_t *index,
+      const char *label, const char *core_name, const char *db_name,
+      uint32_t crc32, unsigned idx);
+
+/**
+ * explore_index_update:
+ * @index              : The index.
+ * @dir_database       : Directory of the databases.
+ * @threads            : Databases read at the same time.
+ *
+ * Looks up the entries of all playlists begun since explore_index_new()
+ * that are not cached yet, and collects the entries found.
+ **/
+void explore_index_update(explore_index_t *index,
+      const char *dir_database, unsigned threads);
+
+/* Entries found by explore_index_update(), one per CRC and database.
+ * Owned by @index. */
+size_t explore_index_get_entries(explore_index_t *index,
+      const explore_index_entry_t **entries);
+
+/* Path of playlist @playlist of an entry */
+const char *explore_index_get_playlist(explore_index_t *index,
+      unsigned playlist);
+
+/* Writes the cache if anything changed. Playlists that were not
+ * begun since explore_index_new() are left out. */
+bool explore_index_save(explore_index_t *index);
+
+void explore_index_get_stats(explore_index_t *index,
+      explore_index_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
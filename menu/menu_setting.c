@@ -314,6 +314,21 @@ struct string_options_entry
    size_t len;
 };
 
+/* Lookup tables over the settings list, built along with it
+ * so finding a setting does not walk the whole list */
+typedef struct menu_setting_index
+{
+   const rarch_setting_t *list;
+   /* Setting per enum + 1, 0 if there is none */
+   uint32_t *by_enum;
+   /* Open addressing over the names, setting + 1, 0 when empty */
+   uint32_t *by_name;
+   size_t by_name_size;
+} menu_setting_index_t;
+
+/* TODO/FIXME - static global */
+static menu_setting_index_t menu_setting_index;
+
 /* SETTINGS LIST */
 
 static void menu_input_st_uint_cb(void *userdata, const char *str)
@@ -6302,6 +6317,85 @@ int menu_action_handle_setting(rarch_setting_t *setting,
    return -1;
 }
 
+static void menu_setting_index_free(void)
+{
+   free(menu_setting_index.by_enum);
+   free(menu_setting_index.by_name);
+   memset(&menu_setting_index, 0, sizeof(menu_setting_index));
+}
+
+/* Indexes the settings of @list by enum and name.
+ * The first one wins, as with a linear search. */
+static void menu_setting_index_init(const rarch_setting_t *list)
+{
+   size_t i, count;
+   size_t size  = 16;
+
+   menu_setting_index_free();
+
+   for (count = 0; list[count].type != ST_NONE; count++);
+
+   while (size < count * 2)
+      size *= 2;
+
+   menu_setting_index.by_enum      = (uint32_t*)
+      calloc(MSG_LAST, sizeof(uint32_t));
+   menu_setting_index.by_name      = (uint32_t*)
+      calloc(size, sizeof(uint32_t));
+   menu_setting_index.by_name_size = size;
+
+   if (!menu_setting_index.by_enum || !menu_setting_index.by_name)
+   {
+      menu_setting_index_free();
+      return;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      const rarch_setting_t *setting = &list[i];
+
+      if (setting->type > ST_GROUP)
+         continue;
+
+      if (     setting->enum_idx > 0
+            && setting->enum_idx < MSG_LAST
+            && !menu_setting_index.by_enum[setting->enum_idx])
+         menu_setting_index.by_enum[setting->enum_idx] = (uint32_t)(i + 1);
+
+      if (setting->name)
+      {
+         size_t j = msg_hash_calculate(setting->name) & (size - 1);
+
+         for (; menu_setting_index.by_name[j]; j = (j + 1) & (size - 1))
+            if (string_is_equal(setting->name,
+                     list[menu_setting_index.by_name[j] - 1].name))
+               break;
+
+         if (!menu_setting_index.by_name[j])
+            menu_setting_index.by_name[j] = (uint32_t)(i + 1);
+      }
+   }
+
+   menu_setting_index.list = list;
+}
+
+static rarch_setting_t *menu_setting_index_find(rarch_setting_t *list,
+      const char *label)
+{
+   size_t size = menu_setting_index.by_name_size;
+   size_t i    = msg_hash_calculate(label) & (size - 1);
+
+   for (; menu_setting_index.by_name[i]; i = (i + 1) & (size - 1))
+   {
+      rarch_setting_t *setting = &list[menu_setting_index.by_name[i] - 1];
+
+      if (string_is_equal(label, setting->name))
+         return setting;
+   }
+
+   return NULL;
+}
+
 /**
  * menu_setting_find:
  * @settings           : pointer to settings
@@ -6324,6 +6418,18 @@ rarch_setting_t *menu_setting_find(const char *label)
    if (!setting)
       return NULL;
 
+   if (setting == menu_setting_index.list)
+   {
+      if (     !(setting = menu_setting_index_find(setting, label))
+            || string_is_empty(setting->short_description))
+         return NULL;
+
+      if (setting->read_handler)
+         setting->read_handler(setting);
+
+      return setting;
+   }
+
    for (; setting->type != ST_NONE; (*list = *list + 1))
    {
       const char *name              = setting->name;
@@ -6358,6 +6464,23 @@ rarch_setting_t *menu_setting_find_enum(enum msg_hash_enums enum_idx)
 
    if (!setting)
       return NULL;
+
+   if (setting == menu_setting_index.list)
+   {
+      uint32_t idx = (enum_idx < MSG_LAST)
+         ? menu_setting_index.by_enum[enum_idx] : 0;
+
+      if (!idx || string_is_empty(setting[idx - 1].short_description))
+         return NULL;
+
+      setting += idx - 1;
+
+      if (setting->read_handler)
+         setting->read_handler(setting);
+
+      return setting;
+   }
+
    for (; setting->type != ST_NONE; (*list = *list + 1))
    {
       if (  setting->enum_idx == enum_idx &&
@@ -18070,6 +18193,9 @@ void menu_setting_free(rarch_setting_t *setting)
    if (!setting)
       return;
 
+   if (setting == menu_setting_index.list)
+      menu_setting_index_free();
+
    list                   = (rarch_setting_t**)&setting;
 
    /* Free data which was previously tagged */
@@ -18279,6 +18405,9 @@ static rarch_setting_t *menu_setting_new(void)
 
    list             = menu_setting_new_internal(list_info);
 
+   if (list)
+      menu_setting_index_init(list);
+
    if (list_info)
       free(list_info);
 
@@ -0,0 +1,215 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2020 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include <compat/strcasestr.h>
+#include <retro_miscellaneous.h>
+
+#include "menu_virtual_list.h"
+
+/* Offset of a window centered on list index @idx */
+static size_t menu_virtual_list_center(size_t size, size_t idx)
+{
+   size_t offset = 0;
+
+   if (idx > MENU_VIRTUAL_LIST_WINDOW / 2)
+      offset = idx - MENU_VIRTUAL_LIST_WINDOW / 2;
+   if (offset + MENU_VIRTUAL_LIST_WINDOW > size)
+      offset = size - MENU_VIRTUAL_LIST_WINDOW;
+
+   return offset;
+}
+
+bool menu_virtual_list_init(menu_virtual_list_t *vl, uint32_t ident,
+      size_t size, size_t *selection)
+{
+   bool same     = ident && vl->ident == ident;
+   /* The selection was saved as a window index
+    * of the list as it was built last time */
+   size_t offset = (same && vl->active) ? vl->offset : 0;
+   size_t idx    = offset + *selection;
+
+   vl->ident     = ident;
+   vl->size      = size;
+   vl->offset    = 0;
+   vl->count     = size;
+   vl->active    = size > MENU_VIRTUAL_LIST_THRESHOLD;
+
+   if (idx >= size)
+      idx        = size ? size - 1 : 0;
+
+   if (!vl->active)
+   {
+      *selection = idx;
+      return false;
+   }
+
+   /* Keep the window where it was, unless
+    * entries were removed from under it */
+   if (same && offset + MENU_VIRTUAL_LIST_WINDOW > size)
+      offset     = size - MENU_VIRTUAL_LIST_WINDOW;
+
+   if (     !same
+         || idx <  offset
+         || idx >= offset + MENU_VIRTUAL_LIST_WINDOW)
+      offset     = menu_virtual_list_center(size, idx);
+
+   vl->offset    = offset;
+   vl->count     = MENU_VIRTUAL_LIST_WINDOW;
+   *selection    = idx - offset;
+
+   return true;
+}
+
+bool menu_virtual_list_place(const menu_virtual_list_t *vl,
+      size_t idx, size_t *offset)
+{
+   size_t start = vl->offset;
+   size_t end   = vl->offset + vl->count;
+
+   if (!vl->active)
+      return false;
+
+   if (idx >= vl->size)
+      idx = vl->size - 1;
+
+   if (     idx >= start
+         && idx <  end
+         && (start == 0        || idx >= start + MENU_VIRTUAL_LIST_MARGIN)
+         && (end   == vl->size || idx + MENU_VIRTUAL_LIST_MARGIN < end))
+      return false;
+
+   *offset = menu_virtual_list_center(vl->size, idx);
+
+   return *offset != vl->offset;
+}
+
+void menu_virtual_list_fill(menu_virtual_list_t *vl,
+      file_list_t *list, size_t offset)
+{
+   if (vl->active)
+   {
+      vl->offset = offset;
+      vl->count  = MENU_VIRTUAL_LIST_WINDOW;
+   }
+
+   vl->fill(list, vl->offset, vl->count, vl->userdata);
+}
+
+void menu_virtual_list_forget(menu_virtual_list_t *vl)
+{
+   vl->ident = 0;
+}
+
+bool menu_virtual_list_search(const menu_virtual_list_t *vl,
+      const char *needle, size_t *idx)
+{
+   size_t i;
+   bool ret = false;
+
+   if (!vl->get_name)
+      return false;
+
+   for (i = 0; i < vl->size; i++)
+   {
+      char name[PATH_MAX_LENGTH];
+      const char *str = NULL;
+
+      name[0]         = '\0';
+
+      if (!vl->get_name(i, name, sizeof(name), vl->userdata))
+         continue;
+
+      str = (const char*)strcasestr(name, needle);
+
+      if (str == name)
+      {
+         /* Found match with first chars, best possible match. */
+         *idx = i;
+         return true;
+      }
+      else if (str && !ret)
+      {
+         /* Found mid-string match, but try to find a match with
+          * first characters before we settle. */
+         *idx = i;
+         ret  = true;
+      }
+   }
+
+   return ret;
+}
+
+/* First character of @name, with all non-alphabetical ones lumped
+ * together, as menu_entries_elem_get_first_char() does */
+static int menu_virtual_list_first_char(const char *name)
+{
+   int ret = tolower((int)*name);
+
+   if (ret < 'a')
+      return ('a' - 1);
+   else if (ret > 'z')
+      return ('z' + 1);
+   return ret;
+}
+
+static size_t menu_virtual_list_add_scroll_index(size_t *indices,
+      size_t count, size_t max, size_t idx)
+{
+   if (count < max)
+      indices[count++] = idx;
+
+   return count;
+}
+
+size_t menu_virtual_list_get_scroll_indices(const menu_virtual_list_t *vl,
+      size_t *indices, size_t max)
+{
+   size_t i;
+   int current;
+   char name[PATH_MAX_LENGTH];
+   size_t count = 0;
+
+   if (!vl->size || !max)
+      return 0;
+
+   name[0]      = '\0';
+   if (vl->get_name)
+      vl->get_name(0, name, sizeof(name), vl->userdata);
+
+   count        = menu_virtual_list_add_scroll_index(indices, count, max, 0);
+   current      = menu_virtual_list_first_char(name);
+
+   for (i = 1; i < vl->size; i++)
+   {
+      int first;
+
+      name[0]   = '\0';
+      if (vl->get_name)
+         vl->get_name(i, name, sizeof(name), vl->userdata);
+
+      first     = menu_virtual_list_first_char(name);
+
+      if (first > current)
+         count  = menu_virtual_list_add_scroll_index(indices, count, max, i);
+
+      current   = first;
+   }
+
+   return menu_virtual_list_add_scroll_index(indices, count, max,
+         vl->size - 1);
+}
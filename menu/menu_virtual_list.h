@@ -0,0 +1,159 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2020 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_VIRTUAL_LIST_H
+#define _MENU_VIRTUAL_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <retro_common_api.h>
+#include <retro_inline.h>
+#include <boolean.h>
+
+#include <lists/file_list.h>
+
+RETRO_BEGIN_DECLS
+
+/* A menu list that is too long to build in full. Only a window of
+ * its entries is added to the file list shown by the menu; the
+ * window moves along with the selection and is filled again from
+ * the source of the list (e.g. a playlist) whenever the selection
+ * gets close to one of its ends. Building and showing the list thus
+ * costs the same whatever its size.
+ *
+ * Indices into the file list are 'window' indices, indices into the
+ * source are 'list' indices; menu_virtual_list_index() converts the
+ * former into the latter. */
+
+/* Lists with up to this many entries are built in full */
+#define MENU_VIRTUAL_LIST_THRESHOLD 1024
+/* Entries in the window */
+#define MENU_VIRTUAL_LIST_WINDOW    256
+/* The window is moved once the selection gets this close to one of
+ * its ends, unless that end is also an end of the list */
+#define MENU_VIRTUAL_LIST_MARGIN    64
+
+/* Adds list entries [start, start + count) to @list, in order */
+typedef void (*menu_virtual_list_fill_t)(file_list_t *list,
+      size_t start, size_t count, void *userdata);
+
+/* Writes the name of list entry @idx as shown in the menu, for
+ * searching entries that are not in the window */
+typedef bool (*menu_virtual_list_get_name_t)(size_t idx,
+      char *s, size_t len, void *userdata);
+
+typedef struct menu_virtual_list
+{
+   menu_virtual_list_fill_t fill;
+   menu_virtual_list_get_name_t get_name;
+   void *userdata;
+   /* Identifies the source, see menu_virtual_list_init() */
+   uint32_t ident;
+   /* Entries in the list */
+   size_t size;
+   /* List index of the first entry in the window */
+   size_t offset;
+   /* Entries in the window */
+   size_t count;
+   /* Menu stack size the list was built at */
+   size_t depth;
+   /* false if the list was built in full */
+   bool active;
+} menu_virtual_list_t;
+
+/**
+ * menu_virtual_list_init:
+ * @vl                 : Virtual list state, with the callbacks of
+ *                       the list to build set.
+ * @ident              : Identifies the source of the list.
+ * @size               : Entries in the list.
+ * @selection          : Window index of the selection, updated
+ *                       to match the new window.
+ *
+ * Places the window for a list about to be built. When the same
+ * list (same @ident) is built again, as happens when it is
+ * refreshed or returned to, the window stays where it was, so
+ * the window indices saved in the menu stack still point to the
+ * same entries; otherwise it starts at the top of the list.
+ *
+ * Returns: true if the list is built as a window, false if it is
+ * built in full.
+ **/
+bool menu_virtual_list_init(menu_virtual_list_t *vl, uint32_t ident,
+      size_t size, size_t *selection);
+
+/**
+ * menu_virtual_list_place:
+ * @vl                 : Virtual list state.
+ * @idx                : List index of the selection.
+ * @offset             : Set to the offset the window should have.
+ *
+ * Returns: true if the window has to move for @idx to be
+ * selected, i.e. @idx is outside it or within the margin of one
+ * of its ends.
+ **/
+bool menu_virtual_list_place(const menu_virtual_list_t *vl,
+      size_t idx, size_t *offset);
+
+/* Moves the window to @offset and fills @list, which must be empty */
+void menu_virtual_list_fill(menu_virtual_list_t *vl,
+      file_list_t *list, size_t offset);
+
+/* Makes the next menu_virtual_list_init() start at the top of
+ * the list, even if it builds the same list again */
+void menu_virtual_list_forget(menu_virtual_list_t *vl);
+
+/**
+ * menu_virtual_list_search:
+ * @vl                 : Virtual list state.
+ * @needle             : String to look for.
+ * @idx                : Set to the list index of the match.
+ *
+ * Searches the names of all entries of the list, matching the way
+ * file_list_search() does: an entry starting with @needle wins
+ * over one that only contains it.
+ *
+ * Returns: true if an entry matched.
+ **/
+bool menu_virtual_list_search(const menu_virtual_list_t *vl,
+      const char *needle, size_t *idx);
+
+/**
+ * menu_virtual_list_get_scroll_indices:
+ * @vl                 : Virtual list state.
+ * @indices            : Filled in with list indices.
+ * @max                : Size of @indices.
+ *
+ * Builds the indices alphabet navigation jumps to over the names of
+ * all entries of the list, the way they are built over the entries
+ * of a file list: the first entry, each entry whose name starts with
+ * a letter later than that of the entry before it, and the last
+ * entry. Indices found once @indices is full are dropped.
+ *
+ * Returns: number of indices written to @indices.
+ **/
+size_t menu_virtual_list_get_scroll_indices(const menu_virtual_list_t *vl,
+      size_t *indices, size_t max);
+
+static INLINE size_t menu_virtual_list_index(
+      const menu_virtual_list_t *vl, size_t i)
+{
+   return vl->active ? vl->offset + i : i;
+}
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,57 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "netplay_broadcast.h"
+
+/**
+ * netplay_broadcast_clear
+ *
+ * Empty the broadcast for a new frame.
+ */
+void netplay_broadcast_clear(netplay_broadcast_t *bc)
+{
+   bc->words     = 0;
+   bc->cmd_count = 0;
+}
+
+/**
+ * netplay_broadcast_add
+ *
+ * Append a command, in network byte order, carrying the given client's input
+ * (or NETPLAY_BROADCAST_EVERYONE).
+ *
+ * Returns false if it doesn't fit.
+ */
+bool netplay_broadcast_add(netplay_broadcast_t *bc, uint32_t client_num,
+      const uint32_t *cmd, size_t words)
+{
+   struct netplay_broadcast_cmd *bcmd;
+
+   if (bc->cmd_count >= NETPLAY_BROADCAST_CMDS ||
+         words > NETPLAY_BROADCAST_CMD_WORDS)
+      return false;
+
+   bcmd             = &bc->cmds[bc->cmd_count++];
+   bcmd->client_num = client_num;
+   bcmd->start      = (uint32_t)bc->words;
+   bcmd->words      = (uint32_t)words;
+
+   memcpy(bc->data + bc->words, cmd, words * sizeof(uint32_t));
+   bc->words       += words;
+
+   return true;
+}
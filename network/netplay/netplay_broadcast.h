@@ -0,0 +1,78 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_BROADCAST_H
+#define __RARCH_NETPLAY_BROADCAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* One input command per client, plus the server's NOINPUT */
+#define NETPLAY_BROADCAST_CMDS      33
+
+/* Largest command we carry, in words, including the command header.
+ * Matches the limit in send_input_frame. */
+#define NETPLAY_BROADCAST_CMD_WORDS 16
+
+/* Owner of a command that goes to every connection */
+#define NETPLAY_BROADCAST_EVERYONE  0xFFFFFFFF
+
+struct netplay_broadcast_cmd
+{
+   /* The client whose input this is, which doesn't need it back */
+   uint32_t client_num;
+
+   /* Where the command is in the data, in words */
+   uint32_t start, words;
+};
+
+/* The input commands of one frame, encoded once and then copied to every
+ * connection, rather than encoded again for each of them. */
+typedef struct netplay_broadcast
+{
+   /* The commands back to back, in network byte order */
+   uint32_t data[NETPLAY_BROADCAST_CMDS * NETPLAY_BROADCAST_CMD_WORDS];
+   size_t words;
+
+   struct netplay_broadcast_cmd cmds[NETPLAY_BROADCAST_CMDS];
+   size_t cmd_count;
+} netplay_broadcast_t;
+
+/**
+ * netplay_broadcast_clear
+ *
+ * Empty the broadcast for a new frame.
+ */
+void netplay_broadcast_clear(netplay_broadcast_t *bc);
+
+/**
+ * netplay_broadcast_add
+ *
+ * Append a command, in network byte order, carrying the given client's input
+ * (or NETPLAY_BROADCAST_EVERYONE).
+ *
+ * Returns false if it doesn't fit.
+ */
+bool netplay_broadcast_add(netplay_broadcast_t *bc, uint32_t client_num,
+      const uint32_t *cmd, size_t words);
+
+RETRO_END_DECLS
+
+#endif
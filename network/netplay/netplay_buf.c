@@ -64,6 +64,7 @@ bool netplay_init_socket_buffer(
       return false;
    sbuf->bufsz = size;
    sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->total = 0;
    return true;
 }
 
@@ -152,6 +153,7 @@ bool netplay_send(
        * need to do a blocking send */
       if (!socket_send_all_blocking(sockfd, buf, len, false))
          return false;
+      sbuf->total += (uint32_t)len;
       return true;
    }
 
@@ -173,6 +175,7 @@ bool netplay_send(
       sbuf->end += len;
    }
 
+   sbuf->total += (uint32_t)len;
    return true;
 }
 
@@ -255,6 +258,16 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    return true;
 }
 
+/**
+ * netplay_send_pending
+ *
+ * Returns how much queued data hasn't been sent yet.
+ */
+size_t netplay_send_pending(struct socket_buffer *sbuf)
+{
+   return buf_used(sbuf);
+}
+
 /**
  * netplay_recv
  *
@@ -342,7 +355,7 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
    /* Perhaps block for more data */
    if (block)
    {
-      sbuf->start = sbuf->read;
+      netplay_recv_flush(sbuf);
       if (recvd < 0 || recvd < (ssize_t) len)
       {
          if (!socket_receive_all_blocking(
@@ -366,6 +379,35 @@ void netplay_recv_reset(struct socket_buffer *sbuf)
    sbuf->read = sbuf->start;
 }
 
+/**
+ * netplay_recv_unflushed
+ *
+ * Get at the data read since the last flush. It may wrap around the end of
+ * the buffer, in which case it continues at *b.
+ *
+ * Returns the total length.
+ */
+size_t netplay_recv_unflushed(struct socket_buffer *sbuf,
+   const unsigned char **a, size_t *a_len,
+   const unsigned char **b, size_t *b_len)
+{
+   *a = sbuf->data + sbuf->start;
+   *b = sbuf->data;
+
+   if (sbuf->read >= sbuf->start)
+   {
+      *a_len = sbuf->read - sbuf->start;
+      *b_len = 0;
+   }
+   else
+   {
+      *a_len = sbuf->bufsz - sbuf->start;
+      *b_len = sbuf->read;
+   }
+
+   return *a_len + *b_len;
+}
+
 /**
  * netplay_recv_flush
  *
@@ -374,5 +416,8 @@ void netplay_recv_reset(struct socket_buffer *sbuf)
  */
 void netplay_recv_flush(struct socket_buffer *sbuf)
 {
+   sbuf->total += (uint32_t)((sbuf->read >= sbuf->start)
+         ? sbuf->read - sbuf->start
+         : sbuf->bufsz - sbuf->start + sbuf->read);
    sbuf->start = sbuf->read;
 }
@@ -224,6 +224,14 @@ static uint32_t simple_rand_uint32(void)
             parts[2]);
 }
 
+/* Are we the host on this connection: the server, or relaying the stream
+ * to a spectator of ours? */
+static bool netplay_handshake_hosting(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   return netplay->is_server || connection->relayed;
+}
+
 /**
  * netplay_handshake_init_send
  *
@@ -238,12 +246,15 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(NETPLAY_MAGIC);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED | NETPLAY_HEADER_DELTA |
+         ((netplay->udp && !connection->relayed &&
+           (!netplay->is_server || netplay->udp_fd >= 0))
+          ? NETPLAY_HEADER_UDP : 0));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
 
-   if (netplay->is_server &&
+   if (netplay_handshake_hosting(netplay, connection) &&
        (settings->paths.netplay_password[0] ||
         settings->paths.netplay_spectate_password[0]))
    {
@@ -368,6 +379,16 @@ bool netplay_handshake_init(netplay_t *netplay,
       goto error;
    }
 
+   /* Both sides have to want UDP input. The server offers it once the
+    * client is connected. */
+   connection->udp_enabled = netplay->is_server && netplay->udp_fd >= 0 &&
+      (ntohl(header[2]) & NETPLAY_HEADER_UDP);
+
+   /* A newly connected peer shares no state with us, so the first savestate
+    * always goes in full */
+   connection->savestate_delta = (ntohl(header[2]) & NETPLAY_HEADER_DELTA) != 0;
+   connection->savestate_full  = true;
+
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
@@ -395,6 +416,17 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   /* We pass the server's savestates on exactly as they come, so spectators
+    * of ours must take them the way we do */
+   if (connection->relayed &&
+         (!connection->savestate_delta ||
+          connection->compression_supported !=
+          netplay->connections[0].compression_supported))
+   {
+      RARCH_ERR("[netplay] Spectator can't take the stream we relay.\n");
+      return false;
+   }
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -411,7 +443,8 @@ bool netplay_handshake_init(netplay_t *netplay,
    }
 
    /* If a password is demanded, ask for it */
-   if (!netplay->is_server && (connection->salt = ntohl(header[3])))
+   if (!netplay_handshake_hosting(netplay, connection) &&
+         (connection->salt = ntohl(header[3])))
    {
 #ifdef HAVE_MENU
       menu_input_ctx_line_t line;
@@ -461,7 +494,16 @@ static void netplay_handshake_ready(netplay_t *netplay,
    char msg[512];
    msg[0] = '\0';
 
-   if (netplay->is_server)
+   if (connection->relayed)
+   {
+      unsigned slot = (unsigned)(connection - netplay->relay_connections);
+
+      netplay_log_connection(&connection->addr,
+            slot, connection->nick, msg, sizeof(msg));
+
+      RARCH_LOG("[netplay] Relaying to spectator in slot %u\n", slot);
+   }
+   else if (netplay->is_server)
    {
       unsigned slot = (unsigned)(connection - netplay->connections);
 
@@ -543,18 +585,23 @@ static bool netplay_handshake_info(netplay_t *netplay,
 /**
  * netplay_handshake_sync
  *
- * Send a SYNC command.
+ * Send a SYNC command, starting the peer at the given frame as the given
+ * client.
  */
 static bool netplay_handshake_sync(netplay_t *netplay,
-      struct netplay_connection *connection)
+      struct netplay_connection *connection, uint32_t frame,
+      uint32_t client_num)
 {
    /* If we're the server, now we send sync info */
    size_t i;
    int matchct;
    uint32_t cmd[4];
    retro_ctx_memory_info_t mem_info;
-   uint32_t client_num        = 0;
    uint32_t device            = 0;
+   struct netplay_connection *connections = connection->relayed ?
+      netplay->relay_connections : netplay->connections;
+   size_t connections_size                = connection->relayed ?
+      netplay->relay_connections_size : netplay->connections_size;
    size_t nicklen, nickmangle = 0;
    bool nick_matched          = false;
 
@@ -584,8 +631,7 @@ static bool netplay_handshake_sync(netplay_t *netplay,
 
          /* And finally, sram */
          + mem_info.size);
-   cmd[2]     = htonl(netplay->self_frame_count);
-   client_num = (uint32_t)(connection - netplay->connections + 1);
+   cmd[2]     = htonl(frame);
 
    if (netplay->local_paused || netplay->remote_paused)
       client_num |= NETPLAY_CMD_SYNC_BIT_PAUSED;
@@ -629,9 +675,9 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    do
    {
       nick_matched = false;
-      for (i = 0; i < netplay->connections_size; i++)
+      for (i = 0; i < connections_size; i++)
       {
-         struct netplay_connection *sc = &netplay->connections[i];
+         struct netplay_connection *sc = &connections[i];
          if (sc == connection)
             continue;
          if (sc->active &&
@@ -681,6 +727,9 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
 
+   if (!netplay_udp_offer(netplay, connection))
+      return false;
+
    return true;
 }
 
@@ -706,7 +755,7 @@ static bool netplay_handshake_pre_nick(netplay_t *netplay,
        ntohl(nick_buf.cmd[0]) != NETPLAY_CMD_NICK ||
        ntohl(nick_buf.cmd[1]) != sizeof(nick_buf.nick))
    {
-      if (netplay->is_server)
+      if (netplay_handshake_hosting(netplay, connection))
          strlcpy(msg, msg_hash_to_str(MSG_FAILED_TO_GET_NICKNAME_FROM_CLIENT),
             sizeof(msg));
       else
@@ -722,7 +771,7 @@ static bool netplay_handshake_pre_nick(netplay_t *netplay,
       (sizeof(connection->nick) < sizeof(nick_buf.nick)) ?
       sizeof(connection->nick) : sizeof(nick_buf.nick));
 
-   if (netplay->is_server)
+   if (netplay_handshake_hosting(netplay, connection))
    {
       settings_t *settings = config_get_ptr();
 
@@ -773,7 +822,7 @@ static bool netplay_handshake_pre_password(netplay_t *netplay,
        ntohl(password_buf.cmd[0]) != NETPLAY_CMD_PASSWORD ||
        ntohl(password_buf.cmd[1]) != sizeof(password_buf.password))
    {
-      if (netplay->is_server)
+      if (netplay_handshake_hosting(netplay, connection))
          strlcpy(msg, msg_hash_to_str(MSG_FAILED_TO_GET_NICKNAME_FROM_CLIENT),
             sizeof(msg));
       else
@@ -916,9 +965,14 @@ static bool netplay_handshake_pre_info(netplay_t *netplay,
    /* Now switch to the right mode */
    if (netplay->is_server)
    {
-      if (!netplay_handshake_sync(netplay, connection))
+      if (!netplay_handshake_sync(netplay, connection,
+               netplay->self_frame_count,
+               (uint32_t)(connection - netplay->connections + 1)))
          return false;
    }
+   /* A spectator of ours waits until we have a state to start it on */
+   else if (connection->relayed)
+      connection->mode = NETPLAY_CONNECTION_PRE_SYNC;
    else
    {
       if (!netplay_handshake_info(netplay, connection))
@@ -1132,13 +1186,38 @@ static bool netplay_handshake_pre_sync(netplay_t *netplay,
    /* Ask to switch to playing mode if we should */
    {
       settings_t *settings = config_get_ptr();
-      if (!settings->bools.netplay_start_as_spectator)
+      /* Relays only spectate */
+      if (!settings->bools.netplay_start_as_spectator &&
+            netplay->relay_fd < 0)
          return netplay_cmd_mode(netplay, NETPLAY_CONNECTION_PLAYING);
    }
 
    return true;
 }
 
+/**
+ * netplay_handshake_relay_sync
+ *
+ * Final stage of the handshake of a spectator of ours, once we're relaying:
+ * start it on the newest state we can, and catch it up from there.
+ */
+static bool netplay_handshake_relay_sync(netplay_t *netplay,
+   struct netplay_connection *connection, bool *had_input)
+{
+   ssize_t ptr = netplay_relay_join_ptr(netplay);
+
+   /* Keep waiting */
+   if (ptr < 0)
+      return true;
+
+   if (!netplay_handshake_sync(netplay, connection,
+            netplay->buffer[ptr].frame, netplay->self_client_num))
+      return false;
+
+   *had_input = true;
+   return netplay_relay_join(netplay, connection, (size_t)ptr);
+}
+
 /**
  * netplay_handshake
  *
@@ -1164,7 +1243,10 @@ bool netplay_handshake(netplay_t *netplay,
          ret = netplay_handshake_pre_info(netplay, connection, had_input);
          break;
       case NETPLAY_CONNECTION_PRE_SYNC:
-         ret = netplay_handshake_pre_sync(netplay, connection, had_input);
+         if (connection->relayed)
+            ret = netplay_handshake_relay_sync(netplay, connection, had_input);
+         else
+            ret = netplay_handshake_pre_sync(netplay, connection, had_input);
          break;
       case NETPLAY_CONNECTION_NONE:
       default:
@@ -218,6 +218,133 @@ static bool init_tcp_socket(netplay_t *netplay, void *direct_host,
    return ret;
 }
 
+/* The UDP input socket goes on the port after the TCP one, as LAN discovery
+ * already uses the default port for UDP. Failing that, anything will do, as
+ * the port is sent to each client. */
+static int init_udp_socket_port(uint16_t port)
+{
+   char port_buf[16];
+   int fd                          = -1;
+   const struct addrinfo *tmp_info = NULL;
+   struct addrinfo *res            = NULL;
+   struct addrinfo hints           = {0};
+
+#ifdef HAVE_INET6
+   hints.ai_family   = AF_INET6;
+#endif
+   hints.ai_socktype = SOCK_DGRAM;
+   hints.ai_flags    = AI_PASSIVE;
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+   {
+#ifdef HAVE_INET6
+      hints.ai_family = 0;
+      if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+#endif
+         return -1;
+   }
+
+   for (tmp_info = res; tmp_info; tmp_info = tmp_info->ai_next)
+   {
+      fd = socket(tmp_info->ai_family, tmp_info->ai_socktype,
+            tmp_info->ai_protocol);
+      if (fd < 0)
+         continue;
+
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+      if (tmp_info->ai_family == AF_INET6)
+      {
+         int on = 0;
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on,
+               sizeof(on));
+      }
+#endif
+
+      if (socket_bind(fd, (void*)tmp_info) && socket_nonblock(fd))
+         break;
+
+      socket_close(fd);
+      fd = -1;
+   }
+
+   if (res)
+      freeaddrinfo_retro(res);
+
+   return fd;
+}
+
+static void init_udp_socket(netplay_t *netplay, uint16_t port)
+{
+   netplay->udp_fd = init_udp_socket_port(port + 1);
+   if (netplay->udp_fd < 0)
+      netplay->udp_fd = init_udp_socket_port(0);
+
+   if (netplay->udp_fd < 0)
+      RARCH_WARN("[netplay] Could not open a UDP socket, input will only be sent over TCP.\n");
+}
+
+/* Listen for spectators of our own, to relay the stream to */
+static void init_relay_socket(netplay_t *netplay, uint16_t port)
+{
+   char port_buf[16];
+   const struct addrinfo *tmp_info = NULL;
+   struct addrinfo *res            = NULL;
+   struct addrinfo hints           = {0};
+
+   /* They're brought up to date with our savestates */
+   if (netplay->quirks &
+         (NETPLAY_QUIRK_NO_SAVESTATES|NETPLAY_QUIRK_NO_TRANSMISSION))
+   {
+      RARCH_WARN("[netplay] This core can't send savestates, not relaying.\n");
+      return;
+   }
+
+#ifdef HAVE_INET6
+   hints.ai_family   = AF_INET6;
+#endif
+   hints.ai_socktype = SOCK_STREAM;
+   hints.ai_flags    = AI_PASSIVE;
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+   {
+#ifdef HAVE_INET6
+      hints.ai_family = 0;
+      if (getaddrinfo_retro(NULL, port_buf, &hints, &res) != 0)
+#endif
+         res = NULL;
+   }
+
+   for (tmp_info = res; tmp_info; tmp_info = tmp_info->ai_next)
+   {
+      struct sockaddr_storage sad = {0};
+      int fd = init_tcp_connection(tmp_info, false,
+            (struct sockaddr*)&sad, sizeof(sad));
+
+      if (fd < 0)
+         continue;
+
+      if (socket_nonblock(fd))
+      {
+         netplay->relay_fd = fd;
+         break;
+      }
+
+      socket_close(fd);
+   }
+
+   if (res)
+      freeaddrinfo_retro(res);
+
+   if (netplay->relay_fd < 0)
+      RARCH_WARN("[netplay] Could not listen on port %hu, not relaying.\n",
+            (unsigned short)port);
+   else
+      RARCH_LOG("[netplay] Relaying to spectators on port %hu.\n",
+            (unsigned short)port);
+}
+
 static bool init_socket(netplay_t *netplay, void *direct_host,
       const char *server, uint16_t port)
 {
@@ -227,6 +354,10 @@ static bool init_socket(netplay_t *netplay, void *direct_host,
    if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
+   /* Clients open theirs when the server tells them where to send */
+   if (netplay->is_server && netplay->udp)
+      init_udp_socket(netplay, port);
+
    if (netplay->is_server && netplay->nat_traversal)
       netplay_init_nat_traversal(netplay);
 
@@ -407,6 +538,9 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp                  : If true, offer to send input over UDP as well.
+ * @relay_port           : If nonzero, relay the stream to spectators of our
+ *                         own on this port (client only).
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -417,19 +551,22 @@ static bool netplay_init_buffers(netplay_t *netplay)
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks)
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp,
+   uint16_t relay_port, const char *nick, uint64_t quirks)
 {
    netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
    if (!netplay)
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
+   netplay->relay_fd             = -1;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
    netplay->is_connected         = false;
    netplay->nat_traversal        = netplay->is_server ? nat_traversal : false;
+   netplay->udp                  = udp;
    netplay->stateless_mode       = stateless_mode;
    netplay->check_frames         = check_frames;
    netplay->crc_validity_checked = false;
@@ -461,6 +598,9 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
       return NULL;
    }
 
+   if (!netplay->is_server && relay_port)
+      init_relay_socket(netplay, relay_port);
+
    if (!netplay_init_buffers(netplay))
    {
       free(netplay);
@@ -512,6 +652,12 @@ error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+
+   if (netplay->relay_fd >= 0)
+      socket_close(netplay->relay_fd);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -532,6 +678,9 @@ void netplay_free(netplay_t *netplay)
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -540,12 +689,30 @@ void netplay_free(netplay_t *netplay)
          socket_close(connection->fd);
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+         netplay_savestate_transfers_free(connection);
       }
    }
 
    if (netplay->connections && netplay->connections != &netplay->one_connection)
       free(netplay->connections);
 
+   if (netplay->relay_fd >= 0)
+      socket_close(netplay->relay_fd);
+
+   for (i = 0; i < netplay->relay_connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->relay_connections[i];
+      if (connection->active)
+      {
+         socket_close(connection->fd);
+         netplay_deinit_socket_buffer(&connection->send_packet_buffer);
+         netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+         netplay_savestate_transfers_free(connection);
+      }
+   }
+
+   free(netplay->relay_connections);
+
    if (netplay->nat_traversal)
       natt_free(&netplay->nat_traversal_state);
 
@@ -560,6 +727,13 @@ void netplay_free(netplay_t *netplay)
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   if (netplay->savestate_chunk_buffer)
+      free(netplay->savestate_chunk_buffer);
+
+   if (netplay->savestate_stream)
+      netplay->compress_zlib.compression_backend->stream_free(
+            netplay->savestate_stream);
+
    if (netplay->compress_nil.compression_stream)
    {
       netplay->compress_nil.compression_backend->stream_free(netplay->compress_nil.compression_stream);
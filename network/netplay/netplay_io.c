@@ -21,6 +21,7 @@
 
 #include <boolean.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
 
 #include "netplay_private.h"
 
@@ -99,6 +100,21 @@ static void remote_unpaused(netplay_t *netplay,
  *
  * Disconnects an active Netplay connection due to an error
  */
+/* Disconnect a spectator of ours. The stream we relay goes on without it. */
+static void netplay_relay_hangup(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   RARCH_LOG("[netplay] Relayed spectator %s disconnected.\n",
+         connection->nick[0] ? connection->nick : "(unnamed)");
+
+   socket_close(connection->fd);
+   connection->active = false;
+   connection->mode   = NETPLAY_CONNECTION_NONE;
+   netplay_deinit_socket_buffer(&connection->send_packet_buffer);
+   netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   netplay_savestate_transfers_free(connection);
+}
+
 void netplay_hangup(netplay_t *netplay,
       struct netplay_connection *connection)
 {
@@ -111,6 +127,12 @@ void netplay_hangup(netplay_t *netplay,
    if (!connection->active)
       return;
 
+   if (connection->relayed)
+   {
+      netplay_relay_hangup(netplay, connection);
+      return;
+   }
+
    msg[0] = msg[sizeof(msg)-1] = '\0';
    dmsg = msg;
 
@@ -142,6 +164,16 @@ void netplay_hangup(netplay_t *netplay,
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   netplay_savestate_transfers_free(connection);
+
+   if (connection->udp_enabled)
+   {
+      RARCH_LOG("[netplay] UDP input: %u packets sent, %u received, "
+            "%u inputs ahead of TCP.\n",
+            connection->udp.packets_sent, connection->udp.packets_received,
+            connection->udp_inputs_early);
+      connection->udp_enabled = connection->udp_active = false;
+   }
 
    if (!netplay->is_server)
    {
@@ -228,13 +260,60 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
+/**
+ * netplay_udp_queue_input
+ *
+ * Account for an input command just queued on TCP, and queue it for UDP too
+ * if that's in use.
+ */
+static void netplay_udp_queue_input(struct netplay_connection *connection,
+      const uint32_t *cmd, size_t words)
+{
+   uint32_t bytes       = (uint32_t)(words * sizeof(uint32_t));
+   /* Everything else that went before it */
+   uint32_t sync_offset = connection->send_packet_buffer.total - bytes -
+      connection->input_bytes_sent;
+
+   connection->input_bytes_sent += bytes;
+
+   if (connection->udp_enabled)
+      netplay_udp_queue(&connection->udp, cmd, words, sync_offset);
+}
+
+/**
+ * netplay_udp_send
+ *
+ * Send a UDP packet with our unacknowledged input to this connection. We do
+ * this every frame even with nothing new to send, as it carries our
+ * acknowledgements.
+ */
+static void netplay_udp_send(netplay_t *netplay,
+      struct netplay_connection *connection)
 {
-#define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
+   uint32_t packet[NETPLAY_UDP_MAX_PACKET / sizeof(uint32_t)];
+   size_t len;
+
+   if (netplay->udp_fd < 0 || !connection->udp_active)
+      return;
+
+   len = netplay_udp_build(&connection->udp, packet, sizeof(packet));
+
+   /* Errors don't matter, TCP has it all anyway */
+   sendto(netplay->udp_fd, (const char*)packet, len, 0,
+         (struct sockaddr*)&connection->udp_addr, connection->udp_addr_len);
+}
+
+/* Largest input command we'll encode, in words (FIXME: Arbitrary
+ * restriction) */
+#define NETPLAY_INPUT_CMD_WORDS NETPLAY_BROADCAST_CMD_WORDS
+
+/* Encode the specified input data as an INPUT command, returning its size
+ * in words */
+static size_t netplay_encode_input(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer)
+{
+   uint32_t devices, device;
    size_t bufused, i;
 
    /* Set up the basic buffer */
@@ -255,7 +334,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          istate = istate->next;
       if (!istate)
          continue;
-      if (bufused + istate->size >= BUFSZ)
+      if (bufused + istate->size >= NETPLAY_INPUT_CMD_WORDS)
          continue; /* FIXME: More severe? */
       for (i = 0; i < istate->size; i++)
          buffer[bufused+i] = htonl(istate->data[i]);
@@ -263,6 +342,19 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
    }
    buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
 
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[NETPLAY_INPUT_CMD_WORDS];
+   size_t bufused, i;
+
+   bufused = netplay_encode_input(netplay, dframe, client_num, slave, buffer);
+
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[netplay] Sending input for client %u\n", (unsigned) client_num);
    print_state(netplay);
@@ -275,6 +367,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          netplay_hangup(netplay, only);
          return false;
       }
+      netplay_udp_queue_input(only, buffer, bufused);
    }
    else
    {
@@ -291,12 +384,13 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
             if (!netplay_send(&connection->send_packet_buffer, connection->fd,
                   buffer, bufused*sizeof(uint32_t)))
                netplay_hangup(netplay, connection);
+            else
+               netplay_udp_queue_input(connection, buffer, bufused);
          }
       }
    }
 
    return true;
-#undef BUFSZ
 }
 
 /**
@@ -336,10 +430,14 @@ bool netplay_send_cur_input(netplay_t *netplay,
       /* If we're not playing, send a NOINPUT */
       if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
       {
-         uint32_t payload = htonl(netplay->self_frame_count);
-         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
-               &payload, sizeof(payload)))
+         uint32_t noinput[3];
+         noinput[0] = htonl(NETPLAY_CMD_NOINPUT);
+         noinput[1] = htonl(sizeof(uint32_t));
+         noinput[2] = htonl(netplay->self_frame_count);
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+               noinput, sizeof(noinput)))
             return false;
+         netplay_udp_queue_input(connection, noinput, 3);
       }
 
    }
@@ -358,9 +456,100 @@ bool netplay_send_cur_input(netplay_t *netplay,
          false))
       return false;
 
+   netplay_udp_send(netplay, connection);
+
    return true;
 }
 
+/**
+ * netplay_send_cur_input_all
+ *
+ * Send the current input frame to every connection. As a server, the input
+ * is encoded once and the same bytes go to everyone.
+ */
+void netplay_send_cur_input_all(netplay_t *netplay)
+{
+   size_t i, j;
+   uint32_t cmd[NETPLAY_INPUT_CMD_WORDS];
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   netplay_broadcast_t *bc    = &netplay->broadcast;
+
+   if (!netplay->is_server)
+   {
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (connection->active &&
+               connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+            netplay_send_cur_input(netplay, connection);
+      }
+      return;
+   }
+
+   /* Encode everything once: the other players' input, tagged with whose it
+    * is so it doesn't go back to them... */
+   netplay_broadcast_clear(bc);
+   for (i = 1; i < MAX_CLIENTS; i++)
+   {
+      if ((netplay->connected_players & (1<<i)) && dframe->have_real[i])
+         netplay_broadcast_add(bc, (uint32_t)i, cmd,
+               netplay_encode_input(netplay, dframe, (uint32_t)i, false, cmd));
+   }
+
+   /* ... then a NOINPUT if we're not playing, or our own data */
+   if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+   {
+      cmd[0] = htonl(NETPLAY_CMD_NOINPUT);
+      cmd[1] = htonl(sizeof(uint32_t));
+      cmd[2] = htonl(netplay->self_frame_count);
+      netplay_broadcast_add(bc, NETPLAY_BROADCAST_EVERYONE, cmd, 3);
+   }
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+      netplay_broadcast_add(bc, netplay->self_client_num, cmd,
+            netplay_encode_input(netplay, dframe, netplay->self_client_num,
+               netplay->self_mode == NETPLAY_CONNECTION_SLAVE, cmd));
+
+#ifdef DEBUG_NETPLAY_STEPS
+   RARCH_LOG("[netplay] Broadcasting %u input commands\n",
+         (unsigned) bc->cmd_count);
+   print_state(netplay);
+#endif
+
+   /* And copy it to each connection */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      uint32_t to_client                    = (uint32_t)(i + 1);
+
+      if (!connection->active ||
+            connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      for (j = 0; j < bc->cmd_count; j++)
+      {
+         const struct netplay_broadcast_cmd *bcmd = &bc->cmds[j];
+         if (bcmd->client_num == to_client)
+            continue;
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+               bc->data + bcmd->start, bcmd->words * sizeof(uint32_t)))
+            break;
+         netplay_udp_queue_input(connection, bc->data + bcmd->start,
+               bcmd->words);
+      }
+
+      if (j < bc->cmd_count ||
+            !netplay_send_flush(&connection->send_packet_buffer,
+               connection->fd, false))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      netplay_udp_send(netplay, connection);
+   }
+}
+
 /**
  * netplay_send_raw_cmd
  *
@@ -482,6 +671,142 @@ bool netplay_cmd_request_savestate(netplay_t *netplay)
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+/* Scratch space for one encoded chunk, followed by room for it decoded */
+static uint8_t *netplay_savestate_chunk_buffer(netplay_t *netplay)
+{
+   if (!netplay->savestate_chunk_buffer)
+      netplay->savestate_chunk_buffer = (uint8_t*)malloc(
+            NETPLAY_SAVESTATE_CHUNK_BOUND + NETPLAY_SAVESTATE_CHUNK_SIZE);
+   return netplay->savestate_chunk_buffer;
+}
+
+/**
+ * netplay_cmd_load_savestate_delta
+ *
+ * Start sending a savestate to a peer that takes them as chunked deltas.
+ * The chunks follow over the next frames.
+ */
+bool netplay_cmd_load_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection, netplay_savestate_source_t *src)
+{
+   uint32_t payload[6];
+
+   payload[0] = htonl(src->frame);
+   payload[1] = htonl((uint32_t)src->size);
+   payload[2] = htonl(src->base_frame);
+   payload[3] = htonl(src->base_crc);
+   payload[4] = htonl(src->crc);
+   payload[5] = htonl(src->chunk_count);
+
+   if (!netplay_send_raw_cmd(netplay, connection,
+            NETPLAY_CMD_LOAD_SAVESTATE_DELTA, payload, sizeof(payload)))
+      return false;
+
+   /* This replaces any transfer still in progress */
+   netplay_savestate_source_free(connection->savestate_send);
+   src->refs++;
+   connection->savestate_send       = src;
+   connection->savestate_send_chunk = 0;
+   connection->savestate_full       = false;
+   return true;
+}
+
+/**
+ * netplay_savestate_transfers_free
+ *
+ * Abandon any savestate transfers in progress on this connection.
+ */
+void netplay_savestate_transfers_free(struct netplay_connection *connection)
+{
+   netplay_savestate_source_free(connection->savestate_send);
+   connection->savestate_send = NULL;
+
+   free(connection->savestate_recv_data);
+   connection->savestate_recv_data = NULL;
+   connection->savestate_recv      = false;
+}
+
+/**
+ * netplay_send_savestate_chunks
+ *
+ * Queue the next few chunks of the savestate being sent on this connection,
+ * no more than the socket is taking and for no longer than a few
+ * milliseconds, so the transfer never holds up the frame.
+ *
+ * Returns false on failure.
+ */
+static bool netplay_send_savestate_chunks(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   retro_time_t start;
+   uint8_t *buffer;
+   const struct trans_stream_backend *backend = NULL;
+   void **stream                              = NULL;
+   netplay_savestate_source_t *src       = connection->savestate_send;
+   struct socket_buffer *sbuf            = &connection->send_packet_buffer;
+   size_t queue_max                      =
+      MIN(NETPLAY_SAVESTATE_QUEUE, sbuf->bufsz / 4);
+
+   if (!src)
+      return true;
+
+   if (!(buffer = netplay_savestate_chunk_buffer(netplay)))
+      return false;
+
+   /* Chunks are compressed at their own level, so they get their own
+    * stream */
+   switch (connection->compression_supported)
+   {
+      case NETPLAY_COMPRESSION_ZLIB:
+         backend = netplay->compress_zlib.compression_backend;
+         stream  = &netplay->savestate_stream;
+         break;
+      default:
+         backend = netplay->compress_nil.compression_backend;
+         stream  = &netplay->compress_nil.compression_stream;
+   }
+
+   start = cpu_features_get_time_usec();
+   while (connection->savestate_send_chunk < src->chunk_count)
+   {
+      uint32_t header[2];
+      size_t len;
+
+      if (netplay_send_pending(sbuf) >= queue_max)
+      {
+         if (!netplay_send_flush(sbuf, connection->fd, false))
+            return false;
+         if (netplay_send_pending(sbuf) >= queue_max)
+            break;
+      }
+
+      len = netplay_savestate_encode_chunk(src,
+            connection->savestate_send_chunk, backend, stream,
+            buffer, NETPLAY_SAVESTATE_CHUNK_BOUND);
+      if (!len)
+         return false;
+
+      header[0] = htonl(NETPLAY_CMD_SAVESTATE_CHUNK);
+      header[1] = htonl((uint32_t)len);
+      if (!netplay_send(sbuf, connection->fd, header, sizeof(header)) ||
+          !netplay_send(sbuf, connection->fd, buffer, len))
+         return false;
+
+      connection->savestate_send_chunk++;
+
+      if (cpu_features_get_time_usec() - start >= NETPLAY_SAVESTATE_SEND_USEC)
+         break;
+   }
+
+   if (connection->savestate_send_chunk >= src->chunk_count)
+   {
+      netplay_savestate_source_free(src);
+      connection->savestate_send = NULL;
+   }
+
+   return true;
+}
+
 /**
  * netplay_cmd_mode
  *
@@ -908,94 +1233,461 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
    }
 }
 
-#undef RECV
-#define RECV(buf, sz) \
-recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), \
-(sz), false); \
-if (recvd >= 0 && recvd < (ssize_t) (sz)) goto shrt; \
-else if (recvd < 0)
-
-static bool netplay_get_cmd(netplay_t *netplay,
-   struct netplay_connection *connection, bool *had_input)
+/**
+ * netplay_udp_connect
+ *
+ * Start sending input over UDP to the server, as it's asked us to.
+ */
+static bool netplay_udp_connect(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t token, uint16_t port)
 {
-   uint32_t cmd;
-   uint32_t cmd_size;
-   ssize_t recvd;
-
-   /* We don't handle the initial handshake here */
-   if (connection->mode < NETPLAY_CONNECTION_CONNECTED)
-      return netplay_handshake(netplay, connection, had_input);
-
-   RECV(&cmd, sizeof(cmd))
-      return false;
-
-   cmd      = ntohl(cmd);
+   struct sockaddr_storage addr;
+   socklen_t addr_len = sizeof(addr);
 
-   RECV(&cmd_size, sizeof(cmd_size))
+   /* The server is where our TCP connection goes, on the port it gave us */
+   if (getpeername(connection->fd, (struct sockaddr*)&addr, &addr_len) < 0)
       return false;
 
-   cmd_size = ntohl(cmd_size);
-
-#ifdef DEBUG_NETPLAY_STEPS
-   RARCH_LOG("[netplay] Received netplay command %X (%u) from %u\n", cmd, cmd_size,
-         (unsigned) (connection - netplay->connections));
-#endif
-
-   netplay->timeout_cnt = 0;
-
-   switch (cmd)
+   switch (((struct sockaddr*)&addr)->sa_family)
    {
-      case NETPLAY_CMD_ACK:
-         /* Why are we even bothering? */
+      case AF_INET:
+         ((struct sockaddr_in*)&addr)->sin_port = htons(port);
+         break;
+#ifdef AF_INET6
+      case AF_INET6:
+         ((struct sockaddr_in6*)&addr)->sin6_port = htons(port);
          break;
+#endif
+      default:
+         return false;
+   }
 
-      case NETPLAY_CMD_NAK:
-         /* Disconnect now! */
+   if (netplay->udp_fd < 0)
+   {
+      netplay->udp_fd = socket(((struct sockaddr*)&addr)->sa_family,
+            SOCK_DGRAM, 0);
+      if (netplay->udp_fd < 0)
+         return false;
+      if (!socket_nonblock(netplay->udp_fd))
+      {
+         socket_close(netplay->udp_fd);
+         netplay->udp_fd = -1;
          return false;
+      }
+   }
 
-      case NETPLAY_CMD_INPUT:
-         {
-            uint32_t frame_num, client_num, input_size, devices, device;
-            struct delta_frame *dframe;
+   memcpy(&connection->udp_addr, &addr, addr_len);
+   connection->udp_addr_len = addr_len;
+   connection->udp_enabled  = true;
+   connection->udp_active   = true;
+   netplay_udp_init(&connection->udp, token);
 
-            if (cmd_size < 2*sizeof(uint32_t))
-            {
-               RARCH_ERR("NETPLAY_CMD_INPUT too short, no frame/client number.");
-               return netplay_cmd_nak(netplay, connection);
-            }
+   RARCH_LOG("[netplay] Sending input over UDP as well.\n");
+   return true;
+}
 
-            RECV(&frame_num, sizeof(frame_num))
-               return false;
-            RECV(&client_num, sizeof(client_num))
-               return false;
-            frame_num = ntohl(frame_num);
-            client_num = ntohl(client_num);
-            client_num &= 0xFFFF;
+/**
+ * netplay_udp_offer
+ *
+ * Offer the UDP input channel to a newly connected client that supports it
+ * (server only).
+ */
+bool netplay_udp_offer(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t payload[2];
+   struct sockaddr_storage addr;
+   socklen_t addr_len = sizeof(addr);
+   uint32_t token     = 0;
+   uint16_t port      = 0;
+   size_t i;
 
-            if (netplay->is_server)
-            {
-               /* Ignore the claimed client #, must be this client */
-               if (connection->mode != NETPLAY_CONNECTION_PLAYING &&
-                   connection->mode != NETPLAY_CONNECTION_SLAVE)
-               {
-                  RARCH_ERR("Netplay input from non-participating player.\n");
-                  return netplay_cmd_nak(netplay, connection);
-               }
-               client_num = (uint32_t)(connection - netplay->connections + 1);
-            }
+   if (!connection->udp_enabled)
+      return true;
 
-            if (client_num > MAX_CLIENTS)
-            {
-               RARCH_ERR("NETPLAY_CMD_INPUT received data for an unsupported client.\n");
-               return netplay_cmd_nak(netplay, connection);
-            }
+   if (netplay->udp_fd < 0 ||
+         getsockname(netplay->udp_fd, (struct sockaddr*)&addr, &addr_len) < 0)
+   {
+      connection->udp_enabled = false;
+      return true;
+   }
 
-            /* Figure out how much input is expected */
-            devices = netplay->client_devices[client_num];
-            input_size = netplay_expected_input_size(netplay, devices);
+   if (((struct sockaddr*)&addr)->sa_family == AF_INET)
+      port = ntohs(((struct sockaddr_in*)&addr)->sin_port);
+#ifdef AF_INET6
+   else if (((struct sockaddr*)&addr)->sa_family == AF_INET6)
+      port = ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+#endif
 
-            if (cmd_size != (2+input_size) * sizeof(uint32_t))
-            {
+   /* Any unique nonzero token will do; it's the source address that we
+    * check */
+   do
+   {
+      token = (uint32_t)cpu_features_get_time_usec() ^
+         ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+      for (i = 0; i < netplay->connections_size && token; i++)
+         if (netplay->connections[i].active &&
+               netplay->connections[i].udp_enabled &&
+               netplay->connections[i].udp.token == token)
+            token = 0;
+   } while (!token);
+
+   netplay_udp_init(&connection->udp, token);
+
+   /* Packets for this connection have to come from the same host */
+   connection->udp_addr_len = sizeof(connection->udp_addr);
+   if (getpeername(connection->fd, (struct sockaddr*)&connection->udp_addr,
+            &connection->udp_addr_len) < 0)
+   {
+      connection->udp_enabled = false;
+      return true;
+   }
+
+   payload[0] = htonl(token);
+   payload[1] = htonl(port);
+   return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP,
+         payload, sizeof(payload));
+}
+
+#undef RECV
+/**
+ * netplay_sync_loaded_state
+ *
+ * Bring our frame counters in line with a state loaded (or a reset) at the
+ * given frame.
+ */
+static void netplay_sync_loaded_state(netplay_t *netplay, size_t load_ptr,
+   uint32_t load_frame_count, bool reset)
+{
+   uint32_t client;
+
+   /* Skip ahead if it's past where we are */
+   if (load_frame_count > netplay->run_frame_count || reset)
+   {
+      /* This is squirrely: We need to assure that when we advance the
+       * frame in post_frame, THEN we're referring to the frame to
+       * load into. If we refer directly to read_ptr, then we'll end
+       * up never reading the input for read_frame_count itself, which
+       * will make the other side unhappy. */
+      netplay->run_ptr           = PREV_PTR(load_ptr);
+      netplay->run_frame_count   = load_frame_count - 1;
+      if (load_frame_count > netplay->self_frame_count)
+      {
+         netplay->self_ptr         = netplay->run_ptr;
+         netplay->self_frame_count = netplay->run_frame_count;
+      }
+   }
+
+   /* Don't expect earlier data from other clients */
+   for (client = 0; client < MAX_CLIENTS; client++)
+   {
+      if (!(netplay->connected_players & (1<<client)))
+         continue;
+
+      if (load_frame_count > netplay->read_frame_count[client])
+      {
+         netplay->read_ptr[client] = load_ptr;
+         netplay->read_frame_count[client] = load_frame_count;
+      }
+   }
+
+   /* Make sure our states are correct */
+   netplay->savestate_request_outstanding = false;
+   netplay->other_ptr                     = load_ptr;
+   netplay->other_frame_count             = load_frame_count;
+
+#ifdef DEBUG_NETPLAY_STEPS
+   RARCH_LOG("[netplay] Loading state at %u\n", load_frame_count);
+   print_state(netplay);
+#endif
+}
+
+/**
+ * netplay_savestate_recv_abandon
+ *
+ * Give up on the savestate being received, and ask for the current state in
+ * full instead.
+ */
+static void netplay_savestate_recv_abandon(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   free(connection->savestate_recv_data);
+   connection->savestate_recv_data = NULL;
+   connection->savestate_recv      = false;
+
+   if (netplay->is_server)
+      netplay_send_raw_cmd(netplay, connection,
+            NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
+   else
+      netplay_cmd_request_savestate(netplay);
+}
+
+/**
+ * netplay_savestate_recv_finish
+ *
+ * All chunks of a savestate are in, so load it.
+ */
+static void netplay_savestate_recv_finish(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   size_t load_ptr           = connection->savestate_recv_ptr;
+   uint32_t load_frame_count = connection->savestate_recv_frame;
+   struct delta_frame *delta = &netplay->buffer[load_ptr];
+
+   if (encoding_crc32(0L, connection->savestate_recv_data,
+            netplay->state_size) != connection->savestate_recv_crc)
+   {
+      RARCH_ERR("[netplay] Received savestate doesn't match its checksum.\n");
+      netplay_savestate_recv_abandon(netplay, connection);
+      return;
+   }
+
+   /* We read no further than this frame, so it's still ours to load into */
+   if (!delta->used || delta->frame != load_frame_count)
+   {
+      RARCH_ERR("[netplay] Lost the frame to load a savestate into.\n");
+      netplay_savestate_recv_abandon(netplay, connection);
+      return;
+   }
+
+   memcpy(delta->state, connection->savestate_recv_data, netplay->state_size);
+   free(connection->savestate_recv_data);
+   connection->savestate_recv_data = NULL;
+   connection->savestate_recv      = false;
+
+   /* Force a rewind to the relevant frame */
+   netplay->force_rewind = true;
+   netplay_sync_loaded_state(netplay, load_ptr, load_frame_count, false);
+}
+
+/**
+ * netplay_savestate_recv_begin
+ *
+ * Start receiving a savestate for the given frame. It's sent as changes
+ * against the state we have for base_frame, which we have to check we
+ * really have.
+ */
+static void netplay_savestate_recv_begin(netplay_t *netplay,
+   struct netplay_connection *connection,
+   size_t load_ptr, uint32_t load_frame_count,
+   uint32_t base_frame, uint32_t base_crc, uint32_t crc, uint32_t chunks)
+{
+   size_t i;
+
+   free(connection->savestate_recv_data);
+   connection->savestate_recv      = false;
+   connection->savestate_recv_data = (uint8_t*)
+      calloc(1, netplay->state_size);
+   if (!connection->savestate_recv_data)
+      return;
+
+   if (base_frame != NETPLAY_SAVESTATE_NO_BASE)
+   {
+      struct delta_frame *base = NULL;
+
+      for (i = 0; i < netplay->buffer_size; i++)
+      {
+         if (netplay->buffer[i].used && netplay->buffer[i].frame == base_frame)
+         {
+            base = &netplay->buffer[i];
+            break;
+         }
+      }
+
+      if (!base || encoding_crc32(0L, (const unsigned char*)base->state,
+               netplay->state_size) != base_crc)
+      {
+         RARCH_WARN("[netplay] Don't have the state for frame %u to load "
+               "a savestate against, requesting it in full.\n", base_frame);
+         netplay_savestate_recv_abandon(netplay, connection);
+         return;
+      }
+
+      memcpy(connection->savestate_recv_data, base->state,
+            netplay->state_size);
+   }
+
+   connection->savestate_recv        = true;
+   connection->savestate_recv_frame  = load_frame_count;
+   connection->savestate_recv_ptr    = load_ptr;
+   connection->savestate_recv_chunks = chunks;
+   connection->savestate_recv_crc    = crc;
+
+   /* Nothing changed at all */
+   if (!chunks)
+      netplay_savestate_recv_finish(netplay, connection);
+}
+
+/**
+ * netplay_relay_forward
+ *
+ * Pass a command we've just handled from the server on to our spectators,
+ * byte for byte as it came.
+ */
+static void netplay_relay_forward(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t cmd)
+{
+   const unsigned char *a, *b;
+   size_t a_len, b_len, len, i;
+   uint32_t head[4];
+
+   switch (cmd)
+   {
+      case NETPLAY_CMD_INPUT:
+      case NETPLAY_CMD_NOINPUT:
+      case NETPLAY_CMD_CRC:
+      case NETPLAY_CMD_PAUSE:
+      case NETPLAY_CMD_RESUME:
+      case NETPLAY_CMD_SAVESTATE_CHUNK:
+      case NETPLAY_CMD_MODE:
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+      case NETPLAY_CMD_RESET:
+         break;
+      default:
+         /* The rest is between us and the server */
+         return;
+   }
+
+   len = netplay_recv_unflushed(&connection->recv_packet_buffer,
+         &a, &a_len, &b, &b_len);
+
+   /* The command header and the first two words of payload */
+   memset(head, 0, sizeof(head));
+   for (i = 0; i < sizeof(head) && i < len; i++)
+      ((unsigned char*)head)[i] = (i < a_len) ? a[i] : b[i - a_len];
+
+   switch (cmd)
+   {
+      case NETPLAY_CMD_MODE:
+         /* Changes to the shared state that spectators joining later have to
+          * start after */
+         if (ntohl(head[2]) > netplay->relay_sync_frame)
+            netplay->relay_sync_frame = ntohl(head[2]);
+
+         /* Our own mode is nobody else's business */
+         if (ntohl(head[3]) & NETPLAY_CMD_MODE_BIT_YOU)
+            return;
+         break;
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+      case NETPLAY_CMD_RESET:
+         if (ntohl(head[2]) > netplay->relay_sync_frame)
+            netplay->relay_sync_frame = ntohl(head[2]);
+         break;
+      default:
+         break;
+   }
+
+   for (i = 0; i < netplay->relay_connections_size; i++)
+   {
+      struct netplay_connection *rc = &netplay->relay_connections[i];
+      if (!rc->active || rc->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      /* The server's state replaces the one we were sending */
+      if (cmd == NETPLAY_CMD_LOAD_SAVESTATE ||
+            cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA ||
+            cmd == NETPLAY_CMD_RESET)
+      {
+         netplay_savestate_source_free(rc->savestate_send);
+         rc->savestate_send = NULL;
+      }
+
+      if (!netplay_send(&rc->send_packet_buffer, rc->fd, a, a_len) ||
+          (b_len &&
+           !netplay_send(&rc->send_packet_buffer, rc->fd, b, b_len)))
+         netplay_hangup(netplay, rc);
+   }
+}
+
+#define RECV(buf, sz) \
+recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), \
+(sz), false); \
+if (recvd >= 0 && recvd < (ssize_t) (sz)) goto shrt; \
+else if (recvd < 0)
+
+static bool netplay_get_cmd(netplay_t *netplay,
+   struct netplay_connection *connection, bool *had_input)
+{
+   uint32_t cmd;
+   uint32_t cmd_size;
+   ssize_t recvd;
+
+   /* We don't handle the initial handshake here */
+   if (connection->mode < NETPLAY_CONNECTION_CONNECTED)
+      return netplay_handshake(netplay, connection, had_input);
+
+   RECV(&cmd, sizeof(cmd))
+      return false;
+
+   cmd      = ntohl(cmd);
+
+   RECV(&cmd_size, sizeof(cmd_size))
+      return false;
+
+   cmd_size = ntohl(cmd_size);
+
+#ifdef DEBUG_NETPLAY_STEPS
+   RARCH_LOG("[netplay] Received netplay command %X (%u) from %u\n", cmd, cmd_size,
+         (unsigned) (connection - netplay->connections));
+#endif
+
+   netplay->timeout_cnt = 0;
+
+   switch (cmd)
+   {
+      case NETPLAY_CMD_ACK:
+         /* Why are we even bothering? */
+         break;
+
+      case NETPLAY_CMD_NAK:
+         /* Disconnect now! */
+         return false;
+
+      case NETPLAY_CMD_INPUT:
+         {
+            uint32_t frame_num, client_num, input_size, devices, device;
+            struct delta_frame *dframe;
+
+            if (cmd_size < 2*sizeof(uint32_t))
+            {
+               RARCH_ERR("NETPLAY_CMD_INPUT too short, no frame/client number.");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&frame_num, sizeof(frame_num))
+               return false;
+            RECV(&client_num, sizeof(client_num))
+               return false;
+            frame_num = ntohl(frame_num);
+            client_num = ntohl(client_num);
+            client_num &= 0xFFFF;
+
+            if (netplay->is_server)
+            {
+               /* Ignore the claimed client #, must be this client */
+               if (connection->mode != NETPLAY_CONNECTION_PLAYING &&
+                   connection->mode != NETPLAY_CONNECTION_SLAVE)
+               {
+                  RARCH_ERR("Netplay input from non-participating player.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               client_num = (uint32_t)(connection - netplay->connections + 1);
+            }
+
+            if (client_num > MAX_CLIENTS)
+            {
+               RARCH_ERR("NETPLAY_CMD_INPUT received data for an unsupported client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            /* Figure out how much input is expected */
+            devices = netplay->client_devices[client_num];
+            input_size = netplay_expected_input_size(netplay, devices);
+
+            if (cmd_size != (2+input_size) * sizeof(uint32_t))
+            {
                RARCH_ERR("NETPLAY_CMD_INPUT received an unexpected payload size.\n");
                return netplay_cmd_nak(netplay, connection);
             }
@@ -1562,17 +2254,19 @@ static bool netplay_get_cmd(netplay_t *netplay,
 
       case NETPLAY_CMD_REQUEST_SAVESTATE:
          /* Delay until next frame so we don't send the savestate after the
-          * input */
+          * input. Whatever state they have, it's not one we can send them a
+          * delta against. */
          netplay->force_send_savestate = true;
+         connection->savestate_full    = true;
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
             uint32_t isize;
             uint32_t rd, wn;
-            uint32_t client;
             uint32_t load_frame_count;
             size_t load_ptr;
             struct compression_transcoder *ctrans = NULL;
@@ -1624,6 +2318,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Check the payload size */
             if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
                  (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+                (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA && cmd_size != 6*sizeof(uint32_t)) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1661,7 +2356,28 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Now we switch based on whether we're loading a state or resetting */
-            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+            {
+               uint32_t payload[5];
+               RECV(payload, sizeof(payload))
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA failed to receive header.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               if (ntohl(payload[0]) != netplay->state_size)
+               {
+                  RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received an unexpected save state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               /* The state is loaded once all of its chunks are in */
+               netplay_savestate_recv_begin(netplay, connection, load_ptr,
+                     load_frame_count, ntohl(payload[1]), ntohl(payload[2]),
+                     ntohl(payload[3]), ntohl(payload[4]));
+               break;
+            }
+            else if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
             {
                RECV(&isize, sizeof(isize))
                {
@@ -1709,47 +2425,58 @@ static bool netplay_get_cmd(netplay_t *netplay,
 
             }
 
-            /* Skip ahead if it's past where we are */
-            if (load_frame_count > netplay->run_frame_count ||
-                cmd == NETPLAY_CMD_RESET)
+            netplay_sync_loaded_state(netplay, load_ptr, load_frame_count,
+                  cmd == NETPLAY_CMD_RESET);
+            break;
+         }
+
+      case NETPLAY_CMD_SAVESTATE_CHUNK:
+         {
+            uint8_t *buffer = netplay_savestate_chunk_buffer(netplay);
+            struct compression_transcoder *ctrans = NULL;
+
+            if (cmd_size < sizeof(uint32_t) ||
+                cmd_size > NETPLAY_SAVESTATE_CHUNK_BOUND)
             {
-               /* This is squirrely: We need to assure that when we advance the
-                * frame in post_frame, THEN we're referring to the frame to
-                * load into. If we refer directly to read_ptr, then we'll end
-                * up never reading the input for read_frame_count itself, which
-                * will make the other side unhappy. */
-               netplay->run_ptr           = PREV_PTR(load_ptr);
-               netplay->run_frame_count   = load_frame_count - 1;
-               if (frame > netplay->self_frame_count)
-               {
-                  netplay->self_ptr         = netplay->run_ptr;
-                  netplay->self_frame_count = netplay->run_frame_count;
-               }
+               RARCH_ERR("CMD_SAVESTATE_CHUNK received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
             }
 
-            /* Don't expect earlier data from other clients */
-            for (client = 0; client < MAX_CLIENTS; client++)
-            {
-               if (!(netplay->connected_players & (1<<client)))
-                  continue;
+            if (!buffer)
+               return false;
 
-               if (frame > netplay->read_frame_count[client])
-               {
-                  netplay->read_ptr[client] = load_ptr;
-                  netplay->read_frame_count[client] = load_frame_count;
-               }
+            RECV(buffer, cmd_size)
+            {
+               RARCH_ERR("CMD_SAVESTATE_CHUNK failed to receive chunk.\n");
+               return netplay_cmd_nak(netplay, connection);
             }
 
-            /* Make sure our states are correct */
-            netplay->savestate_request_outstanding = false;
-            netplay->other_ptr                     = load_ptr;
-            netplay->other_frame_count             = load_frame_count;
+            /* Chunks of a transfer we gave up on */
+            if (!connection->savestate_recv)
+               break;
 
-#ifdef DEBUG_NETPLAY_STEPS
-            RARCH_LOG("[netplay] Loading state at %u\n", load_frame_count);
-            print_state(netplay);
-#endif
+            switch (connection->compression_supported)
+            {
+               case NETPLAY_COMPRESSION_ZLIB:
+                  ctrans = &netplay->compress_zlib;
+                  break;
+               default:
+                  ctrans = &netplay->compress_nil;
+            }
+
+            if (!netplay_savestate_decode_chunk(
+                     connection->savestate_recv_data, netplay->state_size,
+                     buffer, cmd_size, ctrans->decompression_backend,
+                     &ctrans->decompression_stream,
+                     buffer + NETPLAY_SAVESTATE_CHUNK_BOUND))
+            {
+               RARCH_ERR("CMD_SAVESTATE_CHUNK received an invalid chunk.\n");
+               netplay_savestate_recv_abandon(netplay, connection);
+               break;
+            }
 
+            if (--connection->savestate_recv_chunks == 0)
+               netplay_savestate_recv_finish(netplay, connection);
             break;
          }
 
@@ -1837,11 +2564,44 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP:
+         {
+            uint32_t payload[2];
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP from a client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(payload))
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+               return false;
+
+            /* If we can't, TCP carries on as usual */
+            if (netplay->udp)
+               netplay_udp_connect(netplay, connection, ntohl(payload[0]),
+                     (uint16_t)ntohl(payload[1]));
+            break;
+         }
+
       default:
          RARCH_ERR("%s.\n", msg_hash_to_str(MSG_UNKNOWN_NETPLAY_COMMAND_RECEIVED));
          return netplay_cmd_nak(netplay, connection);
    }
 
+   /* Input is counted separately, see netplay_udp_receive_entry */
+   if (cmd == NETPLAY_CMD_INPUT || cmd == NETPLAY_CMD_NOINPUT)
+      connection->input_bytes_recv += 2*sizeof(uint32_t) + cmd_size;
+
+   if (netplay->relay_connections_size)
+      netplay_relay_forward(netplay, connection, cmd);
+
    netplay_recv_flush(&connection->recv_packet_buffer);
    netplay->timeout_cnt = 0;
    if (had_input)
@@ -1856,6 +2616,504 @@ shrt:
 #undef RECV
 }
 
+/* Do two addresses belong to the same host? IPv4 addresses may show up
+ * mapped into IPv6 on one socket but not on the other. */
+static bool netplay_udp_same_host(const struct sockaddr_storage *a,
+      const struct sockaddr_storage *b)
+{
+   const struct sockaddr *sa = (const struct sockaddr*)a;
+   const struct sockaddr *sb = (const struct sockaddr*)b;
+   const uint8_t *ipa        = NULL;
+   const uint8_t *ipb        = NULL;
+   size_t lena               = 0;
+   size_t lenb               = 0;
+
+   if (sa->sa_family == AF_INET)
+   {
+      ipa  = (const uint8_t*)&((const struct sockaddr_in*)a)->sin_addr;
+      lena = 4;
+   }
+#ifdef AF_INET6
+   else if (sa->sa_family == AF_INET6)
+   {
+      ipa  = (const uint8_t*)&((const struct sockaddr_in6*)a)->sin6_addr;
+      lena = 16;
+   }
+#endif
+
+   if (sb->sa_family == AF_INET)
+   {
+      ipb  = (const uint8_t*)&((const struct sockaddr_in*)b)->sin_addr;
+      lenb = 4;
+   }
+#ifdef AF_INET6
+   else if (sb->sa_family == AF_INET6)
+   {
+      ipb  = (const uint8_t*)&((const struct sockaddr_in6*)b)->sin6_addr;
+      lenb = 16;
+   }
+#endif
+
+   if (!ipa || !ipb)
+      return false;
+
+   /* Strip the ::ffff: prefix of a mapped IPv4 address */
+   if (lena == 16 && lenb == 4)
+   {
+      ipa  += 12;
+      lena  = 4;
+   }
+   else if (lenb == 16 && lena == 4)
+   {
+      ipb  += 12;
+      lenb  = 4;
+   }
+
+   return lena == lenb && !memcmp(ipa, ipb, lena);
+}
+
+/**
+ * netplay_udp_input
+ *
+ * Act on an input command received over UDP. This does what
+ * netplay_get_cmd does for the same command over TCP, except that anything
+ * unexpected is simply ignored, as TCP will deliver the command again.
+ *
+ * Returns true if the input was new to us.
+ */
+static bool netplay_udp_input(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t cmd,
+      const uint32_t *payload, size_t words)
+{
+   uint32_t frame_num, client_num, devices, device, input_size;
+   struct delta_frame *dframe;
+
+   /* Slaves don't go by frame numbers, so they stick to TCP */
+   if (connection->mode != NETPLAY_CONNECTION_PLAYING)
+      return false;
+
+   if (cmd == NETPLAY_CMD_NOINPUT)
+   {
+      if (netplay->is_server || words != 1 ||
+            ntohl(payload[0]) != netplay->server_frame_count)
+         return false;
+
+      netplay->server_ptr = NEXT_PTR(netplay->server_ptr);
+      netplay->server_frame_count++;
+      return true;
+   }
+
+   if (cmd != NETPLAY_CMD_INPUT || words < 2)
+      return false;
+
+   frame_num  = ntohl(payload[0]);
+   client_num = ntohl(payload[1]) & 0xFFFF;
+
+   /* Ignore the claimed client #, must be this client */
+   if (netplay->is_server)
+      client_num = (uint32_t)(connection - netplay->connections + 1);
+
+   if (client_num >= MAX_CLIENTS ||
+         !(netplay->connected_players & (1<<client_num)))
+      return false;
+
+   devices    = netplay->client_devices[client_num];
+   input_size = netplay_expected_input_size(netplay, devices);
+   if (words != 2 + input_size)
+      return false;
+
+   /* Older frames we have already, and newer ones have to wait for the
+    * frames before them */
+   if (frame_num != netplay->read_frame_count[client_num])
+      return false;
+
+   dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+   if (!netplay_delta_frame_ready(netplay, dframe, frame_num))
+      return false;
+
+   /* Copy in the input */
+   payload += 2;
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      uint32_t dsize, di;
+      if (!(devices & (1<<device)))
+         continue;
+
+      dsize  = netplay_expected_input_size(netplay, 1 << device);
+      istate = netplay_input_state_for(&dframe->real_input[device],
+            client_num, dsize, false, false);
+      if (!istate)
+         return false;
+      for (di = 0; di < dsize; di++)
+         istate->data[di] = ntohl(*payload++);
+   }
+   dframe->have_real[client_num] = true;
+
+   netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+   netplay->read_frame_count[client_num]++;
+
+   /* Forward it on if it's past data */
+   if (netplay->is_server && dframe->frame <= netplay->self_frame_count)
+      send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+
+   /* If this was server data, advance our server pointer too */
+   if (!netplay->is_server && client_num == 0)
+   {
+      netplay->server_ptr         = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+
+   return true;
+}
+
+struct netplay_udp_receive_state
+{
+   netplay_t *netplay;
+   struct netplay_connection *connection;
+   bool had_input;
+};
+
+static void netplay_udp_receive_entry(void *data, uint32_t sync_offset,
+      const uint32_t *cmd, size_t words)
+{
+   struct netplay_udp_receive_state *state =
+      (struct netplay_udp_receive_state*)data;
+   struct netplay_connection *connection   = state->connection;
+
+   /* Only act on input that comes right where we are in the TCP stream:
+    * after every other command we've handled, and before any we haven't.
+    * Otherwise a mode change or savestate load could end up on the wrong
+    * side of it. */
+   if (connection->recv_packet_buffer.total - connection->input_bytes_recv
+         != sync_offset)
+      return;
+
+   if (netplay_udp_input(state->netplay, connection, ntohl(cmd[0]),
+            cmd + 2, words - 2))
+   {
+      connection->udp_inputs_early++;
+      state->had_input = true;
+   }
+}
+
+/**
+ * netplay_udp_receive
+ *
+ * Handle all UDP packets waiting for us.
+ */
+static void netplay_udp_receive(netplay_t *netplay, bool *had_input)
+{
+   uint32_t packet[NETPLAY_UDP_MAX_PACKET / sizeof(uint32_t)];
+
+   if (netplay->udp_fd < 0)
+      return;
+
+   for (;;)
+   {
+      struct netplay_udp_receive_state state;
+      struct sockaddr_storage addr;
+      struct netplay_connection *connection = NULL;
+      socklen_t addr_len                    = sizeof(addr);
+      ssize_t len                           = recvfrom(netplay->udp_fd,
+            (char*)packet, sizeof(packet), 0,
+            (struct sockaddr*)&addr, &addr_len);
+      uint32_t token;
+      size_t i;
+
+      if (len <= 0)
+         break;
+
+      token = netplay_udp_packet_token(packet, len);
+      if (!token)
+         continue;
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *conn = &netplay->connections[i];
+         if (conn->active && conn->udp_enabled && conn->udp.token == token)
+         {
+            connection = conn;
+            break;
+         }
+      }
+
+      if (!connection ||
+            connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+            !netplay_udp_same_host(&addr, &connection->udp_addr))
+         continue;
+
+      state.netplay    = netplay;
+      state.connection = connection;
+      state.had_input  = false;
+
+      if (!netplay_udp_parse(&connection->udp, packet, len,
+               netplay_udp_receive_entry, &state))
+         continue;
+
+      /* Reply to wherever the client's packets come from, which is what its
+       * NAT will let through */
+      if (netplay->is_server)
+      {
+         memcpy(&connection->udp_addr, &addr, addr_len);
+         connection->udp_addr_len = addr_len;
+         connection->udp_active   = true;
+      }
+
+      if (state.had_input)
+         *had_input = true;
+   }
+}
+
+/**
+ * netplay_relay_join_ptr
+ *
+ * Find the frame a spectator of ours can join the relayed stream at.
+ *
+ * Returns: the frame's index in the buffer, or -1 if there is none yet.
+ */
+ssize_t netplay_relay_join_ptr(netplay_t *netplay)
+{
+   ssize_t ptr;
+   struct netplay_connection *server;
+
+   if (netplay->self_mode != NETPLAY_CONNECTION_SPECTATING ||
+         netplay->connections_size == 0 || !netplay->state_size)
+      return -1;
+
+   /* Nothing must be on its way that the spectator would miss the start
+    * of */
+   server = &netplay->connections[0];
+   if (!server->active || server->mode < NETPLAY_CONNECTION_CONNECTED ||
+         server->savestate_recv)
+      return -1;
+
+   ptr = netplay_final_state_ptr(netplay);
+   if (ptr < 0 || netplay->buffer[ptr].frame < netplay->relay_sync_frame)
+      return -1;
+
+   return ptr;
+}
+
+/**
+ * netplay_relay_join
+ *
+ * Bring a spectator of ours up to date: send it our state at the given frame
+ * and all the input we've read since. From then on it gets the server's
+ * commands as we do.
+ */
+bool netplay_relay_join(netplay_t *netplay,
+   struct netplay_connection *connection, size_t ptr)
+{
+   uint32_t client_num;
+   netplay_savestate_source_t *src;
+   struct delta_frame *dframe = &netplay->buffer[ptr];
+   uint32_t frame             = dframe->frame;
+
+   /* The state, in full: it has nothing to be a delta against */
+   src = netplay_savestate_source_new(dframe->state, NULL,
+         netplay->state_size);
+   if (!src)
+      return false;
+   src->frame = frame;
+   if (!netplay_cmd_load_savestate_delta(netplay, connection, src))
+   {
+      netplay_savestate_source_free(src);
+      return false;
+   }
+   netplay_savestate_source_free(src);
+
+   /* Then the input since */
+   for (client_num = 0; client_num < MAX_CLIENTS; client_num++)
+   {
+      size_t iptr        = ptr;
+      uint32_t iframe;
+
+      if (!(netplay->connected_players & (1<<client_num)))
+         continue;
+
+      for (iframe = frame; iframe < netplay->read_frame_count[client_num];
+            iframe++, iptr = NEXT_PTR(iptr))
+      {
+         struct delta_frame *idframe = &netplay->buffer[iptr];
+         if (!idframe->used || idframe->frame != iframe ||
+               !idframe->have_real[client_num])
+         {
+            RARCH_ERR("[netplay] Lost input to catch a spectator up with.\n");
+            return false;
+         }
+         if (!send_input_frame(netplay, idframe, connection, NULL,
+                  client_num, false))
+            return false;
+      }
+   }
+
+   /* And where the server is, if it isn't playing */
+   if (!(netplay->connected_players & 1))
+   {
+      uint32_t noinput[3];
+      noinput[0] = htonl(NETPLAY_CMD_NOINPUT);
+      noinput[1] = htonl(sizeof(uint32_t));
+      for (; frame < netplay->server_frame_count; frame++)
+      {
+         noinput[2] = htonl(frame);
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+               noinput, sizeof(noinput)))
+            return false;
+      }
+   }
+
+   return netplay_send_flush(&connection->send_packet_buffer,
+         connection->fd, false);
+}
+
+#define RECV(buf, sz) \
+recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), \
+(sz), false); \
+if (recvd >= 0 && recvd < (ssize_t) (sz)) goto shrt; \
+else if (recvd < 0)
+
+/**
+ * netplay_relay_get_cmd
+ *
+ * Read a command from a spectator of ours. There's little they can ask of
+ * us, the stream is the server's.
+ */
+static bool netplay_relay_get_cmd(netplay_t *netplay,
+   struct netplay_connection *connection, bool *had_input)
+{
+   uint32_t cmd;
+   uint32_t cmd_size;
+   ssize_t recvd;
+
+   if (connection->mode < NETPLAY_CONNECTION_CONNECTED)
+      return netplay_handshake(netplay, connection, had_input);
+
+   RECV(&cmd, sizeof(cmd))
+      return false;
+
+   cmd      = ntohl(cmd);
+
+   RECV(&cmd_size, sizeof(cmd_size))
+      return false;
+
+   cmd_size = ntohl(cmd_size);
+
+   switch (cmd)
+   {
+      case NETPLAY_CMD_NAK:
+      case NETPLAY_CMD_DISCONNECT:
+         return false;
+
+      case NETPLAY_CMD_INPUT:
+      case NETPLAY_CMD_NOINPUT:
+         RARCH_ERR("Netplay input from a relayed spectator.\n");
+         return netplay_cmd_nak(netplay, connection);
+
+      case NETPLAY_CMD_PLAY:
+         {
+            uint32_t payload[1];
+            payload[0] = htonl(NETPLAY_CMD_MODE_REFUSED_REASON_OTHER);
+            netplay_send_raw_cmd(netplay, connection,
+                  NETPLAY_CMD_MODE_REFUSED, payload, sizeof(uint32_t));
+         }
+         /* Fallthrough */
+
+      default:
+         {
+            /* Nothing else matters to us, so skip the payload */
+            uint32_t buf[16];
+            while (cmd_size)
+            {
+               size_t sz = (cmd_size > sizeof(buf)) ? sizeof(buf) : cmd_size;
+               RECV(buf, sz)
+                  return false;
+               cmd_size -= (uint32_t)sz;
+            }
+
+            /* Whatever state they have, the server is the one to fix it */
+            if (cmd == NETPLAY_CMD_REQUEST_SAVESTATE)
+               netplay_cmd_request_savestate(netplay);
+            break;
+         }
+   }
+
+   netplay_recv_flush(&connection->recv_packet_buffer);
+   if (had_input)
+      *had_input = true;
+   return true;
+
+shrt:
+   /* No more data, reset and try again */
+   netplay_recv_reset(&connection->recv_packet_buffer);
+   return true;
+}
+
+#undef RECV
+
+/**
+ * netplay_relay_poll
+ *
+ * Take in new spectators of ours, bring them up to date and keep them
+ * going.
+ */
+static void netplay_relay_poll(netplay_t *netplay)
+{
+   size_t i;
+   bool had_input;
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_SPECTATING)
+   {
+      struct netplay_connection *connection = netplay_accept_connection(
+            netplay, netplay->relay_fd,
+            &netplay->relay_connections, &netplay->relay_connections_size);
+
+      if (connection)
+      {
+         connection->relayed = true;
+         if (!netplay_handshake_init_send(netplay, connection))
+            netplay_hangup(netplay, connection);
+      }
+   }
+
+   for (i = 0; i < netplay->relay_connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->relay_connections[i];
+
+      if (!connection->active)
+         continue;
+
+      /* There's nothing to relay unless we're spectating */
+      if (netplay->self_mode != NETPLAY_CONNECTION_SPECTATING)
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      if (connection->savestate_send &&
+            !netplay_send_savestate_chunks(netplay, connection))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      do
+      {
+         had_input = false;
+         if (!netplay_relay_get_cmd(netplay, connection, &had_input))
+         {
+            netplay_hangup(netplay, connection);
+            break;
+         }
+      } while (had_input && connection->active);
+
+      if (connection->active &&
+            !netplay_send_flush(&connection->send_packet_buffer,
+               connection->fd, false))
+         netplay_hangup(netplay, connection);
+   }
+}
+
 /**
  * netplay_poll_net_input
  *
@@ -1877,14 +3135,29 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
    if (max_fd == 0)
       return 0;
 
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
+
    netplay->timeout_cnt = 0;
 
+   /* Keep any savestate transfers moving */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->savestate_send &&
+            !netplay_send_savestate_chunks(netplay, connection))
+         netplay_hangup(netplay, connection);
+   }
+
    do
    {
       had_input = false;
 
       netplay->timeout_cnt++;
 
+      /* Input that came in over UDP first */
+      netplay_udp_receive(netplay, &had_input);
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
@@ -1915,6 +3188,8 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
                if (connection->active)
                   FD_SET(connection->fd, &fds);
             }
+            if (netplay->udp_fd >= 0)
+               FD_SET(netplay->udp_fd, &fds);
 
             if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
                return -1;
@@ -1928,6 +3203,9 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
       }
    } while (had_input || block);
 
+   if (netplay->relay_fd >= 0)
+      netplay_relay_poll(netplay);
+
    return 0;
 }
 
@@ -19,6 +19,9 @@
 #define __RARCH_NETPLAY_PRIVATE_H
 
 #include "netplay.h"
+#include "netplay_udp.h"
+#include "netplay_savestate.h"
+#include "netplay_broadcast.h"
 
 #include <net/net_compat.h>
 #include <net/net_natt.h>
@@ -57,6 +60,11 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Savestate transfers queue no more than this much unsent data, and spend
+ * no more than this many microseconds per frame encoding it */
+#define NETPLAY_SAVESTATE_QUEUE        (256 * 1024)
+#define NETPLAY_SAVESTATE_SEND_USEC    4000
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
@@ -95,6 +103,13 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_COMPRESSION_SUPPORTED 0
 #endif
 
+/* Set alongside the compression protocols in the header by peers that can
+ * take input over UDP. Older peers ignore it. */
+#define NETPLAY_HEADER_UDP (1U<<31)
+
+/* Likewise, by peers that can receive savestates as chunked deltas */
+#define NETPLAY_HEADER_DELTA (1U<<30)
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -166,6 +181,14 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Announce a savestate for the client to load, sent as a series of
+    * SAVESTATE_CHUNK commands that follow it, interleaved with other
+    * commands */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
+   /* A piece of the savestate announced by LOAD_SAVESTATE_DELTA */
+   NETPLAY_CMD_SAVESTATE_CHUNK = 0x0049,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -175,7 +198,11 @@ enum netplay_cmd
    /* CMD_CFG streamlines sending multiple
       configurations. This acknowledges
       each one individually */
-   NETPLAY_CMD_CFG_ACK        = 0x0062
+   NETPLAY_CMD_CFG_ACK        = 0x0062,
+
+   /* Tells the client where to send its UDP input packets (server only,
+    * and only to clients that announced UDP support in their header) */
+   NETPLAY_CMD_UDP            = 0x0063
 };
 
 #define NETPLAY_CMD_SYNC_BIT_PAUSED    (1U<<31)
@@ -322,6 +349,10 @@ struct socket_buffer
    size_t bufsz;
    size_t start, end;
    size_t read;
+
+   /* Bytes queued for sending or consumed by the reader over the
+    * lifetime of the connection. Wraps. */
+   uint32_t total;
 };
 
 /* Each connection gets a connection struct */
@@ -369,6 +400,46 @@ struct netplay_connection
    /* For the server: When was the last time we requested this client to stall?
     * For the client: How many frames of stall do we have left? */
    uint32_t stall_frame;
+
+   /* Bytes of input commands sent and received over TCP. Subtracted from
+    * the socket buffer totals, they place UDP input relative to the other
+    * commands in the stream. Counted whether or not UDP is in use. */
+   uint32_t input_bytes_sent, input_bytes_recv;
+
+   /* Have we agreed to use the UDP input channel, and do we know where to
+    * send packets yet? */
+   bool udp_enabled, udp_active;
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_len;
+
+   /* Input commands that were acted upon from UDP, before TCP delivered
+    * them */
+   uint32_t udp_inputs_early;
+
+   netplay_udp_t udp;
+
+   /* Does the peer take savestates as chunked deltas, and must the next one
+    * we send it be in full anyway (because it has no state in common with
+    * us)? */
+   bool savestate_delta, savestate_full;
+
+   /* Savestate we're sending, and how many of its chunks have been sent */
+   netplay_savestate_source_t *savestate_send;
+   uint32_t savestate_send_chunk;
+
+   /* Savestate we're receiving. It's loaded at savestate_recv_frame once
+    * all of its chunks are in; until then we read no further than that
+    * frame. */
+   bool savestate_recv;
+   uint32_t savestate_recv_frame;
+   size_t savestate_recv_ptr;
+   uint32_t savestate_recv_chunks;
+   uint32_t savestate_recv_crc;
+   uint8_t *savestate_recv_data;
+
+   /* Is this a spectator of ours, while we relay the server's stream
+    * (client only)? */
+   bool relayed;
 };
 
 /* Compression transcoder */
@@ -444,6 +515,28 @@ struct netplay
    /* TCP port (only set if serving) */
    uint16_t tcp_port;
 
+   /* Should we offer to send input over UDP as well? */
+   bool udp;
+
+   /* UDP socket for input (server: bound to tcp_port; client: opened once
+    * the server tells us where to send), or -1 */
+   int udp_fd;
+
+   /* TCP connection for spectators we relay the stream to (client only), or
+    * -1 */
+   int relay_fd;
+
+   /* Our spectators, if we relay */
+   struct netplay_connection *relay_connections;
+   size_t relay_connections_size;
+
+   /* The newest frame the server has changed the shared state at (by a load,
+    * reset or mode change). Spectators can only join us at or after it. */
+   uint32_t relay_sync_frame;
+
+   /* This frame's input, encoded once for all connections (server only) */
+   netplay_broadcast_t broadcast;
+
    /* NAT traversal info (if NAT traversal is used and serving) */
    bool nat_traversal, nat_traversal_task_oustanding;
    struct natt_status nat_traversal_state;
@@ -459,6 +552,11 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* Scratch space for encoding and decoding savestate chunks, and the
+    * stream that compresses them */
+   uint8_t *savestate_chunk_buffer;
+   void *savestate_stream;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -612,6 +710,13 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
  */
 bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block);
 
+/**
+ * netplay_send_pending
+ *
+ * Returns how much queued data hasn't been sent yet.
+ */
+size_t netplay_send_pending(struct socket_buffer *sbuf);
+
 /**
  * netplay_recv
  *
@@ -630,6 +735,18 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
  */
 void netplay_recv_reset(struct socket_buffer *sbuf);
 
+/**
+ * netplay_recv_unflushed
+ *
+ * Get at the data read since the last flush. It may wrap around the end of
+ * the buffer, in which case it continues at *b.
+ *
+ * Returns the total length.
+ */
+size_t netplay_recv_unflushed(struct socket_buffer *sbuf,
+   const unsigned char **a, size_t *a_len,
+   const unsigned char **b, size_t *b_len);
+
 /**
  * netplay_recv_flush
  *
@@ -777,6 +894,9 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp                  : If true, offer to send input over UDP as well.
+ * @relay_port           : If nonzero, relay the stream to spectators of our
+ *                         own on this port (client only).
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -787,8 +907,8 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks);
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp,
+   uint16_t relay_port, const char *nick, uint64_t quirks);
 
 /**
  * netplay_free
@@ -827,6 +947,14 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_send_cur_input_all
+ *
+ * Send the current input frame to every connection. As a server, the input
+ * is encoded once and the same bytes go to everyone.
+ */
+void netplay_send_cur_input_all(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -862,6 +990,22 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 bool netplay_cmd_request_savestate(netplay_t *netplay);
 
+/**
+ * netplay_cmd_load_savestate_delta
+ *
+ * Start sending a savestate to a peer that takes them as chunked deltas.
+ * The chunks follow over the next frames.
+ */
+bool netplay_cmd_load_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection, netplay_savestate_source_t *src);
+
+/**
+ * netplay_savestate_transfers_free
+ *
+ * Abandon any savestate transfers in progress on this connection.
+ */
+void netplay_savestate_transfers_free(struct netplay_connection *connection);
+
 /**
  * netplay_cmd_mode
  *
@@ -887,6 +1031,15 @@ bool netplay_cmd_stall(netplay_t *netplay,
  */
 int netplay_poll_net_input(netplay_t *netplay, bool block);
 
+/**
+ * netplay_udp_offer
+ *
+ * Offer the UDP input channel to a newly connected client that supports it
+ * (server only).
+ */
+bool netplay_udp_offer(netplay_t *netplay,
+   struct netplay_connection *connection);
+
 /**
  * netplay_handle_slaves
  *
@@ -908,6 +1061,25 @@ void netplay_announce_nat_traversal(netplay_t *netplay);
  */
 void netplay_init_nat_traversal(netplay_t *netplay);
 
+/**
+ * netplay_relay_join_ptr
+ *
+ * Find the frame a spectator of ours can join the relayed stream at.
+ *
+ * Returns: the frame's index in the buffer, or -1 if there is none yet.
+ */
+ssize_t netplay_relay_join_ptr(netplay_t *netplay);
+
+/**
+ * netplay_relay_join
+ *
+ * Bring a spectator of ours up to date: send it our state at the given frame
+ * and all the input we've read since. From then on it gets the server's
+ * commands as we do.
+ */
+bool netplay_relay_join(netplay_t *netplay,
+   struct netplay_connection *connection, size_t ptr);
+
 /***************************************************************
  * NETPLAY-KEYBOARD.C
  **************************************************************/
@@ -946,6 +1118,17 @@ void netplay_key_hton_init(void);
  */
 void netplay_update_unread_ptr(netplay_t *netplay);
 
+/**
+ * netplay_final_state_ptr
+ * @netplay              : pointer to netplay object
+ *
+ * Find the newest frame whose state is final: all input before it is known
+ * and has been replayed, so every peer in sync holds the same state for it.
+ *
+ * Returns: the frame's index in the buffer, or -1 if there is none.
+ */
+ssize_t netplay_final_state_ptr(netplay_t *netplay);
+
 /**
  * netplay_resolve_input
  * @netplay             : pointer to netplay object
@@ -967,6 +1150,22 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim);
  */
 bool netplay_sync_pre_frame(netplay_t *netplay);
 
+/**
+ * netplay_accept_connection
+ * @netplay              : pointer to netplay object
+ * @listen_fd            : socket to accept a connection on
+ * @connections          : connection list to put it in
+ * @connections_size     : size of the list
+ *
+ * Accept a waiting connection, if there is one, into a free slot of the
+ * given list, growing the list if need be.
+ *
+ * Returns: the new connection, ready for the handshake, or NULL.
+ */
+struct netplay_connection *netplay_accept_connection(netplay_t *netplay,
+   int listen_fd, struct netplay_connection **connections,
+   size_t *connections_size);
+
 /**
  * netplay_sync_post_frame
  * @netplay              : pointer to netplay object
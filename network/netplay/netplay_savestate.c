@@ -0,0 +1,252 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <encodings/crc32.h>
+#include <net/net_compat.h>
+
+#include "netplay_savestate.h"
+
+static size_t savestate_chunk_length(size_t size, uint32_t chunk)
+{
+   size_t offset = (size_t)chunk * NETPLAY_SAVESTATE_CHUNK_SIZE;
+   size_t len    = size - offset;
+   return (len > NETPLAY_SAVESTATE_CHUNK_SIZE)
+      ? NETPLAY_SAVESTATE_CHUNK_SIZE : len;
+}
+
+/* XOR src into dst, a word at a time where possible. Returns whether
+ * anything in the result is nonzero. */
+static bool savestate_xor(uint8_t *dst, const uint8_t *src, size_t len)
+{
+   size_t i       = 0;
+   size_t nonzero = 0;
+
+   if ((((uintptr_t)dst | (uintptr_t)src) & (sizeof(size_t) - 1)) == 0)
+   {
+      size_t *dw       = (size_t*)dst;
+      const size_t *sw = (const size_t*)src;
+      size_t words     = len / sizeof(size_t);
+
+      for (i = 0; i < words; i++)
+         nonzero |= (dw[i] ^= sw[i]);
+      i *= sizeof(size_t);
+   }
+
+   for (; i < len; i++)
+      nonzero |= (dst[i] ^= src[i]);
+
+   return nonzero != 0;
+}
+
+static bool savestate_is_zero(const uint8_t *data, size_t len)
+{
+   size_t i       = 0;
+   size_t nonzero = 0;
+
+   if (((uintptr_t)data & (sizeof(size_t) - 1)) == 0)
+   {
+      const size_t *w = (const size_t*)data;
+      size_t words    = len / sizeof(size_t);
+
+      for (i = 0; i < words; i++)
+         nonzero |= w[i];
+      i *= sizeof(size_t);
+   }
+
+   for (; i < len; i++)
+      nonzero |= data[i];
+
+   return nonzero == 0;
+}
+
+static void *savestate_stream_new(const struct trans_stream_backend *backend)
+{
+   void *stream = backend->stream_new();
+
+   /* Decompressors ignore this */
+   if (stream && backend->define)
+      backend->define(stream, "level", NETPLAY_SAVESTATE_LEVEL);
+
+   return stream;
+}
+
+/* Run a whole buffer through a transcoder. A stream that fails midway is
+ * left in an unknown state, so it's replaced. */
+static bool savestate_transcode(const struct trans_stream_backend *backend,
+      void **stream, const uint8_t *in, size_t in_size,
+      uint8_t *out, size_t out_size, uint32_t *written)
+{
+   uint32_t rd                   = 0;
+   uint32_t wn                   = 0;
+   enum trans_stream_error error = TRANS_STREAM_ERROR_NONE;
+
+   if (!*stream)
+   {
+      *stream = savestate_stream_new(backend);
+      if (!*stream)
+         return false;
+   }
+
+   backend->set_in(*stream, in, (uint32_t)in_size);
+   backend->set_out(*stream, out, (uint32_t)out_size);
+   if (backend->trans(*stream, true, &rd, &wn, &error) &&
+         error == TRANS_STREAM_ERROR_NONE && rd == in_size)
+   {
+      *written = wn;
+      return true;
+   }
+
+   backend->stream_free(*stream);
+   *stream = savestate_stream_new(backend);
+   return false;
+}
+
+/**
+ * netplay_savestate_source_new
+ *
+ * Prepare a state for sending as a delta against base, or in full if base
+ * is NULL. The caller fills in the frame numbers.
+ *
+ * Returns the new source with one reference, or NULL on failure.
+ */
+netplay_savestate_source_t *netplay_savestate_source_new(const void *state,
+      const void *base, size_t size)
+{
+   uint32_t chunk;
+   uint32_t chunks                 = (uint32_t)
+      ((size + NETPLAY_SAVESTATE_CHUNK_SIZE - 1) / NETPLAY_SAVESTATE_CHUNK_SIZE);
+   netplay_savestate_source_t *src = (netplay_savestate_source_t*)
+      calloc(1, sizeof(*src));
+
+   if (!src)
+      return NULL;
+
+   src->data   = (uint8_t*)malloc(size);
+   src->chunks = (uint32_t*)malloc((chunks ? chunks : 1) * sizeof(uint32_t));
+   if (!src->data || !src->chunks)
+   {
+      free(src->data);
+      free(src->chunks);
+      free(src);
+      return NULL;
+   }
+
+   src->refs       = 1;
+   src->size       = size;
+   src->base_frame = NETPLAY_SAVESTATE_NO_BASE;
+   src->crc        = encoding_crc32(0L, (const unsigned char*)state, size);
+   memcpy(src->data, state, size);
+
+   if (base)
+      src->base_crc = encoding_crc32(0L, (const unsigned char*)base, size);
+
+   /* Only chunks with any difference need to go over the wire */
+   for (chunk = 0; chunk < chunks; chunk++)
+   {
+      size_t offset = (size_t)chunk * NETPLAY_SAVESTATE_CHUNK_SIZE;
+      size_t len    = savestate_chunk_length(size, chunk);
+      bool changed  = base
+         ? savestate_xor(src->data + offset, (const uint8_t*)base + offset, len)
+         : !savestate_is_zero(src->data + offset, len);
+
+      if (changed)
+         src->chunks[src->chunk_count++] = chunk;
+   }
+
+   return src;
+}
+
+/**
+ * netplay_savestate_source_free
+ *
+ * Drop a reference to a source, freeing it when none remain.
+ */
+void netplay_savestate_source_free(netplay_savestate_source_t *src)
+{
+   if (!src || --src->refs)
+      return;
+   free(src->data);
+   free(src->chunks);
+   free(src);
+}
+
+/**
+ * netplay_savestate_encode_chunk
+ *
+ * Encode the index'th chunk to be sent: its offset in network byte order
+ * followed by the compressed data. If *stream is NULL, a stream set up for
+ * chunks is created there.
+ *
+ * Returns the encoded size, or 0 on failure.
+ */
+size_t netplay_savestate_encode_chunk(const netplay_savestate_source_t *src,
+      uint32_t index, const struct trans_stream_backend *backend,
+      void **stream, uint8_t *out, size_t out_size)
+{
+   uint32_t offset, wn;
+   uint32_t chunk;
+
+   if (index >= src->chunk_count || out_size < sizeof(uint32_t))
+      return 0;
+
+   chunk  = src->chunks[index];
+   offset = htonl(chunk * NETPLAY_SAVESTATE_CHUNK_SIZE);
+   memcpy(out, &offset, sizeof(offset));
+
+   if (!savestate_transcode(backend, stream,
+            src->data + (size_t)chunk * NETPLAY_SAVESTATE_CHUNK_SIZE,
+            savestate_chunk_length(src->size, chunk),
+            out + sizeof(uint32_t), out_size - sizeof(uint32_t), &wn))
+      return 0;
+
+   return sizeof(uint32_t) + wn;
+}
+
+/**
+ * netplay_savestate_decode_chunk
+ *
+ * Decode an encoded chunk and apply it to state, which holds the base state
+ * (or zeroes for a transfer without a base). scratch must have room for
+ * NETPLAY_SAVESTATE_CHUNK_SIZE bytes.
+ *
+ * Returns false if the chunk is malformed.
+ */
+bool netplay_savestate_decode_chunk(uint8_t *state, size_t size,
+      const uint8_t *in, size_t in_size,
+      const struct trans_stream_backend *backend, void **stream,
+      uint8_t *scratch)
+{
+   uint32_t offset, wn;
+   size_t len;
+
+   if (in_size < sizeof(uint32_t))
+      return false;
+
+   memcpy(&offset, in, sizeof(offset));
+   offset = ntohl(offset);
+   if (offset % NETPLAY_SAVESTATE_CHUNK_SIZE || offset >= size)
+      return false;
+
+   len = savestate_chunk_length(size, offset / NETPLAY_SAVESTATE_CHUNK_SIZE);
+   if (!savestate_transcode(backend, stream, in + sizeof(uint32_t),
+            in_size - sizeof(uint32_t), scratch, len, &wn) || wn != len)
+      return false;
+
+   savestate_xor(state + offset, scratch, len);
+   return true;
+}
@@ -0,0 +1,113 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_SAVESTATE_H
+#define __RARCH_NETPLAY_SAVESTATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <streams/trans_stream.h>
+
+RETRO_BEGIN_DECLS
+
+/* Savestates are transferred in chunks of this many bytes of state, each
+ * compressed on its own */
+#define NETPLAY_SAVESTATE_CHUNK_SIZE  (64 * 1024)
+
+/* Largest encoded chunk: the offset word plus the compressed data, which
+ * may be slightly bigger than the input if it doesn't compress */
+#define NETPLAY_SAVESTATE_CHUNK_BOUND (sizeof(uint32_t) + \
+      NETPLAY_SAVESTATE_CHUNK_SIZE + NETPLAY_SAVESTATE_CHUNK_SIZE / 64 + 64)
+
+/* Compression level of chunks. Cheap levels cost little in size, but are
+ * many times faster on the noisy data that changes between states. */
+#define NETPLAY_SAVESTATE_LEVEL       1
+
+/* Base frame of a transfer that doesn't depend on any earlier state */
+#define NETPLAY_SAVESTATE_NO_BASE     0xFFFFFFFF
+
+/* A savestate being sent, shared by every connection it goes to. The data
+ * is the state XOR the base state both sides share, so anything that didn't
+ * change is zero; with no base, it's the state itself. Chunks that are all
+ * zero aren't sent at all. */
+typedef struct netplay_savestate_source
+{
+   unsigned refs;
+
+   uint8_t *data;
+   size_t size;
+
+   /* Indexes of the chunks that need to be sent */
+   uint32_t *chunks;
+   uint32_t chunk_count;
+
+   /* Describes the transfer to the receiver */
+   uint32_t frame;
+   uint32_t base_frame;
+   uint32_t base_crc;
+   uint32_t crc;
+} netplay_savestate_source_t;
+
+/**
+ * netplay_savestate_source_new
+ *
+ * Prepare a state for sending as a delta against base, or in full if base
+ * is NULL. The caller fills in the frame numbers.
+ *
+ * Returns the new source with one reference, or NULL on failure.
+ */
+netplay_savestate_source_t *netplay_savestate_source_new(const void *state,
+      const void *base, size_t size);
+
+/**
+ * netplay_savestate_source_free
+ *
+ * Drop a reference to a source, freeing it when none remain.
+ */
+void netplay_savestate_source_free(netplay_savestate_source_t *src);
+
+/**
+ * netplay_savestate_encode_chunk
+ *
+ * Encode the index'th chunk to be sent: its offset in network byte order
+ * followed by the compressed data. If *stream is NULL, a stream set up for
+ * chunks is created there.
+ *
+ * Returns the encoded size, or 0 on failure.
+ */
+size_t netplay_savestate_encode_chunk(const netplay_savestate_source_t *src,
+      uint32_t index, const struct trans_stream_backend *backend,
+      void **stream, uint8_t *out, size_t out_size);
+
+/**
+ * netplay_savestate_decode_chunk
+ *
+ * Decode an encoded chunk and apply it to state, which holds the base state
+ * (or zeroes for a transfer without a base). scratch must have room for
+ * NETPLAY_SAVESTATE_CHUNK_SIZE bytes.
+ *
+ * Returns false if the chunk is malformed.
+ */
+bool netplay_savestate_decode_chunk(uint8_t *state, size_t size,
+      const uint8_t *in, size_t in_size,
+      const struct trans_stream_backend *backend, void **stream,
+      uint8_t *scratch);
+
+RETRO_END_DECLS
+
+#endif
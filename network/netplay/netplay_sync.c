@@ -44,6 +44,8 @@ struct vote_count
  */
 void netplay_update_unread_ptr(netplay_t *netplay)
 {
+   size_t i;
+
    if (netplay->is_server && netplay->connected_players<=1)
    {
       /* Nothing at all to read! */
@@ -89,6 +91,19 @@ void netplay_update_unread_ptr(netplay_t *netplay)
          netplay->unread_frame_count = netplay->self_frame_count;
       }
    }
+
+   /* A savestate still being received is loaded at its frame, so we can't
+    * consider anything after it read */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->savestate_recv &&
+            connection->savestate_recv_frame < netplay->unread_frame_count)
+      {
+         netplay->unread_ptr         = connection->savestate_recv_ptr;
+         netplay->unread_frame_count = connection->savestate_recv_frame;
+      }
+   }
 }
 
 /**
@@ -334,6 +349,35 @@ static void netplay_merge_analog(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_final_state_ptr
+ * @netplay              : pointer to netplay object
+ *
+ * Find the newest frame whose state is final: all input before it is known
+ * and has been replayed, so every peer in sync holds the same state for it.
+ *
+ * Returns: the frame's index in the buffer, or -1 if there is none.
+ */
+ssize_t netplay_final_state_ptr(netplay_t *netplay)
+{
+   size_t ptr     = netplay->other_ptr;
+   uint32_t frame = netplay->other_frame_count;
+
+   /* The state of the frame we're about to run hasn't been taken yet */
+   if (frame >= netplay->run_frame_count)
+   {
+      if (frame == 0)
+         return -1;
+      ptr = PREV_PTR(ptr);
+      frame--;
+   }
+
+   if (!netplay->buffer[ptr].used || netplay->buffer[ptr].frame != frame)
+      return -1;
+
+   return (ssize_t)ptr;
+}
+
 /**
  * netplay_resolve_input
  * @netplay             : pointer to netplay object
@@ -544,6 +588,142 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_accept_connection
+ * @netplay              : pointer to netplay object
+ * @listen_fd            : socket to accept a connection on
+ * @connections          : connection list to put it in
+ * @connections_size     : size of the list
+ *
+ * Accept a waiting connection, if there is one, into a free slot of the
+ * given list, growing the list if need be.
+ *
+ * Returns: the new connection, ready for the handshake, or NULL.
+ */
+struct netplay_connection *netplay_accept_connection(netplay_t *netplay,
+      int listen_fd, struct netplay_connection **connections,
+      size_t *connections_size)
+{
+   fd_set fds;
+   struct timeval tmp_tv = {0};
+   int new_fd;
+   struct sockaddr_storage their_addr;
+   socklen_t addr_size;
+   struct netplay_connection *connection;
+   size_t connection_num;
+
+   /* Check for a connection */
+   FD_ZERO(&fds);
+   FD_SET(listen_fd, &fds);
+   if (socket_select(listen_fd + 1,
+            &fds, NULL, NULL, &tmp_tv) <= 0 ||
+       !FD_ISSET(listen_fd, &fds))
+      return NULL;
+
+   addr_size = sizeof(their_addr);
+   new_fd = accept(listen_fd,
+         (struct sockaddr*)&their_addr, &addr_size);
+
+   if (new_fd < 0)
+   {
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
+      return NULL;
+   }
+
+   /* Set the socket nonblocking */
+   if (!socket_nonblock(new_fd))
+   {
+      /* Catastrophe! */
+      socket_close(new_fd);
+      return NULL;
+   }
+
+#if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
+   {
+      int flag = 1;
+      if (setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY,
+#ifdef _WIN32
+         (const char*)
+#else
+         (const void*)
+#endif
+         &flag,
+         sizeof(int)) < 0)
+         RARCH_WARN("Could not set netplay TCP socket to nodelay. Expect jitter.\n");
+   }
+#endif
+
+#if defined(F_SETFD) && defined(FD_CLOEXEC)
+   /* Don't let any inherited processes keep open our port */
+   if (fcntl(new_fd, F_SETFD, FD_CLOEXEC) < 0)
+      RARCH_WARN("Cannot set Netplay port to close-on-exec. It may fail to reopen if the client disconnects.\n");
+#endif
+
+   /* Allocate a connection */
+   for (connection_num = 0; connection_num < *connections_size; connection_num++)
+      if (!(*connections)[connection_num].active &&
+            (*connections)[connection_num].mode != NETPLAY_CONNECTION_DELAYED_DISCONNECT)
+         break;
+   if (connection_num == *connections_size)
+   {
+      if (connection_num == 0)
+      {
+         *connections = (struct netplay_connection*)
+            malloc(sizeof(struct netplay_connection));
+
+         if (!*connections)
+         {
+            socket_close(new_fd);
+            return NULL;
+         }
+         *connections_size = 1;
+
+      }
+      else
+      {
+         size_t new_connections_size = *connections_size * 2;
+         struct netplay_connection
+            *new_connections         = (struct netplay_connection*)
+
+            realloc(*connections,
+               new_connections_size*sizeof(struct netplay_connection));
+
+         if (!new_connections)
+         {
+            socket_close(new_fd);
+            return NULL;
+         }
+
+         memset(new_connections + *connections_size, 0,
+            *connections_size * sizeof(struct netplay_connection));
+         *connections = new_connections;
+         *connections_size = new_connections_size;
+
+      }
+   }
+   connection         = &(*connections)[connection_num];
+
+   /* Set it up */
+   memset(connection, 0, sizeof(*connection));
+   connection->active = true;
+   connection->fd     = new_fd;
+   connection->mode   = NETPLAY_CONNECTION_INIT;
+
+   if (!netplay_init_socket_buffer(&connection->send_packet_buffer,
+         netplay->packet_buffer_size) ||
+       !netplay_init_socket_buffer(&connection->recv_packet_buffer,
+         netplay->packet_buffer_size))
+   {
+      if (connection->send_packet_buffer.data)
+         netplay_deinit_socket_buffer(&connection->send_packet_buffer);
+      connection->active = false;
+      socket_close(new_fd);
+      return NULL;
+   }
+
+   return connection;
+}
+
 /**
  * netplay_sync_pre_frame
  * @netplay              : pointer to netplay object
@@ -609,128 +789,14 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
 
    if (netplay->is_server)
    {
-      fd_set fds;
-      struct timeval tmp_tv = {0};
-      int new_fd;
-      struct sockaddr_storage their_addr;
-      socklen_t addr_size;
-      struct netplay_connection *connection;
-      size_t connection_num;
-
-      /* Check for a connection */
-      FD_ZERO(&fds);
-      FD_SET(netplay->listen_fd, &fds);
-      if (socket_select(netplay->listen_fd + 1,
-               &fds, NULL, NULL, &tmp_tv) > 0 &&
-          FD_ISSET(netplay->listen_fd, &fds))
-      {
-         addr_size = sizeof(their_addr);
-         new_fd = accept(netplay->listen_fd,
-               (struct sockaddr*)&their_addr, &addr_size);
-
-         if (new_fd < 0)
-         {
-            RARCH_ERR("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
-            goto process;
-         }
-
-         /* Set the socket nonblocking */
-         if (!socket_nonblock(new_fd))
-         {
-            /* Catastrophe! */
-            socket_close(new_fd);
-            goto process;
-         }
-
-#if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
-         {
-            int flag = 1;
-            if (setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY,
-#ifdef _WIN32
-               (const char*)
-#else
-               (const void*)
-#endif
-               &flag,
-               sizeof(int)) < 0)
-               RARCH_WARN("Could not set netplay TCP socket to nodelay. Expect jitter.\n");
-         }
-#endif
-
-#if defined(F_SETFD) && defined(FD_CLOEXEC)
-         /* Don't let any inherited processes keep open our port */
-         if (fcntl(new_fd, F_SETFD, FD_CLOEXEC) < 0)
-            RARCH_WARN("Cannot set Netplay port to close-on-exec. It may fail to reopen if the client disconnects.\n");
-#endif
-
-         /* Allocate a connection */
-         for (connection_num = 0; connection_num < netplay->connections_size; connection_num++)
-            if (!netplay->connections[connection_num].active &&
-                  netplay->connections[connection_num].mode != NETPLAY_CONNECTION_DELAYED_DISCONNECT)
-               break;
-         if (connection_num == netplay->connections_size)
-         {
-            if (connection_num == 0)
-            {
-               netplay->connections = (struct netplay_connection*)
-                  malloc(sizeof(struct netplay_connection));
-
-               if (!netplay->connections)
-               {
-                  socket_close(new_fd);
-                  goto process;
-               }
-               netplay->connections_size = 1;
-
-            }
-            else
-            {
-               size_t new_connections_size = netplay->connections_size * 2;
-               struct netplay_connection
-                  *new_connections         = (struct netplay_connection*)
-
-                  realloc(netplay->connections,
-                     new_connections_size*sizeof(struct netplay_connection));
-
-               if (!new_connections)
-               {
-                  socket_close(new_fd);
-                  goto process;
-               }
-
-               memset(new_connections + netplay->connections_size, 0,
-                  netplay->connections_size * sizeof(struct netplay_connection));
-               netplay->connections = new_connections;
-               netplay->connections_size = new_connections_size;
-
-            }
-         }
-         connection         = &netplay->connections[connection_num];
-
-         /* Set it up */
-         memset(connection, 0, sizeof(*connection));
-         connection->active = true;
-         connection->fd     = new_fd;
-         connection->mode   = NETPLAY_CONNECTION_INIT;
-
-         if (!netplay_init_socket_buffer(&connection->send_packet_buffer,
-               netplay->packet_buffer_size) ||
-             !netplay_init_socket_buffer(&connection->recv_packet_buffer,
-               netplay->packet_buffer_size))
-         {
-            if (connection->send_packet_buffer.data)
-               netplay_deinit_socket_buffer(&connection->send_packet_buffer);
-            connection->active = false;
-            socket_close(new_fd);
-            goto process;
-         }
+      struct netplay_connection *connection = netplay_accept_connection(
+            netplay, netplay->listen_fd,
+            &netplay->connections, &netplay->connections_size);
 
+      if (connection)
          netplay_handshake_init_send(netplay, connection);
-
-      }
    }
 
-process:
    netplay->can_poll = true;
    input_poll_net();
 
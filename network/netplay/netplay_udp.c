@@ -0,0 +1,229 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <net/net_compat.h>
+
+#include "netplay_udp.h"
+
+/* Sequence numbers wrap, so compare them by distance */
+#define SEQ_DIFF(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)))
+
+/**
+ * netplay_udp_init
+ *
+ * Reset the channel state.
+ */
+void netplay_udp_init(netplay_udp_t *udp, uint32_t token)
+{
+   memset(udp, 0, sizeof(*udp));
+   udp->token = token;
+}
+
+/**
+ * netplay_udp_queue
+ *
+ * Add an input command to the retransmission window, dropping the oldest
+ * entry if it's full. TCP will deliver whatever we drop.
+ */
+void netplay_udp_queue(netplay_udp_t *udp, const uint32_t *cmd, size_t words,
+      uint32_t sync_offset)
+{
+   struct netplay_udp_entry *entry;
+
+   if (words > NETPLAY_UDP_ENTRY_WORDS)
+      return;
+
+   if (udp->window_end - udp->window_start >= NETPLAY_UDP_WINDOW)
+      udp->window_start++;
+
+   entry              = &udp->window[udp->window_end % NETPLAY_UDP_WINDOW];
+   entry->sync_offset = sync_offset;
+   entry->words       = (uint32_t)words;
+   memcpy(entry->data, cmd, words * sizeof(uint32_t));
+   udp->window_end++;
+}
+
+/**
+ * netplay_udp_build
+ *
+ * Build the next packet: our acknowledgements and as many of the most recent
+ * unacknowledged commands as fit, oldest first.
+ *
+ * Returns the size of the packet in bytes.
+ */
+size_t netplay_udp_build(netplay_udp_t *udp, uint32_t *packet, size_t size)
+{
+   uint32_t seq, first;
+   size_t used     = NETPLAY_UDP_HEADER_WORDS;
+   size_t max      = size / sizeof(uint32_t);
+   uint32_t count  = 0;
+
+   if (max < NETPLAY_UDP_HEADER_WORDS)
+      return 0;
+
+   /* If it doesn't all fit, leave out the oldest commands. Without
+    * acknowledgements for that long, TCP has most likely delivered them
+    * already. */
+   for (first = udp->window_end; first != udp->window_start; first--)
+   {
+      const struct netplay_udp_entry *entry =
+         &udp->window[(first - 1) % NETPLAY_UDP_WINDOW];
+
+      if (used + 2 + entry->words > max)
+         break;
+      used += 2 + entry->words;
+   }
+
+   used = NETPLAY_UDP_HEADER_WORDS;
+   for (seq = first; seq != udp->window_end; seq++)
+   {
+      const struct netplay_udp_entry *entry =
+         &udp->window[seq % NETPLAY_UDP_WINDOW];
+
+      packet[used++] = htonl(entry->sync_offset);
+      packet[used++] = htonl(entry->words);
+      memcpy(packet + used, entry->data, entry->words * sizeof(uint32_t));
+      used += entry->words;
+      count++;
+   }
+
+   packet[0] = htonl(NETPLAY_UDP_MAGIC);
+   packet[1] = htonl(udp->token);
+   packet[2] = htonl(udp->send_seq);
+   packet[3] = htonl(udp->recv_seq);
+   packet[4] = htonl(udp->recv_bits);
+   packet[5] = htonl(count | (udp->have_recv ? NETPLAY_UDP_ACK_VALID : 0));
+
+   /* Remember what this packet covered, for when it's acknowledged */
+   udp->sent_end[udp->send_seq % NETPLAY_UDP_ACK_BITS] = seq;
+   udp->send_seq++;
+   udp->packets_sent++;
+   udp->entries_sent += count;
+
+   return used * sizeof(uint32_t);
+}
+
+/**
+ * netplay_udp_packet_token
+ *
+ * Returns the token of a packet, or 0 if it isn't a netplay packet at all.
+ */
+uint32_t netplay_udp_packet_token(const uint32_t *packet, size_t size)
+{
+   if (size < NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t) ||
+         ntohl(packet[0]) != NETPLAY_UDP_MAGIC)
+      return 0;
+   return ntohl(packet[1]);
+}
+
+/* The peer got our packet 'seq', so it has every command that packet
+ * carried and we can stop sending them */
+static void netplay_udp_acked(netplay_udp_t *udp, uint32_t seq)
+{
+   uint32_t end;
+   int32_t age = SEQ_DIFF(udp->send_seq, seq);
+
+   if (age <= 0 || age > NETPLAY_UDP_ACK_BITS)
+      return;
+
+   end = udp->sent_end[seq % NETPLAY_UDP_ACK_BITS];
+   if (SEQ_DIFF(end, udp->window_start) > 0 &&
+         SEQ_DIFF(end, udp->window_end) <= 0)
+      udp->window_start = end;
+}
+
+/**
+ * netplay_udp_parse
+ *
+ * Process the acknowledgements in a received packet and hand each command
+ * it carries to the callback, in the order they were queued. Commands may
+ * have been seen before and must be ignored if so.
+ *
+ * Returns false if the packet is malformed or not meant for us.
+ */
+bool netplay_udp_parse(netplay_udp_t *udp, const uint32_t *packet,
+      size_t size, netplay_udp_entry_cb_t cb, void *data)
+{
+   uint32_t seq, ack, ack_bits, count, flags, i;
+   size_t words = size / sizeof(uint32_t);
+   size_t used  = NETPLAY_UDP_HEADER_WORDS;
+
+   if (netplay_udp_packet_token(packet, size) != udp->token)
+      return false;
+
+   seq      = ntohl(packet[2]);
+   ack      = ntohl(packet[3]);
+   ack_bits = ntohl(packet[4]);
+   flags    = ntohl(packet[5]);
+   count    = flags & ~NETPLAY_UDP_ACK_VALID;
+
+   /* Validate the whole packet before acting on any of it */
+   for (i = 0; i < count; i++)
+   {
+      uint32_t entry_words;
+      if (used + 2 > words)
+         return false;
+      entry_words = ntohl(packet[used + 1]);
+      if (entry_words < 2 || entry_words > NETPLAY_UDP_ENTRY_WORDS ||
+            used + 2 + entry_words > words ||
+            ntohl(packet[used + 3]) != (entry_words - 2) * sizeof(uint32_t))
+         return false;
+      used += 2 + entry_words;
+   }
+
+   /* Acknowledgements, unless the peer hasn't heard from us yet */
+   if (flags & NETPLAY_UDP_ACK_VALID)
+   {
+      netplay_udp_acked(udp, ack);
+      for (i = 0; i < NETPLAY_UDP_ACK_BITS; i++)
+         if (ack_bits & (1U << i))
+            netplay_udp_acked(udp, ack - 1 - i);
+   }
+
+   /* Note what we've received, for our own acknowledgements */
+   if (!udp->have_recv)
+   {
+      udp->have_recv = true;
+      udp->recv_seq  = seq;
+      udp->recv_bits = 0;
+   }
+   else
+   {
+      int32_t diff = SEQ_DIFF(seq, udp->recv_seq);
+      if (diff > 0)
+      {
+         udp->recv_bits = (diff > NETPLAY_UDP_ACK_BITS) ? 0 :
+            (diff == NETPLAY_UDP_ACK_BITS) ? (1U << (diff - 1)) :
+            ((udp->recv_bits << diff) | (1U << (diff - 1)));
+         udp->recv_seq  = seq;
+      }
+      else if (diff < 0 && -diff <= NETPLAY_UDP_ACK_BITS)
+         udp->recv_bits |= 1U << (-diff - 1);
+   }
+   udp->packets_received++;
+
+   /* And the commands themselves */
+   used = NETPLAY_UDP_HEADER_WORDS;
+   for (i = 0; i < count; i++)
+   {
+      uint32_t entry_words = ntohl(packet[used + 1]);
+      cb(data, ntohl(packet[used]), packet + used + 2, entry_words);
+      used += 2 + entry_words;
+   }
+
+   return true;
+}
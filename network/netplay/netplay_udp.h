@@ -0,0 +1,144 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_UDP_H
+#define __RARCH_NETPLAY_UDP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Packet magic, "RANU" */
+#define NETPLAY_UDP_MAGIC        0x52414E55
+
+/* Input commands kept for retransmission per connection */
+#define NETPLAY_UDP_WINDOW       64
+
+/* Largest input command we carry, in words, including the command header.
+ * Matches the limit in send_input_frame. */
+#define NETPLAY_UDP_ENTRY_WORDS  16
+
+/* Words of packet header: magic, token, seq, ack, ack bits, entry count */
+#define NETPLAY_UDP_HEADER_WORDS 6
+
+/* Set in the entry count word if the ack fields are meaningful */
+#define NETPLAY_UDP_ACK_VALID    (1U<<31)
+
+/* Keep packets comfortably below common MTUs */
+#define NETPLAY_UDP_MAX_PACKET   1200
+
+/* Packets we remember for acknowledgement (the width of the ack bitfield) */
+#define NETPLAY_UDP_ACK_BITS     32
+
+struct netplay_udp_entry
+{
+   /* Non-input TCP bytes the sender had queued before this command. The
+    * receiver may only act on the command once it has consumed as much, so
+    * that it is never ahead of a synchronization event still in flight on
+    * TCP. */
+   uint32_t sync_offset;
+
+   /* Length of the command in words, including the command header */
+   uint32_t words;
+
+   /* The command exactly as sent over TCP, in network byte order */
+   uint32_t data[NETPLAY_UDP_ENTRY_WORDS];
+};
+
+/* Per-connection state of the UDP input channel. Every input command also
+ * goes out over TCP as usual; this only gets it there sooner. Each packet
+ * repeats every command the peer hasn't acknowledged yet, so a lost packet
+ * is made up for by the next one instead of stalling everything behind it
+ * like a lost TCP segment does. */
+typedef struct netplay_udp
+{
+   /* Identifies the connection in every packet, chosen by the server */
+   uint32_t token;
+
+   /* Outgoing commands not yet acknowledged. Entry sequence numbers in
+    * [window_start, window_end) live at window[seq % NETPLAY_UDP_WINDOW]. */
+   struct netplay_udp_entry window[NETPLAY_UDP_WINDOW];
+   uint32_t window_start, window_end;
+
+   /* Sequence number of our next packet, and for each of the last packets,
+    * the entry sequence number up to which it carried commands */
+   uint32_t send_seq;
+   uint32_t sent_end[NETPLAY_UDP_ACK_BITS];
+
+   /* Latest packet received from the peer, and which of the
+    * NETPLAY_UDP_ACK_BITS packets before it we've seen too */
+   bool have_recv;
+   uint32_t recv_seq;
+   uint32_t recv_bits;
+
+   /* Statistics */
+   uint32_t packets_sent, packets_received, entries_sent;
+} netplay_udp_t;
+
+typedef void (*netplay_udp_entry_cb_t)(void *data, uint32_t sync_offset,
+      const uint32_t *cmd, size_t words);
+
+/**
+ * netplay_udp_init
+ *
+ * Reset the channel state.
+ */
+void netplay_udp_init(netplay_udp_t *udp, uint32_t token);
+
+/**
+ * netplay_udp_queue
+ *
+ * Add an input command to the retransmission window, dropping the oldest
+ * entry if it's full. TCP will deliver whatever we drop.
+ */
+void netplay_udp_queue(netplay_udp_t *udp, const uint32_t *cmd, size_t words,
+      uint32_t sync_offset);
+
+/**
+ * netplay_udp_build
+ *
+ * Build the next packet: our acknowledgements and as many of the most recent
+ * unacknowledged commands as fit, oldest first.
+ *
+ * Returns the size of the packet in bytes.
+ */
+size_t netplay_udp_build(netplay_udp_t *udp, uint32_t *packet, size_t size);
+
+/**
+ * netplay_udp_packet_token
+ *
+ * Returns the token of a packet, or 0 if it isn't a netplay packet at all.
+ */
+uint32_t netplay_udp_packet_token(const uint32_t *packet, size_t size);
+
+/**
+ * netplay_udp_parse
+ *
+ * Process the acknowledgements in a received packet and hand each command
+ * it carries to the callback, in the order they were queued. Commands may
+ * have been seen before and must be ignored if so.
+ *
+ * Returns false if the packet is malformed or not meant for us.
+ */
+bool netplay_udp_parse(netplay_udp_t *udp, const uint32_t *packet,
+      size_t size, netplay_udp_entry_cb_t cb, void *data);
+
+RETRO_END_DECLS
+
+#endif
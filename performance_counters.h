@@ -24,6 +24,8 @@
 #include <libretro.h>
 #include <features/features_cpu.h>
 
+#include "performance_trace.h"
+
 RETRO_BEGIN_DECLS
 
 #ifndef MAX_COUNTERS
@@ -67,7 +69,13 @@ void rarch_perf_register(struct retro_perf_counter *perf);
 
 #define performance_counter_stop_internal(is_perfcnt_enable, perf) \
    if ((is_perfcnt_enable)) \
-      perf.total += cpu_features_get_perf_counter() - perf.start
+   { \
+      retro_perf_tick_t perf_ticks = cpu_features_get_perf_counter() \
+         - perf.start; \
+      perf.total += perf_ticks; \
+      if (performance_trace_flags) \
+         performance_trace_event(perf.ident, perf.start, perf_ticks); \
+   }
 
 /**
  * performance_counter_start:
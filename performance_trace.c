@@ -0,0 +1,854 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2020 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <formats/jsonsax_full.h>
+#include <queues/spsc_queue.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "performance_trace.h"
+
+/* Sections one thread can record between two frames of a capture
+ * before it starts dropping them */
+#define PERFORMANCE_TRACE_EVENTS 4096
+
+/* Distinct sections one thread can keep histograms of. Power of two. */
+#define PERFORMANCE_TRACE_SLOTS  128
+
+/* Section names are copied: a core's counters go away with the core,
+ * possibly before the events naming them are written. */
+#define PERFORMANCE_TRACE_IDENT  48
+
+typedef struct performance_trace_event
+{
+   retro_perf_tick_t start;
+   retro_perf_tick_t ticks;
+   char ident[PERFORMANCE_TRACE_IDENT];
+} performance_trace_event_t;
+
+typedef struct performance_trace_captured
+{
+   performance_trace_event_t event;
+   unsigned tid;
+} performance_trace_captured_t;
+
+typedef struct performance_trace_slot
+{
+   /* Address of the name it was claimed with, NULL while free. Only
+    * set with the lock held, so that readers holding it see either
+    * nothing or a zeroed histogram under a complete name. */
+   const char *key;
+   char ident[PERFORMANCE_TRACE_IDENT];
+   performance_trace_histogram_t hist;
+} performance_trace_slot_t;
+
+typedef struct performance_trace_thread
+{
+   performance_trace_slot_t slots[PERFORMANCE_TRACE_SLOTS];
+   struct performance_trace_thread *next;
+   /* Written by the owning thread, read by the main thread. Created
+    * by the first section it captures. */
+   spsc_queue_t *events;
+#if defined(HAVE_THREADS) && !defined(HAVE_THREAD_STORAGE)
+   uintptr_t id;
+#endif
+   uint64_t dropped;
+   /* Shown as 'tid' in traces */
+   unsigned index;
+   char name[32];
+   /* Its thread is gone, the next new thread takes it over */
+   bool exited;
+} performance_trace_thread_t;
+
+typedef struct performance_trace_state
+{
+   performance_trace_thread_t *threads;
+   performance_trace_captured_t *captured;
+   size_t num_captured;
+   size_t cap_captured;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#ifdef HAVE_THREAD_STORAGE
+   sthread_tls_t tls;
+#endif
+#endif
+   retro_perf_tick_t frame_ticks;
+   retro_perf_tick_t start_ticks;
+   retro_time_t start_usec;
+   unsigned num_threads;
+   /* Capture window */
+   unsigned skip;
+   unsigned frames;
+   unsigned frame;
+   char path[PATH_MAX_LENGTH];
+   bool armed;
+   bool inited;
+} performance_trace_state_t;
+
+typedef struct performance_trace_json
+{
+   JSON_Writer writer;
+   /* NULL when writing to stdout */
+   RFILE *file;
+} performance_trace_json_t;
+
+/* TODO/FIXME - static global variables */
+static performance_trace_state_t performance_trace_st;
+unsigned performance_trace_flags = 0;
+
+#ifdef HAVE_THREADS
+#define PERFORMANCE_TRACE_LOCK(st)   slock_lock((st)->lock)
+#define PERFORMANCE_TRACE_UNLOCK(st) slock_unlock((st)->lock)
+#else
+#define PERFORMANCE_TRACE_LOCK(st)
+#define PERFORMANCE_TRACE_UNLOCK(st)
+#endif
+
+void performance_trace_init(void)
+{
+   performance_trace_state_t *st = &performance_trace_st;
+
+   if (st->inited)
+      return;
+
+#ifdef HAVE_THREADS
+   if (!(st->lock = slock_new()))
+      return;
+#ifdef HAVE_THREAD_STORAGE
+   if (!sthread_tls_create(&st->tls))
+   {
+      slock_free(st->lock);
+      st->lock = NULL;
+      return;
+   }
+#endif
+#endif
+
+   st->inited = true;
+}
+
+/* Lock held */
+static performance_trace_thread_t *performance_trace_thread_new(
+      performance_trace_state_t *st)
+{
+   performance_trace_thread_t *thread = NULL;
+
+   /* Take over the buffers of a thread that is gone. The histograms
+    * are merged by name anyway, and its queued events were written
+    * before it exited. */
+   for (thread = st->threads; thread; thread = thread->next)
+   {
+      if (thread->exited)
+      {
+         thread->exited = false;
+         break;
+      }
+   }
+
+   if (!thread)
+   {
+      if (!(thread = (performance_trace_thread_t*)
+               calloc(1, sizeof(*thread))))
+         return NULL;
+
+      thread->index = st->num_threads++;
+      thread->next  = st->threads;
+      st->threads   = thread;
+   }
+
+   snprintf(thread->name, sizeof(thread->name), "thread %u",
+         thread->index);
+#if defined(HAVE_THREADS) && !defined(HAVE_THREAD_STORAGE)
+   thread->id = sthread_get_current_thread_id();
+#endif
+   return thread;
+}
+
+/* Returns the calling thread's buffers, NULL if it has none yet */
+static performance_trace_thread_t *performance_trace_thread_find(
+      performance_trace_state_t *st)
+{
+#if defined(HAVE_THREADS) && defined(HAVE_THREAD_STORAGE)
+   return (performance_trace_thread_t*)sthread_tls_get(&st->tls);
+#elif defined(HAVE_THREADS)
+   performance_trace_thread_t *thread = NULL;
+   uintptr_t id                       = sthread_get_current_thread_id();
+
+   PERFORMANCE_TRACE_LOCK(st);
+   for (thread = st->threads; thread; thread = thread->next)
+      if (!thread->exited && thread->id == id)
+         break;
+   PERFORMANCE_TRACE_UNLOCK(st);
+   return thread;
+#else
+   return st->threads;
+#endif
+}
+
+static performance_trace_thread_t *performance_trace_thread_get(
+      performance_trace_state_t *st)
+{
+   performance_trace_thread_t *thread = NULL;
+
+   if (!st->inited)
+      return NULL;
+
+   if ((thread = performance_trace_thread_find(st)))
+      return thread;
+
+   PERFORMANCE_TRACE_LOCK(st);
+   thread = performance_trace_thread_new(st);
+   PERFORMANCE_TRACE_UNLOCK(st);
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREAD_STORAGE)
+   if (thread)
+      sthread_tls_set(&st->tls, thread);
+#endif
+   return thread;
+}
+
+void performance_trace_set_thread_name(const char *name)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = performance_trace_thread_get(st);
+
+   if (!thread)
+      return;
+
+   PERFORMANCE_TRACE_LOCK(st);
+   strlcpy(thread->name, name, sizeof(thread->name));
+   PERFORMANCE_TRACE_UNLOCK(st);
+}
+
+void performance_trace_thread_exit(void)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = NULL;
+
+   if (!st->inited || !(thread = performance_trace_thread_find(st)))
+      return;
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREAD_STORAGE)
+   sthread_tls_set(&st->tls, NULL);
+#endif
+   PERFORMANCE_TRACE_LOCK(st);
+   thread->exited = true;
+   PERFORMANCE_TRACE_UNLOCK(st);
+}
+
+static unsigned performance_trace_bucket(retro_perf_tick_t ticks)
+{
+   unsigned bucket = 0;
+
+   while (ticks && bucket < PERFORMANCE_TRACE_BUCKETS - 1)
+   {
+      ticks >>= 1;
+      bucket++;
+   }
+
+   return bucket;
+}
+
+static void performance_trace_histogram_add(performance_trace_state_t *st,
+      performance_trace_thread_t *thread, const char *ident,
+      retro_perf_tick_t ticks)
+{
+   performance_trace_histogram_t *hist = NULL;
+   unsigned i;
+   unsigned slot = (unsigned)(((uintptr_t)ident >> 3) * 2654435761u)
+      & (PERFORMANCE_TRACE_SLOTS - 1);
+
+   /* Keyed by address - only the owning thread adds slots, so
+    * looking one up needs no lock. The name is compared as well, in
+    * case a core loaded later puts another name at that address. */
+   for (i = 0; i < PERFORMANCE_TRACE_SLOTS; i++)
+   {
+      performance_trace_slot_t *entry = &thread->slots[slot];
+
+      if (     entry->key == ident
+            && !strncmp(entry->ident, ident, sizeof(entry->ident) - 1))
+      {
+         hist = &entry->hist;
+         break;
+      }
+
+      if (!entry->key)
+      {
+         PERFORMANCE_TRACE_LOCK(st);
+         strlcpy(entry->ident, ident, sizeof(entry->ident));
+         entry->key = ident;
+         PERFORMANCE_TRACE_UNLOCK(st);
+         hist       = &entry->hist;
+         break;
+      }
+
+      slot = (slot + 1) & (PERFORMANCE_TRACE_SLOTS - 1);
+   }
+
+   if (!hist)
+   {
+      thread->dropped++;
+      return;
+   }
+
+   hist->count++;
+   hist->total += ticks;
+   if (ticks > hist->max)
+      hist->max = ticks;
+   hist->buckets[performance_trace_bucket(ticks)]++;
+}
+
+void performance_trace_event(const char *ident,
+      retro_perf_tick_t start, retro_perf_tick_t ticks)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = performance_trace_thread_get(st);
+   unsigned flags                     = performance_trace_flags;
+
+   if (!thread || !ident)
+      return;
+
+   if (flags & PERFORMANCE_TRACE_HISTOGRAMS)
+      performance_trace_histogram_add(st, thread, ident, ticks);
+
+   if (flags & PERFORMANCE_TRACE_CAPTURE)
+   {
+      performance_trace_event_t *event = NULL;
+
+      if (!thread->events)
+      {
+         PERFORMANCE_TRACE_LOCK(st);
+         thread->events = spsc_queue_new(PERFORMANCE_TRACE_EVENTS
+               * sizeof(*event), 0);
+         PERFORMANCE_TRACE_UNLOCK(st);
+      }
+
+      /* Written in place; the size is a multiple of the event size,
+       * so the span never wraps in the middle of one */
+      if (     !thread->events
+            || spsc_queue_write_span(thread->events, (void**)&event)
+               < sizeof(*event))
+      {
+         thread->dropped++;
+         return;
+      }
+
+      event->start = start;
+      event->ticks = ticks;
+      strlcpy(event->ident, ident, sizeof(event->ident));
+      spsc_queue_write_commit(thread->events, sizeof(*event));
+   }
+}
+
+void performance_trace_enable_histograms(bool enable)
+{
+   performance_trace_init();
+
+   if (!performance_trace_st.inited)
+      return;
+
+   if (enable)
+      performance_trace_flags |=  PERFORMANCE_TRACE_HISTOGRAMS;
+   else
+      performance_trace_flags &= ~PERFORMANCE_TRACE_HISTOGRAMS;
+}
+
+/* Moves every queued event into the capture, or throws them away
+ * when @keep is false. Main thread only. */
+static void performance_trace_drain(performance_trace_state_t *st, bool keep)
+{
+   performance_trace_thread_t *thread = NULL;
+
+   PERFORMANCE_TRACE_LOCK(st);
+   for (thread = st->threads; thread; thread = thread->next)
+   {
+      const performance_trace_event_t *event = NULL;
+
+      if (!thread->events)
+         continue;
+
+      while (spsc_queue_read_span(thread->events, (const void**)&event)
+            >= sizeof(*event))
+      {
+         performance_trace_captured_t *captured = NULL;
+         bool                          skip     =
+               !keep || event->start < st->start_ticks;
+
+         /* Started before the capture did */
+         if (skip)
+         {
+            spsc_queue_read_commit(thread->events, sizeof(*event));
+            continue;
+         }
+
+         if (st->num_captured == st->cap_captured)
+         {
+            size_t cap = st->cap_captured ? st->cap_captured * 2 : 1024;
+            performance_trace_captured_t *tmp  =
+               (performance_trace_captured_t*)realloc(st->captured,
+                     cap * sizeof(*tmp));
+
+            if (!tmp)
+            {
+               thread->dropped++;
+               spsc_queue_read_commit(thread->events, sizeof(*event));
+               continue;
+            }
+
+            st->captured     = tmp;
+            st->cap_captured = cap;
+         }
+
+         captured        = &st->captured[st->num_captured++];
+         captured->event = *event;
+         captured->tid   = thread->index;
+         spsc_queue_read_commit(thread->events, sizeof(*event));
+      }
+   }
+   PERFORMANCE_TRACE_UNLOCK(st);
+}
+
+bool performance_trace_capture(const char *path,
+      unsigned skip, unsigned frames)
+{
+   performance_trace_state_t *st = &performance_trace_st;
+
+   if (!frames)
+      return false;
+
+   performance_trace_init();
+
+   if (!st->inited)
+      return false;
+
+   performance_trace_flags &= ~PERFORMANCE_TRACE_CAPTURE;
+   st->num_captured         = 0;
+   st->skip                 = skip;
+   st->frames               = frames;
+   st->frame                = 0;
+   st->armed                = true;
+
+   if (path)
+      strlcpy(st->path, path, sizeof(st->path));
+   else
+      st->path[0]           = '\0';
+
+   return true;
+}
+
+static JSON_Writer_HandlerResult performance_trace_json_output(
+      JSON_Writer writer, const char *pBytes, size_t length)
+{
+   performance_trace_json_t *ctx = (performance_trace_json_t*)
+      JSON_Writer_GetUserData(writer);
+
+   if (ctx->file)
+      return (filestream_write(ctx->file, pBytes, length) == (int64_t)length)
+         ? JSON_Writer_Continue : JSON_Writer_Abort;
+
+   return (fwrite(pBytes, 1, length, stdout) == length)
+      ? JSON_Writer_Continue : JSON_Writer_Abort;
+}
+
+static void performance_trace_json_key(performance_trace_json_t *ctx,
+      const char *key)
+{
+   JSON_Writer_WriteString(ctx->writer, key, strlen(key), JSON_UTF8);
+   JSON_Writer_WriteColon(ctx->writer);
+   JSON_Writer_WriteSpace(ctx->writer, 1);
+}
+
+static void performance_trace_json_next(performance_trace_json_t *ctx)
+{
+   JSON_Writer_WriteComma(ctx->writer);
+   JSON_Writer_WriteSpace(ctx->writer, 1);
+}
+
+static void performance_trace_json_string(performance_trace_json_t *ctx,
+      const char *str)
+{
+   JSON_Writer_WriteString(ctx->writer, str, strlen(str), JSON_UTF8);
+}
+
+static void performance_trace_json_uint(performance_trace_json_t *ctx,
+      uint64_t value)
+{
+   char buf[32];
+   int n = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+   if (n > 0 && n < (int)sizeof(buf))
+      JSON_Writer_WriteNumber(ctx->writer, buf, n, JSON_UTF8);
+}
+
+static void performance_trace_json_double(performance_trace_json_t *ctx,
+      double value)
+{
+   char buf[64];
+   int n = snprintf(buf, sizeof(buf), "%.3f", value);
+   if (n > 0 && n < (int)sizeof(buf))
+      JSON_Writer_WriteNumber(ctx->writer, buf, n, JSON_UTF8);
+}
+
+/* Starts one entry of "traceEvents", up to and including "tid" */
+static void performance_trace_json_event(performance_trace_json_t *ctx,
+      const char *name, const char *ph, unsigned tid)
+{
+   JSON_Writer_WriteStartObject(ctx->writer);
+   performance_trace_json_key(ctx, "name");
+   performance_trace_json_string(ctx, name);
+   performance_trace_json_next(ctx);
+   performance_trace_json_key(ctx, "ph");
+   performance_trace_json_string(ctx, ph);
+   performance_trace_json_next(ctx);
+   performance_trace_json_key(ctx, "pid");
+   performance_trace_json_uint(ctx, 1);
+   performance_trace_json_next(ctx);
+   performance_trace_json_key(ctx, "tid");
+   performance_trace_json_uint(ctx, tid);
+}
+
+/* Lock held */
+static void performance_trace_json_write(performance_trace_state_t *st,
+      performance_trace_json_t *ctx, double ticks_per_usec)
+{
+   size_t i;
+   performance_trace_thread_t *thread = NULL;
+   JSON_Writer writer                 = ctx->writer;
+   uint64_t dropped                   = 0;
+   bool first                         = true;
+
+   for (thread = st->threads; thread; thread = thread->next)
+      dropped += thread->dropped;
+
+   JSON_Writer_WriteStartObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   performance_trace_json_key(ctx, "displayTimeUnit");
+   performance_trace_json_string(ctx, "ms");
+   JSON_Writer_WriteComma(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   performance_trace_json_key(ctx, "otherData");
+   JSON_Writer_WriteStartObject(writer);
+   performance_trace_json_key(ctx, "frames");
+   performance_trace_json_uint(ctx, st->frame);
+   performance_trace_json_next(ctx);
+   performance_trace_json_key(ctx, "dropped_events");
+   performance_trace_json_uint(ctx, dropped);
+   performance_trace_json_next(ctx);
+   performance_trace_json_key(ctx, "ticks_per_us");
+   performance_trace_json_double(ctx, ticks_per_usec);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteComma(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   performance_trace_json_key(ctx, "traceEvents");
+   JSON_Writer_WriteStartArray(writer);
+
+   for (thread = st->threads; thread; thread = thread->next)
+   {
+      if (!first)
+         JSON_Writer_WriteComma(writer);
+      first = false;
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      performance_trace_json_event(ctx, "thread_name", "M", thread->index);
+      performance_trace_json_next(ctx);
+      performance_trace_json_key(ctx, "args");
+      JSON_Writer_WriteStartObject(writer);
+      performance_trace_json_key(ctx, "name");
+      performance_trace_json_string(ctx, thread->name);
+      JSON_Writer_WriteEndObject(writer);
+      JSON_Writer_WriteEndObject(writer);
+   }
+
+   for (i = 0; i < st->num_captured; i++)
+   {
+      const performance_trace_event_t *event = &st->captured[i].event;
+
+      if (!first)
+         JSON_Writer_WriteComma(writer);
+      first = false;
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      performance_trace_json_event(ctx, event->ident, "X",
+            st->captured[i].tid);
+      performance_trace_json_next(ctx);
+      performance_trace_json_key(ctx, "ts");
+      performance_trace_json_double(ctx,
+            (double)(event->start - st->start_ticks) / ticks_per_usec);
+      performance_trace_json_next(ctx);
+      performance_trace_json_key(ctx, "dur");
+      performance_trace_json_double(ctx,
+            (double)event->ticks / ticks_per_usec);
+      JSON_Writer_WriteEndObject(writer);
+   }
+
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteEndArray(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+}
+
+static bool performance_trace_write(performance_trace_state_t *st)
+{
+   performance_trace_json_t ctx;
+   /* The tick counter has no fixed rate (TSC, nanoseconds, ...) */
+   retro_time_t usec     = cpu_features_get_time_usec() - st->start_usec;
+   double ticks_per_usec = 1.0;
+   bool success          = false;
+
+   if (usec > 0)
+      ticks_per_usec     = (double)(cpu_features_get_perf_counter()
+            - st->start_ticks) / (double)usec;
+   if (ticks_per_usec <= 0.0)
+      ticks_per_usec     = 1.0;
+
+   ctx.writer            = NULL;
+   ctx.file              = NULL;
+
+   if (!string_is_empty(st->path))
+   {
+      if (!(ctx.file = filestream_open(st->path,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return false;
+   }
+
+   if (!(ctx.writer = JSON_Writer_Create(NULL)))
+      goto end;
+
+   JSON_Writer_SetOutputEncoding(ctx.writer, JSON_UTF8);
+   JSON_Writer_SetOutputHandler(ctx.writer, &performance_trace_json_output);
+   JSON_Writer_SetUserData(ctx.writer, &ctx);
+
+   PERFORMANCE_TRACE_LOCK(st);
+   performance_trace_json_write(st, &ctx, ticks_per_usec);
+   PERFORMANCE_TRACE_UNLOCK(st);
+
+   success = JSON_Writer_GetError(ctx.writer) == JSON_Error_None;
+
+end:
+   if (ctx.writer)
+      JSON_Writer_Free(ctx.writer);
+   if (ctx.file)
+      filestream_close(ctx.file);
+   else if (success)
+      fflush(stdout);
+   return success;
+}
+
+void performance_trace_capture_stop(void)
+{
+   performance_trace_state_t *st = &performance_trace_st;
+
+   st->armed = false;
+
+   if (!(performance_trace_flags & PERFORMANCE_TRACE_CAPTURE))
+      return;
+
+   performance_trace_flags &= ~PERFORMANCE_TRACE_CAPTURE;
+   performance_trace_drain(st, true);
+   performance_trace_write(st);
+
+   free(st->captured);
+   st->captured     = NULL;
+   st->num_captured = 0;
+   st->cap_captured = 0;
+}
+
+void performance_trace_frame(void)
+{
+   performance_trace_state_t *st = &performance_trace_st;
+   retro_perf_tick_t now         = 0;
+
+   if (!performance_trace_flags && !st->armed)
+   {
+      st->frame_ticks = 0;
+      return;
+   }
+
+   now = cpu_features_get_perf_counter();
+
+   if (performance_trace_flags && st->frame_ticks)
+      performance_trace_event("frame", st->frame_ticks,
+            now - st->frame_ticks);
+   st->frame_ticks = now;
+
+   if (st->armed)
+   {
+      if (st->skip)
+      {
+         st->skip--;
+         return;
+      }
+
+      /* Whatever is still queued belongs to an earlier capture */
+      performance_trace_drain(st, false);
+      st->armed                = false;
+      st->start_ticks          = now;
+      st->start_usec           = cpu_features_get_time_usec();
+      st->frame                = 0;
+      performance_trace_set_thread_name("main");
+      performance_trace_flags |= PERFORMANCE_TRACE_CAPTURE;
+   }
+   else if (performance_trace_flags & PERFORMANCE_TRACE_CAPTURE)
+   {
+      performance_trace_drain(st, true);
+      if (++st->frame >= st->frames)
+         performance_trace_capture_stop();
+   }
+}
+
+bool performance_trace_get_histogram(const char *ident,
+      performance_trace_histogram_t *hist)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = NULL;
+   bool found                         = false;
+
+   if (!st->inited || !ident)
+      return false;
+
+   memset(hist, 0, sizeof(*hist));
+
+   PERFORMANCE_TRACE_LOCK(st);
+   for (thread = st->threads; thread; thread = thread->next)
+   {
+      unsigned i, j;
+
+      for (i = 0; i < PERFORMANCE_TRACE_SLOTS; i++)
+      {
+         const performance_trace_slot_t *entry = &thread->slots[i];
+
+         if (!entry->key || !string_is_equal(entry->ident, ident))
+            continue;
+
+         found        = true;
+         hist->count += entry->hist.count;
+         hist->total += entry->hist.total;
+         if (entry->hist.max > hist->max)
+            hist->max = entry->hist.max;
+         for (j = 0; j < PERFORMANCE_TRACE_BUCKETS; j++)
+            hist->buckets[j] += entry->hist.buckets[j];
+      }
+   }
+   PERFORMANCE_TRACE_UNLOCK(st);
+
+   return found;
+}
+
+retro_perf_tick_t performance_trace_histogram_percentile(
+      const performance_trace_histogram_t *hist, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen = 0;
+   /* Nearest rank */
+   uint64_t rank = (hist->count * MIN(percent, 100) + 99) / 100;
+
+   if (!hist->count)
+      return 0;
+   if (!rank)
+      rank = 1;
+
+   for (i = 0; i < PERFORMANCE_TRACE_BUCKETS - 1; i++)
+   {
+      if ((seen += hist->buckets[i]) >= rank)
+      {
+         retro_perf_tick_t upper = i ? ((retro_perf_tick_t)1 << i) - 1 : 0;
+         return MIN(upper, hist->max);
+      }
+   }
+
+   return hist->max;
+}
+
+unsigned performance_trace_get_idents(const char **idents, unsigned max)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = NULL;
+   unsigned num                       = 0;
+
+   if (!st->inited)
+      return 0;
+
+   PERFORMANCE_TRACE_LOCK(st);
+   for (thread = st->threads; thread; thread = thread->next)
+   {
+      unsigned i, j;
+
+      for (i = 0; i < PERFORMANCE_TRACE_SLOTS && num < max; i++)
+      {
+         const char *ident = thread->slots[i].ident;
+
+         if (!thread->slots[i].key)
+            continue;
+
+         for (j = 0; j < num; j++)
+            if (string_is_equal(idents[j], ident))
+               break;
+
+         if (j == num)
+            idents[num++] = ident;
+      }
+   }
+   PERFORMANCE_TRACE_UNLOCK(st);
+
+   return num;
+}
+
+void performance_trace_deinit(void)
+{
+   performance_trace_state_t *st      = &performance_trace_st;
+   performance_trace_thread_t *thread = NULL;
+
+   performance_trace_flags = 0;
+
+   if (!st->inited)
+      return;
+
+   thread = st->threads;
+   while (thread)
+   {
+      performance_trace_thread_t *next = thread->next;
+      spsc_queue_free(thread->events);
+      free(thread);
+      thread = next;
+   }
+
+#ifdef HAVE_THREADS
+#ifdef HAVE_THREAD_STORAGE
+   sthread_tls_delete(&st->tls);
+#endif
+   slock_free(st->lock);
+#endif
+   free(st->captured);
+
+   memset(st, 0, sizeof(*st));
+}
@@ -0,0 +1,178 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2020 The RetroArch team
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PERFORMANCE_TRACE_H
+#define _PERFORMANCE_TRACE_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+#include <libretro.h>
+#include <features/features_cpu.h>
+
+RETRO_BEGIN_DECLS
+
+/* Records individual timed sections, on top of the running totals
+ * kept by struct retro_perf_counter:
+ *
+ * - Latency histograms: every section end is counted in a log2
+ *   bucket of its duration, per counter, so frame time spikes show
+ *   up instead of being averaged away.
+ * - Trace capture: for a chosen window of frames, every section is
+ *   stored with its start time and the thread it ran on, then written
+ *   out in the Chrome trace event format, which chrome://tracing and
+ *   Perfetto open.
+ *
+ * Each thread gets its own histograms and its own lock-free event
+ * queue; only the main thread (performance_trace_frame()) reads the
+ * queues. Sections are reported by the performance counter macros, by
+ * the core's perf_stop callback and, on threads that have no counter,
+ * by performance_trace_scope_begin()/performance_trace_scope_end().
+ *
+ * While nothing is enabled, each of those costs one branch on
+ * performance_trace_flags. */
+
+#define PERFORMANCE_TRACE_HISTOGRAMS (1 << 0)
+#define PERFORMANCE_TRACE_CAPTURE    (1 << 1)
+
+/* Bucket i counts durations of i significant bits, i.e. bucket 0 is
+ * 0 ticks and bucket i (i > 0) is [2^(i-1), 2^i) ticks. The last
+ * bucket also takes anything longer. */
+#define PERFORMANCE_TRACE_BUCKETS    48
+
+typedef struct performance_trace_histogram
+{
+   uint64_t count;
+   retro_perf_tick_t total;
+   retro_perf_tick_t max;
+   uint32_t buckets[PERFORMANCE_TRACE_BUCKETS];
+} performance_trace_histogram_t;
+
+/* PERFORMANCE_TRACE_* bits. Only changed from the main thread; other
+ * threads read it unsynchronised and may act on a change a section
+ * late, which the capture window tolerates. */
+/* TODO/FIXME - global referenced outside */
+extern unsigned performance_trace_flags;
+
+/* Times a section on threads without a performance counter.
+ * @start is a retro_perf_tick_t local to the section. */
+#define performance_trace_scope_begin(start) \
+   start = performance_trace_flags ? cpu_features_get_perf_counter() : 0
+
+#define performance_trace_scope_end(start, name) \
+   if (performance_trace_flags && start) \
+      performance_trace_event(name, start, \
+            cpu_features_get_perf_counter() - start)
+
+/**
+ * performance_trace_event:
+ * @ident              : Name of the section. Copied, so it may
+ *                       belong to a core that gets unloaded.
+ * @start              : Tick it started at.
+ * @ticks              : How long it took.
+ *
+ * Records a finished section on the calling thread. Only call it
+ * while performance_trace_flags is non-zero.
+ **/
+void performance_trace_event(const char *ident,
+      retro_perf_tick_t start, retro_perf_tick_t ticks);
+
+/* Creates the lock and thread local storage the other functions
+ * rely on. Call from the main thread before starting any thread
+ * that calls performance_trace_set_thread_name(). */
+void performance_trace_init(void);
+
+/* Name the calling thread is shown under in traces. Does nothing
+ * before performance_trace_init(). */
+void performance_trace_set_thread_name(const char *name);
+
+/* Hands the calling thread's buffers over to the next thread that
+ * records something. Call before a thread that may have recorded
+ * sections exits. */
+void performance_trace_thread_exit(void);
+
+void performance_trace_enable_histograms(bool enable);
+
+/**
+ * performance_trace_capture:
+ * @path               : File to write the trace to.
+ * @skip               : Frames to let pass before the capture starts.
+ * @frames             : Number of frames to capture.
+ *
+ * Arms a capture. It runs from the frame after the next @skip calls
+ * to performance_trace_frame(), and is written once @frames frames
+ * were captured. Replaces a capture still pending or running.
+ *
+ * Returns: false if @frames is 0.
+ **/
+bool performance_trace_capture(const char *path,
+      unsigned skip, unsigned frames);
+
+/**
+ * performance_trace_frame:
+ *
+ * Marks the start of a new frame. Main thread only. Moves the
+ * sections recorded by all threads into the capture, and writes the
+ * capture once its window has passed.
+ **/
+void performance_trace_frame(void);
+
+/* Writes a running capture right away, with the frames it got */
+void performance_trace_capture_stop(void);
+
+/**
+ * performance_trace_get_histogram:
+ * @ident              : Section name.
+ * @hist               : Filled in on success.
+ *
+ * Merges what all threads recorded under @ident. Counts still being
+ * updated by other threads may be slightly behind.
+ *
+ * Returns: false if nothing was recorded under @ident.
+ **/
+bool performance_trace_get_histogram(const char *ident,
+      performance_trace_histogram_t *hist);
+
+/**
+ * performance_trace_histogram_percentile:
+ * @hist               : Histogram.
+ * @percent            : 0 to 100.
+ *
+ * Returns: upper bound, in ticks, of the bucket holding the
+ * @percent-th percentile, capped at the longest section seen.
+ **/
+retro_perf_tick_t performance_trace_histogram_percentile(
+      const performance_trace_histogram_t *hist, unsigned percent);
+
+/**
+ * performance_trace_get_idents:
+ * @idents             : Filled in with section names.
+ * @max                : Size of @idents.
+ *
+ * Lists the sections that have a histogram, each name once. The
+ * names stay valid until performance_trace_deinit().
+ *
+ * Returns: number of names written to @idents.
+ **/
+unsigned performance_trace_get_idents(const char **idents, unsigned max);
+
+/* Stops everything and frees all thread buffers. Only call once no
+ * other thread can record sections any more. */
+void performance_trace_deinit(void);
+
+RETRO_END_DECLS
+
+#endif
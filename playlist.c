@@ -19,13 +19,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#define PLAYLIST_CACHE_MMAP
+#endif
 
 #include <libretro.h>
 #include <boolean.h>
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
 #include <compat/posix_string.h>
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <encodings/utf.h>
 #include <string/stdstring.h>
+#include <streams/file_stream.h>
 #include <streams/interface_stream.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
@@ -70,6 +83,31 @@ struct content_playlist
 
    struct playlist_entry *entries;
    playlist_config_t config;
+
+   /* Cache file the entries were loaded from, see
+    * playlist_read_cache(). Their strings point into it
+    * until they are replaced. */
+   char *cache;
+   size_t cache_size;
+   bool cache_mapped;
+
+   /* Records of the changes since the last write, see
+    * playlist_journal_add() */
+   char *journal;
+   size_t journal_len;
+   size_t journal_capacity;
+   unsigned journal_pending;
+   /* Journal file as last read or written, and the
+    * playlist file it applies to */
+   int64_t journal_size;
+   int64_t journal_base_size;
+   int64_t journal_base_mtime;
+   uint32_t journal_base_crc;
+   unsigned journal_records;
+   bool journal_enabled;
+   /* Set if changes were made that the journal cannot
+    * record, so that the playlist is written in full */
+   bool journal_invalid;
 };
 
 typedef struct
@@ -379,37 +417,50 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* Frees a string of @playlist, unless it is in its cache */
+static void playlist_free_str(playlist_t *playlist, char *str)
+{
+   if (     playlist->cache
+         && (uintptr_t)str >= (uintptr_t)playlist->cache
+         && (uintptr_t)str <  (uintptr_t)playlist->cache + playlist->cache_size)
+      return;
+
+   free(str);
+}
+
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
    if (entry->path != NULL)
-      free(entry->path);
+      playlist_free_str(playlist, entry->path);
    if (entry->label != NULL)
-      free(entry->label);
+      playlist_free_str(playlist, entry->label);
    if (entry->core_path != NULL)
-      free(entry->core_path);
+      playlist_free_str(playlist, entry->core_path);
    if (entry->core_name != NULL)
-      free(entry->core_name);
+      playlist_free_str(playlist, entry->core_name);
    if (entry->db_name != NULL)
-      free(entry->db_name);
+      playlist_free_str(playlist, entry->db_name);
    if (entry->crc32 != NULL)
-      free(entry->crc32);
+      playlist_free_str(playlist, entry->crc32);
    if (entry->subsystem_ident != NULL)
-      free(entry->subsystem_ident);
+      playlist_free_str(playlist, entry->subsystem_ident);
    if (entry->subsystem_name != NULL)
-      free(entry->subsystem_name);
+      playlist_free_str(playlist, entry->subsystem_name);
    if (entry->runtime_str != NULL)
-      free(entry->runtime_str);
+      playlist_free_str(playlist, entry->runtime_str);
    if (entry->last_played_str != NULL)
-      free(entry->last_played_str);
+      playlist_free_str(playlist, entry->last_played_str);
    if (entry->subsystem_roms != NULL)
       string_list_free(entry->subsystem_roms);
 
@@ -436,6 +487,152 @@ static void playlist_free_entry(struct playlist_entry *entry)
    entry->last_played_second = 0;
 }
 
+/* Journal next to a playlist file, holding the changes written
+ * since the file itself was. Each change is appended as one
+ * record, which replaces writing the whole playlist. See
+ * playlist_set_journal(). */
+
+/* "RPLJ" */
+#define PLAYLIST_JOURNAL_MAGIC       0x4A4C5052
+#define PLAYLIST_JOURNAL_VERSION     2
+/* Records after which the playlist is written in full */
+#define PLAYLIST_JOURNAL_MAX_RECORDS 128
+/* 'From' index of an entry pushed as a new one */
+#define PLAYLIST_JOURNAL_NEW         UINT32_MAX
+
+enum playlist_journal_op
+{
+   /* Moves entry 'from' to the top, or inserts a new one,
+    * and gives it the values recorded */
+   PLAYLIST_JOURNAL_PUSH = 0,
+   PLAYLIST_JOURNAL_UPDATE,
+   PLAYLIST_JOURNAL_DELETE
+};
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Playlist file the journal applies to. Size and time
+    * rule out most other versions of the file cheaply, the
+    * CRC32 of its contents the ones written within the
+    * resolution of the file time. */
+   int64_t base_size;
+   int64_t base_mtime;
+   uint32_t base_crc;
+   uint32_t reserved;
+} playlist_journal_header_t;
+
+static void playlist_journal_put(playlist_t *playlist,
+      const void *data, size_t len)
+{
+   if (playlist->journal_invalid)
+      return;
+
+   if (playlist->journal_len + len > playlist->journal_capacity)
+   {
+      size_t capacity = MAX(playlist->journal_capacity * 2,
+            playlist->journal_len + len + 256);
+      char *journal   = (char*)realloc(playlist->journal, capacity);
+
+      /* A change that cannot be recorded is written in full */
+      if (!journal)
+      {
+         playlist->journal_invalid = true;
+         return;
+      }
+
+      playlist->journal          = journal;
+      playlist->journal_capacity = capacity;
+   }
+
+   memcpy(playlist->journal + playlist->journal_len, data, len);
+   playlist->journal_len += len;
+}
+
+static void playlist_journal_put_u32(playlist_t *playlist, uint32_t value)
+{
+   playlist_journal_put(playlist, &value, sizeof(value));
+}
+
+/* Length with terminator, then the string. Empty strings are
+ * recorded as missing, as a parsed playlist has them. */
+static void playlist_journal_put_string(playlist_t *playlist,
+      const char *str)
+{
+   uint32_t len = string_is_empty(str) ? 0 : (uint32_t)strlen(str) + 1;
+
+   playlist_journal_put_u32(playlist, len);
+   if (len)
+      playlist_journal_put(playlist, str, len);
+}
+
+/**
+ * playlist_journal_add:
+ * @playlist            : Playlist handle.
+ * @op                  : Change made.
+ * @idx                 : Index of the entry changed, or the
+ *                        index it was pushed from.
+ * @entry               : Entry as changed, NULL if deleted.
+ *
+ * Records a change to be appended to the journal by the next
+ * playlist_write_file(). Only the values that function writes
+ * are recorded.
+ **/
+static void playlist_journal_add(playlist_t *playlist,
+      enum playlist_journal_op op, uint32_t idx,
+      const struct playlist_entry *entry)
+{
+   uint32_t record[2] = {0, 0};
+   size_t start       = playlist->journal_len;
+
+   if (!playlist->journal_enabled || playlist->journal_invalid)
+      return;
+
+   /* Size and CRC of the record, filled in below */
+   playlist_journal_put(playlist, record, sizeof(record));
+   playlist_journal_put_u32(playlist, op);
+   playlist_journal_put_u32(playlist, idx);
+
+   if (entry)
+   {
+      size_t i;
+      uint32_t num_roms = 0;
+
+      playlist_journal_put_string(playlist, entry->path);
+      playlist_journal_put_string(playlist, entry->label);
+      playlist_journal_put_string(playlist, entry->core_path);
+      playlist_journal_put_string(playlist, entry->core_name);
+      playlist_journal_put_string(playlist, entry->db_name);
+      playlist_journal_put_string(playlist, entry->crc32);
+      playlist_journal_put_string(playlist, entry->subsystem_ident);
+      playlist_journal_put_string(playlist, entry->subsystem_name);
+
+      if (entry->subsystem_roms)
+         for (i = 0; i < entry->subsystem_roms->size; i++)
+            if (!string_is_empty(entry->subsystem_roms->elems[i].data))
+               num_roms++;
+
+      playlist_journal_put_u32(playlist, num_roms);
+
+      if (num_roms)
+         for (i = 0; i < entry->subsystem_roms->size; i++)
+            if (!string_is_empty(entry->subsystem_roms->elems[i].data))
+               playlist_journal_put_string(playlist,
+                     entry->subsystem_roms->elems[i].data);
+   }
+
+   if (playlist->journal_invalid)
+      return;
+
+   record[0] = (uint32_t)(playlist->journal_len - start - sizeof(record));
+   record[1] = encoding_crc32(0,
+         (const uint8_t*)playlist->journal + start + sizeof(record),
+         record[0]);
+   memcpy(playlist->journal + start, record, sizeof(record));
+   playlist->journal_pending++;
+}
+
 /**
  * playlist_delete_index:
  * @playlist            : Playlist handle.
@@ -459,13 +656,15 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
          (playlist->size - idx) * sizeof(struct playlist_entry));
 
    playlist->modified = true;
+   playlist_journal_add(playlist, PLAYLIST_JOURNAL_DELETE,
+         (uint32_t)idx, NULL);
 }
 
 /**
@@ -563,6 +762,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
       const struct playlist_entry *update_entry)
 {
    struct playlist_entry *entry = NULL;
+   bool updated                 = false;
 
    if (!playlist || idx > playlist->size)
       return;
@@ -572,50 +772,57 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
-      playlist->modified = true;
+      updated            = true;
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
    {
       if (entry->label != NULL)
-         free(entry->label);
+         playlist_free_str(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
-      playlist->modified = true;
+      updated            = true;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path != NULL)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
-      playlist->modified = true;
+      updated            = true;
    }
 
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
       if (entry->core_name != NULL)
-         free(entry->core_name);
+         playlist_free_str(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
-      playlist->modified = true;
+      updated            = true;
    }
 
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
       if (entry->db_name != NULL)
-         free(entry->db_name);
+         playlist_free_str(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
-      playlist->modified = true;
+      updated            = true;
    }
 
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
       if (entry->crc32 != NULL)
-         free(entry->crc32);
+         playlist_free_str(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
+      updated            = true;
+   }
+
+   if (updated)
+   {
       playlist->modified = true;
+      playlist_journal_add(playlist, PLAYLIST_JOURNAL_UPDATE,
+            (uint32_t)idx, entry);
    }
 }
 
@@ -624,6 +831,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
       bool register_update)
 {
    struct playlist_entry *entry = NULL;
+   bool updated                 = false;
 
    if (!playlist || idx > playlist->size)
       return;
@@ -633,97 +841,104 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path != NULL)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->runtime_status != entry->runtime_status)
    {
       entry->runtime_status = update_entry->runtime_status;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->runtime_hours != entry->runtime_hours)
    {
       entry->runtime_hours = update_entry->runtime_hours;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->runtime_minutes != entry->runtime_minutes)
    {
       entry->runtime_minutes = update_entry->runtime_minutes;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->runtime_seconds != entry->runtime_seconds)
    {
       entry->runtime_seconds = update_entry->runtime_seconds;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_year != entry->last_played_year)
    {
       entry->last_played_year = update_entry->last_played_year;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_month != entry->last_played_month)
    {
       entry->last_played_month = update_entry->last_played_month;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_day != entry->last_played_day)
    {
       entry->last_played_day = update_entry->last_played_day;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_hour != entry->last_played_hour)
    {
       entry->last_played_hour = update_entry->last_played_hour;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_minute != entry->last_played_minute)
    {
       entry->last_played_minute = update_entry->last_played_minute;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_second != entry->last_played_second)
    {
       entry->last_played_second = update_entry->last_played_second;
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->runtime_str && (update_entry->runtime_str != entry->runtime_str))
    {
       if (entry->runtime_str != NULL)
-         free(entry->runtime_str);
+         playlist_free_str(playlist, entry->runtime_str);
       entry->runtime_str = NULL;
       entry->runtime_str = strdup(update_entry->runtime_str);
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
    }
 
    if (update_entry->last_played_str && (update_entry->last_played_str != entry->last_played_str))
    {
       if (entry->last_played_str != NULL)
-         free(entry->last_played_str);
+         playlist_free_str(playlist, entry->last_played_str);
       entry->last_played_str = NULL;
       entry->last_played_str = strdup(update_entry->last_played_str);
-      playlist->modified = playlist->modified || register_update;
+      updated = true;
+   }
+
+   if (updated && register_update)
+   {
+      playlist->modified = true;
+      playlist_journal_add(playlist, PLAYLIST_JOURNAL_UPDATE,
+            (uint32_t)idx, entry);
    }
 }
 
@@ -731,6 +946,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       const struct playlist_entry *entry)
 {
    size_t i;
+   uint32_t from = PLAYLIST_JOURNAL_NEW;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
 
@@ -791,6 +1007,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
+      from                 = (uint32_t)i;
 
       goto success;
    }
@@ -800,7 +1017,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       struct playlist_entry *last_entry = &playlist->entries[playlist->config.capacity - 1];
 
       if (last_entry)
-         playlist_free_entry(last_entry);
+         playlist_free_entry(playlist, last_entry);
       playlist->size--;
    }
 
@@ -841,6 +1058,8 @@ bool playlist_push_runtime(playlist_t *playlist,
 
 success:
    playlist->modified = true;
+   playlist_journal_add(playlist, PLAYLIST_JOURNAL_PUSH, from,
+         &playlist->entries[0]);
 
    return true;
 }
@@ -899,6 +1118,7 @@ bool playlist_push(playlist_t *playlist,
       const struct playlist_entry *entry)
 {
    size_t i;
+   uint32_t from         = PLAYLIST_JOURNAL_NEW;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
    const char *core_name = entry->core_name;
@@ -1047,6 +1267,8 @@ bool playlist_push(playlist_t *playlist,
        * the top and the entry to be pushed are the same. */
       if (i == 0)
       {
+         from = 0;
+
          if (entry_updated)
             goto success;
 
@@ -1058,6 +1280,7 @@ bool playlist_push(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
+      from                 = (uint32_t)i;
 
       goto success;
    }
@@ -1068,7 +1291,7 @@ bool playlist_push(playlist_t *playlist,
          &playlist->entries[playlist->config.capacity - 1];
 
       if (last_entry)
-         playlist_free_entry(last_entry);
+         playlist_free_entry(playlist, last_entry);
       playlist->size--;
    }
 
@@ -1130,6 +1353,8 @@ bool playlist_push(playlist_t *playlist,
 
 success:
    playlist->modified = true;
+   playlist_journal_add(playlist, PLAYLIST_JOURNAL_PUSH, from,
+         &playlist->entries[0]);
 
    return true;
 }
@@ -1162,6 +1387,1071 @@ static void JSONLogError(JSONContext *pCtx)
    }
 }
 
+/* Binary cache next to a playlist file, holding its parsed
+ * contents. Made of a header, fixed-size entry records and a
+ * string table the records refer to by offset. It is mapped
+ * (or read in one go) and the entries point into it, so loading
+ * allocates nothing per entry. A cache is only used while the
+ * playlist file keeps the size and modification time it was
+ * made for, and writing the playlist replaces it. */
+
+/* "RPLC" */
+#define PLAYLIST_CACHE_MAGIC   0x434C5052
+#define PLAYLIST_CACHE_VERSION 2
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   int64_t source_size;
+   int64_t source_mtime;
+   uint32_t entry_size;
+   uint32_t num_entries;
+   uint32_t strings_size;
+   /* Set if the playlist was read in full, otherwise it
+    * has more than num_entries entries */
+   uint32_t complete;
+   /* Set if entries beyond the capacity were dropped */
+   uint32_t truncated;
+   uint32_t old_format;
+   uint32_t compressed;
+   uint32_t label_display_mode;
+   uint32_t right_thumbnail_mode;
+   uint32_t left_thumbnail_mode;
+   uint32_t sort_mode;
+   uint32_t default_core_path;
+   uint32_t default_core_name;
+   uint32_t base_content_directory;
+} playlist_cache_header_t;
+
+/* Strings are offsets into the string table, 0 for NULL */
+typedef struct
+{
+   uint32_t path;
+   uint32_t label;
+   uint32_t core_path;
+   uint32_t core_name;
+   uint32_t db_name;
+   uint32_t crc32;
+   uint32_t subsystem_ident;
+   uint32_t subsystem_name;
+   uint32_t runtime_str;
+   uint32_t last_played_str;
+   /* Stored one after the other */
+   uint32_t subsystem_roms;
+   uint32_t num_subsystem_roms;
+   uint32_t runtime_status;
+   uint32_t runtime_hours;
+   uint32_t runtime_minutes;
+   uint32_t runtime_seconds;
+   uint32_t last_played_year;
+   uint32_t last_played_month;
+   uint32_t last_played_day;
+   uint32_t last_played_hour;
+   uint32_t last_played_minute;
+   uint32_t last_played_second;
+} playlist_cache_entry_t;
+
+typedef struct
+{
+   char *data;
+   size_t len;
+   size_t capacity;
+   /* Offsets of the strings by hash, 0 is empty */
+   uint32_t *table;
+   size_t table_size;
+   size_t count;
+   bool error;
+} playlist_cache_strings_t;
+
+static void playlist_cache_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   fill_pathname(s, playlist->config.path,
+         file_path_str(FILE_PATH_LPL_CACHE_EXTENSION), len);
+}
+
+/* Size and modification time of @path, the latter in nanoseconds
+ * where the platform has them, else in whole seconds (times
+ * 1000000000). Returns false if @path is missing, or if they cannot
+ * be told on this platform. */
+static bool playlist_file_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+#if defined(LEGACY_WIN32)
+   struct _stat buf;
+   char *path_local   = utf8_to_local_string_alloc(path);
+   int ret            = path_local ? _stat(path_local, &buf) : -1;
+
+   free(path_local);
+#else
+   struct _stat64 buf;
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+   int ret            = path_wide ? _wstat64(path_wide, &buf) : -1;
+
+   free(path_wide);
+#endif
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+   struct stat buf;
+   int ret = stat(path, &buf);
+#else
+   struct { int64_t st_size; int64_t st_mtime; } buf;
+   int ret = -1;
+#endif
+
+   if (ret != 0)
+      return false;
+
+   *size  = (int64_t)buf.st_size;
+   *mtime = (int64_t)buf.st_mtime * 1000000000;
+#if defined(__APPLE__)
+   *mtime += buf.st_mtimespec.tv_nsec;
+#elif defined(__unix__) && defined(st_mtime)
+   /* st_mtime is then an alias of st_mtim.tv_sec */
+   *mtime += buf.st_mtim.tv_nsec;
+#endif
+   return true;
+}
+
+/* CRC32 of the contents of @path. Returns false if it cannot
+ * be read. */
+static bool playlist_file_crc32(const char *path, uint32_t *crc)
+{
+   int64_t len;
+   uint8_t *buf = NULL;
+   RFILE *file  = NULL;
+   bool ret     = false;
+
+   if (!(buf = (uint8_t*)malloc(65536)))
+      return false;
+
+   if ((file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      *crc = 0;
+
+      while ((len = filestream_read(file, buf, 65536)) > 0)
+         *crc = encoding_crc32(*crc, buf, (size_t)len);
+
+      ret = len == 0;
+      filestream_close(file);
+   }
+
+   free(buf);
+   return ret;
+}
+
+static uint32_t playlist_cache_hash(const char *str)
+{
+   uint32_t hash = 2166136261u;
+
+   while (*str)
+   {
+      hash ^= (uint8_t)*str++;
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+static bool playlist_cache_grow_strings(playlist_cache_strings_t *strings)
+{
+   size_t i;
+   size_t table_size = strings->table_size ? strings->table_size * 2 : 1024;
+   uint32_t *table   = (uint32_t*)calloc(table_size, sizeof(*table));
+
+   if (!table)
+      return false;
+
+   for (i = 0; i < strings->table_size; i++)
+   {
+      size_t j;
+      uint32_t offset = strings->table[i];
+
+      if (!offset)
+         continue;
+
+      for (j = playlist_cache_hash(strings->data + offset) & (table_size - 1);
+            table[j]; j = (j + 1) & (table_size - 1));
+      table[j] = offset;
+   }
+
+   free(strings->table);
+   strings->table      = table;
+   strings->table_size = table_size;
+   return true;
+}
+
+/* Offset of @str in the string table, which stores equal
+ * strings once. Paths of cores and names of databases are
+ * mostly the same for all entries. */
+static uint32_t playlist_cache_add_string(playlist_cache_strings_t *strings,
+      const char *str)
+{
+   size_t i, len;
+   uint32_t offset;
+
+   if (!str || strings->error)
+      return 0;
+
+   if (     (strings->count + 1) * 2 > strings->table_size
+         && !playlist_cache_grow_strings(strings))
+      goto error;
+
+   for (i = playlist_cache_hash(str) & (strings->table_size - 1);
+         strings->table[i]; i = (i + 1) & (strings->table_size - 1))
+      if (string_is_equal(strings->data + strings->table[i], str))
+         return strings->table[i];
+
+   len = strlen(str) + 1;
+
+   if (strings->len + len > strings->capacity)
+   {
+      size_t capacity = MAX(strings->capacity * 2, strings->len + len);
+      char *data      = (char*)realloc(strings->data, capacity);
+
+      if (!data)
+         goto error;
+
+      strings->data     = data;
+      strings->capacity = capacity;
+   }
+
+   if (strings->len + len > UINT32_MAX)
+      goto error;
+
+   offset            = (uint32_t)strings->len;
+   memcpy(strings->data + strings->len, str, len);
+   strings->len     += len;
+   strings->table[i] = offset;
+   strings->count++;
+   return offset;
+
+error:
+   strings->error = true;
+   return 0;
+}
+
+/* Subsystem ROMs, one after the other. Not deduplicated, as
+ * they have to stay together. */
+static uint32_t playlist_cache_add_string_list(
+      playlist_cache_strings_t *strings, const struct string_list *list)
+{
+   size_t i;
+   size_t offset = strings->len;
+   size_t len    = 0;
+
+   for (i = 0; i < list->size; i++)
+      len += strlen(list->elems[i].data ? list->elems[i].data : "") + 1;
+
+   if (strings->error || offset + len > UINT32_MAX)
+      goto error;
+
+   if (offset + len > strings->capacity)
+   {
+      size_t capacity = MAX(strings->capacity * 2, offset + len);
+      char *data      = (char*)realloc(strings->data, capacity);
+
+      if (!data)
+         goto error;
+
+      strings->data     = data;
+      strings->capacity = capacity;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      const char *str = list->elems[i].data ? list->elems[i].data : "";
+      size_t str_len  = strlen(str) + 1;
+
+      memcpy(strings->data + strings->len, str, str_len);
+      strings->len += str_len;
+   }
+
+   return (uint32_t)offset;
+
+error:
+   strings->error = true;
+   return 0;
+}
+
+/**
+ * playlist_write_cache:
+ * @playlist            : Playlist handle.
+ *
+ * Writes the cache of @playlist, for its file as it is on disk
+ * now. The cache is written next to it and renamed, so it is
+ * never left half written.
+ **/
+static void playlist_write_cache(playlist_t *playlist)
+{
+   size_t i;
+   int64_t size, mtime;
+   playlist_cache_header_t header;
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+   playlist_cache_strings_t strings = {0};
+   playlist_cache_entry_t *records  = NULL;
+   RFILE *file                      = NULL;
+   bool written                     = false;
+
+   if (!playlist_file_stat(playlist->config.path, &size, &mtime))
+      return;
+
+   if (!(records = (playlist_cache_entry_t*)calloc(
+               MAX(playlist->size, 1), sizeof(*records))))
+      return;
+
+   /* Offset 0 stands for NULL */
+   strings.data     = (char*)malloc(4096);
+   strings.capacity = strings.data ? 4096 : 0;
+   strings.len      = 1;
+   strings.error    = !strings.data;
+   if (strings.data)
+      strings.data[0] = '\0';
+
+   memset(&header, 0, sizeof(header));
+   header.magic                  = PLAYLIST_CACHE_MAGIC;
+   header.version                = PLAYLIST_CACHE_VERSION;
+   header.source_size            = size;
+   header.source_mtime           = mtime;
+   header.entry_size             = sizeof(playlist_cache_entry_t);
+   header.num_entries            = (uint32_t)playlist->size;
+   header.complete               = playlist->size < playlist->config.capacity;
+   header.truncated              = playlist->modified;
+   header.old_format             = playlist->old_format;
+   header.compressed             = playlist->compressed;
+   header.label_display_mode     = playlist->label_display_mode;
+   header.right_thumbnail_mode   = playlist->right_thumbnail_mode;
+   header.left_thumbnail_mode    = playlist->left_thumbnail_mode;
+   header.sort_mode              = playlist->sort_mode;
+   header.default_core_path      = playlist_cache_add_string(&strings,
+         playlist->default_core_path);
+   header.default_core_name      = playlist_cache_add_string(&strings,
+         playlist->default_core_name);
+   header.base_content_directory = playlist_cache_add_string(&strings,
+         playlist->base_content_directory);
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+      playlist_cache_entry_t *record     = &records[i];
+
+      record->path               = playlist_cache_add_string(&strings, entry->path);
+      record->label              = playlist_cache_add_string(&strings, entry->label);
+      record->core_path          = playlist_cache_add_string(&strings, entry->core_path);
+      record->core_name          = playlist_cache_add_string(&strings, entry->core_name);
+      record->db_name            = playlist_cache_add_string(&strings, entry->db_name);
+      record->crc32              = playlist_cache_add_string(&strings, entry->crc32);
+      record->subsystem_ident    = playlist_cache_add_string(&strings, entry->subsystem_ident);
+      record->subsystem_name     = playlist_cache_add_string(&strings, entry->subsystem_name);
+      record->runtime_str        = playlist_cache_add_string(&strings, entry->runtime_str);
+      record->last_played_str    = playlist_cache_add_string(&strings, entry->last_played_str);
+      record->runtime_status     = entry->runtime_status;
+      record->runtime_hours      = entry->runtime_hours;
+      record->runtime_minutes    = entry->runtime_minutes;
+      record->runtime_seconds    = entry->runtime_seconds;
+      record->last_played_year   = entry->last_played_year;
+      record->last_played_month  = entry->last_played_month;
+      record->last_played_day    = entry->last_played_day;
+      record->last_played_hour   = entry->last_played_hour;
+      record->last_played_minute = entry->last_played_minute;
+      record->last_played_second = entry->last_played_second;
+
+      if (entry->subsystem_roms && entry->subsystem_roms->size)
+      {
+         record->subsystem_roms     = playlist_cache_add_string_list(
+               &strings, entry->subsystem_roms);
+         record->num_subsystem_roms = (uint32_t)entry->subsystem_roms->size;
+      }
+   }
+
+   if (strings.error)
+      goto end;
+
+   header.strings_size = (uint32_t)strings.len;
+
+   playlist_cache_path(playlist, path, sizeof(path));
+   strlcpy(tmp, path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   if (!(file = filestream_open(tmp, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto end;
+
+   written = filestream_write(file, &header, sizeof(header))
+         == sizeof(header)
+      && filestream_write(file, records, playlist->size * sizeof(*records))
+         == (int64_t)(playlist->size * sizeof(*records))
+      && filestream_write(file, strings.data, strings.len)
+         == (int64_t)strings.len;
+
+   if (filestream_close(file) != 0)
+      written = false;
+
+   if (written)
+   {
+      filestream_delete(path);
+      written = !filestream_rename(tmp, path);
+   }
+
+   if (!written)
+      filestream_delete(tmp);
+
+end:
+   free(records);
+   free(strings.data);
+   free(strings.table);
+}
+
+/* Drops the cache of @playlist before its file is written, so
+ * that a cache never outlives the file it was made for */
+static void playlist_delete_cache(playlist_t *playlist)
+{
+   char path[PATH_MAX_LENGTH];
+
+   playlist_cache_path(playlist, path, sizeof(path));
+   filestream_delete(path);
+}
+
+static void playlist_release_cache(playlist_t *playlist)
+{
+   if (!playlist->cache)
+      return;
+
+#ifdef PLAYLIST_CACHE_MMAP
+   if (playlist->cache_mapped)
+      munmap(playlist->cache, playlist->cache_size);
+   else
+#endif
+      free(playlist->cache);
+
+   playlist->cache        = NULL;
+   playlist->cache_size   = 0;
+   playlist->cache_mapped = false;
+}
+
+static bool playlist_map_cache(playlist_t *playlist, const char *path)
+{
+#ifdef PLAYLIST_CACHE_MMAP
+   struct stat buf;
+   void *data;
+   int fd = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (fstat(fd, &buf) != 0 || buf.st_size <= 0)
+   {
+      close(fd);
+      return false;
+   }
+
+   /* Private and writable, so that the entries can be
+    * treated like strings of their own */
+   data = mmap(NULL, (size_t)buf.st_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (data == MAP_FAILED)
+      return false;
+
+   playlist->cache        = (char*)data;
+   playlist->cache_size   = (size_t)buf.st_size;
+   playlist->cache_mapped = true;
+   return true;
+#else
+   void *data  = NULL;
+   int64_t len = 0;
+
+   if (!filestream_read_file(path, &data, &len) || len <= 0)
+   {
+      free(data);
+      return false;
+   }
+
+   playlist->cache        = (char*)data;
+   playlist->cache_size   = (size_t)len;
+   playlist->cache_mapped = false;
+   return true;
+#endif
+}
+
+/* String at @offset of a string table of @size bytes that ends
+ * with a terminator, NULL for 0. Sets @ok if out of bounds. */
+static char *playlist_cache_string(char *strings, uint32_t size,
+      uint32_t offset, bool *ok)
+{
+   if (!offset)
+      return NULL;
+
+   if (offset >= size)
+   {
+      *ok = false;
+      return NULL;
+   }
+
+   return strings + offset;
+}
+
+/**
+ * playlist_read_cache:
+ * @playlist            : Playlist handle.
+ *
+ * Loads the entries of @playlist from its cache, if it is
+ * current.
+ *
+ * Returns: true if they were loaded.
+ **/
+static bool playlist_read_cache(playlist_t *playlist)
+{
+   size_t i, num_entries;
+   int64_t size, mtime;
+   char path[PATH_MAX_LENGTH];
+   const playlist_cache_header_t *header  = NULL;
+   const playlist_cache_entry_t *records = NULL;
+   char *strings                         = NULL;
+   bool ok                               = true;
+
+   if (!playlist_file_stat(playlist->config.path, &size, &mtime))
+      return false;
+
+   playlist_cache_path(playlist, path, sizeof(path));
+
+   if (!path_is_valid(path) || !playlist_map_cache(playlist, path))
+      return false;
+
+   header = (const playlist_cache_header_t*)playlist->cache;
+
+   if (     playlist->cache_size < sizeof(*header)
+         || header->magic        != PLAYLIST_CACHE_MAGIC
+         || header->version      != PLAYLIST_CACHE_VERSION
+         || header->entry_size   != sizeof(playlist_cache_entry_t)
+         || header->source_size  != size
+         || header->source_mtime != mtime
+         || header->strings_size == 0
+         || playlist->cache_size != sizeof(*header)
+               + (size_t)header->num_entries * sizeof(*records)
+               + header->strings_size)
+      goto error;
+
+   /* A playlist read in part does not do for a larger capacity */
+   num_entries = header->num_entries;
+   if (num_entries > playlist->config.capacity)
+      num_entries = playlist->config.capacity;
+   else if (!header->complete && num_entries < playlist->config.capacity)
+      goto error;
+
+   records = (const playlist_cache_entry_t*)(header + 1);
+   strings = (char*)(records + header->num_entries);
+
+   if (strings[header->strings_size - 1] != '\0')
+      goto error;
+
+   playlist->default_core_path      = playlist_cache_string(strings,
+         header->strings_size, header->default_core_path, &ok);
+   playlist->default_core_name      = playlist_cache_string(strings,
+         header->strings_size, header->default_core_name, &ok);
+   playlist->base_content_directory = playlist_cache_string(strings,
+         header->strings_size, header->base_content_directory, &ok);
+
+   for (i = 0; i < num_entries && ok; i++)
+   {
+      const playlist_cache_entry_t *record = &records[i];
+      struct playlist_entry *entry         = &playlist->entries[i];
+
+      entry->path               = playlist_cache_string(strings,
+            header->strings_size, record->path, &ok);
+      entry->label              = playlist_cache_string(strings,
+            header->strings_size, record->label, &ok);
+      entry->core_path          = playlist_cache_string(strings,
+            header->strings_size, record->core_path, &ok);
+      entry->core_name          = playlist_cache_string(strings,
+            header->strings_size, record->core_name, &ok);
+      entry->db_name            = playlist_cache_string(strings,
+            header->strings_size, record->db_name, &ok);
+      entry->crc32              = playlist_cache_string(strings,
+            header->strings_size, record->crc32, &ok);
+      entry->subsystem_ident    = playlist_cache_string(strings,
+            header->strings_size, record->subsystem_ident, &ok);
+      entry->subsystem_name     = playlist_cache_string(strings,
+            header->strings_size, record->subsystem_name, &ok);
+      entry->runtime_str        = playlist_cache_string(strings,
+            header->strings_size, record->runtime_str, &ok);
+      entry->last_played_str    = playlist_cache_string(strings,
+            header->strings_size, record->last_played_str, &ok);
+      entry->runtime_status     = (enum playlist_runtime_status)
+         record->runtime_status;
+      entry->runtime_hours      = record->runtime_hours;
+      entry->runtime_minutes    = record->runtime_minutes;
+      entry->runtime_seconds    = record->runtime_seconds;
+      entry->last_played_year   = record->last_played_year;
+      entry->last_played_month  = record->last_played_month;
+      entry->last_played_day    = record->last_played_day;
+      entry->last_played_hour   = record->last_played_hour;
+      entry->last_played_minute = record->last_played_minute;
+      entry->last_played_second = record->last_played_second;
+      entry->subsystem_roms     = NULL;
+
+      /* Rare enough to be allocated */
+      if (record->num_subsystem_roms)
+      {
+         unsigned j;
+         union string_list_elem_attr attr;
+         uint32_t offset = record->subsystem_roms;
+
+         attr.i                = 0;
+         entry->subsystem_roms = string_list_new();
+
+         for (j = 0; j < record->num_subsystem_roms && ok; j++)
+         {
+            const char *rom = playlist_cache_string(strings,
+                  header->strings_size, offset, &ok);
+
+            if (!ok || !rom || !entry->subsystem_roms)
+            {
+               ok = false;
+               break;
+            }
+
+            string_list_append(entry->subsystem_roms, rom, attr);
+            offset += (uint32_t)strlen(rom) + 1;
+         }
+      }
+   }
+
+   if (!ok)
+   {
+      /* Leave nothing pointing into the cache */
+      for (i = 0; i < num_entries; i++)
+         string_list_free(playlist->entries[i].subsystem_roms);
+      memset(playlist->entries, 0, num_entries * sizeof(*playlist->entries));
+      playlist->default_core_path      = NULL;
+      playlist->default_core_name      = NULL;
+      playlist->base_content_directory = NULL;
+      goto error;
+   }
+
+   /* Like a playlist parsed with entries to spare, it is
+    * written again with those it kept */
+   playlist->modified             = header->truncated
+      || header->num_entries > num_entries;
+   playlist->size                 = num_entries;
+   playlist->old_format           = header->old_format != 0;
+   playlist->compressed           = header->compressed != 0;
+   playlist->label_display_mode   = (enum playlist_label_display_mode)
+      header->label_display_mode;
+   playlist->right_thumbnail_mode = (enum playlist_thumbnail_mode)
+      header->right_thumbnail_mode;
+   playlist->left_thumbnail_mode  = (enum playlist_thumbnail_mode)
+      header->left_thumbnail_mode;
+   playlist->sort_mode            = (enum playlist_sort_mode)
+      header->sort_mode;
+   return true;
+
+error:
+   playlist_release_cache(playlist);
+   return false;
+}
+
+static void playlist_journal_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   fill_pathname(s, playlist->config.path,
+         file_path_str(FILE_PATH_LPL_JOURNAL_EXTENSION), len);
+}
+
+/* Drops the journal of @playlist before its file is written in
+ * full. Until that succeeds, changes are not journaled. */
+static void playlist_delete_journal(playlist_t *playlist)
+{
+   char path[PATH_MAX_LENGTH];
+
+   playlist_journal_path(playlist, path, sizeof(path));
+   filestream_delete(path);
+
+   playlist->journal_len     = 0;
+   playlist->journal_pending = 0;
+   playlist->journal_size    = 0;
+   playlist->journal_records = 0;
+   playlist->journal_invalid = true;
+}
+
+/**
+ * playlist_write_journal:
+ * @playlist            : Playlist handle.
+ *
+ * Appends the changes made to @playlist since it was last
+ * written to its journal, if they can all be recorded there and
+ * the journal is still the one last read or written.
+ *
+ * Returns: true if they were appended, false if the playlist
+ * has to be written in full.
+ **/
+static bool playlist_write_journal(playlist_t *playlist)
+{
+   int64_t size, mtime;
+   uint32_t crc;
+   char path[PATH_MAX_LENGTH];
+   RFILE *file  = NULL;
+   bool written = false;
+
+   if (     !playlist->journal_enabled
+         ||  playlist->journal_invalid
+         || !playlist->journal_pending
+         ||  playlist->old_format
+         ||  playlist->config.old_format
+#if defined(HAVE_ZLIB)
+         ||  playlist->compressed != playlist->config.compress
+#endif
+         ||  playlist->journal_records + playlist->journal_pending
+               > PLAYLIST_JOURNAL_MAX_RECORDS
+         || !playlist_file_stat(playlist->config.path, &size, &mtime)
+         || !playlist_file_crc32(playlist->config.path, &crc))
+      return false;
+
+   playlist_journal_path(playlist, path, sizeof(path));
+
+   if (playlist->journal_records)
+   {
+      /* Rewritten by someone else since */
+      if (     size  != playlist->journal_base_size
+            || mtime != playlist->journal_base_mtime
+            || crc   != playlist->journal_base_crc)
+         return false;
+
+      if (!(file = filestream_open(path,
+                  RETRO_VFS_FILE_ACCESS_WRITE
+                  | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return false;
+
+      /* Another playlist handle may have written it */
+      if (filestream_get_size(file) != playlist->journal_size)
+         goto end;
+
+      filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END);
+   }
+   else
+   {
+      playlist_journal_header_t header;
+
+      memset(&header, 0, sizeof(header));
+      header.magic      = PLAYLIST_JOURNAL_MAGIC;
+      header.version    = PLAYLIST_JOURNAL_VERSION;
+      header.base_size  = size;
+      header.base_mtime = mtime;
+      header.base_crc   = crc;
+
+      if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return false;
+
+      if (filestream_write(file, &header, sizeof(header)) != sizeof(header))
+         goto end;
+
+      playlist->journal_size       = sizeof(header);
+      playlist->journal_base_size  = size;
+      playlist->journal_base_mtime = mtime;
+      playlist->journal_base_crc   = crc;
+   }
+
+   written = filestream_write(file, playlist->journal,
+         playlist->journal_len) == (int64_t)playlist->journal_len;
+
+end:
+   if (filestream_close(file) != 0)
+      written = false;
+
+   /* Whatever made it to the journal is dropped by writing
+    * the playlist in full */
+   if (!written)
+      return false;
+
+   RARCH_LOG("[Playlist]: Journaled %u change(s) to playlist file: %s\n",
+         playlist->journal_pending, playlist->config.path);
+
+   playlist->journal_size    += playlist->journal_len;
+   playlist->journal_records += playlist->journal_pending;
+   playlist->journal_len      = 0;
+   playlist->journal_pending  = 0;
+   playlist->modified         = false;
+   return true;
+}
+
+/* Reads a value of a journal record. Returns false if the
+ * record ends first. */
+static bool playlist_journal_get_u32(const uint8_t **data,
+      const uint8_t *end, uint32_t *value)
+{
+   if ((size_t)(end - *data) < sizeof(*value))
+      return false;
+
+   memcpy(value, *data, sizeof(*value));
+   *data += sizeof(*value);
+   return true;
+}
+
+static bool playlist_journal_get_string(const uint8_t **data,
+      const uint8_t *end, const char **str)
+{
+   uint32_t len;
+
+   if (!playlist_journal_get_u32(data, end, &len))
+      return false;
+
+   *str = NULL;
+
+   if (!len)
+      return true;
+
+   if ((size_t)(end - *data) < len || (*data)[len - 1] != '\0')
+      return false;
+
+   *str   = (const char*)*data;
+   *data += len;
+   return true;
+}
+
+/* Values of an entry as recorded in a journal record */
+typedef struct playlist_journal_entry
+{
+   /* Point into the record */
+   const char *str[8];
+   struct string_list *subsystem_roms;
+} playlist_journal_entry_t;
+
+/* Reads and checks the entry values that end the record at @data.
+ * On success, @values->subsystem_roms has to be handed on to
+ * playlist_journal_set_entry() or freed. */
+static bool playlist_journal_get_entry(playlist_journal_entry_t *values,
+      const uint8_t *data, const uint8_t *end)
+{
+   unsigned i;
+   uint32_t num_roms;
+
+   values->subsystem_roms = NULL;
+
+   for (i = 0; i < 8; i++)
+      if (!playlist_journal_get_string(&data, end, &values->str[i]))
+         return false;
+
+   if (!playlist_journal_get_u32(&data, end, &num_roms))
+      return false;
+
+   for (i = 0; i < num_roms; i++)
+   {
+      const char *rom = NULL;
+      union string_list_elem_attr attr;
+
+      attr.i = 0;
+
+      if (     !playlist_journal_get_string(&data, end, &rom) || !rom
+            || (!values->subsystem_roms
+               && !(values->subsystem_roms = string_list_new()))
+            || !string_list_append(values->subsystem_roms, rom, attr))
+         goto error;
+   }
+
+   if (data != end)
+      goto error;
+
+   return true;
+
+error:
+   string_list_free(values->subsystem_roms);
+   values->subsystem_roms = NULL;
+   return false;
+}
+
+/* Gives @entry the values read by playlist_journal_get_entry() */
+static void playlist_journal_set_entry(playlist_t *playlist,
+      struct playlist_entry *entry, playlist_journal_entry_t *values)
+{
+   unsigned i;
+   char **fields[8];
+
+   fields[0] = &entry->path;
+   fields[1] = &entry->label;
+   fields[2] = &entry->core_path;
+   fields[3] = &entry->core_name;
+   fields[4] = &entry->db_name;
+   fields[5] = &entry->crc32;
+   fields[6] = &entry->subsystem_ident;
+   fields[7] = &entry->subsystem_name;
+
+   for (i = 0; i < 8; i++)
+   {
+      if (*fields[i])
+         playlist_free_str(playlist, *fields[i]);
+      *fields[i] = values->str[i] ? strdup(values->str[i]) : NULL;
+   }
+
+   string_list_free(entry->subsystem_roms);
+   entry->subsystem_roms  = values->subsystem_roms;
+   values->subsystem_roms = NULL;
+}
+
+/* Makes the change recorded at @data, as the functions that
+ * recorded it made it. The playlist is left as it was if the
+ * record is invalid. */
+static bool playlist_journal_apply(playlist_t *playlist,
+      const uint8_t *data, const uint8_t *end)
+{
+   uint32_t op, idx;
+   playlist_journal_entry_t values;
+   struct playlist_entry *entries = playlist->entries;
+
+   if (     !playlist_journal_get_u32(&data, end, &op)
+         || !playlist_journal_get_u32(&data, end, &idx))
+      return false;
+
+   switch (op)
+   {
+      case PLAYLIST_JOURNAL_PUSH:
+         if (idx == PLAYLIST_JOURNAL_NEW)
+         {
+            if (     !playlist->config.capacity
+                  || !playlist_journal_get_entry(&values, data, end))
+               return false;
+
+            if (playlist->size == playlist->config.capacity)
+            {
+               playlist_free_entry(playlist, &entries[playlist->size - 1]);
+               playlist->size--;
+            }
+
+            memmove(entries + 1, entries,
+                  playlist->size * sizeof(struct playlist_entry));
+            memset(&entries[0], 0, sizeof(struct playlist_entry));
+            playlist->size++;
+         }
+         else
+         {
+            struct playlist_entry tmp;
+
+            if (     idx >= playlist->size
+                  || !playlist_journal_get_entry(&values, data, end))
+               return false;
+
+            tmp = entries[idx];
+            memmove(entries + 1, entries,
+                  idx * sizeof(struct playlist_entry));
+            entries[0] = tmp;
+         }
+
+         playlist_journal_set_entry(playlist, &entries[0], &values);
+         return true;
+      case PLAYLIST_JOURNAL_UPDATE:
+         if (     idx >= playlist->size
+               || !playlist_journal_get_entry(&values, data, end))
+            return false;
+
+         playlist_journal_set_entry(playlist, &entries[idx], &values);
+         return true;
+      case PLAYLIST_JOURNAL_DELETE:
+         if (idx >= playlist->size || data != end)
+            return false;
+
+         playlist_free_entry(playlist, &entries[idx]);
+         playlist->size--;
+         memmove(entries + idx, entries + idx + 1,
+               (playlist->size - idx) * sizeof(struct playlist_entry));
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/**
+ * playlist_read_journal:
+ * @playlist            : Playlist handle.
+ *
+ * Makes the changes recorded in the journal of @playlist, once
+ * its file has been read. A journal made for another version of
+ * the file is ignored. Records cut short or corrupted by a crash
+ * end the journal; the playlist is then written in full on the
+ * next change.
+ **/
+static void playlist_read_journal(playlist_t *playlist)
+{
+   int64_t size, mtime;
+   uint32_t crc;
+   char path[PATH_MAX_LENGTH];
+   const playlist_journal_header_t *header = NULL;
+   const uint8_t *data                     = NULL;
+   const uint8_t *end                      = NULL;
+   void *buf                               = NULL;
+   int64_t len                             = 0;
+   unsigned records                        = 0;
+
+   playlist_journal_path(playlist, path, sizeof(path));
+
+   if (!path_is_valid(path))
+      return;
+
+   if (!filestream_read_file(path, &buf, &len))
+      goto error;
+
+   header = (const playlist_journal_header_t*)buf;
+
+   if (     (size_t)len < sizeof(*header)
+         || header->magic   != PLAYLIST_JOURNAL_MAGIC
+         || header->version != PLAYLIST_JOURNAL_VERSION
+         || !playlist_file_stat(playlist->config.path, &size, &mtime)
+         || header->base_size  != size
+         || header->base_mtime != mtime
+         || !playlist_file_crc32(playlist->config.path, &crc)
+         || header->base_crc   != crc)
+      goto error;
+
+   data = (const uint8_t*)(header + 1);
+   end  = (const uint8_t*)buf + len;
+
+   while (data < end)
+   {
+      uint32_t record[2];
+
+      if ((size_t)(end - data) < sizeof(record))
+         break;
+
+      memcpy(record, data, sizeof(record));
+
+      if (     (size_t)(end - data - sizeof(record)) < record[0]
+            || encoding_crc32(0, data + sizeof(record), record[0])
+               != record[1]
+            || !playlist_journal_apply(playlist, data + sizeof(record),
+               data + sizeof(record) + record[0]))
+         break;
+
+      data += sizeof(record) + record[0];
+      records++;
+   }
+
+   if (data != end)
+   {
+      RARCH_WARN("[Playlist]: Journal of playlist file ends early: %s\n",
+            playlist->config.path);
+      playlist->journal_invalid = true;
+   }
+
+   playlist->journal_size       = len;
+   playlist->journal_records    = records;
+   playlist->journal_base_size  = size;
+   playlist->journal_base_mtime = mtime;
+   playlist->journal_base_crc   = crc;
+   free(buf);
+   return;
+
+error:
+   /* Not for this playlist file, and not to be added to */
+   playlist->journal_invalid = true;
+   free(buf);
+}
+
 void playlist_write_runtime_file(playlist_t *playlist)
 {
    size_t i;
@@ -1171,6 +2461,9 @@ void playlist_write_runtime_file(playlist_t *playlist)
    if (!playlist || !playlist->modified)
       return;
 
+   playlist_delete_cache(playlist);
+   playlist_delete_journal(playlist);
+
    file = intfstream_open_file(playlist->config.path,
          RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
@@ -1386,9 +2679,10 @@ void playlist_write_runtime_file(playlist_t *playlist)
    JSON_Writer_WriteNewLine(context.writer);
    JSON_Writer_Free(context.writer);
 
-   playlist->modified   = false;
-   playlist->old_format = false;
-   playlist->compressed = false;
+   playlist->modified        = false;
+   playlist->old_format      = false;
+   playlist->compressed      = false;
+   playlist->journal_invalid = false;
 
    RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
 end:
@@ -1429,6 +2723,13 @@ void playlist_write_file(playlist_t *playlist)
         (playlist->old_format != playlist->config.old_format)))
       return;
 
+   if (playlist_write_journal(playlist))
+      return;
+
+   /* Made again when the playlist is next read */
+   playlist_delete_cache(playlist);
+   playlist_delete_journal(playlist);
+
 #if defined(HAVE_ZLIB)
    if (playlist->config.compress)
       file = intfstream_open_rzip_file(playlist->config.path,
@@ -1823,8 +3124,9 @@ void playlist_write_file(playlist_t *playlist)
       playlist->old_format = false;
    }
 
-   playlist->modified   = false;
-   playlist->compressed = compressed;
+   playlist->modified        = false;
+   playlist->compressed      = compressed;
+   playlist->journal_invalid = false;
 
    RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
 end:
@@ -1846,15 +3148,15 @@ void playlist_free(playlist_t *playlist)
       return;
 
    if (playlist->default_core_path != NULL)
-      free(playlist->default_core_path);
+      playlist_free_str(playlist, playlist->default_core_path);
    playlist->default_core_path = NULL;
 
    if (playlist->default_core_name != NULL)
-      free(playlist->default_core_name);
+      playlist_free_str(playlist, playlist->default_core_name);
    playlist->default_core_name = NULL;
 
    if (playlist->base_content_directory != NULL)
-      free(playlist->base_content_directory);
+      playlist_free_str(playlist, playlist->base_content_directory);
    playlist->base_content_directory = NULL;
 
    if (playlist->entries)
@@ -1864,13 +3166,16 @@ void playlist_free(playlist_t *playlist)
          struct playlist_entry *entry = &playlist->entries[i];
 
          if (entry)
-            playlist_free_entry(entry);
+            playlist_free_entry(playlist, entry);
       }
 
       free(playlist->entries);
       playlist->entries = NULL;
    }
 
+   playlist_release_cache(playlist);
+   free(playlist->journal);
+
    free(playlist);
 }
 
@@ -1891,9 +3196,10 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
-   playlist->size = 0;
+   playlist->size            = 0;
+   playlist->journal_invalid = true;
 }
 
 /**
@@ -2001,7 +3307,8 @@ static JSON_Parser_HandlerResult JSONStartObjectHandler(JSON_Parser parser)
              * the playlist must be flagged as being modified
              * (i.e. the playlist is not the same as when it was
              * last saved to disk...) */
-            pCtx->playlist->modified = true;
+            pCtx->playlist->modified        = true;
+            pCtx->playlist->journal_invalid = true;
          }
       }
    }
@@ -2275,15 +3582,24 @@ static bool playlist_read_file(playlist_t *playlist)
 {
    unsigned i;
    int test_char;
+   intfstream_t *file   = NULL;
+   bool parsed          = false;
+
+   if (playlist_read_cache(playlist))
+   {
+      playlist_read_journal(playlist);
+      return true;
+   }
+
 #if defined(HAVE_ZLIB)
       /* Always use RZIP interface when reading playlists
        * > this will automatically handle uncompressed
        *   data */
-   intfstream_t *file   = intfstream_open_rzip_file(
+   file = intfstream_open_rzip_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ);
 #else
-   intfstream_t *file   = intfstream_open_file(
+   file = intfstream_open_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -2399,6 +3715,8 @@ static bool playlist_read_file(playlist_t *playlist)
          goto json_cleanup;
       }
 
+      parsed = true;
+
 json_cleanup:
 
       JSON_Parser_Free(context.parser);
@@ -2599,11 +3917,21 @@ json_cleanup:
             break;
          }
       }
+
+      parsed = true;
    }
 
 end:
    intfstream_close(file);
    free(file);
+
+   if (parsed)
+   {
+      playlist_write_cache(playlist);
+      playlist_read_journal(playlist);
+   }
+   else
+      playlist->journal_invalid = true;
    return true;
 }
 
@@ -2677,6 +4005,20 @@ playlist_t *playlist_init(const playlist_config_t *config)
    playlist->right_thumbnail_mode   = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode    = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->sort_mode              = PLAYLIST_SORT_MODE_DEFAULT;
+   playlist->cache                  = NULL;
+   playlist->cache_size             = 0;
+   playlist->cache_mapped           = false;
+   playlist->journal                = NULL;
+   playlist->journal_len            = 0;
+   playlist->journal_capacity       = 0;
+   playlist->journal_pending        = 0;
+   playlist->journal_size           = 0;
+   playlist->journal_base_size      = 0;
+   playlist->journal_base_mtime     = 0;
+   playlist->journal_base_crc       = 0;
+   playlist->journal_records        = 0;
+   playlist->journal_enabled        = false;
+   playlist->journal_invalid        = false;
 
    /* Attempt to read any existing playlist file */
    playlist_read_file(playlist);
@@ -2706,7 +4048,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
                playlist->base_content_directory, playlist->config.base_content_directory,
                sizeof(tmp_entry_path));
 
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
          entry->path = strdup(tmp_entry_path);
 
          /* Fix subsystem roms paths*/
@@ -2739,11 +4081,12 @@ playlist_t *playlist_init(const playlist_config_t *config)
       }
 
       /* Update playlist base content directory*/
-      free(playlist->base_content_directory);
+      playlist_free_str(playlist, playlist->base_content_directory);
       playlist->base_content_directory = strdup(playlist->config.base_content_directory);
 
       /* Save playlist */
-      playlist->modified = true;
+      playlist->modified        = true;
+      playlist->journal_invalid = true;
       playlist_write_file(playlist);
    }
 
@@ -2837,10 +4180,23 @@ void playlist_qsort(playlist_t *playlist)
 {
    /* Avoid inadvertent sorting if 'sort mode'
     * has been set explicitly to PLAYLIST_SORT_MODE_OFF */
+   size_t i;
+
    if (!playlist ||
        (playlist->sort_mode == PLAYLIST_SORT_MODE_OFF))
       return;
 
+   /* Leave a sorted playlist (and its journal) alone */
+   for (i = 1; i < playlist->size; i++)
+      if (playlist_qsort_func(&playlist->entries[i - 1],
+               &playlist->entries[i]) > 0)
+         break;
+
+   if (i >= playlist->size)
+      return;
+
+   playlist->journal_invalid = true;
+
    qsort(playlist->entries, playlist->size,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
@@ -3035,9 +4391,10 @@ void playlist_set_default_core_path(playlist_t *playlist, const char *core_path)
    if (!string_is_equal(playlist->default_core_path, real_core_path))
    {
       if (playlist->default_core_path)
-         free(playlist->default_core_path);
+         playlist_free_str(playlist, playlist->default_core_path);
       playlist->default_core_path = strdup(real_core_path);
-      playlist->modified = true;
+      playlist->modified          = true;
+      playlist->journal_invalid   = true;
    }
 }
 
@@ -3049,9 +4406,10 @@ void playlist_set_default_core_name(playlist_t *playlist, const char *core_name)
    if (!string_is_equal(playlist->default_core_name, core_name))
    {
       if (playlist->default_core_name)
-         free(playlist->default_core_name);
+         playlist_free_str(playlist, playlist->default_core_name);
       playlist->default_core_name = strdup(core_name);
-      playlist->modified = true;
+      playlist->modified          = true;
+      playlist->journal_invalid   = true;
    }
 }
 
@@ -3064,7 +4422,8 @@ void playlist_set_label_display_mode(playlist_t *playlist,
    if (playlist->label_display_mode != label_display_mode)
    {
       playlist->label_display_mode = label_display_mode;
-      playlist->modified = true;
+      playlist->modified           = true;
+      playlist->journal_invalid    = true;
    }
 }
 
@@ -3080,10 +4439,12 @@ void playlist_set_thumbnail_mode(
       case PLAYLIST_THUMBNAIL_RIGHT:
          playlist->right_thumbnail_mode = thumbnail_mode;
          playlist->modified             = true;
+         playlist->journal_invalid      = true;
          break;
       case PLAYLIST_THUMBNAIL_LEFT:
          playlist->left_thumbnail_mode = thumbnail_mode;
          playlist->modified            = true;
+         playlist->journal_invalid     = true;
          break;
    }
 }
@@ -3095,11 +4456,26 @@ void playlist_set_sort_mode(playlist_t *playlist, enum playlist_sort_mode sort_m
 
    if (playlist->sort_mode != sort_mode)
    {
-      playlist->sort_mode = sort_mode;
-      playlist->modified  = true;
+      playlist->sort_mode       = sort_mode;
+      playlist->modified        = true;
+      playlist->journal_invalid = true;
    }
 }
 
+void playlist_set_journal(playlist_t *playlist, bool enable)
+{
+   if (!playlist)
+      return;
+
+   /* Changes made so far were not recorded */
+   if (enable && !playlist->journal_enabled && playlist->modified)
+      playlist->journal_invalid = true;
+
+   playlist->journal_enabled = enable;
+   playlist->journal_len     = 0;
+   playlist->journal_pending = 0;
+}
+
 /* Returns true if specified entry has a valid
  * core association (i.e. a non-empty string
  * other than DETECT) */
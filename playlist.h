@@ -332,6 +332,15 @@ void playlist_set_thumbnail_mode(
       playlist_t *playlist, enum playlist_thumbnail_id thumbnail_id, enum playlist_thumbnail_mode thumbnail_mode);
 void playlist_set_sort_mode(playlist_t *playlist, enum playlist_sort_mode sort_mode);
 
+/* Sets whether playlist_write_file() appends the changes made
+ * since the last write to a journal next to the playlist file,
+ * instead of writing the whole playlist, as long as they are
+ * entries pushed, updated or deleted. The journal is applied
+ * whenever the playlist is read, and is written into the
+ * playlist file once it has grown large. Meant for playlists
+ * written after every change, like histories. */
+void playlist_set_journal(playlist_t *playlist, bool enable);
+
 /* Returns true if specified entry has a valid
  * core association (i.e. a non-empty string
  * other than DETECT) */
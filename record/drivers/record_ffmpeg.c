@@ -24,7 +24,7 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
@@ -237,10 +237,11 @@ typedef struct ffmpeg
 
    scond_t *cond;
    slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   /* Only written by the frontend and read by ffmpeg_thread(). The
+    * cond above is just for sleeping when there is nothing to do. */
+   spsc_queue_t *audio_fifo;
+   spsc_queue_t *video_fifo;
+   spsc_queue_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
@@ -927,20 +928,19 @@ static void ffmpeg_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
    handle->cond_lock = slock_new();
    handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
-         handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+   handle->audio_fifo = spsc_queue_new(32000 * sizeof(int16_t) *
+         handle->params.channels * MAX_FRAMES / 60, 0); /* Some arbitrary max size. */
+   handle->attr_fifo = spsc_queue_new(sizeof(struct record_video_data) * MAX_FRAMES, 0);
+   handle->video_fifo = spsc_queue_new(handle->params.fb_width * handle->params.fb_height *
+            handle->video.pix_size * MAX_FRAMES, 0);
 
    handle->alive = true;
    handle->can_sleep = true;
    handle->thread = sthread_create(ffmpeg_thread, handle);
 
-   retro_assert(handle->lock && handle->cond_lock &&
+   retro_assert(handle->cond_lock &&
       handle->cond && handle->audio_fifo &&
       handle->attr_fifo && handle->video_fifo && handle->thread);
 
@@ -960,7 +960,6 @@ static void deinit_thread(ffmpeg_t *handle)
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
@@ -971,19 +970,19 @@ static void deinit_thread_buf(ffmpeg_t *handle)
 {
    if (handle->audio_fifo)
    {
-      fifo_free(handle->audio_fifo);
+      spsc_queue_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
 
    if (handle->attr_fifo)
    {
-      fifo_free(handle->attr_fifo);
+      spsc_queue_free(handle->attr_fifo);
       handle->attr_fifo = NULL;
    }
 
    if (handle->video_fifo)
    {
-      fifo_free(handle->video_fifo);
+      spsc_queue_free(handle->video_fifo);
       handle->video_fifo = NULL;
    }
 }
@@ -1101,6 +1100,7 @@ static bool ffmpeg_push_video(void *data,
 {
    unsigned y;
    struct record_video_data attr_data;
+   void *span       = NULL;
    bool drop_frame  = false;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int       offset = 0;
@@ -1118,11 +1118,7 @@ static bool ffmpeg_push_video(void *data,
 
    for (;;)
    {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->attr_fifo);
-      slock_unlock(handle->lock);
+      size_t avail = spsc_queue_write_avail(handle->attr_fifo);
 
       if (!handle->alive)
          return false;
@@ -1143,8 +1139,6 @@ static bool ffmpeg_push_video(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
-
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
@@ -1155,13 +1149,27 @@ static bool ffmpeg_push_video(void *data,
    else
       attr_data.pitch = attr_data.width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
-
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   /* Pack the rows straight into the queue when they fit without
+    * wrapping around, so the frame is published in one go. */
+   if (spsc_queue_write_span(handle->video_fifo, &span)
+         >= attr_data.height * attr_data.pitch)
+   {
+      for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
+         memcpy((uint8_t*)span + y * attr_data.pitch,
+               (const uint8_t*)vid->data + offset, attr_data.pitch);
+      spsc_queue_write_commit(handle->video_fifo,
+            attr_data.height * attr_data.pitch);
+   }
+   else
+   {
+      for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
+         spsc_queue_write(handle->video_fifo,
+               (const uint8_t*)vid->data + offset, attr_data.pitch);
+   }
 
-   slock_unlock(handle->lock);
+   /* The frame becomes visible to the thread with its attributes,
+    * so these go last. */
+   spsc_queue_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
    scond_signal(handle->cond);
 
    return true;
@@ -1180,11 +1188,7 @@ static bool ffmpeg_push_audio(void *data,
 
    for (;;)
    {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->audio_fifo);
-      slock_unlock(handle->lock);
+      size_t avail = spsc_queue_write_avail(handle->audio_fifo);
 
       if (!handle->alive)
          return false;
@@ -1206,10 +1210,8 @@ static bool ffmpeg_push_audio(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
+   spsc_queue_write(handle->audio_fifo, audio_data->data,
          audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
    scond_signal(handle->cond);
 
    return true;
@@ -1575,16 +1577,42 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
    return true;
 }
 
+/* Encodes one codec frame worth of queued audio. It is read straight
+ * from the queue unless it wraps around, in which case it is copied
+ * to @audio_buf first. */
+static void ffmpeg_pop_audio(ffmpeg_t *handle, void *audio_buf,
+      size_t audio_buf_size)
+{
+   const void *span             = NULL;
+   struct record_audio_data aud = {0};
+   bool contiguous              = spsc_queue_read_span(
+         handle->audio_fifo, &span) >= audio_buf_size;
+
+   if (contiguous)
+      aud.data = span;
+   else
+   {
+      spsc_queue_read(handle->audio_fifo, audio_buf, audio_buf_size);
+      aud.data = audio_buf;
+   }
+
+   aud.frames = handle->audio.codec->frame_size;
+   ffmpeg_push_audio_thread(handle, &aud, true);
+
+   if (contiguous)
+      spsc_queue_read_commit(handle->audio_fifo, audio_buf_size);
+}
+
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = FIFO_READ_AVAIL(handle->audio_fifo);
+   size_t avail = spsc_queue_read_avail(handle->audio_fifo);
 
    if (avail)
    {
       struct record_audio_data aud = {0};
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      spsc_queue_read(handle->audio_fifo, audio_buf, avail);
 
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
       aud.data = audio_buf;
@@ -1624,23 +1652,17 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
       if (handle->config.audio_enable)
       {
-         if (FIFO_READ_AVAIL(handle->audio_fifo) >= audio_buf_size)
+         if (spsc_queue_read_avail(handle->audio_fifo) >= audio_buf_size)
          {
-            struct record_audio_data aud = {0};
-
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
-            aud.frames = handle->audio.codec->frame_size;
-            aud.data   = audio_buf;
-            ffmpeg_push_audio_thread(handle, &aud, true);
-
+            ffmpeg_pop_audio(handle, audio_buf, audio_buf_size);
             did_work = true;
          }
       }
 
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_queue_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
+         spsc_queue_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_queue_read(handle->video_fifo, video_buf,
                attr_buf.height * attr_buf.pitch);
          attr_buf.data = video_buf;
          ffmpeg_push_video_thread(handle, &attr_buf);
@@ -1704,14 +1726,12 @@ static void ffmpeg_thread(void *data)
       bool avail_video = false;
       bool avail_audio = false;
 
-      slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_queue_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
          avail_video = true;
 
       if (ff->config.audio_enable)
-         if (FIFO_READ_AVAIL(ff->audio_fifo) >= audio_buf_size)
+         if (spsc_queue_read_avail(ff->audio_fifo) >= audio_buf_size)
             avail_audio = true;
-      slock_unlock(ff->lock);
 
       if (!avail_video && !avail_audio)
       {
@@ -1730,11 +1750,9 @@ static void ffmpeg_thread(void *data)
 
       if (avail_video && video_buf)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
+         spsc_queue_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_queue_read(ff->video_fifo, video_buf,
                attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
          scond_signal(ff->cond);
 
          attr_buf.data = video_buf;
@@ -1743,17 +1761,8 @@ static void ffmpeg_thread(void *data)
 
       if (avail_audio && audio_buf)
       {
-         struct record_audio_data aud = {0};
-
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
+         ffmpeg_pop_audio(ff, audio_buf, audio_buf_size);
          scond_signal(ff->cond);
-
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data   = audio_buf;
-
-         ffmpeg_push_audio_thread(ff, &aud, true);
       }
    }
 
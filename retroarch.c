@@ -130,6 +130,8 @@
 #include "config.def.keybinds.h"
 
 #include "runtime_file.h"
+#include "benchmark.h"
+#include "performance_trace.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -161,6 +163,11 @@
 #include "menu/menu_shader.h"
 #endif
 
+#ifdef HAVE_SLANG
+#include "gfx/drivers_shader/slang_cache.h"
+#include "gfx/drivers_shader/slang_process.h"
+#endif
+
 #ifdef HAVE_GFX_WIDGETS
 #include "gfx/gfx_widgets.h"
 #endif
@@ -205,6 +212,7 @@
 #include "config.features.h"
 #include "cores/internal_cores.h"
 #include "content.h"
+#include "content_fingerprint.h"
 #include "core_type.h"
 #include "core_info.h"
 #include "dynamic.h"
@@ -222,6 +230,7 @@
 #endif
 #include "gfx/video_display_server.h"
 #include "gfx/video_crt_switch.h"
+#include "gfx/video_frame_delay.h"
 #include "bluetooth/bluetooth_driver.h"
 #include "wifi/wifi_driver.h"
 #include "led/led_driver.h"
@@ -255,6 +264,7 @@
 #endif
 
 #ifdef HAVE_THREADS
+#include "audio/audio_pipeline.h"
 #include "audio/audio_thread_wrapper.h"
 #endif
 
@@ -1473,8 +1483,12 @@ static const camera_driver_t *camera_drivers[] = {
 
 #ifdef _WIN32
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+#define PERF_HISTOGRAM_LOG_FMT "[PERF]: %s: %I64u runs, mean %I64u, " \
+   "p50 <= %I64u, p90 <= %I64u, p99 <= %I64u, max %I64u ticks.\n"
 #else
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+#define PERF_HISTOGRAM_LOG_FMT "[PERF]: %s: %llu runs, mean %llu, " \
+   "p50 <= %llu, p90 <= %llu, p99 <= %llu, max %llu ticks.\n"
 #endif
 
 #ifdef HAVE_MENU
@@ -1516,9 +1530,16 @@ enum
    RA_OPT_MAX_FRAMES,
    RA_OPT_MAX_FRAMES_SCREENSHOT,
    RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
+   RA_OPT_BENCHMARK,
+   RA_OPT_BENCHMARK_FEATURES,
+   RA_OPT_BENCHMARK_REPORT,
+   RA_OPT_PERF_TRACE,
+   RA_OPT_PERF_TRACE_FRAMES,
+   RA_OPT_PERF_HISTOGRAMS,
    RA_OPT_SET_SHADER,
    RA_OPT_ACCESSIBILITY,
-   RA_OPT_LOAD_MENU_ON_ERROR
+   RA_OPT_LOAD_MENU_ON_ERROR,
+   RA_OPT_COMPILE_SHADER
 };
 
 enum  runloop_state
@@ -1820,8 +1841,30 @@ struct menu_state
       size_t begin;
       rarch_setting_t *list_settings;
       menu_list_t *list;
+      /* Last menu_file_list_cbs_t cache_id handed out */
+      uint32_t cache_id;
+      /* Callbacks bound for the last playlist entry,
+       * see menu_cbs_init_shared() */
+      menu_file_list_cbs_t shared_cbs;
+      const menu_ctx_driver_t *shared_cbs_driver;
+      unsigned shared_cbs_type;
+      char shared_cbs_menu_label[256];
    } entries;
 
+   /* Sublabels and titles that never change, kept for the entries
+    * last shown instead of in every entry of every list */
+   struct
+   {
+      uint32_t id;
+      char str[MENU_SUBLABEL_MAX_LENGTH];
+   } sublabel_cache[MENU_SUBLABEL_CACHE_SIZE];
+
+   struct
+   {
+      uint32_t id;
+      char str[MENU_TITLE_MAX_LENGTH];
+   } title_cache[MENU_TITLE_CACHE_SIZE];
+
    /* Quick jumping indices with L/R.
     * Rebuilt when parsing directory. */
    struct
@@ -1831,6 +1874,17 @@ struct menu_state
       unsigned acceleration;
    } scroll;
 
+   /* Long list the selection buffer holds a window of,
+    * see menu_entries_append_virtual(). Kept while other
+    * lists are shown, so the window can be restored when
+    * the list is returned to. */
+   menu_virtual_list_t virtual_list;
+   /* The selection buffer currently holds virtual_list */
+   bool virtual_list_shown;
+   /* scroll.index_list holds list indices of virtual_list,
+    * built over all of its entries rather than the window */
+   bool virtual_list_scroll;
+
    size_t   selection_ptr;
 
    /* Timers */
@@ -1996,7 +2050,13 @@ struct rarch_state
    bool runloop_core_shutdown_initiated;
    bool runloop_core_running;
    bool runloop_perfcnt_enable;
+   bool benchmark_rewind_enable;
+   bool benchmark_run_ahead_enabled;
    bool video_driver_window_title_update;
+   bool video_frame_delay_auto_active;
+   /* The driver swapped buffers through video_driver_swap_buffers()
+    * during the last frame */
+   bool video_driver_frame_swap_timed;
 
    /**
     * dynamic.c:dynamic_request_hw_context will try to set
@@ -2182,6 +2242,11 @@ struct rarch_state
    unsigned runloop_pending_windowed_scale;
    unsigned runloop_max_frames;
    unsigned fastforward_after_frames;
+   unsigned benchmark_frames;
+   unsigned benchmark_features;
+   unsigned benchmark_run_ahead_frames;
+   unsigned perf_trace_skip;
+   unsigned perf_trace_frames;
 
 #ifdef HAVE_MENU
    unsigned menu_input_dialog_keyboard_type;
@@ -2218,6 +2283,8 @@ struct rarch_state
       AUDIO_BUFFER_FREE_SAMPLES_COUNT];
    unsigned perf_ptr_rarch;
    unsigned perf_ptr_libretro;
+   unsigned perf_cap_rarch;
+   unsigned perf_cap_libretro;
 
    /* Opaque handles to currently running window.
     * Used by e.g. input drivers which bind to a window.
@@ -2240,11 +2307,14 @@ struct rarch_state
 
    float input_driver_axis_threshold;
 
-   float *audio_driver_input_data;
-   float *audio_driver_output_samples_buf;
+   audio_pipeline_t audio_driver_pipeline;
 
    retro_time_t frame_limit_minimum_time;
    retro_time_t frame_limit_last_time;
+   retro_time_t frame_delay_auto_last_time;
+   retro_time_t video_driver_frame_submit_time;
+   /* Part of the above spent swapping buffers */
+   retro_time_t video_driver_frame_swap_time;
    retro_time_t libretro_core_runtime_last;
    retro_time_t libretro_core_runtime_usec;
    retro_time_t video_driver_frame_time_samples[
@@ -2289,6 +2359,8 @@ struct rarch_state
 #ifdef HAVE_SCREENSHOTS
    char runloop_max_frames_screenshot_path[PATH_MAX_LENGTH];
 #endif
+   char benchmark_report_path[PATH_MAX_LENGTH];
+   char perf_trace_path[PATH_MAX_LENGTH];
    char runtime_content_path[PATH_MAX_LENGTH];
    char runtime_core_path[PATH_MAX_LENGTH];
    char subsystem_path[PATH_MAX_LENGTH];
@@ -2313,8 +2385,8 @@ struct rarch_state
 #endif
 #endif
 
-   struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
-   struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
+   struct retro_perf_counter **perf_counters_rarch;
+   struct retro_perf_counter **perf_counters_libretro;
 
    const struct retro_keybind *libretro_input_binds[MAX_USERS];
 
@@ -2327,6 +2399,15 @@ struct rarch_state
    struct menu_bind_state menu_input_binds;
 #endif
    videocrt_switch_t crt_switch_st;
+   video_frame_delay_auto_t video_frame_delay_auto;
+
+   struct retro_perf_counter core_run_perf;
+   struct retro_perf_counter video_driver_frame_perf;
+   struct retro_perf_counter video_filter_perf;
+   struct retro_perf_counter core_serialize_perf;
+   struct retro_perf_counter input_poll_perf;
+   struct retro_perf_counter audio_flush_perf;
+   struct retro_perf_counter audio_mixer_perf;
 
    gfx_thumbnail_state_t gfx_thumb_state;
 
@@ -2486,6 +2567,8 @@ struct rarch_state
    void               *video_driver_state_buffer;
 #endif
 
+   benchmark_t *benchmark;
+
    const void *frame_cache_data;
 
    void *video_driver_data;
@@ -4239,6 +4322,49 @@ static void menu_cbs_init(
          bind_info.idx);
 }
 
+/* Playlist entries bind to callbacks that only depend on their
+ * type and the menu they are in, not on the content path in
+ * their label. Binding them one by one is most of the time taken
+ * to list a large playlist, so the callbacks bound for one entry
+ * are copied to the next ones. */
+static void menu_cbs_init_shared(
+      struct rarch_state *p_rarch,
+      file_list_t *list,
+      menu_file_list_cbs_t *cbs,
+      const char *path, const char *label,
+      unsigned type, size_t idx)
+{
+   uint32_t cache_id;
+   struct menu_state *menu_st = &p_rarch->menu_driver_state;
+   const char *menu_label     = NULL;
+
+   menu_entries_get_last_stack(NULL, &menu_label, NULL, NULL, NULL);
+
+   if (     !menu_label
+         || menu_st->entries.shared_cbs_driver != p_rarch->menu_driver_ctx
+         || menu_st->entries.shared_cbs_type   != type
+         || menu_st->entries.shared_cbs.enum_idx != cbs->enum_idx
+         || !string_is_equal(menu_st->entries.shared_cbs_menu_label,
+            menu_label))
+   {
+      menu_cbs_init(p_rarch, list, cbs, path, label, type, idx);
+
+      if (menu_label)
+      {
+         menu_st->entries.shared_cbs        = *cbs;
+         menu_st->entries.shared_cbs_driver = p_rarch->menu_driver_ctx;
+         menu_st->entries.shared_cbs_type   = type;
+         strlcpy(menu_st->entries.shared_cbs_menu_label, menu_label,
+               sizeof(menu_st->entries.shared_cbs_menu_label));
+      }
+      return;
+   }
+
+   cache_id      = cbs->cache_id;
+   *cbs          = menu_st->entries.shared_cbs;
+   cbs->cache_id = cache_id;
+}
+
 /* Pretty much a stub function. TODO/FIXME - Might as well remove this. */
 int menu_cbs_exit(void)
 {
@@ -5252,6 +5378,14 @@ float menu_entry_num_max(uint32_t i)
    return (float)max;
 }
 
+/* Ids are never 0, so a zeroed entry never hits the caches */
+static uint32_t menu_entries_next_cache_id(struct menu_state *menu_st)
+{
+   if (!++menu_st->entries.cache_id)
+      menu_st->entries.cache_id++;
+   return menu_st->entries.cache_id;
+}
+
 void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
       size_t i, void *userdata, bool use_representation)
 {
@@ -5330,9 +5464,13 @@ void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
 
       if (entry->sublabel_enabled)
       {
-         if (!string_is_empty(cbs->action_sublabel_cache))
+         unsigned slot = cbs->cache_id & (MENU_SUBLABEL_CACHE_SIZE - 1);
+
+         if (     cbs->cache_id
+               && menu_st->sublabel_cache[slot].id == cbs->cache_id)
             strlcpy(entry->sublabel,
-                     cbs->action_sublabel_cache, sizeof(entry->sublabel));
+                     menu_st->sublabel_cache[slot].str,
+                     sizeof(entry->sublabel));
          else if (cbs->action_sublabel)
          {
             char tmp[MENU_SUBLABEL_MAX_LENGTH];
@@ -5347,8 +5485,9 @@ void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
                /* If this function callback returns true,
                 * we know that the value won't change - so we
                 * can cache it instead. */
-               strlcpy(cbs->action_sublabel_cache,
-                     tmp, sizeof(cbs->action_sublabel_cache));
+               menu_st->sublabel_cache[slot].id = cbs->cache_id;
+               strlcpy(menu_st->sublabel_cache[slot].str,
+                     tmp, sizeof(menu_st->sublabel_cache[slot].str));
             }
 
             strlcpy(entry->sublabel, tmp, sizeof(entry->sublabel));
@@ -5501,6 +5640,7 @@ static menu_list_t *menu_list_new(struct rarch_state *p_rarch)
       list->menu_stack[i]->list     = NULL;
       list->menu_stack[i]->capacity = 0;
       list->menu_stack[i]->size     = 0;
+      list->menu_stack[i]->pool     = NULL;
    }
 
    for (i = 0; i < list->selection_buf_size; i++)
@@ -5510,6 +5650,9 @@ static menu_list_t *menu_list_new(struct rarch_state *p_rarch)
       list->selection_buf[i]->list     = NULL;
       list->selection_buf[i]->capacity = 0;
       list->selection_buf[i]->size     = 0;
+      list->selection_buf[i]->pool     = NULL;
+
+      file_list_use_string_pool(list->selection_buf[i], false);
    }
 
    return list;
@@ -5664,6 +5807,7 @@ static void menu_entries_build_scroll_indices(
    size_t i                    = 0;
 
    menu_st->scroll.index_size  = 0;
+   menu_st->virtual_list_scroll = false;
 
    menu_navigation_add_scroll_index(p_rarch, 0);
 
@@ -5694,6 +5838,23 @@ static void menu_entries_build_scroll_indices(
    menu_navigation_add_scroll_index(p_rarch, list->size - 1);
 }
 
+/* Builds the scroll indices over all entries of the virtual list
+ * shown. Done on the first alphabet jump rather than when the list
+ * is built, as it has to go through the whole list. */
+static void menu_entries_build_virtual_scroll_indices(
+      struct rarch_state *p_rarch)
+{
+   struct menu_state *menu_st   = &p_rarch->menu_driver_state;
+
+   if (menu_st->virtual_list_scroll)
+      return;
+
+   menu_st->scroll.index_size   = menu_virtual_list_get_scroll_indices(
+         &menu_st->virtual_list, menu_st->scroll.index_list,
+         SCROLL_INDEX_SIZE - 1);
+   menu_st->virtual_list_scroll = true;
+}
+
 /**
  * Before a refresh, we could have deleted a
  * file on disk, causing selection_ptr to
@@ -5709,7 +5870,9 @@ static bool menu_entries_refresh(
    struct menu_state *menu_st  = &p_rarch->menu_driver_state;
    size_t          selection   = menu_st->selection_ptr;
 
-   if (list->size)
+   /* Indices over the window would stop alphabet
+    * jumps at its ends, see MENU_NAVIGATION_CTL_ASCEND_ALPHABET */
+   if (list->size && !menu_st->virtual_list_shown)
       menu_entries_build_scroll_indices(p_rarch, list);
 
    list_size                    = menu_entries_get_size();
@@ -5762,15 +5925,22 @@ int menu_entries_get_title(char *s, size_t len)
    if (cbs && cbs->action_get_title)
    {
       int ret;
-      if (!string_is_empty(cbs->action_title_cache))
+      unsigned slot = cbs->cache_id & (MENU_TITLE_CACHE_SIZE - 1);
+
+      if (     cbs->cache_id
+            && menu_st->title_cache[slot].id == cbs->cache_id)
       {
-         strlcpy(s, cbs->action_title_cache, len);
+         strlcpy(s, menu_st->title_cache[slot].str, len);
          return 0;
       }
       menu_entries_get_last_stack(&path, &label, &menu_type, NULL, NULL);
       ret = cbs->action_get_title(path, label, menu_type, s, len);
       if (ret == 1)
-         strlcpy(cbs->action_title_cache, s, sizeof(cbs->action_title_cache));
+      {
+         menu_st->title_cache[slot].id = cbs->cache_id;
+         strlcpy(menu_st->title_cache[slot].str, s,
+               sizeof(menu_st->title_cache[slot].str));
+      }
       return ret;
    }
    return 0;
@@ -5941,8 +6111,8 @@ void menu_entries_append(
    if (!cbs)
       return;
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
    cbs->enum_idx                   = MSG_UNKNOWN;
    cbs->checked                    = false;
    cbs->setting                    = menu_setting_find(label);
@@ -6023,8 +6193,8 @@ bool menu_entries_append_enum(
    file_list_free_actiondata(list, idx);
    cbs = (menu_file_list_cbs_t*)malloc(sizeof(menu_file_list_cbs_t));
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
    cbs->enum_idx                   = enum_idx;
    cbs->checked                    = false;
    cbs->setting                    = NULL;
@@ -6056,12 +6226,147 @@ bool menu_entries_append_enum(
       cbs->setting                 = menu_setting_find_enum(enum_idx);
 
    if (!string_is_equal(menu_ident, "null"))
-      menu_cbs_init(p_rarch,
-            list, cbs, path, label, type, idx);
+   {
+      if (     enum_idx == MENU_ENUM_LABEL_PLAYLIST_ENTRY
+            || enum_idx == MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY)
+         menu_cbs_init_shared(p_rarch,
+               list, cbs, path, label, type, idx);
+      else
+         menu_cbs_init(p_rarch,
+               list, cbs, path, label, type, idx);
+   }
 
    return true;
 }
 
+static void menu_entries_clear(struct rarch_state *p_rarch,
+      file_list_t *list)
+{
+   unsigned i;
+
+   /* Clear all the menu lists. */
+   if (p_rarch->menu_driver_ctx->list_clear)
+      p_rarch->menu_driver_ctx->list_clear(list);
+
+   for (i = 0; i < list->size; i++)
+      file_list_free_actiondata(list, i);
+
+   file_list_clear(list);
+}
+
+void menu_entries_append_virtual(file_list_t *list,
+      uint32_t ident, size_t size,
+      menu_virtual_list_fill_t fill,
+      menu_virtual_list_get_name_t get_name,
+      void *userdata)
+{
+   struct rarch_state   *p_rarch   = &rarch_st;
+   struct menu_state    *menu_st   = &p_rarch->menu_driver_state;
+   menu_virtual_list_t  *vl        = &menu_st->virtual_list;
+   size_t selection                = menu_st->selection_ptr;
+
+   if (!list || !fill)
+      return;
+
+   /* Lists other than the one shown are always built in full */
+   if (list != MENU_ENTRIES_GET_SELECTION_BUF_PTR_INTERNAL(0))
+   {
+      fill(list, 0, size, userdata);
+      return;
+   }
+
+   vl->fill                        = fill;
+   vl->get_name                    = get_name;
+   vl->userdata                    = userdata;
+   vl->depth                       = menu_entries_get_stack_size(0);
+   menu_st->virtual_list_shown     = menu_virtual_list_init(
+         vl, ident, size, &selection);
+   menu_st->virtual_list_scroll    = false;
+
+   /* The driver lays out the entries around the selection
+    * as they are added, so it has to be right beforehand */
+   if (menu_st->virtual_list_shown)
+      menu_st->selection_ptr       = selection;
+
+   menu_virtual_list_fill(vl, list, vl->offset);
+}
+
+size_t menu_entries_get_virtual_index(size_t idx)
+{
+   struct rarch_state   *p_rarch   = &rarch_st;
+   struct menu_state    *menu_st   = &p_rarch->menu_driver_state;
+
+   if (!menu_st->virtual_list_shown)
+      return idx;
+   return menu_virtual_list_index(&menu_st->virtual_list, idx);
+}
+
+/* Selects entry @idx of the virtual list shown, moving
+ * its window first if @idx is outside of it or too
+ * close to one of its ends */
+static void menu_entries_virtual_select(struct rarch_state *p_rarch,
+      size_t idx)
+{
+   size_t offset;
+   struct menu_state    *menu_st   = &p_rarch->menu_driver_state;
+   menu_virtual_list_t  *vl        = &menu_st->virtual_list;
+
+   if (idx >= vl->size)
+      idx                          = vl->size - 1;
+
+   if (menu_virtual_list_place(vl, idx, &offset))
+   {
+      const char *path             = NULL;
+      const char *label            = NULL;
+      unsigned type                = 0;
+      file_list_t *list            = MENU_ENTRIES_GET_SELECTION_BUF_PTR_INTERNAL(0);
+
+      menu_entries_clear(p_rarch, list);
+
+      menu_st->selection_ptr       = idx - offset;
+      menu_virtual_list_fill(vl, list, offset);
+
+      /* Have the driver pick up the new entries
+       * the way it does for an in-place refresh,
+       * i.e. without resetting the view */
+      menu_entries_get_last_stack(&path, &label, &type, NULL, NULL);
+
+      menu_st->prevent_populate    = true;
+      if (     p_rarch->menu_driver_ctx
+            && p_rarch->menu_driver_ctx->populate_entries)
+         p_rarch->menu_driver_ctx->populate_entries(
+               p_rarch->menu_userdata, path,
+               label ? label : "", type);
+      menu_st->prevent_populate    = false;
+   }
+   else
+      menu_st->selection_ptr       = idx - vl->offset;
+}
+
+/* Selects entry @idx of the list shown, which is a
+ * window index unless a virtual list is shown */
+static void menu_navigation_select(struct rarch_state *p_rarch,
+      size_t idx)
+{
+   struct menu_state    *menu_st   = &p_rarch->menu_driver_state;
+
+   if (menu_st->virtual_list_shown)
+      menu_entries_virtual_select(p_rarch, idx);
+   else
+      menu_st->selection_ptr       = idx;
+}
+
+/* Number of entries in the list shown, including those
+ * outside the window of a virtual list */
+static size_t menu_navigation_get_size(struct rarch_state *p_rarch)
+{
+   struct menu_state    *menu_st   = &p_rarch->menu_driver_state;
+
+   if (menu_st->virtual_list_shown)
+      return menu_st->virtual_list.size;
+   return menu_entries_get_size();
+}
+
 void menu_entries_prepend(file_list_t *list,
       const char *path, const char *label,
       enum msg_hash_enums enum_idx,
@@ -6111,8 +6416,8 @@ void menu_entries_prepend(file_list_t *list,
    if (!cbs)
       return;
 
-   cbs->action_sublabel_cache[0]   = '\0';
-   cbs->action_title_cache[0]      = '\0';
+   cbs->cache_id                   = menu_entries_next_cache_id(
+         &p_rarch->menu_driver_state);
    cbs->enum_idx                   = enum_idx;
    cbs->checked                    = false;
    cbs->setting                    = menu_setting_find_enum(cbs->enum_idx);
@@ -6284,20 +6589,15 @@ bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data)
                (file_list_t*)data);
       case MENU_ENTRIES_CTL_CLEAR:
          {
-            unsigned i;
             file_list_t *list = (file_list_t*)data;
 
             if (!list)
                return false;
 
-            /* Clear all the menu lists. */
-            if (p_rarch->menu_driver_ctx->list_clear)
-               p_rarch->menu_driver_ctx->list_clear(list);
+            if (list == MENU_ENTRIES_GET_SELECTION_BUF_PTR_INTERNAL(0))
+               menu_st->virtual_list_shown = false;
 
-            for (i = 0; i < list->size; i++)
-               file_list_free_actiondata(list, i);
-
-            file_list_clear(list);
+            menu_entries_clear(p_rarch, list);
          }
          break;
       case MENU_ENTRIES_CTL_SHOW_BACK:
@@ -6520,7 +6820,11 @@ void menu_driver_frame(bool menu_is_alive, video_frame_info_t *video_info)
 {
    struct rarch_state   *p_rarch  = &rarch_st;
    if (menu_is_alive && p_rarch->menu_driver_ctx->frame)
+   {
       p_rarch->menu_driver_ctx->frame(p_rarch->menu_userdata, video_info);
+      /* In case the menu returned without unsetting its viewport */
+      gfx_display_batch_end();
+   }
 }
 
 /* Time format strings with AM-PM designation require special
@@ -6994,6 +7298,13 @@ bool menu_driver_iterate(menu_ctx_iterate_t *iterate,
       return true;
    }
 
+   /* Keep the window of a virtual list around the selection,
+    * whatever moved it last frame (pointer, alphabet jump...) */
+   if (menu_st->virtual_list_shown)
+      menu_entries_virtual_select(p_rarch,
+            menu_virtual_list_index(&menu_st->virtual_list,
+               menu_st->selection_ptr));
+
    if (     p_rarch->menu_driver_ctx          
          && p_rarch->menu_driver_ctx->iterate)
    {
@@ -7366,6 +7677,9 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
             menu_st->scroll.acceleration = 0;
             menu_st->selection_ptr       = 0;
             menu_st->scroll.index_size   = 0;
+            menu_st->virtual_list_shown  = false;
+            menu_st->virtual_list_scroll = false;
+            memset(&menu_st->virtual_list, 0, sizeof(menu_st->virtual_list));
 
             for (i = 0; i < SCROLL_INDEX_SIZE; i++)
                menu_st->scroll.index_list[i] = 0;
@@ -7523,6 +7837,18 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          {
             bool *pending_push     = (bool*)data;
 
+            /* A virtual list goes back to its top, unless
+             * another list is being pushed on top of it */
+            if (menu_entries_get_stack_size(0) <= menu_st->virtual_list.depth)
+            {
+               if (menu_st->virtual_list_shown)
+                  menu_entries_virtual_select(p_rarch, 0);
+               else
+                  menu_virtual_list_forget(&menu_st->virtual_list);
+            }
+            else
+               menu_st->virtual_list_shown = false;
+
             /* Always set current selection to first entry */
             menu_st->selection_ptr = 0;
 
@@ -7544,18 +7870,20 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          {
             settings_t   *settings = p_rarch->configuration_settings;
             unsigned scroll_speed  = *((unsigned*)data);
-            size_t  menu_list_size = menu_entries_get_size();
+            size_t  menu_list_size = menu_navigation_get_size(p_rarch);
+            size_t  selection      = menu_entries_get_virtual_index(
+                  menu_st->selection_ptr);
             bool wraparound_enable = settings->bools.menu_navigation_wraparound_enable;
 
-            if (menu_st->selection_ptr >= menu_list_size - 1
+            if (selection >= menu_list_size - 1
                   && !wraparound_enable)
                return false;
 
-            if ((menu_st->selection_ptr + scroll_speed) < menu_list_size)
+            if ((selection + scroll_speed) < menu_list_size)
             {
-               size_t idx  = menu_st->selection_ptr + scroll_speed;
+               size_t idx  = selection + scroll_speed;
 
-               menu_st->selection_ptr = idx;
+               menu_navigation_select(p_rarch, idx);
                menu_driver_navigation_set(true);
             }
             else
@@ -7578,14 +7906,16 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
             size_t idx             = 0;
             settings_t   *settings = p_rarch->configuration_settings;
             unsigned scroll_speed  = *((unsigned*)data);
-            size_t  menu_list_size = menu_entries_get_size();
+            size_t  menu_list_size = menu_navigation_get_size(p_rarch);
+            size_t  selection      = menu_entries_get_virtual_index(
+                  menu_st->selection_ptr);
             bool wraparound_enable = settings->bools.menu_navigation_wraparound_enable;
 
-            if (menu_st->selection_ptr == 0 && !wraparound_enable)
+            if (selection == 0 && !wraparound_enable)
                return false;
 
-            if (menu_st->selection_ptr >= scroll_speed)
-               idx = menu_st->selection_ptr - scroll_speed;
+            if (selection >= scroll_speed)
+               idx = selection - scroll_speed;
             else
             {
                idx  = menu_list_size - 1;
@@ -7593,7 +7923,7 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
                   idx = 0;
             }
 
-            menu_st->selection_ptr = idx;
+            menu_navigation_select(p_rarch, idx);
             menu_driver_navigation_set(true);
 
             if (p_rarch->menu_driver_ctx->navigation_decrement)
@@ -7602,10 +7932,10 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          break;
       case MENU_NAVIGATION_CTL_SET_LAST:
          {
-            size_t menu_list_size     = menu_entries_get_size();
+            size_t menu_list_size     = menu_navigation_get_size(p_rarch);
             size_t new_selection      = menu_list_size - 1;
 
-            menu_st->selection_ptr    = new_selection;
+            menu_navigation_select(p_rarch, new_selection);
 
             if (p_rarch->menu_driver_ctx->navigation_set_last)
                p_rarch->menu_driver_ctx->navigation_set_last(p_rarch->menu_userdata);
@@ -7613,25 +7943,35 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          break;
       case MENU_NAVIGATION_CTL_ASCEND_ALPHABET:
          {
+            /* Scroll indices, like the selection here, are
+             * list indices when a virtual list is shown */
             size_t i               = 0;
-            size_t  menu_list_size = menu_entries_get_size();
+            size_t idx             = 0;
+            size_t  menu_list_size = menu_navigation_get_size(p_rarch);
+            size_t  selection      = menu_entries_get_virtual_index(
+                  menu_st->selection_ptr);
+
+            if (menu_st->virtual_list_shown)
+               menu_entries_build_virtual_scroll_indices(p_rarch);
 
             if (!menu_st->scroll.index_size)
                return false;
 
-            if (menu_st->selection_ptr == menu_st->scroll.index_list[menu_st->scroll.index_size - 1])
-               menu_st->selection_ptr = menu_list_size - 1;
+            if (selection == menu_st->scroll.index_list[menu_st->scroll.index_size - 1])
+               idx = menu_list_size - 1;
             else
             {
                while (i < menu_st->scroll.index_size - 1
-                     && menu_st->scroll.index_list[i + 1] <= menu_st->selection_ptr)
+                     && menu_st->scroll.index_list[i + 1] <= selection)
                   i++;
-               menu_st->selection_ptr = menu_st->scroll.index_list[i + 1];
+               idx = menu_st->scroll.index_list[i + 1];
 
-               if (menu_st->selection_ptr >= menu_list_size)
-                  menu_st->selection_ptr = menu_list_size - 1;
+               if (idx >= menu_list_size)
+                  idx = menu_list_size - 1;
             }
 
+            menu_navigation_select(p_rarch, idx);
+
             if (p_rarch->menu_driver_ctx->navigation_ascend_alphabet)
                p_rarch->menu_driver_ctx->navigation_ascend_alphabet(
                      p_rarch->menu_userdata, &menu_st->selection_ptr);
@@ -7639,21 +7979,27 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          break;
       case MENU_NAVIGATION_CTL_DESCEND_ALPHABET:
          {
-            size_t i        = 0;
+            size_t i         = 0;
+            size_t selection = menu_entries_get_virtual_index(
+                  menu_st->selection_ptr);
+
+            if (menu_st->virtual_list_shown)
+               menu_entries_build_virtual_scroll_indices(p_rarch);
 
             if (!menu_st->scroll.index_size)
                return false;
 
-            if (menu_st->selection_ptr == 0)
+            if (selection == 0)
                return false;
 
             i   = menu_st->scroll.index_size - 1;
 
-            while (i && menu_st->scroll.index_list[i - 1] >= menu_st->selection_ptr)
+            while (i && menu_st->scroll.index_list[i - 1] >= selection)
                i--;
 
             if (i > 0)
-               menu_st->selection_ptr = menu_st->scroll.index_list[i - 1];
+               menu_navigation_select(p_rarch,
+                     menu_st->scroll.index_list[i - 1]);
 
             if (p_rarch->menu_driver_ctx->navigation_descend_alphabet)
                p_rarch->menu_driver_ctx->navigation_descend_alphabet(
@@ -9040,12 +9386,7 @@ static bool get_self_input_state(
    }
 
    /* And send this input to our peers */
-   for (i = 0; i < netplay->connections_size; i++)
-   {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
-         netplay_send_cur_input(netplay, &netplay->connections[i]);
-   }
+   netplay_send_cur_input_all(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -9994,7 +10335,8 @@ void netplay_send_savestate(netplay_t *netplay,
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
           connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+          connection->compression_supported != cx ||
+          connection->savestate_delta) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
             sizeof(header)) ||
@@ -10004,6 +10346,56 @@ void netplay_send_savestate(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @serial_info          : the savestate being loaded
+ * @base_ptr             : buffer index of the state to send it relative to,
+ *                         or -1 for none
+ *
+ * Start sending a loaded savestate to those connected peers that take
+ * chunked deltas. Peers we don't share a state with get it in full.
+ */
+static void netplay_send_savestate_delta(netplay_t *netplay,
+   retro_ctx_serialize_info_t *serial_info, ssize_t base_ptr)
+{
+   size_t i;
+   netplay_savestate_source_t *delta = NULL;
+   netplay_savestate_source_t *full  = NULL;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      netplay_savestate_source_t **src      = &full;
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          !connection->savestate_delta) continue;
+
+      if (base_ptr >= 0 && !connection->savestate_full &&
+            serial_info->size == netplay->state_size)
+         src = &delta;
+
+      if (!*src)
+      {
+         *src = netplay_savestate_source_new(serial_info->data_const,
+               (src == &delta) ? netplay->buffer[base_ptr].state : NULL,
+               serial_info->size);
+         if (*src)
+         {
+            (*src)->frame = netplay->run_frame_count;
+            if (src == &delta)
+               (*src)->base_frame = netplay->buffer[base_ptr].frame;
+         }
+      }
+
+      if (!*src || !netplay_cmd_load_savestate_delta(netplay, connection, *src))
+         netplay_hangup(netplay, connection);
+   }
+
+   netplay_savestate_source_free(delta);
+   netplay_savestate_source_free(full);
+}
+
 /**
  * netplay_load_savestate
  * @netplay              : pointer to netplay object
@@ -10018,6 +10410,8 @@ void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save)
 {
    retro_ctx_serialize_info_t tmp_serial_info;
+   /* Chosen before the load moves our frame counters to the present */
+   ssize_t base_ptr = netplay_final_state_ptr(netplay);
 
    netplay_force_future(netplay);
 
@@ -10059,6 +10453,7 @@ void netplay_load_savestate(netplay_t *netplay,
       return;
 
    /* Send this to every peer */
+   netplay_send_savestate_delta(netplay, serial_info, base_ptr);
    if (netplay->compress_nil.compression_backend)
       netplay_send_savestate(netplay, serial_info, 0, &netplay->compress_nil);
    if (netplay->compress_zlib.compression_backend)
@@ -10259,6 +10654,12 @@ static bool init_netplay(
          settings->ints.netplay_check_frames,
          &cbs,
          settings->bools.netplay_nat_traversal && !settings->bools.netplay_use_mitm_server,
+         settings->bools.netplay_udp && !settings->bools.netplay_use_mitm_server,
+         settings->bools.netplay_relay
+         ? (settings->uints.netplay_port
+            ? settings->uints.netplay_port
+            : RARCH_DEFAULT_PORT)
+         : 0,
 #ifdef HAVE_DISCORD
          discord_get_own_username(p_rarch) 
          ? discord_get_own_username(p_rarch) 
@@ -10448,6 +10849,34 @@ static void rarch_perf_log(struct rarch_state *p_rarch)
    log_counters(p_rarch->perf_counters_rarch, p_rarch->perf_ptr_rarch);
 }
 
+static void rarch_perf_trace_log(void)
+{
+   unsigned i;
+   const char *idents[256];
+   unsigned num = performance_trace_get_idents(idents, ARRAY_SIZE(idents));
+
+   if (!num)
+      return;
+
+   RARCH_LOG("[PERF]: Latency histograms:\n");
+   for (i = 0; i < num; i++)
+   {
+      performance_trace_histogram_t hist;
+
+      if (!performance_trace_get_histogram(idents[i], &hist) || !hist.count)
+         continue;
+
+      RARCH_LOG(PERF_HISTOGRAM_LOG_FMT,
+            idents[i],
+            (uint64_t)hist.count,
+            (uint64_t)(hist.total / hist.count),
+            (uint64_t)performance_trace_histogram_percentile(&hist, 50),
+            (uint64_t)performance_trace_histogram_percentile(&hist, 90),
+            (uint64_t)performance_trace_histogram_percentile(&hist, 99),
+            (uint64_t)hist.max);
+   }
+}
+
 static void retro_perf_log(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
@@ -10455,6 +10884,143 @@ static void retro_perf_log(void)
    log_counters(p_rarch->perf_counters_libretro, p_rarch->perf_ptr_libretro);
 }
 
+/* Turns on what --benchmark-features asked for, right before the
+ * first benchmarked frame. Settings changed here are put back by
+ * retroarch_benchmark_finish(), so they are not saved. */
+static void retroarch_benchmark_apply_features(
+      struct rarch_state *p_rarch, settings_t *settings)
+{
+   unsigned features                    = p_rarch->benchmark_features;
+
+   p_rarch->benchmark_rewind_enable     = settings->bools.rewind_enable;
+   p_rarch->benchmark_run_ahead_enabled = settings->bools.run_ahead_enabled;
+   p_rarch->benchmark_run_ahead_frames  = settings->uints.run_ahead_frames;
+
+#ifdef HAVE_REWIND
+   if (     (features & BENCHMARK_FEATURE_REWIND)
+         && !settings->bools.rewind_enable)
+   {
+      configuration_set_bool(settings, settings->bools.rewind_enable, true);
+      command_event(CMD_EVENT_REWIND_INIT, NULL);
+   }
+#endif
+#ifdef HAVE_RUNAHEAD
+   if (features & BENCHMARK_FEATURE_RUNAHEAD)
+   {
+      configuration_set_bool(settings,
+            settings->bools.run_ahead_enabled, true);
+      if (!settings->uints.run_ahead_frames)
+         configuration_set_uint(settings,
+               settings->uints.run_ahead_frames, 1);
+   }
+#endif
+   /* Netplay is set up from the command line, as it has to be
+    * there when the content is loaded */
+   if ((features & BENCHMARK_FEATURE_RECORD) && !p_rarch->recording_data)
+      command_event(CMD_EVENT_RECORD_INIT, NULL);
+#ifdef HAVE_VIDEO_FILTER
+   if (     (features & BENCHMARK_FEATURE_FILTER)
+         && !p_rarch->video_driver_state_filter)
+      RARCH_WARN("[Benchmark]: No video filter is loaded, "
+            "set \"video_filter\" to benchmark one.\n");
+#endif
+}
+
+static void retroarch_benchmark_frame(
+      struct rarch_state *p_rarch, settings_t *settings)
+{
+   if (!p_rarch->benchmark)
+   {
+      if (!(p_rarch->benchmark = benchmark_new(
+                  p_rarch->benchmark_frames,
+                  p_rarch->benchmark_features)))
+      {
+         RARCH_ERR("[Benchmark]: Failed to allocate %u frames.\n",
+               p_rarch->benchmark_frames);
+         p_rarch->benchmark_frames = 0;
+         return;
+      }
+
+      RARCH_LOG("[Benchmark]: Running %u frames.\n",
+            p_rarch->benchmark_frames);
+      retroarch_benchmark_apply_features(p_rarch, settings);
+   }
+
+   benchmark_frame(p_rarch->benchmark,
+         p_rarch->perf_counters_rarch, p_rarch->perf_ptr_rarch,
+         p_rarch->perf_counters_libretro, p_rarch->perf_ptr_libretro);
+}
+
+/* Writes the report, undoes retroarch_benchmark_apply_features() */
+static void retroarch_benchmark_finish(
+      struct rarch_state *p_rarch, settings_t *settings)
+{
+   benchmark_report_info_t info;
+   benchmark_stats_t stats;
+   benchmark_t *bench               = p_rarch->benchmark;
+   const char *report_path          = p_rarch->benchmark_report_path;
+   struct retro_system_info *system = &p_rarch->runloop_system.info;
+
+   if (!bench)
+      return;
+
+   info.core_name       = system->library_name;
+   info.core_version    = system->library_version;
+   info.content_path    = path_get(RARCH_PATH_CONTENT);
+   info.features_active = 0;
+
+   /* Whether a feature really ran is taken from what it did, as
+    * e.g. netplay switches rewind and runahead off */
+   if (     benchmark_get_stats(bench, "rewind_push", &stats)
+         && stats.calls)
+      info.features_active |= BENCHMARK_FEATURE_REWIND;
+#ifdef HAVE_RUNAHEAD
+   if (     settings->bools.run_ahead_enabled
+         && settings->uints.run_ahead_frames
+         && p_rarch->runahead_available
+#ifdef HAVE_NETWORKING
+         && !netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL)
+#endif
+      )
+      info.features_active |= BENCHMARK_FEATURE_RUNAHEAD;
+#endif
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_DATA_INITED, NULL))
+      info.features_active |= BENCHMARK_FEATURE_NETPLAY;
+#endif
+   if (p_rarch->recording_data)
+      info.features_active |= BENCHMARK_FEATURE_RECORD;
+#ifdef HAVE_VIDEO_FILTER
+   if (p_rarch->video_driver_state_filter)
+      info.features_active |= BENCHMARK_FEATURE_FILTER;
+#endif
+
+   if (benchmark_get_features(bench) & ~info.features_active)
+      RARCH_WARN("[Benchmark]: Not every requested feature could be "
+            "enabled, see \"features\" in the report.\n");
+
+   if (benchmark_write_report(bench, report_path, &info))
+   {
+      if (!string_is_empty(report_path))
+         RARCH_LOG("[Benchmark]: %u frames, report written to \"%s\".\n",
+               benchmark_get_frames(bench), report_path);
+   }
+   else
+      RARCH_ERR("[Benchmark]: Failed to write report to \"%s\".\n",
+            string_is_empty(report_path) ? "stdout" : report_path);
+
+   configuration_set_bool(settings, settings->bools.rewind_enable,
+         p_rarch->benchmark_rewind_enable);
+   configuration_set_bool(settings, settings->bools.run_ahead_enabled,
+         p_rarch->benchmark_run_ahead_enabled);
+   configuration_set_uint(settings, settings->uints.run_ahead_frames,
+         p_rarch->benchmark_run_ahead_frames);
+
+   benchmark_free(bench);
+   p_rarch->benchmark        = NULL;
+   p_rarch->benchmark_frames = 0;
+}
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
@@ -10479,36 +11045,77 @@ unsigned retro_get_perf_count_libretro(void)
    return p_rarch->perf_ptr_libretro;
 }
 
+/* Appends @perf to a counter list, growing it as needed.
+ * MAX_COUNTERS only limits how many the menu lists. */
+static bool perf_counters_push(struct retro_perf_counter ***counters,
+      unsigned *num, unsigned *cap, struct retro_perf_counter *perf)
+{
+   if (*num == *cap)
+   {
+      unsigned new_cap                  = *cap ? *cap * 2 : MAX_COUNTERS;
+      struct retro_perf_counter **tmp   = (struct retro_perf_counter**)
+         realloc(*counters, new_cap * sizeof(*tmp));
+
+      if (!tmp)
+         return false;
+
+      *counters = tmp;
+      *cap      = new_cap;
+   }
+
+   (*counters)[(*num)++] = perf;
+   return true;
+}
+
 void rarch_perf_register(struct retro_perf_counter *perf)
 {
    struct rarch_state *p_rarch = &rarch_st;
    if (
             !p_rarch->runloop_perfcnt_enable
          || perf->registered
-         || p_rarch->perf_ptr_rarch >= MAX_COUNTERS
       )
       return;
 
-   p_rarch->perf_counters_rarch[p_rarch->perf_ptr_rarch++] = perf;
-   perf->registered = true;
+   if (perf_counters_push(&p_rarch->perf_counters_rarch,
+            &p_rarch->perf_ptr_rarch, &p_rarch->perf_cap_rarch, perf))
+      perf->registered = true;
 }
 
 void performance_counter_register(struct retro_perf_counter *perf)
 {
    struct rarch_state *p_rarch = &rarch_st;
-   if (perf->registered || p_rarch->perf_ptr_libretro >= MAX_COUNTERS)
+   if (perf->registered)
       return;
 
-   p_rarch->perf_counters_libretro[p_rarch->perf_ptr_libretro++] = perf;
-   perf->registered = true;
+   if (perf_counters_push(&p_rarch->perf_counters_libretro,
+            &p_rarch->perf_ptr_libretro, &p_rarch->perf_cap_libretro, perf))
+      perf->registered = true;
 }
 
 void performance_counters_clear(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
    p_rarch->perf_ptr_libretro  = 0;
-   memset(p_rarch->perf_counters_libretro, 0,
-         sizeof(p_rarch->perf_counters_libretro));
+}
+
+/* Frees both counter lists. The frontend's counters are static, so
+ * they are marked unregistered to get listed again if re-enabled;
+ * the core's may already be gone with the core. */
+static void perf_counters_free(struct rarch_state *p_rarch)
+{
+   unsigned i;
+
+   for (i = 0; i < p_rarch->perf_ptr_rarch; i++)
+      p_rarch->perf_counters_rarch[i]->registered = false;
+
+   free(p_rarch->perf_counters_rarch);
+   free(p_rarch->perf_counters_libretro);
+   p_rarch->perf_counters_rarch    = NULL;
+   p_rarch->perf_counters_libretro = NULL;
+   p_rarch->perf_ptr_rarch         = 0;
+   p_rarch->perf_ptr_libretro      = 0;
+   p_rarch->perf_cap_rarch         = 0;
+   p_rarch->perf_cap_libretro      = 0;
 }
 
 struct string_list *dir_list_new_special(const char *input_dir,
@@ -11898,10 +12505,26 @@ static void menu_input_search_cb(void *userdata, const char *str)
    if (!selection_buf)
       return;
 
-   if (str && *str && file_list_search(selection_buf, str, &idx))
+   if (str && *str)
    {
-      menu_navigation_set_selection(idx);
-      menu_driver_navigation_set(true);
+      struct rarch_state *p_rarch = &rarch_st;
+      struct menu_state  *menu_st = &p_rarch->menu_driver_state;
+
+      /* Entries outside the window of a
+       * virtual list have to be searched too */
+      if (menu_st->virtual_list_shown)
+      {
+         if (menu_virtual_list_search(&menu_st->virtual_list, str, &idx))
+         {
+            menu_entries_virtual_select(p_rarch, idx);
+            menu_driver_navigation_set(true);
+         }
+      }
+      else if (file_list_search(selection_buf, str, &idx))
+      {
+         menu_navigation_set_selection(idx);
+         menu_driver_navigation_set(true);
+      }
    }
 
    menu_input_dialog_end();
@@ -12375,6 +12998,36 @@ static bool command_get_config_param(const char* arg)
    return true;
 }
 
+static bool command_perf_trace(const char *arg)
+{
+   char reply[PATH_MAX_LENGTH + 64];
+   char path[PATH_MAX_LENGTH];
+   struct rarch_state *p_rarch = &rarch_st;
+   settings_t       *settings  = p_rarch->configuration_settings;
+   char                  *end  = NULL;
+   unsigned            frames  = (unsigned)strtoul(arg, &end, 10);
+
+   while (*end == ' ')
+      end++;
+
+   if (!string_is_empty(end))
+      strlcpy(path, end, sizeof(path));
+   else
+      fill_pathname_join(path, settings->paths.log_dir,
+            "retroarch_trace.json", sizeof(path));
+
+   /* Sections are reported as the performance counters stop */
+   p_rarch->runloop_perfcnt_enable = true;
+
+   if (performance_trace_capture(path, 0, frames))
+      snprintf(reply, sizeof(reply), "PERF_TRACE %u %s\n", frames, path);
+   else
+      snprintf(reply, sizeof(reply), "PERF_TRACE -1\n");
+
+   command_reply(p_rarch, reply, strlen(reply));
+   return true;
+}
+
 #if defined(HAVE_CHEEVOS)
 static bool command_read_ram(const char *arg);
 static bool command_write_ram(const char *arg);
@@ -12386,6 +13039,7 @@ static const struct cmd_action_map action_map[] = {
    { "GET_STATUS",       command_get_status,       "No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
+   { "PERF_TRACE",       command_perf_trace,       "<frames> [<trace path>]" },
 #if defined(HAVE_CHEEVOS)
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
    { "WRITE_CORE_RAM",  command_write_ram,   "<address> <byte1> <byte2> ..." },
@@ -12647,7 +13301,7 @@ static bool command_get_arg(const char *tok,
             return false;
 
          if (arg)
-            *arg = argument + 1;
+            *arg = *argument ? argument + 1 : argument;
 
          if (index)
             *index = i;
@@ -16021,6 +16675,7 @@ bool command_event(enum event_command cmd, void *data)
                   path_content_history);
             playlist_config_set_path(&playlist_config, path_content_history);
             g_defaults.content_history = playlist_init(&playlist_config);
+            playlist_set_journal(g_defaults.content_history, true);
             playlist_set_sort_mode(
                   g_defaults.content_history, PLAYLIST_SORT_MODE_OFF);
 
@@ -16029,6 +16684,7 @@ bool command_event(enum event_command cmd, void *data)
                   path_content_music_history);
             playlist_config_set_path(&playlist_config, path_content_music_history);
             g_defaults.music_history = playlist_init(&playlist_config);
+            playlist_set_journal(g_defaults.music_history, true);
             playlist_set_sort_mode(
                   g_defaults.music_history, PLAYLIST_SORT_MODE_OFF);
 
@@ -16038,6 +16694,7 @@ bool command_event(enum event_command cmd, void *data)
                   path_content_video_history);
             playlist_config_set_path(&playlist_config, path_content_video_history);
             g_defaults.video_history = playlist_init(&playlist_config);
+            playlist_set_journal(g_defaults.video_history, true);
             playlist_set_sort_mode(
                   g_defaults.video_history, PLAYLIST_SORT_MODE_OFF);
 #endif
@@ -16048,6 +16705,7 @@ bool command_event(enum event_command cmd, void *data)
                   path_content_image_history);
             playlist_config_set_path(&playlist_config, path_content_image_history);
             g_defaults.image_history = playlist_init(&playlist_config);
+            playlist_set_journal(g_defaults.image_history, true);
             playlist_set_sort_mode(
                   g_defaults.image_history, PLAYLIST_SORT_MODE_OFF);
 #endif
@@ -17125,6 +17783,9 @@ void main_exit(void *args)
             settings->arrays.video_driver);
    }
 
+   retroarch_benchmark_finish(p_rarch, settings);
+   performance_trace_capture_stop();
+
    if (config_save_on_exit)
       command_event(CMD_EVENT_MENU_SAVE_CURRENT_CONFIG, NULL);
 
@@ -17141,6 +17802,8 @@ void main_exit(void *args)
 
    if (p_rarch->runloop_perfcnt_enable)
       rarch_perf_log(p_rarch);
+   if (performance_trace_flags & PERFORMANCE_TRACE_HISTOGRAMS)
+      rarch_perf_trace_log();
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
@@ -17161,11 +17824,16 @@ void main_exit(void *args)
 
    retroarch_msg_queue_deinit(p_rarch);
    driver_uninit(p_rarch, DRIVERS_CMD_ALL);
+   /* No thread is left to report sections */
+   performance_trace_deinit();
    command_event(CMD_EVENT_LOG_FILE_DEINIT, NULL);
 
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
+   perf_counters_free(p_rarch);
    global_free(p_rarch);
    task_queue_deinit();
+   content_fingerprint_deinit();
+   runtime_log_deinit();
 
    if (p_rarch->configuration_settings)
       free(p_rarch->configuration_settings);
@@ -18460,7 +19128,12 @@ static void core_performance_counter_stop(struct retro_perf_counter *perf)
    bool runloop_perfcnt_enable = p_rarch->runloop_perfcnt_enable;
 
    if (runloop_perfcnt_enable)
-      perf->total += cpu_features_get_perf_counter() - perf->start;
+   {
+      retro_perf_tick_t ticks = cpu_features_get_perf_counter() - perf->start;
+      perf->total            += ticks;
+      if (performance_trace_flags)
+         performance_trace_event(perf->ident, perf->start, ticks);
+   }
 }
 
 static size_t mmap_add_bits_down(size_t n)
@@ -21415,9 +22088,13 @@ static bool record_driver_init_first(
 
    for (i = 0; record_drivers[i]; i++)
    {
-      void *handle = record_drivers[i]->init(params);
+      void *handle = NULL;
+
+      /* The null driver cannot record anything */
+      if (!record_drivers[i]->init)
+         continue;
 
-      if (!handle)
+      if (!(handle = record_drivers[i]->init(params)))
          continue;
 
       *backend = record_drivers[i];
@@ -23383,7 +24060,7 @@ float input_sensor_get_input(unsigned port, unsigned id)
  *
  * Input polling callback function.
  **/
-static void input_driver_poll(void)
+static void input_driver_poll_internal(void)
 {
    size_t i, j;
    rarch_joypad_info_t joypad_info[MAX_USERS];
@@ -23736,6 +24413,18 @@ static void input_driver_poll(void)
 #endif
 }
 
+static void input_driver_poll(void)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+
+   performance_counter_init(p_rarch->input_poll_perf, "input_poll");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->input_poll_perf);
+   input_driver_poll_internal();
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->input_poll_perf);
+}
+
 static int16_t input_state_device(
       struct rarch_state *p_rarch,
       int16_t ret,
@@ -28700,6 +29389,7 @@ const char *audio_driver_mixer_get_stream_name(unsigned i)
 static void audio_driver_mixer_deinit(struct rarch_state *p_rarch)
 {
    unsigned i;
+   audio_mixer_stats_t stats;
 
    p_rarch->audio_mixer_active = false;
 
@@ -28709,6 +29399,12 @@ static void audio_driver_mixer_deinit(struct rarch_state *p_rarch)
       audio_driver_mixer_remove_stream(i);
    }
 
+   audio_mixer_get_stats(&stats);
+
+   if (stats.underruns)
+      RARCH_WARN("[Audio]: Mixer streams ran dry %u times (%u frames).\n",
+            stats.underruns, stats.underrun_frames);
+
    audio_mixer_done();
 }
 #endif
@@ -28859,13 +29555,7 @@ static bool audio_driver_deinit_internal(struct rarch_state *p_rarch)
 
    audio_driver_deinit_resampler(p_rarch);
 
-   if (p_rarch->audio_driver_input_data)
-      free(p_rarch->audio_driver_input_data);
-   p_rarch->audio_driver_input_data         = NULL;
-
-   if (p_rarch->audio_driver_output_samples_buf)
-      free(p_rarch->audio_driver_output_samples_buf);
-   p_rarch->audio_driver_output_samples_buf = NULL;
+   audio_pipeline_free(&p_rarch->audio_driver_pipeline);
 
 #ifdef HAVE_DSP_FILTER
    audio_driver_dsp_filter_free();
@@ -28944,15 +29634,13 @@ static bool audio_driver_init_internal(
       bool audio_cb_inited)
 {
    unsigned new_rate       = 0;
-   float   *aud_inp_data   = NULL;
-   float  *samples_buf     = NULL;
-   size_t max_bufsamples   = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
    settings_t *settings    = p_rarch->configuration_settings;
    bool audio_enable       = settings->bools.audio_enable;
    bool audio_sync         = settings->bools.audio_sync;
    bool audio_rate_control = settings->bools.audio_rate_control;
    float slowmotion_ratio  = settings->floats.slowmotion_ratio;
 #ifdef HAVE_REWIND
+   size_t max_bufsamples   = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
    int16_t *rewind_buf     = NULL;
 #endif
    /* Accomodate rewind since at some point we might have two full buffers. */
@@ -29084,26 +29772,15 @@ static bool audio_driver_init_internal(
       p_rarch->audio_driver_active = false;
    }
 
-   aud_inp_data = (float*)malloc(max_bufsamples * sizeof(float));
-   retro_assert(aud_inp_data != NULL);
-
-   if (!aud_inp_data)
-      goto error;
-
-   p_rarch->audio_driver_input_data = aud_inp_data;
    p_rarch->audio_driver_data_ptr   = 0;
 
    retro_assert(settings->uints.audio_out_rate <
          p_rarch->audio_driver_input * AUDIO_MAX_RATIO);
 
-   samples_buf = (float*)malloc(outsamples_max * sizeof(float));
-
-   retro_assert(samples_buf != NULL);
-
-   if (!samples_buf)
+   if (!audio_pipeline_init(&p_rarch->audio_driver_pipeline,
+            AUDIO_MAX_RATIO * slowmotion_ratio))
       goto error;
 
-   p_rarch->audio_driver_output_samples_buf = (float*)samples_buf;
    p_rarch->audio_driver_control            = false;
 
    if (
@@ -29153,7 +29830,8 @@ error:
  * @right                : amount of samples to write.
  *
  * Writes audio samples to audio driver. Will first
- * perform DSP processing (if enabled) and resampling.
+ * perform DSP processing (if enabled) and resampling,
+ * block by block (see audio_pipeline_process()).
  **/
 static void audio_driver_flush(
       struct rarch_state *p_rarch,
@@ -29162,45 +29840,11 @@ static void audio_driver_flush(
       const int16_t *data, size_t samples,
       bool is_slowmotion, bool is_fastmotion)
 {
-   struct resampler_data src_data;
+   audio_pipeline_stages_t stages;
    float audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
          (audio_fastforward_mute && is_fastmotion)) ?
                0.0f : p_rarch->audio_driver_volume_gain;
 
-   src_data.data_out                 = NULL;
-   src_data.output_frames            = 0;
-
-   convert_s16_to_float(p_rarch->audio_driver_input_data, data, samples,
-         audio_volume_gain);
-
-   src_data.data_in                  = p_rarch->audio_driver_input_data;
-   src_data.input_frames             = samples >> 1;
-
-#ifdef HAVE_DSP_FILTER
-   if (p_rarch->audio_driver_dsp)
-   {
-      struct retro_dsp_data dsp_data;
-
-      dsp_data.input                 = NULL;
-      dsp_data.input_frames          = 0;
-      dsp_data.output                = NULL;
-      dsp_data.output_frames         = 0;
-
-      dsp_data.input                 = p_rarch->audio_driver_input_data;
-      dsp_data.input_frames          = (unsigned)(samples >> 1);
-
-      retro_dsp_filter_process(p_rarch->audio_driver_dsp, &dsp_data);
-
-      if (dsp_data.output)
-      {
-         src_data.data_in            = dsp_data.output;
-         src_data.input_frames       = dsp_data.output_frames;
-      }
-   }
-#endif
-
-   src_data.data_out                 = p_rarch->audio_driver_output_samples_buf;
-
    if (p_rarch->audio_driver_control)
    {
       /* Readjust the audio input rate. */
@@ -29235,10 +29879,24 @@ static void audio_driver_flush(
 #endif
    }
 
-   src_data.ratio           = p_rarch->audio_source_ratio_current;
+   stages.write             = p_rarch->current_audio->write;
+   stages.write_data        = p_rarch->audio_driver_context_audio_data;
+   stages.resampler         = p_rarch->audio_driver_resampler;
+   stages.resampler_data    = p_rarch->audio_driver_resampler_data;
+#ifdef HAVE_DSP_FILTER
+   stages.dsp               = p_rarch->audio_driver_dsp;
+#else
+   stages.dsp               = NULL;
+#endif
+   stages.gain              = audio_volume_gain;
+   stages.use_float         = p_rarch->audio_driver_use_float;
+   /* With rate control the ratio keeps moving around 1, and each
+    * switch between passthrough and resampling would be audible. */
+   stages.passthrough       = !p_rarch->audio_driver_control;
+   stages.ratio             = p_rarch->audio_source_ratio_current;
 
    if (is_slowmotion)
-      src_data.ratio       *= slowmotion_ratio;
+      stages.ratio         *= slowmotion_ratio;
 
    /* Note: Ideally we would divide by the user-configured
     * 'fastforward_ratio' when fast forward is enabled,
@@ -29257,50 +29915,42 @@ static void audio_driver_flush(
     * trying to do anything. Just leave the ratio as-is,
     * and hope for the best... */
 
-   p_rarch->audio_driver_resampler->process(
-         p_rarch->audio_driver_resampler_data, &src_data);
+   stages.mixer             = false;
+   stages.mixer_override    = false;
+   stages.mixer_gain        = 0.0f;
+   stages.mixer_perf        = NULL;
 
 #ifdef HAVE_AUDIOMIXER
    if (p_rarch->audio_mixer_active)
    {
-      bool override                       = true;
-      float mixer_gain                    = 0.0f;
-      bool audio_driver_mixer_mute_enable =
-         p_rarch->audio_driver_mixer_mute_enable;
+      stages.mixer          = true;
+      stages.mixer_override = true;
 
-      if (!audio_driver_mixer_mute_enable)
+      if (!p_rarch->audio_driver_mixer_mute_enable)
       {
          if (p_rarch->audio_driver_mixer_volume_gain == 1.0f)
-            override                      = false;
-         mixer_gain                       =
-            p_rarch->audio_driver_mixer_volume_gain;
+            stages.mixer_override = false;
+         stages.mixer_gain  = p_rarch->audio_driver_mixer_volume_gain;
       }
-      audio_mixer_mix(
-            p_rarch->audio_driver_output_samples_buf,
-            src_data.output_frames, mixer_gain, override);
    }
 #endif
 
+   if (p_rarch->runloop_perfcnt_enable)
    {
-      const void *output_data = p_rarch->audio_driver_output_samples_buf;
-      unsigned output_frames  = (unsigned)src_data.output_frames;
+      performance_counter_init(p_rarch->audio_mixer_perf, "audio_mixer");
+      stages.mixer_perf     = &p_rarch->audio_mixer_perf;
+   }
 
-      if (p_rarch->audio_driver_use_float)
-         output_frames       *= sizeof(float);
-      else
-      {
-         convert_float_to_s16(p_rarch->audio_driver_output_samples_conv_buf,
-               (const float*)output_data, output_frames * 2);
+   performance_counter_init(p_rarch->audio_flush_perf, "audio_flush");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->audio_flush_perf);
 
-         output_data          = p_rarch->audio_driver_output_samples_conv_buf;
-         output_frames       *= sizeof(int16_t);
-      }
+   if (!audio_pipeline_process(&p_rarch->audio_driver_pipeline,
+            &stages, data, samples))
+      p_rarch->audio_driver_active = false;
 
-      if (p_rarch->current_audio->write(
-               p_rarch->audio_driver_context_audio_data,
-               output_data, output_frames * 2) < 0)
-         p_rarch->audio_driver_active = false;
-   }
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->audio_flush_perf);
 }
 
 /**
@@ -29336,8 +29986,7 @@ static void audio_driver_sample(int16_t left, int16_t right)
 
    if (!(p_rarch->runloop_paused           ||
 		   !p_rarch->audio_driver_active     ||
-		   !p_rarch->audio_driver_input_data ||
-		   !p_rarch->audio_driver_output_samples_buf))
+		   !p_rarch->audio_driver_pipeline.input))
       audio_driver_flush(
             p_rarch,
             p_rarch->configuration_settings->floats.slowmotion_ratio,
@@ -29362,8 +30011,7 @@ static void audio_driver_menu_sample(void)
    bool check_flush                       = !(
          p_rarch->runloop_paused           ||
          !p_rarch->audio_driver_active     ||
-         !p_rarch->audio_driver_input_data ||
-         !p_rarch->audio_driver_output_samples_buf);
+         !p_rarch->audio_driver_pipeline.input);
 
    while (sample_count > 1024)
    {
@@ -29449,8 +30097,7 @@ static size_t audio_driver_sample_batch(const int16_t *data, size_t frames)
    if (!(
          p_rarch->runloop_paused           ||
          !p_rarch->audio_driver_active     ||
-         !p_rarch->audio_driver_input_data ||
-         !p_rarch->audio_driver_output_samples_buf))
+         !p_rarch->audio_driver_pipeline.input))
       audio_driver_flush(
             p_rarch,
             p_rarch->configuration_settings->floats.slowmotion_ratio,
@@ -30345,8 +30992,7 @@ void audio_driver_frame_is_reverse(void)
    if (!(
           p_rarch->runloop_paused          ||
          !p_rarch->audio_driver_active     ||
-         !p_rarch->audio_driver_input_data ||
-         !p_rarch->audio_driver_output_samples_buf))
+         !p_rarch->audio_driver_pipeline.input))
       audio_driver_flush(
             p_rarch,
             p_rarch->configuration_settings->floats.slowmotion_ratio,
@@ -30718,6 +31364,31 @@ static void video_context_driver_reset(void)
       p_rarch->current_video_context.swap_buffers        = swap_buffers_null;
 }
 
+void video_driver_swap_buffers(const gfx_ctx_driver_t *ctx,
+      void *ctx_data)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+   retro_time_t swap_start     = 0;
+
+   if (!ctx->swap_buffers)
+      return;
+
+   /* Only time it on the main thread, as the wait of a threaded
+    * driver is in its frame call already */
+   if (!p_rarch->video_frame_delay_auto_active
+         || VIDEO_DRIVER_IS_THREADED_INTERNAL())
+   {
+      ctx->swap_buffers(ctx_data);
+      return;
+   }
+
+   swap_start = cpu_features_get_time_usec();
+   ctx->swap_buffers(ctx_data);
+   p_rarch->video_driver_frame_swap_time +=
+      cpu_features_get_time_usec() - swap_start;
+   p_rarch->video_driver_frame_swap_timed = true;
+}
+
 bool video_context_driver_set(const gfx_ctx_driver_t *data)
 {
    struct rarch_state     *p_rarch = &rarch_st;
@@ -31027,6 +31698,16 @@ static void video_driver_free_internal(void)
 #endif
    dir_free_shader(p_rarch);
 
+#ifdef HAVE_SLANG
+   {
+      slang_cache_stats_t stats;
+      slang_cache_get_stats(&stats);
+      RARCH_LOG("[Shader cache]: %u hits, %u misses, %u stores, %u evictions.\n",
+            stats.hits, stats.misses, stats.stores, stats.evictions);
+      slang_cache_deinit();
+   }
+#endif
+
 #ifdef HAVE_THREADS
    if (is_threaded)
       return;
@@ -31172,6 +31853,29 @@ static void video_driver_set_viewport_square_pixel(struct rarch_state *p_rarch)
    aspectratio_lut[ASPECT_RATIO_SQUARE].value = (float)aspect_x / aspect_y;
 }
 
+#ifdef HAVE_SLANG
+/* Compiled slang shaders are kept in the cache directory, or next to
+ * the config file if there is none. */
+static void video_driver_init_shader_cache(settings_t *settings)
+{
+   char dir[PATH_MAX_LENGTH];
+   const char *directory_cache = settings->paths.directory_cache;
+
+   dir[0] = '\0';
+
+   if (!string_is_empty(directory_cache))
+      fill_pathname_join(dir, directory_cache, "shaders", sizeof(dir));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+   {
+      fill_pathname_basedir(dir, path_get(RARCH_PATH_CONFIG), sizeof(dir));
+      fill_pathname_join(dir, dir, "shader_cache", sizeof(dir));
+   }
+
+   if (slang_cache_init(dir, SLANG_CACHE_DEFAULT_SIZE))
+      RARCH_LOG("[Shader cache]: Using \"%s\".\n", dir);
+}
+#endif
+
 static bool video_driver_init_internal(bool *video_is_threaded)
 {
    video_info_t video;
@@ -31186,6 +31890,13 @@ static bool video_driver_init_internal(bool *video_is_threaded)
       video_driver_pix_fmt                = p_rarch->video_driver_pix_fmt;
 #ifdef HAVE_VIDEO_FILTER
    const char *path_softfilter_plugin     = settings->paths.path_softfilter_plugin;
+#endif
+
+#ifdef HAVE_SLANG
+   video_driver_init_shader_cache(settings);
+#endif
+
+#ifdef HAVE_VIDEO_FILTER
 
    if (!string_is_empty(path_softfilter_plugin))
       video_driver_init_filter(video_driver_pix_fmt);
@@ -32646,9 +33357,15 @@ static void video_driver_frame(const void *data, unsigned width,
 
       output_pitch = (output_width) * p_rarch->video_driver_state_out_bpp;
 
+      performance_counter_init(p_rarch->video_filter_perf,
+            "video_filter");
+      performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->video_filter_perf);
       rarch_softfilter_process(p_rarch->video_driver_state_filter,
             p_rarch->video_driver_state_buffer, output_pitch,
             data, width, height, pitch);
+      performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->video_filter_perf);
 
       if (video_info.post_filter_record
             && p_rarch->recording_data
@@ -32773,15 +33490,49 @@ static void video_driver_frame(const void *data, unsigned width,
             av_info->timing.fps,
             av_info->timing.sample_rate);
 
+      if (p_rarch->video_frame_delay_auto_active)
+      {
+         char delay_text[128];
+         const video_frame_delay_auto_t *fd = &p_rarch->video_frame_delay_auto;
+
+         snprintf(delay_text, sizeof(delay_text),
+               "Automatic Frame Delay:\n -Delay: %u ms\n -Work time (p%d): %6.2f ms\n -Missed frames: %" PRIu64 "\n",
+               fd->delay,
+               VIDEO_FRAME_DELAY_AUTO_PERCENTILE,
+               fd->work_percentile / 1000.0f,
+               fd->misses);
+         strlcat(video_info.stat_text, delay_text,
+               sizeof(video_info.stat_text));
+      }
+
       /* TODO/FIXME - add OSD chat text here */
    }
 
    if (p_rarch->current_video && p_rarch->current_video->frame)
+   {
+      /* Time spent in the driver is kept apart, along with the
+       * part of it spent swapping buffers (waiting for VSync), so
+       * that the adaptive frame delay only accounts for the
+       * actual work of the frame */
+      retro_time_t submit_start = cpu_features_get_time_usec();
+
+      performance_counter_init(p_rarch->video_driver_frame_perf,
+            "video_driver_frame");
+      performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->video_driver_frame_perf);
+
       p_rarch->video_driver_active = p_rarch->current_video->frame(
             p_rarch->video_driver_data, data, width, height,
             p_rarch->video_driver_frame_count,
             (unsigned)pitch, video_driver_msg, &video_info);
 
+      performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->video_driver_frame_perf);
+
+      p_rarch->video_driver_frame_submit_time +=
+         cpu_features_get_time_usec() - submit_start;
+   }
+
    p_rarch->video_driver_frame_count++;
 
    /* Display the status text, with a higher priority. */
@@ -35520,7 +36271,7 @@ static void retroarch_print_help(const char *arg0)
           "the device (1 to %d).\n", MAX_USERS);
 
    {
-      char buf[2560];
+      char buf[4096];
       buf[0] = '\0';
       strlcpy(buf, "                        Format is PORT:ID, where ID is a number "
             "corresponding to the particular device.\n", sizeof(buf));
@@ -35580,12 +36331,32 @@ static void retroarch_print_help(const char *arg0)
       strlcat(buf, "      --max-frames-ss-path=FILE\n"
             "                        Path to save the screenshot to at the end of max-frames.\n", sizeof(buf));
 #endif
+      strlcat(buf, "      --benchmark=NUMBER\n"
+            "                        Runs for the specified number of frames, then writes a JSON\n"
+            "                        report of the time spent per frame in each stage.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark-features=LIST\n"
+            "                        Comma separated features to include in the benchmark:\n"
+            "                        rewind, runahead, netplay, record, filter.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark-report=FILE\n"
+            "                        Path to write the benchmark report to, instead of stdout.\n", sizeof(buf));
+      strlcat(buf, "      --perf-trace=FILE\n"
+            "                        Writes the performance counters of a window of frames, per\n"
+            "                        thread, as Chrome/Perfetto trace JSON.\n", sizeof(buf));
+      strlcat(buf, "      --perf-trace-frames=[SKIP:]NUMBER\n"
+            "                        Frames to trace (default 60), after skipping SKIP frames.\n", sizeof(buf));
+      strlcat(buf, "      --perf-histograms\n"
+            "                        Logs latency histograms of the performance counters on exit.\n", sizeof(buf));
 #ifdef HAVE_ACCESSIBILITY
       strlcat(buf, "      --accessibility\n"
             "                        Enables accessibilty for blind users using text-to-speech.\n", sizeof(buf));
 #endif
       strlcat(buf, "      --load-menu-on-error\n"
             "                        Open menu instead of quitting if specified core or content fails to load.\n", sizeof(buf));
+#ifdef HAVE_SLANG
+      strlcat(buf, "      --compile-shader=PRESET\n"
+            "                        Compiles and reflects every pass of a slang preset, prints\n"
+            "                        how long each took, then exits. Bypasses the shader cache.\n", sizeof(buf));
+#endif
       puts(buf);
    }
 }
@@ -35661,11 +36432,20 @@ static void retroarch_parse_input_and_config(
       { "max-frames",         1, NULL, RA_OPT_MAX_FRAMES },
       { "max-frames-ss",      0, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT },
       { "max-frames-ss-path", 1, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT_PATH },
+      { "benchmark",          1, NULL, RA_OPT_BENCHMARK },
+      { "benchmark-features", 1, NULL, RA_OPT_BENCHMARK_FEATURES },
+      { "benchmark-report",   1, NULL, RA_OPT_BENCHMARK_REPORT },
+      { "perf-trace",         1, NULL, RA_OPT_PERF_TRACE },
+      { "perf-trace-frames",  1, NULL, RA_OPT_PERF_TRACE_FRAMES },
+      { "perf-histograms",    0, NULL, RA_OPT_PERF_HISTOGRAMS },
       { "eof-exit",           0, NULL, RA_OPT_EOF_EXIT },
       { "version",            0, NULL, RA_OPT_VERSION },
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
       { "accessibility",      0, NULL, RA_OPT_ACCESSIBILITY},
       { "load-menu-on-error", 0, NULL, RA_OPT_LOAD_MENU_ON_ERROR },
+#ifdef HAVE_SLANG
+      { "compile-shader",     1, NULL, RA_OPT_COMPILE_SHADER },
+#endif
       { NULL, 0, NULL, 0 }
    };
 
@@ -36176,6 +36956,53 @@ static void retroarch_parse_input_and_config(
 #endif
                break;
 
+            case RA_OPT_BENCHMARK:
+               p_rarch->benchmark_frames       = (unsigned)strtoul(optarg, NULL, 10);
+               p_rarch->runloop_max_frames     = p_rarch->benchmark_frames;
+               /* The report is built from the performance counters */
+               p_rarch->runloop_perfcnt_enable = true;
+               break;
+
+            case RA_OPT_BENCHMARK_FEATURES:
+               if (!benchmark_parse_features(optarg,
+                        &p_rarch->benchmark_features))
+               {
+                  RARCH_ERR("Unknown benchmark feature in \"%s\".\n", optarg);
+                  retroarch_fail(1, "retroarch_parse_input()");
+               }
+               break;
+
+            case RA_OPT_BENCHMARK_REPORT:
+               strlcpy(p_rarch->benchmark_report_path, optarg,
+                     sizeof(p_rarch->benchmark_report_path));
+               break;
+
+            case RA_OPT_PERF_TRACE:
+               strlcpy(p_rarch->perf_trace_path, optarg,
+                     sizeof(p_rarch->perf_trace_path));
+               p_rarch->runloop_perfcnt_enable = true;
+               break;
+
+            case RA_OPT_PERF_TRACE_FRAMES:
+               {
+                  char *end                 = NULL;
+                  unsigned value            = (unsigned)strtoul(optarg, &end, 10);
+
+                  p_rarch->perf_trace_skip  = 0;
+                  if (*end == ':')
+                  {
+                     p_rarch->perf_trace_skip = value;
+                     value = (unsigned)strtoul(end + 1, NULL, 10);
+                  }
+                  p_rarch->perf_trace_frames = value;
+               }
+               break;
+
+            case RA_OPT_PERF_HISTOGRAMS:
+               performance_trace_enable_histograms(true);
+               p_rarch->runloop_perfcnt_enable = true;
+               break;
+
             case RA_OPT_SUBSYSTEM:
                path_set(RARCH_PATH_SUBSYSTEM, optarg);
                break;
@@ -36226,6 +37053,16 @@ static void retroarch_parse_input_and_config(
             case RA_OPT_LOAD_MENU_ON_ERROR:
                global->cli_load_menu_on_error = true;
                break;
+#ifdef HAVE_SLANG
+            case RA_OPT_COMPILE_SHADER:
+               if (!slang_compile_preset_report(optarg, 0))
+               {
+                  fprintf(stderr, "Failed to compile \"%s\", "
+                        "use -v for details.\n", optarg);
+                  exit(1);
+               }
+               exit(0);
+#endif
             default:
                RARCH_ERR("%s\n", msg_hash_to_str(MSG_ERROR_PARSING_ARGUMENTS));
                retroarch_fail(1, "retroarch_parse_input()");
@@ -36233,6 +37070,23 @@ static void retroarch_parse_input_and_config(
       }
    }
 
+   if (!string_is_empty(p_rarch->perf_trace_path))
+      performance_trace_capture(p_rarch->perf_trace_path,
+            p_rarch->perf_trace_skip,
+            p_rarch->perf_trace_frames ? p_rarch->perf_trace_frames : 60);
+
+#ifdef HAVE_NETWORKING
+   /* Benchmarked netplay runs as a host nobody connects to, which
+    * still saves a state every frame */
+   if (     p_rarch->benchmark_frames
+         && (p_rarch->benchmark_features & BENCHMARK_FEATURE_NETPLAY))
+   {
+      retroarch_override_setting_set(
+            RARCH_OVERRIDE_SETTING_NETPLAY_MODE, NULL);
+      netplay_driver_ctl(RARCH_NETPLAY_CTL_ENABLE_SERVER, NULL);
+   }
+#endif
+
    if (verbosity_is_enabled())
       rarch_log_file_init(
             p_rarch->configuration_settings->bools.log_to_file,
@@ -36384,6 +37238,31 @@ static void retroarch_validate_cpu_features(void)
  *
  * Returns: true on success, otherwise false if there was an error.
  **/
+static void retroarch_init_content_fingerprints(settings_t *settings)
+{
+   char path[PATH_MAX_LENGTH];
+   const char *directory_cache = settings->paths.directory_cache;
+
+   path[0] = '\0';
+
+   if (!string_is_empty(directory_cache))
+      fill_pathname_join(path, directory_cache,
+            "content_fingerprints.bin", sizeof(path));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+   {
+      fill_pathname_basedir(path, path_get(RARCH_PATH_CONFIG), sizeof(path));
+      fill_pathname_join(path, path,
+            "content_fingerprints.bin", sizeof(path));
+   }
+
+   if (string_is_empty(path))
+      return;
+
+   if (!content_fingerprint_init(path))
+      RARCH_WARN("[Fingerprints]: \"%s\" is invalid, starting over.\n",
+            path);
+}
+
 bool retroarch_main_init(int argc, char *argv[])
 {
 #if defined(DEBUG) && defined(HAVE_DRMINGW)
@@ -36409,7 +37288,11 @@ bool retroarch_main_init(int argc, char *argv[])
    /* Have to initialise non-file logging once at the start... */
    retro_main_log_file_init(NULL, false);
 
+   performance_trace_init();
+   performance_trace_set_thread_name("main");
+
    retroarch_parse_input_and_config(p_rarch, argc, argv);
+   retroarch_init_content_fingerprints(p_rarch->configuration_settings);
 
 #ifdef HAVE_ACCESSIBILITY
    if (is_accessibility_enabled(p_rarch))
@@ -39210,6 +40093,7 @@ int runloop_iterate(void)
    settings_t *settings                         = p_rarch->configuration_settings;
    float fastforward_ratio                      = settings->floats.fastforward_ratio;
    unsigned video_frame_delay                   = settings->uints.video_frame_delay;
+   bool video_frame_delay_auto                  = settings->bools.video_frame_delay_auto;
    bool vrr_runloop_enable                      = settings->bools.vrr_runloop_enable;
    unsigned max_users                           = p_rarch->input_driver_max_users;
    retro_time_t current_time                    = cpu_features_get_time_usec();
@@ -39221,6 +40105,10 @@ int runloop_iterate(void)
       Discord_RunCallbacks();
 #endif
 
+   if (p_rarch->benchmark_frames)
+      retroarch_benchmark_frame(p_rarch, settings);
+   performance_trace_frame();
+
    if (p_rarch->runloop_frame_time.callback)
    {
       /* Updates frame timing if frame timing callback is in use by the core.
@@ -39357,10 +40245,32 @@ int runloop_iterate(void)
       }
    }
 
+   if (video_frame_delay_auto)
+   {
+      /* The fixed delay, if set, caps the automatic one. It is
+       * read every frame so that changing it applies right away */
+      unsigned delay_max = video_frame_delay ? video_frame_delay : 15;
+
+      if (!p_rarch->video_frame_delay_auto_active)
+      {
+         video_frame_delay_auto_init(&p_rarch->video_frame_delay_auto,
+               delay_max);
+         p_rarch->frame_delay_auto_last_time    = 0;
+         p_rarch->video_frame_delay_auto_active = true;
+      }
+      else
+         video_frame_delay_auto_set_max(
+               &p_rarch->video_frame_delay_auto, delay_max);
+      video_frame_delay = p_rarch->video_frame_delay_auto.delay;
+   }
+   else
+      p_rarch->video_frame_delay_auto_active   = false;
+
    if ((video_frame_delay > 0) && !p_rarch->input_driver_nonblock_state)
       retro_sleep(video_frame_delay);
 
    {
+      retro_time_t frame_start      = cpu_features_get_time_usec();
 #ifdef HAVE_RUNAHEAD
       unsigned run_ahead_num_frames = settings->uints.run_ahead_frames;
       /* Run Ahead Feature replaces the call to core_run in this loop */
@@ -39368,7 +40278,17 @@ int runloop_iterate(void)
 #ifdef HAVE_NETWORKING
       want_runahead                 = want_runahead && !netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL);
 #endif
+#endif
+
+      p_rarch->video_driver_frame_submit_time = 0;
+      p_rarch->video_driver_frame_swap_time   = 0;
+      p_rarch->video_driver_frame_swap_timed  = false;
+
+      performance_counter_init(p_rarch->core_run_perf, "core_run");
+      performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->core_run_perf);
 
+#ifdef HAVE_RUNAHEAD
       if (want_runahead)
          do_runahead(
                p_rarch,
@@ -39377,6 +40297,34 @@ int runloop_iterate(void)
       else
 #endif
          core_run();
+
+      performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+            p_rarch->core_run_perf);
+
+      if (p_rarch->video_frame_delay_auto_active)
+      {
+         /* Work time includes submitting the frame, but not the
+          * wait for VSync when swapping buffers. Drivers that do
+          * not swap through video_driver_swap_buffers() wait
+          * somewhere in their frame call, which is then left out
+          * as a whole. */
+         retro_time_t frame_end  = cpu_features_get_time_usec();
+         retro_time_t work_time  = frame_end - frame_start
+            - (p_rarch->video_driver_frame_swap_timed
+                  ? p_rarch->video_driver_frame_swap_time
+                  : p_rarch->video_driver_frame_submit_time);
+         retro_time_t interval   = p_rarch->frame_delay_auto_last_time
+            ? (frame_start - p_rarch->frame_delay_auto_last_time) : 0;
+         float refresh_rate      = settings->floats.video_refresh_rate;
+
+         if (!p_rarch->input_driver_nonblock_state && refresh_rate > 0.0f)
+            video_frame_delay_auto_update(
+                  &p_rarch->video_frame_delay_auto,
+                  (retro_time_t)(1000000.0f / refresh_rate),
+                  work_time, interval);
+
+         p_rarch->frame_delay_auto_last_time = frame_start;
+      }
    }
 
    /* Increment runtime tick counter after each call to
@@ -39645,6 +40593,7 @@ void rarch_favorites_init(void)
          path_content_favorites);
    playlist_config_set_path(&playlist_config, path_content_favorites);
    g_defaults.content_favorites = playlist_init(&playlist_config);
+   playlist_set_journal(g_defaults.content_favorites, true);
 
    /* Get current per-playlist sort mode */
    current_sort_mode = playlist_get_sort_mode(g_defaults.content_favorites);
@@ -39929,10 +40878,19 @@ bool core_unserialize(retro_ctx_serialize_info_t *info)
 
 bool core_serialize(retro_ctx_serialize_info_t *info)
 {
+   bool ret;
    struct rarch_state *p_rarch  = &rarch_st;
-   if (!info || !p_rarch->current_core.retro_serialize(info->data, info->size))
+   if (!info)
       return false;
-   return true;
+
+   performance_counter_init(p_rarch->core_serialize_perf, "serialize");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->core_serialize_perf);
+   ret = p_rarch->current_core.retro_serialize(info->data, info->size);
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         p_rarch->core_serialize_perf);
+
+   return ret;
 }
 
 bool core_serialize_size(retro_ctx_size_info_t *info)
@@ -1173,7 +1173,7 @@ typedef struct video_frame_info
    float font_msg_color_b;
    float xmb_alpha_factor;
 
-   char stat_text[512];
+   char stat_text[1024];
 
    struct
    {
@@ -1767,6 +1767,18 @@ const gfx_ctx_driver_t *video_context_driver_init_first(
 
 bool video_context_driver_set(const gfx_ctx_driver_t *data);
 
+/**
+ * video_driver_swap_buffers:
+ * @ctx                     : Graphics context driver.
+ * @ctx_data                : Its context data.
+ *
+ * Swaps the buffers of @ctx. Video drivers call this instead of
+ * @ctx->swap_buffers, so that the time spent waiting for VSync
+ * there is not taken for work by the automatic frame delay.
+ **/
+void video_driver_swap_buffers(const gfx_ctx_driver_t *ctx,
+      void *ctx_data);
+
 void video_context_driver_destroy(void);
 
 bool video_context_driver_get_ident(gfx_ctx_ident_t *ident);
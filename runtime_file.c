@@ -27,6 +27,7 @@
 #include <locale.h>
 
 #include <file/file_path.h>
+#include <lists/dir_list.h>
 #include <retro_miscellaneous.h>
 #include <streams/file_stream.h>
 #include <formats/jsonsax_full.h>
@@ -45,16 +46,19 @@
 #endif
 
 #include "runtime_file.h"
+#include "runtime_store.h"
 
 #define LOG_FILE_RUNTIME_FORMAT_STR "%u:%02u:%02u"
 #define LOG_FILE_LAST_PLAYED_FORMAT_STR "%04u-%02u-%02u %02u:%02u:%02u"
 
+/* Runtime log directory the runtime store was loaded from */
+static char runtime_log_store_dir[PATH_MAX_LENGTH] = {0};
+
 /* JSON Stuff... */
 
 typedef struct
 {
    JSON_Parser parser;
-   JSON_Writer writer;
    RFILE *file;
    char **current_entry_val;
    char *runtime_string;
@@ -104,14 +108,6 @@ static JSON_Parser_HandlerResult RtlJSONStringHandler(JSON_Parser parser, char *
    return JSON_Parser_Continue;
 }
 
-static JSON_Writer_HandlerResult RtlJSONOutputHandler(JSON_Writer writer, const char *pBytes, size_t length)
-{
-   RtlJSONContext *context = (RtlJSONContext*)JSON_Writer_GetUserData(writer);
-   (void)writer; /* unused */
-
-   return filestream_write(context->file, pBytes, length) == length ? JSON_Writer_Continue : JSON_Writer_Abort;
-}
-
 static void RtlJSONLogError(RtlJSONContext *pCtx)
 {
    if (pCtx->parser && JSON_Parser_GetError(pCtx->parser) != JSON_Error_AbortedByHandler)
@@ -126,16 +122,13 @@ static void RtlJSONLogError(RtlJSONContext *pCtx)
             (int)errorLocation.byte,
             JSON_ErrorString(error));
    }
-   else if (pCtx->writer && JSON_Writer_GetError(pCtx->writer) != JSON_Error_AbortedByHandler)
-   {
-      RARCH_ERR("Error: could not write output - %s.\n", JSON_ErrorString(JSON_Writer_GetError(pCtx->writer)));
-   }
 }
 
 /* Initialisation */
 
 /* Parses log file referenced by runtime_log->path.
- * Does nothing if log file does not exist. */
+ * Only used to import logs written by older versions
+ * into the runtime store. */
 static void runtime_log_read_file(runtime_log_t *runtime_log)
 {
    unsigned runtime_hours      = 0;
@@ -265,6 +258,142 @@ end:
    filestream_close(file);
 }
 
+/* Gets the key of the log at path in the runtime store:
+ * its path relative to the runtime log directory dir,
+ * using forward slashes */
+static void runtime_log_get_key(char *key, const char *path,
+      const char *dir, size_t len)
+{
+   char *s        = NULL;
+   size_t dir_len = strlen(dir);
+
+   if (dir_len && !strncmp(path, dir, dir_len))
+   {
+      path += dir_len;
+      while (*path == '/' || *path == '\\')
+         path++;
+   }
+
+   strlcpy(key, path, len);
+
+   for (s = key; *s; s++)
+      if (*s == '\\')
+         *s = '/';
+}
+
+static void runtime_log_to_entry(runtime_log_t *runtime_log,
+      runtime_store_entry_t *entry)
+{
+   entry->runtime_hours   = runtime_log->runtime.hours;
+   entry->runtime_minutes = runtime_log->runtime.minutes;
+   entry->runtime_seconds = runtime_log->runtime.seconds;
+
+   entry->year            = runtime_log->last_played.year;
+   entry->month           = runtime_log->last_played.month;
+   entry->day             = runtime_log->last_played.day;
+   entry->hour            = runtime_log->last_played.hour;
+   entry->minute          = runtime_log->last_played.minute;
+   entry->second          = runtime_log->last_played.second;
+}
+
+/* Imports the log files found in dir (and its per core
+ * subdirectories) into the runtime store. Done once, when
+ * the store does not exist yet. The log files are left
+ * alone, but are no longer read or updated. */
+static void runtime_log_import_files(const char *dir)
+{
+   size_t i;
+   unsigned imported         = 0;
+   struct string_list *list  = dir_list_new(dir,
+         file_path_str(FILE_PATH_RUNTIME_EXTENSION),
+         false, false, false, true);
+   runtime_log_t *runtime_log = NULL;
+
+   if (!list)
+      return;
+
+   if (list->size)
+      runtime_log = (runtime_log_t*)malloc(sizeof(*runtime_log));
+
+   for (i = 0; runtime_log && i < list->size; i++)
+   {
+      runtime_store_entry_t entry;
+      const char *path = list->elems[i].data;
+
+      memset(runtime_log, 0, sizeof(*runtime_log));
+      strlcpy(runtime_log->path, path, sizeof(runtime_log->path));
+      runtime_log_get_key(runtime_log->key, path, dir,
+            sizeof(runtime_log->key));
+      runtime_log_read_file(runtime_log);
+
+      if (  !runtime_log_has_runtime(runtime_log) &&
+            !runtime_log_has_last_played(runtime_log))
+         continue;
+
+      runtime_log_to_entry(runtime_log, &entry);
+
+      if (runtime_store_set(runtime_log->key, &entry))
+         imported++;
+   }
+
+   if (imported)
+   {
+      if (runtime_store_flush())
+         RARCH_LOG("[runtime] imported %u runtime log files.\n", imported);
+      else
+         RARCH_ERR("[runtime] failed to write runtime store.\n");
+   }
+
+   free(runtime_log);
+   string_list_free(list);
+}
+
+/* Loads the runtime store kept in dir, creating it from
+ * existing log files the first time */
+static bool runtime_log_store_init(const char *dir)
+{
+   char store_path[PATH_MAX_LENGTH];
+   bool import = false;
+
+   if (string_is_equal(runtime_log_store_dir, dir))
+      return true;
+
+   /* Create directory, if required */
+   if (!path_is_directory(dir))
+   {
+      if (!path_mkdir(dir))
+      {
+         RARCH_ERR("[runtime] failed to create directory for"
+               " runtime log: %s.\n", dir);
+         return false;
+      }
+   }
+
+   store_path[0] = '\0';
+   fill_pathname_join(store_path, dir,
+         file_path_str(FILE_PATH_RUNTIME_STORE), sizeof(store_path));
+
+   import = !path_is_valid(store_path);
+
+   if (!runtime_store_init(store_path))
+   {
+      if (runtime_store_is_read_only())
+         RARCH_ERR("[runtime] failed to read runtime store, runtime"
+               " logs will not be saved this session: %s\n",
+               store_path);
+      else
+         RARCH_WARN("[runtime] invalid runtime store, keeping a copy"
+               " as %s.bad\n", store_path);
+   }
+
+   strlcpy(runtime_log_store_dir, dir, sizeof(runtime_log_store_dir));
+
+   if (import)
+      runtime_log_import_files(dir);
+
+   return true;
+}
+
 /* Initialise runtime log, loading current parameters
  * if log file exists. Returned object must be free()'d.
  * Returns NULL if content_path and/or core_path are invalid */
@@ -281,6 +410,7 @@ runtime_log_t *runtime_log_init(
    char log_file_path[PATH_MAX_LENGTH];
    char tmp_buf[PATH_MAX_LENGTH];
    core_info_ctx_find_t core_info;
+   runtime_store_entry_t entry;
    runtime_log_t *runtime_log = NULL;
 
    content_name[0]            = '\0';
@@ -335,6 +465,9 @@ runtime_log_t *runtime_log_init(
    if (string_is_empty(tmp_buf))
       return NULL;
 
+   if (!runtime_log_store_init(tmp_buf))
+      return NULL;
+
    if (log_per_core)
       fill_pathname_join(
             log_file_dir,
@@ -347,17 +480,6 @@ runtime_log_t *runtime_log_init(
    if (string_is_empty(log_file_dir))
       return NULL;
 
-   /* Create directory, if required */
-   if (!path_is_directory(log_file_dir))
-   {
-      if (!path_mkdir(log_file_dir))
-      {
-         RARCH_ERR("[runtime] failed to create directory for"
-               " runtime log: %s.\n", log_file_dir);
-         return NULL;
-      }
-   }
-
    /* Get content name
     * Note: TyrQuake requires a specific hack, since all
     * content has the same name... */
@@ -419,12 +541,26 @@ runtime_log_t *runtime_log_init(
    runtime_log->last_played.second = 0;
 
    runtime_log->path[0]            = '\0';
+   runtime_log->key[0]             = '\0';
 
    strlcpy(runtime_log->path, log_file_path, sizeof(runtime_log->path));
+   runtime_log_get_key(runtime_log->key, log_file_path,
+         runtime_log_store_dir, sizeof(runtime_log->key));
 
-   /* Load existing log file, if it exists */
-   if (path_is_valid(runtime_log->path))
-      runtime_log_read_file(runtime_log);
+   /* Load existing entry, if it exists */
+   if (runtime_store_get(runtime_log->key, &entry))
+   {
+      runtime_log->runtime.hours      = entry.runtime_hours;
+      runtime_log->runtime.minutes    = entry.runtime_minutes;
+      runtime_log->runtime.seconds    = entry.runtime_seconds;
+
+      runtime_log->last_played.year   = entry.year;
+      runtime_log->last_played.month  = entry.month;
+      runtime_log->last_played.day    = entry.day;
+      runtime_log->last_played.hour   = entry.hour;
+      runtime_log->last_played.minute = entry.minute;
+      runtime_log->last_played.second = entry.second;
+   }
 
    return runtime_log;
 }
@@ -1117,109 +1253,30 @@ bool runtime_log_has_last_played(runtime_log_t *runtime_log)
 
 /* Saving */
 
-/* Saves specified runtime log to disk */
+/* Saves specified runtime log to disk
+ * (appends it to the runtime store) */
 void runtime_log_save(runtime_log_t *runtime_log)
 {
-   int n;
-   char value_string[64]; /* 64 characters should be
-                             enough for a very long runtime... :) */
-   RtlJSONContext context = {0};
-   RFILE *file            = NULL;
+   runtime_store_entry_t entry;
 
    if (!runtime_log)
       return;
 
-   RARCH_LOG("Saving runtime log file: %s\n", runtime_log->path);
+   RARCH_LOG("Saving runtime log: %s\n", runtime_log->key);
 
-   /* Attempt to open log file */
-   file = filestream_open(runtime_log->path,
-         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   runtime_log_to_entry(runtime_log, &entry);
 
-   if (!file)
-   {
-      RARCH_ERR("Failed to open runtime log file: %s\n", runtime_log->path);
-      return;
-   }
-
-   /* Initialise JSON writer */
-   context.writer = JSON_Writer_Create(NULL);
-   context.file   = file;
-
-   if (!context.writer)
-   {
-      RARCH_ERR("Failed to create JSON writer.\n");
-      goto end;
-   }
-
-   /* Configure JSON writer */
-   JSON_Writer_SetOutputEncoding(context.writer, JSON_UTF8);
-   JSON_Writer_SetOutputHandler(context.writer, &RtlJSONOutputHandler);
-   JSON_Writer_SetUserData(context.writer, &context);
-
-   /* Write output file */
-   JSON_Writer_WriteStartObject(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-
-   /* > Version entry */
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteString(context.writer, "version",
-         STRLEN_CONST("version"), JSON_UTF8);
-   JSON_Writer_WriteColon(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 1);
-   JSON_Writer_WriteString(context.writer, "1.0",
-         STRLEN_CONST("1.0"), JSON_UTF8);
-   JSON_Writer_WriteComma(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-
-   /* > Runtime entry */
-   value_string[0] = '\0';
-   n               = snprintf(value_string,
-         sizeof(value_string), LOG_FILE_RUNTIME_FORMAT_STR,
-         runtime_log->runtime.hours, runtime_log->runtime.minutes,
-         runtime_log->runtime.seconds);
-   if ((n < 0) || (n >= 64))
-      n = 0; /* Silence GCC warnings... */
-
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteString(context.writer, "runtime",
-         STRLEN_CONST("runtime"), JSON_UTF8);
-   JSON_Writer_WriteColon(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 1);
-   JSON_Writer_WriteString(context.writer, value_string,
-         strlen(value_string), JSON_UTF8);
-   JSON_Writer_WriteComma(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-
-   /* > Last played entry */
-   value_string[0] = '\0';
-   n               = snprintf(value_string, sizeof(value_string),
-         LOG_FILE_LAST_PLAYED_FORMAT_STR,
-         runtime_log->last_played.year, runtime_log->last_played.month,
-         runtime_log->last_played.day,
-         runtime_log->last_played.hour, runtime_log->last_played.minute,
-         runtime_log->last_played.second);
-   if ((n < 0) || (n >= 64))
-      n = 0; /* Silence GCC warnings... */
-
-   JSON_Writer_WriteSpace(context.writer, 2);
-   JSON_Writer_WriteString(context.writer, "last_played",
-         STRLEN_CONST("last_played"), JSON_UTF8);
-   JSON_Writer_WriteColon(context.writer);
-   JSON_Writer_WriteSpace(context.writer, 1);
-   JSON_Writer_WriteString(context.writer, value_string,
-         strlen(value_string), JSON_UTF8);
-   JSON_Writer_WriteNewLine(context.writer);
-
-   /* > Finalise */
-   JSON_Writer_WriteEndObject(context.writer);
-   JSON_Writer_WriteNewLine(context.writer);
-
-   /* Free JSON writer */
-   JSON_Writer_Free(context.writer);
+   /* Only the changed entry is appended to the store */
+   if (  !runtime_store_set(runtime_log->key, &entry) ||
+         !runtime_store_flush())
+      RARCH_ERR("Failed to save runtime log: %s\n", runtime_log->key);
+}
 
-end:
-   /* Close log file */
-   filestream_close(file);
+/* Frees the runtime store */
+void runtime_log_deinit(void)
+{
+   runtime_store_deinit();
+   runtime_log_store_dir[0] = '\0';
 }
 
 /* Utility functions */
@@ -103,7 +103,10 @@ typedef struct
 {
    rtl_runtime_t runtime;
    rtl_last_played_t last_played;
+   /* Log file written by older versions */
    char path[PATH_MAX_LENGTH];
+   /* Entry in the runtime store */
+   char key[PATH_MAX_LENGTH];
 } runtime_log_t;
 
 /* Initialisation */
@@ -118,6 +121,10 @@ runtime_log_t *runtime_log_init(
       const char *dir_playlist,
       bool log_per_core);
 
+/* Frees the runtime store, which holds the
+ * runtime logs of all content */
+void runtime_log_deinit(void);
+
 /* Setters */
 
 /* Set runtime to specified hours, minutes, seconds value */
@@ -182,7 +189,8 @@ bool runtime_log_has_last_played(runtime_log_t *runtime_log);
 
 /* Saving */
 
-/* Saves specified runtime log to disk */
+/* Saves specified runtime log to disk
+ * (appends it to the runtime store) */
 void runtime_log_save(runtime_log_t *runtime_log);
 
 /* Utility functions */
@@ -0,0 +1,559 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (runtime_store.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "runtime_store.h"
+
+/* "RTLS" */
+#define RUNTIME_STORE_MAGIC       0x534C5452
+#define RUNTIME_STORE_VERSION     1
+#define RUNTIME_STORE_HEADER_SIZE 8
+
+/* Fixed part of a record, followed by the key. The first 4 bytes
+ * are the CRC32 of everything after them. All fields, header
+ * included, are little endian. */
+#define RUNTIME_STORE_RECORD_SIZE 20
+
+/* The file is rewritten once it holds this many times more records
+ * than there are entries */
+#define RUNTIME_STORE_COMPACT_RATIO 4
+
+typedef struct runtime_store_item
+{
+   char *key;
+   uint32_t hash;
+   bool dirty;
+   runtime_store_entry_t entry;
+} runtime_store_item_t;
+
+typedef struct runtime_store_state
+{
+   runtime_store_item_t *items;
+   /* Open addressing over items, index + 1, 0 when empty */
+   uint32_t *table;
+   size_t count;
+   size_t capacity;
+   size_t table_size;
+   /* Records in the file, outdated ones included */
+   size_t records;
+   char path[PATH_MAX_LENGTH];
+   bool loaded;
+   /* The file is missing, damaged or mostly outdated records, and
+    * is rewritten instead of appended to */
+   bool rewrite;
+   /* Loading dropped part of the file; the old file is kept as
+    * <path>.bad when it is rewritten */
+   bool backup;
+   /* The file could not be read, so it is never written either */
+   bool read_only;
+} runtime_store_state_t;
+
+static runtime_store_state_t runtime_store_st;
+
+static runtime_store_item_t *runtime_store_find(
+      runtime_store_state_t *state, const char *key, uint32_t hash)
+{
+   size_t i;
+
+   if (!state->table_size)
+      return NULL;
+
+   for (i = hash & (state->table_size - 1); state->table[i];
+         i = (i + 1) & (state->table_size - 1))
+   {
+      runtime_store_item_t *item = &state->items[state->table[i] - 1];
+
+      if (item->hash == hash && string_is_equal(item->key, key))
+         return item;
+   }
+
+   return NULL;
+}
+
+static void runtime_store_rehash(runtime_store_state_t *state,
+      size_t table_size)
+{
+   size_t i;
+   uint32_t *table = (uint32_t*)calloc(table_size, sizeof(*table));
+
+   if (!table)
+      return;
+
+   for (i = 0; i < state->count; i++)
+   {
+      size_t j = state->items[i].hash & (table_size - 1);
+
+      while (table[j])
+         j = (j + 1) & (table_size - 1);
+
+      table[j] = (uint32_t)(i + 1);
+   }
+
+   free(state->table);
+   state->table      = table;
+   state->table_size = table_size;
+}
+
+static runtime_store_item_t *runtime_store_add(
+      runtime_store_state_t *state, const char *key, uint32_t hash)
+{
+   runtime_store_item_t *item = NULL;
+
+   if (state->count == state->capacity)
+   {
+      size_t capacity             = state->capacity
+         ? state->capacity * 2 : 256;
+      runtime_store_item_t *items = (runtime_store_item_t*)
+         realloc(state->items, capacity * sizeof(*items));
+
+      if (!items)
+         return NULL;
+
+      state->items    = items;
+      state->capacity = capacity;
+   }
+
+   item       = &state->items[state->count];
+   memset(item, 0, sizeof(*item));
+   item->hash = hash;
+
+   if (!(item->key = strdup(key)))
+      return NULL;
+
+   state->count++;
+
+   /* Keep the table at most half full */
+   if (state->count * 2 > state->table_size)
+      runtime_store_rehash(state,
+            state->table_size ? state->table_size * 2 : 512);
+   else
+   {
+      size_t i = hash & (state->table_size - 1);
+
+      while (state->table[i])
+         i = (i + 1) & (state->table_size - 1);
+
+      state->table[i] = (uint32_t)state->count;
+   }
+
+   return item;
+}
+
+static void runtime_store_free_items(runtime_store_state_t *state)
+{
+   size_t i;
+
+   for (i = 0; i < state->count; i++)
+      free(state->items[i].key);
+
+   free(state->items);
+   free(state->table);
+
+   state->items      = NULL;
+   state->table      = NULL;
+   state->count      = 0;
+   state->capacity   = 0;
+   state->table_size = 0;
+   state->records    = 0;
+}
+
+static void runtime_store_put16(uint8_t *ptr, uint16_t val)
+{
+   val = swap_if_big16(val);
+   memcpy(ptr, &val, sizeof(val));
+}
+
+static void runtime_store_put32(uint8_t *ptr, uint32_t val)
+{
+   val = swap_if_big32(val);
+   memcpy(ptr, &val, sizeof(val));
+}
+
+static uint16_t runtime_store_get16(const uint8_t *ptr)
+{
+   uint16_t val;
+   memcpy(&val, ptr, sizeof(val));
+   return swap_if_big16(val);
+}
+
+static uint32_t runtime_store_get32(const uint8_t *ptr)
+{
+   uint32_t val;
+   memcpy(&val, ptr, sizeof(val));
+   return swap_if_big32(val);
+}
+
+/* Writes the record of @item to @ptr, returns its size */
+static size_t runtime_store_write_record(uint8_t *ptr,
+      const runtime_store_item_t *item)
+{
+   uint16_t key_len = (uint16_t)strlen(item->key);
+
+   runtime_store_put16(ptr + 4, key_len);
+   runtime_store_put16(ptr + 6, (uint16_t)item->entry.year);
+   runtime_store_put32(ptr + 8, item->entry.runtime_hours);
+   ptr[12] = (uint8_t)item->entry.runtime_minutes;
+   ptr[13] = (uint8_t)item->entry.runtime_seconds;
+   ptr[14] = (uint8_t)item->entry.month;
+   ptr[15] = (uint8_t)item->entry.day;
+   ptr[16] = (uint8_t)item->entry.hour;
+   ptr[17] = (uint8_t)item->entry.minute;
+   ptr[18] = (uint8_t)item->entry.second;
+   ptr[19] = 0;
+   memcpy(ptr + RUNTIME_STORE_RECORD_SIZE, item->key, key_len);
+
+   runtime_store_put32(ptr, encoding_crc32(0, ptr + 4,
+         RUNTIME_STORE_RECORD_SIZE - 4 + key_len));
+
+   return RUNTIME_STORE_RECORD_SIZE + key_len;
+}
+
+static bool runtime_store_load(runtime_store_state_t *state)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+   const uint8_t *ptr;
+   const uint8_t *end;
+
+   if (!path_is_valid(state->path))
+   {
+      state->rewrite = true;
+      return true;
+   }
+
+   /* Not the same as a damaged file: the data may well be fine,
+    * so leave it alone rather than replace it with this session */
+   if (!filestream_read_file(state->path, &buf, &len))
+   {
+      state->read_only = true;
+      return false;
+   }
+
+   ptr = (const uint8_t*)buf;
+   end = ptr + len;
+
+   /* A store written by a big endian build before all fields were
+    * little endian fails here too */
+   if (     len < RUNTIME_STORE_HEADER_SIZE
+         || runtime_store_get32(ptr)     != RUNTIME_STORE_MAGIC
+         || runtime_store_get32(ptr + 4) != RUNTIME_STORE_VERSION)
+   {
+      free(buf);
+      state->rewrite = true;
+      state->backup  = true;
+      return false;
+   }
+
+   ptr += RUNTIME_STORE_HEADER_SIZE;
+
+   /* Later records replace earlier ones for the same key. Stop at
+    * the first damaged record, which is most likely one that was
+    * being written when RetroArch was interrupted. */
+   while (ptr < end)
+   {
+      char key[PATH_MAX_LENGTH];
+      uint32_t hash;
+      uint16_t key_len;
+      runtime_store_item_t *item = NULL;
+
+      if (end - ptr < RUNTIME_STORE_RECORD_SIZE)
+         break;
+
+      key_len = runtime_store_get16(ptr + 4);
+
+      if (     !key_len
+            || key_len >= sizeof(key)
+            || end - ptr < RUNTIME_STORE_RECORD_SIZE + key_len
+            || runtime_store_get32(ptr) != encoding_crc32(0, ptr + 4,
+               RUNTIME_STORE_RECORD_SIZE - 4 + key_len))
+         break;
+
+      memcpy(key, ptr + RUNTIME_STORE_RECORD_SIZE, key_len);
+      key[key_len] = '\0';
+      hash         = djb2_calculate(key);
+
+      /* Out of memory says nothing about the file, which must
+       * then not be replaced by the part of it that was loaded */
+      if (     !(item = runtime_store_find(state, key, hash))
+            && !(item = runtime_store_add(state, key, hash)))
+      {
+         free(buf);
+         state->read_only = true;
+         return false;
+      }
+
+      item->entry.runtime_hours   = runtime_store_get32(ptr + 8);
+      item->entry.runtime_minutes = ptr[12];
+      item->entry.runtime_seconds = ptr[13];
+      item->entry.year            = runtime_store_get16(ptr + 6);
+      item->entry.month           = ptr[14];
+      item->entry.day             = ptr[15];
+      item->entry.hour            = ptr[16];
+      item->entry.minute          = ptr[17];
+      item->entry.second          = ptr[18];
+
+      state->records++;
+      ptr += RUNTIME_STORE_RECORD_SIZE + key_len;
+   }
+
+   if (ptr != end)
+   {
+      state->rewrite = true;
+      state->backup  = true;
+   }
+   else if (state->records >
+         state->count * RUNTIME_STORE_COMPACT_RATIO + 64)
+      state->rewrite = true;
+
+   free(buf);
+   return true;
+}
+
+/* Writes all entries to a new file, replacing the old one */
+static bool runtime_store_write_all(runtime_store_state_t *state)
+{
+   char tmp[PATH_MAX_LENGTH];
+   size_t i;
+   size_t len   = RUNTIME_STORE_HEADER_SIZE;
+   uint8_t *buf = NULL;
+   uint8_t *ptr = NULL;
+   bool ret     = false;
+
+   for (i = 0; i < state->count; i++)
+      len += RUNTIME_STORE_RECORD_SIZE + strlen(state->items[i].key);
+
+   if (!(buf = (uint8_t*)malloc(len)))
+      return false;
+
+   runtime_store_put32(buf,     RUNTIME_STORE_MAGIC);
+   runtime_store_put32(buf + 4, RUNTIME_STORE_VERSION);
+   ptr = buf + RUNTIME_STORE_HEADER_SIZE;
+
+   for (i = 0; i < state->count; i++)
+      ptr += runtime_store_write_record(ptr, &state->items[i]);
+
+   /* Written next to the store and renamed, so it is never left
+    * half written */
+   strlcpy(tmp, state->path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   if (filestream_write_file(tmp, buf, (int64_t)len))
+   {
+      /* Keep whatever loading could not make sense of */
+      if (state->backup && path_is_valid(state->path))
+      {
+         char bad[PATH_MAX_LENGTH];
+
+         strlcpy(bad, state->path, sizeof(bad));
+         strlcat(bad, ".bad", sizeof(bad));
+         filestream_delete(bad);
+         filestream_rename(state->path, bad);
+      }
+
+      filestream_delete(state->path);
+
+      if (!filestream_rename(tmp, state->path))
+         ret = true;
+      else
+         filestream_delete(tmp);
+   }
+
+   if (ret)
+   {
+      for (i = 0; i < state->count; i++)
+         state->items[i].dirty = false;
+
+      state->records = state->count;
+      state->rewrite = false;
+      state->backup  = false;
+   }
+
+   free(buf);
+   return ret;
+}
+
+/* Appends the records of the changed entries */
+static bool runtime_store_append(runtime_store_state_t *state)
+{
+   size_t i;
+   size_t len   = 0;
+   size_t dirty = 0;
+   uint8_t *buf = NULL;
+   uint8_t *ptr = NULL;
+   RFILE *file  = NULL;
+   bool ret     = false;
+
+   for (i = 0; i < state->count; i++)
+   {
+      if (state->items[i].dirty)
+      {
+         len += RUNTIME_STORE_RECORD_SIZE + strlen(state->items[i].key);
+         dirty++;
+      }
+   }
+
+   if (!dirty)
+      return true;
+
+   if (!(buf = (uint8_t*)malloc(len)))
+      return false;
+
+   ptr = buf;
+
+   for (i = 0; i < state->count; i++)
+      if (state->items[i].dirty)
+         ptr += runtime_store_write_record(ptr, &state->items[i]);
+
+   file = filestream_open(state->path,
+         RETRO_VFS_FILE_ACCESS_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file)
+   {
+      /* One write, so a crash leaves at most one damaged record at
+       * the end, which loading drops */
+      if (     filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END) != -1
+            && filestream_write(file, buf, (int64_t)len) == (int64_t)len)
+         ret = true;
+
+      if (filestream_close(file) != 0)
+         ret = false;
+   }
+
+   if (ret)
+   {
+      for (i = 0; i < state->count; i++)
+         state->items[i].dirty = false;
+
+      state->records += dirty;
+   }
+   else
+      state->rewrite  = true;
+
+   free(buf);
+   return ret;
+}
+
+bool runtime_store_init(const char *path)
+{
+   runtime_store_state_t *state = &runtime_store_st;
+
+   if (string_is_empty(path))
+      return false;
+
+   if (state->loaded && string_is_equal(state->path, path))
+      return true;
+
+   runtime_store_free_items(state);
+   strlcpy(state->path, path, sizeof(state->path));
+
+   state->loaded    = true;
+   state->rewrite   = false;
+   state->backup    = false;
+   state->read_only = false;
+
+   return runtime_store_load(state);
+}
+
+void runtime_store_deinit(void)
+{
+   runtime_store_state_t *state = &runtime_store_st;
+
+   runtime_store_free_items(state);
+   memset(state, 0, sizeof(*state));
+}
+
+bool runtime_store_get(const char *key, runtime_store_entry_t *entry)
+{
+   runtime_store_state_t *state = &runtime_store_st;
+   runtime_store_item_t *item   = NULL;
+
+   if (!state->loaded || string_is_empty(key))
+      return false;
+
+   if (!(item = runtime_store_find(state, key, djb2_calculate(key))))
+      return false;
+
+   *entry = item->entry;
+   return true;
+}
+
+bool runtime_store_set(const char *key, const runtime_store_entry_t *entry)
+{
+   uint32_t hash;
+   runtime_store_state_t *state = &runtime_store_st;
+   runtime_store_item_t *item   = NULL;
+
+   if (     !state->loaded
+         || string_is_empty(key)
+         || strlen(key) >= PATH_MAX_LENGTH)
+      return false;
+
+   hash = djb2_calculate(key);
+
+   if (     !(item = runtime_store_find(state, key, hash))
+         && !(item = runtime_store_add(state, key, hash)))
+      return false;
+
+   if (memcmp(&item->entry, entry, sizeof(*entry)))
+   {
+      item->entry = *entry;
+      item->dirty = true;
+   }
+
+   return true;
+}
+
+bool runtime_store_flush(void)
+{
+   runtime_store_state_t *state = &runtime_store_st;
+
+   if (!state->loaded || state->read_only)
+      return false;
+
+   if (state->rewrite || !path_is_valid(state->path))
+      return runtime_store_write_all(state);
+
+   return runtime_store_append(state);
+}
+
+size_t runtime_store_size(void)
+{
+   return runtime_store_st.count;
+}
+
+bool runtime_store_is_read_only(void)
+{
+   return runtime_store_st.read_only;
+}
@@ -0,0 +1,94 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (runtime_store.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __RUNTIME_STORE_H
+#define __RUNTIME_STORE_H
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Single file holding the runtime and last played time of all
+ * content, replacing one small log file per content (and core).
+ * The whole store is read once into a hash table; changes are
+ * appended to the file as checksummed records, so a session only
+ * writes the entries it changed and an interrupted write loses at
+ * most that last record. The file is rewritten from memory once it
+ * holds too many outdated records.
+ *
+ * Not thread safe - only used from the main thread. */
+
+typedef struct runtime_store_entry
+{
+   unsigned runtime_hours;
+   unsigned runtime_minutes;
+   unsigned runtime_seconds;
+   unsigned year;
+   unsigned month;
+   unsigned day;
+   unsigned hour;
+   unsigned minute;
+   unsigned second;
+} runtime_store_entry_t;
+
+/**
+ * runtime_store_init:
+ * @path               : File the store is kept in.
+ *
+ * Loads the store. Does nothing if it is already loaded from @path.
+ *
+ * Returns: false if the file exists but could not be loaded. If it
+ * could not be read, the store is read only until the next init
+ * (see runtime_store_is_read_only()). If it is not a valid store,
+ * it is moved to <path>.bad and replaced on the next flush. A
+ * damaged tail is dropped, everything before it is kept, and the
+ * file is likewise moved aside before it is rewritten.
+ **/
+bool runtime_store_init(const char *path);
+
+/* Frees the store. Changes not yet flushed are lost. */
+void runtime_store_deinit(void);
+
+/* Returns: true if @key has an entry, copied to @entry. */
+bool runtime_store_get(const char *key, runtime_store_entry_t *entry);
+
+/* Sets the entry of @key. Written on the next flush. */
+bool runtime_store_set(const char *key, const runtime_store_entry_t *entry);
+
+/* Appends the changed entries to the file, or rewrites it if it
+ * has to be compacted. Fails without writing anything while the
+ * store is read only. */
+bool runtime_store_flush(void);
+
+/* Number of entries */
+size_t runtime_store_size(void);
+
+/* Returns: true if the file could not be read by the last init, and
+ * is left untouched until the next one. */
+bool runtime_store_is_read_only(void);
+
+RETRO_END_DECLS
+
+#endif
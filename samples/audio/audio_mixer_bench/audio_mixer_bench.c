@@ -0,0 +1,291 @@
+/* Benchmark and regression harness for the audio mixer's streams.
+ *
+ *   audio_mixer_bench [file.ogg|.mod|.s3m|.xm|.flac|.mp3 ...]
+ *
+ * Plays 8 looping streams at once and calls audio_mixer_mix() in the
+ * blocks audio_driver_flush() uses, paced at the output rate like a
+ * real audio driver would. This is done twice: once with the streams
+ * decoded inside audio_mixer_mix(), as before, and once with the
+ * decoder thread filling them ahead. The mixed output of both runs
+ * must be identical and the threaded run must not underrun; the time
+ * spent in each audio_mixer_mix() call is reported for both.
+ *
+ * Without arguments, a 16 channel MOD generated in memory is used for
+ * all streams, otherwise the given files are cycled through.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <retro_timers.h>
+#include <audio/audio_mixer.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+
+#define BENCH_RATE      48000
+#define BENCH_STREAMS   8
+#define BENCH_SECONDS   4
+/* AUDIO_PIPELINE_BLOCK_FRAMES */
+#define BENCH_BLOCK     256
+#define BENCH_BLOCKS    (BENCH_RATE * BENCH_SECONDS / BENCH_BLOCK)
+
+#define MOD_CHANNELS    16
+#define MOD_SAMPLE_LEN  256
+
+typedef struct bench_result
+{
+   float *output;
+   retro_time_t total;
+   retro_time_t worst;
+   retro_time_t p99;
+   audio_mixer_stats_t stats;
+} bench_result_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* A one pattern, MOD_CHANNELS channel MOD playing a looped sawtooth
+ * on every channel and row. */
+static void *generate_mod(int32_t *size)
+{
+   static const unsigned periods[] = {
+      428, 381, 339, 320, 285, 254, 226, 214 };
+   unsigned row, chan, i;
+   size_t pattern_size = 64 * MOD_CHANNELS * 4;
+   size_t len          = 1084 + pattern_size + MOD_SAMPLE_LEN;
+   uint8_t *mod        = (uint8_t*)calloc(1, len);
+   uint8_t *ptr        = NULL;
+
+   if (!mod)
+      return NULL;
+
+   memcpy(mod, "audio_mixer_bench", 17);
+
+   /* Sample 1, looped over its whole length at full volume */
+   mod[42]   = (MOD_SAMPLE_LEN / 2) >> 8;
+   mod[43]   = (MOD_SAMPLE_LEN / 2) & 0xFF;
+   mod[45]   = 64;
+   mod[48]   = (MOD_SAMPLE_LEN / 2) >> 8;
+   mod[49]   = (MOD_SAMPLE_LEN / 2) & 0xFF;
+
+   mod[950]  = 1;
+   mod[951]  = 0;
+   mod[952]  = 0;
+   mod[1080] = '0' + MOD_CHANNELS / 10;
+   mod[1081] = '0' + MOD_CHANNELS % 10;
+   mod[1082] = 'C';
+   mod[1083] = 'H';
+
+   ptr       = mod + 1084;
+
+   for (row = 0; row < 64; row++)
+   {
+      for (chan = 0; chan < MOD_CHANNELS; chan++, ptr += 4)
+      {
+         unsigned period = periods[(row + chan * 3) & 7] >> (chan & 1);
+
+         ptr[0] = (period >> 8) & 0x0F;
+         ptr[1] = period & 0xFF;
+         ptr[2] = 1 << 4;
+         /* Set the volume low enough for 16 channels not to clip */
+         ptr[2] |= 0x0C;
+         ptr[3] = 16 + (chan & 7);
+      }
+   }
+
+   for (i = 0; i < MOD_SAMPLE_LEN; i++)
+      *ptr++ = (uint8_t)(int8_t)((int)(i * 256 / MOD_SAMPLE_LEN) - 128);
+
+   *size = (int32_t)len;
+   return mod;
+}
+
+static audio_mixer_sound_t *load_sound(const char *path)
+{
+   void *buf        = NULL;
+   int64_t len      = 0;
+   const char *ext  = NULL;
+
+   if (!path)
+   {
+      int32_t size = 0;
+
+      if (!(buf = generate_mod(&size)))
+         return NULL;
+
+      return audio_mixer_load_mod(buf, size);
+   }
+
+   if (!filestream_read_file(path, &buf, &len))
+      return NULL;
+
+   ext = path_get_extension(path);
+
+   if (string_is_equal_noncase(ext, "ogg"))
+      return audio_mixer_load_ogg(buf, (int32_t)len);
+   if (string_is_equal_noncase(ext, "flac"))
+      return audio_mixer_load_flac(buf, (int32_t)len);
+   if (string_is_equal_noncase(ext, "mp3"))
+      return audio_mixer_load_mp3(buf, (int32_t)len);
+   if (     string_is_equal_noncase(ext, "mod")
+         || string_is_equal_noncase(ext, "s3m")
+         || string_is_equal_noncase(ext, "xm"))
+      return audio_mixer_load_mod(buf, (int32_t)len);
+
+   free(buf);
+   return NULL;
+}
+
+static int compare_time(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+static bool run(bool threaded, int argc, char **argv,
+      bench_result_t *result)
+{
+   unsigned i;
+   audio_mixer_sound_t *sounds[BENCH_STREAMS];
+   audio_mixer_voice_t *voices[BENCH_STREAMS];
+   retro_time_t *times = (retro_time_t*)calloc(BENCH_BLOCKS,
+         sizeof(*times));
+   retro_time_t start  = 0;
+   bool ret            = true;
+
+   result->output = (float*)calloc(BENCH_BLOCKS * BENCH_BLOCK * 2,
+         sizeof(float));
+   result->total  = 0;
+   result->worst  = 0;
+
+   if (!times || !result->output)
+      return false;
+
+   audio_mixer_init(BENCH_RATE);
+   audio_mixer_set_threaded(threaded);
+
+   for (i = 0; i < BENCH_STREAMS; i++)
+   {
+      const char *path = argc > 1 ? argv[1 + i % (argc - 1)] : NULL;
+
+      sounds[i] = load_sound(path);
+      voices[i] = sounds[i] ? audio_mixer_play(sounds[i], true,
+            1.0f / BENCH_STREAMS, NULL) : NULL;
+
+      if (!voices[i])
+      {
+         fprintf(stderr, "Could not play %s.\n",
+               path ? path : "the generated MOD");
+         ret = false;
+      }
+   }
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; ret && i < BENCH_BLOCKS; i++)
+   {
+      float *out       = result->output + i * BENCH_BLOCK * 2;
+      retro_time_t due = start
+         + (retro_time_t)i * BENCH_BLOCK * 1000000 / BENCH_RATE;
+      retro_time_t t0;
+
+      /* Wait for the audio driver to want the next block */
+      while (cpu_features_get_time_usec() < due)
+         retro_sleep(1);
+
+      t0       = cpu_features_get_time_usec();
+      audio_mixer_mix(out, BENCH_BLOCK, 0.0f, false);
+      times[i] = cpu_features_get_time_usec() - t0;
+
+      result->total += times[i];
+      if (times[i] > result->worst)
+         result->worst = times[i];
+   }
+
+   audio_mixer_get_stats(&result->stats);
+
+   for (i = 0; i < BENCH_STREAMS; i++)
+   {
+      if (voices[i])
+         audio_mixer_stop(voices[i]);
+      audio_mixer_destroy(sounds[i]);
+   }
+
+   audio_mixer_done();
+
+   qsort(times, BENCH_BLOCKS, sizeof(*times), compare_time);
+   result->p99 = times[BENCH_BLOCKS * 99 / 100];
+
+   free(times);
+   return ret;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i;
+   char msg[256];
+   float peak = 0.0f;
+   bench_result_t sync_result, thread_result;
+
+   printf("Mixing %d streams in blocks of %d frames at %d Hz for %d s.\n",
+         BENCH_STREAMS, BENCH_BLOCK, BENCH_RATE, BENCH_SECONDS);
+
+   check(run(false, argc, argv, &sync_result), "synchronous", "played");
+   check(run(true,  argc, argv, &thread_result), "threaded", "played");
+
+   if (failures)
+      goto end;
+
+   for (i = 0; i < BENCH_BLOCKS * BENCH_BLOCK * 2; i++)
+      if (fabsf(sync_result.output[i]) > peak)
+         peak = fabsf(sync_result.output[i]);
+
+   snprintf(msg, sizeof(msg), "peak level %.3f", peak);
+   check(peak > 0.01f, "synchronous", msg);
+
+   snprintf(msg, sizeof(msg), "%u underruns (%u frames)",
+         thread_result.stats.underruns,
+         thread_result.stats.underrun_frames);
+   check(!thread_result.stats.underruns, "threaded", msg);
+
+   check(!memcmp(sync_result.output, thread_result.output,
+            BENCH_BLOCKS * BENCH_BLOCK * 2 * sizeof(float)),
+         "threaded", "output identical to synchronous decoding");
+
+   printf("%-12s %10s %10s %10s\n", "decoding", "avg (us)",
+         "p99 (us)", "max (us)");
+   printf("%-12s %10.1f %10u %10u\n", "synchronous",
+         (double)sync_result.total / BENCH_BLOCKS,
+         (unsigned)sync_result.p99, (unsigned)sync_result.worst);
+   printf("%-12s %10.1f %10u %10u\n", "threaded",
+         (double)thread_result.total / BENCH_BLOCKS,
+         (unsigned)thread_result.p99, (unsigned)thread_result.worst);
+
+end:
+   free(sync_result.output);
+   free(thread_result.output);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
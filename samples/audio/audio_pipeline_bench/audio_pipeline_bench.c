@@ -0,0 +1,455 @@
+/* Benchmark and regression harness for the audio output pipeline.
+ *
+ *   audio_pipeline_bench [dsp preset]
+ *
+ * Feeds a synthetic core signal, in the batches cores usually hand
+ * to the frontend, through audio_pipeline_process() for a number of
+ * setups (resampler, DSP filter, mixer, float or s16 output, ratio of
+ * exactly 1). The bytes written to the audio driver must match those
+ * of the previous audio_driver_flush(), which made one pass over the
+ * whole batch per stage; that implementation is kept below as the
+ * reference. Both are then timed against a null audio driver that
+ * discards everything, and the average nanoseconds per input frame
+ * are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <audio/audio_mixer.h>
+#include <audio/audio_resampler.h>
+#include <audio/conversion/float_to_s16.h>
+#include <audio/conversion/s16_to_float.h>
+#include <features/features_cpu.h>
+
+#include "../../../audio/audio_defines.h"
+#include "../../../audio/audio_pipeline.h"
+
+#define BENCH_RATE_IN  44100
+#define BENCH_RATE_OUT 48000
+#define BENCH_SECONDS  10
+#define BENCH_FRAMES   (BENCH_RATE_IN * BENCH_SECONDS)
+/* Largest batch audio_driver_sample_batch() passes on. */
+#define BENCH_BATCH    1024
+#define BENCH_RUNS     3
+
+typedef struct bench_setup
+{
+   const char *name;
+   const char *resampler;
+   double ratio;
+   float gain;
+   bool dsp;
+   bool mixer;
+   bool use_float;
+   bool passthrough;
+} bench_setup_t;
+
+typedef struct bench_sink
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+} bench_sink_t;
+
+static const bench_setup_t setups[] = {
+   { "sinc",                  "sinc",    (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      1.0f, false, false, false, true },
+   { "sinc, gain 0.5",        "sinc",    (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      0.5f, false, false, false, true },
+   { "sinc, float",           "sinc",    (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      1.0f, false, false, true,  true },
+   { "sinc + dsp",            "sinc",    (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      1.0f, true,  false, false, true },
+   { "sinc + dsp + mixer",    "sinc",    (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      1.0f, true,  true,  false, true },
+   { "nearest",               "nearest", (double)BENCH_RATE_OUT / BENCH_RATE_IN,
+      1.0f, false, false, false, true },
+   { "sinc, ratio 1",         "sinc",    1.0,
+      1.0f, false, false, false, false },
+   { "passthrough",           "sinc",    1.0,
+      1.0f, false, false, false, true },
+   { "passthrough, gain 0.5", "sinc",    1.0,
+      0.5f, false, false, false, true },
+   { "passthrough, float",    "sinc",    1.0,
+      1.0f, false, false, true,  true },
+};
+
+static unsigned failures = 0;
+static const char *dsp_preset =
+   "../../../libretro-common/audio/dsp_filters/EchoReverb.dsp";
+
+static float *ref_input;
+static float *ref_output;
+static int16_t *ref_conv;
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR]: %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static ssize_t bench_sink_write(void *data, const void *buf, size_t size)
+{
+   bench_sink_t *sink = (bench_sink_t*)data;
+
+   if (sink->size + size > sink->capacity)
+   {
+      sink->capacity = (sink->size + size) * 2;
+      sink->data     = (uint8_t*)realloc(sink->data, sink->capacity);
+   }
+
+   memcpy(sink->data + sink->size, buf, size);
+   sink->size += size;
+   return size;
+}
+
+/* What the null audio driver would do. */
+static ssize_t bench_null_write(void *data, const void *buf, size_t size)
+{
+   (void)data;
+   (void)buf;
+   return size;
+}
+
+/* audio_driver_flush() before audio_pipeline_process(): every stage
+ * runs over the whole batch before the next one starts. With
+ * passthrough, the resampler is left out instead. */
+static bool bench_flush_reference(const audio_pipeline_stages_t *stages,
+      const int16_t *data, size_t samples)
+{
+   struct resampler_data src_data;
+   const void *output_data = ref_output;
+   size_t output_frames;
+
+   convert_s16_to_float(ref_input, data, samples, stages->gain);
+
+   src_data.data_in      = ref_input;
+   src_data.input_frames = samples >> 1;
+
+   if (stages->dsp)
+   {
+      struct retro_dsp_data dsp_data;
+
+      dsp_data.input        = ref_input;
+      dsp_data.input_frames = (unsigned)(samples >> 1);
+      dsp_data.output       = NULL;
+
+      retro_dsp_filter_process(stages->dsp, &dsp_data);
+
+      if (dsp_data.output)
+      {
+         src_data.data_in      = dsp_data.output;
+         src_data.input_frames = dsp_data.output_frames;
+      }
+   }
+
+   src_data.data_out = ref_output;
+   src_data.ratio    = stages->ratio;
+
+   if (     stages->passthrough
+         && fabs(stages->ratio - 1.0) < AUDIO_PIPELINE_PASSTHROUGH_EPSILON)
+   {
+      memcpy(ref_output, src_data.data_in,
+            src_data.input_frames * 2 * sizeof(float));
+      src_data.output_frames = src_data.input_frames;
+   }
+   else
+      stages->resampler->process(stages->resampler_data, &src_data);
+
+   if (stages->mixer)
+      audio_mixer_mix(ref_output, src_data.output_frames,
+            stages->mixer_gain, stages->mixer_override);
+
+   output_frames = src_data.output_frames;
+
+   if (stages->use_float)
+      output_frames *= sizeof(float);
+   else
+   {
+      convert_float_to_s16(ref_conv, ref_output, output_frames * 2);
+      output_data    = ref_conv;
+      output_frames *= sizeof(int16_t);
+   }
+
+   return stages->write(stages->write_data,
+         output_data, output_frames * 2) >= 0;
+}
+
+/* A tone plus noise, with a few clipped peaks. */
+static void bench_signal(int16_t *samples, size_t frames)
+{
+   size_t i;
+   uint32_t seed = 1;
+
+   for (i = 0; i < frames; i++)
+   {
+      float t   = (float)i / BENCH_RATE_IN;
+      int32_t l = (int32_t)(20000.0f * sinf(2.0f * M_PI * 220.0f * t));
+      int32_t r = (int32_t)(36000.0f * sinf(2.0f * M_PI * 3.0f * t));
+
+      seed  = seed * 1664525u + 1013904223u;
+      l    += (int32_t)(seed >> 20) - 2048;
+      seed  = seed * 1664525u + 1013904223u;
+      r    += (int32_t)(seed >> 20) - 2048;
+
+      samples[i * 2 + 0] = (int16_t)MAX(-0x8000, MIN(0x7fff, l));
+      samples[i * 2 + 1] = (int16_t)MAX(-0x8000, MIN(0x7fff, r));
+   }
+}
+
+/* One second of a stereo 16-bit WAV at the output rate. */
+static void *bench_wav(size_t *size)
+{
+   size_t i;
+   size_t frames  = BENCH_RATE_OUT;
+   size_t bytes   = frames * 4;
+   uint8_t *wav   = (uint8_t*)calloc(1, 44 + bytes);
+   int16_t *pcm   = (int16_t*)(wav + 44);
+   uint32_t value;
+   uint16_t half;
+
+#define BENCH_PUT32(off, v) value = (v); memcpy(wav + (off), &value, 4)
+#define BENCH_PUT16(off, v) half  = (v); memcpy(wav + (off), &half, 2)
+   memcpy(wav + 0,  "RIFF", 4);
+   BENCH_PUT32(4,   (uint32_t)(36 + bytes));
+   memcpy(wav + 8,  "WAVE", 4);
+   memcpy(wav + 12, "fmt ", 4);
+   BENCH_PUT32(16,  16);
+   BENCH_PUT16(20,  1);
+   BENCH_PUT16(22,  2);
+   BENCH_PUT32(24,  BENCH_RATE_OUT);
+   BENCH_PUT32(28,  BENCH_RATE_OUT * 4);
+   BENCH_PUT16(32,  4);
+   BENCH_PUT16(34,  16);
+   memcpy(wav + 36, "data", 4);
+   BENCH_PUT32(40,  (uint32_t)bytes);
+#undef BENCH_PUT32
+#undef BENCH_PUT16
+
+   for (i = 0; i < frames; i++)
+   {
+      int16_t v      = (int16_t)(24000.0f
+            * sinf(2.0f * M_PI * 440.0f * i / BENCH_RATE_OUT));
+      pcm[i * 2 + 0] = v;
+      pcm[i * 2 + 1] = -v;
+   }
+
+   *size = 44 + bytes;
+   return wav;
+}
+
+typedef struct bench_run
+{
+   audio_pipeline_stages_t stages;
+   audio_mixer_sound_t *sound;
+   void *wav;
+} bench_run_t;
+
+static bool bench_run_init(bench_run_t *run, const bench_setup_t *setup,
+      ssize_t (*write)(void*, const void*, size_t), void *write_data)
+{
+   memset(run, 0, sizeof(*run));
+
+   run->stages.write       = write;
+   run->stages.write_data  = write_data;
+   run->stages.ratio       = setup->ratio;
+   run->stages.gain        = setup->gain;
+   run->stages.use_float   = setup->use_float;
+   run->stages.passthrough = setup->passthrough;
+   run->stages.mixer_gain  = 1.0f;
+
+   if (!retro_resampler_realloc(&run->stages.resampler_data,
+            &run->stages.resampler, setup->resampler,
+            RESAMPLER_QUALITY_NORMAL, setup->ratio))
+      return false;
+
+   if (setup->dsp && !(run->stages.dsp = retro_dsp_filter_new(
+               dsp_preset, NULL, BENCH_RATE_IN)))
+      return false;
+
+   if (setup->mixer)
+   {
+      size_t size;
+
+      audio_mixer_init(BENCH_RATE_OUT);
+      run->wav   = bench_wav(&size);
+      run->sound = audio_mixer_load_wav(run->wav, (int32_t)size);
+      if (!run->sound || !audio_mixer_play(run->sound, true, 0.5f, NULL))
+         return false;
+      run->stages.mixer = true;
+   }
+
+   return true;
+}
+
+static void bench_run_free(bench_run_t *run)
+{
+   if (run->stages.resampler_data)
+      run->stages.resampler->free(run->stages.resampler_data);
+   if (run->stages.dsp)
+      retro_dsp_filter_free(run->stages.dsp);
+   if (run->sound)
+   {
+      audio_mixer_done();
+      audio_mixer_destroy(run->sound);
+   }
+   free(run->wav);
+}
+
+static bool bench_run(const bench_setup_t *setup, audio_pipeline_t *pipe,
+      const int16_t *signal, bool reference,
+      ssize_t (*write)(void*, const void*, size_t), void *write_data)
+{
+   size_t i;
+   bench_run_t run;
+   bool ret = true;
+
+   if (!bench_run_init(&run, setup, write, write_data))
+   {
+      bench_run_free(&run);
+      return false;
+   }
+
+   for (i = 0; i < BENCH_FRAMES && ret; i += BENCH_BATCH)
+   {
+      size_t frames = MIN(BENCH_BATCH, BENCH_FRAMES - i);
+
+      if (reference)
+         ret = bench_flush_reference(&run.stages, signal + i * 2, frames * 2);
+      else
+         ret = audio_pipeline_process(pipe, &run.stages,
+               signal + i * 2, frames * 2);
+   }
+
+   bench_run_free(&run);
+   return ret;
+}
+
+static void bench_verify(const bench_setup_t *setup, audio_pipeline_t *pipe,
+      const int16_t *signal)
+{
+   size_t i;
+   char msg[256];
+   bench_sink_t ref = {0};
+   bench_sink_t out = {0};
+
+   if (     !bench_run(setup, pipe, signal, true,  bench_sink_write, &ref)
+         || !bench_run(setup, pipe, signal, false, bench_sink_write, &out))
+   {
+      check(false, setup->name, "could not run the setup");
+      return;
+   }
+
+   if (ref.size != out.size)
+   {
+      snprintf(msg, sizeof(msg), "%u bytes written, expected %u",
+            (unsigned)out.size, (unsigned)ref.size);
+      check(false, setup->name, msg);
+   }
+   else
+   {
+      for (i = 0; i < ref.size && ref.data[i] == out.data[i]; i++);
+
+      if (i == ref.size)
+         snprintf(msg, sizeof(msg), "%u bytes, bit-exact",
+               (unsigned)ref.size);
+      else
+         snprintf(msg, sizeof(msg), "first difference at byte %u of %u",
+               (unsigned)i, (unsigned)ref.size);
+      check(i == ref.size, setup->name, msg);
+   }
+
+   free(ref.data);
+   free(out.data);
+}
+
+/* Best of BENCH_RUNS in average nanoseconds per input frame,
+ * or -1.0 on failure. */
+static double bench_time(const bench_setup_t *setup, audio_pipeline_t *pipe,
+      const int16_t *signal, bool reference)
+{
+   unsigned i;
+   double best = -1.0;
+
+   for (i = 0; i < BENCH_RUNS; i++)
+   {
+      double ns;
+      retro_time_t start = cpu_features_get_time_usec();
+
+      if (!bench_run(setup, pipe, signal, reference, bench_null_write, NULL))
+         return -1.0;
+
+      ns = (double)(cpu_features_get_time_usec() - start)
+         * 1000.0 / BENCH_FRAMES;
+      if (best < 0.0 || ns < best)
+         best = ns;
+   }
+
+   return best;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   audio_pipeline_t pipe;
+   int16_t *signal   = (int16_t*)malloc(BENCH_FRAMES * 2 * sizeof(int16_t));
+   size_t max_output = BENCH_BATCH * 2 * AUDIO_MAX_RATIO;
+
+   if (argc > 1)
+      dsp_preset = argv[1];
+
+   /* Same sizes audio_driver_init_internal() used to allocate. */
+   ref_input  = (float*)malloc(BENCH_BATCH * 2 * sizeof(float) * 2);
+   ref_output = (float*)malloc(max_output * sizeof(float));
+   ref_conv   = (int16_t*)malloc(max_output * sizeof(int16_t));
+
+   if (     !signal || !ref_input || !ref_output || !ref_conv
+         || !audio_pipeline_init(&pipe, AUDIO_MAX_RATIO))
+      return 1;
+
+   convert_s16_to_float_init_simd();
+   convert_float_to_s16_init_simd();
+   bench_signal(signal, BENCH_FRAMES);
+
+   printf("%u seconds of %u Hz stereo, batches of %u frames\n\n",
+         BENCH_SECONDS, BENCH_RATE_IN, BENCH_BATCH);
+
+   for (i = 0; i < ARRAY_SIZE(setups); i++)
+      bench_verify(&setups[i], &pipe, signal);
+
+   printf("\n%-24s %9s %9s %8s\n", "ns/frame", "reference", "pipeline",
+         "speedup");
+
+   for (i = 0; i < ARRAY_SIZE(setups); i++)
+   {
+      double ref = bench_time(&setups[i], &pipe, signal, true);
+      double out = bench_time(&setups[i], &pipe, signal, false);
+
+      if (ref < 0.0 || out < 0.0)
+         printf("%-24s %9s %9s %8s\n", setups[i].name, "-", "-", "-");
+      else
+         printf("%-24s %9.2f %9.2f %7.2fx\n", setups[i].name,
+               ref, out, out > 0.0 ? ref / out : 0.0);
+   }
+
+   audio_pipeline_free(&pipe);
+   free(ref_input);
+   free(ref_output);
+   free(ref_conv);
+   free(signal);
+
+   printf("\n%s\n", failures ? "[ERROR]: Some setups did not match"
+         : "[SUCCESS]: All setups matched the reference");
+
+   return failures ? 1 : 0;
+}
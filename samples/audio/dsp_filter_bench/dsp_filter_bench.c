@@ -0,0 +1,476 @@
+/* Benchmark and regression harness for the audio DSP filters.
+ *
+ *   dsp_filter_bench [filter dir]
+ *      Runs every .dsp preset in the directory (by default the presets
+ *      and plugins built in libretro-common/audio/dsp_filters) over a
+ *      synthetic stereo signal.
+ *
+ * Every preset is first run through a reference chain: each plugin's
+ * scalar implementation (SIMD mask 0), one filter after another over
+ * the whole batch. retro_dsp_filter then runs the same preset with the
+ * CPU's SIMD kernels and the fused block mode, and its output has to
+ * stay within BENCH_TOLERANCE of the reference. Most kernels reproduce
+ * the scalar arithmetic exactly; the SSE biquad in iir.c pre-divides
+ * its coefficients and so only matches up to rounding. After that both
+ * paths are timed and the average nanoseconds per sample are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <audio/dsp_filter.h>
+#include <dynamic/dylib.h>
+#include <features/features_cpu.h>
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
+#include <libretro_dspfilter.h>
+
+#define BENCH_RATE      44100
+#define BENCH_SECONDS   10
+#define BENCH_FRAMES    (BENCH_RATE * BENCH_SECONDS)
+/* Roughly what the frontend hands to the DSP per video frame. */
+#define BENCH_BATCH     1024
+#define BENCH_TOLERANCE 1e-4f
+
+typedef struct bench_plug
+{
+   dylib_t lib;
+   const struct dspfilter_implementation *impl;
+} bench_plug_t;
+
+typedef struct bench_instance
+{
+   const struct dspfilter_implementation *impl;
+   void *data;
+} bench_instance_t;
+
+/* Reference chain, the equivalent of retro_dsp_filter_process()
+ * before the fused block mode. */
+typedef struct bench_chain
+{
+   config_file_t *conf;
+   bench_instance_t instances[16];
+   unsigned num_instances;
+} bench_chain_t;
+
+typedef struct bench_stream
+{
+   float *samples;
+   size_t frames;
+   size_t capacity;
+} bench_stream_t;
+
+static const char *plug_names[] = {
+   "chorus", "crystalizer", "echo", "eq", "iir", "panning",
+   "phaser", "reverb", "tremolo", "vibrato", "wahwah",
+};
+
+static bench_plug_t plugs[ARRAY_SIZE(plug_names)];
+static unsigned num_plugs = 0;
+static unsigned failures  = 0;
+
+static const struct dspfilter_config bench_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR]: %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void bench_plugs_load(const char *dir_path)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(plug_names); i++)
+   {
+      char path[PATH_MAX_LENGTH];
+      dspfilter_get_implementation_t cb;
+      dylib_t lib;
+
+      snprintf(path, sizeof(path), "%s/%s.so", dir_path, plug_names[i]);
+      if (!(lib = dylib_load(path)))
+         continue;
+
+      cb = (dspfilter_get_implementation_t)
+         dylib_proc(lib, "dspfilter_get_implementation");
+      if (!cb)
+      {
+         dylib_close(lib);
+         continue;
+      }
+
+      plugs[num_plugs].lib  = lib;
+      plugs[num_plugs].impl = cb(0);
+      num_plugs++;
+   }
+}
+
+static struct string_list *bench_plugs_list(const char *dir_path)
+{
+   unsigned i;
+   union string_list_elem_attr attr;
+   struct string_list *list = string_list_new();
+
+   attr.i = 0;
+
+   for (i = 0; i < ARRAY_SIZE(plug_names); i++)
+   {
+      char path[PATH_MAX_LENGTH];
+      snprintf(path, sizeof(path), "%s/%s.so", dir_path, plug_names[i]);
+      string_list_append(list, path, attr);
+   }
+
+   return list;
+}
+
+static void bench_chain_free(bench_chain_t *chain)
+{
+   unsigned i;
+
+   for (i = 0; i < chain->num_instances; i++)
+      chain->instances[i].impl->free(chain->instances[i].data);
+   if (chain->conf)
+      config_file_free(chain->conf);
+   memset(chain, 0, sizeof(*chain));
+}
+
+static bool bench_chain_init(bench_chain_t *chain, const char *preset)
+{
+   unsigned i, j;
+   unsigned filters = 0;
+
+   memset(chain, 0, sizeof(*chain));
+
+   if (!(chain->conf = config_file_new_from_path_to_string(preset)))
+      return false;
+
+   if (     !config_get_uint(chain->conf, "filters", &filters)
+         || filters > ARRAY_SIZE(chain->instances))
+      goto error;
+
+   for (i = 0; i < filters; i++)
+   {
+      struct config_file_userdata userdata;
+      struct dspfilter_info info;
+      bench_instance_t *instance = &chain->instances[i];
+      char key[64];
+      char name[64];
+
+      snprintf(key, sizeof(key), "filter%u", i);
+      if (!config_get_array(chain->conf, key, name, sizeof(name)))
+         goto error;
+
+      for (j = 0; j < num_plugs; j++)
+         if (string_is_equal(plugs[j].impl->short_ident, name))
+            instance->impl = plugs[j].impl;
+      if (!instance->impl)
+         goto error;
+
+      info.input_rate    = BENCH_RATE;
+      userdata.conf      = chain->conf;
+      userdata.prefix[0] = key;
+      userdata.prefix[1] = instance->impl->short_ident;
+
+      if (!(instance->data = instance->impl->init(&info,
+                  &bench_config, &userdata)))
+         goto error;
+      chain->num_instances++;
+   }
+
+   return true;
+
+error:
+   bench_chain_free(chain);
+   return false;
+}
+
+static void bench_chain_process(bench_chain_t *chain,
+      struct retro_dsp_data *data)
+{
+   unsigned i;
+   struct dspfilter_output output = {0};
+   struct dspfilter_input input   = {0};
+
+   output.samples = data->input;
+   output.frames  = data->input_frames;
+
+   for (i = 0; i < chain->num_instances; i++)
+   {
+      input.samples = output.samples;
+      input.frames  = output.frames;
+      chain->instances[i].impl->process(
+            chain->instances[i].data, &output, &input);
+   }
+
+   data->output        = output.samples;
+   data->output_frames = output.frames;
+}
+
+static void bench_stream_append(bench_stream_t *stream,
+      const float *samples, size_t frames)
+{
+   if (stream->frames + frames > stream->capacity)
+   {
+      stream->capacity = (stream->frames + frames) * 2;
+      stream->samples  = (float*)realloc(stream->samples,
+            stream->capacity * 2 * sizeof(float));
+   }
+
+   memcpy(stream->samples + stream->frames * 2, samples,
+         frames * 2 * sizeof(float));
+   stream->frames += frames;
+}
+
+/* A couple of tones plus noise, kept well within [-1, 1]. */
+static void bench_signal(float *samples, size_t frames)
+{
+   size_t i;
+   uint32_t seed = 12345;
+
+   for (i = 0; i < frames; i++)
+   {
+      float t = (float)i / BENCH_RATE;
+      float noise[2];
+
+      seed     = seed * 1664525u + 1013904223u;
+      noise[0] = (float)(seed >> 8) / (1 << 24) - 0.5f;
+      seed     = seed * 1664525u + 1013904223u;
+      noise[1] = (float)(seed >> 8) / (1 << 24) - 0.5f;
+
+      samples[i * 2 + 0] = 0.4f * sinf(2.0f * M_PI * 110.0f * t)
+         + 0.1f * noise[0];
+      samples[i * 2 + 1] = 0.3f * sinf(2.0f * M_PI * 1760.0f * t)
+         + 0.1f * noise[1];
+   }
+}
+
+static void bench_verify(const char *name, const char *preset,
+      const char *dir_path, const float *signal, unsigned batch)
+{
+   size_t i;
+   char msg[256];
+   bench_chain_t chain;
+   bench_stream_t ref   = {0};
+   bench_stream_t out   = {0};
+   float max_diff       = 0.0f;
+   float *buf           = (float*)malloc(batch * 2 * sizeof(float));
+   retro_dsp_filter_t *dsp;
+
+   if (!bench_chain_init(&chain, preset))
+   {
+      check(false, name, "reference chain could not be created");
+      free(buf);
+      return;
+   }
+
+   if (!(dsp = retro_dsp_filter_new(preset,
+               bench_plugs_list(dir_path), BENCH_RATE)))
+   {
+      check(false, name, "retro_dsp_filter could not be created");
+      bench_chain_free(&chain);
+      free(buf);
+      return;
+   }
+
+   for (i = 0; i < BENCH_FRAMES; i += batch)
+   {
+      struct retro_dsp_data data;
+      unsigned frames = MIN(batch, BENCH_FRAMES - i);
+
+      memcpy(buf, signal + i * 2, frames * 2 * sizeof(float));
+      data.input        = buf;
+      data.input_frames = frames;
+      bench_chain_process(&chain, &data);
+      bench_stream_append(&ref, data.output, data.output_frames);
+
+      memcpy(buf, signal + i * 2, frames * 2 * sizeof(float));
+      data.input        = buf;
+      data.input_frames = frames;
+      retro_dsp_filter_process(dsp, &data);
+      bench_stream_append(&out, data.output, data.output_frames);
+   }
+
+   if (ref.frames == out.frames)
+   {
+      for (i = 0; i < ref.frames * 2; i++)
+      {
+         float diff = fabsf(ref.samples[i] - out.samples[i]);
+         if (diff > max_diff || diff != diff)
+            max_diff = diff;
+      }
+
+      snprintf(msg, sizeof(msg),
+            "batch %u, max difference %g (tolerance %g)",
+            batch, max_diff, BENCH_TOLERANCE);
+      check(max_diff <= BENCH_TOLERANCE, name, msg);
+   }
+   else
+   {
+      snprintf(msg, sizeof(msg), "batch %u, %u frames out, expected %u",
+            batch, (unsigned)out.frames, (unsigned)ref.frames);
+      check(false, name, msg);
+   }
+
+   retro_dsp_filter_free(dsp);
+   bench_chain_free(&chain);
+   free(ref.samples);
+   free(out.samples);
+   free(buf);
+}
+
+/* Average nanoseconds per output sample, or -1.0 on failure. */
+static double bench_time(const char *preset, const char *dir_path,
+      const float *signal, bool reference)
+{
+   size_t i;
+   retro_time_t start, end;
+   bench_chain_t chain;
+   retro_dsp_filter_t *dsp = NULL;
+   float *buf              = (float*)malloc(BENCH_BATCH * 2 * sizeof(float));
+
+   if (reference)
+   {
+      if (!bench_chain_init(&chain, preset))
+      {
+         free(buf);
+         return -1.0;
+      }
+   }
+   else if (!(dsp = retro_dsp_filter_new(preset,
+               bench_plugs_list(dir_path), BENCH_RATE)))
+   {
+      free(buf);
+      return -1.0;
+   }
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < BENCH_FRAMES; i += BENCH_BATCH)
+   {
+      struct retro_dsp_data data;
+      unsigned frames = MIN(BENCH_BATCH, BENCH_FRAMES - i);
+
+      memcpy(buf, signal + i * 2, frames * 2 * sizeof(float));
+      data.input        = buf;
+      data.input_frames = frames;
+
+      if (reference)
+         bench_chain_process(&chain, &data);
+      else
+         retro_dsp_filter_process(dsp, &data);
+   }
+
+   end = cpu_features_get_time_usec();
+
+   if (reference)
+      bench_chain_free(&chain);
+   else
+      retro_dsp_filter_free(dsp);
+   free(buf);
+
+   return (double)(end - start) * 1000.0 / (BENCH_FRAMES * 2.0);
+}
+
+static int bench_compare_names(const void *a, const void *b)
+{
+   return strcmp(*(const char**)a, *(const char**)b);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   const char *dir_path = argc > 1 ? argv[1]
+      : "../../../libretro-common/audio/dsp_filters";
+   char *names[64];
+   unsigned num_names   = 0;
+   float *signal        = NULL;
+   struct dirent *entry;
+   DIR *dir;
+
+   bench_plugs_load(dir_path);
+   if (!num_plugs)
+   {
+      fprintf(stderr, "No DSP plugins found in %s\n", dir_path);
+      return 1;
+   }
+
+   if (!(dir = opendir(dir_path)))
+   {
+      fprintf(stderr, "Could not open %s\n", dir_path);
+      return 1;
+   }
+
+   while ((entry = readdir(dir)) && num_names < ARRAY_SIZE(names))
+   {
+      const char *ext = strrchr(entry->d_name, '.');
+      if (ext && string_is_equal(ext, ".dsp"))
+         names[num_names++] = strdup(entry->d_name);
+   }
+   closedir(dir);
+   qsort(names, num_names, sizeof(*names), bench_compare_names);
+
+   if (!(signal = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float))))
+      return 1;
+   bench_signal(signal, BENCH_FRAMES);
+
+   printf("%u seconds of %u Hz stereo, batches of %u frames\n\n",
+         BENCH_SECONDS, BENCH_RATE, BENCH_BATCH);
+
+   for (i = 0; i < num_names; i++)
+   {
+      char preset[PATH_MAX_LENGTH];
+      snprintf(preset, sizeof(preset), "%s/%s", dir_path, names[i]);
+
+      bench_verify(names[i], preset, dir_path, signal, BENCH_BATCH);
+      /* Not a multiple of the fused block size. */
+      bench_verify(names[i], preset, dir_path, signal, 1000);
+   }
+
+   printf("\n%-24s %9s %9s %8s\n", "ns/sample", "scalar", "dsp", "speedup");
+
+   for (i = 0; i < num_names; i++)
+   {
+      char preset[PATH_MAX_LENGTH];
+      double scalar, fused;
+
+      snprintf(preset, sizeof(preset), "%s/%s", dir_path, names[i]);
+
+      scalar = bench_time(preset, dir_path, signal, true);
+      fused  = bench_time(preset, dir_path, signal, false);
+
+      if (scalar < 0.0 || fused < 0.0)
+         printf("%-24s %9s %9s %8s\n", names[i], "-", "-", "-");
+      else
+         printf("%-24s %9.2f %9.2f %7.2fx\n", names[i],
+               scalar, fused, fused > 0.0 ? scalar / fused : 0.0);
+      free(names[i]);
+   }
+
+   for (i = 0; i < num_plugs; i++)
+      dylib_close(plugs[i].lib);
+   free(signal);
+
+   printf("\n%s\n", failures ? "[ERROR]: Some presets did not match"
+         : "[SUCCESS]: All presets matched their scalar reference");
+
+   return failures ? 1 : 0;
+}
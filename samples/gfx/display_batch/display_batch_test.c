@@ -0,0 +1,523 @@
+/* Regression test and benchmark for quad batching in gfx_display.
+ *
+ *   display_batch_test [entries]
+ *
+ * Draws a synthetic menu frame of [entries] rows (200 by default):
+ * backgrounds, separators, icons (some rotated and scaled, like XMB
+ * and MaterialUI draw them), a highlight over the selected row and
+ * a scissored scrolling region.
+ *
+ * A recording display driver turns every draw it receives into
+ * triangles in pixel space, with the texture, blend state and
+ * scissor rectangle they were drawn with. The frame is drawn with
+ * and without batching, and the checks make sure that the same
+ * triangles come out and that any two which overlap are still drawn
+ * in the same order. This is done for two different default MVPs.
+ *
+ * Then the null display driver counts the draw calls and vertices of
+ * the same frame with and without batching, and times both.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <gfx/math/matrix_4x4.h>
+
+#include "../../../gfx/gfx_display.h"
+#include "../../../gfx/gfx_animation.h"
+
+#define VIDEO_WIDTH  1920
+#define VIDEO_HEIGHT 1080
+#define MAX_TRIS     16384
+
+typedef struct rec_tri
+{
+   float x[3];
+   float y[3];
+   float u[3];
+   float v[3];
+   float color[3][4];
+   int scissor[4];
+   uintptr_t texture;
+   bool blend;
+} rec_tri_t;
+
+typedef struct recording
+{
+   rec_tri_t tris[MAX_TRIS];
+   unsigned count;
+   unsigned draws;
+} recording_t;
+
+static int failures = 0;
+static gfx_display_t disp;
+static recording_t *rec;
+static math_matrix_4x4 rec_mvp;
+static int rec_scissor[4];
+static bool rec_blend;
+
+/* Stubs for what gfx_display.c needs from the rest of RetroArch */
+void RARCH_LOG(const char *fmt, ...) { }
+gfx_display_t *disp_get_ptr(void) { return &disp; }
+void *config_get_ptr(void) { return NULL; }
+void *video_driver_get_ptr(bool force_nonthreaded_data) { return NULL; }
+const char *video_driver_get_ident(void) { return "null"; }
+bool video_driver_has_windowed(void) { return false; }
+bool video_driver_supports_rgba(void) { return true; }
+bool video_driver_set_viewport(unsigned width, unsigned height,
+      bool force_fullscreen, bool allow_rotate)
+{
+   return true;
+}
+void video_driver_set_osd_msg(const char *msg, const void *params,
+      void *font) { }
+bool video_driver_texture_load(void *data,
+      enum texture_filter_type filter_type, uintptr_t *id)
+{
+   return false;
+}
+bool video_driver_texture_unload(uintptr_t *id) { return false; }
+bool video_context_driver_get_metrics(gfx_ctx_metrics_t *metrics)
+{
+   return false;
+}
+bool gfx_animation_ctl(enum gfx_animation_ctl_state state, void *data)
+{
+   return false;
+}
+bool gfx_animation_is_active(void) { return false; }
+void fill_pathname_application_special(char *s, size_t len,
+      enum application_special_type type) { }
+font_data_t *font_driver_init_first(void *video_data, const char *font_path,
+      float font_size, bool threading_hint, bool is_threaded,
+      enum font_driver_render_api api)
+{
+   return NULL;
+}
+void font_driver_free(void *font_data) { }
+bool image_texture_load(struct texture_image *img, const char *path)
+{
+   return false;
+}
+bool image_texture_load_buffer(struct texture_image *img,
+      enum image_type_enum type, void *buffer, size_t buffer_len)
+{
+   return false;
+}
+void image_texture_free(struct texture_image *img) { }
+
+static const float rec_vertices[8]   = { 0, 0, 1, 0, 0, 1, 1, 1 };
+static const float rec_tex_coords[8] = { 0, 1, 1, 1, 0, 0, 1, 0 };
+
+static const float *rec_get_default_vertices(void)
+{
+   return rec_vertices;
+}
+
+static const float *rec_get_default_tex_coords(void)
+{
+   return rec_tex_coords;
+}
+
+static void *rec_get_default_mvp(void *data) { return &rec_mvp; }
+static void rec_blend_begin(void *data) { rec_blend = true; }
+static void rec_blend_end(void *data) { rec_blend = false; }
+
+static void rec_scissor_begin(void *data, unsigned video_width,
+      unsigned video_height, int x, int y, unsigned width, unsigned height)
+{
+   rec_scissor[0] = x;
+   rec_scissor[1] = y;
+   rec_scissor[2] = width;
+   rec_scissor[3] = height;
+}
+
+static void rec_scissor_end(void *data, unsigned video_width,
+      unsigned video_height)
+{
+   rec_scissor[0] = 0;
+   rec_scissor[1] = 0;
+   rec_scissor[2] = video_width;
+   rec_scissor[3] = video_height;
+}
+
+/* Where a vertex ends up on screen, the way the GL display driver
+ * draws it: through the MVP into the draw's viewport */
+static void rec_add_vertex(rec_tri_t *tri, unsigned k,
+      gfx_display_ctx_draw_t *draw, const math_matrix_4x4 *mat,
+      const float *vertex, const float *tex_coord, const float *color)
+{
+   float cx = MAT_ELEM_4X4(*mat, 0, 0) * vertex[0]
+            + MAT_ELEM_4X4(*mat, 0, 1) * vertex[1]
+            + MAT_ELEM_4X4(*mat, 0, 3);
+   float cy = MAT_ELEM_4X4(*mat, 1, 0) * vertex[0]
+            + MAT_ELEM_4X4(*mat, 1, 1) * vertex[1]
+            + MAT_ELEM_4X4(*mat, 1, 3);
+
+   tri->x[k] = draw->x + (cx + 1.0f) * 0.5f * draw->width;
+   tri->y[k] = draw->y + (cy + 1.0f) * 0.5f * draw->height;
+   tri->u[k] = tex_coord[0];
+   tri->v[k] = tex_coord[1];
+   memcpy(tri->color[k], color, sizeof(tri->color[k]));
+}
+
+static void rec_draw(gfx_display_ctx_draw_t *draw,
+      void *data, unsigned video_width, unsigned video_height)
+{
+   static const unsigned strip[6] = { 0, 1, 2, 2, 1, 3 };
+   static const float white[4]    = { 1, 1, 1, 1 };
+   unsigned i, k;
+   const float *vertex             = draw->coords->vertex;
+   const float *tex_coord          = draw->coords->tex_coord;
+   const float *color              = draw->coords->color;
+   const math_matrix_4x4 *mat      = draw->matrix_data
+      ? (const math_matrix_4x4*)draw->matrix_data : &rec_mvp;
+   unsigned vertices               = draw->coords->vertices;
+   bool is_strip                   =
+      draw->prim_type == GFX_DISPLAY_PRIM_TRIANGLESTRIP;
+
+   if (!vertex)
+      vertex    = rec_vertices;
+   if (!tex_coord)
+      tex_coord = rec_tex_coords;
+
+   rec->draws++;
+
+   if (is_strip && vertices != 4)
+      return;
+
+   for (i = 0; i < (is_strip ? 6 : vertices); i += 3)
+   {
+      rec_tri_t *tri = &rec->tris[rec->count++];
+
+      for (k = 0; k < 3; k++)
+      {
+         unsigned idx = is_strip ? strip[i + k] : i + k;
+         rec_add_vertex(tri, k, draw, mat, vertex + idx * 2,
+               tex_coord + idx * 2, color ? color + idx * 4 : white);
+      }
+
+      memcpy(tri->scissor, rec_scissor, sizeof(rec_scissor));
+      tri->texture = draw->texture;
+      tri->blend   = rec_blend;
+   }
+}
+
+static gfx_display_ctx_driver_t gfx_display_ctx_rec = {
+   rec_draw,
+   NULL,
+   NULL,
+   rec_blend_begin,
+   rec_blend_end,
+   NULL,
+   NULL,
+   rec_get_default_mvp,
+   rec_get_default_vertices,
+   rec_get_default_tex_coords,
+   NULL,
+   GFX_VIDEO_DRIVER_GENERIC,
+   "record",
+   false,
+   rec_scissor_begin,
+   rec_scissor_end,
+   true
+};
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void entry_color(float *color, unsigned i, float alpha)
+{
+   unsigned k;
+
+   for (k = 0; k < 4; k++)
+   {
+      color[k * 4 + 0] = (float)(i % 7) / 7.0f;
+      color[k * 4 + 1] = (float)(i % 13) / 13.0f;
+      color[k * 4 + 2] = (float)(i / 91) / 16.0f;
+      color[k * 4 + 3] = alpha;
+   }
+}
+
+/* An icon as the menu drivers draw them, rotated and scaled
+ * about its centre by the MVP */
+static void draw_icon(float x, float y, unsigned size,
+      float rotation, float scale, float *color, uintptr_t texture)
+{
+   gfx_display_ctx_draw_t draw;
+   gfx_display_ctx_rotate_draw_t rotate_draw;
+   struct video_coords coords;
+   math_matrix_4x4 mymat;
+
+   rotate_draw.matrix       = &mymat;
+   rotate_draw.rotation     = rotation;
+   rotate_draw.scale_x      = scale;
+   rotate_draw.scale_y      = scale;
+   rotate_draw.scale_z      = 1;
+   rotate_draw.scale_enable = true;
+
+   gfx_display_rotate_z(&rotate_draw, NULL);
+
+   coords.vertices          = 4;
+   coords.vertex            = NULL;
+   coords.tex_coord         = NULL;
+   coords.lut_tex_coord     = NULL;
+   coords.color             = color;
+
+   draw.x                   = x;
+   draw.y                   = VIDEO_HEIGHT - y - size;
+   draw.width               = size;
+   draw.height              = size;
+   draw.coords              = &coords;
+   draw.matrix_data         = &mymat;
+   draw.texture             = texture;
+   draw.prim_type           = GFX_DISPLAY_PRIM_TRIANGLESTRIP;
+   draw.pipeline.id         = 0;
+
+   gfx_display_draw(&draw, NULL, VIDEO_WIDTH, VIDEO_HEIGHT);
+}
+
+static void draw_frame(unsigned entries)
+{
+   unsigned i;
+   float color[16];
+   unsigned row       = 48;
+   unsigned selection = entries / 3;
+
+   gfx_display_set_viewport(VIDEO_WIDTH, VIDEO_HEIGHT);
+
+   entry_color(color, 1000, 1.0f);
+   gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+         0, 0, VIDEO_WIDTH, VIDEO_HEIGHT,
+         VIDEO_WIDTH, VIDEO_HEIGHT, color);
+
+   /* Sidebar */
+   gfx_display_blend_begin(NULL);
+   for (i = 0; i < 8; i++)
+   {
+      entry_color(color, 2000 + i, 0.8f);
+      gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+            16, 64 + i * 56, 360, 52, VIDEO_WIDTH, VIDEO_HEIGHT, color);
+      draw_icon(24, 70 + i * 56, 40, 0.0f, 1.0f, color, 10 + (i % 4));
+   }
+
+   /* Scrolling entries */
+   gfx_display_scissor_begin(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+         408, 64, VIDEO_WIDTH - 408, VIDEO_HEIGHT - 128);
+
+   for (i = 0; i < entries; i++)
+   {
+      /* A grid of 20 rows */
+      int x = 420 + (int)(i / 20) * 150;
+      int y = 44  + (int)(i % 20) * row;
+
+      entry_color(color, i, 1.0f);
+      gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+            x, y + row - 1, 140, 1,
+            VIDEO_WIDTH, VIDEO_HEIGHT, color);
+
+      if (i == selection)
+      {
+         entry_color(color, 3000, 0.5f);
+         gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+               x - 10, y, 150, row,
+               VIDEO_WIDTH, VIDEO_HEIGHT, color);
+      }
+
+      if (i % 9 == 4)
+         draw_icon(x + 10, y + 4, 40, 0.25f * (float)(i % 5),
+               1.0f + 0.05f * (float)(i % 3), color, 20);
+      else
+         gfx_display_draw_texture(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+               x + 10, y + 4 + 40, 40, 40, VIDEO_WIDTH, VIDEO_HEIGHT,
+               color, (i % 5) ? 21 : 22);
+
+      /* A badge over the icon */
+      if (i % 10 == 3)
+      {
+         entry_color(color, 5000 + i, 1.0f);
+         gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+               x + 40, y + 30, 16, 16,
+               VIDEO_WIDTH, VIDEO_HEIGHT, color);
+      }
+   }
+
+   gfx_display_scissor_end(NULL, VIDEO_WIDTH, VIDEO_HEIGHT);
+   gfx_display_blend_end(NULL);
+
+   /* Scrollbar, footer and the cursor */
+   entry_color(color, 4000, 1.0f);
+   gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+         VIDEO_WIDTH - 12, 80, 6, 400, VIDEO_WIDTH, VIDEO_HEIGHT, color);
+   entry_color(color, 4001, 1.0f);
+   gfx_display_draw_quad(NULL, VIDEO_WIDTH, VIDEO_HEIGHT,
+         0, VIDEO_HEIGHT - 64, VIDEO_WIDTH, 64,
+         VIDEO_WIDTH, VIDEO_HEIGHT, color);
+   entry_color(color, 4002, 1.0f);
+   gfx_display_draw_cursor(NULL, VIDEO_WIDTH, VIDEO_HEIGHT, true,
+         color, 64, 30, 800, 500, VIDEO_WIDTH, VIDEO_HEIGHT);
+
+   gfx_display_unset_viewport(VIDEO_WIDTH, VIDEO_HEIGHT);
+}
+
+static bool tri_equal(const rec_tri_t *a, const rec_tri_t *b)
+{
+   unsigned k;
+
+   if (     a->texture != b->texture
+         || a->blend   != b->blend
+         || memcmp(a->scissor, b->scissor, sizeof(a->scissor)))
+      return false;
+
+   for (k = 0; k < 3; k++)
+   {
+      if (     fabsf(a->x[k] - b->x[k]) > 0.01f
+            || fabsf(a->y[k] - b->y[k]) > 0.01f
+            || a->u[k] != b->u[k] || a->v[k] != b->v[k]
+            || memcmp(a->color[k], b->color[k], sizeof(a->color[k])))
+         return false;
+   }
+
+   return true;
+}
+
+static bool tri_overlap(const rec_tri_t *a, const rec_tri_t *b)
+{
+   float ax0 = fminf(a->x[0], fminf(a->x[1], a->x[2]));
+   float ax1 = fmaxf(a->x[0], fmaxf(a->x[1], a->x[2]));
+   float ay0 = fminf(a->y[0], fminf(a->y[1], a->y[2]));
+   float ay1 = fmaxf(a->y[0], fmaxf(a->y[1], a->y[2]));
+   float bx0 = fminf(b->x[0], fminf(b->x[1], b->x[2]));
+   float bx1 = fmaxf(b->x[0], fmaxf(b->x[1], b->x[2]));
+   float by0 = fminf(b->y[0], fminf(b->y[1], b->y[2]));
+   float by1 = fmaxf(b->y[0], fmaxf(b->y[1], b->y[2]));
+
+   /* Allow for rounding where two quads only touch */
+   return ax0 < bx1 - 0.01f && bx0 < ax1 - 0.01f
+       && ay0 < by1 - 0.01f && by0 < ay1 - 0.01f;
+}
+
+static void record_frame(recording_t *out, bool batch, unsigned entries)
+{
+   rec                         = out;
+   rec->count                  = 0;
+   rec->draws                  = 0;
+   rec_blend                   = false;
+   rec_scissor_end(NULL, VIDEO_WIDTH, VIDEO_HEIGHT);
+   gfx_display_ctx_rec.can_batch = batch;
+   draw_frame(entries);
+}
+
+static void test_batching(const char *name, unsigned entries)
+{
+   unsigned i, j;
+   char msg[128];
+   unsigned *pos       = NULL;
+   bool matched        = true;
+   bool ordered        = true;
+   recording_t *plain  = (recording_t*)calloc(1, sizeof(*plain));
+   recording_t *merged = (recording_t*)calloc(1, sizeof(*merged));
+
+   record_frame(plain,  false, entries);
+   record_frame(merged, true,  entries);
+
+   check(rec_blend == false, name, "blend state left as requested");
+
+   pos = (unsigned*)malloc(plain->count * sizeof(*pos));
+
+   /* Every triangle is drawn, exactly once */
+   if (plain->count != merged->count)
+      matched = false;
+   for (i = 0; matched && i < plain->count; i++)
+   {
+      for (j = 0; j < merged->count; j++)
+         if (tri_equal(&plain->tris[i], &merged->tris[j]))
+            break;
+      if (j == merged->count)
+         matched = false;
+      else
+         pos[i] = j;
+   }
+   snprintf(msg, sizeof(msg), "same %u triangles", plain->count);
+   check(matched, name, msg);
+
+   /* Overlapping triangles are drawn in the same order */
+   for (i = 0; matched && i < plain->count; i++)
+      for (j = i + 1; j < plain->count; j++)
+         if (     tri_overlap(&plain->tris[i], &plain->tris[j])
+               && pos[i] > pos[j])
+            ordered = false;
+   check(matched && ordered, name, "overlapping triangles keep their order");
+
+   snprintf(msg, sizeof(msg), "%u draws instead of %u",
+         merged->draws, plain->draws);
+   check(merged->draws < plain->draws / 4, name, msg);
+
+   free(pos);
+   free(plain);
+   free(merged);
+}
+
+static void bench(unsigned entries, bool batch)
+{
+   unsigned i, draws;
+   size_t vertices;
+   retro_time_t start;
+   unsigned frames = 1000;
+
+   disp.dispctx                  = &gfx_display_ctx_null;
+   gfx_display_ctx_null.can_batch = batch;
+
+   draw_frame(entries);
+   gfx_display_null_get_stats(&draws, &vertices, true);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < frames; i++)
+      draw_frame(entries);
+
+   printf("%-12s %u entries: %5u draws, %6u vertices per frame, "
+         "%6.1f usec per frame\n",
+         batch ? "batched" : "not batched", entries, draws,
+         (unsigned)vertices,
+         (cpu_features_get_time_usec() - start) / (double)frames);
+   gfx_display_null_get_stats(NULL, NULL, true);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned entries = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 200;
+
+   gfx_display_white_texture = 1;
+   disp.dispctx              = &gfx_display_ctx_rec;
+
+   matrix_4x4_ortho(rec_mvp, 0, 1, 0, 1, -1, 1);
+   test_batching("ortho", entries);
+
+   /* Upside down, with the origin elsewhere */
+   matrix_4x4_ortho(rec_mvp, -0.5f, 1.5f, 1.25f, -0.25f, -1, 1);
+   test_batching("flipped ortho", entries);
+
+   bench(entries, false);
+   bench(entries, true);
+
+   gfx_display_free();
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
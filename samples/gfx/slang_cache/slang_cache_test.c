@@ -0,0 +1,316 @@
+/* Regression test for the compiled shader cache.
+ *
+ *   slang_cache_test [directory]
+ *
+ * Uses (and empties) the given directory, "slang_cache_test.dir" by
+ * default. Checks hits and misses, that corrupt entries are rejected,
+ * that the size bound evicts the least recently used entries, that
+ * entries survive a restart and that concurrent stores and lookups
+ * only ever return what was stored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <rthreads/rthreads.h>
+#include <streams/file_stream.h>
+
+#include "slang_cache.h"
+
+#define ENTRY_SIZE     1000
+/* slang_cache_header_t */
+#define HEADER_SIZE    24
+#define THREADS        4
+#define THREAD_KEYS    16
+#define THREAD_ROUNDS  200
+
+static int failures = 0;
+static const char *dir = "slang_cache_test.dir";
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void clear_dir(void)
+{
+   size_t i;
+   struct string_list *list = dir_list_new(dir, NULL,
+         false, true, false, false);
+
+   if (!list)
+      return;
+
+   for (i = 0; i < list->size; i++)
+      filestream_delete(list->elems[i].data);
+
+   string_list_free(list);
+}
+
+static size_t count_files(void)
+{
+   size_t size;
+   struct string_list *list = dir_list_new(dir, NULL,
+         false, true, false, false);
+
+   if (!list)
+      return 0;
+
+   size = list->size;
+   string_list_free(list);
+   return size;
+}
+
+/* Entry @n: ENTRY_SIZE bytes derived from @n, keyed by their hash */
+static void make_entry(unsigned n, uint8_t *data, char *key)
+{
+   unsigned i;
+
+   for (i = 0; i < ENTRY_SIZE; i++)
+      data[i] = (uint8_t)(n * 131 + i * 7 + (i >> 8));
+
+   slang_cache_key(key, data, ENTRY_SIZE);
+}
+
+static bool put_entry(unsigned n)
+{
+   uint8_t data[ENTRY_SIZE];
+   char key[SLANG_CACHE_KEY_SIZE];
+
+   make_entry(n, data, key);
+   return slang_cache_put("test", key, data, sizeof(data));
+}
+
+/* 1 on a correct hit, 0 on a miss, -1 on wrong contents */
+static int get_entry(unsigned n)
+{
+   uint8_t data[ENTRY_SIZE];
+   char key[SLANG_CACHE_KEY_SIZE];
+   void *cached = NULL;
+   size_t size  = 0;
+   int ret;
+
+   make_entry(n, data, key);
+
+   if (!slang_cache_get("test", key, &cached, &size))
+      return 0;
+
+   ret = (size == sizeof(data) && !memcmp(cached, data, size)) ? 1 : -1;
+   free(cached);
+   return ret;
+}
+
+static void test_basic(void)
+{
+   uint8_t data[ENTRY_SIZE];
+   char key[SLANG_CACHE_KEY_SIZE];
+   void *cached = NULL;
+   size_t size  = 0;
+   slang_cache_stats_t stats;
+
+   check(slang_cache_init(dir, SLANG_CACHE_DEFAULT_SIZE),
+         "basic", "directory usable");
+   check(get_entry(0) == 0, "basic", "miss on an empty cache");
+   check(put_entry(0), "basic", "store");
+   check(get_entry(0) == 1, "basic", "hit returns the stored bytes");
+
+   make_entry(0, data, key);
+   check(!slang_cache_get("other", key, &cached, &size),
+         "basic", "kinds are separate");
+
+   check(slang_cache_put("test", key, data, 0)
+         && slang_cache_get("test", key, &cached, &size) && size == 0,
+         "basic", "empty entry replaces the previous one");
+   free(cached);
+
+   slang_cache_get_stats(&stats);
+   check(stats.hits == 2 && stats.misses == 2 && stats.stores == 2,
+         "basic", "statistics");
+
+   slang_cache_deinit();
+   clear_dir();
+}
+
+static void test_corrupt(void)
+{
+   char path[PATH_MAX_LENGTH];
+   uint8_t data[ENTRY_SIZE];
+   char key[SLANG_CACHE_KEY_SIZE];
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   slang_cache_init(dir, SLANG_CACHE_DEFAULT_SIZE);
+   put_entry(1);
+   make_entry(1, data, key);
+
+   fill_pathname_join(path, dir, key, sizeof(path));
+   strlcat(path, ".test", sizeof(path));
+
+   if (filestream_read_file(path, &buf, &len))
+   {
+      ((uint8_t*)buf)[len / 2] ^= 0x10;
+      filestream_write_file(path, buf, len);
+      free(buf);
+   }
+
+   check(get_entry(1) == 0, "corrupt", "flipped bit is a miss");
+   check(!path_is_valid(path), "corrupt", "corrupt entry deleted");
+
+   put_entry(1);
+   if (filestream_read_file(path, &buf, &len))
+   {
+      filestream_write_file(path, buf, len - 1);
+      free(buf);
+   }
+
+   check(get_entry(1) == 0, "corrupt", "truncated entry is a miss");
+
+   slang_cache_deinit();
+   clear_dir();
+}
+
+static void test_eviction(void)
+{
+   unsigned i;
+   slang_cache_stats_t stats;
+
+   slang_cache_init(dir, 3 * (ENTRY_SIZE + HEADER_SIZE));
+
+   for (i = 0; i < 3; i++)
+      put_entry(i);
+
+   /* 0 is now the most recently used, 1 the least */
+   get_entry(0);
+   put_entry(3);
+
+   check(get_entry(1) == 0, "eviction", "least recently used evicted");
+   check(get_entry(0) == 1 && get_entry(2) == 1 && get_entry(3) == 1,
+         "eviction", "others kept");
+   check(count_files() == 3, "eviction", "3 files on disk");
+
+   slang_cache_get_stats(&stats);
+   check(stats.evictions == 1 && stats.size == 3 * (ENTRY_SIZE + HEADER_SIZE),
+         "eviction", "statistics");
+
+   /* A smaller bound applies to what is already there */
+   slang_cache_init(dir, 2 * (ENTRY_SIZE + HEADER_SIZE));
+   check(count_files() == 2, "eviction", "shrinking the bound evicts");
+
+   slang_cache_deinit();
+   clear_dir();
+}
+
+static void test_restart(void)
+{
+   unsigned i;
+   slang_cache_stats_t stats;
+
+   slang_cache_init(dir, 4 * (ENTRY_SIZE + HEADER_SIZE));
+   for (i = 0; i < 4; i++)
+      put_entry(i);
+   get_entry(0);
+   slang_cache_deinit();
+
+   /* Leftover of an interrupted store */
+   {
+      char path[PATH_MAX_LENGTH];
+      fill_pathname_join(path, dir, "0123.test.tmp", sizeof(path));
+      filestream_write_file(path, "x", 1);
+   }
+
+   slang_cache_init(dir, 4 * (ENTRY_SIZE + HEADER_SIZE));
+   check(get_entry(2) == 1, "restart", "entries survive");
+
+   /* The first store indexes the directory, and needs room */
+   put_entry(4);
+   check(get_entry(1) == 0 && get_entry(0) == 1,
+         "restart", "use order survives");
+   check(count_files() == 4, "restart", "temporary file removed");
+
+   slang_cache_get_stats(&stats);
+   check(stats.size == 4 * (ENTRY_SIZE + HEADER_SIZE),
+         "restart", "size recovered from the directory");
+
+   slang_cache_deinit();
+   clear_dir();
+}
+
+static bool thread_ok = true;
+
+static void thread_func(void *data)
+{
+   unsigned i;
+   unsigned seed = (unsigned)(uintptr_t)data;
+
+   for (i = 0; i < THREAD_ROUNDS; i++)
+   {
+      unsigned n;
+
+      seed = seed * 1103515245 + 12345;
+      n    = (seed >> 16) % THREAD_KEYS;
+
+      if (get_entry(n) < 0)
+         thread_ok = false;
+      else
+         put_entry(n);
+   }
+}
+
+static void test_threads(void)
+{
+   unsigned i;
+   sthread_t *threads[THREADS];
+   slang_cache_stats_t stats;
+
+   /* Small enough to evict while the other threads read */
+   slang_cache_init(dir, (THREAD_KEYS / 2) * (ENTRY_SIZE + HEADER_SIZE));
+
+   for (i = 0; i < THREADS; i++)
+      threads[i] = sthread_create(thread_func, (void*)(uintptr_t)(i + 1));
+   for (i = 0; i < THREADS; i++)
+      sthread_join(threads[i]);
+
+   slang_cache_get_stats(&stats);
+   check(thread_ok, "threads", "every hit returned the stored bytes");
+   check(stats.hits + stats.misses == THREADS * THREAD_ROUNDS,
+         "threads", "every lookup counted");
+   check(stats.size <= (THREAD_KEYS / 2) * (ENTRY_SIZE + HEADER_SIZE)
+         && count_files() <= THREAD_KEYS / 2,
+         "threads", "size bound kept");
+
+   slang_cache_deinit();
+   clear_dir();
+}
+
+int main(int argc, char **argv)
+{
+   if (argc > 1)
+      dir = argv[1];
+
+   path_mkdir(dir);
+   clear_dir();
+
+   test_basic();
+   test_corrupt();
+   test_eviction();
+   test_restart();
+   test_threads();
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
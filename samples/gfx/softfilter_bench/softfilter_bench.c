@@ -0,0 +1,571 @@
+/* Benchmark and regression harness for the CPU video filters.
+ *
+ *   softfilter_bench [filter dir]
+ *      Runs every .filt preset in the directory (by default the
+ *      presets shipped in gfx/video_filters) over a synthetic clip.
+ *
+ *   softfilter_bench <filter dir> <frames.raw> <width> <height>
+ *      Runs the presets over a recorded clip instead: raw XRGB8888
+ *      frames of the given size stored back to back.
+ *
+ * Every preset is first run through its scalar code path on a single
+ * packet. That output is the reference the frontend path (SIMD kernels,
+ * row tiles on the work-stealing pool) must match bit for bit, for both
+ * pixel formats. After that the frontend path is timed for a number of
+ * thread counts and the average milliseconds per frame are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <dirent.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "../../../gfx/video_filter.h"
+#include "../../../gfx/video_filters/softfilter.h"
+
+#define BENCH_WIDTH  320
+#define BENCH_HEIGHT 240
+#define BENCH_FRAMES 120
+
+/* Several filters read a couple of pixels past the edges of the
+ * frame, as cores usually hand out frames with some slack around
+ * them. Every frame of the clip gets a black border of that size. */
+#define BENCH_BORDER 4
+
+extern const struct softfilter_implementation *blargg_ntsc_snes_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *lq2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *phosphor2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxbr_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *epx_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supereagle_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supertwoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *darken_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *scale2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *normal2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *scanline2x_get_implementation(softfilter_simd_mask_t simd);
+
+static const softfilter_get_implementation_t bench_plugs[] = {
+   blargg_ntsc_snes_get_implementation,
+   lq2x_get_implementation,
+   phosphor2x_get_implementation,
+   twoxbr_get_implementation,
+   darken_get_implementation,
+   twoxsai_get_implementation,
+   supertwoxsai_get_implementation,
+   supereagle_get_implementation,
+   epx_get_implementation,
+   scale2x_get_implementation,
+   normal2x_get_implementation,
+   scanline2x_get_implementation,
+};
+
+static const struct softfilter_config bench_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+typedef struct bench_clip
+{
+   uint32_t *xrgb8888;
+   uint16_t *rgb565;
+   unsigned width;
+   unsigned height;
+   unsigned stride;
+   unsigned frames;
+} bench_clip_t;
+
+static unsigned failures = 0;
+
+/* video_filter.c logs through the frontend's verbosity functions. */
+void RARCH_LOG(const char *fmt, ...) { (void)fmt; }
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR]: %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static size_t bench_clip_offset(const bench_clip_t *clip, unsigned frame)
+{
+   return (size_t)(frame * (clip->height + 2 * BENCH_BORDER) + BENCH_BORDER)
+      * clip->stride + BENCH_BORDER;
+}
+
+static bool bench_clip_alloc(bench_clip_t *clip)
+{
+   size_t count  = (size_t)clip->stride
+      * (clip->height + 2 * BENCH_BORDER) * clip->frames;
+
+   clip->xrgb8888 = (uint32_t*)calloc(count, sizeof(uint32_t));
+   clip->rgb565   = (uint16_t*)calloc(count, sizeof(uint16_t));
+
+   return clip->xrgb8888 && clip->rgb565;
+}
+
+static uint32_t bench_rand(uint32_t *state)
+{
+   *state = *state * 1664525u + 1013904223u;
+   return *state >> 8;
+}
+
+/* A clip that looks vaguely like a 2D game: a flat sky, a tiled
+ * playfield, a few moving sprites and a noisy status area. Flat
+ * areas are cheap for the pattern matching filters while the noise
+ * is expensive, so row tiles end up with very different costs. */
+static void bench_clip_synthesize(bench_clip_t *clip)
+{
+   unsigned f, x, y, i;
+   uint32_t seed = 1;
+
+   for (f = 0; f < clip->frames; f++)
+   {
+      uint32_t *frame = clip->xrgb8888 + bench_clip_offset(clip, f);
+
+      for (y = 0; y < clip->height; y++)
+      {
+         for (x = 0; x < clip->width; x++)
+         {
+            uint32_t color;
+
+            if (y < clip->height / 3)
+               color = 0x003060c0 + ((y / 8) << 8);
+            else if (y < clip->height * 3 / 4)
+            {
+               unsigned tx = (x + f * 2) / 16;
+               unsigned ty = y / 16;
+               color = ((tx ^ ty) & 1) ? 0x00208030 : 0x00c09040;
+               if (((x + f * 2) & 15) == 0 || (y & 15) == 0)
+                  color = 0x00000000;
+            }
+            else
+               color = bench_rand(&seed) & 0x00ffffff;
+
+            frame[y * clip->stride + x] = color;
+         }
+      }
+
+      for (i = 0; i < 6; i++)
+      {
+         unsigned sx = (i * 53 + f * (i + 1)) % (clip->width - 16);
+         unsigned sy = clip->height / 3 + (i * 29) % (clip->height / 3);
+
+         for (y = 0; y < 16; y++)
+            for (x = 0; x < 16; x++)
+               if ((x - 8) * (x - 8) + (y - 8) * (y - 8) < 50)
+                  frame[(sy + y) * clip->stride + sx + x] = 0x00ffe0a0
+                     - (y << 3);
+      }
+   }
+}
+
+static bool bench_clip_load(bench_clip_t *clip, const char *path)
+{
+   long size;
+   unsigned f, y;
+   size_t row_size = clip->width * sizeof(uint32_t);
+   FILE *file      = fopen(path, "rb");
+
+   if (!file)
+      return false;
+
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   clip->frames = (unsigned)(size / (row_size * clip->height));
+   if (clip->frames > BENCH_FRAMES)
+      clip->frames = BENCH_FRAMES;
+   if (!clip->frames || !bench_clip_alloc(clip))
+   {
+      fclose(file);
+      return false;
+   }
+
+   for (f = 0; f < clip->frames; f++)
+   {
+      uint32_t *frame = clip->xrgb8888 + bench_clip_offset(clip, f);
+
+      for (y = 0; y < clip->height; y++)
+      {
+         if (fread(frame + y * clip->stride, row_size, 1, file) != 1)
+         {
+            fclose(file);
+            return false;
+         }
+      }
+   }
+
+   fclose(file);
+   return true;
+}
+
+static void bench_clip_convert(bench_clip_t *clip)
+{
+   size_t i;
+   size_t count  = (size_t)clip->stride
+      * (clip->height + 2 * BENCH_BORDER) * clip->frames;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t c      = clip->xrgb8888[i];
+      clip->rgb565[i] = (uint16_t)(((c >> 8) & 0xf800)
+            | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f));
+   }
+}
+
+static const struct softfilter_implementation *bench_find_implementation(
+      const char *ident)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(bench_plugs); i++)
+   {
+      const struct softfilter_implementation *impl = bench_plugs[i](0);
+      if (impl && string_is_equal(impl->short_ident, ident))
+         return impl;
+   }
+
+   return NULL;
+}
+
+/* The scalar path of a filter, run on a single packet without
+ * the pool. Kept alive across frames like the frontend's filter,
+ * as some filters carry state from one frame to the next. */
+typedef struct bench_reference
+{
+   const struct softfilter_implementation *impl;
+   config_file_t *conf;
+   void *impl_data;
+} bench_reference_t;
+
+static void bench_reference_free(bench_reference_t *ref)
+{
+   if (ref->impl_data)
+      ref->impl->destroy(ref->impl_data);
+   if (ref->conf)
+      config_file_free(ref->conf);
+}
+
+static bool bench_reference_init(bench_reference_t *ref,
+      const char *preset, unsigned fmt, unsigned width, unsigned height)
+{
+   char ident[64];
+   struct config_file_userdata userdata;
+
+   memset(ref, 0, sizeof(*ref));
+
+   if (!(ref->conf = config_file_new_from_path_to_string(preset)))
+      return false;
+
+   ident[0] = '\0';
+   if (!config_get_array(ref->conf, "filter", ident, sizeof(ident))
+         || !(ref->impl = bench_find_implementation(ident))
+         || !(ref->impl->query_input_formats() & fmt))
+   {
+      bench_reference_free(ref);
+      return false;
+   }
+
+   userdata.conf      = ref->conf;
+   userdata.prefix[0] = "filter";
+   userdata.prefix[1] = ref->impl->short_ident;
+
+   ref->impl_data = ref->impl->create(&bench_config, fmt, fmt,
+         width, height, 1, 0, &userdata);
+   if (!ref->impl_data)
+   {
+      bench_reference_free(ref);
+      return false;
+   }
+
+   return true;
+}
+
+static void bench_reference_process(bench_reference_t *ref,
+      void *output, size_t out_stride, const void *input,
+      unsigned width, unsigned height, size_t in_stride)
+{
+   struct softfilter_work_packet packet;
+
+   ref->impl->get_work_packets(ref->impl_data, &packet, output, out_stride,
+         input, width, height, in_stride);
+   packet.work(ref->impl_data, packet.thread_data);
+}
+
+static const void *bench_clip_frame(const bench_clip_t *clip,
+      enum retro_pixel_format format, unsigned frame)
+{
+   if (format == RETRO_PIXEL_FORMAT_RGB565)
+      return clip->rgb565 + bench_clip_offset(clip, frame);
+   return clip->xrgb8888 + bench_clip_offset(clip, frame);
+}
+
+static void bench_verify(const char *name, const char *preset,
+      const bench_clip_t *clip, enum retro_pixel_format format,
+      unsigned threads)
+{
+   unsigned f, out_width, out_height;
+   size_t out_size, out_stride;
+   uint8_t *ref_out, *out;
+   char msg[128];
+   bench_reference_t ref;
+   bool match               = true;
+   unsigned bpp             = (format == RETRO_PIXEL_FORMAT_RGB565) ? 2 : 4;
+   rarch_softfilter_t *filt = NULL;
+
+   /* Not every filter supports both formats */
+   if (!bench_reference_init(&ref, preset, (bpp == 2)
+            ? SOFTFILTER_FMT_RGB565 : SOFTFILTER_FMT_XRGB8888,
+            clip->width, clip->height))
+      return;
+
+   if (!(filt = rarch_softfilter_new(preset, threads,
+               format, clip->width, clip->height)))
+   {
+      snprintf(msg, sizeof(msg), "%s filter could not be created",
+            bpp == 2 ? "RGB565" : "XRGB8888");
+      check(false, name, msg);
+      bench_reference_free(&ref);
+      return;
+   }
+
+   rarch_softfilter_get_max_output_size(filt, &out_width, &out_height);
+   out_stride = out_width *
+      (rarch_softfilter_get_output_format(filt)
+       == RETRO_PIXEL_FORMAT_RGB565 ? 2 : 4);
+   out_size   = out_stride * out_height;
+   ref_out    = (uint8_t*)calloc(1, out_size);
+   out        = (uint8_t*)calloc(1, out_size);
+
+   /* A handful of frames is enough to cover the edge handling. */
+   for (f = 0; f < clip->frames && f < 8 && match; f++)
+   {
+      const void *in = bench_clip_frame(clip, format, f);
+
+      bench_reference_process(&ref, ref_out, out_stride, in,
+            clip->width, clip->height, clip->stride * bpp);
+      rarch_softfilter_process(filt, out, out_stride, in,
+            clip->width, clip->height, clip->stride * bpp);
+      match = memcmp(ref_out, out, out_size) == 0;
+   }
+
+   snprintf(msg, sizeof(msg),
+         "%s output with %u threads matches the scalar reference",
+         bpp == 2 ? "RGB565" : "XRGB8888", threads);
+   check(match, name, msg);
+
+   free(ref_out);
+   free(out);
+   rarch_softfilter_free(filt);
+   bench_reference_free(&ref);
+}
+
+/* Average ms per frame of the scalar single packet path when
+ * threads is 0, of the frontend path otherwise. */
+static double bench_time(const char *preset, const bench_clip_t *clip,
+      enum retro_pixel_format format, unsigned threads)
+{
+   unsigned f, out_width, out_height;
+   retro_time_t start = 0, end;
+   bench_reference_t ref;
+   void *out;
+   unsigned bpp             = (format == RETRO_PIXEL_FORMAT_RGB565) ? 2 : 4;
+   rarch_softfilter_t *filt = rarch_softfilter_new(preset,
+         threads ? threads : 1, format, clip->width, clip->height);
+
+   if (!filt)
+      return -1.0;
+
+   rarch_softfilter_get_max_output_size(filt, &out_width, &out_height);
+   out = malloc(out_width * out_height * 4);
+
+   if (!threads)
+   {
+      rarch_softfilter_free(filt);
+      filt = NULL;
+      if (!bench_reference_init(&ref, preset, (bpp == 2)
+               ? SOFTFILTER_FMT_RGB565 : SOFTFILTER_FMT_XRGB8888,
+               clip->width, clip->height))
+      {
+         free(out);
+         return -1.0;
+      }
+   }
+
+   /* Warm up caches and wake the pool once before timing. */
+   for (f = 0; f <= clip->frames; f++)
+   {
+      const void *in = bench_clip_frame(clip, format,
+            f ? f - 1 : 0);
+
+      if (f == 1)
+         start = cpu_features_get_time_usec();
+
+      if (filt)
+         rarch_softfilter_process(filt, out, out_width * 4, in,
+               clip->width, clip->height, clip->stride * bpp);
+      else
+         bench_reference_process(&ref, out, out_width * 4, in,
+               clip->width, clip->height, clip->stride * bpp);
+   }
+   end = cpu_features_get_time_usec();
+
+   free(out);
+   if (filt)
+      rarch_softfilter_free(filt);
+   else
+      bench_reference_free(&ref);
+
+   return (double)(end - start) / 1000.0 / clip->frames;
+}
+
+static int bench_compare_names(const void *a, const void *b)
+{
+   return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   unsigned thread_counts[8];
+   unsigned num_thread_counts = 0;
+   unsigned max_threads;
+   unsigned cores             = cpu_features_get_core_amount();
+   const char *dir_path       = argc > 1 ? argv[1]
+      : "../../../gfx/video_filters";
+   char *names[64];
+   unsigned num_names         = 0;
+   bench_clip_t clip;
+   struct dirent *entry;
+   DIR *dir;
+
+   memset(&clip, 0, sizeof(clip));
+   clip.width  = BENCH_WIDTH;
+   clip.height = BENCH_HEIGHT;
+   clip.frames = BENCH_FRAMES;
+
+   if (argc > 4)
+   {
+      clip.width  = (unsigned)strtoul(argv[3], NULL, 0);
+      clip.height = (unsigned)strtoul(argv[4], NULL, 0);
+      clip.stride = clip.width + 2 * BENCH_BORDER;
+      if (!clip.width || !clip.height || !bench_clip_load(&clip, argv[2]))
+      {
+         fprintf(stderr, "Could not load %ux%u frames from %s\n",
+               clip.width, clip.height, argv[2]);
+         return 1;
+      }
+   }
+   else
+   {
+      clip.stride = clip.width + 2 * BENCH_BORDER;
+      if (!bench_clip_alloc(&clip))
+         return 1;
+      bench_clip_synthesize(&clip);
+   }
+   bench_clip_convert(&clip);
+
+   if (!(dir = opendir(dir_path)))
+   {
+      fprintf(stderr, "Could not open %s\n", dir_path);
+      return 1;
+   }
+
+   while ((entry = readdir(dir)) && num_names < ARRAY_SIZE(names))
+   {
+      const char *ext = strrchr(entry->d_name, '.');
+      if (ext && string_is_equal(ext, ".filt"))
+         names[num_names++] = strdup(entry->d_name);
+   }
+   closedir(dir);
+   qsort(names, num_names, sizeof(*names), bench_compare_names);
+
+   /* Go past the core count on small machines, so the tiling and
+    * the work stealing get exercised even there. */
+   max_threads = cores < 4 ? 4 : cores;
+   for (i = 1; i <= max_threads
+         && num_thread_counts < ARRAY_SIZE(thread_counts); i <<= 1)
+      thread_counts[num_thread_counts++] = i;
+   if (thread_counts[num_thread_counts - 1] != max_threads
+         && num_thread_counts < ARRAY_SIZE(thread_counts))
+      thread_counts[num_thread_counts++] = max_threads;
+
+   printf("%u frames of %ux%u, %u cores\n\n",
+         clip.frames, clip.width, clip.height, cores);
+
+   for (i = 0; i < num_names; i++)
+   {
+      char preset[PATH_MAX_LENGTH];
+      snprintf(preset, sizeof(preset), "%s/%s", dir_path, names[i]);
+
+      for (j = 1; j < num_thread_counts; j++)
+      {
+         bench_verify(names[i], preset, &clip,
+               RETRO_PIXEL_FORMAT_XRGB8888, thread_counts[j]);
+         bench_verify(names[i], preset, &clip,
+               RETRO_PIXEL_FORMAT_RGB565, thread_counts[j]);
+      }
+   }
+
+   printf("\n%-34s %-8s %7s", "ms/frame", "format", "scalar");
+   for (j = 0; j < num_thread_counts; j++)
+      printf(" %7u", thread_counts[j]);
+   printf("\n");
+
+   for (i = 0; i < num_names; i++)
+   {
+      char preset[PATH_MAX_LENGTH];
+      enum retro_pixel_format format = RETRO_PIXEL_FORMAT_XRGB8888;
+      double scalar;
+
+      snprintf(preset, sizeof(preset), "%s/%s", dir_path, names[i]);
+
+      if ((scalar = bench_time(preset, &clip, format, 0)) < 0.0)
+      {
+         format = RETRO_PIXEL_FORMAT_RGB565;
+         scalar = bench_time(preset, &clip, format, 0);
+      }
+
+      printf("%-34s %-8s %7.3f", names[i],
+            format == RETRO_PIXEL_FORMAT_RGB565 ? "RGB565" : "XRGB8888",
+            scalar);
+      for (j = 0; j < num_thread_counts; j++)
+         printf(" %7.3f", bench_time(preset, &clip, format,
+                  thread_counts[j]));
+      printf("\n");
+      free(names[i]);
+   }
+
+   free(clip.xrgb8888);
+   free(clip.rgb565);
+
+   printf("\n%s\n", failures ? "[ERROR]: Some filters did not match"
+         : "[SUCCESS]: All filters matched their scalar reference");
+
+   return failures ? 1 : 0;
+}
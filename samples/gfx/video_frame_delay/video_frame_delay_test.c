@@ -0,0 +1,242 @@
+/* Deterministic harness for the adaptive frame delay controller.
+ *
+ *   video_frame_delay_test
+ *      Runs the built-in synthetic scenarios and checks the results.
+ *
+ *   video_frame_delay_test <trace> [refresh rate] [max delay]
+ *      Replays a frame time trace (one work time in usec per line,
+ *      '#' starts a comment) against a simulated VSync display and
+ *      reports the chosen delays and missed frames.
+ *
+ * The display is modelled as follows: a frame starts 'delay' ms after
+ * a VSync and is presented on the first VSync after its work is done.
+ * If that is not the very next VSync the frame missed its deadline,
+ * which the controller sees as a longer interval between frames.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../gfx/video_frame_delay.h"
+
+typedef struct sim_result
+{
+   uint64_t frames;
+   uint64_t misses;
+   uint64_t delay_total;
+   unsigned delay_min;
+   unsigned delay_max;
+   unsigned delay_final;
+} sim_result_t;
+
+static unsigned failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s\n", msg);
+   else
+   {
+      printf("[ERROR]: %s\n", msg);
+      failures++;
+   }
+}
+
+static void simulate(const retro_time_t *work, size_t count,
+      retro_time_t period, unsigned max_delay, sim_result_t *res)
+{
+   size_t i;
+   video_frame_delay_auto_t fd;
+   retro_time_t vsync      = 0;
+   retro_time_t last_start = 0;
+
+   video_frame_delay_auto_init(&fd, max_delay);
+   memset(res, 0, sizeof(*res));
+   res->delay_min = max_delay;
+
+   for (i = 0; i < count; i++)
+   {
+      retro_time_t start  = vsync + fd.delay * 1000;
+      retro_time_t end    = start + work[i];
+      retro_time_t next   = vsync + period;
+      unsigned delay_used = fd.delay;
+
+      /* Presented on the first VSync after the work is done */
+      while (next < end)
+         next += period;
+
+      if (next > vsync + period)
+         res->misses++;
+
+      video_frame_delay_auto_update(&fd, period, work[i],
+            i ? start - last_start : 0);
+
+      last_start        = start;
+      vsync             = next;
+
+      res->frames++;
+      res->delay_total += delay_used;
+      if (delay_used < res->delay_min)
+         res->delay_min = delay_used;
+      if (delay_used > res->delay_max)
+         res->delay_max = delay_used;
+   }
+
+   res->delay_final = fd.delay;
+}
+
+static void print_result(const char *name, const sim_result_t *res)
+{
+   printf("%-24s frames %6u, missed %4u, delay avg %5.2f ms "
+         "(min %u, max %u, final %u)\n",
+         name,
+         (unsigned)res->frames, (unsigned)res->misses,
+         res->frames ? (double)res->delay_total / res->frames : 0.0,
+         res->delay_min, res->delay_max, res->delay_final);
+}
+
+/* Simple deterministic LCG so the jitter is reproducible */
+static unsigned lcg(unsigned *state)
+{
+   *state = *state * 1103515245u + 12345u;
+   return (*state >> 16) & 0x7fff;
+}
+
+/* The maximum changed while running, as the frame delay
+ * setting can be from the menu */
+static void test_set_max(retro_time_t period)
+{
+   unsigned i;
+   bool capped = true;
+   video_frame_delay_auto_t fd;
+
+   video_frame_delay_auto_init(&fd, 10);
+
+   for (i = 0; i < 1000; i++)
+      video_frame_delay_auto_update(&fd, period, 2000, period);
+   check(fd.delay == 10, "Light frames reach the maximum");
+
+   video_frame_delay_auto_set_max(&fd, 4);
+   check(fd.delay == 4, "A lower maximum applies right away");
+
+   for (i = 0; i < 1000; i++)
+      if (video_frame_delay_auto_update(&fd, period, 2000, period) > 4)
+         capped = false;
+   check(capped, "The lower maximum holds");
+
+   video_frame_delay_auto_set_max(&fd, 8);
+   for (i = 0; i < 1000; i++)
+      video_frame_delay_auto_update(&fd, period, 2000, period);
+   check(fd.delay == 8, "A higher maximum is ramped up to");
+}
+
+static void selftest(void)
+{
+   size_t i;
+   sim_result_t res;
+   unsigned seed         = 1;
+   const size_t frames   = 3600;
+   const retro_time_t p  = 16667;
+   retro_time_t *work    = (retro_time_t*)malloc(frames * sizeof(*work));
+
+   /* Light, steady frames */
+   for (i = 0; i < frames; i++)
+      work[i] = 4000 + lcg(&seed) % 500;
+   simulate(work, frames, p, 15, &res);
+   print_result("light steady", &res);
+   check(res.misses == 0 && res.delay_final >= 9,
+         "Light frames converge to a high delay without misses");
+
+   /* Heavy frames close to the budget */
+   for (i = 0; i < frames; i++)
+      work[i] = 13000 + lcg(&seed) % 1000;
+   simulate(work, frames, p, 15, &res);
+   print_result("heavy steady", &res);
+   check(res.misses == 0 && res.delay_final <= 1,
+         "Heavy frames keep the delay near zero");
+
+   /* Light gameplay with a heavy scene in the middle */
+   for (i = 0; i < frames; i++)
+      work[i] = (i >= 1200 && i < 1800)
+         ? 11000 + lcg(&seed) % 1500
+         : 5000  + lcg(&seed) % 800;
+   simulate(work, frames, p, 15, &res);
+   print_result("heavy scene", &res);
+   check(res.misses <= 1, "Heavy scene only misses its first frame");
+
+   /* Occasional spikes */
+   for (i = 0; i < frames; i++)
+      work[i] = (lcg(&seed) % 100 == 0) ? 12000 : 5000;
+   simulate(work, frames, p, 15, &res);
+   print_result("rare spikes", &res);
+   check(res.misses < frames / 100,
+         "Rare spikes are absorbed by the backoff");
+
+   /* The fixed delay acts as the upper bound */
+   for (i = 0; i < frames; i++)
+      work[i] = 2000;
+   simulate(work, frames, p, 4, &res);
+   print_result("capped", &res);
+   check(res.delay_max <= 4, "Delay never exceeds the configured maximum");
+
+   free(work);
+
+   test_set_max(p);
+}
+
+static int replay(const char *path, float refresh, unsigned max_delay)
+{
+   char line[256];
+   sim_result_t res;
+   size_t count       = 0;
+   size_t capacity    = 1024;
+   retro_time_t *work = (retro_time_t*)malloc(capacity * sizeof(*work));
+   FILE *file         = fopen(path, "r");
+
+   if (!file)
+   {
+      printf("[ERROR]: Could not open %s\n", path);
+      free(work);
+      return 1;
+   }
+
+   while (fgets(line, sizeof(line), file))
+   {
+      char *end = NULL;
+      long long val;
+
+      if (line[0] == '#')
+         continue;
+
+      val = strtoll(line, &end, 10);
+      if (end == line)
+         continue;
+
+      if (count == capacity)
+      {
+         capacity *= 2;
+         work      = (retro_time_t*)realloc(work, capacity * sizeof(*work));
+      }
+      work[count++] = val;
+   }
+   fclose(file);
+
+   simulate(work, count, (retro_time_t)(1000000.0f / refresh),
+         max_delay, &res);
+   print_result(path, &res);
+
+   free(work);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc >= 2)
+      return replay(argv[1],
+            argc >= 3 ? (float)atof(argv[2]) : 60.0f,
+            argc >= 4 ? (unsigned)atoi(argv[3]) : 15);
+
+   selftest();
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+/* Exercises the input thread event queue used by the udev and
+ * linuxraw input drivers.
+ *
+ *   linux_input_thread_test
+ *      Runs the built-in self tests.
+ *
+ *   linux_input_thread_test trace <file> [poll interval usec]
+ *      Replays a recorded evdev trace (raw struct input_event records,
+ *      e.g. captured with 'cat /dev/input/eventN > trace.bin')
+ *      deterministically, polling at a fixed interval (default 16667),
+ *      and reports the resulting event-to-poll latency histogram.
+ *
+ *   linux_input_thread_test device <node> [seconds]
+ *      Reads a real or virtual (uinput) evdev node on the input
+ *      thread, polls once per 60Hz frame and reports the measured
+ *      event-to-poll latency.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+#include <features/features_cpu.h>
+#include <retro_timers.h>
+
+#include "../../../input/common/linux_input_thread.h"
+
+#ifndef input_event_sec
+#define input_event_sec  time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define SELFTEST_EVENTS 100000
+
+static unsigned failures = 0;
+
+/* linux_input_thread.c logs through RetroArch's logger */
+void RARCH_LOG(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vprintf(fmt, ap);
+   va_end(ap);
+}
+
+static void check(bool cond, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s\n", msg);
+   else
+   {
+      printf("[ERROR]: %s\n", msg);
+      failures++;
+   }
+}
+
+static void print_histogram(linux_input_thread_t *thread)
+{
+   unsigned i;
+   linux_input_thread_stats_t stats;
+
+   linux_input_thread_get_stats(thread, &stats);
+
+   for (i = 0; i < LINUX_INPUT_THREAD_HISTOGRAM_BUCKETS; i++)
+   {
+      if (!stats.histogram[i])
+         continue;
+      if (i == 0)
+         printf("  %8s usec: %llu\n", "0",
+               (unsigned long long)stats.histogram[i]);
+      else
+         printf("  < %6lld usec: %llu\n", (long long)1 << i,
+               (unsigned long long)stats.histogram[i]);
+   }
+
+   linux_input_thread_log_stats(thread, "test");
+}
+
+struct order_state
+{
+   int32_t expected;
+   bool in_order;
+};
+
+static void order_cb(void *data, const linux_input_thread_event_t *event)
+{
+   struct order_state *state = (struct order_state*)data;
+
+   if (event->value != state->expected)
+      state->in_order = false;
+   state->expected = event->value + 1;
+}
+
+static void synthetic_wait(void *data,
+      linux_input_thread_t *thread, int timeout_ms)
+{
+   int32_t *next = (int32_t*)data;
+
+   while (*next < SELFTEST_EVENTS)
+   {
+      if (!linux_input_thread_push(thread, NULL,
+               cpu_features_get_time_usec(), EV_KEY, KEY_A, *next))
+         break;
+      (*next)++;
+   }
+
+   if (*next >= SELFTEST_EVENTS)
+      retro_sleep(timeout_ms);
+}
+
+static void selftest(void)
+{
+   unsigned i;
+   size_t drained;
+   struct order_state state;
+   linux_input_thread_stats_t stats;
+   int32_t next                 = 0;
+   linux_input_thread_t *thread = linux_input_thread_new(NULL, NULL, false);
+
+   /* Ordering, unthreaded */
+   for (i = 0; i < 512; i++)
+      linux_input_thread_push(thread, NULL, i, EV_KEY, KEY_A, i);
+
+   state.expected = 0;
+   state.in_order = true;
+   drained        = linux_input_thread_drain(thread, 512, order_cb, &state);
+   check(drained == 512 && state.in_order, "Events drained in order");
+
+   /* Overflow */
+   for (i = 0; i < 2048; i++)
+      linux_input_thread_push(thread, NULL, 1000, EV_KEY, KEY_A, i);
+
+   state.expected = 0;
+   state.in_order = true;
+   drained        = linux_input_thread_drain(thread, 1000, order_cb, &state);
+   linux_input_thread_get_stats(thread, &stats);
+   check(drained + stats.dropped == 2048 && state.in_order,
+         "Full queue drops newest events only");
+
+   /* Latency accounting */
+   linux_input_thread_free(thread);
+   thread = linux_input_thread_new(NULL, NULL, false);
+   for (i = 0; i < 100; i++)
+      linux_input_thread_push(thread, NULL, 10000 - i * 100,
+            EV_KEY, KEY_A, i);
+   linux_input_thread_drain(thread, 10000, order_cb, &state);
+   linux_input_thread_get_stats(thread, &stats);
+   check(stats.latency_max == 9900
+         && linux_input_thread_latency_percentile(&stats, 50) >= 4950,
+         "Latency histogram");
+   linux_input_thread_free(thread);
+
+   /* Threaded producer */
+   thread         = linux_input_thread_new(synthetic_wait, &next, true);
+   state.expected = 0;
+   state.in_order = true;
+   drained        = 0;
+
+   while (drained < SELFTEST_EVENTS)
+      drained += linux_input_thread_drain(thread,
+            cpu_features_get_time_usec(), order_cb, &state);
+
+   check(drained == SELFTEST_EVENTS && state.in_order,
+         "Threaded producer delivers every event in order");
+   print_histogram(thread);
+   linux_input_thread_free(thread);
+}
+
+static void null_cb(void *data, const linux_input_thread_event_t *event) { }
+
+static int replay_trace(const char *path, retro_time_t interval)
+{
+   struct input_event ev;
+   retro_time_t next_poll       = -1;
+   size_t events                = 0;
+   FILE *file                   = fopen(path, "rb");
+   linux_input_thread_t *thread = NULL;
+
+   if (!file)
+   {
+      printf("[ERROR]: Could not open %s\n", path);
+      return 1;
+   }
+
+   thread = linux_input_thread_new(NULL, NULL, false);
+
+   while (fread(&ev, sizeof(ev), 1, file) == 1)
+   {
+      retro_time_t time = (retro_time_t)ev.input_event_sec * 1000000
+         + ev.input_event_usec;
+
+      if (ev.type == EV_SYN)
+         continue;
+
+      if (next_poll < 0)
+         next_poll = time + interval;
+
+      /* Polls that happened before this event arrived */
+      while (time >= next_poll)
+      {
+         linux_input_thread_drain(thread, next_poll, null_cb, NULL);
+         next_poll += interval;
+      }
+
+      linux_input_thread_push(thread, NULL, time,
+            ev.type, ev.code, ev.value);
+      events++;
+   }
+
+   linux_input_thread_drain(thread, next_poll, null_cb, NULL);
+
+   printf("Replayed %u events from %s, polling every %lld usec:\n",
+         (unsigned)events, path, (long long)interval);
+   print_histogram(thread);
+
+   linux_input_thread_free(thread);
+   fclose(file);
+   return 0;
+}
+
+struct device_state
+{
+   int fd;
+   bool monotonic;
+};
+
+static void device_wait(void *data,
+      linux_input_thread_t *thread, int timeout_ms)
+{
+   struct input_event ev;
+   struct pollfd fds;
+   struct device_state *dev = (struct device_state*)data;
+
+   fds.fd      = dev->fd;
+   fds.events  = POLLIN;
+   fds.revents = 0;
+
+   if (poll(&fds, 1, timeout_ms) <= 0)
+      return;
+
+   while (read(dev->fd, &ev, sizeof(ev)) == sizeof(ev))
+   {
+      retro_time_t time = dev->monotonic
+         ? (retro_time_t)ev.input_event_sec * 1000000 + ev.input_event_usec
+         : cpu_features_get_time_usec();
+
+      if (ev.type != EV_SYN)
+         linux_input_thread_push(thread, NULL, time,
+               ev.type, ev.code, ev.value);
+   }
+}
+
+static int read_device(const char *path, unsigned seconds)
+{
+   int clk                      = CLOCK_MONOTONIC;
+   retro_time_t end             = 0;
+   linux_input_thread_t *thread = NULL;
+   struct device_state dev;
+
+   dev.fd = open(path, O_RDONLY | O_NONBLOCK);
+   if (dev.fd < 0)
+   {
+      printf("[ERROR]: Could not open %s\n", path);
+      return 1;
+   }
+
+   dev.monotonic = ioctl(dev.fd, EVIOCSCLOCKID, &clk) == 0;
+   thread        = linux_input_thread_new(device_wait, &dev, true);
+   end           = cpu_features_get_time_usec() + seconds * 1000000;
+
+   printf("Reading %s for %u seconds...\n", path, seconds);
+
+   while (cpu_features_get_time_usec() < end)
+   {
+      retro_sleep(16);
+      linux_input_thread_drain(thread, cpu_features_get_time_usec(),
+            null_cb, NULL);
+   }
+
+   print_histogram(thread);
+
+   linux_input_thread_free(thread);
+   close(dev.fd);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc >= 3 && !strcmp(argv[1], "trace"))
+      return replay_trace(argv[2], argc >= 4 ? atoi(argv[3]) : 16667);
+   if (argc >= 3 && !strcmp(argv[1], "device"))
+      return read_device(argv[2], argc >= 4 ? atoi(argv[3]) : 10);
+
+   selftest();
+   return failures ? 1 : 0;
+}
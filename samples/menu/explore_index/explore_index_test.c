@@ -0,0 +1,398 @@
+/* Regression test and benchmark for the Explore index.
+ *
+ *   explore_index_test [entries]
+ *
+ * Uses (and empties) "explore_index_test.dir". Builds four synthetic
+ * databases and playlists with [entries] (50000 by default) entries in
+ * total, then checks that a warm start reads nothing, that a changed
+ * playlist is parsed alone, that only new CRCs and changed databases
+ * are looked up and that a damaged cache is rebuilt. Times a cold
+ * start with one and with several threads against a warm start.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "libretro-db/libretrodb.h"
+#include "menu/menu_explore_index.h"
+
+#define NUM_DBS 4
+
+static int failures = 0;
+static const char *dir = "explore_index_test.dir";
+static const char *fields[] = {
+   "developer", "publisher", "releaseyear", "users", "genre",
+   "origin", "region", "franchise", "tags"
+};
+#define NUM_FIELDS (sizeof(fields) / sizeof(fields[0]))
+
+/* Entries per playlist, and extra ones added by a test */
+static unsigned per_playlist;
+static unsigned extra[NUM_DBS];
+static unsigned variant[NUM_DBS];
+
+typedef struct
+{
+   unsigned db;
+   unsigned next;
+   unsigned count;
+   unsigned variant;
+} rdb_ctx_t;
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* Distinct and non-zero per database */
+static uint32_t make_crc(unsigned db, unsigned i)
+{
+   uint32_t x = ((uint32_t)db << 24) + i + 1;
+
+   x ^= x >> 16;
+   x *= 0x85EBCA6Bu;
+   x ^= x >> 13;
+   x *= 0xC2B2AE35u;
+   x ^= x >> 16;
+   return x;
+}
+
+static void make_developer(char *s, size_t len, uint32_t crc, unsigned var)
+{
+   snprintf(s, len, var ? "Studio %u" : "Developer %u", crc % 50);
+}
+
+static void set_string(struct rmsgpack_dom_value *val, const char *str)
+{
+   val->type            = RDT_STRING;
+   val->val.string.len  = (uint32_t)strlen(str);
+   val->val.string.buff = strdup(str);
+}
+
+static int rdb_provider(void *data, struct rmsgpack_dom_value *out)
+{
+   char tmp[64];
+   uint32_t crc_be;
+   rdb_ctx_t *ctx = (rdb_ctx_t*)data;
+   uint32_t crc;
+
+   if (ctx->next >= ctx->count)
+      return 1;
+
+   crc                 = make_crc(ctx->db, ctx->next++);
+   out->type           = RDT_MAP;
+   out->val.map.len    = 5;
+   out->val.map.items  = (struct rmsgpack_dom_pair*)calloc(5,
+         sizeof(struct rmsgpack_dom_pair));
+
+   snprintf(tmp, sizeof(tmp), "Game %08X", crc);
+   set_string(&out->val.map.items[0].key, "name");
+   set_string(&out->val.map.items[0].value, tmp);
+
+   crc_be = swap_if_little32(crc);
+   set_string(&out->val.map.items[1].key, "crc");
+   out->val.map.items[1].value.type            = RDT_BINARY;
+   out->val.map.items[1].value.val.binary.len  = 4;
+   out->val.map.items[1].value.val.binary.buff = (char*)malloc(4);
+   memcpy(out->val.map.items[1].value.val.binary.buff, &crc_be, 4);
+
+   make_developer(tmp, sizeof(tmp), crc, ctx->variant);
+   set_string(&out->val.map.items[2].key, "developer");
+   set_string(&out->val.map.items[2].value, tmp);
+
+   snprintf(tmp, sizeof(tmp), "Genre %u", crc % 20);
+   set_string(&out->val.map.items[3].key, "genre");
+   set_string(&out->val.map.items[3].value, tmp);
+
+   set_string(&out->val.map.items[4].key, "releaseyear");
+   out->val.map.items[4].value.type     = RDT_UINT;
+   out->val.map.items[4].value.val.uint_ = 1980 + crc % 30;
+
+   return 0;
+}
+
+static void make_db_path(char *s, size_t len, unsigned db, bool ext)
+{
+   char name[32];
+
+   snprintf(name, sizeof(name), "System %u%s", db, ext ? ".rdb" : "");
+   fill_pathname_join(s, dir, name, len);
+}
+
+static void write_db(unsigned db)
+{
+   char path[PATH_MAX_LENGTH];
+   rdb_ctx_t ctx;
+   RFILE *file;
+
+   /* Twice as many games as the playlists have */
+   ctx.db      = db;
+   ctx.next    = 0;
+   ctx.count   = per_playlist * 2;
+   ctx.variant = variant[db];
+
+   make_db_path(path, sizeof(path), db, true);
+   if ((file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      libretrodb_create(file, rdb_provider, &ctx);
+      filestream_close(file);
+   }
+}
+
+static void make_playlist_path(char *s, size_t len, unsigned p)
+{
+   char name[32];
+
+   snprintf(name, sizeof(name), "System %u.lpl", p);
+   fill_pathname_join(s, dir, name, len);
+}
+
+/* Only the size and time of playlists matter to the index. Times
+ * may only have a resolution of seconds, so a playlist with other
+ * entries gets another size. */
+static void write_playlist(unsigned p)
+{
+   char path[PATH_MAX_LENGTH];
+   char data[64];
+   int len = snprintf(data, sizeof(data), "%u entries%.*s",
+         per_playlist + extra[p], (int)extra[p], "++++++++");
+
+   make_playlist_path(path, sizeof(path), p);
+   filestream_write_file(path, data, len);
+}
+
+static void make_cache_path(char *s, size_t len)
+{
+   fill_pathname_join(s, dir, "explore_index.rexi", len);
+}
+
+static explore_index_t *build(unsigned threads,
+      explore_index_stats_t *stats)
+{
+   unsigned p, i;
+   char path[PATH_MAX_LENGTH];
+   char db_name[32];
+   char label[32];
+   explore_index_t *index;
+
+   make_cache_path(path, sizeof(path));
+   index = explore_index_new(path, fields, NUM_FIELDS);
+
+   for (p = 0; p < NUM_DBS; p++)
+   {
+      make_playlist_path(path, sizeof(path), p);
+
+      if (!path_is_valid(path))
+         continue;
+
+      if (explore_index_begin_playlist(index, path))
+         continue;
+
+      snprintf(db_name, sizeof(db_name), "System %u.rdb", p);
+
+      for (i = 0; i < per_playlist + extra[p]; i++)
+      {
+         uint32_t crc = make_crc(p, i);
+
+         snprintf(label, sizeof(label), "Game %08X", crc);
+         explore_index_add_entry(index, label, "Core", db_name, crc, i);
+      }
+   }
+
+   explore_index_update(index, dir, threads);
+   explore_index_save(index);
+   explore_index_get_stats(index, stats);
+   return index;
+}
+
+/* Number of entries with the values the database has for them */
+static unsigned count_valid(explore_index_t *index)
+{
+   size_t i;
+   unsigned valid                       = 0;
+   const explore_index_entry_t *entries = NULL;
+   size_t count = explore_index_get_entries(index, &entries);
+
+   for (i = 0; i < count; i++)
+   {
+      char tmp[64];
+      unsigned db;
+      const char *playlist = explore_index_get_playlist(index,
+            entries[i].playlist);
+      uint32_t crc         = (uint32_t)strtoul(entries[i].label + 5, NULL, 16);
+
+      if (!playlist || sscanf(path_basename(playlist), "System %u", &db) != 1
+            || db >= NUM_DBS || make_crc(db, entries[i].index) != crc)
+         continue;
+
+      make_developer(tmp, sizeof(tmp), crc, variant[db]);
+      if (!string_is_equal(entries[i].fields[0], tmp)
+            || entries[i].fields[1])
+         continue;
+
+      snprintf(tmp, sizeof(tmp), "%u", 1980 + crc % 30);
+      if (!string_is_equal(entries[i].fields[2], tmp))
+         continue;
+
+      snprintf(tmp, sizeof(tmp), "Genre %u", crc % 20);
+      if (!string_is_equal(entries[i].fields[4], tmp)
+            || !string_is_equal(entries[i].core_name, "Core")
+            || entries[i].original_title)
+         continue;
+
+      valid++;
+   }
+
+   return valid;
+}
+
+static bool expect(const char *name, unsigned threads,
+      unsigned parsed, unsigned read, unsigned entries)
+{
+   explore_index_stats_t stats;
+   explore_index_t *index = build(threads, &stats);
+   unsigned valid         = count_valid(index);
+   bool ok                = stats.playlists_parsed == parsed
+         && stats.databases_read == read
+         && stats.entries == entries
+         && valid == entries;
+
+   if (!ok)
+      printf("%s: %u parsed, %u read, %u entries, %u valid\n", name,
+            stats.playlists_parsed, stats.databases_read, stats.entries,
+            valid);
+
+   explore_index_free(index);
+   return ok;
+}
+
+static void test_index(void)
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned total = per_playlist * NUM_DBS;
+   void *buf      = NULL;
+   int64_t len    = 0;
+
+   check(expect("cold", 4, NUM_DBS, NUM_DBS, total),
+         "index", "cold start reads everything");
+   check(expect("warm", 4, 0, 0, total),
+         "index", "warm start reads nothing");
+
+   /* Touched, but without new games */
+   make_playlist_path(path, sizeof(path), 1);
+   filestream_write_file(path, "changed", 7);
+   check(expect("touched", 4, 1, 0, total),
+         "index", "changed playlist parsed alone, no database read");
+
+   extra[2] = 1;
+   write_playlist(2);
+   check(expect("new crc", 4, 1, 1, total + 1),
+         "index", "new game looked up in its database only");
+
+   /* Different values, different size */
+   variant[3] = 1;
+   write_db(3);
+   check(expect("changed db", 4, 0, 1, total + 1),
+         "index", "changed database read again");
+
+   make_cache_path(path, sizeof(path));
+   if (filestream_read_file(path, &buf, &len))
+   {
+      ((uint8_t*)buf)[len / 2] ^= 0x10;
+      filestream_write_file(path, buf, len);
+      free(buf);
+   }
+   check(expect("damaged", 1, NUM_DBS, NUM_DBS, total + 1),
+         "index", "damaged cache rebuilt");
+
+   make_playlist_path(path, sizeof(path), 0);
+   filestream_delete(path);
+   check(expect("removed", 4, 0, 0, total + 1 - per_playlist),
+         "index", "removed playlist left out");
+   check(expect("removed", 4, 0, 0, total + 1 - per_playlist),
+         "index", "removed playlist stays out");
+
+   write_playlist(0);
+   check(expect("restored", 4, 1, 1, total + 1),
+         "index", "restored playlist read again");
+}
+
+static double time_build(unsigned threads, bool cold)
+{
+   char path[PATH_MAX_LENGTH];
+   explore_index_stats_t stats;
+   retro_time_t start;
+
+   make_cache_path(path, sizeof(path));
+   if (cold)
+      filestream_delete(path);
+
+   start = cpu_features_get_time_usec();
+   explore_index_free(build(threads, &stats));
+   return (cpu_features_get_time_usec() - start) / 1000.0;
+}
+
+static void bench(void)
+{
+   printf("cold, 1 thread:  %8.1f ms\n", time_build(1, true));
+   printf("cold, %u threads: %8.1f ms\n", EXPLORE_INDEX_DEFAULT_THREADS,
+         time_build(EXPLORE_INDEX_DEFAULT_THREADS, true));
+   printf("warm:            %8.1f ms\n",
+         time_build(EXPLORE_INDEX_DEFAULT_THREADS, false));
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+   unsigned entries = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 50000;
+
+   per_playlist = MAX(entries / NUM_DBS, 1);
+
+   path_mkdir(dir);
+   make_cache_path(path, sizeof(path));
+   filestream_delete(path);
+
+   for (i = 0; i < NUM_DBS; i++)
+   {
+      write_db(i);
+      write_playlist(i);
+   }
+
+   test_index();
+   bench();
+
+   for (i = 0; i < NUM_DBS; i++)
+   {
+      make_db_path(path, sizeof(path), i, true);
+      filestream_delete(path);
+      make_playlist_path(path, sizeof(path), i);
+      filestream_delete(path);
+   }
+   make_cache_path(path, sizeof(path));
+   filestream_delete(path);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
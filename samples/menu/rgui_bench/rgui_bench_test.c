@@ -0,0 +1,615 @@
+/* Regression test and benchmark for RGUI rendering.
+ *
+ *   rgui_bench_test [frames]
+ *
+ * Builds the RGUI driver against a stubbed frontend with a synthetic
+ * 200 entry menu. Checks the glyph and rectangle fill routines against
+ * straightforward per-pixel versions, checks that unchanged frames are
+ * not uploaded and that partial updates of the upscaled texture match
+ * a full rescale. Then drives navigation, ticker scrolling and idle
+ * redraws for [frames] (2000 by default) frames each, with and without
+ * internal upscaling, and reports CPU time and uploads per frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "menu/drivers/rgui.c"
+
+#define NUM_ENTRIES 200
+
+static int failures = 0;
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* ==============================
+ * Frontend stubs
+ * ============================== */
+
+struct aspect_ratio_elem aspectratio_lut[ASPECT_RATIO_END];
+uintptr_t gfx_display_white_texture;
+
+static settings_t *test_settings   = NULL;
+static struct video_viewport test_custom_vp;
+static unsigned test_vp_width      = 1280;
+static unsigned test_vp_height     = 720;
+
+static unsigned test_fb_width      = 0;
+static unsigned test_fb_height     = 0;
+static size_t test_fb_pitch        = 0;
+static bool test_fb_dirty          = false;
+static bool test_update_pending    = false;
+
+static size_t test_selection       = 0;
+static size_t test_start           = 0;
+static uint64_t test_ticker_idx    = 0;
+static retro_time_t test_time      = 0;
+
+static unsigned test_uploads       = 0;
+static unsigned test_upload_width  = 0;
+static unsigned test_upload_height = 0;
+
+settings_t *config_get_ptr(void) { return test_settings; }
+bool command_event(enum event_command action, void *data) { return true; }
+
+const char *msg_hash_to_str(enum msg_hash_enums msg) { return ""; }
+
+void gfx_display_set_width(unsigned width)   { test_fb_width  = width; }
+void gfx_display_set_height(unsigned height) { test_fb_height = height; }
+void gfx_display_set_framebuffer_pitch(size_t pitch) { test_fb_pitch = pitch; }
+void gfx_display_get_fb_size(unsigned *fb_width, unsigned *fb_height,
+      size_t *fb_pitch)
+{
+   *fb_width  = test_fb_width;
+   *fb_height = test_fb_height;
+   *fb_pitch  = test_fb_pitch;
+}
+void gfx_display_set_header_height(unsigned height) { }
+unsigned gfx_display_get_header_height(void) { return FONT_HEIGHT_STRIDE * 2; }
+bool gfx_display_get_msg_force(void) { return false; }
+bool gfx_display_get_update_pending(void) { return test_update_pending; }
+bool gfx_display_get_framebuffer_dirty_flag(void) { return test_fb_dirty; }
+void gfx_display_set_framebuffer_dirty_flag(void) { test_fb_dirty = true; }
+void gfx_display_unset_framebuffer_dirty_flag(void) { test_fb_dirty = false; }
+bool gfx_display_init_first_driver(bool video_is_threaded) { return true; }
+void gfx_display_allocate_white_texture(void) { }
+
+bool gfx_animation_ctl(enum gfx_animation_ctl_state state, void *data) { return false; }
+float gfx_animation_get_delta_time(void) { return 1000.0f / 60.0f; }
+uint64_t gfx_animation_get_ticker_idx(void) { return test_ticker_idx; }
+uint64_t gfx_animation_get_ticker_pixel_idx(void) { return test_ticker_idx; }
+void gfx_animation_set_update_time_cb(update_time_cb cb) { }
+void gfx_animation_unset_update_time_cb(void) { }
+
+/* Selected strings that do not fit scroll one character per tick */
+bool gfx_animation_ticker(gfx_animation_ctx_ticker_t *ticker)
+{
+   size_t src_len = strlen(ticker->str);
+   size_t offset  = 0;
+   size_t len     = src_len;
+
+   if (len > ticker->len)
+   {
+      len = ticker->len;
+      if (ticker->selected)
+         offset = ticker->idx % (src_len - len + 1);
+   }
+
+   memcpy(ticker->s, ticker->str + offset, len);
+   ticker->s[len] = '\0';
+   return offset > 0;
+}
+
+bool gfx_animation_ticker_smooth(gfx_animation_ctx_ticker_smooth_t *ticker)
+{
+   size_t len = ticker->field_width / ticker->glyph_width;
+
+   strlcpy(ticker->dst_str, ticker->src_str,
+         (len + 1 < ticker->dst_str_len) ? len + 1 : ticker->dst_str_len);
+   if (ticker->x_offset)
+      *ticker->x_offset = 0;
+   return false;
+}
+
+gfx_thumbnail_path_data_t *gfx_thumbnail_path_init(void)
+{
+   /* Opaque to RGUI - only ever freed */
+   return (gfx_thumbnail_path_data_t*)calloc(1, 16);
+}
+bool gfx_thumbnail_get_label(gfx_thumbnail_path_data_t *path_data,
+      const char **label) { return false; }
+bool gfx_thumbnail_get_path(gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id, const char **path) { return false; }
+bool gfx_thumbnail_get_system(gfx_thumbnail_path_data_t *path_data,
+      const char **system) { return false; }
+bool gfx_thumbnail_is_enabled(gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id) { return false; }
+bool gfx_thumbnail_set_content_playlist(gfx_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t idx) { return false; }
+bool gfx_thumbnail_set_system(gfx_thumbnail_path_data_t *path_data,
+      const char *system, playlist_t *playlist) { return false; }
+bool gfx_thumbnail_update_path(gfx_thumbnail_path_data_t *path_data,
+      enum gfx_thumbnail_id thumbnail_id) { return false; }
+playlist_t *playlist_get_cached(void) { return NULL; }
+
+bool task_push_image_load(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *userdata) { return false; }
+bool task_push_pl_entry_thumbnail_download(const char *system,
+      playlist_t *playlist, unsigned idx, bool overwrite, bool mute)
+{ return false; }
+void menu_display_handle_thumbnail_upload(retro_task_t *task,
+      void *task_data, void *user_data, const char *err) { }
+void menu_display_handle_left_thumbnail_upload(retro_task_t *task,
+      void *task_data, void *user_data, const char *err) { }
+void menu_display_handle_wallpaper_upload(retro_task_t *task,
+      void *task_data, void *user_data, const char *err) { }
+
+char **input_event_get_osk_grid(void) { return NULL; }
+int input_event_get_osk_ptr(void) { return 0; }
+const char *menu_input_dialog_get_buffer(void) { return ""; }
+const char *menu_input_dialog_get_label_buffer(void) { return ""; }
+bool menu_input_dialog_get_display_kb(void) { return false; }
+void menu_input_get_pointer_state(menu_input_pointer_t *pointer)
+{
+   memset(pointer, 0, sizeof(*pointer));
+}
+void menu_input_set_pointer_selection(unsigned selection) { }
+
+void menu_display_timedate(gfx_display_ctx_datetime_t *datetime)
+{
+   datetime->s[0] = '\0';
+}
+void menu_display_powerstate(gfx_display_ctx_powerstate_t *powerstate)
+{
+   powerstate->s[0] = '\0';
+}
+retro_time_t menu_driver_get_current_time(void) { return test_time; }
+void menu_driver_navigation_set(bool scroll) { }
+int generic_menu_entry_action(void *userdata, menu_entry_t *entry,
+      size_t i, enum menu_action action) { return 0; }
+
+size_t menu_navigation_get_selection(void) { return test_selection; }
+void menu_navigation_set_selection(size_t val) { test_selection = val; }
+size_t menu_entries_get_size(void) { return NUM_ENTRIES; }
+size_t menu_entries_get_virtual_index(size_t idx) { return idx; }
+
+bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data)
+{
+   switch (state)
+   {
+      case MENU_ENTRIES_CTL_START_GET:
+         *(size_t*)data = test_start;
+         return true;
+      case MENU_ENTRIES_CTL_SET_START:
+         test_start = *(size_t*)data;
+         return true;
+      default:
+         break;
+   }
+   return false;
+}
+
+int menu_entries_get_title(char *title, size_t title_len)
+{
+   strlcpy(title, "Main Menu", title_len);
+   return 0;
+}
+
+int menu_entries_get_core_title(char *title_msg, size_t title_msg_len)
+{
+   strlcpy(title_msg, "RetroArch", title_msg_len);
+   return 0;
+}
+
+void menu_entry_init(menu_entry_t *entry)
+{
+   memset(entry, 0, sizeof(*entry));
+}
+
+/* Every 7th entry is too long for the terminal */
+void menu_entry_get(menu_entry_t *entry, size_t stack_idx,
+      size_t i, void *userdata, bool use_representation)
+{
+   if (i % 7 == 3)
+      snprintf(entry->path, sizeof(entry->path),
+            "Entry %03u has a label that is far too long to fit on a single row of the menu, even in full width layout",
+            (unsigned)i);
+   else
+      snprintf(entry->path, sizeof(entry->path), "Entry %03u", (unsigned)i);
+   snprintf(entry->value, sizeof(entry->value), "Value %u", (unsigned)i);
+}
+
+void menu_entry_get_rich_label(menu_entry_t *entry, const char **rich_label)
+{
+   *rich_label = entry->path;
+}
+
+void menu_entry_get_value(menu_entry_t *entry, const char **value)
+{
+   *value = entry->value;
+}
+
+const char *video_driver_get_ident(void) { return "gl"; }
+bool video_driver_supports_rgba(void) { return false; }
+void video_driver_monitor_reset(void) { }
+struct video_viewport *video_viewport_get_custom(void) { return &test_custom_vp; }
+
+bool video_driver_get_viewport_info(struct video_viewport *vp)
+{
+   memset(vp, 0, sizeof(*vp));
+   vp->width       = test_vp_width;
+   vp->height      = test_vp_height;
+   vp->full_width  = test_vp_width;
+   vp->full_height = test_vp_height;
+   return true;
+}
+
+void video_driver_set_texture_frame(const void *frame, bool rgb32,
+      unsigned width, unsigned height, float alpha)
+{
+   test_uploads++;
+   test_upload_width  = width;
+   test_upload_height = height;
+}
+
+/* ==============================
+ * Reference implementations
+ * ============================== */
+
+static bool glyph_pixel(unsigned symbol, unsigned i, unsigned j)
+{
+   unsigned bit = i + j * FONT_WIDTH;
+   return (bitmap_bin[FONT_OFFSET(symbol) + (bit >> 3)] & (1 << (bit & 7))) != 0;
+}
+
+static void ref_blit_line(uint16_t *data, unsigned fb_width, int x, int y,
+      const char *message, uint16_t color, uint16_t shadow_color,
+      bool shadow)
+{
+   for (; *message; message++, x += FONT_WIDTH_STRIDE)
+   {
+      unsigned i, j;
+      uint8_t symbol = (uint8_t)*message;
+
+      if (symbol >= RGUI_NUM_FONT_GLYPHS_REGULAR || symbol == ' ')
+         continue;
+
+      for (j = 0; j < FONT_HEIGHT; j++)
+      {
+         for (i = 0; i < FONT_WIDTH; i++)
+         {
+            uint16_t *p = data + ((y + j) * fb_width) + x + i;
+
+            if (!glyph_pixel(symbol, i, j))
+               continue;
+
+            p[0] = color;
+            if (shadow)
+            {
+               p[1]            = shadow_color;
+               p[fb_width]     = shadow_color;
+               p[fb_width + 1] = shadow_color;
+            }
+         }
+      }
+   }
+}
+
+static uint32_t test_rand_state = 12345;
+
+static uint32_t test_rand(void)
+{
+   test_rand_state = test_rand_state * 1103515245 + 12345;
+   return test_rand_state >> 8;
+}
+
+static void fill_noise(uint16_t *data, size_t len)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+      data[i] = (uint16_t)test_rand();
+}
+
+static void test_blit_line(rgui_t *rgui)
+{
+   unsigned w      = rgui_frame_buf.width;
+   unsigned h      = rgui_frame_buf.height;
+   size_t size     = w * h;
+   uint16_t *ref   = (uint16_t*)malloc(size * sizeof(uint16_t));
+   int pass;
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      char line[40];
+      unsigned c, row;
+      bool shadow = (pass == 1);
+      void (*fn)(rgui_t*, unsigned, int, int, const char*,
+            uint16_t, uint16_t) = shadow
+         ? blit_line_regular_shadow : blit_line_regular;
+
+      fill_noise(rgui_frame_buf.data, size);
+      memcpy(ref, rgui_frame_buf.data, size * sizeof(uint16_t));
+
+      /* All glyphs, a row of 32 at a time */
+      for (c = 1, row = 0; c < RGUI_NUM_FONT_GLYPHS_REGULAR; row++)
+      {
+         unsigned n;
+         for (n = 0; n < 32 && c < RGUI_NUM_FONT_GLYPHS_REGULAR; n++, c++)
+            line[n] = (char)c;
+         line[n] = '\0';
+
+         fn(rgui, w, 3 + row, 3 + row * FONT_HEIGHT_STRIDE,
+               line, 0x1234, 0x5678);
+         ref_blit_line(ref, w, 3 + row, 3 + row * FONT_HEIGHT_STRIDE,
+               line, 0x1234, 0x5678, shadow);
+      }
+
+      /* Bottom right corner - last glyph can't use wide writes */
+      fn(rgui, w, w - 3 * FONT_WIDTH_STRIDE, h - FONT_HEIGHT_STRIDE,
+            "#@W", 0x4321, 0x8765);
+      ref_blit_line(ref, w, w - 3 * FONT_WIDTH_STRIDE, h - FONT_HEIGHT_STRIDE,
+            "#@W", 0x4321, 0x8765, shadow);
+
+      check(!memcmp(ref, rgui_frame_buf.data, size * sizeof(uint16_t)),
+            shadow ? "blit_line_shadow" : "blit_line",
+            "matches per-pixel blit");
+   }
+
+   free(ref);
+}
+
+static void test_fill_rect(void)
+{
+   unsigned w    = rgui_frame_buf.width;
+   unsigned h    = rgui_frame_buf.height;
+   bool match    = true;
+   unsigned n;
+
+   for (n = 0; n < 300 && match; n++)
+   {
+      unsigned rx    = test_rand() % (w + 8);
+      unsigned ry    = test_rand() % (h + 8);
+      unsigned rw    = test_rand() % w;
+      unsigned rh    = test_rand() % h;
+      uint16_t dark  = (uint16_t)test_rand();
+      uint16_t light = (n % 3 == 0) ? dark : (uint16_t)test_rand();
+      bool thick     = (n & 1) != 0;
+      unsigned x, y;
+
+      fill_noise(rgui_frame_buf.data, w * h);
+      memcpy(rgui_background_buf.data, rgui_frame_buf.data,
+            w * h * sizeof(uint16_t));
+
+      rgui_fill_rect(rgui_frame_buf.data, w, h, rx, ry, rw, rh,
+            dark, light, thick);
+
+      for (y = 0; y < h; y++)
+      {
+         for (x = 0; x < w; x++)
+         {
+            uint16_t expected = rgui_background_buf.data[y * w + x];
+
+            if (x >= rx && x < rx + rw && y >= ry && y < ry + rh)
+            {
+               bool odd = thick
+                  ? (((x >> 1) ^ (y >> 1)) & 1)
+                  : ((x ^ y) & 1);
+               expected = odd ? light : dark;
+            }
+
+            if (rgui_frame_buf.data[y * w + x] != expected)
+               match = false;
+         }
+      }
+   }
+
+   check(match, "fill_rect", "matches per-pixel fill");
+}
+
+/* ==============================
+ * Frame driving
+ * ============================== */
+
+static void run_frame(rgui_t *rgui, bool pending)
+{
+   video_frame_info_t video_info;
+
+   memset(&video_info, 0, sizeof(video_info));
+   video_info.width    = test_vp_width;
+   video_info.height   = test_vp_height;
+
+   test_update_pending = pending;
+   test_time          += 16666;
+
+   rgui_frame(rgui, &video_info);
+   rgui_render(rgui, test_vp_width, test_vp_height, false);
+   rgui_set_texture();
+}
+
+static void navigate(rgui_t *rgui, size_t selection)
+{
+   test_selection = selection;
+   rgui_navigation_set(rgui, true);
+}
+
+static bool upscale_matches(void)
+{
+   unsigned out_w = rgui_upscale_buf.width;
+   unsigned out_h = rgui_upscale_buf.height;
+   unsigned fb_w  = rgui_frame_buf.width;
+   unsigned fb_h  = rgui_frame_buf.height;
+   uint32_t x_ratio = (fb_w << 16) / out_w;
+   uint32_t y_ratio = (fb_h << 16) / out_h;
+   unsigned x, y;
+
+   for (y = 0; y < out_h; y++)
+      for (x = 0; x < out_w; x++)
+         if (rgui_upscale_buf.data[y * out_w + x] !=
+             rgui_frame_buf.data[((y * y_ratio) >> 16) * fb_w
+                                 + ((x * x_ratio) >> 16)])
+            return false;
+   return true;
+}
+
+static void test_uploads_skipped(rgui_t *rgui)
+{
+   unsigned uploads;
+   char msg[128];
+
+   test_settings->uints.menu_rgui_internal_upscale_level = RGUI_UPSCALE_NONE;
+   rgui->force_redraw = true;
+   run_frame(rgui, true);
+
+   uploads = test_uploads;
+   run_frame(rgui, true);
+   run_frame(rgui, true);
+   check(test_uploads == uploads, "upload",
+         "identical redraws are not uploaded");
+
+   navigate(rgui, 5);
+   run_frame(rgui, true);
+   check(test_uploads == uploads + 1, "upload",
+         "navigation uploads a new frame");
+
+   rgui_context_reset(rgui, false);
+   rgui->force_redraw = true;
+   run_frame(rgui, true);
+   check(test_uploads == uploads + 2, "upload",
+         "context reset forces an upload");
+
+   /* Upscaled: partial updates must match a full rescale */
+   test_settings->uints.menu_rgui_internal_upscale_level = RGUI_UPSCALE_X2;
+   rgui->force_redraw = true;
+   run_frame(rgui, true);
+   snprintf(msg, sizeof(msg), "upscaled texture is %ux%u",
+         test_upload_width, test_upload_height);
+   check(test_upload_width == rgui_frame_buf.width * 2
+         && test_upload_height == rgui_frame_buf.height * 2,
+         "upscale", msg);
+
+   navigate(rgui, 6);
+   run_frame(rgui, true);
+   navigate(rgui, 30);
+   run_frame(rgui, true);
+   for (test_ticker_idx = 0; test_ticker_idx < 10; test_ticker_idx++)
+   {
+      navigate(rgui, 3);
+      run_frame(rgui, true);
+   }
+   check(upscale_matches(), "upscale",
+         "partial updates match a full rescale");
+
+   run_frame(rgui, true);
+   uploads = test_uploads;
+   run_frame(rgui, true);
+   check(test_uploads == uploads, "upscale",
+         "identical redraws are not uploaded");
+
+   test_settings->uints.menu_rgui_internal_upscale_level = RGUI_UPSCALE_NONE;
+   rgui->force_redraw = true;
+   run_frame(rgui, true);
+   check(test_upload_width == rgui_frame_buf.width,
+         "upscale", "disabling upscaling uploads the native frame");
+}
+
+static void bench(rgui_t *rgui, const char *name, unsigned frames,
+      int mode)
+{
+   unsigned i;
+   unsigned uploads = test_uploads;
+   clock_t start;
+   double us;
+
+   navigate(rgui, 0);
+   rgui->force_redraw = true;
+   run_frame(rgui, true);
+   uploads = test_uploads;
+
+   start = clock();
+   for (i = 0; i < frames; i++)
+   {
+      switch (mode)
+      {
+         case 0: /* Scroll through the list */
+            navigate(rgui, (i + 1) % NUM_ENTRIES);
+            run_frame(rgui, true);
+            break;
+         case 1: /* Long label selected, ticker scrolling */
+            if (i == 0)
+               navigate(rgui, 10);
+            test_ticker_idx = i / 4;
+            run_frame(rgui, true);
+            break;
+         case 2: /* Redraw requested, nothing changes */
+            run_frame(rgui, true);
+            break;
+         default: /* Idle */
+            run_frame(rgui, false);
+            break;
+      }
+   }
+   us = (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+
+   printf("  %-28s %8.2f us/frame CPU, %5.3f uploads/frame\n",
+         name, us / frames, (double)(test_uploads - uploads) / frames);
+}
+
+int main(int argc, char *argv[])
+{
+   static const char *mode_names[] = {
+      "navigation", "ticker", "redraw, unchanged", "idle"
+   };
+   unsigned frames  = (argc > 1) ? (unsigned)strtoul(argv[1], NULL, 10) : 2000;
+   menu_handle_t *menu;
+   rgui_t *rgui     = NULL;
+   int up, mode;
+
+   test_settings = (settings_t*)calloc(1, sizeof(settings_t));
+   test_settings->uints.menu_rgui_color_theme  = RGUI_THEME_CLASSIC_GREEN;
+   test_settings->uints.menu_rgui_aspect_ratio = RGUI_ASPECT_RATIO_16_9;
+   test_settings->bools.menu_rgui_shadows      = true;
+   test_settings->bools.menu_rgui_border_filler_enable = true;
+
+   menu = (menu_handle_t*)rgui_init((void**)&rgui, false);
+   if (!menu || !rgui)
+   {
+      printf("[ERROR] rgui_init failed\n");
+      return 1;
+   }
+
+   test_blit_line(rgui);
+   test_fill_rect();
+   test_uploads_skipped(rgui);
+
+   printf("%ux%u framebuffer, %u entries, %u frames per run:\n",
+         rgui_frame_buf.width, rgui_frame_buf.height, NUM_ENTRIES, frames);
+
+   for (up = 0; up < 2; up++)
+   {
+      test_settings->uints.menu_rgui_internal_upscale_level =
+         up ? RGUI_UPSCALE_X2 : RGUI_UPSCALE_NONE;
+      printf(" upscaling %s\n", up ? "x2" : "off");
+
+      for (mode = 0; mode < 4; mode++)
+         bench(rgui, mode_names[mode], frames, mode);
+   }
+
+   rgui_free(rgui);
+   free(rgui);
+   free(menu);
+   free(test_settings);
+
+   return failures ? 1 : 0;
+}
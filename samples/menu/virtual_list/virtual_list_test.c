@@ -0,0 +1,483 @@
+/* Checks the window of long menu lists (menu/menu_virtual_list.c).
+ *
+ *   virtual_list_test
+ *      Builds lists of up to ten million entries from a synthetic
+ *      source, the way menu_displaylist_parse_playlist() does, and
+ *      checks that:
+ *      - only the window is built, whatever the size of the list,
+ *        and building it takes the same time;
+ *      - walking the whole list keeps every selected entry in the
+ *        window, mapped to the right list index;
+ *      - the window is kept when a list is built again, e.g. when
+ *        returning from the quick menu, and not otherwise;
+ *      - searching finds entries outside of the window;
+ *      - alphabet jumps go from letter to letter over the whole
+ *        list, not only over the window.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <lists/file_list.h>
+
+#include "../../../menu/menu_virtual_list.h"
+
+#define SEARCH_MID_IDX     1234
+#define SEARCH_PREFIX_IDX  876543
+
+typedef struct test_source
+{
+   size_t size;
+   /* Names run from 'A' to 'Z' over the list, in order */
+   bool alphabetical;
+   /* Entries added by fill(), in total */
+   size_t filled;
+} test_source_t;
+
+static unsigned failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s\n", msg);
+   else
+   {
+      printf("[ERROR]: %s\n", msg);
+      failures++;
+   }
+}
+
+static bool test_get_name(size_t idx, char *s, size_t len, void *userdata)
+{
+   test_source_t *src = (test_source_t*)userdata;
+
+   if (idx >= src->size)
+      return false;
+
+   if (src->alphabetical)
+      snprintf(s, len, "%c Game %07u",
+            'A' + (int)(idx * 26 / src->size), (unsigned)idx);
+   else if (idx == SEARCH_MID_IDX)
+      snprintf(s, len, "The Legend of Gloop");
+   else if (idx == SEARCH_PREFIX_IDX)
+      snprintf(s, len, "Gloop Racing");
+   else
+      snprintf(s, len, "Game %07u", (unsigned)idx);
+
+   return true;
+}
+
+static void test_fill(file_list_t *list,
+      size_t start, size_t count, void *userdata)
+{
+   size_t i;
+   test_source_t *src = (test_source_t*)userdata;
+
+   file_list_reserve(list, list->size + count);
+
+   for (i = start; i < start + count && i < src->size; i++)
+   {
+      char name[64];
+
+      test_get_name(i, name, sizeof(name), src);
+      file_list_append(list, name, "entry", 0, 0, i);
+      src->filled++;
+   }
+}
+
+/* Frees the entries of a file list that lives on the stack */
+static void test_list_free(file_list_t *list)
+{
+   file_list_clear(list);
+   free(list->list);
+}
+
+static void test_init(menu_virtual_list_t *vl, test_source_t *src)
+{
+   vl->fill     = test_fill;
+   vl->get_name = test_get_name;
+   vl->userdata = src;
+}
+
+/* Builds the list, as menu_entries_append_virtual() does */
+static void test_build(menu_virtual_list_t *vl, file_list_t *list,
+      uint32_t ident, size_t *selection)
+{
+   test_source_t *src = (test_source_t*)vl->userdata;
+
+   file_list_clear(list);
+   menu_virtual_list_init(vl, ident, src->size, selection);
+   menu_virtual_list_fill(vl, list, vl->offset);
+}
+
+/* Selects list index @idx, as menu_entries_virtual_select() does.
+ * Returns the window index of the selection. */
+static size_t test_select(menu_virtual_list_t *vl, file_list_t *list,
+      size_t idx, unsigned *moves)
+{
+   size_t offset;
+
+   if (menu_virtual_list_place(vl, idx, &offset))
+   {
+      file_list_clear(list);
+      menu_virtual_list_fill(vl, list, offset);
+      (*moves)++;
+   }
+
+   return idx - vl->offset;
+}
+
+/* Does window entry @sel hold list entry @idx? */
+static bool test_entry_is(const menu_virtual_list_t *vl,
+      const file_list_t *list, size_t sel, size_t idx)
+{
+   char name[64];
+
+   if (sel >= list->size)
+      return false;
+   if (menu_virtual_list_index(vl, sel) != idx)
+      return false;
+   if (list->list[sel].entry_idx != idx)
+      return false;
+
+   test_get_name(idx, name, sizeof(name), vl->userdata);
+
+   return !strcmp(list->list[sel].path, name);
+}
+
+static void test_small_list(void)
+{
+   test_source_t src;
+   menu_virtual_list_t vl;
+   file_list_t list;
+   size_t selection = 0;
+
+   memset(&vl, 0, sizeof(vl));
+   memset(&list, 0, sizeof(list));
+
+   src.size         = MENU_VIRTUAL_LIST_THRESHOLD;
+   src.filled       = 0;
+   src.alphabetical = false;
+   test_init(&vl, &src);
+
+   test_build(&vl, &list, 1, &selection);
+
+   check(!vl.active && list.size == src.size
+         && test_entry_is(&vl, &list, src.size - 1, src.size - 1),
+         "lists up to the threshold are built in full");
+
+   test_list_free(&list);
+}
+
+static void test_size_independence(void)
+{
+   static const size_t sizes[] = {
+      MENU_VIRTUAL_LIST_THRESHOLD + 1, 50000, 1000000, 10000000 };
+   size_t i;
+   size_t filled0      = 0;
+   size_t capacity0    = 0;
+   retro_time_t time0  = 0;
+   bool same_work      = true;
+   bool same_memory    = true;
+   retro_time_t max_us = 0;
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      unsigned j;
+      test_source_t src;
+      menu_virtual_list_t vl;
+      file_list_t list;
+      retro_time_t best = 0;
+
+      memset(&vl, 0, sizeof(vl));
+      memset(&list, 0, sizeof(list));
+      src.size         = sizes[i];
+      src.alphabetical = false;
+      test_init(&vl, &src);
+
+      /* Best of a few runs, to keep scheduling noise out */
+      for (j = 0; j < 5; j++)
+      {
+         size_t selection = 0;
+         retro_time_t start;
+
+         src.filled = 0;
+         start      = cpu_features_get_time_usec();
+         test_build(&vl, &list, 0, &selection);
+         start      = cpu_features_get_time_usec() - start;
+
+         if (!j || start < best)
+            best = start;
+      }
+
+      printf("  %8u entries: %u built, capacity %u, %u us\n",
+            (unsigned)sizes[i], (unsigned)src.filled,
+            (unsigned)list.capacity, (unsigned)best);
+
+      if (!i)
+      {
+         filled0   = src.filled;
+         capacity0 = list.capacity;
+         time0     = best;
+      }
+      else
+      {
+         if (src.filled != filled0)
+            same_work   = false;
+         if (list.capacity != capacity0)
+            same_memory = false;
+      }
+      if (best > max_us)
+         max_us = best;
+
+      test_list_free(&list);
+   }
+
+   check(filled0 == MENU_VIRTUAL_LIST_WINDOW && same_work,
+         "opening a list builds the window only, whatever its size");
+   check(same_memory,
+         "the file list takes the same memory whatever the list size");
+   /* Generous bound, the work is the same */
+   check(max_us <= time0 * 4 + 1000,
+         "opening a list takes the same time whatever its size");
+}
+
+static void test_walk(void)
+{
+   size_t idx;
+   test_source_t src;
+   menu_virtual_list_t vl;
+   file_list_t list;
+   size_t selection = 0;
+   unsigned moves   = 0;
+   bool in_window   = true;
+   bool margin      = true;
+   size_t max_size  = 0;
+
+   memset(&vl, 0, sizeof(vl));
+   memset(&list, 0, sizeof(list));
+   src.size   = 100000;
+   src.filled       = 0;
+   src.alphabetical = false;
+   test_init(&vl, &src);
+
+   test_build(&vl, &list, 1, &selection);
+
+   /* Down through the whole list, one entry at a time */
+   for (idx = 0; idx < src.size; idx++)
+   {
+      size_t sel = test_select(&vl, &list, idx, &moves);
+
+      if (!test_entry_is(&vl, &list, sel, idx))
+         in_window = false;
+      if (     (vl.offset > 0 && sel < MENU_VIRTUAL_LIST_MARGIN)
+            || (vl.offset + vl.count < src.size
+               && sel + MENU_VIRTUAL_LIST_MARGIN >= vl.count))
+         margin = false;
+      if (list.size > max_size)
+         max_size = list.size;
+   }
+
+   check(in_window, "walking down, the selection is always in the window");
+   check(margin, "walking down, the window keeps a margin around the selection");
+   check(max_size == MENU_VIRTUAL_LIST_WINDOW,
+         "walking down, the file list never grows past the window");
+   check(moves < src.size / (MENU_VIRTUAL_LIST_WINDOW / 2 - MENU_VIRTUAL_LIST_MARGIN) + 2,
+         "walking down, the window only moves every few entries");
+
+   /* Back up */
+   for (idx = src.size; idx-- > 0; )
+   {
+      size_t sel = test_select(&vl, &list, idx, &moves);
+      if (!test_entry_is(&vl, &list, sel, idx))
+         in_window = false;
+   }
+
+   check(in_window, "walking up, the selection is always in the window");
+
+   /* Jumps, as wraparound and 'last entry' do */
+   selection = test_select(&vl, &list, src.size - 1, &moves);
+   check(test_entry_is(&vl, &list, selection, src.size - 1)
+         && vl.offset + vl.count == src.size,
+         "jumping to the last entry");
+   selection = test_select(&vl, &list, 0, &moves);
+   check(test_entry_is(&vl, &list, selection, 0) && vl.offset == 0,
+         "jumping to the first entry");
+
+   test_list_free(&list);
+}
+
+static void test_rebuild(void)
+{
+   test_source_t src;
+   menu_virtual_list_t vl;
+   file_list_t list;
+   size_t selection;
+   size_t saved;
+   unsigned moves = 0;
+
+   memset(&vl, 0, sizeof(vl));
+   memset(&list, 0, sizeof(list));
+   src.size   = 20000;
+   src.filled       = 0;
+   src.alphabetical = false;
+   test_init(&vl, &src);
+
+   selection = 0;
+   test_build(&vl, &list, 1, &selection);
+   saved     = test_select(&vl, &list, 12345, &moves);
+
+   /* Quick menu and back: the menu stack restores the saved
+    * window index, and the same list is built again */
+   selection = saved;
+   test_build(&vl, &list, 1, &selection);
+   check(test_entry_is(&vl, &list, selection, 12345),
+         "the window is kept when the same list is built again");
+
+   /* Last entries removed from under the window */
+   src.size  = 12400;
+   selection = test_select(&vl, &list, 12345, &moves);
+   test_build(&vl, &list, 1, &selection);
+   check(test_entry_is(&vl, &list, selection, 12345)
+         && vl.offset + vl.count <= src.size,
+         "the window follows the list when entries are removed");
+
+   /* Another list at the same depth */
+   selection = 0;
+   test_build(&vl, &list, 2, &selection);
+   check(test_entry_is(&vl, &list, selection, 0),
+         "another list starts at the top");
+
+   /* Same list opened again */
+   selection = test_select(&vl, &list, 9000, &moves);
+   menu_virtual_list_forget(&vl);
+   selection = 0;
+   test_build(&vl, &list, 2, &selection);
+   check(test_entry_is(&vl, &list, selection, 0),
+         "a list opened again starts at the top");
+
+   test_list_free(&list);
+}
+
+static void test_search(void)
+{
+   test_source_t src;
+   menu_virtual_list_t vl;
+   file_list_t list;
+   size_t selection = 0;
+   size_t idx       = 0;
+   unsigned moves   = 0;
+
+   memset(&vl, 0, sizeof(vl));
+   memset(&list, 0, sizeof(list));
+   src.size   = 1000000;
+   src.filled       = 0;
+   src.alphabetical = false;
+   test_init(&vl, &src);
+
+   test_build(&vl, &list, 1, &selection);
+
+   check(menu_virtual_list_search(&vl, "gloop", &idx)
+         && idx == SEARCH_PREFIX_IDX,
+         "search finds entries outside of the window, prefix first");
+   check(menu_virtual_list_search(&vl, "legend", &idx)
+         && idx == SEARCH_MID_IDX,
+         "search falls back to a match inside the name");
+   check(!menu_virtual_list_search(&vl, "nothing like it", &idx),
+         "search without a match");
+
+   selection = test_select(&vl, &list, SEARCH_PREFIX_IDX, &moves);
+   check(test_entry_is(&vl, &list, selection, SEARCH_PREFIX_IDX),
+         "the match found is selected");
+
+   test_list_free(&list);
+}
+
+/* First list index of letter @c in the alphabetical source */
+static size_t test_letter_start(const test_source_t *src, char c)
+{
+   return ((c - 'A') * src->size + 25) / 26;
+}
+
+static void test_alphabet(void)
+{
+   size_t i;
+   size_t indices[64];
+   size_t count;
+   test_source_t src;
+   menu_virtual_list_t vl;
+   file_list_t list;
+   size_t selection = 0;
+   size_t idx       = 0;
+   unsigned moves   = 0;
+   unsigned jumps   = 0;
+   bool letters     = true;
+   bool in_window   = true;
+
+   memset(&vl, 0, sizeof(vl));
+   memset(&list, 0, sizeof(list));
+   src.size         = 100000;
+   src.filled       = 0;
+   src.alphabetical = true;
+   test_init(&vl, &src);
+
+   test_build(&vl, &list, 1, &selection);
+
+   /* First entry, one per letter after 'A', last entry */
+   count = menu_virtual_list_get_scroll_indices(&vl, indices,
+         sizeof(indices) / sizeof(indices[0]));
+
+   for (i = 1; i < 26 && i < count; i++)
+      if (indices[i] != test_letter_start(&src, (char)('A' + i)))
+         letters = false;
+
+   check(count == 27 && indices[0] == 0 && letters
+         && indices[26] == src.size - 1,
+         "scroll indices are list indices over the whole list");
+
+   /* Ascend through the list as MENU_NAVIGATION_CTL_ASCEND_ALPHABET
+    * does: each jump lands on the next letter, far outside the window
+    * the jump started from */
+   while (idx != src.size - 1 && jumps < 64)
+   {
+      size_t j = 0;
+
+      while (j < count - 1 && indices[j + 1] <= idx)
+         j++;
+      idx       = indices[j + 1];
+      selection = test_select(&vl, &list, idx, &moves);
+
+      if (!test_entry_is(&vl, &list, selection, idx))
+         in_window = false;
+      jumps++;
+   }
+
+   check(jumps == 26 && in_window,
+         "ascending goes one letter per jump to the end of the list");
+
+   check(menu_virtual_list_get_scroll_indices(&vl, indices, 4) == 4
+         && indices[3] == test_letter_start(&src, 'D'),
+         "scroll indices stop once full");
+
+   test_list_free(&list);
+}
+
+int main(int argc, char *argv[])
+{
+   test_small_list();
+   test_size_independence();
+   test_walk();
+   test_rebuild();
+   test_search();
+   test_alphabet();
+
+   if (failures)
+   {
+      printf("%u check(s) failed\n", failures);
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,549 @@
+/* Loopback comparison of netplay savestate transfers: the whole state
+ * compressed and sent at once, as older peers get it, against the chunked
+ * transfer, in full and as a delta against a state both sides share.
+ *
+ *   netplay_savestate_test
+ *      Runs the built-in scenarios and checks the results.
+ *
+ *   netplay_savestate_test <state MB> <dirty %> [seed]
+ *      Transfers a synthetic state of the given size, of which the given
+ *      share of pages changed since the shared base, and prints the
+ *      comparison.
+ *
+ * Both peers run in this process, connected over a real TCP loopback
+ * socket. Each iteration of the loop is one frame: the sender does its
+ * share of the transfer, flushes what the socket takes, and the receiver
+ * decodes whatever arrived. Chunks are encoded and decoded by
+ * netplay_savestate.c itself, with the per-frame limits netplay uses. A
+ * frame lasts 1/60s, or as long as the slower peer's work for it took, and
+ * the resync time is the sum of frames until the receiver holds the state
+ * and has verified its checksum.
+ *
+ * The synthetic state is a quarter zeroes (unused memory), a quarter
+ * repetitive data (tiles, tables) and half noisy work RAM, of which the
+ * given share of 4KB pages is touched between the base and the new state,
+ * along with a small hot region that always changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <zlib.h>
+
+#include "../../../network/netplay/netplay_savestate.h"
+
+#define FRAME_USEC        16667.0
+#define PAGE_SIZE_BYTES   4096
+#define HOT_SIZE          (16 * 1024)
+
+/* From netplay_private.h, which needs the whole frontend */
+#define NETPLAY_CMD_LOAD_SAVESTATE       0x0042
+#define NETPLAY_CMD_LOAD_SAVESTATE_DELTA 0x0048
+#define NETPLAY_CMD_SAVESTATE_CHUNK      0x0049
+#define NETPLAY_SAVESTATE_QUEUE          (256 * 1024)
+#define NETPLAY_SAVESTATE_SEND_USEC      4000
+#define NETPLAY_MAX_STALL_FRAMES         60
+
+enum mode
+{
+   MODE_LEGACY = 0,
+   MODE_FULL,
+   MODE_DELTA
+};
+
+static const char *mode_names[] = { "whole state", "chunked full", "chunked delta" };
+
+typedef struct result
+{
+   size_t bytes;
+   unsigned frames;
+   double resync_ms;
+   double sender_worst_ms;
+   double receiver_worst_ms;
+   bool ok;
+} result_t;
+
+typedef struct queue
+{
+   uint8_t *data;
+   size_t head, tail, cap;
+} queue_t;
+
+static unsigned failures = 0;
+
+/* libretro-common's implementation pulls in the file streams; the
+ * polynomial is the same as zlib's */
+uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   return (uint32_t)crc32(crc, buf, (uInt)len);
+}
+
+static void check(bool cond, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s\n", msg);
+   else
+   {
+      printf("[ERROR]: %s\n", msg);
+      failures++;
+   }
+}
+
+/* Simple deterministic LCG so the runs are reproducible */
+static unsigned lcg(unsigned *state)
+{
+   *state = *state * 1103515245u + 12345u;
+   return (*state >> 16) & 0x7fff;
+}
+
+static double now_usec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static void make_state(uint8_t *state, size_t size, unsigned *seed)
+{
+   size_t i;
+   size_t zero_end = size / 4;
+   size_t rep_end  = size / 2;
+
+   memset(state, 0, zero_end);
+   for (i = zero_end; i < rep_end; i++)
+      state[i] = (uint8_t)((i & 63) * 7 + ((i >> 12) & 3));
+   for (i = rep_end; i < size; i++)
+      state[i] = (uint8_t)(lcg(seed) & 0x3f);
+}
+
+static void advance_state(uint8_t *state, size_t size, double dirty,
+      unsigned *seed)
+{
+   size_t page;
+   size_t i;
+   size_t ram   = size / 2;
+   size_t pages = (size - ram) / PAGE_SIZE_BYTES;
+
+   for (page = 0; page < pages; page++)
+   {
+      uint8_t *p = state + ram + page * PAGE_SIZE_BYTES;
+      if ((double)lcg(seed) / 32768.0 * 100.0 >= dirty)
+         continue;
+      for (i = 0; i < 256; i++)
+         p[lcg(seed) % PAGE_SIZE_BYTES] = (uint8_t)lcg(seed);
+   }
+
+   for (i = ram; i < ram + HOT_SIZE && i < size; i++)
+      state[i] = (uint8_t)lcg(seed);
+}
+
+static bool loopback_pair(int *out_send, int *out_recv)
+{
+   struct sockaddr_in addr;
+   socklen_t len = sizeof(addr);
+   int flag      = 1;
+   int lfd       = socket(AF_INET, SOCK_STREAM, 0);
+   int sfd       = socket(AF_INET, SOCK_STREAM, 0);
+   int rfd;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (lfd < 0 || sfd < 0 ||
+         bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         listen(lfd, 1) < 0 ||
+         getsockname(lfd, (struct sockaddr*)&addr, &len) < 0 ||
+         connect(sfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         (rfd = accept(lfd, NULL, NULL)) < 0)
+      return false;
+
+   close(lfd);
+   fcntl(sfd, F_SETFL, fcntl(sfd, F_GETFL) | O_NONBLOCK);
+   fcntl(rfd, F_SETFL, fcntl(rfd, F_GETFL) | O_NONBLOCK);
+   setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+   *out_send = sfd;
+   *out_recv = rfd;
+   return true;
+}
+
+static void queue_push(queue_t *q, const void *data, size_t len)
+{
+   if (q->tail + len > q->cap)
+   {
+      memmove(q->data, q->data + q->head, q->tail - q->head);
+      q->tail -= q->head;
+      q->head  = 0;
+   }
+   memcpy(q->data + q->tail, data, len);
+   q->tail += len;
+}
+
+static void queue_cmd(queue_t *q, uint32_t cmd, const void *payload,
+      size_t len)
+{
+   uint32_t header[2];
+   header[0] = htonl(cmd);
+   header[1] = htonl((uint32_t)len);
+   queue_push(q, header, sizeof(header));
+   queue_push(q, payload, len);
+}
+
+static size_t queue_flush(queue_t *q, int fd)
+{
+   size_t sent = 0;
+   while (q->head < q->tail)
+   {
+      ssize_t r = send(fd, q->data + q->head, q->tail - q->head, 0);
+      if (r <= 0)
+         break;
+      q->head += (size_t)r;
+      sent    += (size_t)r;
+   }
+   if (q->head == q->tail)
+      q->head = q->tail = 0;
+   return sent;
+}
+
+typedef struct peer_recv
+{
+   queue_t in;
+   uint8_t *state;
+   size_t size;
+   uint8_t *scratch;
+   void *stream;
+   uint32_t chunks_left;
+   uint32_t crc;
+   bool started;
+   bool done;
+   bool ok;
+} peer_recv_t;
+
+/* Handle every complete command the receiver has, as netplay_get_cmd does */
+static void receive(peer_recv_t *r, int fd, const uint8_t *base,
+      const struct trans_stream_backend *inflate)
+{
+   for (;;)
+   {
+      ssize_t got;
+      if (r->in.tail == r->in.cap)
+      {
+         memmove(r->in.data, r->in.data + r->in.head, r->in.tail - r->in.head);
+         r->in.tail -= r->in.head;
+         r->in.head  = 0;
+      }
+      got = recv(fd, r->in.data + r->in.tail, r->in.cap - r->in.tail, 0);
+      if (got <= 0)
+         break;
+      r->in.tail += (size_t)got;
+   }
+
+   while (!r->done && r->in.tail - r->in.head >= 2 * sizeof(uint32_t))
+   {
+      uint32_t header[2], cmd, len;
+      const uint8_t *payload;
+
+      memcpy(header, r->in.data + r->in.head, sizeof(header));
+      cmd = ntohl(header[0]);
+      len = ntohl(header[1]);
+      if (r->in.tail - r->in.head < sizeof(header) + len)
+         break;
+      payload     = r->in.data + r->in.head + sizeof(header);
+      r->in.head += sizeof(header) + len;
+
+      if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+      {
+         /* The old way: frame, size, then the whole state compressed */
+         uLongf out = (uLongf)r->size;
+         r->done    = true;
+         r->ok      = uncompress(r->state, &out, payload + 8, len - 8) == Z_OK &&
+            out == r->size && crc32(0, r->state, (uInt)r->size) == r->crc;
+      }
+      else if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+      {
+         uint32_t words[6];
+         memcpy(words, payload, sizeof(words));
+         if (ntohl(words[2]) == NETPLAY_SAVESTATE_NO_BASE)
+            memset(r->state, 0, r->size);
+         else
+            memcpy(r->state, base, r->size);
+         r->crc         = ntohl(words[4]);
+         r->chunks_left = ntohl(words[5]);
+         r->started     = true;
+      }
+      else if (cmd == NETPLAY_CMD_SAVESTATE_CHUNK && r->started)
+      {
+         if (!netplay_savestate_decode_chunk(r->state, r->size, payload, len,
+                  inflate, &r->stream, r->scratch))
+         {
+            r->done = true;
+            r->ok   = false;
+         }
+         else
+            r->chunks_left--;
+      }
+
+      if (r->started && !r->done && !r->chunks_left)
+      {
+         r->done = true;
+         r->ok   = crc32(0, r->state, (uInt)r->size) == r->crc;
+      }
+   }
+}
+
+static void transfer(enum mode mode, const uint8_t *base,
+      const uint8_t *state, size_t size, result_t *res)
+{
+   int sfd, rfd;
+   peer_recv_t r;
+   queue_t out;
+   uint8_t *chunk;
+   netplay_savestate_source_t *src = NULL;
+   void *deflate_stream            = NULL;
+   uint32_t next                   = 0;
+   size_t bufsz                    = 2 * size + NETPLAY_MAX_STALL_FRAMES * 16;
+   size_t queue_max                = bufsz / 4 < NETPLAY_SAVESTATE_QUEUE
+      ? bufsz / 4 : NETPLAY_SAVESTATE_QUEUE;
+   const struct trans_stream_backend *deflate = trans_stream_get_zlib_deflate_backend();
+   const struct trans_stream_backend *inflate = trans_stream_get_zlib_inflate_backend();
+
+   memset(res, 0, sizeof(*res));
+   memset(&r, 0, sizeof(r));
+   memset(&out, 0, sizeof(out));
+
+   if (!loopback_pair(&sfd, &rfd))
+   {
+      printf("[ERROR]: Could not set up a loopback connection\n");
+      failures++;
+      return;
+   }
+
+   out.cap    = bufsz + NETPLAY_SAVESTATE_CHUNK_BOUND + 64;
+   out.data   = (uint8_t*)malloc(out.cap);
+   r.in.cap   = out.cap;
+   r.in.data  = (uint8_t*)malloc(r.in.cap);
+   r.size     = size;
+   r.state    = (uint8_t*)malloc(size);
+   r.scratch  = (uint8_t*)malloc(NETPLAY_SAVESTATE_CHUNK_SIZE);
+   r.crc      = crc32(0, state, (uInt)size);
+   chunk      = (uint8_t*)malloc(NETPLAY_SAVESTATE_CHUNK_BOUND);
+
+   while (!r.done)
+   {
+      double start = now_usec();
+      double sender_work, receiver_work, frame;
+
+      if (res->frames == 0)
+      {
+         if (mode == MODE_LEGACY)
+         {
+            /* As netplay_send_savestate: compress it all, then queue it */
+            uint32_t words[2];
+            uint8_t *z  = (uint8_t*)malloc(2 * size + 16);
+            uLongf zlen = (uLongf)(2 * size);
+            compress2(z + 8, &zlen, state, (uLong)size, 9);
+            words[0]    = htonl(0);
+            words[1]    = htonl((uint32_t)size);
+            memcpy(z, words, sizeof(words));
+            queue_cmd(&out, NETPLAY_CMD_LOAD_SAVESTATE, z, zlen + 8);
+            free(z);
+         }
+         else
+         {
+            uint32_t words[6];
+            src = netplay_savestate_source_new(state,
+                  mode == MODE_DELTA ? base : NULL, size);
+            src->frame = 1;
+            if (mode == MODE_DELTA)
+               src->base_frame = 0;
+            words[0] = htonl(src->frame);
+            words[1] = htonl((uint32_t)size);
+            words[2] = htonl(src->base_frame);
+            words[3] = htonl(src->base_crc);
+            words[4] = htonl(src->crc);
+            words[5] = htonl(src->chunk_count);
+            queue_cmd(&out, NETPLAY_CMD_LOAD_SAVESTATE_DELTA,
+                  words, sizeof(words));
+         }
+      }
+
+      /* As netplay_send_savestate_chunks */
+      if (src)
+      {
+         double pump = now_usec();
+         while (next < src->chunk_count)
+         {
+            size_t len;
+            if (out.tail - out.head >= queue_max)
+            {
+               res->bytes += queue_flush(&out, sfd);
+               if (out.tail - out.head >= queue_max)
+                  break;
+            }
+            len = netplay_savestate_encode_chunk(src, next, deflate,
+                  &deflate_stream, chunk, NETPLAY_SAVESTATE_CHUNK_BOUND);
+            if (!len)
+               break;
+            queue_cmd(&out, NETPLAY_CMD_SAVESTATE_CHUNK, chunk, len);
+            next++;
+            if (now_usec() - pump >= NETPLAY_SAVESTATE_SEND_USEC)
+               break;
+         }
+      }
+
+      res->bytes   += queue_flush(&out, sfd);
+      sender_work   = now_usec() - start;
+
+      start         = now_usec();
+      receive(&r, rfd, base, inflate);
+      receiver_work = now_usec() - start;
+
+      frame = sender_work > receiver_work ? sender_work : receiver_work;
+      if (sender_work / 1000.0 > res->sender_worst_ms)
+         res->sender_worst_ms = sender_work / 1000.0;
+      if (receiver_work / 1000.0 > res->receiver_worst_ms)
+         res->receiver_worst_ms = receiver_work / 1000.0;
+      res->resync_ms += (frame > FRAME_USEC ? frame : FRAME_USEC) / 1000.0;
+      res->frames++;
+
+      /* Something went very wrong */
+      if (res->frames > 100000)
+         break;
+   }
+
+   res->ok = r.done && r.ok;
+
+   netplay_savestate_source_free(src);
+   if (deflate_stream)
+      deflate->stream_free(deflate_stream);
+   if (r.stream)
+      inflate->stream_free(r.stream);
+   free(out.data);
+   free(r.in.data);
+   free(r.state);
+   free(r.scratch);
+   free(chunk);
+   close(sfd);
+   close(rfd);
+}
+
+static void print_result(enum mode mode, const result_t *res)
+{
+   printf("%-14s %10u bytes, %4u frames, resync %8.1f ms, "
+         "worst frame: sender %7.1f ms, receiver %6.1f ms%s\n",
+         mode_names[mode], (unsigned)res->bytes, res->frames, res->resync_ms,
+         res->sender_worst_ms, res->receiver_worst_ms,
+         res->ok ? "" : " (FAILED)");
+}
+
+static void compare(size_t size, double dirty, unsigned seed,
+      result_t *res)
+{
+   unsigned i;
+   uint8_t *base  = (uint8_t*)malloc(size);
+   uint8_t *state = (uint8_t*)malloc(size);
+
+   make_state(base, size, &seed);
+   memcpy(state, base, size);
+   advance_state(state, size, dirty, &seed);
+
+   printf("%u KB state, %.1f%% of pages changed:\n",
+         (unsigned)(size / 1024), dirty);
+   for (i = MODE_LEGACY; i <= MODE_DELTA; i++)
+   {
+      transfer((enum mode)i, base, state, size, &res[i]);
+      print_result((enum mode)i, &res[i]);
+   }
+
+   free(base);
+   free(state);
+}
+
+static void selftest(void)
+{
+   result_t res[3];
+   uint8_t state[1000];
+   uint8_t chunk[NETPLAY_SAVESTATE_CHUNK_BOUND];
+   uint8_t scratch[NETPLAY_SAVESTATE_CHUNK_SIZE];
+   uint8_t out[1000];
+   size_t len;
+   unsigned i;
+   void *deflate_stream = NULL;
+   void *inflate_stream = NULL;
+   unsigned seed        = 7;
+   netplay_savestate_source_t *src;
+   const struct trans_stream_backend *deflate = trans_stream_get_zlib_deflate_backend();
+   const struct trans_stream_backend *inflate = trans_stream_get_zlib_inflate_backend();
+
+   /* A typical state with light changes */
+   compare(16 * 1024 * 1024, 2.0, 1, res);
+   check(res[MODE_LEGACY].ok && res[MODE_FULL].ok && res[MODE_DELTA].ok,
+         "Every transfer arrives intact");
+   check(res[MODE_DELTA].bytes * 10 < res[MODE_LEGACY].bytes,
+         "A delta is a fraction of the whole state");
+   check(res[MODE_FULL].bytes < res[MODE_LEGACY].bytes * 11 / 10,
+         "Chunking costs little compression");
+
+   /* Heavy changes still beat sending it all */
+   compare(4 * 1024 * 1024 + 123, 50.0, 2, res);
+   check(res[MODE_FULL].ok && res[MODE_DELTA].ok,
+         "States that aren't a multiple of the chunk size arrive intact");
+   check(res[MODE_DELTA].bytes < res[MODE_FULL].bytes,
+         "Even a heavily changed state is smaller as a delta");
+
+   /* Nothing changed: nothing to send */
+   for (i = 0; i < sizeof(state); i++)
+      state[i] = (uint8_t)lcg(&seed);
+   src = netplay_savestate_source_new(state, state, sizeof(state));
+   check(src && src->chunk_count == 0, "An unchanged state needs no chunks");
+   netplay_savestate_source_free(src);
+
+   /* A damaged chunk is refused rather than applied */
+   src = netplay_savestate_source_new(state, NULL, sizeof(state));
+   len = netplay_savestate_encode_chunk(src, 0, deflate, &deflate_stream,
+         chunk, sizeof(chunk));
+   memset(out, 0, sizeof(out));
+   check(len && netplay_savestate_decode_chunk(out, sizeof(out), chunk, len,
+            inflate, &inflate_stream, scratch) &&
+         !memcmp(out, state, sizeof(out)),
+         "A small state round-trips");
+   chunk[len / 2] ^= 0x55;
+   check(!netplay_savestate_decode_chunk(out, sizeof(out), chunk, len,
+            inflate, &inflate_stream, scratch),
+         "A corrupted chunk is rejected");
+   memset(out, 0, sizeof(out));
+   chunk[len / 2] ^= 0x55;
+   check(netplay_savestate_decode_chunk(out, sizeof(out), chunk, len,
+            inflate, &inflate_stream, scratch) &&
+         !memcmp(out, state, sizeof(out)),
+         "The decoder recovers after a bad chunk");
+   netplay_savestate_source_free(src);
+
+   deflate->stream_free(deflate_stream);
+   inflate->stream_free(inflate_stream);
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc >= 3)
+   {
+      result_t res[3];
+      compare((size_t)(atof(argv[1]) * 1024 * 1024), atof(argv[2]),
+            argc >= 4 ? (unsigned)atoi(argv[3]) : 1, res);
+      return (res[0].ok && res[1].ok && res[2].ok) ? 0 : 1;
+   }
+
+   selftest();
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,627 @@
+/* Loopback benchmark of a netplay host sending its input stream to many
+ * spectators: each frame's input encoded again for every connection, as the
+ * host used to, against encoding it once and copying the bytes, and against
+ * sending it once to a spectator that relays it to the rest.
+ *
+ *   netplay_spectators_test
+ *      Runs 1, 8 and 32 spectators in each mode and checks the results.
+ *
+ *   netplay_spectators_test <spectators> [frames]
+ *      Runs the given number of spectators only.
+ *
+ * Everything runs in this process over real TCP loopback sockets, with the
+ * host's side of each connection going through netplay_buf.c just as in
+ * netplay. The host runs a frame about every millisecond: it takes its input
+ * and that of the other players, and sends the frame's commands. The host
+ * frame time is how long that send took. A relay, when there is one, runs in
+ * its own thread and forwards each whole command as it came in, through
+ * netplay_recv_unflushed, as netplay_io.c does. The spectators are drained
+ * by another thread, which checks every one of them got the same stream.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../../../network/netplay/netplay_private.h"
+
+#define MAX_SPECTATORS   32
+#define PLAYERS          4
+#define DEVICE_WORDS     3
+#define DEFAULT_FRAMES   3000
+#define FRAME_SLEEP_USEC 1000
+#define PACKET_BUFFER    (64 * 1024)
+
+enum mode
+{
+   MODE_PER_CONNECTION = 0,
+   MODE_BROADCAST,
+   MODE_RELAY
+};
+
+static const char *mode_names[] = { "per connection", "broadcast", "relay" };
+
+/* Just enough of a delta frame to encode input the way netplay does */
+struct input_state
+{
+   struct input_state *next;
+   uint32_t client_num;
+   bool used;
+   uint32_t size;
+   uint32_t data[DEVICE_WORDS];
+};
+
+struct frame
+{
+   uint32_t frame;
+   struct input_state *real_input[MAX_INPUT_DEVICES];
+   struct input_state states[PLAYERS];
+};
+
+typedef struct conn
+{
+   int fd;
+   struct socket_buffer sbuf;
+} conn_t;
+
+typedef struct sink
+{
+   int fd;
+   uint64_t bytes;
+   uint32_t hash;
+} sink_t;
+
+typedef struct run
+{
+   enum mode mode;
+   unsigned spectators;
+   unsigned frames;
+
+   /* Host side */
+   conn_t host[MAX_SPECTATORS];
+   unsigned host_conns;
+
+   /* Relay side: upstream, and the connections to the spectators */
+   int relay_in;
+   struct socket_buffer relay_in_buf;
+   conn_t relay[MAX_SPECTATORS];
+   volatile int relay_done;
+   double relay_busy_usec;
+   uint64_t relay_bytes;
+
+   /* Spectators */
+   sink_t sinks[MAX_SPECTATORS];
+   uint64_t expected_bytes;
+   bool failed;
+} run_t;
+
+typedef struct result
+{
+   double frame_avg_usec;
+   double frame_max_usec;
+   uint64_t host_bytes;
+   double relay_avg_usec;
+   uint64_t relay_bytes;
+   uint32_t hash;
+   uint64_t stream_bytes;
+   bool ok;
+} result_t;
+
+static uint32_t client_devices[MAX_CLIENTS];
+
+static double now_usec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const unsigned char *data, size_t len)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      hash ^= data[i];
+      hash *= 16777619U;
+   }
+   return hash;
+}
+
+/* A connected pair of loopback sockets, both nonblocking */
+static bool socket_pair(int *a, int *b)
+{
+   struct sockaddr_in addr;
+   socklen_t addr_len = sizeof(addr);
+   int flag           = 1;
+   int listen_fd      = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (listen_fd < 0)
+      return false;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+       listen(listen_fd, 1) < 0 ||
+       getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len) < 0)
+   {
+      close(listen_fd);
+      return false;
+   }
+
+   *a = socket(AF_INET, SOCK_STREAM, 0);
+   if (*a < 0 || connect(*a, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      close(listen_fd);
+      return false;
+   }
+   *b = accept(listen_fd, NULL, NULL);
+   close(listen_fd);
+   if (*b < 0)
+      return false;
+
+   setsockopt(*a, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+   setsockopt(*b, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+   fcntl(*a, F_SETFL, fcntl(*a, F_GETFL) | O_NONBLOCK);
+   fcntl(*b, F_SETFL, fcntl(*b, F_GETFL) | O_NONBLOCK);
+   return true;
+}
+
+/* Each player has one device, which they alone are on */
+static void frame_fill(struct frame *dframe, uint32_t frame)
+{
+   unsigned p, w;
+
+   memset(dframe, 0, sizeof(*dframe));
+   dframe->frame = frame;
+   for (p = 0; p < PLAYERS; p++)
+   {
+      struct input_state *istate = &dframe->states[p];
+      istate->client_num = p;
+      istate->used       = true;
+      istate->size       = DEVICE_WORDS;
+      for (w = 0; w < DEVICE_WORDS; w++)
+         istate->data[w] = (frame * 2654435761U) ^ (p << 8) ^ w;
+      dframe->real_input[p] = istate;
+   }
+}
+
+/* As netplay_encode_input in netplay_io.c */
+static size_t encode_input(struct frame *dframe, uint32_t client_num,
+      uint32_t *buffer)
+{
+   uint32_t devices, device;
+   size_t bufused, i;
+
+   bufused   = 4;
+   buffer[0] = htonl(NETPLAY_CMD_INPUT);
+   buffer[2] = htonl(dframe->frame);
+   buffer[3] = htonl(client_num);
+
+   devices = client_devices[client_num];
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      struct input_state *istate;
+      if (!(devices & (1<<device)))
+         continue;
+      istate = dframe->real_input[device];
+      while (istate && (!istate->used || istate->client_num != client_num))
+         istate = istate->next;
+      if (!istate)
+         continue;
+      if (bufused + istate->size >= NETPLAY_BROADCAST_CMD_WORDS)
+         continue;
+      for (i = 0; i < istate->size; i++)
+         buffer[bufused+i] = htonl(istate->data[i]);
+      bufused += istate->size;
+   }
+   buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
+
+   return bufused;
+}
+
+/* One host frame: the other players' input, then the host's own */
+static bool host_frame(run_t *run, struct frame *dframe,
+      netplay_broadcast_t *bc)
+{
+   uint32_t cmd[NETPLAY_BROADCAST_CMD_WORDS];
+   unsigned i, p;
+   size_t j;
+
+   if (run->mode == MODE_PER_CONNECTION)
+   {
+      for (i = 0; i < run->host_conns; i++)
+      {
+         conn_t *conn = &run->host[i];
+         for (p = 1; p <= PLAYERS; p++)
+         {
+            uint32_t client_num = p % PLAYERS;
+            size_t words        = encode_input(dframe, client_num, cmd);
+            if (!netplay_send(&conn->sbuf, conn->fd, cmd,
+                     words * sizeof(uint32_t)))
+               return false;
+         }
+         if (!netplay_send_flush(&conn->sbuf, conn->fd, false))
+            return false;
+      }
+      return true;
+   }
+
+   netplay_broadcast_clear(bc);
+   for (p = 1; p <= PLAYERS; p++)
+   {
+      uint32_t client_num = p % PLAYERS;
+      netplay_broadcast_add(bc, client_num, cmd,
+            encode_input(dframe, client_num, cmd));
+   }
+
+   for (i = 0; i < run->host_conns; i++)
+   {
+      conn_t *conn = &run->host[i];
+      for (j = 0; j < bc->cmd_count; j++)
+      {
+         const struct netplay_broadcast_cmd *bcmd = &bc->cmds[j];
+         if (!netplay_send(&conn->sbuf, conn->fd, bc->data + bcmd->start,
+                  bcmd->words * sizeof(uint32_t)))
+            return false;
+      }
+      if (!netplay_send_flush(&conn->sbuf, conn->fd, false))
+         return false;
+   }
+   return true;
+}
+
+/* Forward whole commands from upstream to every spectator, verbatim */
+static void *relay_thread(void *data)
+{
+   run_t *run = (run_t*)data;
+   unsigned i;
+
+   while (!run->relay_done)
+   {
+      fd_set fds;
+      struct timeval tv = {0, 10000};
+      bool had_input    = false;
+      double start;
+
+      FD_ZERO(&fds);
+      FD_SET(run->relay_in, &fds);
+      if (select(run->relay_in + 1, &fds, NULL, NULL, &tv) < 0)
+         break;
+
+      start = now_usec();
+      for (;;)
+      {
+         uint32_t head[2];
+         unsigned char payload[NETPLAY_BROADCAST_CMD_WORDS * 4];
+         const unsigned char *a, *b;
+         size_t a_len, b_len;
+         ssize_t recvd = netplay_recv(&run->relay_in_buf, run->relay_in,
+               head, sizeof(head), false);
+
+         if (recvd < 0)
+         {
+            run->failed = true;
+            return NULL;
+         }
+         if (recvd < (ssize_t)sizeof(head))
+            break;
+         if (ntohl(head[1]) > sizeof(payload))
+         {
+            run->failed = true;
+            return NULL;
+         }
+         recvd = netplay_recv(&run->relay_in_buf, run->relay_in,
+               payload, ntohl(head[1]), false);
+         if (recvd < (ssize_t)ntohl(head[1]))
+            break;
+
+         run->relay_bytes += netplay_recv_unflushed(&run->relay_in_buf,
+               &a, &a_len, &b, &b_len) * run->spectators;
+         for (i = 0; i < run->spectators; i++)
+         {
+            conn_t *conn = &run->relay[i];
+            if (!netplay_send(&conn->sbuf, conn->fd, a, a_len) ||
+                (b_len && !netplay_send(&conn->sbuf, conn->fd, b, b_len)))
+            {
+               run->failed = true;
+               return NULL;
+            }
+         }
+         netplay_recv_flush(&run->relay_in_buf);
+         had_input = true;
+      }
+      netplay_recv_reset(&run->relay_in_buf);
+
+      if (had_input)
+      {
+         for (i = 0; i < run->spectators; i++)
+            if (!netplay_send_flush(&run->relay[i].sbuf, run->relay[i].fd,
+                     false))
+            {
+               run->failed = true;
+               return NULL;
+            }
+         run->relay_busy_usec += now_usec() - start;
+      }
+   }
+
+   /* Whatever is left */
+   for (i = 0; i < run->spectators; i++)
+      netplay_send_flush(&run->relay[i].sbuf, run->relay[i].fd, true);
+
+   return NULL;
+}
+
+/* Read everything every spectator gets until they have it all */
+static void *sink_thread(void *data)
+{
+   run_t *run = (run_t*)data;
+   unsigned char buf[65536];
+   double deadline = now_usec() + 60 * 1000000.0;
+
+   for (;;)
+   {
+      fd_set fds;
+      struct timeval tv = {0, 10000};
+      unsigned i, done = 0;
+      int max_fd       = 0;
+
+      FD_ZERO(&fds);
+      for (i = 0; i < run->spectators; i++)
+      {
+         if (run->sinks[i].bytes >= run->expected_bytes)
+         {
+            done++;
+            continue;
+         }
+         FD_SET(run->sinks[i].fd, &fds);
+         if (run->sinks[i].fd >= max_fd)
+            max_fd = run->sinks[i].fd + 1;
+      }
+      if (done == run->spectators || run->failed || now_usec() > deadline)
+         break;
+
+      if (select(max_fd, &fds, NULL, NULL, &tv) <= 0)
+         continue;
+
+      for (i = 0; i < run->spectators; i++)
+      {
+         sink_t *sink = &run->sinks[i];
+         ssize_t got;
+         if (!FD_ISSET(sink->fd, &fds))
+            continue;
+         while ((got = recv(sink->fd, buf, sizeof(buf), 0)) > 0)
+         {
+            sink->hash   = hash_bytes(sink->hash, buf, got);
+            sink->bytes += got;
+         }
+      }
+   }
+
+   return NULL;
+}
+
+static bool run_mode(enum mode mode, unsigned spectators, unsigned frames,
+      result_t *res)
+{
+   static run_t run;
+   struct frame dframe;
+   netplay_broadcast_t *bc = (netplay_broadcast_t*)calloc(1, sizeof(*bc));
+   pthread_t sink_tid, relay_tid;
+   double total = 0, worst = 0;
+   unsigned i, f;
+   bool ok = true;
+   size_t frame_bytes;
+
+   memset(&run, 0, sizeof(run));
+   memset(res, 0, sizeof(*res));
+   run.mode       = mode;
+   run.spectators = spectators;
+   run.frames     = frames;
+   run.host_conns = (mode == MODE_RELAY) ? 1 : spectators;
+
+   for (i = 0; i < PLAYERS; i++)
+      client_devices[i] = 1 << i;
+
+   /* Every frame carries each player's input */
+   frame_bytes        = PLAYERS * (4 + DEVICE_WORDS) * sizeof(uint32_t);
+   run.expected_bytes = (uint64_t)frame_bytes * frames;
+
+   for (i = 0; i < run.host_conns; i++)
+   {
+      int fd_out, fd_in;
+      if (!socket_pair(&fd_out, &fd_in) ||
+          !netplay_init_socket_buffer(&run.host[i].sbuf, PACKET_BUFFER))
+         return false;
+      run.host[i].fd = fd_out;
+      if (mode == MODE_RELAY)
+      {
+         run.relay_in = fd_in;
+         if (!netplay_init_socket_buffer(&run.relay_in_buf, PACKET_BUFFER))
+            return false;
+      }
+      else
+         run.sinks[i].fd = fd_in;
+   }
+
+   if (mode == MODE_RELAY)
+   {
+      for (i = 0; i < spectators; i++)
+      {
+         int fd_out, fd_in;
+         if (!socket_pair(&fd_out, &fd_in) ||
+             !netplay_init_socket_buffer(&run.relay[i].sbuf, PACKET_BUFFER))
+            return false;
+         run.relay[i].fd = fd_out;
+         run.sinks[i].fd = fd_in;
+      }
+      pthread_create(&relay_tid, NULL, relay_thread, &run);
+   }
+
+   for (i = 0; i < spectators; i++)
+      run.sinks[i].hash = 2166136261U;
+
+   pthread_create(&sink_tid, NULL, sink_thread, &run);
+
+   for (f = 0; f < frames && ok; f++)
+   {
+      double start, elapsed;
+
+      frame_fill(&dframe, f);
+      start   = now_usec();
+      ok      = host_frame(&run, &dframe, bc);
+      elapsed = now_usec() - start;
+
+      total  += elapsed;
+      if (elapsed > worst)
+         worst = elapsed;
+
+      usleep(FRAME_SLEEP_USEC);
+   }
+
+   for (i = 0; i < run.host_conns; i++)
+   {
+      if (!netplay_send_flush(&run.host[i].sbuf, run.host[i].fd, true))
+         ok = false;
+      res->host_bytes += run.host[i].sbuf.total;
+   }
+
+   if (mode == MODE_RELAY)
+   {
+      /* Let it forward the rest before it stops */
+      while (!run.failed && run.relay_in_buf.total < res->host_bytes)
+         usleep(1000);
+      run.relay_done = 1;
+      pthread_join(relay_tid, NULL);
+   }
+   pthread_join(sink_tid, NULL);
+
+   res->frame_avg_usec = total / frames;
+   res->frame_max_usec = worst;
+   res->relay_avg_usec = run.relay_busy_usec / frames;
+   res->relay_bytes    = run.relay_bytes;
+   res->hash           = run.sinks[0].hash;
+   res->stream_bytes   = run.sinks[0].bytes;
+   res->ok             = ok && !run.failed;
+
+   /* Every spectator must have had exactly the same stream */
+   for (i = 0; i < spectators; i++)
+   {
+      if (run.sinks[i].bytes != run.expected_bytes ||
+          run.sinks[i].hash  != res->hash)
+         res->ok = false;
+   }
+
+   for (i = 0; i < run.host_conns; i++)
+   {
+      close(run.host[i].fd);
+      netplay_deinit_socket_buffer(&run.host[i].sbuf);
+   }
+   if (mode == MODE_RELAY)
+   {
+      close(run.relay_in);
+      netplay_deinit_socket_buffer(&run.relay_in_buf);
+      for (i = 0; i < spectators; i++)
+      {
+         close(run.relay[i].fd);
+         netplay_deinit_socket_buffer(&run.relay[i].sbuf);
+      }
+   }
+   for (i = 0; i < spectators; i++)
+      close(run.sinks[i].fd);
+   free(bc);
+
+   return true;
+}
+
+static bool run_spectators(unsigned spectators, unsigned frames)
+{
+   result_t res[3];
+   unsigned m;
+   bool ok = true;
+
+   printf("%u spectator%s, %u frames:\n", spectators,
+         spectators == 1 ? "" : "s", frames);
+
+   for (m = MODE_PER_CONNECTION; m <= MODE_RELAY; m++)
+   {
+      if (!run_mode((enum mode)m, spectators, frames, &res[m]))
+      {
+         printf("[ERROR] Could not set up loopback sockets\n");
+         return false;
+      }
+
+      printf("   %-15s host frame %7.1f us avg %8.1f us max, "
+            "host sent %9llu bytes",
+            mode_names[m], res[m].frame_avg_usec, res[m].frame_max_usec,
+            (unsigned long long)res[m].host_bytes);
+      if (m == MODE_RELAY)
+         printf("; relay %7.1f us/frame, sent %9llu bytes",
+               res[m].relay_avg_usec, (unsigned long long)res[m].relay_bytes);
+      printf("%s\n", res[m].ok ? "" : "  <- BAD STREAM");
+
+      if (!res[m].ok)
+         ok = false;
+   }
+
+   /* The same stream whichever way it went */
+   for (m = MODE_BROADCAST; m <= MODE_RELAY; m++)
+      if (res[m].hash != res[MODE_PER_CONNECTION].hash ||
+          res[m].stream_bytes != res[MODE_PER_CONNECTION].stream_bytes)
+         ok = false;
+
+   /* With a relay, the host sends the stream once */
+   if (res[MODE_RELAY].host_bytes != res[MODE_RELAY].stream_bytes)
+      ok = false;
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   static const unsigned counts[] = { 1, 8, 32 };
+   unsigned frames = DEFAULT_FRAMES;
+   unsigned i;
+   bool ok = true;
+
+   if (argc > 1)
+   {
+      unsigned spectators = (unsigned)strtoul(argv[1], NULL, 10);
+      if (argc > 2)
+         frames = (unsigned)strtoul(argv[2], NULL, 10);
+      if (spectators < 1 || spectators > MAX_SPECTATORS || frames < 1)
+      {
+         fprintf(stderr, "Usage: %s [spectators (1-%u)] [frames]\n",
+               argv[0], MAX_SPECTATORS);
+         return 1;
+      }
+      ok = run_spectators(spectators, frames);
+   }
+   else
+   {
+      for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+         if (!run_spectators(counts[i], frames))
+            ok = false;
+   }
+
+   if (!ok)
+   {
+      printf("[ERROR] Spectator streams differ\n");
+      return 1;
+   }
+
+   printf("[SUCCESS] Every spectator got the same stream\n");
+   return 0;
+}
@@ -0,0 +1,469 @@
+/* Loopback comparison of netplay input delivery over TCP alone and with
+ * the redundant UDP input channel.
+ *
+ *   netplay_udp_test
+ *      Runs the built-in scenarios and checks the results.
+ *
+ *   netplay_udp_test <loss %> <latency ms> <jitter ms> [seconds] [seed]
+ *      Simulates the given link and prints the comparison.
+ *
+ * One peer sends an input command every frame (60Hz) to the other over a
+ * simulated link with the given one-way latency, uniformly random jitter on
+ * top of it, and independent random loss in both directions. TCP is modelled
+ * as an in-order stream whose lost segments are retransmitted on fast
+ * retransmit (three later segments) or after the 200ms minimum RTO,
+ * whichever comes first, backing off on repeated loss. The UDP packets are
+ * built and parsed by netplay_udp.c itself, with the acknowledgements
+ * riding on the other peer's packets.
+ *
+ * The receiver runs each frame 'input latency' frames after the sender
+ * captured it, the latency being the link latency plus jitter rounded up to
+ * whole frames. Input that arrives after its frame ran means a rollback.
+ * Input that still hasn't arrived once the receiver is ROLLBACK_FRAMES ahead
+ * of it stalls the receiver, as netplay does when it couldn't rewind
+ * transparently.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <net/net_compat.h>
+
+#include "../../../network/netplay/netplay_udp.h"
+
+#define FRAME_USEC        16667
+#define ROLLBACK_FRAMES   8
+#define TCP_MIN_RTO       200000
+#define MAX_IN_FLIGHT     1024
+#define NEVER             INT64_MAX
+
+/* From netplay_private.h, which needs the whole frontend */
+#define NETPLAY_CMD_INPUT 0x0003
+
+typedef struct link_params
+{
+   double loss;
+   double loss_back;
+   int64_t latency;
+   int64_t jitter;
+   unsigned frames;
+   unsigned seed;
+} link_params_t;
+
+typedef struct result
+{
+   unsigned late;
+   unsigned rollbacks;
+   unsigned replayed;
+   int64_t stall;
+   int64_t worst;
+} result_t;
+
+typedef struct udp_stats
+{
+   unsigned delivered;
+   unsigned first;
+   unsigned duplicates;
+   unsigned peak_window;
+   size_t bytes;
+   unsigned packets;
+} udp_stats_t;
+
+typedef struct packet
+{
+   int64_t arrival;
+   int to;
+   size_t len;
+   uint32_t data[NETPLAY_UDP_MAX_PACKET / sizeof(uint32_t)];
+} packet_t;
+
+typedef struct receiver
+{
+   int64_t *deliver;
+   int64_t now;
+   uint32_t next;
+   unsigned duplicates;
+} receiver_t;
+
+static unsigned failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS]: %s\n", msg);
+   else
+   {
+      printf("[ERROR]: %s\n", msg);
+      failures++;
+   }
+}
+
+/* Simple deterministic LCG so the runs are reproducible */
+static unsigned lcg(unsigned *state)
+{
+   *state = *state * 1103515245u + 12345u;
+   return (*state >> 16) & 0x7fff;
+}
+
+static double rnd(unsigned *state)
+{
+   unsigned hi = lcg(state);
+   unsigned lo = lcg(state);
+   return (double)((hi << 15) | lo) / (double)(1u << 30);
+}
+
+static bool lost(unsigned *state, double loss)
+{
+   return rnd(state) * 100.0 < loss;
+}
+
+static int64_t transit(unsigned *state, const link_params_t *p)
+{
+   return p->latency + (int64_t)(rnd(state) * (double)p->jitter);
+}
+
+static void simulate_tcp(const link_params_t *p, int64_t *deliver)
+{
+   unsigned f;
+   int64_t prev   = 0;
+   unsigned state = p->seed * 2 + 1;
+
+   for (f = 0; f < p->frames; f++)
+   {
+      int64_t sent    = (int64_t)f * FRAME_USEC;
+      int64_t rto     = 2 * p->latency + 4 * p->jitter;
+      int64_t arrival = 0;
+      unsigned tries  = 0;
+
+      if (rto < TCP_MIN_RTO)
+         rto = TCP_MIN_RTO;
+
+      for (;;)
+      {
+         int64_t resend;
+
+         if (!lost(&state, p->loss))
+         {
+            arrival = sent + transit(&state, p);
+            break;
+         }
+
+         /* The first loss may be caught by the duplicate acks of the
+          * following segments, after that it's down to the timer */
+         resend = sent + rto;
+         if (!tries)
+         {
+            int64_t fast = sent + 3 * FRAME_USEC + 2 * p->latency;
+            if (fast < resend)
+               resend = fast;
+         }
+         else
+            rto *= 2;
+
+         sent = resend;
+         tries++;
+      }
+
+      /* In order, so nothing is delivered before what was sent before it */
+      deliver[f] = (arrival > prev) ? arrival : prev;
+      prev       = deliver[f];
+   }
+}
+
+static void receive_entry(void *data, uint32_t sync_offset,
+      const uint32_t *cmd, size_t words)
+{
+   receiver_t *recv = (receiver_t*)data;
+   uint32_t frame;
+
+   if (ntohl(cmd[0]) != NETPLAY_CMD_INPUT || words < 3)
+      return;
+
+   /* Like netplay, only the next frame is any use */
+   frame = ntohl(cmd[2]);
+   if (frame == recv->next)
+   {
+      recv->deliver[frame] = recv->now;
+      recv->next++;
+   }
+   else if (frame < recv->next)
+      recv->duplicates++;
+}
+
+static void ack_entry(void *data, uint32_t sync_offset,
+      const uint32_t *cmd, size_t words) { }
+
+static void simulate_udp(const link_params_t *p, int64_t *deliver,
+      udp_stats_t *stats)
+{
+   unsigned f, i;
+   receiver_t recv;
+   netplay_udp_t sender, receiver;
+   size_t in_flight  = 0;
+   unsigned state    = p->seed * 2 + 2;
+   packet_t *packets = (packet_t*)malloc((MAX_IN_FLIGHT + 1) * sizeof(*packets));
+   /* Keep going for a while after the last input, so it can get through */
+   unsigned ticks    = p->frames + 120;
+
+   memset(stats, 0, sizeof(*stats));
+   memset(&recv, 0, sizeof(recv));
+   recv.deliver = deliver;
+   for (f = 0; f < p->frames; f++)
+      deliver[f] = NEVER;
+
+   netplay_udp_init(&sender, 0x1234);
+   netplay_udp_init(&receiver, 0x1234);
+
+   for (f = 0; f < ticks; f++)
+   {
+      int64_t now = (int64_t)f * FRAME_USEC;
+      int peer;
+
+      /* Hand over everything that has arrived by now, in order of arrival */
+      for (;;)
+      {
+         size_t next = in_flight;
+
+         for (i = 0; i < in_flight; i++)
+            if (packets[i].arrival <= now &&
+                  (next == in_flight ||
+                   packets[i].arrival < packets[next].arrival))
+               next = i;
+
+         if (next == in_flight)
+            break;
+
+         if (packets[next].to)
+         {
+            recv.now = packets[next].arrival;
+            netplay_udp_parse(&receiver, packets[next].data,
+                  packets[next].len, receive_entry, &recv);
+         }
+         else
+            netplay_udp_parse(&sender, packets[next].data,
+                  packets[next].len, ack_entry, NULL);
+
+         packets[next] = packets[--in_flight];
+      }
+
+      /* This frame's input */
+      if (f < p->frames)
+      {
+         uint32_t cmd[5];
+         cmd[0] = htonl(NETPLAY_CMD_INPUT);
+         cmd[1] = htonl(3 * sizeof(uint32_t));
+         cmd[2] = htonl(f);
+         cmd[3] = htonl(0);
+         cmd[4] = htonl(lcg(&state));
+         netplay_udp_queue(&sender, cmd, 5, 0);
+      }
+
+      if (sender.window_end - sender.window_start > stats->peak_window)
+         stats->peak_window = sender.window_end - sender.window_start;
+
+      /* And both peers send their packet for the frame */
+      for (peer = 1; peer >= 0; peer--)
+      {
+         packet_t *pkt = &packets[in_flight];
+         netplay_udp_t *udp = peer ? &sender : &receiver;
+
+         pkt->len = netplay_udp_build(udp, pkt->data, sizeof(pkt->data));
+         pkt->to  = peer;
+
+         if (peer)
+         {
+            stats->bytes += pkt->len;
+            stats->packets++;
+         }
+
+         if (lost(&state, peer ? p->loss : p->loss_back))
+            continue;
+
+         pkt->arrival = now + transit(&state, p);
+         if (in_flight < MAX_IN_FLIGHT)
+            in_flight++;
+      }
+   }
+
+   for (f = 0; f < p->frames; f++)
+      if (deliver[f] != NEVER)
+         stats->delivered++;
+   stats->duplicates = recv.duplicates;
+
+   free(packets);
+}
+
+static unsigned input_latency(const link_params_t *p)
+{
+   return (unsigned)((p->latency + p->jitter + FRAME_USEC - 1) / FRAME_USEC);
+}
+
+static void evaluate(const link_params_t *p, const int64_t *deliver,
+      result_t *res)
+{
+   unsigned f;
+   unsigned group   = 0;
+   bool in_group    = false;
+   unsigned latency = input_latency(p);
+   int64_t *run     = (int64_t*)malloc(p->frames * sizeof(*run));
+
+   memset(res, 0, sizeof(*res));
+
+   /* When does each frame actually run? */
+   for (f = 0; f < p->frames; f++)
+   {
+      int64_t nominal = (int64_t)(f + latency) * FRAME_USEC;
+      int64_t ready   = (f && run[f - 1] > nominal) ? run[f - 1] : nominal;
+      int64_t start   = ready;
+
+      if (f >= ROLLBACK_FRAMES && deliver[f - ROLLBACK_FRAMES] > start)
+         start = deliver[f - ROLLBACK_FRAMES];
+
+      res->stall += start - ready;
+      run[f]      = start;
+   }
+
+   /* Which frames ran on predicted input, and when were they replayed? */
+   for (f = 0; f < p->frames; f++)
+   {
+      unsigned g;
+      int64_t delay = deliver[f] - (int64_t)f * FRAME_USEC;
+
+      if (delay > res->worst)
+         res->worst = delay;
+
+      if (deliver[f] <= run[f])
+         continue;
+
+      res->late++;
+
+      /* The replay happens at the first frame run after the input is in */
+      for (g = f + 1; g < p->frames && run[g] < deliver[f]; g++);
+
+      if (!in_group || g != group)
+      {
+         res->rollbacks++;
+         res->replayed += g - f;
+         group          = g;
+         in_group       = true;
+      }
+   }
+
+   free(run);
+}
+
+static void print_result(const char *name, const result_t *res)
+{
+   printf("  %-10s %11u %10u %9u %9.1f %15.1f\n", name,
+         res->late, res->rollbacks, res->replayed,
+         res->stall / 1000.0, res->worst / 1000.0);
+}
+
+static void run(const link_params_t *p, result_t *tcp, result_t *hybrid,
+      udp_stats_t *stats)
+{
+   unsigned f;
+   int64_t *deliver_tcp = (int64_t*)malloc(p->frames * sizeof(int64_t));
+   int64_t *deliver_udp = (int64_t*)malloc(p->frames * sizeof(int64_t));
+
+   simulate_tcp(p, deliver_tcp);
+   simulate_udp(p, deliver_udp, stats);
+
+   /* Over TCP alone */
+   evaluate(p, deliver_tcp, tcp);
+
+   /* Netplay sends input over both, and uses whatever gets there first */
+   for (f = 0; f < p->frames; f++)
+   {
+      if (deliver_udp[f] < deliver_tcp[f])
+         stats->first++;
+      else
+         deliver_udp[f] = deliver_tcp[f];
+   }
+   evaluate(p, deliver_udp, hybrid);
+
+   printf("Loss %.1f%% (%.1f%% back), latency %lld ms, jitter %lld ms, "
+         "%u frames, input latency %u frames:\n",
+         p->loss, p->loss_back,
+         (long long)(p->latency / 1000), (long long)(p->jitter / 1000),
+         p->frames, input_latency(p));
+   printf("  %-10s %11s %10s %9s %9s %15s\n", "transport",
+         "late frames", "rollbacks", "replayed", "stall ms", "worst delay ms");
+   print_result("TCP", tcp);
+   print_result("TCP+UDP", hybrid);
+   printf("  UDP: %u of %u frames arrived, %u ahead of TCP, "
+         "%u duplicates, peak window %u, %u bytes per packet\n\n",
+         stats->delivered, p->frames, stats->first, stats->duplicates,
+         stats->peak_window,
+         stats->packets ? (unsigned)(stats->bytes / stats->packets) : 0);
+
+   free(deliver_tcp);
+   free(deliver_udp);
+}
+
+static void selftest(void)
+{
+   result_t tcp, hybrid;
+   udp_stats_t stats;
+   link_params_t p;
+
+   p.loss      = 0;
+   p.loss_back = 0;
+   p.latency   = 30000;
+   p.jitter    = 5000;
+   p.frames    = 3600;
+   p.seed      = 1;
+   run(&p, &tcp, &hybrid, &stats);
+   check(tcp.late == 0 && hybrid.late == 0 && hybrid.stall == 0,
+         "Clean link: no rollbacks or stalls either way");
+   check(stats.delivered == p.frames && stats.peak_window <= 6,
+         "Clean link: UDP delivers every frame and acks keep the window small");
+
+   p.loss      = 2;
+   p.loss_back = 2;
+   run(&p, &tcp, &hybrid, &stats);
+   check(hybrid.late * 10 < tcp.late && hybrid.stall <= tcp.stall,
+         "2% loss: redundant UDP avoids most rollbacks");
+
+   p.loss      = 10;
+   p.loss_back = 10;
+   p.latency   = 50000;
+   p.jitter    = 10000;
+   run(&p, &tcp, &hybrid, &stats);
+   check(hybrid.late * 4 < tcp.late && tcp.stall > 0 &&
+         hybrid.stall * 4 < tcp.stall,
+         "10% loss: TCP stalls, redundant UDP mostly doesn't");
+
+   p.loss      = 0;
+   p.loss_back = 100;
+   run(&p, &tcp, &hybrid, &stats);
+   check(stats.delivered == p.frames &&
+         stats.peak_window == NETPLAY_UDP_WINDOW &&
+         stats.bytes / stats.packets <= NETPLAY_UDP_MAX_PACKET,
+         "No acks: the window and packets stay bounded and input still "
+         "gets through");
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc >= 4)
+   {
+      result_t tcp, hybrid;
+      udp_stats_t stats;
+      link_params_t p;
+
+      p.loss      = atof(argv[1]);
+      p.loss_back = p.loss;
+      p.latency   = (int64_t)(atof(argv[2]) * 1000);
+      p.jitter    = (int64_t)(atof(argv[3]) * 1000);
+      p.frames    = (argc >= 5) ? (unsigned)atoi(argv[4]) * 60 : 3600;
+      p.seed      = (argc >= 6) ? (unsigned)atoi(argv[5]) : 1;
+      run(&p, &tcp, &hybrid, &stats);
+      return 0;
+   }
+
+   selftest();
+   return failures ? 1 : 0;
+}
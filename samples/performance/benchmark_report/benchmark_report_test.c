@@ -0,0 +1,307 @@
+/* Regression test for the --benchmark report.
+ *
+ *   benchmark_report_test [frames]
+ *
+ * Feeds synthetic performance counters to the benchmark and checks
+ * the per-frame statistics (percentiles, counters registered late or
+ * reset, frames beyond the requested count), that the report is
+ * valid JSON holding them, and that unknown feature names are
+ * rejected. Then times sampling 64 counters over [frames] (100000 by
+ * default) frames.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <formats/jsonsax_full.h>
+#include <streams/file_stream.h>
+
+#include "benchmark.h"
+
+static int failures = 0;
+static const char *report_path = "benchmark_report_test.json";
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void test_features(void)
+{
+   unsigned features = 0;
+   bool ok           = benchmark_parse_features("rewind,netplay,filter",
+         &features);
+
+   check(ok && features == (BENCHMARK_FEATURE_REWIND
+            | BENCHMARK_FEATURE_NETPLAY | BENCHMARK_FEATURE_FILTER),
+         "features", "known names are parsed");
+
+   ok = benchmark_parse_features("runahead,warp", &features);
+   check(!ok && features == BENCHMARK_FEATURE_RUNAHEAD,
+         "features", "unknown names are rejected");
+
+   ok = benchmark_parse_features("", &features);
+   check(ok && !features, "features", "empty list selects nothing");
+}
+
+static bool stats_equal(const benchmark_stats_t *stats,
+      uint64_t frames, uint64_t calls, retro_perf_tick_t min,
+      retro_perf_tick_t mean, retro_perf_tick_t p50,
+      retro_perf_tick_t p90, retro_perf_tick_t p99,
+      retro_perf_tick_t max)
+{
+   bool ret = stats->frames == frames && stats->calls == calls
+      && stats->min == min && stats->mean == mean && stats->p50 == p50
+      && stats->p90 == p90 && stats->p99 == p99 && stats->max == max;
+
+   if (!ret)
+      printf("  got frames %llu calls %llu min %llu mean %llu "
+            "p50 %llu p90 %llu p99 %llu max %llu\n",
+            (unsigned long long)stats->frames,
+            (unsigned long long)stats->calls,
+            (unsigned long long)stats->min,
+            (unsigned long long)stats->mean,
+            (unsigned long long)stats->p50,
+            (unsigned long long)stats->p90,
+            (unsigned long long)stats->p99,
+            (unsigned long long)stats->max);
+
+   return ret;
+}
+
+static bool report_is_valid_json(const char *data, size_t len)
+{
+   bool ret          = false;
+   JSON_Parser parser = JSON_Parser_Create(NULL);
+
+   if (!parser)
+      return false;
+
+   ret = JSON_Parser_Parse(parser, data, len, JSON_True) == JSON_Success;
+   JSON_Parser_Free(parser);
+   return ret;
+}
+
+static void test_report(void)
+{
+   unsigned i;
+   benchmark_stats_t stats;
+   benchmark_report_info_t info;
+   struct retro_perf_counter linear  = {0};
+   struct retro_perf_counter even    = {0};
+   struct retro_perf_counter early   = {0};
+   struct retro_perf_counter late    = {0};
+   struct retro_perf_counter reset   = {0};
+   struct retro_perf_counter *frontend[4];
+   struct retro_perf_counter *core[1];
+   unsigned num_frontend             = 3;
+   unsigned num_core                 = 0;
+   benchmark_t *bench                = benchmark_new(100,
+         BENCHMARK_FEATURE_REWIND | BENCHMARK_FEATURE_RECORD);
+   bool more                         = true;
+   char *data                        = NULL;
+   int64_t len                       = 0;
+
+   linear.ident = "linear";
+   even.ident   = "even \"quoted\"";
+   early.ident  = "early";
+   late.ident   = "late";
+   reset.ident  = "reset";
+
+   /* Counted before the benchmark started, must not show up */
+   early.total    = 100000;
+   early.call_cnt = 1000;
+
+   frontend[0]  = &linear;
+   frontend[1]  = &even;
+   frontend[2]  = &early;
+   frontend[3]  = &reset;
+   core[0]      = &late;
+
+   check(bench != NULL, "report", "benchmark created");
+   if (!bench)
+      return;
+
+   /* Baseline */
+   benchmark_frame(bench, frontend, num_frontend, core, num_core);
+
+   for (i = 0; i < 100; i++)
+   {
+      /* 1..100 ticks, once per frame */
+      linear.call_cnt++;
+      linear.total += i + 1;
+
+      /* 10 ticks in two calls, every other frame */
+      if (!(i & 1))
+      {
+         even.call_cnt += 2;
+         even.total    += 10;
+      }
+
+      /* The core registers its counter half way through */
+      if (i == 50)
+         num_core = 1;
+      if (num_core)
+      {
+         late.call_cnt++;
+         late.total    += 7;
+      }
+
+      /* Registered at frame 20, goes back to zero at frame 60 */
+      if (i == 20)
+         num_frontend = 4;
+      if (i == 60)
+      {
+         reset.call_cnt = 0;
+         reset.total    = 0;
+      }
+      if (num_frontend == 4)
+      {
+         reset.call_cnt++;
+         reset.total   += 3;
+      }
+
+      more = benchmark_frame(bench, frontend, num_frontend, core, num_core);
+   }
+
+   check(!more && benchmark_get_frames(bench) == 100,
+         "report", "stops after the requested frames");
+
+   linear.call_cnt++;
+   linear.total += 1000000;
+   benchmark_frame(bench, frontend, num_frontend, core, num_core);
+   check(benchmark_get_frames(bench) == 100
+         && benchmark_get_stats(bench, "linear", &stats)
+         && stats.max == 100,
+         "report", "frames past the end are ignored");
+
+   check(benchmark_get_stats(bench, "linear", &stats)
+         && stats_equal(&stats, 100, 100, 1, 50, 50, 90, 99, 100),
+         "report", "nearest rank percentiles");
+
+   check(benchmark_get_stats(bench, "even \"quoted\"", &stats)
+         && stats_equal(&stats, 50, 100, 10, 10, 10, 10, 10, 10),
+         "report", "frames without calls are left out");
+
+   check(benchmark_get_stats(bench, "early", &stats)
+         && stats_equal(&stats, 0, 0, 0, 0, 0, 0, 0, 0),
+         "report", "time before the first frame is not counted");
+
+   check(benchmark_get_stats(bench, "late", &stats)
+         && stats_equal(&stats, 50, 50, 7, 7, 7, 7, 7, 7),
+         "report", "counters registered late are picked up");
+
+   check(benchmark_get_stats(bench, "reset", &stats)
+         && stats_equal(&stats, 80, 80, 3, 3, 3, 3, 3, 3),
+         "report", "counters that were reset keep counting");
+
+   check(!benchmark_get_stats(bench, "missing", &stats),
+         "report", "unknown counters are not found");
+
+   info.core_name       = "Test \\ Core";
+   info.core_version    = "1.0";
+   info.content_path    = NULL;
+   info.features_active = BENCHMARK_FEATURE_REWIND;
+
+   check(benchmark_write_report(bench, report_path, &info),
+         "report", "written");
+
+   if (filestream_read_file(report_path, (void**)&data, &len))
+   {
+      check(report_is_valid_json(data, (size_t)len),
+            "report", "is valid JSON");
+      check(strstr(data, "\"frames\": 100,") != NULL
+            && strstr(data, "\"name\": \"linear\"") != NULL
+            && strstr(data, "\"source\": \"core\"") != NULL
+            && strstr(data, "\"name\": \"even \\\"quoted\\\"\"") != NULL
+            && strstr(data, "\"core\": \"Test \\\\ Core\"") != NULL
+            && strstr(data, "\"content\": null") != NULL,
+            "report", "holds the counters and run info");
+      check(strstr(data,
+               "\"rewind\": {\"requested\": true, \"active\": true}") != NULL
+            && strstr(data,
+               "\"record\": {\"requested\": true, \"active\": false}") != NULL,
+            "report", "holds requested and active features");
+      free(data);
+   }
+   else
+      check(false, "report", "read back");
+
+   filestream_delete(report_path);
+   benchmark_free(bench);
+}
+
+static void bench_sampling(unsigned frames)
+{
+   unsigned i, j;
+   retro_time_t start, usec;
+   struct retro_perf_counter counters[64];
+   struct retro_perf_counter *list[64];
+   benchmark_t *bench = benchmark_new(frames, 0);
+
+   if (!bench)
+   {
+      check(false, "bench", "benchmark created");
+      return;
+   }
+
+   memset(counters, 0, sizeof(counters));
+   for (i = 0; i < 64; i++)
+   {
+      counters[i].ident = "counter";
+      list[i]           = &counters[i];
+   }
+
+   benchmark_frame(bench, list, 48, list + 48, 16);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < frames; i++)
+   {
+      for (j = 0; j < 64; j++)
+      {
+         counters[j].call_cnt++;
+         counters[j].total += j + (i & 15);
+      }
+      benchmark_frame(bench, list, 48, list + 48, 16);
+   }
+   usec  = cpu_features_get_time_usec() - start;
+
+   printf("[INFO] sampling 64 counters: %.3f us per frame\n",
+         (double)usec / frames);
+
+   start = cpu_features_get_time_usec();
+   benchmark_write_report(bench, report_path, NULL);
+   usec  = cpu_features_get_time_usec() - start;
+
+   printf("[INFO] report over %u frames: %.3f ms\n",
+         frames, (double)usec / 1000.0);
+
+   filestream_delete(report_path);
+   benchmark_free(bench);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned frames = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 100000;
+
+   test_features();
+   test_report();
+   if (frames)
+      bench_sampling(frames);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
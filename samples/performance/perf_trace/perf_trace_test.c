@@ -0,0 +1,504 @@
+/* Regression test for the performance trace.
+ *
+ *   perf_trace_test [iterations]
+ *
+ * Checks the latency histograms (buckets, percentiles, names from
+ * memory that goes away), that threads recording at the same time
+ * end up on their own tracks of a capture that is valid Chrome trace
+ * JSON and covers exactly the asked for window of frames, and that
+ * exited threads hand their buffers on. Then times a performance
+ * counter over [iterations] (10000000 by default) start/stop pairs
+ * with tracing off, with histograms and while capturing, next to the
+ * same counter without the tracing hook.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <retro_timers.h>
+#include <features/features_cpu.h>
+#include <formats/jsonsax_full.h>
+#include <rthreads/rthreads.h>
+#include <streams/file_stream.h>
+
+#include "performance_counters.h"
+#include "performance_trace.h"
+
+#define NUM_WORKERS 4
+
+static int failures = 0;
+static const char *trace_path = "perf_trace_test.json";
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* The frontend's counter registration is not linked in */
+void rarch_perf_register(struct retro_perf_counter *perf)
+{
+   perf->registered = true;
+}
+
+typedef struct worker
+{
+   const char *name;
+   unsigned index;
+   volatile bool *stop;
+   unsigned recorded;
+} worker_t;
+
+static void worker_loop(void *data)
+{
+   worker_t *worker = (worker_t*)data;
+
+   performance_trace_set_thread_name(worker->name);
+
+   while (!*worker->stop)
+   {
+      retro_perf_tick_t trace_start;
+
+      performance_trace_scope_begin(trace_start);
+      retro_sleep(1);
+      performance_trace_scope_end(trace_start, "worker_work");
+      worker->recorded++;
+   }
+
+   performance_trace_thread_exit();
+}
+
+static void test_histograms(void)
+{
+   unsigned i;
+   performance_trace_histogram_t hist;
+   char ident[32];
+   const char *idents[8];
+   unsigned num = 0;
+
+   performance_trace_enable_histograms(true);
+
+   /* 1..100 ticks */
+   for (i = 1; i <= 100; i++)
+      performance_trace_event("linear", 0, i);
+
+   check(performance_trace_get_histogram("linear", &hist)
+         && hist.count == 100 && hist.total == 5050 && hist.max == 100,
+         "histogram", "counts, total and max");
+
+   /* 1 -> bucket 1, 2-3 -> 2, 4-7 -> 3, ... 64-100 -> 7 */
+   check(hist.buckets[0] == 0 && hist.buckets[1] == 1
+         && hist.buckets[2] == 2 && hist.buckets[3] == 4
+         && hist.buckets[6] == 32 && hist.buckets[7] == 37,
+         "histogram", "log2 buckets");
+
+   check(performance_trace_histogram_percentile(&hist, 50) == 63
+         && performance_trace_histogram_percentile(&hist, 20) == 31
+         && performance_trace_histogram_percentile(&hist, 99) == 100
+         && performance_trace_histogram_percentile(&hist, 0) == 1,
+         "histogram", "percentiles are bucket upper bounds");
+
+   performance_trace_event("huge", 0, (retro_perf_tick_t)1 << 60);
+   check(performance_trace_get_histogram("huge", &hist)
+         && hist.buckets[PERFORMANCE_TRACE_BUCKETS - 1] == 1
+         && performance_trace_histogram_percentile(&hist, 50)
+            == (retro_perf_tick_t)1 << 60,
+         "histogram", "longest durations go to the last bucket");
+
+   /* Like a core's counter, the name goes away after use */
+   strcpy(ident, "unloaded");
+   performance_trace_event(ident, 0, 5);
+   strcpy(ident, "reloaded");
+   performance_trace_event(ident, 0, 6);
+   memset(ident, 0, sizeof(ident));
+
+   check(performance_trace_get_histogram("unloaded", &hist)
+         && hist.count == 1 && hist.max == 5
+         && performance_trace_get_histogram("reloaded", &hist)
+         && hist.count == 1 && hist.max == 6,
+         "histogram", "names are copied and compared");
+
+   num = performance_trace_get_idents(idents, 8);
+   check(num == 4, "histogram", "lists each section once");
+   check(!performance_trace_get_histogram("missing", &hist),
+         "histogram", "unknown sections are not found");
+
+   performance_trace_enable_histograms(false);
+   performance_trace_event("linear", 0, 1);
+   check(performance_trace_get_histogram("linear", &hist)
+         && hist.count == 100,
+         "histogram", "nothing is counted while disabled");
+}
+
+static void test_counter(void)
+{
+   performance_trace_histogram_t hist;
+   static struct retro_perf_counter counter;
+
+   performance_trace_enable_histograms(true);
+   performance_counter_init(counter, "counter");
+   performance_counter_start_plus(true, counter);
+   performance_counter_stop_plus(true, counter);
+   performance_counter_start_plus(false, counter);
+   performance_counter_stop_plus(false, counter);
+   performance_trace_enable_histograms(false);
+
+   check(performance_trace_get_histogram("counter", &hist)
+         && hist.count == 1 && hist.total == counter.total,
+         "counter", "stopping a counter records the section");
+}
+
+/* Objects in "traceEvents", their "args" one level down */
+#define EVENT_DEPTH 2
+
+typedef struct trace_json
+{
+   unsigned depth;
+   bool in_args;
+   char key[32];
+   char name[32];
+   char ph[4];
+   unsigned tid;
+   double ts;
+   double dur;
+   /* Events per tid */
+   unsigned events[16];
+   unsigned frames;
+   unsigned thread_names;
+   bool names[NUM_WORKERS];
+   bool in_window;
+} trace_json_t;
+
+static JSON_Parser_HandlerResult trace_json_object_start(JSON_Parser parser)
+{
+   trace_json_t *ctx = (trace_json_t*)JSON_Parser_GetUserData(parser);
+
+   if (++ctx->depth == EVENT_DEPTH)
+   {
+      ctx->name[0] = '\0';
+      ctx->ph[0]   = '\0';
+      ctx->tid     = 0;
+      ctx->ts      = 0.0;
+      ctx->dur     = 0.0;
+   }
+   else if (ctx->depth == EVENT_DEPTH + 1)
+      ctx->in_args = true;
+
+   return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult trace_json_object_end(JSON_Parser parser)
+{
+   trace_json_t *ctx = (trace_json_t*)JSON_Parser_GetUserData(parser);
+
+   if (ctx->depth == EVENT_DEPTH + 1)
+      ctx->in_args = false;
+   else if (ctx->depth == EVENT_DEPTH && !strcmp(ctx->ph, "X"))
+   {
+      if (ctx->tid < 16)
+         ctx->events[ctx->tid]++;
+      if (!strcmp(ctx->name, "frame"))
+         ctx->frames++;
+      if (ctx->ts < 0.0 || ctx->dur < 0.0)
+         ctx->in_window = false;
+   }
+   else if (ctx->depth == EVENT_DEPTH && !strcmp(ctx->ph, "M"))
+      ctx->thread_names++;
+
+   ctx->depth--;
+   return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult trace_json_member(JSON_Parser parser,
+      char *pValue, size_t length, JSON_StringAttributes attributes)
+{
+   trace_json_t *ctx = (trace_json_t*)JSON_Parser_GetUserData(parser);
+   strlcpy(ctx->key, pValue, sizeof(ctx->key));
+   return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult trace_json_string(JSON_Parser parser,
+      char *pValue, size_t length, JSON_StringAttributes attributes)
+{
+   trace_json_t *ctx = (trace_json_t*)JSON_Parser_GetUserData(parser);
+
+   if (ctx->in_args && !strcmp(ctx->key, "name"))
+   {
+      unsigned i;
+      for (i = 0; i < NUM_WORKERS; i++)
+      {
+         char name[16];
+         snprintf(name, sizeof(name), "worker %u", i);
+         if (!strcmp(pValue, name))
+            ctx->names[i] = true;
+      }
+   }
+   else if (!strcmp(ctx->key, "name"))
+      strlcpy(ctx->name, pValue, sizeof(ctx->name));
+   else if (!strcmp(ctx->key, "ph"))
+      strlcpy(ctx->ph, pValue, sizeof(ctx->ph));
+
+   return JSON_Parser_Continue;
+}
+
+static JSON_Parser_HandlerResult trace_json_number(JSON_Parser parser,
+      char *pValue, size_t length, JSON_NumberAttributes attributes)
+{
+   trace_json_t *ctx = (trace_json_t*)JSON_Parser_GetUserData(parser);
+
+   if (ctx->depth != EVENT_DEPTH)
+      return JSON_Parser_Continue;
+
+   if (!strcmp(ctx->key, "tid"))
+      ctx->tid = (unsigned)strtoul(pValue, NULL, 10);
+   else if (!strcmp(ctx->key, "ts"))
+      ctx->ts  = atof(pValue);
+   else if (!strcmp(ctx->key, "dur"))
+      ctx->dur = atof(pValue);
+
+   return JSON_Parser_Continue;
+}
+
+static bool trace_parse(const char *data, size_t len, trace_json_t *ctx)
+{
+   bool ret           = false;
+   JSON_Parser parser = JSON_Parser_Create(NULL);
+
+   if (!parser)
+      return false;
+
+   memset(ctx, 0, sizeof(*ctx));
+   ctx->in_window = true;
+
+   JSON_Parser_SetUserData(parser, ctx);
+   JSON_Parser_SetStartObjectHandler(parser, &trace_json_object_start);
+   JSON_Parser_SetEndObjectHandler(parser, &trace_json_object_end);
+   JSON_Parser_SetObjectMemberHandler(parser, &trace_json_member);
+   JSON_Parser_SetStringHandler(parser, &trace_json_string);
+   JSON_Parser_SetNumberHandler(parser, &trace_json_number);
+
+   ret = JSON_Parser_Parse(parser, data, len, JSON_True) == JSON_Success;
+   JSON_Parser_Free(parser);
+   return ret;
+}
+
+static void test_capture(void)
+{
+   unsigned i;
+   trace_json_t ctx;
+   worker_t workers[NUM_WORKERS];
+   sthread_t *threads[NUM_WORKERS];
+   char names[NUM_WORKERS][16];
+   volatile bool stop = false;
+   char *data         = NULL;
+   int64_t len        = 0;
+   bool named         = true;
+   bool all_recorded  = true;
+
+   performance_trace_set_thread_name("main");
+
+   for (i = 0; i < NUM_WORKERS; i++)
+   {
+      snprintf(names[i], sizeof(names[i]), "worker %u", i);
+      workers[i].name     = names[i];
+      workers[i].index    = i;
+      workers[i].stop     = &stop;
+      workers[i].recorded = 0;
+      threads[i]          = sthread_create(worker_loop, &workers[i]);
+   }
+
+   check(!performance_trace_capture(trace_path, 0, 0),
+         "capture", "needs at least one frame");
+   check(performance_trace_capture(trace_path, 5, 20),
+         "capture", "armed");
+
+   /* 5 skipped, one to start, 20 captured, 5 more after */
+   for (i = 0; i < 31; i++)
+   {
+      retro_perf_tick_t trace_start;
+
+      performance_trace_frame();
+      performance_trace_scope_begin(trace_start);
+      retro_sleep(2);
+      performance_trace_scope_end(trace_start, "main_work");
+   }
+
+   stop = true;
+   for (i = 0; i < NUM_WORKERS; i++)
+   {
+      sthread_join(threads[i]);
+      if (!workers[i].recorded)
+         all_recorded = false;
+   }
+
+   check(!(performance_trace_flags & PERFORMANCE_TRACE_CAPTURE),
+         "capture", "stops after the window");
+
+   if (!filestream_read_file(trace_path, (void**)&data, &len))
+   {
+      check(false, "capture", "written");
+      return;
+   }
+
+   check(trace_parse(data, (size_t)len, &ctx),
+         "capture", "is valid JSON");
+
+   check(strstr(data, "\"traceEvents\"") != NULL
+         && strstr(data, "\"displayTimeUnit\": \"ms\"") != NULL
+         && strstr(data, "\"dropped_events\": 0") != NULL,
+         "capture", "is in the trace event format");
+   check(ctx.frames == 20, "capture", "covers the asked for frames");
+   check(ctx.in_window, "capture", "events start inside the window");
+   check(ctx.thread_names == NUM_WORKERS + 1,
+         "capture", "names every thread");
+
+   for (i = 0; i < NUM_WORKERS; i++)
+      if (!ctx.names[i])
+         named = false;
+   check(named && all_recorded, "capture", "workers keep their names");
+
+   /* Main is tid 0, the workers follow */
+   for (i = 0; i <= NUM_WORKERS; i++)
+      if (!ctx.events[i])
+         break;
+   check(i > NUM_WORKERS, "capture", "every thread has events");
+
+   free(data);
+   filestream_delete(trace_path);
+}
+
+static void test_thread_reuse(void)
+{
+   unsigned i;
+   char *data       = NULL;
+   int64_t len      = 0;
+   trace_json_t ctx;
+   volatile bool stop = true;
+   worker_t worker;
+
+   worker.name  = "worker 0";
+   worker.stop  = &stop;
+
+   /* Threads that come and go should not add tracks */
+   for (i = 0; i < 8; i++)
+   {
+      sthread_t *thread = sthread_create(worker_loop, &worker);
+      sthread_join(thread);
+   }
+
+   performance_trace_capture(trace_path, 0, 1);
+   performance_trace_frame();
+   performance_trace_frame();
+
+   if (!filestream_read_file(trace_path, (void**)&data, &len))
+   {
+      check(false, "reuse", "written");
+      return;
+   }
+
+   check(trace_parse(data, (size_t)len, &ctx)
+         && ctx.thread_names == NUM_WORKERS + 1,
+         "reuse", "exited threads hand their buffers on");
+
+   free(data);
+   filestream_delete(trace_path);
+}
+
+/* The counter as it was before tracing, for reference */
+static double bench_plain(unsigned iterations)
+{
+   unsigned i;
+   retro_time_t start;
+   static struct retro_perf_counter counter;
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < iterations; i++)
+   {
+      counter.call_cnt++;
+      counter.start  = cpu_features_get_perf_counter();
+      counter.total += cpu_features_get_perf_counter() - counter.start;
+   }
+
+   return (double)(cpu_features_get_time_usec() - start) * 1000.0
+      / iterations;
+}
+
+static double bench_counter(unsigned iterations)
+{
+   unsigned i;
+   retro_time_t start;
+   static struct retro_perf_counter counter;
+
+   performance_counter_init(counter, "bench");
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < iterations; i++)
+   {
+      performance_counter_start_plus(true, counter);
+      performance_counter_stop_plus(true, counter);
+   }
+
+   return (double)(cpu_features_get_time_usec() - start) * 1000.0
+      / iterations;
+}
+
+static void bench(unsigned iterations)
+{
+   unsigned i;
+   double plain, off, hist, capture;
+
+   plain   = bench_plain(iterations);
+   off     = bench_counter(iterations);
+
+   performance_trace_enable_histograms(true);
+   hist    = bench_counter(iterations);
+   performance_trace_enable_histograms(false);
+
+   /* Frames short enough for the queue to keep up */
+   performance_trace_capture(trace_path, 0, 20);
+   performance_trace_frame();
+   capture = 0.0;
+   for (i = 0; i < 20; i++)
+   {
+      capture += bench_counter(4000);
+      performance_trace_frame();
+   }
+   capture /= 20;
+   filestream_delete(trace_path);
+
+   printf("[INFO] counter start/stop: %.2f ns without tracing, %.2f ns "
+         "off, %.2f ns with histograms, %.2f ns capturing\n",
+         plain, off, hist, capture);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned iterations = argc > 1
+      ? (unsigned)strtoul(argv[1], NULL, 10) : 10000000;
+
+   performance_trace_init();
+
+   test_histograms();
+   test_counter();
+   test_capture();
+   test_thread_reuse();
+   if (iterations)
+      bench(iterations);
+
+   performance_trace_deinit();
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
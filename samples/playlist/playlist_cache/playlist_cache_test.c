@@ -0,0 +1,404 @@
+/* Regression test and benchmark for the binary playlist cache.
+ *
+ *   playlist_cache_test [entries]
+ *
+ * Uses (and empties) "playlist_cache_test.dir". Checks that a cache
+ * is written when a playlist is parsed, gives the same entries, is
+ * only used while the playlist keeps its size and modification time
+ * (to the nanosecond),
+ * and is ignored if it is broken. Entries loaded from it are changed
+ * and freed like any other. Then times loading a playlist of
+ * [entries] (50000 by default) entries with and without the cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boolean.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <lists/string_list.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "playlist.h"
+
+static int failures = 0;
+static const char *dir = "playlist_cache_test.dir";
+static char lpl[PATH_MAX_LENGTH];
+static char lplc[PATH_MAX_LENGTH];
+
+void RARCH_LOG(const char *fmt, ...) { (void)fmt; }
+void RARCH_WARN(const char *fmt, ...) { (void)fmt; }
+void RARCH_ERR(const char *fmt, ...) { (void)fmt; }
+
+bool core_info_find(core_info_ctx_find_t *info) { return false; }
+
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b)
+{
+   return string_is_equal(core_path_a, core_path_b);
+}
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+/* Labels start with @c, so that playlists of the same size
+ * can be told apart */
+static void write_playlist(unsigned entries, char c)
+{
+   unsigned i;
+   size_t len = 0;
+   char *buf  = (char*)malloc(512 + entries * 512);
+
+   len += sprintf(buf + len,
+         "{\n  \"version\": \"1.0\",\n"
+         "  \"default_core_path\": \"/cores/default_libretro.so\",\n"
+         "  \"default_core_name\": \"Default\",\n"
+         "  \"label_display_mode\": 2,\n"
+         "  \"right_thumbnail_mode\": 3,\n"
+         "  \"left_thumbnail_mode\": 1,\n"
+         "  \"sort_mode\": 1,\n"
+         "  \"items\": [\n");
+
+   for (i = 0; i < entries; i++)
+   {
+      len += sprintf(buf + len,
+            "    {\n"
+            "      \"path\": \"/roms/Game %05u.zip\",\n"
+            "      \"label\": \"%c Game %05u\",\n"
+            "      \"core_path\": \"/cores/core%u_libretro.so\",\n"
+            "      \"core_name\": \"Core %u\",\n"
+            "      \"crc32\": \"%08X|crc\",\n"
+            "      \"db_name\": \"System %u.lpl\"",
+            i, c, i, i % 3, i % 3, i * 2654435761u, i % 5);
+
+      if (i % 10 == 3)
+         len += sprintf(buf + len, ",\n"
+               "      \"subsystem_ident\": \"sgb\",\n"
+               "      \"subsystem_name\": \"Super Game Boy\",\n"
+               "      \"subsystem_roms\": [\"/roms/bios.sfc\", \"\", "
+               "\"/roms/Game %05u.gb\"]", i);
+
+      if (i % 10 == 7)
+         len += sprintf(buf + len, ",\n"
+               "      \"runtime_hours\": %u,\n"
+               "      \"runtime_minutes\": 42,\n"
+               "      \"last_played_year\": 2020,\n"
+               "      \"last_played_second\": 59", i);
+
+      len += sprintf(buf + len, "\n    }%s\n", i + 1 < entries ? "," : "");
+   }
+
+   len += sprintf(buf + len, "  ]\n}\n");
+   filestream_write_file(lpl, buf, len);
+   free(buf);
+}
+
+/* Modification time of the playlist */
+static struct timespec get_mtime(void)
+{
+   struct stat buf;
+
+   stat(lpl, &buf);
+   return buf.st_mtim;
+}
+
+/* Gives the playlist the modification time @mtime */
+static void set_mtime(struct timespec mtime)
+{
+   struct timespec times[2];
+
+   times[0] = mtime;
+   times[1] = mtime;
+   utimensat(AT_FDCWD, lpl, times, 0);
+}
+
+static playlist_t *load(size_t capacity)
+{
+   playlist_config_t config;
+
+   memset(&config, 0, sizeof(config));
+   config.capacity = capacity;
+   playlist_config_set_path(&config, lpl);
+   return playlist_init(&config);
+}
+
+static bool str_equal(const char *a, const char *b)
+{
+   return (!a && !b) || (a && b && string_is_equal(a, b));
+}
+
+static bool entries_equal(playlist_t *a, playlist_t *b)
+{
+   size_t i, j;
+
+   if (playlist_size(a) != playlist_size(b))
+      return false;
+
+   if (     !str_equal(playlist_get_default_core_path(a),
+               playlist_get_default_core_path(b))
+         || !str_equal(playlist_get_default_core_name(a),
+               playlist_get_default_core_name(b))
+         || playlist_get_label_display_mode(a)
+            != playlist_get_label_display_mode(b)
+         || playlist_get_thumbnail_mode(a, PLAYLIST_THUMBNAIL_RIGHT)
+            != playlist_get_thumbnail_mode(b, PLAYLIST_THUMBNAIL_RIGHT)
+         || playlist_get_thumbnail_mode(a, PLAYLIST_THUMBNAIL_LEFT)
+            != playlist_get_thumbnail_mode(b, PLAYLIST_THUMBNAIL_LEFT)
+         || playlist_get_sort_mode(a) != playlist_get_sort_mode(b))
+      return false;
+
+   for (i = 0; i < playlist_size(a); i++)
+   {
+      const struct playlist_entry *x = NULL;
+      const struct playlist_entry *y = NULL;
+
+      playlist_get_index(a, i, &x);
+      playlist_get_index(b, i, &y);
+
+      if (     !str_equal(x->path, y->path)
+            || !str_equal(x->label, y->label)
+            || !str_equal(x->core_path, y->core_path)
+            || !str_equal(x->core_name, y->core_name)
+            || !str_equal(x->db_name, y->db_name)
+            || !str_equal(x->crc32, y->crc32)
+            || !str_equal(x->subsystem_ident, y->subsystem_ident)
+            || !str_equal(x->subsystem_name, y->subsystem_name)
+            || !str_equal(x->runtime_str, y->runtime_str)
+            || !str_equal(x->last_played_str, y->last_played_str)
+            || x->runtime_status     != y->runtime_status
+            || x->runtime_hours      != y->runtime_hours
+            || x->runtime_minutes    != y->runtime_minutes
+            || x->last_played_year   != y->last_played_year
+            || x->last_played_second != y->last_played_second
+            || !x->subsystem_roms    != !y->subsystem_roms)
+         return false;
+
+      if (x->subsystem_roms)
+      {
+         if (x->subsystem_roms->size != y->subsystem_roms->size)
+            return false;
+
+         for (j = 0; j < x->subsystem_roms->size; j++)
+            if (!str_equal(x->subsystem_roms->elems[j].data,
+                     y->subsystem_roms->elems[j].data))
+               return false;
+      }
+   }
+
+   return true;
+}
+
+static const char *label_at(playlist_t *playlist, size_t idx)
+{
+   const struct playlist_entry *entry = NULL;
+
+   playlist_get_index(playlist, idx, &entry);
+   return entry ? entry->label : NULL;
+}
+
+static void test_cache(void)
+{
+   struct timespec mtime;
+   playlist_t *parsed, *cached, *other;
+   struct playlist_entry update = {0};
+   struct playlist_entry pushed = {0};
+   FILE *file;
+
+   filestream_delete(lplc);
+   write_playlist(1000, 'a');
+   parsed = load(COLLECTION_SIZE);
+   check(playlist_size(parsed) == 1000 && path_is_valid(lplc),
+         "cache", "written when the playlist is parsed");
+
+   cached = load(COLLECTION_SIZE);
+   check(entries_equal(parsed, cached), "cache", "same entries as parsed");
+   playlist_free(cached);
+
+   /* Same size and modification time, so the cache is used */
+   mtime = get_mtime();
+   write_playlist(1000, 'b');
+   set_mtime(mtime);
+   cached = load(COLLECTION_SIZE);
+   check(string_is_equal(label_at(cached, 0), "a Game 00000"),
+         "cache", "used while the playlist is unchanged");
+   playlist_free(cached);
+
+   /* Rewritten within the same second */
+   mtime.tv_nsec = (mtime.tv_nsec + 1) % 1000000000;
+   set_mtime(mtime);
+   other = load(COLLECTION_SIZE);
+   check(string_is_equal(label_at(other, 0), "b Game 00000"),
+         "cache", "not used once the playlist changed, same second");
+   playlist_free(other);
+
+   mtime.tv_sec += 10;
+   set_mtime(mtime);
+   other = load(COLLECTION_SIZE);
+   check(string_is_equal(label_at(other, 0), "b Game 00000"),
+         "cache", "not used once the playlist changed");
+   playlist_free(other);
+
+   other = load(COLLECTION_SIZE);
+   check(string_is_equal(label_at(other, 999), "b Game 00999"),
+         "cache", "made again for the changed playlist");
+
+   /* Entries pointing into the cache are replaced and freed */
+   update.label = (char*)"updated";
+   playlist_update(other, 3, &update);
+   playlist_set_default_core_path(other, "/cores/other_libretro.so");
+   playlist_delete_index(other, 5);
+   pushed.path      = (char*)"/roms/new.zip";
+   pushed.label     = (char*)"new";
+   pushed.core_path = (char*)"/cores/core0_libretro.so";
+   pushed.core_name = (char*)"Core 0";
+   playlist_push(other, &pushed);
+   check(string_is_equal(label_at(other, 0), "new")
+         && string_is_equal(label_at(other, 4), "updated")
+         && string_is_equal(playlist_get_default_core_path(other),
+            "/cores/other_libretro.so"),
+         "cache", "cached entries changed");
+
+   /* Writing the playlist drops its cache */
+   playlist_write_file(other);
+   check(!path_is_valid(lplc), "cache", "dropped when the playlist is written");
+   playlist_free(other);
+
+   other = load(COLLECTION_SIZE);
+   cached = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 1000 && entries_equal(other, cached)
+         && string_is_equal(label_at(cached, 4), "updated"),
+         "cache", "written playlist read back");
+   playlist_free(other);
+   playlist_free(cached);
+
+   /* Capacity */
+   other = load(10);
+   check(playlist_size(other) == 10
+         && string_is_equal(label_at(other, 4), "updated")
+         && string_is_equal(label_at(other, 9), "b Game 00009"),
+         "capacity", "cache of a whole playlist cut short");
+   playlist_free(other);
+
+   filestream_delete(lplc);
+   other = load(10);
+   playlist_free(other);
+   other = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 1000,
+         "capacity", "cache of part of a playlist not used for all of it");
+   playlist_free(other);
+
+   /* Broken caches */
+   if ((file = fopen(lplc, "r+b")))
+   {
+      fseek(file, 100, SEEK_SET);
+      fwrite("\xff\xff\xff\xff\xff\xff\xff\xff", 1, 8, file);
+      fclose(file);
+   }
+   other = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 1000
+         && string_is_equal(label_at(other, 0), "new"),
+         "broken", "offsets out of range");
+   playlist_free(other);
+
+   if ((file = fopen(lplc, "r+b")))
+   {
+      fseek(file, 0, SEEK_END);
+      ftruncate(fileno(file), ftell(file) / 2);
+      fclose(file);
+   }
+   other = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 1000, "broken", "truncated");
+   playlist_free(other);
+
+   filestream_write_file(lplc, "RPLC", 4);
+   other = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 1000, "broken", "header only");
+   playlist_free(other);
+
+   /* Entries dropped for the capacity are dropped from the file
+    * too, as when the playlist is parsed */
+   other = load(COLLECTION_SIZE);
+   playlist_free(other);
+   other = load(10);
+   playlist_write_file(other);
+   playlist_free(other);
+   other = load(COLLECTION_SIZE);
+   check(playlist_size(other) == 10,
+         "capacity", "cache cut short for the capacity written back");
+   playlist_free(other);
+
+   playlist_free(parsed);
+}
+
+/* Milliseconds to load the playlist @runs times, parsing it
+ * (and writing the cache) every time if @parse */
+static double time_load(unsigned runs, bool parse, size_t *size)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (i = 0; i < runs; i++)
+   {
+      playlist_t *playlist = NULL;
+
+      if (parse)
+         filestream_delete(lplc);
+
+      playlist = load(COLLECTION_SIZE);
+      *size    = playlist_size(playlist);
+      playlist_free(playlist);
+   }
+
+   return (cpu_features_get_time_usec() - start) / 1000.0 / runs;
+}
+
+static void bench(unsigned entries)
+{
+   size_t parsed_size, cached_size;
+   double parse_ms, cache_ms;
+
+   write_playlist(entries, 'a');
+   parse_ms = time_load(3, true, &parsed_size);
+   cache_ms = time_load(10, false, &cached_size);
+   check(parsed_size == entries && cached_size == entries,
+         "bench", "all entries loaded");
+   printf("%u entries: %8.1f ms to parse and write the cache, "
+         "%6.2f ms from the cache\n", entries, parse_ms, cache_ms);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned entries = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 50000;
+
+   path_mkdir(dir);
+   fill_pathname_join(lpl, dir, "test.lpl", sizeof(lpl));
+   fill_pathname_join(lplc, dir, "test.lplc", sizeof(lplc));
+
+   test_cache();
+   bench(entries);
+
+   filestream_delete(lpl);
+   filestream_delete(lplc);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
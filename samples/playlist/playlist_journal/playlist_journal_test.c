@@ -0,0 +1,537 @@
+/* Regression test and benchmark for journaled playlist writes.
+ *
+ *   playlist_journal_test [entries]
+ *
+ * Uses (and empties) "playlist_journal_test.dir". Checks that pushes,
+ * updates and deletions are appended to the journal of a playlist
+ * without rewriting it, that reading the playlist back gives what
+ * writing it in full would, and that the playlist is written in full
+ * for other changes, for a journal that grew large, or cut short by
+ * a crash, or made for another version of the file (even one of the
+ * same size and time), and that a malformed record leaves the
+ * playlist as it was. Then times
+ * pushing an entry to a history of [entries] (1000 by default)
+ * entries and writing it, with and without the journal.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boolean.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <lists/string_list.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "playlist.h"
+
+static int failures = 0;
+static const char *dir = "playlist_journal_test.dir";
+static char lpl[PATH_MAX_LENGTH];
+static char lplj[PATH_MAX_LENGTH];
+static unsigned pushed = 0;
+
+void RARCH_LOG(const char *fmt, ...) { (void)fmt; }
+void RARCH_WARN(const char *fmt, ...) { (void)fmt; }
+void RARCH_ERR(const char *fmt, ...) { (void)fmt; }
+
+bool core_info_find(core_info_ctx_find_t *info) { return false; }
+
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b)
+{
+   return string_is_equal(core_path_a, core_path_b);
+}
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static playlist_t *load(size_t capacity, bool journal)
+{
+   playlist_t *playlist;
+   playlist_config_t config;
+
+   memset(&config, 0, sizeof(config));
+   config.capacity = capacity;
+   playlist_config_set_path(&config, lpl);
+   playlist = playlist_init(&config);
+   playlist_set_journal(playlist, journal);
+   return playlist;
+}
+
+/* Pushes content not in the playlist yet */
+static void push(playlist_t *playlist)
+{
+   char path[64];
+   char label[64];
+   struct playlist_entry entry = {0};
+   struct string_list *roms    = NULL;
+
+   snprintf(path, sizeof(path), "/roms/Game %05u.zip", pushed);
+   snprintf(label, sizeof(label), "Game %05u", pushed);
+
+   entry.path      = path;
+   entry.label     = label;
+   entry.core_path = (char*)"/cores/core_libretro.so";
+   entry.core_name = (char*)"Core";
+   entry.crc32     = (char*)"DEADBEEF|crc";
+   entry.db_name   = (char*)"System.lpl";
+
+   if (pushed % 7 == 3)
+   {
+      union string_list_elem_attr attr;
+
+      attr.i                = 0;
+      roms                  = string_list_new();
+      string_list_append(roms, "/roms/bios.sfc", attr);
+      string_list_append(roms, path, attr);
+      entry.subsystem_ident = (char*)"sgb";
+      entry.subsystem_name  = (char*)"Super Game Boy";
+      entry.subsystem_roms  = roms;
+   }
+
+   playlist_push(playlist, &entry);
+   string_list_free(roms);
+   pushed++;
+}
+
+static bool str_equal(const char *a, const char *b)
+{
+   return (!a && !b) || (a && b && string_is_equal(a, b));
+}
+
+static bool entries_equal(playlist_t *a, playlist_t *b)
+{
+   size_t i, j;
+
+   if (playlist_size(a) != playlist_size(b))
+      return false;
+
+   for (i = 0; i < playlist_size(a); i++)
+   {
+      const struct playlist_entry *x = NULL;
+      const struct playlist_entry *y = NULL;
+
+      playlist_get_index(a, i, &x);
+      playlist_get_index(b, i, &y);
+
+      if (     !str_equal(x->path, y->path)
+            || !str_equal(x->label, y->label)
+            || !str_equal(x->core_path, y->core_path)
+            || !str_equal(x->core_name, y->core_name)
+            || !str_equal(x->db_name, y->db_name)
+            || !str_equal(x->crc32, y->crc32)
+            || !str_equal(x->subsystem_ident, y->subsystem_ident)
+            || !str_equal(x->subsystem_name, y->subsystem_name)
+            || !x->subsystem_roms != !y->subsystem_roms)
+         return false;
+
+      if (x->subsystem_roms)
+      {
+         if (x->subsystem_roms->size != y->subsystem_roms->size)
+            return false;
+
+         for (j = 0; j < x->subsystem_roms->size; j++)
+            if (!str_equal(x->subsystem_roms->elems[j].data,
+                     y->subsystem_roms->elems[j].data))
+               return false;
+      }
+   }
+
+   return true;
+}
+
+static int64_t file_size(const char *path)
+{
+   struct stat buf;
+
+   return stat(path, &buf) == 0 ? (int64_t)buf.st_size : -1;
+}
+
+/* Reads the playlist back, and compares it with @playlist and
+ * with the playlist written in full */
+/* Appends a record with a valid size and CRC: @op, @idx, then the
+ * eight strings of an entry, and @num_roms with @roms_recorded of
+ * them, followed by @trailing stray bytes */
+static void append_record(uint32_t op, uint32_t idx, uint32_t num_roms,
+      unsigned roms_recorded, unsigned trailing)
+{
+   unsigned i;
+   FILE *file;
+   uint32_t header[2];
+   uint8_t record[512];
+   size_t len = 0;
+
+#define PUT_U32(value) \
+   do { uint32_t v = (value); memcpy(record + len, &v, 4); len += 4; } while (0)
+#define PUT_STRING(str) \
+   do { uint32_t n = (uint32_t)strlen(str) + 1; PUT_U32(n); \
+      memcpy(record + len, str, n); len += n; } while (0)
+
+   PUT_U32(op);
+   PUT_U32(idx);
+   for (i = 0; i < 8; i++)
+      PUT_STRING("malformed");
+   PUT_U32(num_roms);
+   for (i = 0; i < roms_recorded; i++)
+      PUT_STRING("/roms/malformed.sfc");
+   for (i = 0; i < trailing; i++)
+      record[len++] = 0;
+
+#undef PUT_STRING
+#undef PUT_U32
+
+   header[0] = (uint32_t)len;
+   header[1] = encoding_crc32(0, record, len);
+
+   if ((file = fopen(lplj, "ab")))
+   {
+      fwrite(header, 1, sizeof(header), file);
+      fwrite(record, 1, len, file);
+      fclose(file);
+   }
+}
+
+static void check_read_back(playlist_t *playlist, const char *msg)
+{
+   playlist_t *journaled = load(playlist_capacity(playlist), true);
+   playlist_t *full      = NULL;
+   bool equal            = entries_equal(playlist, journaled);
+
+   /* A change that cannot be journaled writes it in full */
+   playlist_set_label_display_mode(journaled,
+         LABEL_DISPLAY_MODE_REMOVE_PARENTHESES);
+   playlist_set_label_display_mode(journaled, LABEL_DISPLAY_MODE_DEFAULT);
+   playlist_write_file(journaled);
+   full = load(playlist_capacity(playlist), true);
+
+   check(equal && entries_equal(playlist, full) && !path_is_valid(lplj),
+         "read back", msg);
+
+   playlist_free(full);
+   playlist_free(journaled);
+}
+
+static void test_journal(void)
+{
+   int64_t size;
+   playlist_t *playlist, *other;
+   struct playlist_entry update = {0};
+   const struct playlist_entry *entry = NULL;
+   FILE *file;
+   unsigned i;
+   struct stat st;
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   filestream_delete(lpl);
+   filestream_delete(lplj);
+
+   /* The first write is in full, as there is no file yet */
+   playlist = load(20, true);
+   for (i = 0; i < 10; i++)
+      push(playlist);
+   playlist_write_file(playlist);
+   size = file_size(lpl);
+   check(size > 0 && !path_is_valid(lplj), "journal", "new playlist written");
+
+   push(playlist);
+   playlist_write_file(playlist);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(file_size(lpl) == size && path_is_valid(lplj),
+         "journal", "pushes journaled");
+   check_read_back(playlist, "pushes");
+   playlist_free(playlist);
+
+   /* Pushing content again moves it to the top */
+   playlist = load(20, true);
+   size     = file_size(lpl);
+   playlist_get_index(playlist, 5, &entry);
+   other    = load(20, false);
+   playlist_push(playlist, entry);
+   playlist_write_file(playlist);
+   playlist_get_index(playlist, 0, &entry);
+   check(playlist_size(playlist) == 12 && file_size(lpl) == size
+         && string_is_equal(entry->label, "Game 00006"),
+         "journal", "push moving an entry journaled");
+
+   update.label   = (char*)"Updated";
+   update.db_name = (char*)"Other.lpl";
+   playlist_update(playlist, 3, &update);
+   playlist_delete_index(playlist, 7);
+   playlist_delete_index(playlist, 0);
+   playlist_write_file(playlist);
+   check(playlist_size(playlist) == 10 && file_size(lpl) == size,
+         "journal", "update and deletes journaled");
+
+   /* Without a journal, the playlist is written in full, and the
+    * journal is dropped */
+   push(other);
+   playlist_write_file(other);
+   check(file_size(lpl) != size && !path_is_valid(lplj),
+         "journal", "written in full without journaling");
+   playlist_free(other);
+
+   /* Written since @playlist wrote its journal */
+   size = file_size(lpl);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(file_size(lpl) != size && !path_is_valid(lplj),
+         "journal", "written in full once written by another handle");
+   playlist_free(playlist);
+
+   playlist = load(20, true);
+   size     = file_size(lpl);
+   for (i = 0; i < 15; i++)
+   {
+      push(playlist);
+      playlist_write_file(playlist);
+   }
+   check(playlist_size(playlist) == 20 && file_size(lpl) == size,
+         "capacity", "pushes beyond the capacity journaled");
+   check_read_back(playlist, "pushes beyond the capacity");
+   playlist_free(playlist);
+
+   /* Other changes */
+   playlist = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   playlist_set_sort_mode(playlist, PLAYLIST_SORT_MODE_ALPHABETICAL);
+   playlist_qsort(playlist);
+   playlist_write_file(playlist);
+   check(!path_is_valid(lplj), "full", "written in full when sorted");
+   check_read_back(playlist, "sorted");
+   playlist_free(playlist);
+
+   playlist = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   playlist_clear(playlist);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(!path_is_valid(lplj), "full", "written in full when cleared");
+   check_read_back(playlist, "cleared");
+   playlist_free(playlist);
+
+   /* Grown large */
+   playlist = load(20, true);
+   size     = file_size(lpl);
+   for (i = 0; i < 200 && path_is_valid(lplj) == (i > 0); i++)
+   {
+      push(playlist);
+      playlist_write_file(playlist);
+   }
+   check(i > 100 && i < 200 && file_size(lpl) != size,
+         "full", "written in full once the journal grew large");
+   check_read_back(playlist, "after the journal grew large");
+   playlist_free(playlist);
+
+   /* Crash while appending */
+   playlist = load(20, true);
+   for (i = 0; i < 3; i++)
+   {
+      push(playlist);
+      playlist_write_file(playlist);
+   }
+   other = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   if ((file = fopen(lplj, "r+b")))
+   {
+      fseek(file, 0, SEEK_END);
+      ftruncate(fileno(file), ftell(file) - 5);
+      fclose(file);
+   }
+   playlist_free(playlist);
+   playlist = load(20, true);
+   check(entries_equal(playlist, other), "crash", "cut short record dropped");
+   push(playlist);
+   playlist_write_file(playlist);
+   check(!path_is_valid(lplj), "crash", "written in full next time");
+   check_read_back(playlist, "after a crash");
+   playlist_free(other);
+   playlist_free(playlist);
+
+   playlist = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   other = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   if ((file = fopen(lplj, "r+b")))
+   {
+      fseek(file, -3, SEEK_END);
+      fputc('#', file);
+      fclose(file);
+   }
+   playlist_free(playlist);
+   playlist = load(20, true);
+   check(entries_equal(playlist, other), "crash", "corrupted record dropped");
+   playlist_free(other);
+   playlist_free(playlist);
+
+   /* Malformed records that pass their CRC */
+   for (i = 0; i < 3; i++)
+   {
+      playlist = load(20, true);
+      push(playlist);
+      playlist_write_file(playlist);
+      push(playlist);
+      playlist_write_file(playlist);
+      other = load(20, true);
+      playlist_free(playlist);
+      check(path_is_valid(lplj), "malformed", "journal written");
+
+      switch (i)
+      {
+         case 0:
+            /* New entry missing a subsystem ROM */
+            append_record(0, UINT32_MAX, 2, 1, 0);
+            break;
+         case 1:
+            /* Moved entry with bytes after its values */
+            append_record(0, 3, 0, 0, 4);
+            break;
+         default:
+            /* Updated entry missing a subsystem ROM */
+            append_record(1, 0, 1, 0, 0);
+            break;
+      }
+
+      playlist = load(20, true);
+      check(entries_equal(playlist, other),
+            "malformed", i == 0
+            ? "no entry inserted for a bad new entry"
+            : i == 1 ? "no entry moved for a bad push"
+            : "entry not changed by a bad update");
+      playlist_free(other);
+      playlist_free(playlist);
+   }
+
+   /* Made for another version of the playlist file */
+   filestream_delete(lpl);
+   filestream_delete(lplj);
+   playlist = load(20, true);
+   push(playlist);
+   push(playlist);
+   playlist_write_file(playlist);
+   playlist_free(playlist);
+   playlist = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(path_is_valid(lplj), "stale", "journal written");
+   if ((file = fopen(lpl, "ab")))
+   {
+      fputc('\n', file);
+      fclose(file);
+   }
+   other = load(20, true);
+   playlist_delete_index(playlist, 0);
+   check(entries_equal(playlist, other), "stale", "journal ignored");
+   playlist_free(other);
+   playlist_free(playlist);
+
+   /* Rewritten by someone else, with the same size and time */
+   filestream_delete(lpl);
+   filestream_delete(lplj);
+   playlist = load(20, true);
+   push(playlist);
+   push(playlist);
+   playlist_write_file(playlist);
+   playlist_free(playlist);
+   playlist = load(20, true);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(path_is_valid(lplj), "same time", "journal written");
+   if (!stat(lpl, &st) && filestream_read_file(lpl, &buf, &len))
+   {
+      struct timespec times[2];
+      char *crc = strstr((char*)buf, "DEADBEEF");
+
+      if (crc)
+         memcpy(crc, "BEEFDEAD", 8);
+      filestream_write_file(lpl, buf, len);
+      free(buf);
+
+      times[0] = st.st_atim;
+      times[1] = st.st_mtim;
+      utimensat(AT_FDCWD, lpl, times, 0);
+   }
+   other = load(20, true);
+   check(playlist_size(other) == 2, "same time", "journal ignored");
+   playlist_free(other);
+   push(playlist);
+   playlist_write_file(playlist);
+   check(!path_is_valid(lplj), "same time", "not appended to");
+   playlist_free(playlist);
+}
+
+/* Milliseconds to push an entry and write the playlist */
+static double bench_pushes(unsigned entries, bool journal, unsigned runs)
+{
+   unsigned i;
+   retro_time_t start;
+   playlist_t *playlist = load(entries, journal);
+
+   for (i = playlist_size(playlist); i < entries; i++)
+      push(playlist);
+   playlist_set_label_display_mode(playlist,
+         LABEL_DISPLAY_MODE_REMOVE_PARENTHESES);
+   playlist_write_file(playlist);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < runs; i++)
+   {
+      push(playlist);
+      playlist_write_file(playlist);
+   }
+
+   playlist_free(playlist);
+   return (cpu_features_get_time_usec() - start) / 1000.0 / runs;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned entries = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 1000;
+   double full_ms, journal_ms;
+
+   path_mkdir(dir);
+   fill_pathname_join(lpl, dir, "test.lpl", sizeof(lpl));
+   fill_pathname_join(lplj, dir, "test.lplj", sizeof(lplj));
+
+   test_journal();
+
+   filestream_delete(lpl);
+   filestream_delete(lplj);
+   full_ms    = bench_pushes(entries, false, 50);
+   journal_ms = bench_pushes(entries, true, 50);
+   printf("History of %u entries: %7.3f ms to push and write in full, "
+         "%7.3f ms journaled\n", entries, full_ms, journal_ms);
+
+   filestream_delete(lpl);
+   filestream_delete(lplj);
+   filestream_delete(dir);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
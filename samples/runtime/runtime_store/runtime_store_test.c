@@ -0,0 +1,394 @@
+/* Regression test and benchmark for the runtime store.
+ *
+ *   runtime_store_test [entries]
+ *
+ * Uses (and empties) "runtime_store_test.dir". Checks that entries
+ * survive a restart, that later records win, that the file is little
+ * endian, that a damaged tail or header is dropped with the file kept
+ * aside, that an unreadable file is left alone and that the file is
+ * compacted. Then times populating the runtime of a playlist of
+ * [entries] (10000 by default) items, once from one log file per item
+ * as before and once from the store.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+
+#include "runtime_store.h"
+
+static int failures = 0;
+static const char *dir = "runtime_store_test.dir";
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void make_path(char *s, size_t len, const char *name)
+{
+   fill_pathname_join(s, dir, name, len);
+}
+
+static void store_init(void)
+{
+   char path[PATH_MAX_LENGTH];
+
+   make_path(path, sizeof(path), "store.lrts");
+   runtime_store_init(path);
+}
+
+static int64_t store_file_size(void)
+{
+   char path[PATH_MAX_LENGTH];
+
+   make_path(path, sizeof(path), "store.lrts");
+   return path_get_size(path);
+}
+
+static void make_entry(runtime_store_entry_t *entry, unsigned i)
+{
+   entry->runtime_hours   = i;
+   entry->runtime_minutes = i % 60;
+   entry->runtime_seconds = (i * 7) % 60;
+   entry->year            = 2000 + i % 30;
+   entry->month           = 1 + i % 12;
+   entry->day             = 1 + i % 28;
+   entry->hour            = i % 24;
+   entry->minute          = (i * 3) % 60;
+   entry->second          = (i * 5) % 60;
+}
+
+static bool has_entry(const char *key, unsigned i)
+{
+   runtime_store_entry_t expected, entry;
+
+   make_entry(&expected, i);
+
+   return runtime_store_get(key, &entry)
+      && !memcmp(&entry, &expected, sizeof(entry));
+}
+
+static void set_entry(const char *key, unsigned i)
+{
+   runtime_store_entry_t entry;
+
+   make_entry(&entry, i);
+   runtime_store_set(key, &entry);
+}
+
+static void test_basic(void)
+{
+   int64_t size;
+
+   store_init();
+   check(!has_entry("Core/Game", 1), "basic", "miss on an empty store");
+
+   set_entry("Core/Game", 1);
+   set_entry("Game", 2);
+   check(has_entry("Core/Game", 1) && has_entry("Game", 2),
+         "basic", "hit after set");
+   check(runtime_store_flush(), "basic", "flush");
+   runtime_store_deinit();
+
+   store_init();
+   check(has_entry("Core/Game", 1) && has_entry("Game", 2)
+         && runtime_store_size() == 2, "basic", "entries survive restart");
+
+   /* A session end only appends the entry it changed */
+   size = store_file_size();
+   set_entry("Core/Game", 3);
+   runtime_store_flush();
+   check(store_file_size() == size + 20 + (int64_t)strlen("Core/Game"),
+         "basic", "one record appended");
+
+   /* Unchanged entries are not written again */
+   size = store_file_size();
+   set_entry("Core/Game", 3);
+   runtime_store_flush();
+   check(store_file_size() == size, "basic", "unchanged entry not written");
+   runtime_store_deinit();
+
+   store_init();
+   check(has_entry("Core/Game", 3) && has_entry("Game", 2)
+         && runtime_store_size() == 2, "basic", "later record wins");
+   runtime_store_deinit();
+}
+
+static void test_damaged(void)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   make_path(path, sizeof(path), "store.lrts");
+
+   /* Cut the last record short, as an interrupted write would */
+   if (filestream_read_file(path, &buf, &len))
+   {
+      filestream_write_file(path, buf, len - 3);
+      free(buf);
+   }
+
+   store_init();
+   check(has_entry("Core/Game", 1) && has_entry("Game", 2),
+         "damaged", "torn record dropped, earlier ones kept");
+
+   set_entry("Other", 4);
+   runtime_store_flush();
+   runtime_store_deinit();
+
+   store_init();
+   check(has_entry("Core/Game", 1) && has_entry("Game", 2)
+         && has_entry("Other", 4), "damaged", "rewritten after a torn record");
+   runtime_store_deinit();
+
+   if (filestream_read_file(path, &buf, &len))
+   {
+      ((uint8_t*)buf)[0] ^= 0x10;
+      filestream_write_file(path, buf, len);
+      free(buf);
+   }
+
+   check(!runtime_store_init(path) && runtime_store_size() == 0
+         && !runtime_store_is_read_only(),
+         "damaged", "bad header rejected");
+   set_entry("Game", 5);
+   runtime_store_flush();
+   runtime_store_deinit();
+
+   store_init();
+   check(has_entry("Game", 5) && runtime_store_size() == 1,
+         "damaged", "store replaced");
+   runtime_store_deinit();
+
+   /* The rejected file was kept, as it was */
+   strlcat(path, ".bad", sizeof(path));
+   check(path_get_size(path) == len, "damaged", "old store kept aside");
+   filestream_delete(path);
+}
+
+static void test_layout(void)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf   = NULL;
+   int64_t len = 0;
+   bool ok     = false;
+
+   make_path(path, sizeof(path), "store.lrts");
+   filestream_delete(path);
+
+   store_init();
+   set_entry("Key", 0x10203);
+   runtime_store_flush();
+   runtime_store_deinit();
+
+   /* Header, then CRC, key length, year, hours, the rest and the key,
+    * the same bytes whatever the endianness of the build */
+   if (filestream_read_file(path, &buf, &len))
+   {
+      const uint8_t *ptr = (const uint8_t*)buf;
+
+      ok = len == 8 + 20 + 3
+         && !memcmp(ptr, "RTLS\1\0\0\0", 8)
+         && ptr[12] == 3 && ptr[13] == 0
+         && ptr[14] == (2000 + 0x10203 % 30) % 256
+         && ptr[15] == (2000 + 0x10203 % 30) / 256
+         && ptr[16] == 3 && ptr[17] == 2 && ptr[18] == 1 && ptr[19] == 0
+         && !memcmp(ptr + 28, "Key", 3);
+      free(buf);
+   }
+
+   check(ok, "layout", "fields are little endian");
+   filestream_delete(path);
+}
+
+static void test_unreadable(void)
+{
+   char path[PATH_MAX_LENGTH];
+
+   /* A directory where the store should be cannot be read, nor
+    * must it be replaced */
+   make_path(path, sizeof(path), "store.lrts");
+   filestream_delete(path);
+   path_mkdir(path);
+
+   check(!runtime_store_init(path) && runtime_store_is_read_only(),
+         "unreadable", "store read only");
+   set_entry("Game", 6);
+   check(has_entry("Game", 6) && !runtime_store_flush()
+         && path_is_directory(path),
+         "unreadable", "nothing written");
+   runtime_store_deinit();
+
+   filestream_delete(path);
+   check(!path_is_valid(path), "unreadable", "cleaned up");
+}
+
+static void test_compact(void)
+{
+   unsigned i;
+   int64_t size;
+
+   store_init();
+
+   for (i = 0; i < 500; i++)
+   {
+      set_entry("Game", i);
+      runtime_store_flush();
+   }
+
+   size = store_file_size();
+   runtime_store_deinit();
+
+   /* Loading finds mostly outdated records, the next flush
+    * rewrites the file */
+   store_init();
+   set_entry("Game", 1000);
+   runtime_store_flush();
+   check(store_file_size() < size / 10, "compact", "file compacted");
+   runtime_store_deinit();
+
+   store_init();
+   check(has_entry("Game", 1000) && runtime_store_size() == 1,
+         "compact", "entry kept");
+   runtime_store_deinit();
+}
+
+static void bench(unsigned entries)
+{
+   unsigned i;
+   char key[64];
+   char path[PATH_MAX_LENGTH];
+   char logs[PATH_MAX_LENGTH];
+   retro_time_t start;
+   unsigned found = 0;
+
+   make_path(logs, sizeof(logs), "logs");
+   path_mkdir(logs);
+
+   /* One JSON log per item, as older versions kept them */
+   for (i = 0; i < entries; i++)
+   {
+      char json[256];
+      runtime_store_entry_t entry;
+      int len;
+
+      make_entry(&entry, i);
+      snprintf(key, sizeof(key), "Game %u.lrtl", i);
+      fill_pathname_join(path, logs, key, sizeof(path));
+
+      len = snprintf(json, sizeof(json),
+            "{\n  \"version\": \"1.0\",\n"
+            "  \"runtime\": \"%u:%02u:%02u\",\n"
+            "  \"last_played\": \"%04u-%02u-%02u %02u:%02u:%02u\"\n}\n",
+            entry.runtime_hours, entry.runtime_minutes,
+            entry.runtime_seconds, entry.year, entry.month, entry.day,
+            entry.hour, entry.minute, entry.second);
+      filestream_write_file(path, json, len);
+   }
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < entries; i++)
+   {
+      void *buf   = NULL;
+      int64_t len = 0;
+
+      snprintf(key, sizeof(key), "Game %u.lrtl", i);
+      fill_pathname_join(path, logs, key, sizeof(path));
+
+      if (     path_is_valid(path)
+            && filestream_read_file(path, &buf, &len))
+      {
+         if (strstr((const char*)buf, "\"runtime\""))
+            found++;
+         free(buf);
+      }
+   }
+
+   printf("%u log files:      %8.1f ms (%u found, reading only)\n",
+         entries, (cpu_features_get_time_usec() - start) / 1000.0, found);
+
+   make_path(path, sizeof(path), "store.lrts");
+   filestream_delete(path);
+   store_init();
+
+   for (i = 0; i < entries; i++)
+   {
+      snprintf(key, sizeof(key), "Game %u.lrtl", i);
+      set_entry(key, i);
+   }
+
+   runtime_store_flush();
+   runtime_store_deinit();
+
+   found = 0;
+   start = cpu_features_get_time_usec();
+   store_init();
+
+   for (i = 0; i < entries; i++)
+   {
+      runtime_store_entry_t entry;
+
+      snprintf(key, sizeof(key), "Game %u.lrtl", i);
+      if (runtime_store_get(key, &entry))
+         found++;
+   }
+
+   printf("store, %u entries: %8.1f ms (%u found, including load)\n",
+         entries, (cpu_features_get_time_usec() - start) / 1000.0, found);
+   check(found == entries, "bench", "all entries found");
+
+   start = cpu_features_get_time_usec();
+   set_entry("Game 0.lrtl", entries);
+   runtime_store_flush();
+   printf("session end:       %8.1f ms\n",
+         (cpu_features_get_time_usec() - start) / 1000.0);
+
+   runtime_store_deinit();
+
+   for (i = 0; i < entries; i++)
+   {
+      snprintf(key, sizeof(key), "Game %u.lrtl", i);
+      fill_pathname_join(path, logs, key, sizeof(path));
+      filestream_delete(path);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned entries = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 10000;
+
+   path_mkdir(dir);
+   make_path(path, sizeof(path), "store.lrts");
+   filestream_delete(path);
+
+   test_basic();
+   test_damaged();
+   test_layout();
+   test_unreadable();
+   test_compact();
+   bench(entries);
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,294 @@
+/* Regression test for the content fingerprint store.
+ *
+ *   content_fingerprint_test [directory]
+ *
+ * Uses (and empties) the given directory, "content_fingerprint_test.dir"
+ * by default. Checks hits and misses, that changed files are misses,
+ * that members and fields are kept apart, that the store survives a
+ * restart, that corrupt stores are rejected and that entries for
+ * deleted files are pruned.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+
+#include "content_fingerprint.h"
+
+static int failures = 0;
+static const char *dir = "content_fingerprint_test.dir";
+
+static void check(bool cond, const char *name, const char *msg)
+{
+   if (cond)
+      printf("[SUCCESS] %s: %s\n", name, msg);
+   else
+   {
+      printf("[ERROR] %s: %s\n", name, msg);
+      failures++;
+   }
+}
+
+static void make_path(char *s, size_t len, const char *name)
+{
+   fill_pathname_join(s, dir, name, len);
+}
+
+/* Writes @size bytes to @name, dated @mtime seconds since the epoch */
+static void make_file(const char *name, size_t size, time_t mtime)
+{
+   char path[PATH_MAX_LENGTH];
+   struct utimbuf times;
+   char *data = (char*)calloc(1, size + 1);
+
+   make_path(path, sizeof(path), name);
+   filestream_write_file(path, data, (int64_t)size);
+   free(data);
+
+   times.actime  = mtime;
+   times.modtime = mtime;
+   utime(path, &times);
+}
+
+static void store_init(void)
+{
+   char path[PATH_MAX_LENGTH];
+
+   make_path(path, sizeof(path), "store.bin");
+   content_fingerprint_init(path);
+}
+
+static void set_crc(const char *name, const char *member, uint32_t crc)
+{
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_t fp;
+
+   make_path(path, sizeof(path), name);
+   fp.flags = CONTENT_FINGERPRINT_CRC;
+   fp.crc   = crc;
+   content_fingerprint_update(path, member, &fp);
+}
+
+/* The stored CRC, 0 on a miss */
+static uint32_t get_crc(const char *name, const char *member)
+{
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_t fp;
+
+   make_path(path, sizeof(path), name);
+
+   if (     !content_fingerprint_get(path, member, &fp)
+         || !(fp.flags & CONTENT_FINGERPRINT_CRC))
+      return 0;
+
+   return fp.crc;
+}
+
+static void test_basic(void)
+{
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_t fp;
+   content_fingerprint_stats_t stats;
+
+   store_init();
+   make_file("a.iso", 100, 1000000);
+
+   check(get_crc("a.iso", NULL) == 0, "basic", "miss on an empty store");
+   set_crc("a.iso", NULL, 0x12345678);
+   check(get_crc("a.iso", NULL) == 0x12345678, "basic", "hit after update");
+   check(get_crc("a.iso", "@16:32") == 0, "basic", "members are separate");
+   check(get_crc("missing.iso", NULL) == 0, "basic", "missing file is a miss");
+
+   /* Fields are merged, and an empty serial is a known one */
+   make_path(path, sizeof(path), "a.iso");
+   fp.flags     = CONTENT_FINGERPRINT_SERIAL;
+   fp.serial[0] = '\0';
+   content_fingerprint_update(path, NULL, &fp);
+   check(content_fingerprint_get(path, NULL, &fp)
+         && fp.flags == (CONTENT_FINGERPRINT_CRC | CONTENT_FINGERPRINT_SERIAL)
+         && fp.crc == 0x12345678 && fp.serial[0] == '\0',
+         "basic", "fields merged");
+
+   content_fingerprint_get_stats(&stats);
+   check(stats.hits == 2 && stats.misses == 2 && stats.entries == 1,
+         "basic", "statistics");
+
+   content_fingerprint_deinit();
+}
+
+static void test_changes(void)
+{
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_t fp;
+
+   store_init();
+   make_file("b.iso", 100, 1000000);
+   set_crc("b.iso", NULL, 1);
+
+   make_file("b.iso", 100, 1000001);
+   check(get_crc("b.iso", NULL) == 0, "changes", "newer file is a miss");
+
+   set_crc("b.iso", NULL, 2);
+   make_file("b.iso", 101, 1000001);
+   check(get_crc("b.iso", NULL) == 0, "changes", "longer file is a miss");
+
+   /* Recording one field of a changed file drops the others */
+   set_crc("b.iso", NULL, 3);
+   make_path(path, sizeof(path), "b.iso");
+   make_file("b.iso", 102, 1000001);
+   fp.flags = CONTENT_FINGERPRINT_SERIAL;
+   strlcpy(fp.serial, "SLUS-00001", sizeof(fp.serial));
+   content_fingerprint_update(path, NULL, &fp);
+   check(content_fingerprint_get(path, NULL, &fp)
+         && fp.flags == CONTENT_FINGERPRINT_SERIAL
+         && !strcmp(fp.serial, "SLUS-00001"),
+         "changes", "stale fields dropped");
+
+   content_fingerprint_deinit();
+}
+
+static void test_restart(void)
+{
+   unsigned i;
+   char name[32];
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_t fp;
+   bool ok = true;
+
+   store_init();
+
+   for (i = 0; i < 1000; i++)
+   {
+      snprintf(name, sizeof(name), "c%u.bin", i % 10);
+      if (i < 10)
+         make_file(name, 10 + i, 1000000);
+      snprintf(path, sizeof(path), "@%u:2048", i);
+      set_crc(name, path, i + 1);
+   }
+
+   make_path(path, sizeof(path), "c0.bin");
+   fp.flags = CONTENT_FINGERPRINT_CHEEVOS;
+   strlcpy(fp.cheevos_hash, "0123456789abcdef0123456789abcdef",
+         sizeof(fp.cheevos_hash));
+   content_fingerprint_update(path, NULL, &fp);
+
+   check(content_fingerprint_flush(), "restart", "flush");
+   content_fingerprint_deinit();
+
+   store_init();
+
+   for (i = 0; i < 1000; i++)
+   {
+      snprintf(name, sizeof(name), "c%u.bin", i % 10);
+      snprintf(path, sizeof(path), "@%u:2048", i);
+      if (get_crc(name, path) != i + 1)
+         ok = false;
+   }
+
+   check(ok, "restart", "1000 entries survive");
+
+   make_path(path, sizeof(path), "c0.bin");
+   check(content_fingerprint_get(path, NULL, &fp)
+         && fp.flags == CONTENT_FINGERPRINT_CHEEVOS
+         && !strcmp(fp.cheevos_hash, "0123456789abcdef0123456789abcdef"),
+         "restart", "achievement hash survives");
+
+   make_path(path, sizeof(path), "store.bin.tmp");
+   check(!path_is_valid(path), "restart", "no temporary file left");
+
+   content_fingerprint_deinit();
+}
+
+static void test_corrupt(void)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   make_path(path, sizeof(path), "store.bin");
+
+   if (filestream_read_file(path, &buf, &len))
+   {
+      ((uint8_t*)buf)[len / 2] ^= 0x10;
+      filestream_write_file(path, buf, len);
+      free(buf);
+   }
+
+   check(!content_fingerprint_init(path), "corrupt", "flipped bit rejected");
+   check(get_crc("c1.bin", "@1:2048") == 0, "corrupt", "nothing loaded");
+
+   /* The next flush replaces it */
+   set_crc("c1.bin", NULL, 42);
+   content_fingerprint_deinit();
+   store_init();
+   check(get_crc("c1.bin", NULL) == 42, "corrupt", "store replaced");
+   content_fingerprint_deinit();
+
+   if (filestream_read_file(path, &buf, &len))
+   {
+      filestream_write_file(path, buf, len - 1);
+      free(buf);
+   }
+
+   check(!content_fingerprint_init(path), "corrupt", "truncated store rejected");
+   content_fingerprint_deinit();
+}
+
+static void test_prune(void)
+{
+   char path[PATH_MAX_LENGTH];
+   content_fingerprint_stats_t stats;
+
+   make_path(path, sizeof(path), "store.bin");
+   filestream_delete(path);
+   store_init();
+
+   make_file("d.bin", 10, 1000000);
+   make_file("e.bin", 10, 1000000);
+   set_crc("d.bin", NULL, 1);
+   set_crc("d.bin", "@0:5", 2);
+   set_crc("e.bin", NULL, 3);
+
+   make_path(path, sizeof(path), "d.bin");
+   filestream_delete(path);
+   content_fingerprint_prune();
+
+   content_fingerprint_get_stats(&stats);
+   check(stats.entries == 1, "prune", "entries of deleted file removed");
+   check(get_crc("e.bin", NULL) == 3, "prune", "others still found");
+
+   content_fingerprint_deinit();
+}
+
+int main(int argc, char **argv)
+{
+   char path[PATH_MAX_LENGTH];
+
+   if (argc > 1)
+      dir = argv[1];
+
+   path_mkdir(dir);
+   make_path(path, sizeof(path), "store.bin");
+   filestream_delete(path);
+
+   test_basic();
+   test_changes();
+   test_restart();
+   test_corrupt();
+   test_prune();
+
+   if (failures)
+      printf("[ERROR] %d check(s) failed\n", failures);
+   else
+      printf("[SUCCESS] All checks passed\n");
+
+   return failures ? 1 : 0;
+}
@@ -29,6 +29,7 @@
 #include <streams/interface_stream.h>
 #include "tasks_internal.h"
 
+#include "../content_fingerprint.h"
 #include "../core_info.h"
 #include "../database_info.h"
 
@@ -100,13 +101,18 @@ static const char *database_info_get_current_element_name(
 {
    if (!handle || !handle->list)
       return NULL;
-   /* Skip pruned entries */
-   while (!handle->list->elems[handle->list_ptr].data)
+
+   for (;;)
    {
-      if (++handle->list_ptr >= handle->list->size)
+      /* Wait for the next directory while the rest is still listed */
+      if (     handle->list_ptr >= handle->list->size
+            && !database_info_dir_next(handle))
          return NULL;
+      /* Skip pruned entries */
+      if (handle->list->elems[handle->list_ptr].data)
+         return handle->list->elems[handle->list_ptr].data;
+      handle->list_ptr++;
    }
-   return handle->list->elems[handle->list_ptr].data;
 }
 
 static int task_database_iterate_start(retro_task_t *task,
@@ -188,13 +194,39 @@ static int intfstream_get_serial(intfstream_t *fd, char *serial)
   return 1;
 }
 
+/* Fingerprints of a part of a file (a track in a CUE sheet) are
+ * keyed by the range they were read from. */
+static const char *task_database_fingerprint_member(char *s, size_t len,
+      uint64_t offset, uint64_t size)
+{
+   if (offset == 0 && size >= SIZE_MAX)
+      return NULL;
+
+   snprintf(s, len, "@%llu:%llu",
+         (unsigned long long)offset, (unsigned long long)size);
+   return s;
+}
+
 static bool intfstream_file_get_serial(const char *name,
       uint64_t offset, uint64_t size, char *serial)
 {
    int rv;
+   char member[64];
+   content_fingerprint_t fp;
    uint8_t *data     = NULL;
    int64_t file_size = -1;
-   intfstream_t *fd  = intfstream_open_file(name,
+   intfstream_t *fd  = NULL;
+   const char *range = task_database_fingerprint_member(
+         member, sizeof(member), offset, size);
+
+   if (     content_fingerprint_get(name, range, &fp)
+         && (fp.flags & CONTENT_FINGERPRINT_SERIAL))
+   {
+      strcpy(serial, fp.serial);
+      return !string_is_empty(serial);
+   }
+
+   fd = intfstream_open_file(name,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!fd)
@@ -240,6 +272,15 @@ static bool intfstream_file_get_serial(const char *name,
    intfstream_close(fd);
    free(fd);
    free(data);
+
+   /* Not finding one is remembered too, as an empty serial */
+   if (strlen(serial) < sizeof(fp.serial))
+   {
+      fp.flags = CONTENT_FINGERPRINT_SERIAL;
+      strlcpy(fp.serial, rv ? serial : "", sizeof(fp.serial));
+      content_fingerprint_update(name, range, &fp);
+   }
+
    return rv;
 
 error:
@@ -309,7 +350,17 @@ static int task_database_gdi_get_serial(const char *name, char* serial)
 static int task_database_chd_get_serial(const char *name, char* serial)
 {
    int result;
-   intfstream_t *fd = intfstream_open_chd_track(
+   content_fingerprint_t fp;
+   intfstream_t *fd = NULL;
+
+   if (     content_fingerprint_get(name, "chd", &fp)
+         && (fp.flags & CONTENT_FINGERPRINT_SERIAL))
+   {
+      strcpy(serial, fp.serial);
+      return !string_is_empty(serial);
+   }
+
+   fd = intfstream_open_chd_track(
          name,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE,
@@ -320,6 +371,14 @@ static int task_database_chd_get_serial(const char *name, char* serial)
    result = intfstream_get_serial(fd, serial);
    intfstream_close(fd);
    free(fd);
+
+   if (strlen(serial) < sizeof(fp.serial))
+   {
+      fp.flags = CONTENT_FINGERPRINT_SERIAL;
+      strlcpy(fp.serial, result ? serial : "", sizeof(fp.serial));
+      content_fingerprint_update(name, "chd", &fp);
+   }
+
    return result;
 }
 
@@ -327,10 +386,23 @@ static bool intfstream_file_get_crc(const char *name,
       uint64_t offset, size_t size, uint32_t *crc)
 {
    bool rv;
-   intfstream_t *fd  = intfstream_open_file(name,
-         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   char member[64];
+   content_fingerprint_t fp;
+   intfstream_t *fd  = NULL;
    uint8_t *data     = NULL;
    int64_t file_size = -1;
+   const char *range = task_database_fingerprint_member(
+         member, sizeof(member), offset, size);
+
+   if (     content_fingerprint_get(name, range, &fp)
+         && (fp.flags & CONTENT_FINGERPRINT_CRC))
+   {
+      *crc = fp.crc;
+      return 1;
+   }
+
+   fd = intfstream_open_file(name,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!fd)
       return 0;
@@ -369,6 +441,14 @@ static bool intfstream_file_get_crc(const char *name,
    intfstream_close(fd);
    free(fd);
    free(data);
+
+   if (rv)
+   {
+      fp.flags = CONTENT_FINGERPRINT_CRC;
+      fp.crc   = *crc;
+      content_fingerprint_update(name, range, &fp);
+   }
+
    return rv;
 
 error:
@@ -449,7 +529,17 @@ static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
 static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
 {
    bool rv;
-   intfstream_t *fd = intfstream_open_chd_track(
+   content_fingerprint_t fp;
+   intfstream_t *fd = NULL;
+
+   if (     content_fingerprint_get(name, "chd", &fp)
+         && (fp.flags & CONTENT_FINGERPRINT_CRC))
+   {
+      *crc = fp.crc;
+      return 1;
+   }
+
+   fd = intfstream_open_chd_track(
          name,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE,
@@ -461,6 +551,10 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
    if (rv)
    {
       RARCH_LOG("CHD '%s' crc: %x\n", name, *crc);
+
+      fp.flags = CONTENT_FINGERPRINT_CRC;
+      fp.crc   = *crc;
+      content_fingerprint_update(name, "chd", &fp);
    }
    if (fd)
    {
@@ -489,8 +583,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
                && string_is_equal(path, db->list->elems[i].data))
          {
             RARCH_LOG("Pruning file referenced by cue: %s\n", path);
-            free(db->list->elems[i].data);
-            db->list->elems[i].data = NULL;
+            string_list_set(db->list, (unsigned)i, NULL);
          }
       }
    }
@@ -522,8 +615,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
                && string_is_equal(path, db->list->elems[i].data))
          {
             RARCH_LOG("Pruning file referenced by gdi: %s\n", path);
-            free(db->list->elems[i].data);
-            db->list->elems[i].data = NULL;
+            string_list_set(db->list, (unsigned)i, NULL);
          }
       }
    }
@@ -892,7 +984,17 @@ static int task_database_iterate_crc_lookup(
     * or the file is empty. */
    if (!db_state->crc)
    {
-      db_state->crc = file_archive_get_file_crc32(name);
+      content_fingerprint_t fp;
+
+      if (     content_fingerprint_get(name, NULL, &fp)
+            && (fp.flags & CONTENT_FINGERPRINT_CRC))
+         db_state->crc = fp.crc;
+      else if ((db_state->crc = file_archive_get_file_crc32(name)))
+      {
+         fp.flags = CONTENT_FINGERPRINT_CRC;
+         fp.crc   = db_state->crc;
+         content_fingerprint_update(name, NULL, &fp);
+      }
 
       if (!db_state->crc)
          return database_info_list_iterate_next(db_state);
@@ -1268,7 +1370,8 @@ static void task_database_handler(retro_task_t *task)
       case DATABASE_STATUS_ITERATE_NEXT:
          dbinfo->list_ptr++;
 
-         if (dbinfo->list_ptr < dbinfo->list->size)
+         if (     dbinfo->list_ptr < dbinfo->list->size
+               || database_info_dir_next(dbinfo))
          {
             dbinfo->status = DATABASE_STATUS_ITERATE_START;
             dbinfo->type   = DATABASE_TYPE_ITERATE;
@@ -1288,6 +1391,7 @@ static void task_database_handler(retro_task_t *task)
 #else
             fprintf(stderr, "msg: %s\n", msg);
 #endif
+            content_fingerprint_prune();
             goto task_finished;
          }
          break;
@@ -1302,6 +1406,16 @@ task_finished:
    if (task)
       task_set_finished(task, true);
 
+   /* Also keeps what a cancelled scan found out */
+   {
+      content_fingerprint_stats_t stats;
+
+      content_fingerprint_flush();
+      content_fingerprint_get_stats(&stats);
+      RARCH_LOG("[Database]: Fingerprints: %u hits, %u misses, %u stored.\n",
+            stats.hits, stats.misses, stats.entries);
+   }
+
    if (dbstate)
    {
       if (dbstate->list)
@@ -56,6 +56,7 @@ typedef struct manual_scan_handle
    playlist_config_t playlist_config;
    playlist_t *playlist;
    struct string_list *content_list;
+   dir_walk_t *content_walk;
    logiqx_dat_t *dat_file;
    size_t list_size;
    size_t list_index;
@@ -88,6 +89,12 @@ static void free_manual_content_scan_handle(manual_scan_handle_t *manual_scan)
       manual_scan->content_list = NULL;
    }
 
+   if (manual_scan->content_walk)
+   {
+      dir_walk_free(manual_scan->content_walk);
+      manual_scan->content_walk = NULL;
+   }
+
    if (manual_scan->m3u_list)
    {
       string_list_free(manual_scan->m3u_list);
@@ -199,11 +206,17 @@ static void task_manual_content_scan_handler(retro_task_t *task)
    {
       case MANUAL_SCAN_BEGIN:
          {
-            /* Get content list */
-            manual_scan->content_list = manual_content_scan_get_content_list(
+            /* Start listing content
+             * > Content is added to the playlist while
+             *   the remaining directories are listed */
+            manual_scan->content_walk = manual_content_scan_get_content_walk(
                   manual_scan->task_config);
+            manual_scan->content_list = string_list_new();
 
-            if (!manual_scan->content_list)
+            if (     !manual_scan->content_walk
+                  || !manual_scan->content_list
+                  || !manual_content_scan_get_content_list(
+                        manual_scan->content_walk, manual_scan->content_list))
             {
                runloop_msg_queue_push(
                      msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_INVALID_CONTENT),
@@ -299,8 +312,14 @@ static void task_manual_content_scan_handler(retro_task_t *task)
                }
             }
 
-            /* Increment content index */
+            /* Increment content index, fetching the
+             * content of the next directory if required */
             manual_scan->list_index++;
+            if (manual_scan->list_index >= manual_scan->list_size &&
+                  manual_content_scan_get_content_list(
+                     manual_scan->content_walk, manual_scan->content_list))
+               manual_scan->list_size = manual_scan->content_list->size;
+
             if (manual_scan->list_index >= manual_scan->list_size)
             {
                /* Check whether we have any M3U files